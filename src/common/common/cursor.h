@@ -27,6 +27,7 @@
 #include <guacamole/client.h>
 #include <guacamole/socket.h>
 #include <guacamole/user.h>
+#include <pthread.h>
 
 /**
  * The default size of the cursor image buffer.
@@ -123,6 +124,13 @@ typedef struct guac_common_cursor {
      */
     guac_timestamp timestamp;
 
+    /**
+     * Lock which is acquired while the cursor image is being changed or
+     * sent, such that the instructions sending the cursor image are never
+     * interrupted by a resync.
+     */
+    pthread_mutex_t _lock;
+
 } guac_common_cursor;
 
 /**
@@ -162,6 +170,41 @@ void guac_common_cursor_free(guac_common_cursor* cursor);
 void guac_common_cursor_dup(guac_common_cursor* cursor, guac_user* user,
         guac_socket* socket);
 
+/**
+ * Acquires the lock of the given cursor, preventing the cursor image from
+ * being changed until the lock is released with guac_common_cursor_unlock().
+ *
+ * @param cursor
+ *     The cursor to lock.
+ */
+void guac_common_cursor_lock(guac_common_cursor* cursor);
+
+/**
+ * Releases the lock of the given cursor, as acquired by
+ * guac_common_cursor_lock().
+ *
+ * @param cursor
+ *     The cursor to unlock.
+ */
+void guac_common_cursor_unlock(guac_common_cursor* cursor);
+
+/**
+ * Sends the current state of this cursor across the given socket, exactly
+ * as guac_common_cursor_dup(), except that the cursor must already be locked
+ * with guac_common_cursor_lock().
+ *
+ * @param cursor
+ *     The cursor to send.
+ *
+ * @param user
+ *     The user receiving the updated cursor.
+ *
+ * @param socket
+ *     The socket over which the updated cursor should be sent.
+ */
+void guac_common_cursor_resync(guac_common_cursor* cursor, guac_user* user,
+        guac_socket* socket);
+
 /**
  * Updates the current position and button state of the mouse cursor, marking
  * the given user as the most recent user of the mouse. The remote mouse cursor
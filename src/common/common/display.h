@@ -21,6 +21,9 @@
 #define GUAC_COMMON_DISPLAY_H
 
 #include "cursor.h"
+#include "encode-pool.h"
+#include "image-cache.h"
+#include "quality-controller.h"
 #include "surface.h"
 
 #include <guacamole/client.h>
@@ -28,6 +31,13 @@
 
 #include <pthread.h>
 
+/**
+ * The maximum number of threads that may concurrently encode the images of a
+ * single display, regardless of the number requested or of the number of
+ * processors available.
+ */
+#define GUAC_COMMON_DISPLAY_MAX_ENCODE_THREADS 16
+
 /**
  * A list element representing a pairing of a Guacamole layer with a
  * corresponding guac_common_surface which wraps that layer. Adjacent layers
@@ -62,6 +72,54 @@ struct guac_common_display_layer {
      */
     guac_common_display_layer* next;
 
+    /**
+     * The display which allocated this layer.
+     */
+    struct guac_common_display* display;
+
+    /**
+     * Non-zero if this layer is currently within the set of layers having
+     * changes awaiting the next flush of the display, zero otherwise. This
+     * member is protected by the _dirty_lock of the display.
+     */
+    int dirty;
+
+    /**
+     * The next layer within the set of layers having changes awaiting the
+     * next flush of the display, or NULL if this is the last such layer. This
+     * member is protected by the _dirty_lock of the display.
+     */
+    guac_common_display_layer* next_dirty;
+
+};
+
+/**
+ * A record of a layer or buffer which has been freed, retained such that
+ * users which missed the corresponding "dispose" instruction can be
+ * resynchronized.
+ */
+typedef struct guac_common_display_disposed guac_common_display_disposed;
+
+struct guac_common_display_disposed {
+
+    /**
+     * The index of the layer or buffer which was freed.
+     */
+    int index;
+
+    /**
+     * The timestamp of the "sync" instruction which preceded the "dispose"
+     * instruction for the layer or buffer, as stored in the
+     * last_sent_timestamp member of the guac_client when it was freed.
+     */
+    guac_timestamp frame;
+
+    /**
+     * The next record in the list of all freed layers and buffers, or NULL
+     * if this is the last record.
+     */
+    guac_common_display_disposed* next;
+
 };
 
 /**
@@ -99,6 +157,13 @@ typedef struct guac_common_display {
      */
     guac_common_display_layer* buffers;
 
+    /**
+     * The first element within a linked list of records of all layers and
+     * buffers which have been freed and whose indices have not since been
+     * reused, or NULL if there are no such layers or buffers.
+     */
+    guac_common_display_disposed* disposed;
+
     /**
      * Non-zero if all graphical updates for this display should use lossless
      * compression, 0 otherwise. By default, newly-created displays will use
@@ -106,6 +171,42 @@ typedef struct guac_common_display {
      */
     int lossless;
 
+    /**
+     * The pool of threads which concurrently encode the images sent when the
+     * surfaces of this display are flushed, or NULL if images are encoded one
+     * at a time by the thread flushing each surface.
+     */
+    guac_common_encode_pool* encode_pool;
+
+    /**
+     * The cache of images previously sent when the surfaces of this display
+     * were flushed, or NULL if images are not cached.
+     */
+    guac_common_image_cache* image_cache;
+
+    /**
+     * The controller which chooses the parameters used to encode the images
+     * sent when the surfaces of this display are flushed, adjusting those
+     * parameters as congestion is measured from the users of the client.
+     */
+    guac_common_quality_controller* quality_controller;
+
+    /**
+     * The list element tracking whether the default surface has changes
+     * awaiting the next flush. This element is not part of the layers list,
+     * and its layer member is NULL.
+     */
+    guac_common_display_layer default_layer;
+
+    /**
+     * The first element within the set of visible layers (excluding the
+     * default layer) whose surfaces have changes awaiting the next flush,
+     * linked via the next_dirty member of each element, or NULL if no such
+     * layers exist. Only these layers are visited when the display is
+     * flushed.
+     */
+    guac_common_display_layer* dirty_layers;
+
     /**
      * Mutex which is locked internally when access to the display must be
      * synchronized. All public functions of guac_common_display should be
@@ -113,6 +214,13 @@ typedef struct guac_common_display {
      */
     pthread_mutex_t _lock;
 
+    /**
+     * Mutex which guards dirty_layers and the dirty state of each layer.
+     * This lock is acquired while surfaces are locked, and thus must never be
+     * held while acquiring the lock of any surface.
+     */
+    pthread_mutex_t _dirty_lock;
+
 } guac_common_display;
 
 /**
@@ -160,9 +268,44 @@ void guac_common_display_free(guac_common_display* display);
 void guac_common_display_dup(guac_common_display* display, guac_user* user,
         guac_socket* socket);
 
+/**
+ * Resynchronizes the given user with the current state of the display, where
+ * the user is known to have received all output up to and including the
+ * frame ending with the given timestamp, but may have missed any output
+ * following that frame. Unlike guac_common_display_dup(), which assumes the
+ * remote display of the user is empty, only the layers, buffers, and regions
+ * which have changed since that frame are sent, and any layers or buffers
+ * freed since that frame are disposed.
+ *
+ * Any broadcast output not yet written to the user is discarded with
+ * guac_client_discard_broadcast() while the display is locked, such that the
+ * state sent corresponds exactly to the point at which the user resumes
+ * receiving broadcast output. Discarded instructions which do not affect the
+ * display, such as those of audio or clipboard streams, are sent to the user
+ * ahead of the display state. This function must thus only be invoked from
+ * within the client's resync handler.
+ *
+ * @param display
+ *     The display whose state should be sent along the given socket.
+ *
+ * @param user
+ *     The user receiving the display state.
+ *
+ * @param socket
+ *     The socket over which the display state should be sent.
+ *
+ * @param since
+ *     The timestamp of the most recent frame which the user is known to
+ *     have received in its entirety.
+ */
+void guac_common_display_resync(guac_common_display* display, guac_user* user,
+        guac_socket* socket, guac_timestamp since);
+
 /**
  * Flushes pending changes to the given display. All pending operations will
- * become visible to any connected users.
+ * become visible to any connected users. Only layers which have changed since
+ * the previous flush are visited. The time taken to flush each such layer is
+ * logged at the GUAC_LOG_TRACE level.
  *
  * @param display
  *     The display to flush.
@@ -257,5 +400,44 @@ void guac_common_display_free_buffer(guac_common_display* display,
 void guac_common_display_set_lossless(guac_common_display* display,
         int lossless);
 
+/**
+ * Sets the number of threads which should concurrently encode the images
+ * sent when the surfaces of the given display are flushed, applying to all
+ * current and future layers and buffers. By default, newly-created displays
+ * encode all images within the thread flushing each surface. Regardless of
+ * the number of threads, images are sent in the same order as they would be
+ * if encoded one at a time.
+ *
+ * @param display
+ *     The display to modify.
+ *
+ * @param threads
+ *     The total number of threads that should encode images, including the
+ *     thread flushing each surface. If this value is 1 or less, all images
+ *     are encoded by the thread flushing each surface. Values greater than
+ *     the number of online processors, or than
+ *     GUAC_COMMON_DISPLAY_MAX_ENCODE_THREADS, are reduced to the lower of
+ *     the two.
+ */
+void guac_common_display_set_encode_threads(guac_common_display* display,
+        int threads);
+
+/**
+ * Sets the maximum total size of the images cached when the surfaces of the
+ * given display are flushed. Updates whose contents are identical to a
+ * cached image are sent as copies from client-side buffers rather than as
+ * newly-encoded images. Any existing cache is discarded. By default,
+ * newly-created displays do not cache images.
+ *
+ * @param display
+ *     The display to modify.
+ *
+ * @param size
+ *     The maximum total size of all cached images, in bytes, or zero if
+ *     images should not be cached.
+ */
+void guac_common_display_set_image_cache_size(guac_common_display* display,
+        size_t size);
+
 #endif
 
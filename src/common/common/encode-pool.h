@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_ENCODE_POOL_H
+#define GUAC_COMMON_ENCODE_POOL_H
+
+#include "config.h"
+
+#include <guacamole/socket.h>
+
+/**
+ * Handler which performs a single job submitted to a
+ * guac_common_encode_pool, such as encoding and sending an image, writing
+ * all resulting instructions to the given socket. The socket provided is
+ * private to the job, and the data written will later be sent to the real
+ * socket in the order that jobs were submitted.
+ *
+ * @param socket
+ *     The socket that all instructions produced by the job must be written
+ *     to.
+ *
+ * @param data
+ *     The arbitrary data provided when the job was submitted. The handler is
+ *     responsible for freeing this data, if necessary.
+ */
+typedef void guac_common_encode_pool_handler(guac_socket* socket, void* data);
+
+/**
+ * A pool of worker threads which perform independent jobs, typically the
+ * compression of images, concurrently, while ultimately sending the output
+ * of each job in exactly the order those jobs were submitted. The thread
+ * submitting jobs also performs jobs while waiting for them to complete.
+ */
+typedef struct guac_common_encode_pool guac_common_encode_pool;
+
+/**
+ * Allocates a new encode pool having the given number of threads, including
+ * the thread that will be submitting jobs. An encode pool having only one
+ * thread starts no additional threads, performing all jobs within the
+ * thread that flushes the pool.
+ *
+ * @param threads
+ *     The total number of threads that should perform jobs, including the
+ *     thread submitting those jobs. This must be positive.
+ *
+ * @return
+ *     A newly-allocated encode pool, or NULL if the pool could not be
+ *     allocated.
+ */
+guac_common_encode_pool* guac_common_encode_pool_alloc(int threads);
+
+/**
+ * Stops all worker threads of the given encode pool and frees the pool. Any
+ * jobs submitted but not yet flushed are discarded without being performed.
+ *
+ * @param pool
+ *     The encode pool to free.
+ */
+void guac_common_encode_pool_free(guac_common_encode_pool* pool);
+
+/**
+ * Acquires exclusive use of the given encode pool for submitting a series of
+ * jobs, blocking if another thread is currently using the pool. Exclusive
+ * use of the pool is released when the pool is next flushed with
+ * guac_common_encode_pool_flush().
+ *
+ * @param pool
+ *     The encode pool to acquire.
+ */
+void guac_common_encode_pool_begin(guac_common_encode_pool* pool);
+
+/**
+ * Submits a new job to the given encode pool. The job may begin
+ * immediately within any worker thread. Any data read by the job must not
+ * be modified until the pool has been flushed with
+ * guac_common_encode_pool_flush(). Exclusive use of the pool must have been
+ * acquired with guac_common_encode_pool_begin().
+ *
+ * @param pool
+ *     The encode pool to submit the job to.
+ *
+ * @param handler
+ *     The handler which performs the job.
+ *
+ * @param data
+ *     Arbitrary data to pass to the handler.
+ *
+ * @return
+ *     Zero if the job was successfully submitted, non-zero if the job could
+ *     not be submitted due to lack of memory, in which case the handler will
+ *     not be invoked.
+ */
+int guac_common_encode_pool_submit(guac_common_encode_pool* pool,
+        guac_common_encode_pool_handler* handler, void* data);
+
+/**
+ * Waits for all jobs submitted to the given encode pool to complete,
+ * writing the output of each job to the given socket in the order the jobs
+ * were submitted. The output of each job is written atomically with respect
+ * to other instructions written to the socket. Output is written as soon as
+ * it is available, while later jobs may still be in progress. Exclusive use
+ * of the pool must have been acquired with guac_common_encode_pool_begin(),
+ * and is released once all output has been written.
+ *
+ * @param pool
+ *     The encode pool to flush.
+ *
+ * @param socket
+ *     The socket to write the output of all jobs to.
+ */
+void guac_common_encode_pool_flush(guac_common_encode_pool* pool,
+        guac_socket* socket);
+
+#endif
+
@@ -0,0 +1,275 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_HEAT_MAP_H
+#define GUAC_COMMON_HEAT_MAP_H
+
+#include "config.h"
+#include "rect.h"
+
+#include <guacamole/timestamp.h>
+
+#include <pthread.h>
+
+/**
+ * Heat map cell size in pixels. Each side of each heat map cell will consist
+ * of this many pixels.
+ */
+#define GUAC_COMMON_HEAT_MAP_CELL_SIZE 64
+
+/**
+ * The width or height of the heat map (in cells) given the width or height of
+ * the image (in pixels).
+ */
+#define GUAC_COMMON_HEAT_MAP_DIMENSION(x) (       \
+        (x + GUAC_COMMON_HEAT_MAP_CELL_SIZE - 1)  \
+            / GUAC_COMMON_HEAT_MAP_CELL_SIZE      \
+)
+
+/**
+ * The number of rows of cells within each band of the heat map. Each band is
+ * locked independently, such that updates to different areas of the same
+ * heat map need not wait for each other.
+ */
+#define GUAC_COMMON_HEAT_MAP_BAND_HEIGHT 4
+
+/**
+ * The weight given to each new sample when updating the moving average of
+ * the interval between updates to a heat map cell, expressed as a power of
+ * two. A value of 2 gives each new sample a weight of 1/4, roughly matching
+ * the responsiveness of averaging the last several updates.
+ */
+#define GUAC_COMMON_HEAT_MAP_EMA_SHIFT 2
+
+/**
+ * The number of fractional bits used to store the moving average of the
+ * interval between updates to a heat map cell. Intervals are stored in
+ * milliseconds multiplied by 2 to the power of this value.
+ */
+#define GUAC_COMMON_HEAT_MAP_INTERVAL_BITS 4
+
+/**
+ * The number of intervals between updates which must be observed for a heat
+ * map cell before that cell reports a non-zero framerate. This prevents
+ * areas which have merely been updated a couple of times in quick succession
+ * from being considered part of an animation or video.
+ */
+#define GUAC_COMMON_HEAT_MAP_MIN_SAMPLES 4
+
+/**
+ * The maximum interval between updates to a heat map cell which is
+ * considered when calculating that cell's framerate, in milliseconds. Longer
+ * intervals are treated as if they were this long.
+ */
+#define GUAC_COMMON_HEAT_MAP_MAX_INTERVAL 60000
+
+/**
+ * Representation of a cell in the refresh heat map. This cell is used to keep
+ * track of how often an area on a surface is refreshed.
+ */
+typedef struct guac_common_heat_map_cell {
+
+    /**
+     * The timestamp of the most recent update covering the location
+     * associated with this heat map cell, or zero if no such update has
+     * occurred.
+     */
+    guac_timestamp last_update;
+
+    /**
+     * The exponential moving average of the time elapsed between updates to
+     * this cell, in fixed-point milliseconds having
+     * GUAC_COMMON_HEAT_MAP_INTERVAL_BITS fractional bits, or zero if fewer
+     * than two updates have occurred.
+     */
+    unsigned int interval;
+
+    /**
+     * The number of intervals between updates which have been observed for
+     * this cell, up to GUAC_COMMON_HEAT_MAP_MIN_SAMPLES.
+     */
+    int samples;
+
+    /**
+     * The framerate of this cell, in frames per second, as derived from the
+     * moving average interval, or zero if fewer than
+     * GUAC_COMMON_HEAT_MAP_MIN_SAMPLES intervals have been observed. This
+     * value is recalculated only when the cell is updated.
+     */
+    unsigned int framerate;
+
+} guac_common_heat_map_cell;
+
+/**
+ * A horizontal band of GUAC_COMMON_HEAT_MAP_BAND_HEIGHT rows of heat map
+ * cells, along with the summed-area table of the framerates of those cells.
+ */
+typedef struct guac_common_heat_map_band {
+
+    /**
+     * The cells within this band, in row-major order.
+     */
+    guac_common_heat_map_cell* cells;
+
+    /**
+     * The summed-area table of the framerates of all cells within this band,
+     * containing (rows + 1) * (width + 1) entries. The entry at row Y and
+     * column X is the sum of the framerates of all cells above and to the
+     * left of cell (X, Y), such that the sum over any rectangle of cells can
+     * be calculated from four entries.
+     */
+    unsigned int* sums;
+
+    /**
+     * The number of rows of cells within this band.
+     */
+    int rows;
+
+    /**
+     * Non-zero if the framerates of any cells within this band have changed
+     * since the summed-area table was last recalculated.
+     */
+    int dirty;
+
+    /**
+     * Lock which must be held while accessing the cells or summed-area table
+     * of this band.
+     */
+    pthread_mutex_t lock;
+
+} guac_common_heat_map_band;
+
+/**
+ * A heat map tracking the frequency at which each area of a surface is
+ * updated. Each cell of the heat map maintains a moving average of the
+ * interval between its updates, and the average framerate of any rectangle
+ * can be queried in constant time per band via a summed-area table which is
+ * recalculated only when queried after a change. All functions of
+ * guac_common_heat_map are threadsafe.
+ */
+typedef struct guac_common_heat_map {
+
+    /**
+     * The width of this heat map, in cells.
+     */
+    int width;
+
+    /**
+     * The height of this heat map, in cells.
+     */
+    int height;
+
+    /**
+     * The bands of cells making up this heat map, in order from top to
+     * bottom.
+     */
+    guac_common_heat_map_band* bands;
+
+    /**
+     * The number of bands within this heat map.
+     */
+    int band_count;
+
+    /**
+     * Lock which must be held for reading while accessing any band, and for
+     * writing while changing the dimensions of this heat map.
+     */
+    pthread_rwlock_t lock;
+
+} guac_common_heat_map;
+
+/**
+ * Allocates a new heat map covering a surface of the given dimensions. All
+ * cells of the new heat map have a framerate of zero.
+ *
+ * @param width
+ *     The width of the surface covered by the heat map, in pixels.
+ *
+ * @param height
+ *     The height of the surface covered by the heat map, in pixels.
+ *
+ * @return
+ *     A newly-allocated heat map, which must eventually be freed with
+ *     guac_common_heat_map_free().
+ */
+guac_common_heat_map* guac_common_heat_map_alloc(int width, int height);
+
+/**
+ * Frees the given heat map and all associated resources.
+ *
+ * @param heat_map
+ *     The heat map to free.
+ */
+void guac_common_heat_map_free(guac_common_heat_map* heat_map);
+
+/**
+ * Resizes the given heat map to cover a surface of the given dimensions,
+ * discarding all past updates.
+ *
+ * @param heat_map
+ *     The heat map to resize.
+ *
+ * @param width
+ *     The new width of the surface covered by the heat map, in pixels.
+ *
+ * @param height
+ *     The new height of the surface covered by the heat map, in pixels.
+ */
+void guac_common_heat_map_resize(guac_common_heat_map* heat_map,
+        int width, int height);
+
+/**
+ * Records an update to all heat map cells which intersect the given
+ * rectangle, updating the moving average framerate of each. Updates having
+ * the same timestamp as the previous update to a cell are considered part of
+ * the same frame and are ignored.
+ *
+ * @param heat_map
+ *     The heat map to update.
+ *
+ * @param rect
+ *     The updated rectangle, in pixels. Portions of this rectangle outside
+ *     the bounds of the heat map are ignored.
+ *
+ * @param time
+ *     The time at which the update occurred.
+ */
+void guac_common_heat_map_touch(guac_common_heat_map* heat_map,
+        const guac_common_rect* rect, guac_timestamp time);
+
+/**
+ * Returns the average framerate of all heat map cells which intersect the
+ * given rectangle.
+ *
+ * @param heat_map
+ *     The heat map to query.
+ *
+ * @param rect
+ *     The rectangle to query, in pixels. Portions of this rectangle outside
+ *     the bounds of the heat map are ignored.
+ *
+ * @return
+ *     The average framerate of the given rectangle, in frames per second, or
+ *     zero if the rectangle does not intersect the heat map.
+ */
+unsigned int guac_common_heat_map_get_framerate(
+        guac_common_heat_map* heat_map, const guac_common_rect* rect);
+
+#endif
+
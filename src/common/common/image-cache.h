@@ -0,0 +1,338 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_IMAGE_CACHE_H
+#define GUAC_COMMON_IMAGE_CACHE_H
+
+#include "config.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+#include <pthread.h>
+#include <stddef.h>
+
+/**
+ * The number of buckets within the hash table of each image cache.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_BUCKETS 1024
+
+/**
+ * The number of recently-seen images which are remembered by each image
+ * cache without being stored. An image is only stored within the cache once
+ * it has been seen at least twice, such that content which never repeats
+ * (video, for example) does not needlessly churn the cache.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_SEEN_SIZE 4096
+
+/**
+ * The maximum number of images which may be stored within an image cache at
+ * any one time, regardless of the total size of those images. Each stored
+ * image occupies one buffer within the remotely-connected client.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_MAX_ENTRIES 1024
+
+/**
+ * The minimum area of any image stored within an image cache, in pixels.
+ * Smaller images are cheap enough to encode that copying them from a buffer
+ * offers little benefit.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_MIN_AREA 256
+
+/**
+ * The fraction of the total size of an image cache that any one image may
+ * occupy. Images which are larger than this fraction of the cache are never
+ * stored.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_MAX_ENTRY_FRACTION 8
+
+/**
+ * The result of looking up an image within a guac_common_image_cache.
+ */
+typedef enum guac_common_image_cache_result {
+
+    /**
+     * The image is not stored within the cache and will not be stored. The
+     * image must be sent normally.
+     */
+    GUAC_COMMON_IMAGE_CACHE_MISS,
+
+    /**
+     * The image was not stored within the cache but has now been stored. The
+     * image must be sent normally, after which the contents of the image must
+     * be copied into the upper-left corner of the buffer provided, resizing
+     * that buffer to fit the image.
+     */
+    GUAC_COMMON_IMAGE_CACHE_STORE,
+
+    /**
+     * The image is stored within the cache, and the upper-left corner of the
+     * buffer provided already contains the image. The image need not be sent
+     * and can instead be copied from that buffer.
+     */
+    GUAC_COMMON_IMAGE_CACHE_HIT
+
+} guac_common_image_cache_result;
+
+typedef struct guac_common_image_cache_entry guac_common_image_cache_entry;
+
+/**
+ * A single image stored within a guac_common_image_cache, along with the
+ * buffer containing that image within the remotely-connected client.
+ */
+struct guac_common_image_cache_entry {
+
+    /**
+     * The hash of the stored image, as produced by guac_hash_surface().
+     */
+    unsigned int hash;
+
+    /**
+     * A copy of the stored image, used to verify that images having the
+     * same hash are actually identical and to send the image to any users
+     * joining the connection.
+     */
+    cairo_surface_t* image;
+
+    /**
+     * The buffer which contains the stored image within the
+     * remotely-connected client. Buffers are retained by entries which have
+     * been evicted and are reused by subsequently-stored images.
+     */
+    guac_layer* buffer;
+
+    /**
+     * The size of the stored image, in bytes.
+     */
+    size_t size;
+
+    /**
+     * The timestamp of the "sync" instruction which preceded the output
+     * storing the image within its buffer, as stored in the
+     * last_sent_timestamp member of the guac_client at the time the image
+     * was stored.
+     */
+    guac_timestamp frame;
+
+    /**
+     * The next entry within the same hash table bucket, or NULL if this is
+     * the last entry in that bucket. For entries which have been evicted,
+     * this is the next evicted entry.
+     */
+    guac_common_image_cache_entry* next_in_bucket;
+
+    /**
+     * The entry which was used immediately more recently than this entry, or
+     * NULL if this is the most recently used entry.
+     */
+    guac_common_image_cache_entry* newer;
+
+    /**
+     * The entry which was used immediately less recently than this entry, or
+     * NULL if this is the least recently used entry.
+     */
+    guac_common_image_cache_entry* older;
+
+};
+
+/**
+ * A least-recently-used cache of images which have recently been sent to the
+ * users of a connection, keyed by the hash of their contents. Each cached
+ * image is retained within an offscreen buffer of the remotely-connected
+ * client, such that repeated updates having identical contents can be sent
+ * as a "copy" from that buffer rather than as a newly-encoded image.
+ */
+typedef struct guac_common_image_cache {
+
+    /**
+     * The client whose buffers contain the cached images.
+     */
+    guac_client* client;
+
+    /**
+     * The maximum total size of all cached images, in bytes.
+     */
+    size_t max_size;
+
+    /**
+     * The current total size of all cached images, in bytes.
+     */
+    size_t size;
+
+    /**
+     * The number of images currently cached.
+     */
+    int length;
+
+    /**
+     * Hash table of all cached images, where each bucket is a linked list of
+     * entries whose hashes map to that bucket.
+     */
+    guac_common_image_cache_entry* buckets[GUAC_COMMON_IMAGE_CACHE_BUCKETS];
+
+    /**
+     * The hashes of recently-seen images which have not necessarily been
+     * stored, each offset by one such that zero denotes an empty slot.
+     */
+    unsigned int seen[GUAC_COMMON_IMAGE_CACHE_SEEN_SIZE];
+
+    /**
+     * The most recently used entry, or NULL if the cache is empty.
+     */
+    guac_common_image_cache_entry* newest;
+
+    /**
+     * The least recently used entry, or NULL if the cache is empty.
+     */
+    guac_common_image_cache_entry* oldest;
+
+    /**
+     * Linked list of evicted entries whose buffers may be reused, linked via
+     * their next_in_bucket members, or NULL if there are no such entries.
+     */
+    guac_common_image_cache_entry* evicted;
+
+    /**
+     * The number of lookups which found the image within the cache.
+     */
+    int hits;
+
+    /**
+     * The number of lookups of cacheable images which did not find the image
+     * within the cache.
+     */
+    int misses;
+
+    /**
+     * The number of images stored within the cache.
+     */
+    int stores;
+
+    /**
+     * The number of images evicted from the cache to make room for others.
+     */
+    int evictions;
+
+    /**
+     * Lock which is acquired when the cache is being accessed or modified.
+     */
+    pthread_mutex_t _lock;
+
+} guac_common_image_cache;
+
+/**
+ * Allocates a new, empty image cache whose images are stored within buffers
+ * of the given client.
+ *
+ * @param client
+ *     The client whose buffers should contain the cached images.
+ *
+ * @param max_size
+ *     The maximum total size of all cached images, in bytes.
+ *
+ * @return
+ *     A newly-allocated image cache, or NULL if the cache could not be
+ *     allocated.
+ */
+guac_common_image_cache* guac_common_image_cache_alloc(guac_client* client,
+        size_t max_size);
+
+/**
+ * Frees the given image cache, disposing of and freeing all buffers used to
+ * store its images. The hit rate of the cache is logged.
+ *
+ * @param cache
+ *     The image cache to free.
+ */
+void guac_common_image_cache_free(guac_common_image_cache* cache);
+
+/**
+ * Looks up the given image within the given cache. If the image is found,
+ * the buffer containing that image is returned and the image need not be
+ * sent. If the image has not been found but has been seen recently, the
+ * image is stored within the cache, and the buffer which must receive the
+ * image after it is sent is returned. The least recently used images are
+ * evicted as necessary to make room.
+ *
+ * @param cache
+ *     The image cache to search.
+ *
+ * @param image
+ *     The image to look up, which must be an image surface of format
+ *     CAIRO_FORMAT_ARGB32 or CAIRO_FORMAT_RGB24.
+ *
+ * @param buffer
+ *     Pointer to a guac_layer pointer which will receive the buffer that
+ *     contains the image (for GUAC_COMMON_IMAGE_CACHE_HIT) or that must
+ *     receive the image (for GUAC_COMMON_IMAGE_CACHE_STORE). This is left
+ *     untouched for GUAC_COMMON_IMAGE_CACHE_MISS.
+ *
+ * @return
+ *     GUAC_COMMON_IMAGE_CACHE_HIT if the image was found within the cache,
+ *     GUAC_COMMON_IMAGE_CACHE_STORE if the image has now been stored, or
+ *     GUAC_COMMON_IMAGE_CACHE_MISS if the image was neither found nor
+ *     stored.
+ */
+guac_common_image_cache_result guac_common_image_cache_lookup(
+        guac_common_image_cache* cache, cairo_surface_t* image,
+        const guac_layer** buffer);
+
+/**
+ * Sends the contents of all buffers of the given image cache to the given
+ * user over the given socket.
+ *
+ * @param cache
+ *     The image cache whose buffers should be sent.
+ *
+ * @param user
+ *     The user receiving the buffers.
+ *
+ * @param socket
+ *     The socket over which the buffers should be sent.
+ */
+void guac_common_image_cache_dup(guac_common_image_cache* cache,
+        guac_user* user, guac_socket* socket);
+
+/**
+ * Resends the contents of only those buffers of the given image cache which
+ * have changed since the given frame to the given user over the given
+ * socket, restoring any cached images that the user did not receive.
+ *
+ * @param cache
+ *     The image cache whose buffers should be resent.
+ *
+ * @param user
+ *     The user receiving the buffers.
+ *
+ * @param socket
+ *     The socket over which the buffers should be sent.
+ *
+ * @param since
+ *     The timestamp of the most recent frame which the user is known to
+ *     have received in its entirety.
+ */
+void guac_common_image_cache_resync(guac_common_image_cache* cache,
+        guac_user* user, guac_socket* socket, guac_timestamp since);
+
+#endif
+
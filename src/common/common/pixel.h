@@ -0,0 +1,174 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_PIXEL_H
+#define GUAC_COMMON_PIXEL_H
+
+#include "config.h"
+#include "rect.h"
+
+/**
+ * Copies the given rectangle of 32-bit ARGB image data over the given
+ * destination image data, either replacing the destination pixels (if the
+ * source is opaque) or blending the source pixels over them using the
+ * Porter-Duff "over" operator, and determines which pixels actually changed.
+ *
+ * @param src
+ *     The source image data, pointing to the upper-left corner of the
+ *     rectangle to copy.
+ *
+ * @param src_stride
+ *     The number of bytes in each row of the source image data.
+ *
+ * @param dst
+ *     The destination image data, pointing to the upper-left corner of the
+ *     rectangle to modify.
+ *
+ * @param dst_stride
+ *     The number of bytes in each row of the destination image data.
+ *
+ * @param width
+ *     The width of the rectangle, in pixels.
+ *
+ * @param height
+ *     The height of the rectangle, in pixels.
+ *
+ * @param opaque
+ *     Non-zero if the source image data is opaque (its alpha channel should
+ *     be ignored), zero otherwise.
+ *
+ * @param changed
+ *     The rectangle which will receive the bounds of all changed pixels,
+ *     relative to the upper-left corner of the rectangle copied. If no
+ *     pixels changed, the width and height of this rectangle will be zero.
+ */
+typedef void guac_common_pixel_put_function(const unsigned char* src,
+        int src_stride, unsigned char* dst, int dst_stride, int width,
+        int height, int opaque, guac_common_rect* changed);
+
+/**
+ * Returns whether the given rectangle of 32-bit ARGB image data contains only
+ * fully opaque pixels.
+ *
+ * @param buffer
+ *     The image data to check, pointing to the upper-left corner of the
+ *     rectangle.
+ *
+ * @param stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param width
+ *     The width of the rectangle, in pixels.
+ *
+ * @param height
+ *     The height of the rectangle, in pixels.
+ *
+ * @return
+ *     Non-zero if the rectangle contains only fully opaque pixels, zero
+ *     otherwise.
+ */
+typedef int guac_common_pixel_is_opaque_function(const unsigned char* buffer,
+        int stride, int width, int height);
+
+/**
+ * Guesses whether the given rectangle of 32-bit ARGB image data would be
+ * better compressed as PNG or using a lossy format like JPEG, based on how
+ * often horizontally-adjacent pixels are identical. Alpha is ignored.
+ *
+ * @param buffer
+ *     The image data to check, pointing to the upper-left corner of the
+ *     rectangle.
+ *
+ * @param stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param width
+ *     The width of the rectangle, in pixels.
+ *
+ * @param height
+ *     The height of the rectangle, in pixels.
+ *
+ * @return
+ *     Positive values if PNG compression is likely to perform better than
+ *     lossy alternatives, or negative values if PNG is likely to perform
+ *     worse.
+ */
+typedef int guac_common_pixel_png_optimality_function(
+        const unsigned char* buffer, int stride, int width, int height);
+
+/**
+ * A set of implementations of the per-pixel operations performed on the
+ * image data of surfaces, all of which produce identical results regardless
+ * of the instructions used.
+ */
+typedef struct guac_common_pixel_kernels {
+
+    /**
+     * A human-readable name for this set of implementations, such as the
+     * instruction set used.
+     */
+    const char* name;
+
+    /**
+     * Returns whether the current CPU is able to run this set of
+     * implementations.
+     *
+     * @return
+     *     Non-zero if this set of implementations can be used, zero
+     *     otherwise.
+     */
+    int (*supported)(void);
+
+    /**
+     * Copies or blends image data, determining which pixels changed.
+     */
+    guac_common_pixel_put_function* put;
+
+    /**
+     * Tests whether image data is fully opaque.
+     */
+    guac_common_pixel_is_opaque_function* is_opaque;
+
+    /**
+     * Estimates how well image data would compress as PNG.
+     */
+    guac_common_pixel_png_optimality_function* png_optimality;
+
+} guac_common_pixel_kernels;
+
+/**
+ * All sets of pixel kernel implementations built into this copy of
+ * libguac_common, in order of increasing preference and terminated by NULL.
+ * The first set of implementations is always the portable, scalar set
+ * against which all others must match exactly. Implementations within this
+ * list may not be supported by the current CPU.
+ */
+extern const guac_common_pixel_kernels* const GUAC_COMMON_PIXEL_KERNELS[];
+
+/**
+ * Returns the most preferable set of pixel kernel implementations which is
+ * supported by the current CPU. The choice is made once, upon first call.
+ *
+ * @return
+ *     The most preferable supported set of pixel kernel implementations.
+ */
+const guac_common_pixel_kernels* guac_common_pixel_kernels_select();
+
+#endif
+
@@ -0,0 +1,242 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_QUALITY_CONTROLLER_H
+#define GUAC_COMMON_QUALITY_CONTROLLER_H
+
+#include "config.h"
+
+#include <guacamole/client.h>
+#include <guacamole/timestamp.h>
+
+#include <pthread.h>
+
+/**
+ * The highest quality which will be used for lossy encoding. This is the
+ * quality used while no congestion has been observed.
+ */
+#define GUAC_COMMON_QUALITY_MAX 90
+
+/**
+ * The lowest quality which will be used for lossy encoding, regardless of how
+ * congested the connection becomes.
+ */
+#define GUAC_COMMON_QUALITY_MIN 30
+
+/**
+ * The minimum amount of time between adjustments of the encoding parameters,
+ * in milliseconds. Measurements of users are only as fresh as their most
+ * recent "sync" instructions, so adjusting more often than this would react
+ * repeatedly to the same congestion.
+ */
+#define GUAC_COMMON_QUALITY_INTERVAL 250
+
+/**
+ * The delay, in milliseconds, above which a connection is considered
+ * congested. Each adjustment made while congested reduces quality
+ * multiplicatively.
+ */
+#define GUAC_COMMON_QUALITY_CONGESTED_DELAY 100
+
+/**
+ * The delay, in milliseconds, below which a connection is considered clear.
+ * Each adjustment made while clear increases quality additively.
+ */
+#define GUAC_COMMON_QUALITY_CLEAR_DELAY 25
+
+/**
+ * The amount that quality is increased by each adjustment made while the
+ * connection is clear.
+ */
+#define GUAC_COMMON_QUALITY_INCREASE 2
+
+/**
+ * The minimum duration of each frame, in milliseconds, when quality has been
+ * reduced to GUAC_COMMON_QUALITY_MIN. Frames are lengthened proportionally as
+ * quality is reduced, such that updates are combined into fewer, larger
+ * frames when bandwidth is scarce.
+ */
+#define GUAC_COMMON_QUALITY_MAX_FRAME_DURATION 200
+
+/**
+ * The framerate which, if exceeded, indicates that a lossy format is
+ * preferred for an area of a surface, while the connection is not congested.
+ * This threshold is lowered as quality is reduced.
+ */
+#define GUAC_COMMON_QUALITY_LOSSY_FRAMERATE 3
+
+/**
+ * The WebP compression method used while the connection is not congested.
+ * Slower methods which produce smaller images are used as quality is
+ * reduced, trading encoding time for bandwidth.
+ */
+#define GUAC_COMMON_QUALITY_WEBP_METHOD 2
+
+/**
+ * The zlib compression level used for PNG images while the connection is not
+ * congested. Low levels encode considerably faster, particularly for images
+ * with many colors, while costing relatively little in size for images
+ * consisting of few colors, such as text.
+ */
+#define GUAC_COMMON_QUALITY_PNG_COMPRESSION 3
+
+/**
+ * The zlib compression level used for PNG images when quality has been
+ * reduced to GUAC_COMMON_QUALITY_MIN. Higher levels spend substantially more
+ * time for little further reduction in size.
+ */
+#define GUAC_COMMON_QUALITY_MAX_PNG_COMPRESSION 6
+
+/**
+ * The encoding parameters chosen by a guac_common_quality_controller.
+ */
+typedef struct guac_common_quality_params {
+
+    /**
+     * The quality to use for lossy encoding, between GUAC_COMMON_QUALITY_MIN
+     * and GUAC_COMMON_QUALITY_MAX inclusive.
+     */
+    int quality;
+
+    /**
+     * The framerate which, if exceeded, indicates that a lossy format should
+     * be used for an area of a surface rather than PNG.
+     */
+    int lossy_framerate;
+
+    /**
+     * The minimum duration of each frame, in milliseconds, or zero if frames
+     * need not be lengthened.
+     */
+    int frame_duration;
+
+    /**
+     * The WebP compression method to use, between 0 (fastest, largest output)
+     * and 6 (slowest, smallest output) inclusive.
+     */
+    int webp_method;
+
+    /**
+     * The zlib compression level to use for PNG images, between 0 (no
+     * compression) and 9 (smallest output, slowest) inclusive.
+     */
+    int png_compression;
+
+} guac_common_quality_params;
+
+/**
+ * Controller which adjusts the parameters used to encode graphical updates
+ * in response to congestion measured from the users of a guac_client. The
+ * amount of congestion is measured as the delay that data currently
+ * experiences before reaching the slowest user, derived from the depth of
+ * that user's send queue relative to their throughput, the increase of their
+ * sync round-trip time above its baseline, and their processing lag. Quality
+ * is adjusted using additive increase and multiplicative decrease, and all
+ * other parameters are derived from the resulting quality.
+ */
+typedef struct guac_common_quality_controller {
+
+    /**
+     * The client whose users are measured.
+     */
+    guac_client* client;
+
+    /**
+     * The current encoding parameters.
+     */
+    guac_common_quality_params params;
+
+    /**
+     * The time of the most recent adjustment, in milliseconds, or zero if no
+     * adjustment has yet been made.
+     */
+    guac_timestamp last_update;
+
+    /**
+     * Lock which guards access to the current encoding parameters.
+     */
+    pthread_mutex_t _lock;
+
+} guac_common_quality_controller;
+
+/**
+ * Allocates a new quality controller which measures the users of the given
+ * client. Until congestion is measured, the parameters chosen are those of
+ * an uncongested connection.
+ *
+ * @param client
+ *     The client whose users should be measured.
+ *
+ * @return
+ *     A newly-allocated quality controller, or NULL if allocation fails.
+ */
+guac_common_quality_controller* guac_common_quality_controller_alloc(
+        guac_client* client);
+
+/**
+ * Frees the given quality controller.
+ *
+ * @param controller
+ *     The quality controller to free.
+ */
+void guac_common_quality_controller_free(
+        guac_common_quality_controller* controller);
+
+/**
+ * Measures the congestion currently experienced by the users of the client
+ * associated with the given controller, adjusting the encoding parameters
+ * accordingly. Measurements are taken at most once every
+ * GUAC_COMMON_QUALITY_INTERVAL milliseconds, and calls made more frequently
+ * have no effect. This function is intended to be called once per frame.
+ *
+ * @param controller
+ *     The quality controller to update.
+ */
+void guac_common_quality_controller_update(
+        guac_common_quality_controller* controller);
+
+/**
+ * Adjusts the encoding parameters of the given controller in response to
+ * the given measured delay, regardless of when the parameters were last
+ * adjusted. Changes to the parameters are logged at the debug level.
+ *
+ * @param controller
+ *     The quality controller to adjust.
+ *
+ * @param delay
+ *     The delay currently experienced by data before it reaches the slowest
+ *     user, in milliseconds.
+ */
+void guac_common_quality_controller_adjust(
+        guac_common_quality_controller* controller, int delay);
+
+/**
+ * Returns the current encoding parameters of the given controller.
+ *
+ * @param controller
+ *     The quality controller to query.
+ *
+ * @param params
+ *     The structure to populate with the current encoding parameters.
+ */
+void guac_common_quality_controller_get(
+        guac_common_quality_controller* controller,
+        guac_common_quality_params* params);
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_REGION_H
+#define GUAC_COMMON_REGION_H
+
+#include "config.h"
+#include "rect.h"
+
+/**
+ * The number of rectangles for which space is initially allocated within
+ * each region. Regions grow as needed beyond this size.
+ */
+#define GUAC_COMMON_REGION_INITIAL_SIZE 64
+
+/**
+ * The number of most recently combined rectangles that each rectangle is
+ * considered for combination with while coalescing a region. Rectangles are
+ * visited in top-to-bottom, left-to-right order, so nearby rectangles are
+ * generally within this window of each other.
+ */
+#define GUAC_COMMON_REGION_COMBINE_WINDOW 16
+
+/**
+ * The maximum number of passes made over a region while coalescing. Each
+ * pass may combine rectangles which grew during the previous pass; further
+ * passes are skipped if a pass makes no changes.
+ */
+#define GUAC_COMMON_REGION_MAX_PASSES 4
+
+/**
+ * Callback which decides whether two rectangles within a region should be
+ * combined into their bounding rectangle.
+ *
+ * @param current
+ *     The rectangle which would be extended to contain the other rectangle.
+ *
+ * @param rect
+ *     The rectangle which would be combined into the current rectangle.
+ *
+ * @param data
+ *     The arbitrary data provided to guac_common_region_coalesce().
+ *
+ * @return
+ *     Non-zero if the rectangles should be combined, zero otherwise.
+ */
+typedef int guac_common_region_combine_callback(
+        const guac_common_rect* current, const guac_common_rect* rect,
+        void* data);
+
+/**
+ * An arbitrary number of possibly-overlapping rectangles which may be
+ * coalesced into fewer, larger rectangles.
+ */
+typedef struct guac_common_region {
+
+    /**
+     * All rectangles within this region, in no particular order unless the
+     * region has just been coalesced.
+     */
+    guac_common_rect* rects;
+
+    /**
+     * The number of rectangles within this region.
+     */
+    int count;
+
+    /**
+     * The number of rectangles for which space has been allocated.
+     */
+    int size;
+
+} guac_common_region;
+
+/**
+ * Allocates a new, empty region.
+ *
+ * @return
+ *     A newly-allocated region, which must eventually be freed with
+ *     guac_common_region_free(), or NULL if memory could not be allocated.
+ */
+guac_common_region* guac_common_region_alloc();
+
+/**
+ * Frees the given region and all associated resources.
+ *
+ * @param region
+ *     The region to free.
+ */
+void guac_common_region_free(guac_common_region* region);
+
+/**
+ * Adds the given rectangle to the given region, growing the region as
+ * necessary. Empty rectangles are ignored. If the region cannot grow, it is
+ * replaced by a single rectangle covering both the region and the given
+ * rectangle.
+ *
+ * @param region
+ *     The region to add the rectangle to.
+ *
+ * @param rect
+ *     The rectangle to add.
+ */
+void guac_common_region_add(guac_common_region* region,
+        const guac_common_rect* rect);
+
+/**
+ * Removes all rectangles from the given region. Space allocated for those
+ * rectangles is retained for future use.
+ *
+ * @param region
+ *     The region to clear.
+ */
+void guac_common_region_clear(guac_common_region* region);
+
+/**
+ * Clips all rectangles within the given region to the given bounds, removing
+ * any rectangles which fall entirely outside those bounds.
+ *
+ * @param region
+ *     The region to clip.
+ *
+ * @param bounds
+ *     The rectangle that all rectangles within the region must be within.
+ */
+void guac_common_region_clip(guac_common_region* region,
+        const guac_common_rect* bounds);
+
+/**
+ * Reduces the number of rectangles within the given region by combining
+ * rectangles into their bounding rectangles wherever the given callback
+ * agrees. Rectangles lying entirely within others are always combined. The
+ * rectangles are sorted from top to bottom and left to right, and each is
+ * considered for combination only with the most recent
+ * GUAC_COMMON_REGION_COMBINE_WINDOW rectangles, preferring whichever would
+ * grow the least, such that coalescing requires O(n log n) time. Upon
+ * return, the rectangles of the region are ordered roughly from top to
+ * bottom.
+ *
+ * @param region
+ *     The region to coalesce.
+ *
+ * @param callback
+ *     The callback to invoke to decide whether two rectangles should be
+ *     combined.
+ *
+ * @param data
+ *     Arbitrary data to pass to the given callback.
+ */
+void guac_common_region_coalesce(guac_common_region* region,
+        guac_common_region_combine_callback* callback, void* data);
+
+#endif
+
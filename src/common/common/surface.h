@@ -21,7 +21,12 @@
 #define __GUAC_COMMON_SURFACE_H
 
 #include "config.h"
+#include "encode-pool.h"
+#include "heat-map.h"
+#include "image-cache.h"
+#include "quality-controller.h"
 #include "rect.h"
+#include "region.h"
 
 #include <cairo/cairo.h>
 #include <guacamole/client.h>
@@ -32,78 +37,54 @@
 #include <pthread.h>
 
 /**
- * The maximum number of updates to allow within the bitmap queue.
+ * The number of frames for which the region of each surface modified within
+ * that frame is retained. Users that have missed more frames than this are
+ * resynchronized with the entire contents of the surface.
  */
-#define GUAC_COMMON_SURFACE_QUEUE_SIZE 256
+#define GUAC_COMMON_SURFACE_DAMAGE_HISTORY_SIZE 64
 
 /**
- * Heat map cell size in pixels. Each side of each heat map cell will consist
- * of this many pixels.
+ * The region of a surface modified by the output sent within a single frame.
  */
-#define GUAC_COMMON_SURFACE_HEAT_CELL_SIZE 64
-
-/**
- * The width or height of the heat map (in cells) given the width or height of
- * the image (in pixels).
- */
-#define GUAC_COMMON_SURFACE_HEAT_DIMENSION(x) (       \
-        (x + GUAC_COMMON_SURFACE_HEAT_CELL_SIZE - 1)  \
-            / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE      \
-)
-
-/**
- * The number of entries to collect within each heat map cell. Collected
- * history entries are used to determine the framerate of the region associated
- * with that cell.
- */
-#define GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE 5
-
-/**
- * Representation of a cell in the refresh heat map. This cell is used to keep
- * track of how often an area on a surface is refreshed.
- */
-typedef struct guac_common_surface_heat_cell {
+typedef struct guac_common_surface_damage {
 
     /**
-     * Timestamps of each of the last N updates covering the location
-     * associated with this heat map cell. This is used to calculate the
-     * framerate. This array is structured as a ring buffer containing history
-     * entries in chronologically-ascending order, starting at the entry
-     * pointed to by oldest_entry and proceeding through all other entries,
-     * wrapping around if the end of the array is reached.
+     * The timestamp of the "sync" instruction which preceded the output
+     * modifying this region, as stored in the last_sent_timestamp member of
+     * the guac_client at the time that output was sent.
      */
-    guac_timestamp history[GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE];
+    guac_timestamp frame;
 
     /**
-     * Index of the oldest entry within the history.
-     */
-    int oldest_entry;
-
-} guac_common_surface_heat_cell;
-
-/**
- * Representation of a bitmap update, having a rectangle of image data (stored
- * elsewhere) and a flushed/not-flushed state.
- */
-typedef struct guac_common_surface_bitmap_rect {
-
-    /**
-     * Whether this rectangle has been flushed.
-     */
-    int flushed;
-
-    /**
-     * The rectangle containing the bitmap update.
+     * The smallest rectangle containing all changes sent within the frame.
      */
     guac_common_rect rect;
 
-} guac_common_surface_bitmap_rect;
+} guac_common_surface_damage;
 
 /**
  * Surface which backs a Guacamole buffer or layer, automatically
  * combining updates when possible.
  */
-typedef struct guac_common_surface {
+typedef struct guac_common_surface guac_common_surface;
+
+/**
+ * Handler which is invoked whenever a surface which had no changes awaiting
+ * a call to guac_common_surface_flush() first receives such a change. The
+ * handler is invoked while the surface is locked, and thus must not call any
+ * guac_common_surface function on that surface.
+ *
+ * @param surface
+ *     The surface that now has changes awaiting a flush.
+ *
+ * @param data
+ *     The arbitrary data provided when the handler was assigned to the
+ *     surface via guac_common_surface_set_pending_handler().
+ */
+typedef void guac_common_surface_pending_handler(
+        guac_common_surface* surface, void* data);
+
+struct guac_common_surface {
 
     /**
      * The layer this surface will draw to.
@@ -133,6 +114,51 @@ typedef struct guac_common_surface {
      */
     int lossless;
 
+    /**
+     * The pool of threads which should concurrently encode the images sent
+     * when this surface is flushed, or NULL if images should be encoded one
+     * at a time by the thread flushing the surface.
+     */
+    guac_common_encode_pool* encode_pool;
+
+    /**
+     * The cache of images previously sent to the client, which may be used
+     * to send repeated updates as copies from client-side buffers, or NULL
+     * if every update should be sent as a newly-encoded image.
+     */
+    guac_common_image_cache* image_cache;
+
+    /**
+     * The controller which chooses the parameters used to encode the images
+     * sent when this surface is flushed, or NULL if parameters should be
+     * chosen based on processing lag alone.
+     */
+    guac_common_quality_controller* quality_controller;
+
+    /**
+     * The encoding parameters in effect for the current flush of this
+     * surface, as chosen at the start of that flush.
+     */
+    guac_common_quality_params quality_params;
+
+    /**
+     * Non-zero if this surface has changes which have not yet been sent by
+     * a call to guac_common_surface_flush(), such as updated image data,
+     * location or opacity, zero otherwise.
+     */
+    int flush_pending;
+
+    /**
+     * The handler to invoke whenever flush_pending changes from zero to
+     * non-zero, or NULL if no handler should be invoked.
+     */
+    guac_common_surface_pending_handler* pending_handler;
+
+    /**
+     * The arbitrary data to provide to pending_handler.
+     */
+    void* pending_data;
+
     /**
      * The X coordinate of the upper-left corner of this layer, in pixels,
      * relative to its parent layer. This is only applicable to visible
@@ -226,20 +252,46 @@ typedef struct guac_common_surface {
     guac_common_rect clip_rect;
 
     /**
-     * The number of updates in the bitmap queue.
+     * All deferred bitmap updates, to be coalesced and sent as images when
+     * the surface is next flushed.
      */
-    int bitmap_queue_length;
+    guac_common_region* bitmap_region;
 
     /**
-     * All queued bitmap updates.
+     * A heat map keeping track of the refresh frequency of
+     * the areas of the screen. The heat map is internally synchronized, and
+     * may be updated without holding _lock.
      */
-    guac_common_surface_bitmap_rect bitmap_queue[GUAC_COMMON_SURFACE_QUEUE_SIZE];
+    guac_common_heat_map* heat_map;
 
     /**
-     * A heat map keeping track of the refresh frequency of
-     * the areas of the screen.
+     * The regions of this surface modified within each of the most recent
+     * frames, used to resynchronize users that have missed those frames.
+     * This array is structured as a ring buffer containing entries in
+     * chronologically-ascending order, starting at the entry pointed to by
+     * oldest_damage and proceeding through the following damage_length
+     * entries, wrapping around if the end of the array is reached.
+     */
+    guac_common_surface_damage damage[GUAC_COMMON_SURFACE_DAMAGE_HISTORY_SIZE];
+
+    /**
+     * Index of the oldest entry within the damage history.
+     */
+    int oldest_damage;
+
+    /**
+     * The number of entries within the damage history.
+     */
+    int damage_length;
+
+    /**
+     * The timestamp of the most recent frame for which damage is no longer
+     * tracked, either because this surface did not yet exist or because the
+     * damage for that frame has been dropped from the damage history. Users
+     * that have not received all frames following this frame must be sent
+     * the entire surface.
      */
-    guac_common_surface_heat_cell* heat_map;
+    guac_timestamp damage_base;
 
     /**
      * Mutex which is locked internally when access to the surface must be
@@ -248,7 +300,7 @@ typedef struct guac_common_surface {
      */
     pthread_mutex_t _lock;
 
-} guac_common_surface;
+};
 
 /**
  * Allocates a new guac_common_surface, assigning it to the given layer.
@@ -499,6 +551,65 @@ void guac_common_surface_flush(guac_common_surface* surface);
 void guac_common_surface_dup(guac_common_surface* surface, guac_user* user,
         guac_socket* socket);
 
+/**
+ * Acquires the lock of the given surface, preventing the surface from being
+ * changed or flushed by any other thread until the lock is released with
+ * guac_common_surface_unlock().
+ *
+ * @param surface
+ *     The surface to lock.
+ */
+void guac_common_surface_lock(guac_common_surface* surface);
+
+/**
+ * Acquires the lock of the given surface only if doing so does not require
+ * waiting for another thread. If acquired, the lock must be released with
+ * guac_common_surface_unlock().
+ *
+ * @param surface
+ *     The surface to lock.
+ *
+ * @return
+ *     Zero if the lock has been acquired, non-zero if the surface is
+ *     currently locked by another thread.
+ */
+int guac_common_surface_trylock(guac_common_surface* surface);
+
+/**
+ * Releases the lock of the given surface, as acquired by
+ * guac_common_surface_lock() or guac_common_surface_trylock().
+ *
+ * @param surface
+ *     The surface to unlock.
+ */
+void guac_common_surface_unlock(guac_common_surface* surface);
+
+/**
+ * Resynchronizes the given user with the current contents of the surface,
+ * where the user is known to have received all output up to and including
+ * the frame ending with the given timestamp, but may have missed any output
+ * following that frame. Only the union of all regions modified since that
+ * frame is sent, unless the damage history of the surface no longer covers
+ * that frame, in which case the entire surface is sent. Pending changes are
+ * not flushed. The surface must already be locked with
+ * guac_common_surface_lock() or guac_common_surface_trylock().
+ *
+ * @param surface
+ *     The surface to resynchronize.
+ *
+ * @param user
+ *     The user receiving the surface.
+ *
+ * @param socket
+ *     The socket over which the surface contents should be sent.
+ *
+ * @param since
+ *     The timestamp of the most recent frame which the user is known to
+ *     have received in its entirety.
+ */
+void guac_common_surface_resync(guac_common_surface* surface,
+        guac_user* user, guac_socket* socket, guac_timestamp since);
+
 /**
  * Declares that the given surface should receive touch events. By default,
  * surfaces are assumed to not expect touch events. This value is advisory, and
@@ -535,5 +646,73 @@ void guac_common_surface_set_multitouch(guac_common_surface* surface,
 void guac_common_surface_set_lossless(guac_common_surface* surface,
         int lossless);
 
+/**
+ * Sets the pool of threads which should concurrently encode the images sent
+ * when the given surface is flushed. Images are still sent in the same order
+ * as they would be if encoded one at a time. By default, newly-created
+ * surfaces encode all images within the thread flushing the surface.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param pool
+ *     The encode pool to use for all future flushes of the given surface, or
+ *     NULL to encode all images within the thread flushing the surface.
+ */
+void guac_common_surface_set_encode_pool(guac_common_surface* surface,
+        guac_common_encode_pool* pool);
+
+/**
+ * Sets the image cache which should be searched for identical contents
+ * whenever an update to the given surface is flushed. Updates found within
+ * the cache are sent as copies from the client-side buffers of that cache
+ * rather than as newly-encoded images. By default, newly-created surfaces do
+ * not use an image cache.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param cache
+ *     The image cache to use for all future flushes of the given surface, or
+ *     NULL to send all updates as newly-encoded images.
+ */
+void guac_common_surface_set_image_cache(guac_common_surface* surface,
+        guac_common_image_cache* cache);
+
+/**
+ * Sets the controller which should choose the quality, lossy framerate
+ * threshold, and WebP compression method used to encode the images sent
+ * whenever the given surface is flushed. By default, newly-created surfaces
+ * choose lossy quality based on processing lag alone.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param controller
+ *     The quality controller to use for all future flushes of the given
+ *     surface, or NULL to choose quality based on processing lag alone.
+ */
+void guac_common_surface_set_quality_controller(guac_common_surface* surface,
+        guac_common_quality_controller* controller);
+
+/**
+ * Sets the handler which should be invoked whenever the given surface, having
+ * no changes awaiting a flush, first receives such a change. This allows the
+ * owner of many surfaces to track which surfaces actually need to be flushed.
+ * If the surface already has changes awaiting a flush, the handler is
+ * invoked immediately.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param handler
+ *     The handler to invoke, or NULL if no handler should be invoked.
+ *
+ * @param data
+ *     Arbitrary data to provide to the handler each time it is invoked.
+ */
+void guac_common_surface_set_pending_handler(guac_common_surface* surface,
+        guac_common_surface_pending_handler* handler, void* data);
+
 #endif
 
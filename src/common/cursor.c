@@ -32,6 +32,7 @@
 #include <guacamole/user.h>
 
 #include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -74,6 +75,8 @@ guac_common_cursor* guac_common_cursor_alloc(guac_client* client) {
     cursor->x = 0;
     cursor->y = 0;
 
+    pthread_mutex_init(&(cursor->_lock), NULL);
+
     return cursor;
 
 }
@@ -95,6 +98,7 @@ void guac_common_cursor_free(guac_common_cursor* cursor) {
     /* Return buffer to pool */
     guac_client_free_buffer(client, buffer);
 
+    pthread_mutex_destroy(&(cursor->_lock));
     free(cursor);
 
 }
@@ -102,6 +106,23 @@ void guac_common_cursor_free(guac_common_cursor* cursor) {
 void guac_common_cursor_dup(guac_common_cursor* cursor, guac_user* user,
         guac_socket* socket) {
 
+    pthread_mutex_lock(&(cursor->_lock));
+    guac_common_cursor_resync(cursor, user, socket);
+    pthread_mutex_unlock(&(cursor->_lock));
+
+}
+
+void guac_common_cursor_lock(guac_common_cursor* cursor) {
+    pthread_mutex_lock(&(cursor->_lock));
+}
+
+void guac_common_cursor_unlock(guac_common_cursor* cursor) {
+    pthread_mutex_unlock(&(cursor->_lock));
+}
+
+void guac_common_cursor_resync(guac_common_cursor* cursor, guac_user* user,
+        guac_socket* socket) {
+
     /* Synchronize location */
     guac_protocol_send_mouse(socket, cursor->x, cursor->y, cursor->button_mask,
             cursor->timestamp);
@@ -212,6 +233,8 @@ static void guac_common_cursor_resize(guac_common_cursor* cursor,
 void guac_common_cursor_set_argb(guac_common_cursor* cursor, int hx, int hy,
     unsigned const char* data, int width, int height, int stride) {
 
+    pthread_mutex_lock(&(cursor->_lock));
+
     /* Copy image data */
     guac_common_cursor_resize(cursor, width, height, stride);
     memcpy(cursor->image_buffer, data, height * stride);
@@ -242,6 +265,8 @@ void guac_common_cursor_set_argb(guac_common_cursor* cursor, int hx, int hy,
 
     guac_socket_flush(cursor->client->socket);
 
+    pthread_mutex_unlock(&(cursor->_lock));
+
 }
 
 void guac_common_cursor_set_surface(guac_common_cursor* cursor, int hx, int hy,
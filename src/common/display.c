@@ -19,14 +19,95 @@
 
 #include "common/cursor.h"
 #include "common/display.h"
+#include "common/encode-pool.h"
+#include "common/image-cache.h"
 #include "common/surface.h"
 
 #include <guacamole/client.h>
+#include <guacamole/protocol.h>
 #include <guacamole/socket.h>
 
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The initial size of the buffer which receives the output of a resync, in
+ * bytes. Buffers grow automatically as needed.
+ */
+#define GUAC_COMMON_DISPLAY_RESYNC_OUTPUT_SIZE 65536
+
+/**
+ * The output of a resync, buffered in memory such that it can be produced
+ * while the display is locked, yet written to the user being resynchronized
+ * only once the display has been unlocked.
+ */
+typedef struct guac_common_display_resync_output {
+
+    /**
+     * The buffered output.
+     */
+    char* data;
+
+    /**
+     * The number of bytes of buffered output.
+     */
+    size_t length;
+
+    /**
+     * The size of the buffer, in bytes.
+     */
+    size_t size;
+
+} guac_common_display_resync_output;
+
+/**
+ * Socket write handler which appends all data written to the
+ * guac_common_display_resync_output associated with the socket.
+ *
+ * @param socket
+ *     The socket being written to.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param count
+ *     The number of bytes to write.
+ *
+ * @return
+ *     The number of bytes written, or -1 if the output buffer cannot be
+ *     expanded.
+ */
+static ssize_t guac_common_display_resync_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_common_display_resync_output* output =
+        (guac_common_display_resync_output*) socket->data;
+
+    /* Expand output buffer as necessary */
+    if (output->length + count > output->size) {
+
+        size_t size = output->size;
+        while (output->length + count > size)
+            size *= 2;
+
+        char* data = realloc(output->data, size);
+        if (data == NULL)
+            return -1;
+
+        output->data = data;
+        output->size = size;
+
+    }
+
+    memcpy(output->data + output->length, buf, count);
+    output->length += count;
+    return count;
+
+}
 
 /**
  * Synchronizes all surfaces within the given linked list to the given socket.
@@ -56,6 +137,319 @@ static void guac_common_display_dup_layers(guac_common_display_layer* layers,
 
 }
 
+/**
+ * Resynchronizes all surfaces within the given linked list with the given
+ * socket. The surfaces must already be locked. If the provided pointer to the
+ * linked list is NULL, this function has no effect.
+ *
+ * @param layers
+ *     The head element of the linked list of layers to resynchronize, which
+ *     may be NULL if the list is currently empty.
+ *
+ * @param user
+ *     The user receiving the layers.
+ *
+ * @param socket
+ *     The socket over which each layer should be sent.
+ *
+ * @param since
+ *     The timestamp of the most recent frame which the user is known to
+ *     have received in its entirety.
+ */
+static void guac_common_display_resync_layers(guac_common_display_layer* layers,
+        guac_user* user, guac_socket* socket, guac_timestamp since) {
+
+    guac_common_display_layer* current = layers;
+
+    /* Resynchronize all surfaces in given list */
+    while (current != NULL) {
+        guac_common_surface_resync(current->surface, user, socket, since);
+        current = current->next;
+    }
+
+}
+
+/**
+ * Releases the locks of the surfaces of all layers within the given linked
+ * list, up to but excluding the given layer.
+ *
+ * @param layers
+ *     The head element of the linked list of layers to unlock, which may be
+ *     NULL if the list is currently empty.
+ *
+ * @param end
+ *     The first layer which should not be unlocked, or NULL to unlock all
+ *     layers within the list.
+ */
+static void guac_common_display_unlock_layers(guac_common_display_layer* layers,
+        guac_common_display_layer* end) {
+
+    for (guac_common_display_layer* current = layers; current != end;
+            current = current->next)
+        guac_common_surface_unlock(current->surface);
+
+}
+
+/**
+ * Acquires the locks of the surfaces of all layers within the given linked
+ * list without waiting for other threads. If any surface is already locked,
+ * no locks are acquired.
+ *
+ * @param layers
+ *     The head element of the linked list of layers to lock, which may be
+ *     NULL if the list is currently empty.
+ *
+ * @return
+ *     NULL if all surfaces have been locked, or the surface which could not
+ *     be locked otherwise.
+ */
+static guac_common_surface* guac_common_display_trylock_layers(
+        guac_common_display_layer* layers) {
+
+    for (guac_common_display_layer* current = layers; current != NULL;
+            current = current->next) {
+
+        if (guac_common_surface_trylock(current->surface)) {
+            guac_common_display_unlock_layers(layers, current);
+            return current->surface;
+        }
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Acquires the locks of all surfaces of the given display, such that no
+ * surface can be changed or flushed until those locks are released with
+ * guac_common_display_unlock_surfaces(). As operations involving two surfaces
+ * may lock those surfaces in either order, surfaces are locked without
+ * waiting, waiting only after releasing all locks acquired thus far. The
+ * display must be locked.
+ *
+ * @param display
+ *     The display whose surfaces should be locked.
+ */
+static void guac_common_display_lock_surfaces(guac_common_display* display) {
+
+    for (;;) {
+
+        guac_common_surface* busy;
+
+        if (guac_common_surface_trylock(display->default_surface))
+            busy = display->default_surface;
+
+        else if ((busy = guac_common_display_trylock_layers(display->layers)))
+            guac_common_surface_unlock(display->default_surface);
+
+        else if ((busy = guac_common_display_trylock_layers(display->buffers))) {
+            guac_common_display_unlock_layers(display->layers, NULL);
+            guac_common_surface_unlock(display->default_surface);
+        }
+
+        /* All surfaces are now locked */
+        else
+            return;
+
+        /* Wait for the surface to be released before retrying */
+        guac_common_surface_lock(busy);
+        guac_common_surface_unlock(busy);
+
+    }
+
+}
+
+/**
+ * Releases the locks of all surfaces of the given display, as acquired by
+ * guac_common_display_lock_surfaces().
+ *
+ * @param display
+ *     The display whose surfaces should be unlocked.
+ */
+static void guac_common_display_unlock_surfaces(
+        guac_common_display* display) {
+    guac_common_display_unlock_layers(display->buffers, NULL);
+    guac_common_display_unlock_layers(display->layers, NULL);
+    guac_common_surface_unlock(display->default_surface);
+}
+
+/**
+ * Records that the layer or buffer having the given index has been freed
+ * within the current frame.
+ *
+ * @param display
+ *     The display that the layer or buffer was freed from.
+ *
+ * @param index
+ *     The index of the freed layer or buffer.
+ */
+static void guac_common_display_add_disposed(guac_common_display* display,
+        int index) {
+
+    guac_common_display_disposed* disposed =
+        malloc(sizeof(guac_common_display_disposed));
+
+    disposed->index = index;
+    disposed->frame = display->client->last_sent_timestamp;
+
+    /* Insert record as the new head */
+    disposed->next = display->disposed;
+    display->disposed = disposed;
+
+}
+
+/**
+ * Removes any record of the layer or buffer having the given index having
+ * been freed. This must be invoked whenever a layer or buffer is allocated,
+ * as the newly-allocated layer or buffer may reuse the index of a layer or
+ * buffer that was previously freed.
+ *
+ * @param display
+ *     The display that the layer or buffer is being allocated from.
+ *
+ * @param index
+ *     The index of the newly-allocated layer or buffer.
+ */
+static void guac_common_display_remove_disposed(guac_common_display* display,
+        int index) {
+
+    guac_common_display_disposed** current = &display->disposed;
+    while (*current != NULL) {
+
+        /* Unlink and free any matching record */
+        if ((*current)->index == index) {
+            guac_common_display_disposed* disposed = *current;
+            *current = disposed->next;
+            free(disposed);
+            return;
+        }
+
+        current = &((*current)->next);
+
+    }
+
+}
+
+/**
+ * Surface pending handler which adds the display layer associated with the
+ * flushed surface to the set of layers which must be visited by the next
+ * flush of the display.
+ *
+ * @param surface
+ *     The surface which now has changes awaiting a flush.
+ *
+ * @param data
+ *     The guac_common_display_layer associated with the surface.
+ */
+static void guac_common_display_layer_pending(guac_common_surface* surface,
+        void* data) {
+
+    guac_common_display_layer* display_layer =
+        (guac_common_display_layer*) data;
+
+    guac_common_display* display = display_layer->display;
+
+    pthread_mutex_lock(&display->_dirty_lock);
+
+    /* Add to dirty set only if not already present. The default layer is
+     * tracked by its flag alone, as it is always flushed last. */
+    if (!display_layer->dirty) {
+
+        display_layer->dirty = 1;
+
+        if (display_layer != &display->default_layer) {
+            display_layer->next_dirty = display->dirty_layers;
+            display->dirty_layers = display_layer;
+        }
+
+    }
+
+    pthread_mutex_unlock(&display->_dirty_lock);
+
+}
+
+/**
+ * Removes the given display layer from the set of layers having changes
+ * awaiting the next flush of the display, if present. This must be invoked
+ * before the display layer is freed.
+ *
+ * @param display
+ *     The display that allocated the given layer.
+ *
+ * @param display_layer
+ *     The display layer to remove.
+ */
+static void guac_common_display_remove_dirty(guac_common_display* display,
+        guac_common_display_layer* display_layer) {
+
+    pthread_mutex_lock(&display->_dirty_lock);
+
+    if (display_layer->dirty) {
+
+        guac_common_display_layer** current = &display->dirty_layers;
+        while (*current != NULL) {
+
+            /* Unlink matching element */
+            if (*current == display_layer) {
+                *current = display_layer->next_dirty;
+                break;
+            }
+
+            current = &((*current)->next_dirty);
+
+        }
+
+        display_layer->dirty = 0;
+
+    }
+
+    pthread_mutex_unlock(&display->_dirty_lock);
+
+}
+
+/**
+ * Returns the current value of the monotonic clock, in microseconds, for the
+ * sake of measuring the time taken to flush each layer.
+ *
+ * @return
+ *     The current value of the monotonic clock, in microseconds.
+ */
+static int64_t guac_common_display_now_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Flushes the surface of the given display layer, logging the time taken at
+ * the GUAC_LOG_TRACE level.
+ *
+ * @param display
+ *     The display that allocated the given layer.
+ *
+ * @param display_layer
+ *     The display layer whose surface should be flushed.
+ *
+ * @return
+ *     The time taken to flush the surface, in microseconds.
+ */
+static int64_t guac_common_display_flush_layer(guac_common_display* display,
+        guac_common_display_layer* display_layer) {
+
+    guac_common_surface* surface = display_layer->surface;
+
+    int64_t start = guac_common_display_now_us();
+    guac_common_surface_flush(surface);
+    int64_t elapsed = guac_common_display_now_us() - start;
+
+    guac_client_log(display->client, GUAC_LOG_TRACE, "Layer %i flushed in "
+            "%" PRId64 " us.", surface->layer->index, elapsed);
+
+    return elapsed;
+
+}
+
 /**
  * Frees all layers and associated surfaces within the given list, as well as
  * their corresponding list elements. If the provided pointer to the linked
@@ -130,6 +524,14 @@ guac_common_display* guac_common_display_alloc(guac_client* client,
         return NULL;
     }
 
+    /* Allocate controller shared by all surfaces */
+    display->quality_controller = guac_common_quality_controller_alloc(client);
+    if (display->quality_controller == NULL) {
+        guac_common_cursor_free(display->cursor);
+        free(display);
+        return NULL;
+    }
+
     pthread_mutex_init(&display->_lock, NULL);
 
     /* Associate display with given client */
@@ -138,9 +540,30 @@ guac_common_display* guac_common_display_alloc(guac_client* client,
     display->default_surface = guac_common_surface_alloc(client,
             client->socket, GUAC_DEFAULT_LAYER, width, height);
 
+    guac_common_surface_set_quality_controller(display->default_surface,
+            display->quality_controller);
+
     /* No initial layers or buffers */
     display->layers = NULL;
     display->buffers = NULL;
+    display->disposed = NULL;
+
+    /* Track changes to the default surface like any other layer */
+    pthread_mutex_init(&display->_dirty_lock, NULL);
+    display->dirty_layers = NULL;
+    display->default_layer = (guac_common_display_layer) {
+        .surface = display->default_surface,
+        .display = display
+    };
+
+    guac_common_surface_set_pending_handler(display->default_surface,
+            guac_common_display_layer_pending, &display->default_layer);
+
+    /* Encode images within the flushing thread by default */
+    display->encode_pool = NULL;
+
+    /* Do not cache images by default */
+    display->image_cache = NULL;
 
     return display;
 
@@ -158,6 +581,25 @@ void guac_common_display_free(guac_common_display* display) {
     guac_common_display_free_layers(display->buffers, display->client);
     guac_common_display_free_layers(display->layers, display->client);
 
+    /* Free all records of freed layers and buffers */
+    guac_common_display_disposed* disposed = display->disposed;
+    while (disposed != NULL) {
+        guac_common_display_disposed* next = disposed->next;
+        free(disposed);
+        disposed = next;
+    }
+
+    /* Free encode pool only after all surfaces using the pool are freed */
+    if (display->encode_pool != NULL)
+        guac_common_encode_pool_free(display->encode_pool);
+
+    /* Likewise free the image cache and its buffers */
+    if (display->image_cache != NULL)
+        guac_common_image_cache_free(display->image_cache);
+
+    guac_common_quality_controller_free(display->quality_controller);
+
+    pthread_mutex_destroy(&display->_dirty_lock);
     pthread_mutex_destroy(&display->_lock);
     free(display);
 
@@ -178,10 +620,89 @@ void guac_common_display_dup(guac_common_display* display, guac_user* user,
     guac_common_display_dup_layers(display->layers, user, socket);
     guac_common_display_dup_layers(display->buffers, user, socket);
 
+    /* Synchronize buffers of cached images */
+    if (display->image_cache != NULL)
+        guac_common_image_cache_dup(display->image_cache, user, socket);
+
     pthread_mutex_unlock(&display->_lock);
 
 }
 
+void guac_common_display_resync(guac_common_display* display, guac_user* user,
+        guac_socket* socket, guac_timestamp since) {
+
+    guac_common_display_resync_output output = {
+        .data = malloc(GUAC_COMMON_DISPLAY_RESYNC_OUTPUT_SIZE),
+        .size = GUAC_COMMON_DISPLAY_RESYNC_OUTPUT_SIZE
+    };
+
+    /* Buffer the display state in memory, such that the display need not
+     * remain locked while it is written to a user that is likely slow */
+    guac_socket* buffered = guac_socket_alloc();
+    guac_socket* target = socket;
+    if (output.data != NULL && buffered != NULL) {
+        buffered->data = &output;
+        buffered->write_handler = guac_common_display_resync_write_handler;
+        target = buffered;
+    }
+
+    pthread_mutex_lock(&display->_lock);
+
+    /* The state sent must correspond exactly to the point in the broadcast
+     * output at which the user resumes, thus nothing which is part of that
+     * state may change (nor be partway through being sent) until both the
+     * state and that point have been determined */
+    guac_common_display_lock_surfaces(display);
+    guac_common_cursor_lock(display->cursor);
+    guac_client_discard_broadcast(display->client, user, target);
+
+    /* Dispose of any layers and buffers freed since the given frame */
+    for (guac_common_display_disposed* disposed = display->disposed;
+            disposed != NULL; disposed = disposed->next) {
+
+        if (disposed->frame >= since) {
+            const guac_layer layer = { .index = disposed->index };
+            guac_protocol_send_dispose(target, &layer);
+        }
+
+    }
+
+    /* Restore any cached images stored since the given frame, including
+     * those whose buffers reuse indices disposed of above */
+    if (display->image_cache != NULL)
+        guac_common_image_cache_resync(display->image_cache, user, target,
+                since);
+
+    /* Synchronize shared cursor */
+    guac_common_cursor_resync(display->cursor, user, target);
+
+    /* Resynchronize default surface */
+    guac_common_surface_resync(display->default_surface, user, target, since);
+
+    /* Resynchronize all layers and buffers */
+    guac_common_display_resync_layers(display->layers, user, target, since);
+    guac_common_display_resync_layers(display->buffers, user, target, since);
+
+    guac_common_cursor_unlock(display->cursor);
+    guac_common_display_unlock_surfaces(display);
+
+    pthread_mutex_unlock(&display->_lock);
+
+    /* Write buffered state as a single block, such that it cannot be
+     * interleaved with other instructions */
+    if (target == buffered) {
+        guac_socket_instruction_begin(socket);
+        guac_socket_write(socket, output.data, output.length);
+        guac_socket_instruction_end(socket);
+    }
+
+    if (buffered != NULL)
+        guac_socket_free(buffered);
+
+    free(output.data);
+
+}
+
 void guac_common_display_set_lossless(guac_common_display* display,
         int lossless) {
 
@@ -206,19 +727,193 @@ void guac_common_display_set_lossless(guac_common_display* display,
 
 }
 
+/**
+ * Sets the encode pool of each surface within the given linked list of
+ * layers or buffers.
+ *
+ * @param display_layer
+ *     The first element of the list of layers or buffers to modify, or NULL
+ *     if the list is empty.
+ *
+ * @param pool
+ *     The encode pool to assign to each surface, or NULL if each surface
+ *     should encode images within the thread flushing that surface.
+ */
+static void guac_common_display_set_encode_pool_layers(
+        guac_common_display_layer* display_layer,
+        guac_common_encode_pool* pool) {
+
+    while (display_layer != NULL) {
+        guac_common_surface_set_encode_pool(display_layer->surface, pool);
+        display_layer = display_layer->next;
+    }
+
+}
+
+/**
+ * Returns the greatest number of encoding threads that a display may use,
+ * which is the number of online processors, but never more than
+ * GUAC_COMMON_DISPLAY_MAX_ENCODE_THREADS.
+ *
+ * @return
+ *     The greatest number of encoding threads that a display may use.
+ */
+static int guac_common_display_max_encode_threads() {
+
+    long processors = -1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    processors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    /* Assume the fixed maximum if the number of processors is unknown */
+    if (processors < 1 || processors > GUAC_COMMON_DISPLAY_MAX_ENCODE_THREADS)
+        return GUAC_COMMON_DISPLAY_MAX_ENCODE_THREADS;
+
+    return (int) processors;
+
+}
+
+void guac_common_display_set_encode_threads(guac_common_display* display,
+        int threads) {
+
+    guac_common_encode_pool* pool = NULL;
+
+    /* Never start more threads than can usefully run at once */
+    int max_threads = guac_common_display_max_encode_threads();
+    if (threads > max_threads) {
+        guac_client_log(display->client, GUAC_LOG_WARNING, "%i encoding "
+                "threads were requested, but at most %i may be used. Using "
+                "%i encoding threads.", threads, max_threads, max_threads);
+        threads = max_threads;
+    }
+
+    /* A pool is only needed if more than one thread is requested */
+    if (threads > 1) {
+        pool = guac_common_encode_pool_alloc(threads);
+        if (pool == NULL)
+            guac_client_log(display->client, GUAC_LOG_WARNING, "Unable to "
+                    "start %i encoding threads. Images will be encoded "
+                    "one at a time.", threads);
+    }
+
+    pthread_mutex_lock(&display->_lock);
+
+    guac_common_encode_pool* old_pool = display->encode_pool;
+    display->encode_pool = pool;
+
+    /* Update all surfaces, including those not yet allocated */
+    guac_common_surface_set_encode_pool(display->default_surface, pool);
+    guac_common_display_set_encode_pool_layers(display->layers, pool);
+    guac_common_display_set_encode_pool_layers(display->buffers, pool);
+
+    pthread_mutex_unlock(&display->_lock);
+
+    /* No surface can be using the old pool, as each surface is locked for
+     * the duration of each flush */
+    if (old_pool != NULL)
+        guac_common_encode_pool_free(old_pool);
+
+}
+
+/**
+ * Sets the image cache of each surface within the given linked list of
+ * layers or buffers.
+ *
+ * @param display_layer
+ *     The first element of the list of layers or buffers to modify, or NULL
+ *     if the list is empty.
+ *
+ * @param cache
+ *     The image cache to assign to each surface, or NULL if each surface
+ *     should not cache images.
+ */
+static void guac_common_display_set_image_cache_layers(
+        guac_common_display_layer* display_layer,
+        guac_common_image_cache* cache) {
+
+    while (display_layer != NULL) {
+        guac_common_surface_set_image_cache(display_layer->surface, cache);
+        display_layer = display_layer->next;
+    }
+
+}
+
+void guac_common_display_set_image_cache_size(guac_common_display* display,
+        size_t size) {
+
+    guac_common_image_cache* cache = NULL;
+
+    /* A cache is only needed if images may actually be stored */
+    if (size > 0) {
+        cache = guac_common_image_cache_alloc(display->client, size);
+        if (cache == NULL)
+            guac_client_log(display->client, GUAC_LOG_WARNING, "Unable to "
+                    "allocate image cache. Repeated images will be sent "
+                    "normally.");
+    }
+
+    pthread_mutex_lock(&display->_lock);
+
+    guac_common_image_cache* old_cache = display->image_cache;
+    display->image_cache = cache;
+
+    /* Update all surfaces, including those not yet allocated */
+    guac_common_surface_set_image_cache(display->default_surface, cache);
+    guac_common_display_set_image_cache_layers(display->layers, cache);
+    guac_common_display_set_image_cache_layers(display->buffers, cache);
+
+    pthread_mutex_unlock(&display->_lock);
+
+    /* As with encode pools, no surface can be using the old cache */
+    if (old_cache != NULL)
+        guac_common_image_cache_free(old_cache);
+
+}
+
 void guac_common_display_flush(guac_common_display* display) {
 
     pthread_mutex_lock(&display->_lock);
 
-    guac_common_display_layer* current = display->layers;
+    /* Adjust encoding parameters to current congestion */
+    guac_common_quality_controller_update(display->quality_controller);
+
+    /* Take ownership of the current dirty set. Any layers changed while
+     * flushing will be added to a new set for the next flush. */
+    pthread_mutex_lock(&display->_dirty_lock);
+
+    guac_common_display_layer* current = display->dirty_layers;
+    display->dirty_layers = NULL;
+
+    int default_dirty = display->default_layer.dirty;
+    display->default_layer.dirty = 0;
+
+    for (guac_common_display_layer* layer = current; layer != NULL;
+            layer = layer->next_dirty)
+        layer->dirty = 0;
 
-    /* Flush all surfaces */
+    pthread_mutex_unlock(&display->_dirty_lock);
+
+    int flushed = 0;
+    int64_t elapsed = 0;
+
+    /* Flush only those surfaces which have changed */
     while (current != NULL) {
-        guac_common_surface_flush(current->surface);
-        current = current->next;
+        guac_common_display_layer* next = current->next_dirty;
+        elapsed += guac_common_display_flush_layer(display, current);
+        flushed++;
+        current = next;
     }
 
-    guac_common_surface_flush(display->default_surface);
+    if (default_dirty) {
+        elapsed += guac_common_display_flush_layer(display,
+                &display->default_layer);
+        flushed++;
+    }
+
+    if (flushed)
+        guac_client_log(display->client, GUAC_LOG_TRACE, "Display flushed "
+                "%i changed layer(s) in %" PRId64 " us.", flushed, elapsed);
 
     pthread_mutex_unlock(&display->_lock);
 
@@ -256,6 +951,9 @@ static guac_common_display_layer* guac_common_display_add_layer(
     /* Init layer/surface pair */
     display_layer->layer = layer;
     display_layer->surface = surface;
+    display_layer->display = NULL;
+    display_layer->dirty = 0;
+    display_layer->next_dirty = NULL;
 
     /* Insert list element as the new head */
     display_layer->prev = NULL;
@@ -306,18 +1004,29 @@ guac_common_display_layer* guac_common_display_alloc_layer(
 
     /* Allocate Guacamole layer */
     guac_layer* layer = guac_client_alloc_layer(display->client);
+    guac_common_display_remove_disposed(display, layer->index);
 
     /* Allocate corresponding surface */
     guac_common_surface* surface = guac_common_surface_alloc(display->client,
             display->client->socket, layer, width, height);
 
-    /* Apply current display losslessness */
+    /* Apply current display losslessness, encoding threads, and cache */
     guac_common_surface_set_lossless(surface, display->lossless);
+    guac_common_surface_set_encode_pool(surface, display->encode_pool);
+    guac_common_surface_set_image_cache(surface, display->image_cache);
+    guac_common_surface_set_quality_controller(surface,
+            display->quality_controller);
 
     /* Add layer and surface to list */
     guac_common_display_layer* display_layer =
         guac_common_display_add_layer(&display->layers, layer, surface);
 
+    /* Track changes to the new layer such that only changed layers need be
+     * flushed */
+    display_layer->display = display;
+    guac_common_surface_set_pending_handler(surface,
+            guac_common_display_layer_pending, display_layer);
+
     pthread_mutex_unlock(&display->_lock);
     return display_layer;
 
@@ -330,18 +1039,26 @@ guac_common_display_layer* guac_common_display_alloc_buffer(
 
     /* Allocate Guacamole buffer */
     guac_layer* buffer = guac_client_alloc_buffer(display->client);
+    guac_common_display_remove_disposed(display, buffer->index);
 
     /* Allocate corresponding surface */
     guac_common_surface* surface = guac_common_surface_alloc(display->client,
             display->client->socket, buffer, width, height);
 
-    /* Apply current display losslessness */
+    /* Apply current display losslessness, encoding threads, and cache */
     guac_common_surface_set_lossless(surface, display->lossless);
+    guac_common_surface_set_encode_pool(surface, display->encode_pool);
+    guac_common_surface_set_image_cache(surface, display->image_cache);
+    guac_common_surface_set_quality_controller(surface,
+            display->quality_controller);
 
     /* Add buffer and surface to list */
     guac_common_display_layer* display_layer =
         guac_common_display_add_layer(&display->buffers, buffer, surface);
 
+    /* Buffers are flushed only when used, and thus never become dirty */
+    display_layer->display = display;
+
     pthread_mutex_unlock(&display->_lock);
     return display_layer;
 
@@ -354,9 +1071,11 @@ void guac_common_display_free_layer(guac_common_display* display,
 
     /* Remove list element from list */
     guac_common_display_remove_layer(&display->layers, display_layer);
+    guac_common_display_remove_dirty(display, display_layer);
 
     /* Free associated layer and surface */
     guac_common_surface_free(display_layer->surface);
+    guac_common_display_add_disposed(display, display_layer->layer->index);
     guac_client_free_layer(display->client, display_layer->layer);
 
     /* Free list element */
@@ -376,6 +1095,7 @@ void guac_common_display_free_buffer(guac_common_display* display,
 
     /* Free associated layer and surface */
     guac_common_surface_free(display_buffer->surface);
+    guac_common_display_add_disposed(display, display_buffer->layer->index);
     guac_client_free_buffer(display->client, display_buffer->layer);
 
     /* Free list element */
@@ -0,0 +1,441 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "common/encode-pool.h"
+
+#include <guacamole/error.h>
+#include <guacamole/socket.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The initial size of the buffer which receives the output of a job, in
+ * bytes. Buffers grow automatically as needed and are reused by later jobs.
+ */
+#define GUAC_COMMON_ENCODE_POOL_OUTPUT_SIZE 65536
+
+/**
+ * A job submitted to a guac_common_encode_pool, along with the buffered
+ * output of that job. Job structures are reused across flushes.
+ */
+typedef struct guac_common_encode_job {
+
+    /**
+     * The handler which performs this job.
+     */
+    guac_common_encode_pool_handler* handler;
+
+    /**
+     * Arbitrary data to pass to the handler.
+     */
+    void* data;
+
+    /**
+     * The socket provided to the handler, which appends all data written to
+     * the output buffer of this job.
+     */
+    guac_socket* socket;
+
+    /**
+     * All data written by the handler thus far.
+     */
+    char* output;
+
+    /**
+     * The number of bytes of data within the output buffer.
+     */
+    size_t length;
+
+    /**
+     * The number of bytes currently allocated for the output buffer.
+     */
+    size_t size;
+
+    /**
+     * Non-zero if the handler has completed, zero otherwise.
+     */
+    int done;
+
+} guac_common_encode_job;
+
+struct guac_common_encode_pool {
+
+    /**
+     * Lock which must be acquired before accessing the jobs within the pool
+     * or their completion status.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Lock which is held by the thread submitting jobs, from the call to
+     * guac_common_encode_pool_begin() until the pool is flushed.
+     */
+    pthread_mutex_t batch_lock;
+
+    /**
+     * Condition which is signalled whenever a new job is submitted or the
+     * pool is being freed.
+     */
+    pthread_cond_t job_available;
+
+    /**
+     * Condition which is signalled whenever a job completes.
+     */
+    pthread_cond_t job_complete;
+
+    /**
+     * All worker threads.
+     */
+    pthread_t* threads;
+
+    /**
+     * The number of worker threads within the threads array.
+     */
+    int thread_count;
+
+    /**
+     * Array of all job structures allocated thus far, in order of
+     * submission. Only the first job_count jobs are currently in use.
+     */
+    guac_common_encode_job** jobs;
+
+    /**
+     * The number of job structures allocated within the jobs array.
+     */
+    int jobs_allocated;
+
+    /**
+     * The number of jobs submitted since the pool was last flushed.
+     */
+    int job_count;
+
+    /**
+     * The index of the next submitted job which has not yet been claimed by
+     * any thread.
+     */
+    int next_job;
+
+    /**
+     * Non-zero if the pool is being freed and all worker threads must stop,
+     * zero otherwise.
+     */
+    int stopping;
+
+};
+
+/**
+ * Socket write handler which appends all written data to the output buffer
+ * of the guac_common_encode_job associated with the socket.
+ *
+ * @param socket
+ *     The socket being written to.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param count
+ *     The number of bytes to write.
+ *
+ * @return
+ *     The number of bytes written, or -1 if the output buffer cannot be
+ *     expanded.
+ */
+static ssize_t guac_common_encode_job_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_common_encode_job* job = (guac_common_encode_job*) socket->data;
+
+    /* Expand output buffer as necessary */
+    if (job->length + count > job->size) {
+
+        size_t size = job->size;
+        while (job->length + count > size)
+            size *= 2;
+
+        char* output = realloc(job->output, size);
+        if (output == NULL)
+            return -1;
+
+        job->output = output;
+        job->size = size;
+
+    }
+
+    memcpy(job->output + job->length, buf, count);
+    job->length += count;
+    return count;
+
+}
+
+/**
+ * Allocates a new job structure, including its socket and output buffer.
+ *
+ * @return
+ *     A newly-allocated job structure, or NULL if allocation fails.
+ */
+static guac_common_encode_job* guac_common_encode_job_alloc() {
+
+    guac_common_encode_job* job = calloc(1, sizeof(guac_common_encode_job));
+    if (job == NULL)
+        return NULL;
+
+    job->size = GUAC_COMMON_ENCODE_POOL_OUTPUT_SIZE;
+    job->output = malloc(job->size);
+    job->socket = guac_socket_alloc();
+
+    if (job->output == NULL || job->socket == NULL) {
+        if (job->socket != NULL)
+            guac_socket_free(job->socket);
+        free(job->output);
+        free(job);
+        return NULL;
+    }
+
+    job->socket->data = job;
+    job->socket->write_handler = guac_common_encode_job_write_handler;
+
+    return job;
+
+}
+
+/**
+ * Frees the given job structure, including its socket and output buffer.
+ *
+ * @param job
+ *     The job structure to free.
+ */
+static void guac_common_encode_job_free(guac_common_encode_job* job) {
+    guac_socket_free(job->socket);
+    free(job->output);
+    free(job);
+}
+
+/**
+ * Performs the given job, which must already have been claimed by the
+ * current thread, marking the job as complete. The lock of the pool must be
+ * held, and is temporarily released while the job is performed.
+ *
+ * @param pool
+ *     The pool containing the job.
+ *
+ * @param job
+ *     The job to perform.
+ */
+static void guac_common_encode_pool_run(guac_common_encode_pool* pool,
+        guac_common_encode_job* job) {
+
+    pthread_mutex_unlock(&pool->lock);
+    job->handler(job->socket, job->data);
+    pthread_mutex_lock(&pool->lock);
+
+    job->done = 1;
+    pthread_cond_broadcast(&pool->job_complete);
+
+}
+
+/**
+ * Worker thread which performs jobs as they are submitted to the given pool,
+ * until the pool is freed.
+ *
+ * @param data
+ *     A pointer to the guac_common_encode_pool providing jobs.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_common_encode_pool_worker(void* data) {
+
+    guac_common_encode_pool* pool = (guac_common_encode_pool*) data;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (!pool->stopping) {
+
+        /* Perform next unclaimed job, if any */
+        if (pool->next_job < pool->job_count)
+            guac_common_encode_pool_run(pool, pool->jobs[pool->next_job++]);
+
+        /* Otherwise wait for more jobs */
+        else
+            pthread_cond_wait(&pool->job_available, &pool->lock);
+
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+
+}
+
+guac_common_encode_pool* guac_common_encode_pool_alloc(int threads) {
+
+    guac_common_encode_pool* pool = calloc(1, sizeof(guac_common_encode_pool));
+    if (pool == NULL)
+        return NULL;
+
+    /* The thread flushing the pool is itself one of the threads */
+    pool->threads = calloc(threads, sizeof(pthread_t));
+    if (pool->threads == NULL) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->batch_lock, NULL);
+    pthread_cond_init(&pool->job_available, NULL);
+    pthread_cond_init(&pool->job_complete, NULL);
+
+    /* Start all additional worker threads */
+    while (pool->thread_count < threads - 1) {
+
+        if (pthread_create(&pool->threads[pool->thread_count], NULL,
+                    guac_common_encode_pool_worker, pool)) {
+            guac_common_encode_pool_free(pool);
+            return NULL;
+        }
+
+        pool->thread_count++;
+
+    }
+
+    return pool;
+
+}
+
+void guac_common_encode_pool_free(guac_common_encode_pool* pool) {
+
+    /* Signal all worker threads to stop */
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->job_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    /* Wait for all worker threads to stop */
+    for (int i = 0; i < pool->thread_count; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    /* Free all job structures */
+    for (int i = 0; i < pool->jobs_allocated; i++)
+        guac_common_encode_job_free(pool->jobs[i]);
+
+    pthread_cond_destroy(&pool->job_complete);
+    pthread_cond_destroy(&pool->job_available);
+    pthread_mutex_destroy(&pool->batch_lock);
+    pthread_mutex_destroy(&pool->lock);
+
+    free(pool->jobs);
+    free(pool->threads);
+    free(pool);
+
+}
+
+void guac_common_encode_pool_begin(guac_common_encode_pool* pool) {
+    pthread_mutex_lock(&pool->batch_lock);
+}
+
+int guac_common_encode_pool_submit(guac_common_encode_pool* pool,
+        guac_common_encode_pool_handler* handler, void* data) {
+
+    pthread_mutex_lock(&pool->lock);
+
+    /* Allocate a new job structure if all existing structures are in use */
+    if (pool->job_count == pool->jobs_allocated) {
+
+        guac_common_encode_job* job = guac_common_encode_job_alloc();
+        guac_common_encode_job** jobs = realloc(pool->jobs,
+                sizeof(guac_common_encode_job*) * (pool->jobs_allocated + 1));
+
+        if (job == NULL || jobs == NULL) {
+
+            if (job != NULL)
+                guac_common_encode_job_free(job);
+
+            /* The original array remains valid if realloc() fails */
+            if (jobs != NULL)
+                pool->jobs = jobs;
+
+            pthread_mutex_unlock(&pool->lock);
+
+            guac_error = GUAC_STATUS_NO_MEMORY;
+            guac_error_message = "Could not allocate memory for encode job";
+            return 1;
+
+        }
+
+        pool->jobs = jobs;
+        pool->jobs[pool->jobs_allocated++] = job;
+
+    }
+
+    guac_common_encode_job* job = pool->jobs[pool->job_count++];
+    job->handler = handler;
+    job->data = data;
+    job->length = 0;
+    job->done = 0;
+
+    pthread_cond_signal(&pool->job_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+
+}
+
+void guac_common_encode_pool_flush(guac_common_encode_pool* pool,
+        guac_socket* socket) {
+
+    pthread_mutex_lock(&pool->lock);
+
+    /* Write the output of each job in order of submission */
+    for (int i = 0; i < pool->job_count; i++) {
+
+        guac_common_encode_job* job = pool->jobs[i];
+
+        /* Help perform any unclaimed jobs until this job is complete */
+        while (!job->done) {
+            if (pool->next_job < pool->job_count)
+                guac_common_encode_pool_run(pool, pool->jobs[pool->next_job++]);
+            else
+                pthread_cond_wait(&pool->job_complete, &pool->lock);
+        }
+
+        /* Completed jobs are not touched by other threads */
+        pthread_mutex_unlock(&pool->lock);
+
+        guac_socket_instruction_begin(socket);
+        guac_socket_write(socket, job->output, job->length);
+        guac_socket_instruction_end(socket);
+
+        pthread_mutex_lock(&pool->lock);
+
+    }
+
+    /* All jobs have now been claimed and completed */
+    pool->job_count = 0;
+    pool->next_job = 0;
+
+    pthread_mutex_unlock(&pool->lock);
+
+    /* Release exclusive use acquired by guac_common_encode_pool_begin() */
+    pthread_mutex_unlock(&pool->batch_lock);
+
+}
+
@@ -0,0 +1,364 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/heat-map.h"
+#include "common/rect.h"
+
+#include <guacamole/timestamp.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/**
+ * Allocates the bands of the given heat map such that the heat map covers a
+ * surface of the given dimensions. Any existing bands are not freed.
+ *
+ * @param heat_map
+ *     The heat map whose bands should be allocated.
+ *
+ * @param width
+ *     The width of the surface covered by the heat map, in pixels.
+ *
+ * @param height
+ *     The height of the surface covered by the heat map, in pixels.
+ */
+static void __guac_common_heat_map_init_bands(guac_common_heat_map* heat_map,
+        int width, int height) {
+
+    heat_map->width = GUAC_COMMON_HEAT_MAP_DIMENSION(width);
+    heat_map->height = GUAC_COMMON_HEAT_MAP_DIMENSION(height);
+    heat_map->band_count = (heat_map->height
+            + GUAC_COMMON_HEAT_MAP_BAND_HEIGHT - 1)
+            / GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+
+    heat_map->bands = calloc(heat_map->band_count,
+            sizeof(guac_common_heat_map_band));
+
+    for (int i = 0; i < heat_map->band_count; i++) {
+
+        guac_common_heat_map_band* band = &heat_map->bands[i];
+
+        /* The final band may be shorter than the others */
+        band->rows = heat_map->height - i * GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+        if (band->rows > GUAC_COMMON_HEAT_MAP_BAND_HEIGHT)
+            band->rows = GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+
+        band->cells = calloc(band->rows * heat_map->width,
+                sizeof(guac_common_heat_map_cell));
+        band->sums = calloc((band->rows + 1) * (heat_map->width + 1),
+                sizeof(unsigned int));
+
+        pthread_mutex_init(&band->lock, NULL);
+
+    }
+
+}
+
+/**
+ * Frees all bands of the given heat map.
+ *
+ * @param heat_map
+ *     The heat map whose bands should be freed.
+ */
+static void __guac_common_heat_map_free_bands(guac_common_heat_map* heat_map) {
+
+    for (int i = 0; i < heat_map->band_count; i++) {
+        guac_common_heat_map_band* band = &heat_map->bands[i];
+        pthread_mutex_destroy(&band->lock);
+        free(band->cells);
+        free(band->sums);
+    }
+
+    free(heat_map->bands);
+
+}
+
+/**
+ * Converts the given rectangle, in pixels, to the inclusive range of heat map
+ * cells which intersect that rectangle, clipped to the bounds of the heat
+ * map.
+ *
+ * @param heat_map
+ *     The heat map containing the cells.
+ *
+ * @param rect
+ *     The rectangle to convert, in pixels.
+ *
+ * @param min_x
+ *     Pointer to an int which will receive the column of the leftmost cell.
+ *
+ * @param min_y
+ *     Pointer to an int which will receive the row of the topmost cell.
+ *
+ * @param max_x
+ *     Pointer to an int which will receive the column of the rightmost cell.
+ *
+ * @param max_y
+ *     Pointer to an int which will receive the row of the bottommost cell.
+ *
+ * @return
+ *     Non-zero if at least one cell intersects the given rectangle, zero
+ *     otherwise.
+ */
+static int __guac_common_heat_map_cell_range(guac_common_heat_map* heat_map,
+        const guac_common_rect* rect, int* min_x, int* min_y,
+        int* max_x, int* max_y) {
+
+    if (rect->width <= 0 || rect->height <= 0)
+        return 0;
+
+    int right = rect->x + rect->width - 1;
+    int bottom = rect->y + rect->height - 1;
+
+    if (right < 0 || bottom < 0)
+        return 0;
+
+    *min_x = rect->x > 0 ? rect->x / GUAC_COMMON_HEAT_MAP_CELL_SIZE : 0;
+    *min_y = rect->y > 0 ? rect->y / GUAC_COMMON_HEAT_MAP_CELL_SIZE : 0;
+    *max_x = right / GUAC_COMMON_HEAT_MAP_CELL_SIZE;
+    *max_y = bottom / GUAC_COMMON_HEAT_MAP_CELL_SIZE;
+
+    if (*max_x >= heat_map->width)
+        *max_x = heat_map->width - 1;
+
+    if (*max_y >= heat_map->height)
+        *max_y = heat_map->height - 1;
+
+    return *min_x <= *max_x && *min_y <= *max_y;
+
+}
+
+/**
+ * Recalculates the summed-area table of the given band from the framerates
+ * of its cells. The band must be locked.
+ *
+ * @param band
+ *     The band whose summed-area table should be recalculated.
+ *
+ * @param width
+ *     The width of the band, in cells.
+ */
+static void __guac_common_heat_map_band_update_sums(
+        guac_common_heat_map_band* band, int width) {
+
+    int sums_width = width + 1;
+
+    for (int y = 0; y < band->rows; y++) {
+
+        const guac_common_heat_map_cell* cell = band->cells + y * width;
+        unsigned int* above = band->sums + y * sums_width;
+        unsigned int* current = above + sums_width;
+
+        /* Each entry is the sum of the current row up to this cell, plus the
+         * entry above */
+        unsigned int row_sum = 0;
+        for (int x = 0; x < width; x++) {
+            row_sum += cell[x].framerate;
+            current[x + 1] = above[x + 1] + row_sum;
+        }
+
+    }
+
+    band->dirty = 0;
+
+}
+
+guac_common_heat_map* guac_common_heat_map_alloc(int width, int height) {
+
+    guac_common_heat_map* heat_map = calloc(1, sizeof(guac_common_heat_map));
+    pthread_rwlock_init(&heat_map->lock, NULL);
+
+    __guac_common_heat_map_init_bands(heat_map, width, height);
+    return heat_map;
+
+}
+
+void guac_common_heat_map_free(guac_common_heat_map* heat_map) {
+
+    __guac_common_heat_map_free_bands(heat_map);
+    pthread_rwlock_destroy(&heat_map->lock);
+    free(heat_map);
+
+}
+
+void guac_common_heat_map_resize(guac_common_heat_map* heat_map,
+        int width, int height) {
+
+    pthread_rwlock_wrlock(&heat_map->lock);
+
+    /* Allocate completely new bands (can safely discard old stats) */
+    __guac_common_heat_map_free_bands(heat_map);
+    __guac_common_heat_map_init_bands(heat_map, width, height);
+
+    pthread_rwlock_unlock(&heat_map->lock);
+
+}
+
+void guac_common_heat_map_touch(guac_common_heat_map* heat_map,
+        const guac_common_rect* rect, guac_timestamp time) {
+
+    int min_x, min_y, max_x, max_y;
+
+    pthread_rwlock_rdlock(&heat_map->lock);
+
+    if (!__guac_common_heat_map_cell_range(heat_map, rect,
+                &min_x, &min_y, &max_x, &max_y))
+        goto complete;
+
+    int first_band = min_y / GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+    int last_band = max_y / GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+
+    for (int i = first_band; i <= last_band; i++) {
+
+        guac_common_heat_map_band* band = &heat_map->bands[i];
+        int band_y = i * GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+
+        /* Determine rows of this band which intersect the rectangle */
+        int start_row = min_y > band_y ? min_y - band_y : 0;
+        int end_row = max_y - band_y;
+        if (end_row >= band->rows)
+            end_row = band->rows - 1;
+
+        pthread_mutex_lock(&band->lock);
+
+        for (int y = start_row; y <= end_row; y++) {
+
+            guac_common_heat_map_cell* cell =
+                band->cells + y * heat_map->width + min_x;
+
+            for (int x = min_x; x <= max_x; x++, cell++) {
+
+                guac_timestamp elapsed = time - cell->last_update;
+
+                /* Ignore further updates within the same frame */
+                if (cell->last_update && elapsed <= 0)
+                    continue;
+
+                /* Update moving average of interval between updates */
+                if (cell->last_update) {
+
+                    if (elapsed > GUAC_COMMON_HEAT_MAP_MAX_INTERVAL)
+                        elapsed = GUAC_COMMON_HEAT_MAP_MAX_INTERVAL;
+
+                    int sample = elapsed << GUAC_COMMON_HEAT_MAP_INTERVAL_BITS;
+                    int interval = cell->interval;
+
+                    /* The first sample seeds the average */
+                    if (interval == 0)
+                        interval = sample;
+                    else
+                        interval += (sample - interval)
+                            / (1 << GUAC_COMMON_HEAT_MAP_EMA_SHIFT);
+
+                    cell->interval = interval > 0 ? interval : 1;
+
+                    if (cell->samples < GUAC_COMMON_HEAT_MAP_MIN_SAMPLES)
+                        cell->samples++;
+
+                    /* Report framerate (rounded to nearest) only once
+                     * enough samples exist */
+                    unsigned int one_second =
+                        1000 << GUAC_COMMON_HEAT_MAP_INTERVAL_BITS;
+
+                    unsigned int framerate = 0;
+                    if (cell->samples >= GUAC_COMMON_HEAT_MAP_MIN_SAMPLES)
+                        framerate = (one_second + cell->interval / 2)
+                            / cell->interval;
+
+                    if (framerate != cell->framerate) {
+                        cell->framerate = framerate;
+                        band->dirty = 1;
+                    }
+
+                }
+
+                cell->last_update = time;
+
+            }
+
+        }
+
+        pthread_mutex_unlock(&band->lock);
+
+    }
+
+complete:
+    pthread_rwlock_unlock(&heat_map->lock);
+
+}
+
+unsigned int guac_common_heat_map_get_framerate(
+        guac_common_heat_map* heat_map, const guac_common_rect* rect) {
+
+    int min_x, min_y, max_x, max_y;
+    unsigned int sum_framerate = 0;
+    unsigned int count = 0;
+
+    pthread_rwlock_rdlock(&heat_map->lock);
+
+    if (!__guac_common_heat_map_cell_range(heat_map, rect,
+                &min_x, &min_y, &max_x, &max_y))
+        goto complete;
+
+    int sums_width = heat_map->width + 1;
+    int first_band = min_y / GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+    int last_band = max_y / GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+
+    for (int i = first_band; i <= last_band; i++) {
+
+        guac_common_heat_map_band* band = &heat_map->bands[i];
+        int band_y = i * GUAC_COMMON_HEAT_MAP_BAND_HEIGHT;
+
+        /* Determine rows of this band which intersect the rectangle, as the
+         * half-open range [top, bottom) */
+        int top = min_y > band_y ? min_y - band_y : 0;
+        int bottom = max_y - band_y + 1;
+        if (bottom > band->rows)
+            bottom = band->rows;
+
+        pthread_mutex_lock(&band->lock);
+
+        /* Recalculate summed-area table only if changed since last query */
+        if (band->dirty)
+            __guac_common_heat_map_band_update_sums(band, heat_map->width);
+
+        const unsigned int* sums = band->sums;
+        sum_framerate += sums[bottom * sums_width + max_x + 1]
+                       - sums[top    * sums_width + max_x + 1]
+                       - sums[bottom * sums_width + min_x]
+                       + sums[top    * sums_width + min_x];
+
+        pthread_mutex_unlock(&band->lock);
+
+        count += (bottom - top) * (max_x - min_x + 1);
+
+    }
+
+complete:
+    pthread_rwlock_unlock(&heat_map->lock);
+
+    /* Calculate the average framerate over entire rect */
+    if (count)
+        return sum_framerate / count;
+
+    return 0;
+
+}
+
@@ -0,0 +1,399 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/image-cache.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/hash.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+guac_common_image_cache* guac_common_image_cache_alloc(guac_client* client,
+        size_t max_size) {
+
+    guac_common_image_cache* cache = calloc(1,
+            sizeof(guac_common_image_cache));
+    if (cache == NULL)
+        return NULL;
+
+    cache->client = client;
+    cache->max_size = max_size;
+
+    pthread_mutex_init(&cache->_lock, NULL);
+    return cache;
+
+}
+
+/**
+ * Frees the given entry, disposing of and freeing its buffer within the
+ * remotely-connected client. The entry must not be referenced by the cache
+ * after this function is invoked.
+ *
+ * @param cache
+ *     The image cache containing the entry.
+ *
+ * @param entry
+ *     The entry to free.
+ */
+static void guac_common_image_cache_free_entry(
+        guac_common_image_cache* cache, guac_common_image_cache_entry* entry) {
+
+    guac_client* client = cache->client;
+
+    guac_protocol_send_dispose(client->socket, entry->buffer);
+    guac_client_free_buffer(client, entry->buffer);
+
+    if (entry->image != NULL)
+        cairo_surface_destroy(entry->image);
+
+    free(entry);
+
+}
+
+void guac_common_image_cache_free(guac_common_image_cache* cache) {
+
+    int lookups = cache->hits + cache->misses;
+    guac_client_log(cache->client, GUAC_LOG_INFO, "Image cache: %i hits, "
+            "%i misses (%i%% hit rate), %i images stored, %i evicted.",
+            cache->hits, cache->misses,
+            lookups > 0 ? cache->hits * 100 / lookups : 0,
+            cache->stores, cache->evictions);
+
+    /* Free all cached entries */
+    guac_common_image_cache_entry* current = cache->newest;
+    while (current != NULL) {
+        guac_common_image_cache_entry* older = current->older;
+        guac_common_image_cache_free_entry(cache, current);
+        current = older;
+    }
+
+    /* Free all evicted entries */
+    current = cache->evicted;
+    while (current != NULL) {
+        guac_common_image_cache_entry* next = current->next_in_bucket;
+        guac_common_image_cache_free_entry(cache, current);
+        current = next;
+    }
+
+    pthread_mutex_destroy(&cache->_lock);
+    free(cache);
+
+}
+
+/**
+ * Removes the given entry from the least-recently-used list of the given
+ * cache. The entry remains within its hash table bucket.
+ *
+ * @param cache
+ *     The image cache containing the entry.
+ *
+ * @param entry
+ *     The entry to remove.
+ */
+static void guac_common_image_cache_unlink(guac_common_image_cache* cache,
+        guac_common_image_cache_entry* entry) {
+
+    if (entry->newer != NULL)
+        entry->newer->older = entry->older;
+    else
+        cache->newest = entry->older;
+
+    if (entry->older != NULL)
+        entry->older->newer = entry->newer;
+    else
+        cache->oldest = entry->newer;
+
+}
+
+/**
+ * Inserts the given entry at the head of the least-recently-used list of the
+ * given cache, marking it as the most recently used entry.
+ *
+ * @param cache
+ *     The image cache that should contain the entry.
+ *
+ * @param entry
+ *     The entry to insert, which must not currently be within the list.
+ */
+static void guac_common_image_cache_push(guac_common_image_cache* cache,
+        guac_common_image_cache_entry* entry) {
+
+    entry->newer = NULL;
+    entry->older = cache->newest;
+
+    if (cache->newest != NULL)
+        cache->newest->newer = entry;
+    else
+        cache->oldest = entry;
+
+    cache->newest = entry;
+
+}
+
+/**
+ * Evicts the least recently used entry from the given cache, retaining its
+ * buffer for reuse by a future entry. The cache must not be empty.
+ *
+ * @param cache
+ *     The image cache to evict an entry from.
+ */
+static void guac_common_image_cache_evict(guac_common_image_cache* cache) {
+
+    guac_common_image_cache_entry* entry = cache->oldest;
+    guac_common_image_cache_unlink(cache, entry);
+
+    /* Remove from hash table */
+    guac_common_image_cache_entry** current =
+        &cache->buckets[entry->hash % GUAC_COMMON_IMAGE_CACHE_BUCKETS];
+
+    while (*current != entry)
+        current = &((*current)->next_in_bucket);
+
+    *current = entry->next_in_bucket;
+
+    cairo_surface_destroy(entry->image);
+    entry->image = NULL;
+
+    cache->size -= entry->size;
+    cache->length--;
+    cache->evictions++;
+
+    /* Retain buffer for reuse */
+    entry->next_in_bucket = cache->evicted;
+    cache->evicted = entry;
+
+}
+
+/**
+ * Stores a copy of the given image within the given cache, evicting the
+ * least recently used entries as necessary to make room.
+ *
+ * @param cache
+ *     The image cache to store the image within.
+ *
+ * @param image
+ *     The image to store.
+ *
+ * @param hash
+ *     The hash of the given image, as produced by guac_hash_surface().
+ *
+ * @return
+ *     The newly-stored entry, or NULL if the image could not be stored.
+ */
+static guac_common_image_cache_entry* guac_common_image_cache_store(
+        guac_common_image_cache* cache, cairo_surface_t* image,
+        unsigned int hash) {
+
+    int width = cairo_image_surface_get_width(image);
+    int height = cairo_image_surface_get_height(image);
+    size_t size = (size_t) width * height * 4;
+
+    /* Copy image, retaining its pixels exactly */
+    cairo_surface_t* copy = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+            width, height);
+    if (cairo_surface_status(copy) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(copy);
+        return NULL;
+    }
+
+    unsigned char* src = cairo_image_surface_get_data(image);
+    int src_stride = cairo_image_surface_get_stride(image);
+
+    unsigned char* dst = cairo_image_surface_get_data(copy);
+    int dst_stride = cairo_image_surface_get_stride(copy);
+
+    for (int y = 0; y < height; y++) {
+        memcpy(dst, src, width * 4);
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    cairo_surface_mark_dirty(copy);
+
+    /* Make room for new entry */
+    while (cache->length > 0
+            && (cache->size + size > cache->max_size
+                || cache->length >= GUAC_COMMON_IMAGE_CACHE_MAX_ENTRIES))
+        guac_common_image_cache_evict(cache);
+
+    /* Reuse the buffer of an evicted entry if possible */
+    guac_common_image_cache_entry* entry = cache->evicted;
+    if (entry != NULL)
+        cache->evicted = entry->next_in_bucket;
+
+    /* Otherwise, allocate a new buffer */
+    else {
+        entry = malloc(sizeof(guac_common_image_cache_entry));
+        if (entry == NULL) {
+            cairo_surface_destroy(copy);
+            return NULL;
+        }
+        entry->buffer = guac_client_alloc_buffer(cache->client);
+    }
+
+    entry->hash = hash;
+    entry->image = copy;
+    entry->size = size;
+    entry->frame = cache->client->last_sent_timestamp;
+
+    /* Add to hash table */
+    guac_common_image_cache_entry** bucket =
+        &cache->buckets[hash % GUAC_COMMON_IMAGE_CACHE_BUCKETS];
+
+    entry->next_in_bucket = *bucket;
+    *bucket = entry;
+
+    guac_common_image_cache_push(cache, entry);
+
+    cache->size += size;
+    cache->length++;
+    cache->stores++;
+
+    return entry;
+
+}
+
+guac_common_image_cache_result guac_common_image_cache_lookup(
+        guac_common_image_cache* cache, cairo_surface_t* image,
+        const guac_layer** buffer) {
+
+    int width = cairo_image_surface_get_width(image);
+    int height = cairo_image_surface_get_height(image);
+    size_t size = (size_t) width * height * 4;
+
+    /* Do not bother hashing images which would never be stored */
+    if (width * height < GUAC_COMMON_IMAGE_CACHE_MIN_AREA
+            || size > cache->max_size
+                      / GUAC_COMMON_IMAGE_CACHE_MAX_ENTRY_FRACTION)
+        return GUAC_COMMON_IMAGE_CACHE_MISS;
+
+    unsigned int hash = guac_hash_surface(image);
+
+    pthread_mutex_lock(&cache->_lock);
+
+    /* Search for identical image within cache */
+    guac_common_image_cache_entry* entry =
+        cache->buckets[hash % GUAC_COMMON_IMAGE_CACHE_BUCKETS];
+
+    while (entry != NULL) {
+
+        /* Hashes may collide, so the images themselves must be compared */
+        if (entry->hash == hash && guac_surface_cmp(entry->image, image) == 0) {
+
+            /* Mark entry as most recently used */
+            guac_common_image_cache_unlink(cache, entry);
+            guac_common_image_cache_push(cache, entry);
+
+            cache->hits++;
+            *buffer = entry->buffer;
+
+            pthread_mutex_unlock(&cache->_lock);
+            return GUAC_COMMON_IMAGE_CACHE_HIT;
+
+        }
+
+        entry = entry->next_in_bucket;
+
+    }
+
+    cache->misses++;
+
+    /* Store only images which have been seen before */
+    unsigned int* seen = &cache->seen[hash % GUAC_COMMON_IMAGE_CACHE_SEEN_SIZE];
+    if (*seen != hash + 1) {
+        *seen = hash + 1;
+        pthread_mutex_unlock(&cache->_lock);
+        return GUAC_COMMON_IMAGE_CACHE_MISS;
+    }
+
+    entry = guac_common_image_cache_store(cache, image, hash);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&cache->_lock);
+        return GUAC_COMMON_IMAGE_CACHE_MISS;
+    }
+
+    *buffer = entry->buffer;
+
+    pthread_mutex_unlock(&cache->_lock);
+    return GUAC_COMMON_IMAGE_CACHE_STORE;
+
+}
+
+/**
+ * Sends the image stored within the given entry to the given user over the
+ * given socket, replacing the contents of the entry's buffer.
+ *
+ * @param entry
+ *     The entry whose image should be sent.
+ *
+ * @param user
+ *     The user receiving the image.
+ *
+ * @param socket
+ *     The socket over which the image should be sent.
+ */
+static void guac_common_image_cache_send_entry(
+        guac_common_image_cache_entry* entry, guac_user* user,
+        guac_socket* socket) {
+
+    guac_protocol_send_size(socket, entry->buffer,
+            cairo_image_surface_get_width(entry->image),
+            cairo_image_surface_get_height(entry->image));
+
+    guac_user_stream_png(user, socket, GUAC_COMP_SRC, entry->buffer, 0, 0,
+            entry->image);
+
+}
+
+void guac_common_image_cache_dup(guac_common_image_cache* cache,
+        guac_user* user, guac_socket* socket) {
+
+    guac_common_image_cache_resync(cache, user, socket, 0);
+
+}
+
+void guac_common_image_cache_resync(guac_common_image_cache* cache,
+        guac_user* user, guac_socket* socket, guac_timestamp since) {
+
+    pthread_mutex_lock(&cache->_lock);
+
+    /* Send all images stored since the given frame */
+    guac_common_image_cache_entry* current = cache->newest;
+    while (current != NULL) {
+
+        if (current->frame >= since)
+            guac_common_image_cache_send_entry(current, user, socket);
+
+        current = current->older;
+
+    }
+
+    pthread_mutex_unlock(&cache->_lock);
+
+}
+
@@ -0,0 +1,908 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/pixel.h"
+#include "common/rect.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/**
+ * Tracks which pixels of a rectangle have changed, as a row at a time is
+ * processed by a put kernel.
+ */
+typedef struct guac_common_pixel_bounds {
+
+    /**
+     * The leftmost changed column, or the width of the rectangle if no
+     * pixels have changed.
+     */
+    int min_x;
+
+    /**
+     * The topmost changed row, or the height of the rectangle if no pixels
+     * have changed.
+     */
+    int min_y;
+
+    /**
+     * The rightmost changed column.
+     */
+    int max_x;
+
+    /**
+     * The bottommost changed row.
+     */
+    int max_y;
+
+} guac_common_pixel_bounds;
+
+/**
+ * Initializes the given bounds such that no pixels of a rectangle having the
+ * given dimensions are considered changed.
+ *
+ * @param bounds
+ *     The bounds to initialize.
+ *
+ * @param width
+ *     The width of the rectangle, in pixels.
+ *
+ * @param height
+ *     The height of the rectangle, in pixels.
+ */
+static void guac_common_pixel_bounds_init(guac_common_pixel_bounds* bounds,
+        int width, int height) {
+    bounds->min_x = width;
+    bounds->min_y = height;
+    bounds->max_x = 0;
+    bounds->max_y = 0;
+}
+
+/**
+ * Records that the pixels of the given row between the given columns,
+ * inclusive, include all changed pixels of that row. If first is negative,
+ * no pixels of the row changed.
+ *
+ * @param bounds
+ *     The bounds to update.
+ *
+ * @param y
+ *     The row being recorded.
+ *
+ * @param first
+ *     The leftmost changed column of the row, or a negative value if no
+ *     pixels of the row changed.
+ *
+ * @param last
+ *     The rightmost changed column of the row.
+ */
+static void guac_common_pixel_bounds_add_row(guac_common_pixel_bounds* bounds,
+        int y, int first, int last) {
+
+    if (first < 0)
+        return;
+
+    if (first < bounds->min_x) bounds->min_x = first;
+    if (last > bounds->max_x) bounds->max_x = last;
+    if (y < bounds->min_y) bounds->min_y = y;
+    if (y > bounds->max_y) bounds->max_y = y;
+
+}
+
+/**
+ * Stores the given bounds within the given rectangle.
+ *
+ * @param bounds
+ *     The bounds of all changed pixels.
+ *
+ * @param changed
+ *     The rectangle which should receive the bounds of all changed pixels,
+ *     or a width and height of zero if no pixels changed.
+ */
+static void guac_common_pixel_bounds_store(
+        const guac_common_pixel_bounds* bounds, guac_common_rect* changed) {
+
+    if (bounds->max_x >= bounds->min_x && bounds->max_y >= bounds->min_y)
+        guac_common_rect_init(changed, bounds->min_x, bounds->min_y,
+                bounds->max_x - bounds->min_x + 1,
+                bounds->max_y - bounds->min_y + 1);
+    else
+        guac_common_rect_init(changed, 0, 0, 0, 0);
+
+}
+
+/**
+ * Returns the result of applying the Porter-Duff "over" composite operator
+ * to the given source and destination components, assuming pre-multiplied
+ * alpha.
+ *
+ * @param dst
+ *     The destination component.
+ *
+ * @param src
+ *     The source component.
+ *
+ * @param alpha
+ *     The alpha component of the source color.
+ *
+ * @return
+ *     The result of applying the Porter-Duff "over" composite operator to the
+ *     given source and destination components.
+ */
+static int guac_common_pixel_blend_component(int dst, int src, int alpha) {
+
+    int blended = src + dst * (0xFF - alpha);
+
+    /* Do not exceed maximum component value */
+    if (blended > 0xFF)
+        return 0xFF;
+
+    return blended;
+
+}
+
+/**
+ * Applies the Porter-Duff "over" composite operator, blending each component
+ * of the two given ARGB colors.
+ *
+ * @param dst
+ *     The destination ARGB color.
+ *
+ * @param src
+ *     The source ARGB color.
+ *
+ * @return
+ *     The result of applying the Porter-Duff "over" composite operator to the
+ *     given source and destination colors.
+ */
+static uint32_t guac_common_pixel_argb_blend(uint32_t dst, uint32_t src) {
+
+    /* Separate destination ARGB color into its components */
+    int dst_a = (dst >> 24) & 0xFF;
+    int dst_r = (dst >> 16) & 0xFF;
+    int dst_g = (dst >>  8) & 0xFF;
+    int dst_b =  dst        & 0xFF;
+
+    /* Separate source ARGB color into its components */
+    int src_a = (src >> 24) & 0xFF;
+    int src_r = (src >> 16) & 0xFF;
+    int src_g = (src >>  8) & 0xFF;
+    int src_b =  src        & 0xFF;
+
+    /* If source is fully opaque (or destination is fully transparent), the
+     * blended result is the source */
+    if (src_a == 0xFF || dst_a == 0x00)
+        return src;
+
+    /* If source is fully transparent, the blended result is the destination */
+    if (src_a == 0x00)
+        return dst;
+
+    /* Otherwise, blend each ARGB component, assuming pre-multiplied alpha */
+    int r = guac_common_pixel_blend_component(dst_r, src_r, src_a);
+    int g = guac_common_pixel_blend_component(dst_g, src_g, src_a);
+    int b = guac_common_pixel_blend_component(dst_b, src_b, src_a);
+    int a = guac_common_pixel_blend_component(dst_a, src_a, src_a);
+
+    /* Recombine blended components */
+    return ((uint32_t) a << 24) | (r << 16) | (g << 8) | b;
+
+}
+
+/**
+ * Copies or blends the given pixels of a single row, one pixel at a time,
+ * updating the given range of changed columns.
+ *
+ * @param src
+ *     The source pixels.
+ *
+ * @param dst
+ *     The destination pixels.
+ *
+ * @param start
+ *     The first column to process.
+ *
+ * @param width
+ *     The total number of columns within the row.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the source pixels should be ignored,
+ *     zero otherwise.
+ *
+ * @param first
+ *     Pointer to the leftmost changed column of the row, or a negative value
+ *     if no pixels of the row have yet changed.
+ *
+ * @param last
+ *     Pointer to the rightmost changed column of the row.
+ */
+static void guac_common_pixel_put_row_scalar(const uint32_t* src,
+        uint32_t* dst, int start, int width, int opaque,
+        int* first, int* last) {
+
+    for (int x = start; x < width; x++) {
+
+        uint32_t color;
+
+        /* Get source and destination color values */
+        uint32_t src_color = src[x];
+        uint32_t dst_color = dst[x];
+
+        /* Ignore alpha channel if opaque */
+        if (opaque)
+            color = src_color | 0xFF000000;
+
+        /* Otherwise, perform alpha blending operation */
+        else
+            color = guac_common_pixel_argb_blend(dst_color, src_color);
+
+        /* If the destination color is changing, update bounds and store the
+         * new color */
+        if (dst_color != color) {
+            if (*first < 0) *first = x;
+            *last = x;
+            dst[x] = color;
+        }
+
+    }
+
+}
+
+/**
+ * Scalar implementation of guac_common_pixel_put_function.
+ */
+static void guac_common_pixel_put_scalar(const unsigned char* src,
+        int src_stride, unsigned char* dst, int dst_stride, int width,
+        int height, int opaque, guac_common_rect* changed) {
+
+    guac_common_pixel_bounds bounds;
+    guac_common_pixel_bounds_init(&bounds, width, height);
+
+    for (int y = 0; y < height; y++) {
+
+        int first = -1;
+        int last = -1;
+
+        guac_common_pixel_put_row_scalar((const uint32_t*) src,
+                (uint32_t*) dst, 0, width, opaque, &first, &last);
+
+        guac_common_pixel_bounds_add_row(&bounds, y, first, last);
+
+        src += src_stride;
+        dst += dst_stride;
+
+    }
+
+    guac_common_pixel_bounds_store(&bounds, changed);
+
+}
+
+/**
+ * Scalar implementation of guac_common_pixel_is_opaque_function.
+ */
+static int guac_common_pixel_is_opaque_scalar(const unsigned char* buffer,
+        int stride, int width, int height) {
+
+    for (int y = 0; y < height; y++) {
+
+        /* Rectangle is non-opaque if a single non-opaque pixel is found */
+        const uint32_t* current = (const uint32_t*) buffer;
+        for (int x = 0; x < width; x++) {
+            if ((current[x] & 0xFF000000) != 0xFF000000)
+                return 0;
+        }
+
+        buffer += stride;
+
+    }
+
+    /* Rectangle is opaque */
+    return 1;
+
+}
+
+/**
+ * Converts counts of identical and differing horizontally-adjacent pixels
+ * into an approximation of how well an image will compress as PNG.
+ *
+ * @param num_same
+ *     The number of pixels identical to the pixel to their left.
+ *
+ * @param num_different
+ *     The number of pixels differing from the pixel to their left, plus one.
+ *
+ * @return
+ *     Positive values if PNG compression is likely to perform better than
+ *     lossy alternatives, or negative values if PNG is likely to perform
+ *     worse.
+ */
+static int guac_common_pixel_png_optimality_result(int num_same,
+        int num_different) {
+    return 0x100 * num_same / num_different - 0x400;
+}
+
+/**
+ * Scalar implementation of guac_common_pixel_png_optimality_function.
+ */
+static int guac_common_pixel_png_optimality_scalar(
+        const unsigned char* buffer, int stride, int width, int height) {
+
+    int num_same = 0;
+    int num_different = 1;
+
+    /* Image must be at least 1x1 */
+    if (width < 1 || height < 1)
+        return 0;
+
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* row = (const uint32_t*) buffer;
+        uint32_t last_pixel = row[0] | 0xFF000000;
+
+        /* Update same/different counts according to pixel value */
+        for (int x = 1; x < width; x++) {
+
+            uint32_t current_pixel = row[x] | 0xFF000000;
+            if (current_pixel == last_pixel)
+                num_same++;
+            else
+                num_different++;
+
+            last_pixel = current_pixel;
+
+        }
+
+        buffer += stride;
+
+    }
+
+    return guac_common_pixel_png_optimality_result(num_same, num_different);
+
+}
+
+/**
+ * Returns non-zero, indicating that the scalar implementations are always
+ * supported.
+ *
+ * @return
+ *     Always non-zero.
+ */
+static int guac_common_pixel_supported_scalar(void) {
+    return 1;
+}
+
+/**
+ * Portable implementations of all pixel kernels, processing one pixel at a
+ * time.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_kernels_scalar = {
+    .name           = "scalar",
+    .supported      = guac_common_pixel_supported_scalar,
+    .put            = guac_common_pixel_put_scalar,
+    .is_opaque      = guac_common_pixel_is_opaque_scalar,
+    .png_optimality = guac_common_pixel_png_optimality_scalar
+};
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * Blends four ARGB source pixels over four ARGB destination pixels exactly as
+ * guac_common_pixel_argb_blend() would.
+ *
+ * @param dst
+ *     The destination pixels.
+ *
+ * @param src
+ *     The source pixels.
+ *
+ * @return
+ *     The blended pixels.
+ */
+__attribute__((target("sse4.1")))
+static __m128i guac_common_pixel_blend_sse41(__m128i dst, __m128i src) {
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(0xFF);
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+
+    /* Copy the source alpha of each pixel into all of its components */
+    __m128i src_alpha = _mm_shuffle_epi8(src, _mm_setr_epi8(
+                3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15));
+
+    /* Widen components to 16 bits */
+    __m128i dst_lo = _mm_unpacklo_epi8(dst, zero);
+    __m128i dst_hi = _mm_unpackhi_epi8(dst, zero);
+    __m128i src_lo = _mm_unpacklo_epi8(src, zero);
+    __m128i src_hi = _mm_unpackhi_epi8(src, zero);
+    __m128i inv_lo = _mm_sub_epi16(max, _mm_unpacklo_epi8(src_alpha, zero));
+    __m128i inv_hi = _mm_sub_epi16(max, _mm_unpackhi_epi8(src_alpha, zero));
+
+    /* src + dst * (0xFF - alpha), which cannot exceed 16 bits, clamped */
+    __m128i lo = _mm_min_epu16(_mm_add_epi16(src_lo,
+                _mm_mullo_epi16(dst_lo, inv_lo)), max);
+    __m128i hi = _mm_min_epu16(_mm_add_epi16(src_hi,
+                _mm_mullo_epi16(dst_hi, inv_hi)), max);
+
+    __m128i blended = _mm_packus_epi16(lo, hi);
+
+    /* Transparent source leaves destination untouched, while transparent
+     * destination is replaced by the source (taking precedence) */
+    __m128i src_clear = _mm_cmpeq_epi32(_mm_and_si128(src, alpha_mask), zero);
+    __m128i dst_clear = _mm_cmpeq_epi32(_mm_and_si128(dst, alpha_mask), zero);
+
+    blended = _mm_blendv_epi8(blended, dst, src_clear);
+    return _mm_blendv_epi8(blended, src, dst_clear);
+
+}
+
+/**
+ * SSE4.1 implementation of guac_common_pixel_put_function.
+ */
+__attribute__((target("sse4.1")))
+static void guac_common_pixel_put_sse41(const unsigned char* src,
+        int src_stride, unsigned char* dst, int dst_stride, int width,
+        int height, int opaque, guac_common_rect* changed) {
+
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+
+    guac_common_pixel_bounds bounds;
+    guac_common_pixel_bounds_init(&bounds, width, height);
+
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* src_row = (const uint32_t*) src;
+        uint32_t* dst_row = (uint32_t*) dst;
+
+        int first = -1;
+        int last = -1;
+        int x;
+
+        for (x = 0; x + 4 <= width; x += 4) {
+
+            __m128i src_pixels = _mm_loadu_si128((const __m128i*) &src_row[x]);
+            __m128i dst_pixels = _mm_loadu_si128((const __m128i*) &dst_row[x]);
+
+            __m128i color = opaque
+                ? _mm_or_si128(src_pixels, alpha_mask)
+                : guac_common_pixel_blend_sse41(dst_pixels, src_pixels);
+
+            /* One bit per pixel which is changing */
+            int mask = ~_mm_movemask_ps(_mm_castsi128_ps(
+                        _mm_cmpeq_epi32(color, dst_pixels))) & 0xF;
+
+            /* Unchanged pixels are rewritten with their own value */
+            if (mask) {
+                _mm_storeu_si128((__m128i*) &dst_row[x], color);
+                if (first < 0) first = x + __builtin_ctz(mask);
+                last = x + 31 - __builtin_clz(mask);
+            }
+
+        }
+
+        guac_common_pixel_put_row_scalar(src_row, dst_row, x, width, opaque,
+                &first, &last);
+
+        guac_common_pixel_bounds_add_row(&bounds, y, first, last);
+
+        src += src_stride;
+        dst += dst_stride;
+
+    }
+
+    guac_common_pixel_bounds_store(&bounds, changed);
+
+}
+
+/**
+ * SSE4.1 implementation of guac_common_pixel_is_opaque_function.
+ */
+__attribute__((target("sse4.1")))
+static int guac_common_pixel_is_opaque_sse41(const unsigned char* buffer,
+        int stride, int width, int height) {
+
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* row = (const uint32_t*) buffer;
+        __m128i all = alpha_mask;
+        int x;
+
+        /* Combine alpha of all pixels, which remains 0xFF only if opaque */
+        for (x = 0; x + 4 <= width; x += 4)
+            all = _mm_and_si128(all,
+                    _mm_loadu_si128((const __m128i*) &row[x]));
+
+        if (!_mm_testc_si128(all, alpha_mask))
+            return 0;
+
+        for (; x < width; x++) {
+            if ((row[x] & 0xFF000000) != 0xFF000000)
+                return 0;
+        }
+
+        buffer += stride;
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * SSE4.1 implementation of guac_common_pixel_png_optimality_function.
+ */
+__attribute__((target("sse4.1")))
+static int guac_common_pixel_png_optimality_sse41(
+        const unsigned char* buffer, int stride, int width, int height) {
+
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+
+    int num_same = 0;
+
+    /* Image must be at least 1x1 */
+    if (width < 1 || height < 1)
+        return 0;
+
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* row = (const uint32_t*) buffer;
+        __m128i same = _mm_setzero_si128();
+        int x;
+
+        /* Compare each pixel with the pixel to its left, counting matches
+         * per lane (each match is -1) */
+        for (x = 1; x + 4 <= width; x += 4) {
+
+            __m128i current = _mm_or_si128(alpha_mask,
+                    _mm_loadu_si128((const __m128i*) &row[x]));
+            __m128i previous = _mm_or_si128(alpha_mask,
+                    _mm_loadu_si128((const __m128i*) &row[x - 1]));
+
+            same = _mm_sub_epi32(same, _mm_cmpeq_epi32(current, previous));
+
+        }
+
+        /* Sum per-lane counts */
+        same = _mm_add_epi32(same, _mm_shuffle_epi32(same, 0x4E));
+        same = _mm_add_epi32(same, _mm_shuffle_epi32(same, 0xB1));
+        num_same += _mm_cvtsi128_si32(same);
+
+        for (; x < width; x++) {
+            if ((row[x] | 0xFF000000) == (row[x - 1] | 0xFF000000))
+                num_same++;
+        }
+
+        buffer += stride;
+
+    }
+
+    /* Every pixel but the first of each row is either same or different */
+    int num_different = 1 + (width - 1) * height - num_same;
+    return guac_common_pixel_png_optimality_result(num_same, num_different);
+
+}
+
+/**
+ * Returns whether the current CPU supports SSE4.1.
+ *
+ * @return
+ *     Non-zero if SSE4.1 is supported, zero otherwise.
+ */
+static int guac_common_pixel_supported_sse41(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+/**
+ * Implementations of all pixel kernels using SSE4.1, processing four pixels
+ * at a time.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_kernels_sse41 = {
+    .name           = "sse4.1",
+    .supported      = guac_common_pixel_supported_sse41,
+    .put            = guac_common_pixel_put_sse41,
+    .is_opaque      = guac_common_pixel_is_opaque_sse41,
+    .png_optimality = guac_common_pixel_png_optimality_sse41
+};
+
+/**
+ * Blends eight ARGB source pixels over eight ARGB destination pixels exactly
+ * as guac_common_pixel_argb_blend() would.
+ *
+ * @param dst
+ *     The destination pixels.
+ *
+ * @param src
+ *     The source pixels.
+ *
+ * @return
+ *     The blended pixels.
+ */
+__attribute__((target("avx2")))
+static __m256i guac_common_pixel_blend_avx2(__m256i dst, __m256i src) {
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(0xFF);
+    const __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+
+    /* Copy the source alpha of each pixel into all of its components (the
+     * shuffle operates within each 128-bit lane) */
+    __m256i src_alpha = _mm256_shuffle_epi8(src, _mm256_setr_epi8(
+                3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15,
+                3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15));
+
+    /* Widen components to 16 bits (within each 128-bit lane, matching the
+     * lane-wise behavior of the final pack) */
+    __m256i dst_lo = _mm256_unpacklo_epi8(dst, zero);
+    __m256i dst_hi = _mm256_unpackhi_epi8(dst, zero);
+    __m256i src_lo = _mm256_unpacklo_epi8(src, zero);
+    __m256i src_hi = _mm256_unpackhi_epi8(src, zero);
+    __m256i inv_lo = _mm256_sub_epi16(max,
+            _mm256_unpacklo_epi8(src_alpha, zero));
+    __m256i inv_hi = _mm256_sub_epi16(max,
+            _mm256_unpackhi_epi8(src_alpha, zero));
+
+    /* src + dst * (0xFF - alpha), which cannot exceed 16 bits, clamped */
+    __m256i lo = _mm256_min_epu16(_mm256_add_epi16(src_lo,
+                _mm256_mullo_epi16(dst_lo, inv_lo)), max);
+    __m256i hi = _mm256_min_epu16(_mm256_add_epi16(src_hi,
+                _mm256_mullo_epi16(dst_hi, inv_hi)), max);
+
+    __m256i blended = _mm256_packus_epi16(lo, hi);
+
+    /* Transparent source leaves destination untouched, while transparent
+     * destination is replaced by the source (taking precedence) */
+    __m256i src_clear = _mm256_cmpeq_epi32(
+            _mm256_and_si256(src, alpha_mask), zero);
+    __m256i dst_clear = _mm256_cmpeq_epi32(
+            _mm256_and_si256(dst, alpha_mask), zero);
+
+    blended = _mm256_blendv_epi8(blended, dst, src_clear);
+    return _mm256_blendv_epi8(blended, src, dst_clear);
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_put_function.
+ */
+__attribute__((target("avx2")))
+static void guac_common_pixel_put_avx2(const unsigned char* src,
+        int src_stride, unsigned char* dst, int dst_stride, int width,
+        int height, int opaque, guac_common_rect* changed) {
+
+    const __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+
+    guac_common_pixel_bounds bounds;
+    guac_common_pixel_bounds_init(&bounds, width, height);
+
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* src_row = (const uint32_t*) src;
+        uint32_t* dst_row = (uint32_t*) dst;
+
+        int first = -1;
+        int last = -1;
+        int x;
+
+        for (x = 0; x + 8 <= width; x += 8) {
+
+            __m256i src_pixels = _mm256_loadu_si256(
+                    (const __m256i*) &src_row[x]);
+            __m256i dst_pixels = _mm256_loadu_si256(
+                    (const __m256i*) &dst_row[x]);
+
+            __m256i color = opaque
+                ? _mm256_or_si256(src_pixels, alpha_mask)
+                : guac_common_pixel_blend_avx2(dst_pixels, src_pixels);
+
+            /* One bit per pixel which is changing */
+            int mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(
+                        _mm256_cmpeq_epi32(color, dst_pixels))) & 0xFF;
+
+            /* Unchanged pixels are rewritten with their own value */
+            if (mask) {
+                _mm256_storeu_si256((__m256i*) &dst_row[x], color);
+                if (first < 0) first = x + __builtin_ctz(mask);
+                last = x + 31 - __builtin_clz(mask);
+            }
+
+        }
+
+        guac_common_pixel_put_row_scalar(src_row, dst_row, x, width, opaque,
+                &first, &last);
+
+        guac_common_pixel_bounds_add_row(&bounds, y, first, last);
+
+        src += src_stride;
+        dst += dst_stride;
+
+    }
+
+    guac_common_pixel_bounds_store(&bounds, changed);
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_is_opaque_function.
+ */
+__attribute__((target("avx2")))
+static int guac_common_pixel_is_opaque_avx2(const unsigned char* buffer,
+        int stride, int width, int height) {
+
+    const __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* row = (const uint32_t*) buffer;
+        __m256i all = alpha_mask;
+        int x;
+
+        /* Combine alpha of all pixels, which remains 0xFF only if opaque */
+        for (x = 0; x + 8 <= width; x += 8)
+            all = _mm256_and_si256(all,
+                    _mm256_loadu_si256((const __m256i*) &row[x]));
+
+        if (!_mm256_testc_si256(all, alpha_mask))
+            return 0;
+
+        for (; x < width; x++) {
+            if ((row[x] & 0xFF000000) != 0xFF000000)
+                return 0;
+        }
+
+        buffer += stride;
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_png_optimality_function.
+ */
+__attribute__((target("avx2")))
+static int guac_common_pixel_png_optimality_avx2(
+        const unsigned char* buffer, int stride, int width, int height) {
+
+    const __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+
+    int num_same = 0;
+
+    /* Image must be at least 1x1 */
+    if (width < 1 || height < 1)
+        return 0;
+
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* row = (const uint32_t*) buffer;
+        __m256i same = _mm256_setzero_si256();
+        int x;
+
+        /* Compare each pixel with the pixel to its left, counting matches
+         * per lane (each match is -1) */
+        for (x = 1; x + 8 <= width; x += 8) {
+
+            __m256i current = _mm256_or_si256(alpha_mask,
+                    _mm256_loadu_si256((const __m256i*) &row[x]));
+            __m256i previous = _mm256_or_si256(alpha_mask,
+                    _mm256_loadu_si256((const __m256i*) &row[x - 1]));
+
+            same = _mm256_sub_epi32(same,
+                    _mm256_cmpeq_epi32(current, previous));
+
+        }
+
+        /* Sum per-lane counts */
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(same),
+                _mm256_extracti128_si256(same, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        num_same += _mm_cvtsi128_si32(sum);
+
+        for (; x < width; x++) {
+            if ((row[x] | 0xFF000000) == (row[x - 1] | 0xFF000000))
+                num_same++;
+        }
+
+        buffer += stride;
+
+    }
+
+    /* Every pixel but the first of each row is either same or different */
+    int num_different = 1 + (width - 1) * height - num_same;
+    return guac_common_pixel_png_optimality_result(num_same, num_different);
+
+}
+
+/**
+ * Returns whether the current CPU supports AVX2.
+ *
+ * @return
+ *     Non-zero if AVX2 is supported, zero otherwise.
+ */
+static int guac_common_pixel_supported_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+/**
+ * Implementations of all pixel kernels using AVX2, processing eight pixels
+ * at a time.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_kernels_avx2 = {
+    .name           = "avx2",
+    .supported      = guac_common_pixel_supported_avx2,
+    .put            = guac_common_pixel_put_avx2,
+    .is_opaque      = guac_common_pixel_is_opaque_avx2,
+    .png_optimality = guac_common_pixel_png_optimality_avx2
+};
+
+#endif
+
+const guac_common_pixel_kernels* const GUAC_COMMON_PIXEL_KERNELS[] = {
+    &guac_common_pixel_kernels_scalar,
+#ifdef HAVE_X86_SIMD
+    &guac_common_pixel_kernels_sse41,
+    &guac_common_pixel_kernels_avx2,
+#endif
+    NULL
+};
+
+/**
+ * The most preferable set of pixel kernel implementations supported by the
+ * current CPU, as chosen by guac_common_pixel_kernels_init().
+ */
+static const guac_common_pixel_kernels* guac_common_pixel_kernels_selected;
+
+/**
+ * Guards the one-time choice of pixel kernel implementations.
+ */
+static pthread_once_t guac_common_pixel_kernels_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Chooses the most preferable set of pixel kernel implementations supported
+ * by the current CPU, storing that choice within
+ * guac_common_pixel_kernels_selected.
+ */
+static void guac_common_pixel_kernels_init(void) {
+
+    const guac_common_pixel_kernels* const* current = GUAC_COMMON_PIXEL_KERNELS;
+
+    /* Later entries are preferred */
+    for (; *current != NULL; current++) {
+        if ((*current)->supported())
+            guac_common_pixel_kernels_selected = *current;
+    }
+
+}
+
+const guac_common_pixel_kernels* guac_common_pixel_kernels_select() {
+    pthread_once(&guac_common_pixel_kernels_once,
+            guac_common_pixel_kernels_init);
+    return guac_common_pixel_kernels_selected;
+}
+
@@ -0,0 +1,244 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/quality-controller.h"
+
+#include <guacamole/client.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * The state of a measurement of congestion across all users of a client,
+ * populated by guac_common_quality_controller_measure_user().
+ */
+typedef struct guac_common_quality_measurement {
+
+    /**
+     * Whether users which have frames skipped should be ignored.
+     */
+    int skips_frames;
+
+    /**
+     * The largest delay measured so far, in milliseconds.
+     */
+    int delay;
+
+} guac_common_quality_measurement;
+
+/**
+ * Callback for guac_client_foreach_user() which measures the delay currently
+ * experienced by data sent to the given user, updating the given measurement
+ * if that delay is the largest measured so far. The delay is the largest of
+ * the time needed to drain the user's send queue at their measured
+ * throughput, the increase of their sync round-trip time above its baseline,
+ * and their processing lag.
+ *
+ * @param user
+ *     The user to measure.
+ *
+ * @param data
+ *     A pointer to the guac_common_quality_measurement to update.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_common_quality_controller_measure_user(guac_user* user,
+        void* data) {
+
+    guac_common_quality_measurement* measurement =
+        (guac_common_quality_measurement*) data;
+
+    /* Ignore users that are having frames skipped, as they do not hold back
+     * other users */
+    if (measurement->skips_frames
+            && user->processing_lag > GUAC_CLIENT_FRAME_SKIP_LAG)
+        return NULL;
+
+    int delay = user->processing_lag;
+
+    /* The statistics below are updated concurrently by the user's input
+     * thread, and are read atomically */
+    int sync_rtt = __atomic_load_n(&user->sync_rtt, __ATOMIC_RELAXED);
+    int min_sync_rtt = __atomic_load_n(&user->min_sync_rtt, __ATOMIC_RELAXED);
+    int queued = __atomic_load_n(&user->queued, __ATOMIC_RELAXED);
+    int throughput = __atomic_load_n(&user->throughput, __ATOMIC_RELAXED);
+
+    /* Include delay caused by round trips lengthening beyond baseline */
+    int rtt_delay = sync_rtt - min_sync_rtt;
+    if (min_sync_rtt > 0 && rtt_delay > delay)
+        delay = rtt_delay;
+
+    /* Include time needed to deliver data already queued */
+    if (queued > 0 && throughput > 0) {
+        int queue_delay = (int) ((int64_t) queued * 1000 / throughput);
+        if (queue_delay > delay)
+            delay = queue_delay;
+    }
+
+    if (delay > measurement->delay)
+        measurement->delay = delay;
+
+    return NULL;
+
+}
+
+/**
+ * Derives all encoding parameters other than quality from the quality
+ * stored within the given parameters, scaling each parameter linearly
+ * between its uncongested and most congested values.
+ *
+ * @param params
+ *     The encoding parameters to update.
+ */
+static void guac_common_quality_controller_derive(
+        guac_common_quality_params* params) {
+
+    int range = GUAC_COMMON_QUALITY_MAX - GUAC_COMMON_QUALITY_MIN;
+    int reduction = GUAC_COMMON_QUALITY_MAX - params->quality;
+
+    /* Lower the framerate at which lossy formats are preferred from its
+     * usual value down to 1 fps */
+    params->lossy_framerate = GUAC_COMMON_QUALITY_LOSSY_FRAMERATE
+        - ((GUAC_COMMON_QUALITY_LOSSY_FRAMERATE - 1) * reduction + range / 2)
+            / range;
+
+    /* Lengthen frames to combine more updates per frame */
+    params->frame_duration =
+        GUAC_COMMON_QUALITY_MAX_FRAME_DURATION * reduction / range;
+
+    /* Spend up to two additional WebP methods on smaller images */
+    params->webp_method = GUAC_COMMON_QUALITY_WEBP_METHOD
+        + (2 * reduction + range / 2) / range;
+
+    /* Likewise compress PNG images harder */
+    params->png_compression = GUAC_COMMON_QUALITY_PNG_COMPRESSION
+        + ((GUAC_COMMON_QUALITY_MAX_PNG_COMPRESSION
+                    - GUAC_COMMON_QUALITY_PNG_COMPRESSION) * reduction
+                + range / 2) / range;
+
+}
+
+guac_common_quality_controller* guac_common_quality_controller_alloc(
+        guac_client* client) {
+
+    guac_common_quality_controller* controller =
+        malloc(sizeof(guac_common_quality_controller));
+
+    if (controller == NULL)
+        return NULL;
+
+    controller->client = client;
+    controller->last_update = 0;
+
+    /* Assume no congestion until measured otherwise */
+    controller->params.quality = GUAC_COMMON_QUALITY_MAX;
+    guac_common_quality_controller_derive(&controller->params);
+
+    pthread_mutex_init(&controller->_lock, NULL);
+
+    return controller;
+
+}
+
+void guac_common_quality_controller_free(
+        guac_common_quality_controller* controller) {
+
+    pthread_mutex_destroy(&controller->_lock);
+    free(controller);
+
+}
+
+void guac_common_quality_controller_update(
+        guac_common_quality_controller* controller) {
+
+    /* Do not adjust more often than new measurements can arrive */
+    guac_timestamp current = guac_timestamp_current();
+    if (current - controller->last_update < GUAC_COMMON_QUALITY_INTERVAL)
+        return;
+
+    controller->last_update = current;
+
+    guac_common_quality_measurement measurement = {
+        .skips_frames = guac_client_skips_frames(controller->client),
+        .delay = 0
+    };
+
+    guac_client_foreach_user(controller->client,
+            guac_common_quality_controller_measure_user, &measurement);
+
+    guac_common_quality_controller_adjust(controller, measurement.delay);
+
+}
+
+void guac_common_quality_controller_adjust(
+        guac_common_quality_controller* controller, int delay) {
+
+    pthread_mutex_lock(&controller->_lock);
+
+    guac_common_quality_params* params = &controller->params;
+    int quality = params->quality;
+
+    /* Back off quickly while congested */
+    if (delay > GUAC_COMMON_QUALITY_CONGESTED_DELAY) {
+        quality = quality * 3 / 4;
+        if (quality < GUAC_COMMON_QUALITY_MIN)
+            quality = GUAC_COMMON_QUALITY_MIN;
+    }
+
+    /* Recover gradually once clear */
+    else if (delay < GUAC_COMMON_QUALITY_CLEAR_DELAY) {
+        quality += GUAC_COMMON_QUALITY_INCREASE;
+        if (quality > GUAC_COMMON_QUALITY_MAX)
+            quality = GUAC_COMMON_QUALITY_MAX;
+    }
+
+    /* Otherwise, hold steady */
+    if (quality != params->quality) {
+
+        params->quality = quality;
+        guac_common_quality_controller_derive(params);
+
+        guac_client_log(controller->client, GUAC_LOG_DEBUG, "Encoding "
+                "parameters adjusted for %ims delay: quality=%i, "
+                "lossy_framerate=%ifps, frame_duration=%ims, "
+                "webp_method=%i, png_compression=%i", delay,
+                params->quality, params->lossy_framerate,
+                params->frame_duration, params->webp_method,
+                params->png_compression);
+
+    }
+
+    pthread_mutex_unlock(&controller->_lock);
+
+}
+
+void guac_common_quality_controller_get(
+        guac_common_quality_controller* controller,
+        guac_common_quality_params* params) {
+
+    pthread_mutex_lock(&controller->_lock);
+    *params = controller->params;
+    pthread_mutex_unlock(&controller->_lock);
+
+}
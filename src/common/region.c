@@ -0,0 +1,264 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/rect.h"
+#include "common/region.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+guac_common_region* guac_common_region_alloc() {
+
+    guac_common_region* region = malloc(sizeof(guac_common_region));
+    if (region == NULL)
+        return NULL;
+
+    region->size = GUAC_COMMON_REGION_INITIAL_SIZE;
+    region->rects = malloc(sizeof(guac_common_rect) * region->size);
+    region->count = 0;
+
+    if (region->rects == NULL) {
+        free(region);
+        return NULL;
+    }
+
+    return region;
+
+}
+
+void guac_common_region_free(guac_common_region* region) {
+    free(region->rects);
+    free(region);
+}
+
+void guac_common_region_add(guac_common_region* region,
+        const guac_common_rect* rect) {
+
+    /* Ignore empty rects */
+    if (rect->width <= 0 || rect->height <= 0)
+        return;
+
+    /* Double available space if full */
+    if (region->count == region->size) {
+
+        guac_common_rect* rects = realloc(region->rects,
+                sizeof(guac_common_rect) * region->size * 2);
+
+        /* If space cannot be allocated, fall back to a single rect covering
+         * the entire region, which is larger but still correct */
+        if (rects == NULL) {
+
+            guac_common_rect bounds = *rect;
+            for (int i = 0; i < region->count; i++)
+                guac_common_rect_extend(&bounds, &region->rects[i]);
+
+            region->rects[0] = bounds;
+            region->count = 1;
+            return;
+
+        }
+
+        region->rects = rects;
+        region->size *= 2;
+
+    }
+
+    region->rects[region->count++] = *rect;
+
+}
+
+void guac_common_region_clear(guac_common_region* region) {
+    region->count = 0;
+}
+
+void guac_common_region_clip(guac_common_region* region,
+        const guac_common_rect* bounds) {
+
+    int count = 0;
+
+    for (int i = 0; i < region->count; i++) {
+
+        guac_common_rect rect = region->rects[i];
+        guac_common_rect_constrain(&rect, bounds);
+
+        /* Retain only rects still within bounds */
+        if (rect.width > 0 && rect.height > 0)
+            region->rects[count++] = rect;
+
+    }
+
+    region->count = count;
+
+}
+
+/**
+ * Comparator for instances of guac_common_rect, ordering rectangles from top
+ * to bottom and left to right.
+ *
+ * @see qsort
+ */
+static int __guac_common_region_rect_compare(const void* a, const void* b) {
+
+    const guac_common_rect* ra = (const guac_common_rect*) a;
+    const guac_common_rect* rb = (const guac_common_rect*) b;
+
+    /* Order roughly top to bottom, left to right */
+    if (ra->y != rb->y) return ra->y - rb->y;
+    if (ra->x != rb->x) return ra->x - rb->x;
+
+    /* Wider rects should come first (more likely to intersect later) */
+    if (ra->width != rb->width) return rb->width - ra->width;
+
+    /* Shorter rects should come first (less likely to increase cost) */
+    return ra->height - rb->height;
+
+}
+
+/**
+ * Returns the area of the given rectangle, in pixels.
+ *
+ * @param rect
+ *     The rectangle to calculate the area of.
+ *
+ * @return
+ *     The area of the given rectangle.
+ */
+static int __guac_common_region_area(const guac_common_rect* rect) {
+    return rect->width * rect->height;
+}
+
+/**
+ * Returns whether the given rectangle lies entirely within the given
+ * container.
+ *
+ * @param container
+ *     The rectangle which may contain the other rectangle.
+ *
+ * @param rect
+ *     The rectangle to test.
+ *
+ * @return
+ *     Non-zero if the given rectangle lies entirely within the container,
+ *     zero otherwise.
+ */
+static int __guac_common_region_contains(const guac_common_rect* container,
+        const guac_common_rect* rect) {
+    return rect->x >= container->x
+        && rect->y >= container->y
+        && rect->x + rect->width  <= container->x + container->width
+        && rect->y + rect->height <= container->y + container->height;
+}
+
+/**
+ * Makes a single pass over the given region, combining each rectangle with
+ * the best of the preceding GUAC_COMMON_REGION_COMBINE_WINDOW combined
+ * rectangles, if any. The region must already be sorted.
+ *
+ * @param region
+ *     The region to coalesce.
+ *
+ * @param callback
+ *     The callback to invoke to decide whether two rectangles should be
+ *     combined.
+ *
+ * @param data
+ *     Arbitrary data to pass to the given callback.
+ *
+ * @return
+ *     The number of rectangles combined into other rectangles.
+ */
+static int __guac_common_region_coalesce_pass(guac_common_region* region,
+        guac_common_region_combine_callback* callback, void* data) {
+
+    guac_common_rect* rects = region->rects;
+    int combined = 0;
+    int count = 0;
+
+    for (int i = 0; i < region->count; i++) {
+
+        guac_common_rect rect = rects[i];
+        int rect_area = __guac_common_region_area(&rect);
+
+        int best = -1;
+        int best_growth = INT_MAX;
+
+        /* Find the combination which adds the fewest pixels */
+        int start = count - GUAC_COMMON_REGION_COMBINE_WINDOW;
+        for (int j = count - 1; j >= 0 && j >= start; j--) {
+
+            guac_common_rect* current = &rects[j];
+
+            /* Rects already covered never need to be sent separately */
+            if (__guac_common_region_contains(current, &rect)) {
+                best = j;
+                break;
+            }
+
+            if (!callback(current, &rect, data))
+                continue;
+
+            guac_common_rect bounds = *current;
+            guac_common_rect_extend(&bounds, &rect);
+
+            int growth = __guac_common_region_area(&bounds)
+                       - __guac_common_region_area(current) - rect_area;
+
+            if (growth < best_growth) {
+                best = j;
+                best_growth = growth;
+            }
+
+        }
+
+        /* Combine if possible, otherwise retain as a separate rect. Combined
+         * rects are stored at or before the current index, thus never
+         * overwriting rects not yet visited. */
+        if (best != -1) {
+            guac_common_rect_extend(&rects[best], &rect);
+            combined++;
+        }
+        else
+            rects[count++] = rect;
+
+    }
+
+    region->count = count;
+    return combined;
+
+}
+
+void guac_common_region_coalesce(guac_common_region* region,
+        guac_common_region_combine_callback* callback, void* data) {
+
+    for (int pass = 0; pass < GUAC_COMMON_REGION_MAX_PASSES; pass++) {
+
+        /* Sort rects to bring nearby rects within the combination window */
+        qsort(region->rects, region->count, sizeof(guac_common_rect),
+                __guac_common_region_rect_compare);
+
+        /* Stop once no further rects can be combined */
+        if (region->count <= 1
+                || !__guac_common_region_coalesce_pass(region, callback, data))
+            break;
+
+    }
+
+}
+
@@ -18,6 +18,7 @@
  */
 
 #include "config.h"
+#include "common/pixel.h"
 #include "common/rect.h"
 #include "common/surface.h"
 
@@ -25,6 +26,7 @@
 #include <guacamole/client.h>
 #include <guacamole/layer.h>
 #include <guacamole/protocol.h>
+#include <guacamole/protocol-batch.h>
 #include <guacamole/socket.h>
 #include <guacamole/timestamp.h>
 #include <guacamole/user.h>
@@ -78,11 +80,6 @@
 #define cairo_format_stride_for_width(format, width) (width*4)
 #endif
 
-/**
- * The framerate which, if exceeded, indicates that JPEG is preferred.
- */
-#define GUAC_COMMON_SURFACE_JPEG_FRAMERATE 3
-
 /**
  * Minimum JPEG bitmap size (area). If the bitmap is smaller than this threshold,
  * it should be compressed as a PNG image to avoid the JPEG compression tax.
@@ -103,6 +100,24 @@
  */
 #define GUAC_SURFACE_WEBP_BLOCK_SIZE 8
 
+/**
+ * The minimum width and height of an update, in pixels, for that update to
+ * be checked for content which has merely moved, such as when scrolling.
+ */
+#define GUAC_COMMON_SURFACE_MOTION_MIN_SIZE 64
+
+/**
+ * The minimum number of consecutive rows or columns of an update which must
+ * have moved by the same distance for that motion to be sent as a copy.
+ */
+#define GUAC_COMMON_SURFACE_MOTION_MIN_LENGTH 16
+
+/**
+ * The minimum number of distinct rows or columns of an update which must
+ * agree on the distance moved for motion to be considered detected.
+ */
+#define GUAC_COMMON_SURFACE_MOTION_MIN_VOTES 4
+
 void guac_common_surface_set_multitouch(guac_common_surface* surface,
         int touches) {
 
@@ -125,6 +140,69 @@ void guac_common_surface_set_lossless(guac_common_surface* surface,
 
 }
 
+void guac_common_surface_set_encode_pool(guac_common_surface* surface,
+        guac_common_encode_pool* pool) {
+
+    pthread_mutex_lock(&surface->_lock);
+    surface->encode_pool = pool;
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
+void guac_common_surface_set_image_cache(guac_common_surface* surface,
+        guac_common_image_cache* cache) {
+
+    pthread_mutex_lock(&surface->_lock);
+    surface->image_cache = cache;
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
+void guac_common_surface_set_quality_controller(guac_common_surface* surface,
+        guac_common_quality_controller* controller) {
+
+    pthread_mutex_lock(&surface->_lock);
+    surface->quality_controller = controller;
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
+void guac_common_surface_set_pending_handler(guac_common_surface* surface,
+        guac_common_surface_pending_handler* handler, void* data) {
+
+    pthread_mutex_lock(&surface->_lock);
+
+    surface->pending_handler = handler;
+    surface->pending_data = data;
+
+    /* Notify new handler of any changes which are already pending */
+    if (surface->flush_pending && handler != NULL)
+        handler(surface, data);
+
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
+/**
+ * Records that the given surface has changes awaiting a call to
+ * guac_common_surface_flush(), invoking the pending handler of the surface if
+ * no changes were previously pending. The surface must be locked.
+ *
+ * @param surface
+ *     The surface that has been changed.
+ */
+static void __guac_common_surface_set_pending(guac_common_surface* surface) {
+
+    if (surface->flush_pending)
+        return;
+
+    surface->flush_pending = 1;
+
+    if (surface->pending_handler != NULL)
+        surface->pending_handler(surface, surface->pending_data);
+
+}
+
 void guac_common_surface_move(guac_common_surface* surface, int x, int y) {
 
     pthread_mutex_lock(&surface->_lock);
@@ -132,6 +210,7 @@ void guac_common_surface_move(guac_common_surface* surface, int x, int y) {
     surface->x = x;
     surface->y = y;
     surface->location_dirty = 1;
+    __guac_common_surface_set_pending(surface);
 
     pthread_mutex_unlock(&surface->_lock);
 
@@ -143,6 +222,7 @@ void guac_common_surface_stack(guac_common_surface* surface, int z) {
 
     surface->z = z;
     surface->location_dirty = 1;
+    __guac_common_surface_set_pending(surface);
 
     pthread_mutex_unlock(&surface->_lock);
 
@@ -155,6 +235,7 @@ void guac_common_surface_set_parent(guac_common_surface* surface,
 
     surface->parent = parent;
     surface->location_dirty = 1;
+    __guac_common_surface_set_pending(surface);
 
     pthread_mutex_unlock(&surface->_lock);
 
@@ -167,6 +248,7 @@ void guac_common_surface_set_opacity(guac_common_surface* surface,
 
     surface->opacity = opacity;
     surface->opacity_dirty = 1;
+    __guac_common_surface_set_pending(surface);
 
     pthread_mutex_unlock(&surface->_lock);
 
@@ -249,37 +331,80 @@ static void __guac_common_clip_rect(guac_common_surface* surface,
 static int __guac_common_surface_is_opaque(guac_common_surface* surface,
         guac_common_rect* rect) {
 
-    int x, y;
-
-    int stride = surface ->stride;
+    int stride = surface->stride;
     unsigned char* buffer =
         surface->buffer + (stride * rect->y) + (4 * rect->x);
 
-    /* For each row */
-    for (y = 0; y < rect->height; y++) {
+    return guac_common_pixel_kernels_select()->is_opaque(buffer, stride,
+            rect->width, rect->height);
 
-        /* Search for a non-opaque pixel */
-        uint32_t* current = (uint32_t*) buffer;
-        for (x=0; x < rect->width; x++) {
+}
 
-            /* Rectangle is non-opaque if a single non-opaque pixel is found */
-            uint32_t color = *(current++);
-            if ((color & 0xFF000000) != 0xFF000000)
-                return 0;
 
-        }
+/**
+ * Returns whether the given update should be combined with the given existing
+ * update, to be eventually flushed as a single image, or would be best kept
+ * independent of the existing update. Only the estimated cost of sending the
+ * updates is considered.
+ *
+ * @param current
+ *     The bounding rectangle of the existing update.
+ *
+ * @param rect
+ *     The bounding rectangle of the update being made to the surface.
+ *
+ * @param rect_only
+ *     Non-zero if this update, by its nature, contains only metainformation
+ *     about the update's bounding rectangle, zero if the update also contains
+ *     image data.
+ *
+ * @return
+ *     Non-zero if the updates should be combined, zero otherwise.
+ */
+static int __guac_common_should_combine_rects(const guac_common_rect* current,
+        const guac_common_rect* rect, int rect_only) {
 
-        /* Next row */
-        buffer += stride;
+    int combined_cost, dirty_cost, update_cost;
+
+    /* Simulate combination */
+    guac_common_rect combined = *current;
+    guac_common_rect_extend(&combined, rect);
+
+    /* Combine if result is still small */
+    if (combined.width <= GUAC_SURFACE_NEGLIGIBLE_WIDTH && combined.height <= GUAC_SURFACE_NEGLIGIBLE_HEIGHT)
+        return 1;
+
+    /* Estimate costs of the existing update, new update, and both combined */
+    combined_cost = GUAC_SURFACE_BASE_COST + combined.width * combined.height;
+    dirty_cost    = GUAC_SURFACE_BASE_COST + current->width * current->height;
+    update_cost   = GUAC_SURFACE_BASE_COST + rect->width * rect->height;
+
+    /* Reduce cost if no image data */
+    if (rect_only)
+        update_cost /= GUAC_SURFACE_DATA_FACTOR;
+
+    /* Combine if cost estimate shows benefit */
+    if (combined_cost <= update_cost + dirty_cost)
+        return 1;
+
+    /* Combine if increase in cost is negligible */
+    if (combined_cost - dirty_cost <= dirty_cost / GUAC_SURFACE_NEGLIGIBLE_INCREASE)
+        return 1;
+
+    if (combined_cost - update_cost <= update_cost / GUAC_SURFACE_NEGLIGIBLE_INCREASE)
+        return 1;
 
+    /* Combine if we anticipate further updates, as this update follows a common fill pattern */
+    if (rect->x == current->x && rect->y == current->y + current->height) {
+        if (combined_cost <= (dirty_cost + update_cost) * GUAC_SURFACE_FILL_PATTERN_FACTOR)
+            return 1;
     }
 
-    /* Rectangle is opaque */
-    return 1;
+    /* Otherwise, do not combine */
+    return 0;
 
 }
 
-
 /**
  * Returns whether the given rectangle should be combined into the existing
  * dirty rectangle, to be eventually flushed as image data, or would be best
@@ -307,48 +432,35 @@ static int __guac_common_should_combine(guac_common_surface* surface, const guac
     if (!surface->realized)
         return 1;
 
-    if (surface->dirty) {
-
-        int combined_cost, dirty_cost, update_cost;
-
-        /* Simulate combination */
-        guac_common_rect combined = surface->dirty_rect;
-        guac_common_rect_extend(&combined, rect);
-
-        /* Combine if result is still small */
-        if (combined.width <= GUAC_SURFACE_NEGLIGIBLE_WIDTH && combined.height <= GUAC_SURFACE_NEGLIGIBLE_HEIGHT)
-            return 1;
-
-        /* Estimate costs of the existing update, new update, and both combined */
-        combined_cost = GUAC_SURFACE_BASE_COST + combined.width * combined.height;
-        dirty_cost    = GUAC_SURFACE_BASE_COST + surface->dirty_rect.width * surface->dirty_rect.height;
-        update_cost   = GUAC_SURFACE_BASE_COST + rect->width * rect->height;
+    /* Combine only if cost estimate shows benefit */
+    if (surface->dirty)
+        return __guac_common_should_combine_rects(&surface->dirty_rect, rect,
+                rect_only);
 
-        /* Reduce cost if no image data */
-        if (rect_only)
-            update_cost /= GUAC_SURFACE_DATA_FACTOR;
+    /* Otherwise, do not combine */
+    return 0;
 
-        /* Combine if cost estimate shows benefit */
-        if (combined_cost <= update_cost + dirty_cost)
-            return 1;
+}
 
-        /* Combine if increase in cost is negligible */
-        if (combined_cost - dirty_cost <= dirty_cost / GUAC_SURFACE_NEGLIGIBLE_INCREASE)
-            return 1;
+/**
+ * Callback for guac_common_region_coalesce() which decides whether two
+ * deferred bitmap updates should be sent as a single image. The arbitrary
+ * data given to the callback must be the guac_common_surface being flushed.
+ *
+ * @see guac_common_region_combine_callback
+ */
+static int __guac_common_surface_region_combine(
+        const guac_common_rect* current, const guac_common_rect* rect,
+        void* data) {
 
-        if (combined_cost - update_cost <= update_cost / GUAC_SURFACE_NEGLIGIBLE_INCREASE)
-            return 1;
+    guac_common_surface* surface = (guac_common_surface*) data;
 
-        /* Combine if we anticipate further updates, as this update follows a common fill pattern */
-        if (rect->x == surface->dirty_rect.x && rect->y == surface->dirty_rect.y + surface->dirty_rect.height) {
-            if (combined_cost <= (dirty_cost + update_cost) * GUAC_SURFACE_FILL_PATTERN_FACTOR)
-                return 1;
-        }
+    /* Always favor combining updates if surface is currently a purely
+     * server-side scratch area */
+    if (!surface->realized)
+        return 1;
 
-    }
-    
-    /* Otherwise, do not combine */
-    return 0;
+    return __guac_common_should_combine_rects(current, rect, 0);
 
 }
 
@@ -375,85 +487,7 @@ static void __guac_common_mark_dirty(guac_common_surface* surface, const guac_co
         surface->dirty = 1;
     }
 
-}
-
-/**
- * Calculate the current average framerate for a given area on the surface.
- *
- * @param surface
- *     The surface on which the framerate will be calculated.
- *
- * @param rect
- *     The rect containing the area for which the average framerate will be
- *     calculated.
- *
- * @return
- *     The average framerate of the given area, in frames per second.
- */
-static unsigned int __guac_common_surface_calculate_framerate(
-        guac_common_surface* surface, const guac_common_rect* rect) {
-
-    int x, y;
-
-    /* Calculate heat map dimensions */
-    int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
-
-    /* Calculate minimum X/Y coordinates intersecting given rect */
-    int min_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-    int min_y = rect->y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-
-    /* Calculate maximum X/Y coordinates intersecting given rect */
-    int max_x = min_x + (rect->width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-    int max_y = min_y + (rect->height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-
-    unsigned int sum_framerate = 0;
-    unsigned int count = 0;
-
-    /* Get start of buffer at given coordinates */
-    const guac_common_surface_heat_cell* heat_row =
-        surface->heat_map + min_y * heat_width + min_x;
-
-    /* Iterate over all the heat map cells for the area
-     * and calculate the average framerate */
-    for (y = min_y; y < max_y; y++) {
-
-        /* Get current row of heat map */
-        const guac_common_surface_heat_cell* heat_cell = heat_row;
-
-        /* For each cell in subset of row */
-        for (x = min_x; x < max_x; x++) {
-
-            /* Calculate indicies for latest and oldest history entries */
-            int oldest_entry = heat_cell->oldest_entry;
-            int latest_entry = oldest_entry - 1;
-            if (latest_entry < 0)
-                latest_entry = GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE - 1;
-
-            /* Calculate elapsed time covering entire history for this cell */
-            int elapsed_time = heat_cell->history[latest_entry]
-                             - heat_cell->history[oldest_entry];
-
-            /* Calculate and add framerate */
-            if (elapsed_time)
-                sum_framerate += GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE
-                    * 1000 / elapsed_time;
-
-            /* Next heat map cell */
-            heat_cell++;
-            count++;
-
-        }
-
-        /* Next heat map row */
-        heat_row += heat_width;
-
-    }
-
-    /* Calculate the average framerate over entire rect */
-    if (count)
-        return sum_framerate / count;
-
-    return 0;
+    __guac_common_surface_set_pending(surface);
 
 }
 
@@ -477,52 +511,11 @@ static unsigned int __guac_common_surface_calculate_framerate(
 static int __guac_common_surface_png_optimality(guac_common_surface* surface,
         const guac_common_rect* rect) {
 
-    int x, y;
-
-    int num_same = 0;
-    int num_different = 1;
-
-    /* Get image/buffer metrics */
-    int width = rect->width;
-    int height = rect->height;
     int stride = surface->stride;
-
-    /* Get buffer from surface */
     unsigned char* buffer = surface->buffer + rect->y * stride + rect->x * 4;
 
-    /* Image must be at least 1x1 */
-    if (width < 1 || height < 1)
-        return 0;
-
-    /* For each row */
-    for (y = 0; y < height; y++) {
-
-        uint32_t* row = (uint32_t*) buffer;
-        uint32_t last_pixel = *(row++) | 0xFF000000;
-
-        /* For each pixel in current row */
-        for (x = 1; x < width; x++) {
-
-            /* Get next pixel */
-            uint32_t current_pixel = *(row++) | 0xFF000000;
-
-            /* Update same/different counts according to pixel value */
-            if (current_pixel == last_pixel)
-                num_same++;
-            else
-                num_different++;
-
-            last_pixel = current_pixel;
-
-        }
-
-        /* Advance to next row */
-        buffer += stride;
-
-    }
-
-    /* Return rough approximation of optimality for PNG compression */
-    return 0x100 * num_same / num_different - 0x400;
+    return guac_common_pixel_kernels_select()->png_optimality(buffer, stride,
+            rect->width, rect->height);
 
 }
 
@@ -548,7 +541,8 @@ static int __guac_common_surface_should_use_jpeg(guac_common_surface* surface,
         return 0;
 
     /* Calculate the average framerate for the given rect */
-    int framerate = __guac_common_surface_calculate_framerate(surface, rect);
+    int framerate = guac_common_heat_map_get_framerate(surface->heat_map,
+            rect);
 
     int rect_size = rect->width * rect->height;
 
@@ -556,7 +550,7 @@ static int __guac_common_surface_should_use_jpeg(guac_common_surface* surface,
      * - frame rate is high enough
      * - image size is large enough
      * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
+    return framerate >= surface->quality_params.lossy_framerate
         && rect_size > GUAC_SURFACE_JPEG_MIN_BITMAP_SIZE
         && __guac_common_surface_png_optimality(surface, rect) < 0;
 
@@ -584,103 +578,84 @@ static int __guac_common_surface_should_use_webp(guac_common_surface* surface,
         return 0;
 
     /* Calculate the average framerate for the given rect */
-    int framerate = __guac_common_surface_calculate_framerate(surface, rect);
+    int framerate = guac_common_heat_map_get_framerate(surface->heat_map,
+            rect);
 
     /* WebP is preferred if:
      * - frame rate is high enough
      * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
+    return framerate >= surface->quality_params.lossy_framerate
         && __guac_common_surface_png_optimality(surface, rect) < 0;
 
 }
 
 /**
- * Updates the heat map cells which intersect the given rectangle using the
- * given timestamp. This timestamp, along with timestamps from past updates,
- * is used to calculate the framerate of each heat cell.
- *
- * @param surface
- *     The surface containing the heat map cells to be updated.
- *
- * @param rect
- *     The rectangle containing the heat map cells to be updated.
+ * Flushes the bitmap update currently described by the dirty rectangle within the
+ * given surface to that surface's region of deferred bitmap updates.
  *
- * @param time
- *     The timestamp to use when updating the heat map cells which intersect
- *     the given rectangle.
+ * @param surface The surface to flush.
  */
-static void __guac_common_surface_touch_rect(guac_common_surface* surface,
-        guac_common_rect* rect, guac_timestamp time) {
-
-    int x, y;
-
-    /* Calculate heat map dimensions */
-    int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+static void __guac_common_surface_flush_to_region(guac_common_surface* surface) {
 
-    /* Calculate minimum X/Y coordinates intersecting given rect */
-    int min_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-    int min_y = rect->y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-
-    /* Calculate maximum X/Y coordinates intersecting given rect */
-    int max_x = min_x + (rect->width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-    int max_y = min_y + (rect->height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    /* Do not flush if not dirty */
+    if (!surface->dirty)
+        return;
 
-    /* Get start of buffer at given coordinates */
-    guac_common_surface_heat_cell* heat_row =
-        surface->heat_map + min_y * heat_width + min_x;
+    /* Add new rect to region */
+    guac_common_region_add(surface->bitmap_region, &surface->dirty_rect);
 
-    /* Update all heat map cells which intersect with rectangle */
-    for (y = min_y; y <= max_y; y++) {
+    /* Surface now flushed */
+    surface->dirty = 0;
 
-        /* Get current row of heat map */
-        guac_common_surface_heat_cell* heat_cell = heat_row;
+}
 
-        /* For each cell in subset of row */
-        for (x = min_x; x <= max_x; x++) {
+/**
+ * Records that the given rectangle of the given surface has been modified by
+ * output sent within the current frame, adding to the damage history of the
+ * surface. Damage must be recorded whenever output affecting the contents of
+ * the surface is actually sent, not when that output is merely deferred.
+ *
+ * @param surface
+ *     The surface that has been modified.
+ *
+ * @param rect
+ *     The rectangle of the surface that has been modified.
+ */
+static void __guac_common_surface_record_damage(guac_common_surface* surface,
+        const guac_common_rect* rect) {
 
-            /* Replace oldest entry with new timestamp */
-            heat_cell->history[heat_cell->oldest_entry] = time;
+    guac_timestamp frame = surface->client->last_sent_timestamp;
 
-            /* Update to next oldest entry */
-            heat_cell->oldest_entry++;
-            if (heat_cell->oldest_entry >=
-                    GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE)
-                heat_cell->oldest_entry = 0;
+    /* Extend existing damage if still within the same frame */
+    if (surface->damage_length > 0) {
 
-            /* Advance to next heat map cell */
-            heat_cell++;
+        int newest = (surface->oldest_damage + surface->damage_length - 1)
+                   % GUAC_COMMON_SURFACE_DAMAGE_HISTORY_SIZE;
 
+        guac_common_surface_damage* damage = &surface->damage[newest];
+        if (damage->frame == frame) {
+            guac_common_rect_extend(&damage->rect, rect);
+            return;
         }
 
-        /* Next heat map row */
-        heat_row += heat_width;
-
     }
 
-}
-
-/**
- * Flushes the bitmap update currently described by the dirty rectangle within the
- * given surface to that surface's bitmap queue. There MUST be space within the
- * queue.
- *
- * @param surface The surface to flush.
- */
-static void __guac_common_surface_flush_to_queue(guac_common_surface* surface) {
-
-    guac_common_surface_bitmap_rect* rect;
-
-    /* Do not flush if not dirty */
-    if (!surface->dirty)
-        return;
+    /* Drop oldest damage if history is full */
+    if (surface->damage_length == GUAC_COMMON_SURFACE_DAMAGE_HISTORY_SIZE) {
+        surface->damage_base = surface->damage[surface->oldest_damage].frame;
+        surface->oldest_damage = (surface->oldest_damage + 1)
+                               % GUAC_COMMON_SURFACE_DAMAGE_HISTORY_SIZE;
+        surface->damage_length--;
+    }
 
-    /* Add new rect to queue */
-    rect = &(surface->bitmap_queue[surface->bitmap_queue_length++]);
-    rect->rect = surface->dirty_rect;
-    rect->flushed = 0;
+    /* Begin tracking damage for new frame */
+    int index = (surface->oldest_damage + surface->damage_length)
+              % GUAC_COMMON_SURFACE_DAMAGE_HISTORY_SIZE;
 
-    /* Surface now flushed */
-    surface->dirty = 0;
+    guac_common_surface_damage* damage = &surface->damage[index];
+    damage->frame = frame;
+    damage->rect = *rect;
+    surface->damage_length++;
 
 }
 
@@ -696,26 +671,13 @@ static void __guac_common_surface_flush(guac_common_surface* surface);
 /**
  * Schedules a deferred flush of the given surface. This will not immediately
  * flush the surface to the client. Instead, the result of the flush is
- * added to a queue which is reinspected and combined (if possible) with other
- * deferred flushes during the call to guac_common_surface_flush().
+ * added to a region which is coalesced (if possible) with other deferred
+ * flushes during the call to guac_common_surface_flush().
  *
  * @param surface The surface to flush.
  */
 static void __guac_common_surface_flush_deferred(guac_common_surface* surface) {
-
-    /* Do not flush if not dirty */
-    if (!surface->dirty)
-        return;
-
-    /* Flush if queue size has reached maximum (space is reserved for the final
-     * dirty rect, as __guac_common_surface_flush() MAY add an additional rect
-     * to the queue */
-    if (surface->bitmap_queue_length == GUAC_COMMON_SURFACE_QUEUE_SIZE-1)
-        __guac_common_surface_flush(surface);
-
-    /* Append dirty rect to queue */
-    __guac_common_surface_flush_to_queue(surface);
-
+    __guac_common_surface_flush_to_region(surface);
 }
 
 /**
@@ -887,83 +849,6 @@ static void __guac_common_surface_set(guac_common_surface* dst,
 
 }
 
-/**
- * Applies the Porter-Duff "over" composite operator, blending the two given
- * color components using the given alpha value.
- *
- * @param dst
- *     The destination color component.
- *
- * @param src
- *     The source color component.
- *
- * @param alpha
- *     The alpha value which applies to the blending operation.
- *
- * @return
- *     The result of applying the Porter-Duff "over" composite operator to the
- *     given source and destination components.
- */
-static int guac_common_surface_blend_component(int dst, int src, int alpha) {
-
-    int blended = src + dst * (0xFF - alpha);
-
-    /* Do not exceed maximum component value */
-    if (blended > 0xFF)
-        return 0xFF;
-
-    return blended;
-
-}
-
-/**
- * Applies the Porter-Duff "over" composite operator, blending each component
- * of the two given ARGB colors.
- *
- * @param dst
- *     The destination ARGB color.
- *
- * @param src
- *     The source ARGB color.
- *
- * @return
- *     The result of applying the Porter-Duff "over" composite operator to the
- *     given source and destination colors.
- */
-static uint32_t guac_common_surface_argb_blend(uint32_t dst, uint32_t src) {
-
-    /* Separate destination ARGB color into its components */
-    int dst_a = (dst >> 24) & 0xFF;
-    int dst_r = (dst >> 16) & 0xFF;
-    int dst_g = (dst >>  8) & 0xFF;
-    int dst_b =  dst        & 0xFF;
-
-    /* Separate source ARGB color into its components */
-    int src_a = (src >> 24) & 0xFF;
-    int src_r = (src >> 16) & 0xFF;
-    int src_g = (src >>  8) & 0xFF;
-    int src_b =  src        & 0xFF;
-
-    /* If source is fully opaque (or destination is fully transparent), the
-     * blended result is the source */
-    if (src_a == 0xFF || dst_a == 0x00)
-        return src;
-
-    /* If source is fully transparent, the blended result is the destination */
-    if (src_a == 0x00)
-        return dst;
-
-    /* Otherwise, blend each ARGB component, assuming pre-multiplied alpha */
-    int r = guac_common_surface_blend_component(dst_r, src_r, src_a);
-    int g = guac_common_surface_blend_component(dst_g, src_g, src_a);
-    int b = guac_common_surface_blend_component(dst_b, src_b, src_a);
-    int a = guac_common_surface_blend_component(dst_a, src_a, src_a);
-
-    /* Recombine blended components */
-    return (a << 24) | (r << 16) | (g << 8) | b;
-
-}
-
 /**
  * Copies data from the given buffer to the surface at the given coordinates.
  * The dimensions and location of the destination rectangle will be altered
@@ -983,82 +868,25 @@ static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
                                       guac_common_surface* dst, guac_common_rect* rect,
                                       int opaque) {
 
-    unsigned char* dst_buffer = dst->buffer;
-    int dst_stride = dst->stride;
-
-    int x, y;
-
-    int min_x = rect->width;
-    int min_y = rect->height;
-    int max_x = 0;
-    int max_y = 0;
-
-    int orig_x = rect->x;
-    int orig_y = rect->y;
+    guac_common_rect changed;
 
     src_buffer += src_stride * (*sy) + 4 * (*sx);
-    dst_buffer += (dst_stride * rect->y) + (4 * rect->x);
+    unsigned char* dst_buffer = dst->buffer
+                              + (dst->stride * rect->y) + (4 * rect->x);
 
-    /* For each row */
-    for (y=0; y < rect->height; y++) {
+    guac_common_pixel_kernels_select()->put(src_buffer, src_stride,
+            dst_buffer, dst->stride, rect->width, rect->height, opaque,
+            &changed);
 
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
+    /* Update source X/Y */
+    *sx += changed.x;
+    *sy += changed.y;
 
-        /* Copy row */
-        for (x=0; x < rect->width; x++) {
-
-            uint32_t color;
-
-            /* Get source and destination color values */
-            uint32_t src_color = *src_current;
-            uint32_t dst_color = *dst_current;
-
-            /* Ignore alpha channel if opaque */
-            if (opaque)
-                color = src_color | 0xFF000000;
-
-            /* Otherwise, perform alpha blending operation */
-            else
-                color = guac_common_surface_argb_blend(dst_color, src_color);
-
-            /* If the destination color is changing, update rectangle bounds
-             * and store the new color */
-            if (dst_color != color) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-                *dst_current = color;
-            }
-
-            /* Advance to next pixel */
-            src_current++;
-            dst_current++;
-
-        }
-
-        /* Next row */
-        src_buffer += src_stride;
-        dst_buffer += dst_stride;
-
-    }
-
-    /* Restrict destination rect to only updated pixels */
-    if (max_x >= min_x && max_y >= min_y) {
-        rect->x += min_x;
-        rect->y += min_y;
-        rect->width = max_x - min_x + 1;
-        rect->height = max_y - min_y + 1;
-    }
-    else {
-        rect->width = 0;
-        rect->height = 0;
-    }
-
-    /* Update source X/Y */
-    *sx += rect->x - orig_x;
-    *sy += rect->y - orig_y;
+    /* Restrict destination rect to only updated pixels */
+    rect->x += changed.x;
+    rect->y += changed.y;
+    rect->width = changed.width;
+    rect->height = changed.height;
 
 }
 
@@ -1223,13 +1051,405 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
 
 }
 
+/**
+ * Calculates a hash of each row and each column of the given rectangle of
+ * image data, for use in detecting motion.
+ *
+ * @param buffer
+ *     The image data to hash, pointing to the upper-left corner of the
+ *     rectangle.
+ *
+ * @param stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param width
+ *     The width of the rectangle, in pixels.
+ *
+ * @param height
+ *     The height of the rectangle, in pixels.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the image data should be ignored, zero
+ *     otherwise.
+ *
+ * @param row_hashes
+ *     An array of at least height elements which will receive the hash of
+ *     each row.
+ *
+ * @param column_hashes
+ *     An array of at least width elements which will receive the hash of
+ *     each column.
+ */
+static void __guac_common_surface_hash_lines(unsigned char* buffer,
+        int stride, int width, int height, int opaque,
+        uint32_t* row_hashes, uint32_t* column_hashes) {
+
+    uint32_t alpha = opaque ? 0xFF000000 : 0;
+
+    for (int x = 0; x < width; x++)
+        column_hashes[x] = 0x811C9DC5;
+
+    for (int y = 0; y < height; y++) {
+
+        uint32_t* current = (uint32_t*) buffer;
+        uint32_t row_hash = 0x811C9DC5;
+
+        for (int x = 0; x < width; x++) {
+            uint32_t color = current[x] | alpha;
+            row_hash = (row_hash ^ color) * 0x01000193;
+            column_hashes[x] = (column_hashes[x] ^ color) * 0x01000193;
+        }
+
+        row_hashes[y] = row_hash;
+        buffer += stride;
+
+    }
+
+}
+
+/**
+ * Determines the most likely distance that the lines (rows or columns) of
+ * an image have moved, given the hashes of each line before and after the
+ * image was changed. Only lines which are unique within the original image
+ * are considered, as repeated lines (such as blank lines) say nothing about
+ * how far content has moved.
+ *
+ * @param old_hashes
+ *     The hash of each line prior to the change.
+ *
+ * @param new_hashes
+ *     The hash of each line after the change.
+ *
+ * @param length
+ *     The number of lines.
+ *
+ * @param shift
+ *     Pointer to an int which will receive the detected distance, where the
+ *     line at index i after the change was at index i + shift prior to the
+ *     change.
+ *
+ * @return
+ *     Non-zero if motion was detected, zero otherwise.
+ */
+static int __guac_common_surface_find_shift(const uint32_t* old_hashes,
+        const uint32_t* new_hashes, int length, int* shift) {
+
+    /* Use a power-of-two hash table at least twice as large as the number of
+     * lines, storing the index of each line plus one (zero is empty) */
+    int table_size = 1;
+    while (table_size < length * 2)
+        table_size <<= 1;
+
+    int mask = table_size - 1;
+    int* table = calloc(table_size, sizeof(int));
+    char* repeated = calloc(table_size, sizeof(char));
+    int* votes = calloc(length * 2, sizeof(int));
+
+    int detected = 0;
+    if (table == NULL || repeated == NULL || votes == NULL)
+        goto complete;
+
+    /* Index all original lines by hash, noting any which are repeated */
+    for (int i = 0; i < length; i++) {
+
+        int slot = old_hashes[i] & mask;
+        while (table[slot] != 0 && old_hashes[table[slot] - 1] != old_hashes[i])
+            slot = (slot + 1) & mask;
+
+        if (table[slot] != 0)
+            repeated[slot] = 1;
+        else
+            table[slot] = i + 1;
+
+    }
+
+    /* Each changed line which is unique within the original votes for the
+     * distance that it has moved */
+    for (int i = 0; i < length; i++) {
+
+        if (new_hashes[i] == old_hashes[i])
+            continue;
+
+        int slot = new_hashes[i] & mask;
+        while (table[slot] != 0 && old_hashes[table[slot] - 1] != new_hashes[i])
+            slot = (slot + 1) & mask;
+
+        if (table[slot] != 0 && !repeated[slot])
+            votes[table[slot] - 1 - i + length]++;
+
+    }
+
+    /* Choose the distance having the most votes */
+    int best = 0;
+    for (int i = 1; i < length * 2; i++) {
+        if (votes[i] > votes[best])
+            best = i;
+    }
+
+    detected = votes[best] >= GUAC_COMMON_SURFACE_MOTION_MIN_VOTES;
+    *shift = best - length;
+
+complete:
+    free(table);
+    free(repeated);
+    free(votes);
+
+    return detected;
+
+}
+
+/**
+ * Finds the longest run of consecutive lines which are unchanged aside from
+ * having moved the given distance, given the hashes of each line before and
+ * after the image was changed.
+ *
+ * @param old_hashes
+ *     The hash of each line prior to the change.
+ *
+ * @param new_hashes
+ *     The hash of each line after the change.
+ *
+ * @param length
+ *     The number of lines.
+ *
+ * @param shift
+ *     The distance that lines have moved, where the line at index i after the
+ *     change was at index i + shift prior to the change.
+ *
+ * @param start
+ *     Pointer to an int which will receive the index of the first line of
+ *     the run, after the change.
+ *
+ * @return
+ *     The number of lines in the run, or zero if no lines match.
+ */
+static int __guac_common_surface_find_run(const uint32_t* old_hashes,
+        const uint32_t* new_hashes, int length, int shift, int* start) {
+
+    int first = shift < 0 ? -shift : 0;
+    int last = shift > 0 ? length - shift : length;
+
+    int best_length = 0;
+    int run_length = 0;
+
+    for (int i = first; i < last; i++) {
+
+        /* Extend current run while lines match */
+        if (new_hashes[i] == old_hashes[i + shift]) {
+            run_length++;
+            if (run_length > best_length) {
+                best_length = run_length;
+                *start = i - run_length + 1;
+            }
+        }
+
+        else
+            run_length = 0;
+
+    }
+
+    return best_length;
+
+}
+
+/**
+ * Returns whether the given opaque image data exactly matches the current
+ * contents of the given surface at the given offset from the rectangle that
+ * the image data will be drawn to.
+ *
+ * @param surface
+ *     The surface whose contents should be compared.
+ *
+ * @param buffer
+ *     The image data to compare, pointing to the pixel which will be drawn
+ *     to the upper-left corner of the given rectangle.
+ *
+ * @param stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param rect
+ *     The rectangle that the image data will be drawn to.
+ *
+ * @param dx
+ *     The horizontal offset of the contents which should be compared, relative
+ *     to the given rectangle.
+ *
+ * @param dy
+ *     The vertical offset of the contents which should be compared, relative
+ *     to the given rectangle.
+ *
+ * @return
+ *     Non-zero if the image data matches the surface contents exactly, zero
+ *     otherwise.
+ */
+static int __guac_common_surface_matches(guac_common_surface* surface,
+        unsigned char* buffer, int stride, const guac_common_rect* rect,
+        int dx, int dy) {
+
+    unsigned char* current = surface->buffer
+                           + (rect->y + dy) * surface->stride
+                           + (rect->x + dx) * 4;
+
+    for (int y = 0; y < rect->height; y++) {
+
+        uint32_t* src = (uint32_t*) buffer;
+        uint32_t* dst = (uint32_t*) current;
+
+        for (int x = 0; x < rect->width; x++) {
+            if ((src[x] | 0xFF000000) != dst[x])
+                return 0;
+        }
+
+        buffer += stride;
+        current += surface->stride;
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * Detects whether the given opaque image data, which is about to be drawn to
+ * the given rectangle of the given surface, largely consists of the current
+ * contents of that rectangle shifted vertically or horizontally, as happens
+ * when content scrolls. If so, the shifted contents are moved within the
+ * surface and, with a "copy" instruction, within the remote display, such
+ * that only the remainder of the image data need be drawn. The surface must
+ * be locked.
+ *
+ * @param surface
+ *     The surface that the image data will be drawn to.
+ *
+ * @param buffer
+ *     The image data to be drawn.
+ *
+ * @param stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param sx
+ *     The X coordinate of the pixel within the image data which will be
+ *     drawn to the upper-left corner of the given rectangle.
+ *
+ * @param sy
+ *     The Y coordinate of the pixel within the image data which will be
+ *     drawn to the upper-left corner of the given rectangle.
+ *
+ * @param rect
+ *     The rectangle that the image data will be drawn to, which must already
+ *     be clipped to the bounds of the surface.
+ *
+ * @param moved
+ *     Pointer to a rectangle which will receive the portion of the given
+ *     rectangle which now contains the image data, if motion was detected.
+ *
+ * @return
+ *     Non-zero if motion was detected and a portion of the surface now
+ *     contains the image data, zero otherwise.
+ */
+static int __guac_common_surface_apply_motion(guac_common_surface* surface,
+        unsigned char* buffer, int stride, int sx, int sy,
+        const guac_common_rect* rect, guac_common_rect* moved) {
+
+    /* Motion can only be represented on the client if the surface exists
+     * there, and is only worth detecting for large updates */
+    if (!surface->realized
+            || rect->width < GUAC_COMMON_SURFACE_MOTION_MIN_SIZE
+            || rect->height < GUAC_COMMON_SURFACE_MOTION_MIN_SIZE)
+        return 0;
+
+    uint32_t* hashes = malloc(sizeof(uint32_t)
+            * (rect->width + rect->height) * 2);
+    if (hashes == NULL)
+        return 0;
+
+    uint32_t* old_rows = hashes;
+    uint32_t* new_rows = old_rows + rect->height;
+    uint32_t* old_columns = new_rows + rect->height;
+    uint32_t* new_columns = old_columns + rect->width;
+
+    buffer += sy * stride + sx * 4;
+
+    /* Hash lines of current and new contents */
+    __guac_common_surface_hash_lines(surface->buffer
+                + rect->y * surface->stride + rect->x * 4, surface->stride,
+            rect->width, rect->height, 0, old_rows, old_columns);
+
+    __guac_common_surface_hash_lines(buffer, stride,
+            rect->width, rect->height, 1, new_rows, new_columns);
+
+    int dx = 0;
+    int dy = 0;
+    int start;
+    int length = 0;
+
+    /* Prefer vertical motion, as is typical of scrolling */
+    if (__guac_common_surface_find_shift(old_rows, new_rows,
+                rect->height, &dy)) {
+
+        length = __guac_common_surface_find_run(old_rows, new_rows,
+                rect->height, dy, &start);
+
+        guac_common_rect_init(moved, rect->x, rect->y + start,
+                rect->width, length);
+
+    }
+
+    /* Fall back to horizontal motion */
+    if (length < GUAC_COMMON_SURFACE_MOTION_MIN_LENGTH) {
+
+        dy = 0;
+        length = 0;
+
+        if (__guac_common_surface_find_shift(old_columns, new_columns,
+                    rect->width, &dx)) {
+
+            length = __guac_common_surface_find_run(old_columns, new_columns,
+                    rect->width, dx, &start);
+
+            guac_common_rect_init(moved, rect->x + start, rect->y,
+                    length, rect->height);
+
+        }
+
+    }
+
+    free(hashes);
+
+    if (length < GUAC_COMMON_SURFACE_MOTION_MIN_LENGTH)
+        return 0;
+
+    /* Hashes may collide, so verify that the contents truly match */
+    if (!__guac_common_surface_matches(surface,
+                buffer + (moved->y - rect->y) * stride
+                       + (moved->x - rect->x) * 4,
+                stride, moved, dx, dy))
+        return 0;
+
+    /* The remote display must be up-to-date before its contents move */
+    __guac_common_surface_flush(surface);
+
+    guac_protocol_send_copy(surface->socket,
+            surface->layer, moved->x + dx, moved->y + dy,
+            moved->width, moved->height, GUAC_COMP_OVER,
+            surface->layer, moved->x, moved->y);
+
+    __guac_common_surface_record_damage(surface, moved);
+
+    /* Move contents of backing surface to match */
+    int copy_x = moved->x + dx;
+    int copy_y = moved->y + dy;
+    guac_common_rect copy_rect = *moved;
+    __guac_common_surface_transfer(surface, &copy_x, &copy_y,
+            GUAC_TRANSFER_BINARY_SRC, surface, &copy_rect);
+
+    return 1;
+
+}
+
 guac_common_surface* guac_common_surface_alloc(guac_client* client,
         guac_socket* socket, const guac_layer* layer, int w, int h) {
 
-    /* Calculate heat map dimensions */
-    int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(w);
-    int heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(h);
-
     /* Init surface */
     guac_common_surface* surface = calloc(1, sizeof(guac_common_surface));
     surface->client = client;
@@ -1247,12 +1467,18 @@ guac_common_surface* guac_common_surface_alloc(guac_client* client,
     surface->buffer = calloc(h, surface->stride);
 
     /* Create corresponding heat map */
-    surface->heat_map = calloc(heat_width * heat_height,
-            sizeof(guac_common_surface_heat_cell));
+    surface->heat_map = guac_common_heat_map_alloc(w, h);
+
+    /* No updates are initially deferred */
+    surface->bitmap_region = guac_common_region_alloc();
 
     /* Reset clipping rect */
     guac_common_surface_reset_clip(surface);
 
+    /* Users that did not receive the creation of the surface require its
+     * entire contents */
+    surface->damage_base = client->last_sent_timestamp;
+
     /* Layers must initially exist */
     if (layer->index >= 0) {
         guac_protocol_send_size(socket, layer, w, h);
@@ -1274,7 +1500,8 @@ void guac_common_surface_free(guac_common_surface* surface) {
 
     pthread_mutex_destroy(&surface->_lock);
 
-    free(surface->heat_map);
+    guac_common_heat_map_free(surface->heat_map);
+    guac_common_region_free(surface->bitmap_region);
     free(surface->buffer);
     free(surface);
 
@@ -1298,10 +1525,6 @@ void guac_common_surface_resize(guac_common_surface* surface, int w, int h) {
     int sx = 0;
     int sy = 0;
 
-    /* Calculate heat map dimensions */
-    int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(w);
-    int heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(h);
-
     /* Copy old surface data */
     old_buffer = surface->buffer;
     old_stride = surface->stride;
@@ -1321,10 +1544,8 @@ void guac_common_surface_resize(guac_common_surface* surface, int w, int h) {
     /* Free old data */
     free(old_buffer);
 
-    /* Allocate completely new heat map (can safely discard old stats) */
-    free(surface->heat_map);
-    surface->heat_map = calloc(heat_width * heat_height,
-            sizeof(guac_common_surface_heat_cell));
+    /* Reset heat map (can safely discard old stats) */
+    guac_common_heat_map_resize(surface->heat_map, w, h);
 
     /* Resize dirty rect to fit new surface dimensions */
     if (surface->dirty) {
@@ -1334,14 +1555,76 @@ void guac_common_surface_resize(guac_common_surface* surface, int w, int h) {
     }
 
     /* Update Guacamole layer */
-    if (surface->realized)
+    if (surface->realized) {
         guac_protocol_send_size(socket, layer, w, h);
+        guac_common_rect_init(&old_rect, 0, 0, w, h);
+        __guac_common_surface_record_damage(surface, &old_rect);
+    }
 
 complete:
     pthread_mutex_unlock(&surface->_lock);
 
 }
 
+/**
+ * Draws the given image data to the given rectangle of the given surface,
+ * marking the changed portion of that rectangle as dirty and updating the
+ * heat map accordingly. The surface must be locked, and the rectangle must
+ * already be clipped to the bounds of the surface.
+ *
+ * @param surface
+ *     The surface to draw to.
+ *
+ * @param buffer
+ *     The image data to draw.
+ *
+ * @param stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param sx
+ *     The X coordinate of the pixel within the image data which should be
+ *     drawn to the upper-left corner of the given rectangle.
+ *
+ * @param sy
+ *     The Y coordinate of the pixel within the image data which should be
+ *     drawn to the upper-left corner of the given rectangle.
+ *
+ * @param rect
+ *     The rectangle to draw to.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the image data should be ignored, zero
+ *     otherwise.
+ *
+ * @param time
+ *     The time of the draw operation, in milliseconds, with which the heat
+ *     map should be updated.
+ */
+static void __guac_common_surface_draw_rect(guac_common_surface* surface,
+        unsigned char* buffer, int stride, int sx, int sy,
+        guac_common_rect rect, int opaque, guac_timestamp time) {
+
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+
+    /* Update backing surface */
+    __guac_common_surface_put(buffer, stride, &sx, &sy, surface, &rect, opaque);
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+
+    /* Update the heat map before any flush, such that the encoding chosen
+     * for this update reflects it */
+    guac_common_heat_map_touch(surface->heat_map, &rect, time);
+
+    /* Flush if not combining */
+    if (!__guac_common_should_combine(surface, &rect, 0))
+        __guac_common_surface_flush_deferred(surface);
+
+    /* Always defer draws */
+    __guac_common_mark_dirty(surface, &rect);
+
+}
+
 void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_surface_t* src) {
 
     pthread_mutex_lock(&surface->_lock);
@@ -1352,6 +1635,8 @@ void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_
     int w = cairo_image_surface_get_width(src);
     int h = cairo_image_surface_get_height(src);
 
+    int opaque = format != CAIRO_FORMAT_ARGB32;
+
     int sx = 0;
     int sy = 0;
 
@@ -1363,21 +1648,48 @@ void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_
     if (rect.width <= 0 || rect.height <= 0)
         goto complete;
 
-    /* Update backing surface */
-    __guac_common_surface_put(buffer, stride, &sx, &sy, surface, &rect, format != CAIRO_FORMAT_ARGB32);
-    if (rect.width <= 0 || rect.height <= 0)
-        goto complete;
-
-    /* Update the heat map for the update rectangle. */
     guac_timestamp time = guac_timestamp_current();
-    __guac_common_surface_touch_rect(surface, &rect, time);
 
-    /* Flush if not combining */
-    if (!__guac_common_should_combine(surface, &rect, 0))
-        __guac_common_surface_flush_deferred(surface);
+    /* Copy any content which has merely moved, drawing only the remainder */
+    guac_common_rect moved;
+    if (opaque && __guac_common_surface_apply_motion(surface, buffer, stride,
+                sx, sy, &rect, &moved)) {
+
+        guac_common_rect part;
+        int moved_right = moved.x + moved.width;
+        int moved_bottom = moved.y + moved.height;
+
+        /* Above moved content */
+        guac_common_rect_init(&part, rect.x, rect.y,
+                rect.width, moved.y - rect.y);
+        __guac_common_surface_draw_rect(surface, buffer, stride,
+                sx, sy, part, 1, time);
+
+        /* Below moved content */
+        guac_common_rect_init(&part, rect.x, moved_bottom,
+                rect.width, rect.y + rect.height - moved_bottom);
+        __guac_common_surface_draw_rect(surface, buffer, stride,
+                sx, sy + moved_bottom - rect.y, part, 1, time);
+
+        /* Left of moved content */
+        guac_common_rect_init(&part, rect.x, moved.y,
+                moved.x - rect.x, moved.height);
+        __guac_common_surface_draw_rect(surface, buffer, stride,
+                sx, sy + moved.y - rect.y, part, 1, time);
+
+        /* Right of moved content */
+        guac_common_rect_init(&part, moved_right, moved.y,
+                rect.x + rect.width - moved_right, moved.height);
+        __guac_common_surface_draw_rect(surface, buffer, stride,
+                sx + moved_right - rect.x, sy + moved.y - rect.y, part, 1,
+                time);
 
-    /* Always defer draws */
-    __guac_common_mark_dirty(surface, &rect);
+    }
+
+    /* Otherwise, draw everything */
+    else
+        __guac_common_surface_draw_rect(surface, buffer, stride, sx, sy,
+                rect, opaque, time);
 
 complete:
     pthread_mutex_unlock(&surface->_lock);
@@ -1471,6 +1783,7 @@ void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
         guac_protocol_send_copy(socket, src_layer, srect.x, srect.y,
                 drect.width, drect.height, GUAC_COMP_OVER, dst_layer,
                 drect.x, drect.y);
+        __guac_common_surface_record_damage(dst, &drect);
         dst->realized = 1;
     }
 
@@ -1537,6 +1850,7 @@ void guac_common_surface_transfer(guac_common_surface* src, int sx, int sy, int
         __guac_common_surface_flush(src);
         guac_protocol_send_transfer(socket, src_layer, srect.x, srect.y,
                 drect.width, drect.height, op, dst_layer, drect.x, drect.y);
+        __guac_common_surface_record_damage(dst, &drect);
         dst->realized = 1;
     }
 
@@ -1593,8 +1907,15 @@ void guac_common_surface_set(guac_common_surface* surface,
     /* Otherwise, flush and draw immediately */
     else {
         __guac_common_surface_flush(surface);
-        guac_protocol_send_rect(socket, layer, rect.x, rect.y, rect.width, rect.height);
-        guac_protocol_send_cfill(socket, GUAC_COMP_OVER, layer, red, green, blue, alpha);
+
+        char buffer[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH * 2];
+        guac_protocol_batch batch;
+        guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
+
+        guac_protocol_batch_rect(&batch, layer, rect.x, rect.y, rect.width, rect.height);
+        guac_protocol_batch_cfill(&batch, GUAC_COMP_OVER, layer, red, green, blue, alpha);
+        guac_protocol_batch_flush(&batch);
+        __guac_common_surface_record_damage(surface, &rect);
         surface->realized = 1;
     }
 
@@ -1629,95 +1950,367 @@ void guac_common_surface_reset_clip(guac_common_surface* surface) {
 }
 
 /**
- * Flushes the bitmap update currently described by the dirty rectangle within
- * the given surface directly via an "img" instruction as PNG data. The
- * resulting instructions will be sent over the socket associated with the
- * given surface.
+ * Returns an appropriate quality between 0 and 100 for lossy encoding
+ * depending on the current processing lag calculated for the given client.
+ *
+ * @param client
+ *     The client for which the lossy quality is being calculated.
+ *
+ * @return
+ *     A value between 0 and 100 inclusive which seems appropriate for the
+ *     client based on lag measurements.
+ */
+static int guac_common_surface_suggest_quality(guac_client* client) {
+
+    int lag = guac_client_get_processing_lag(client);
+
+    /* Scale quality linearly from 90 to 30 as lag varies from 20ms to 80ms */
+    int quality = 90 - (lag - 20);
+
+    /* Do not exceed 90 for quality */
+    if (quality > 90)
+        return 90;
+
+    /* Do not go below 30 for quality */
+    if (quality < 30)
+        return 30;
+
+    return quality;
+
+}
+
+/**
+ * Chooses the encoding parameters to use for the current flush of the given
+ * surface, storing them within the surface. If the surface has a quality
+ * controller, the parameters most recently chosen by that controller are
+ * used. Otherwise, quality is chosen based on processing lag alone and all
+ * other parameters take their uncongested values. The surface must be
+ * locked.
  *
  * @param surface
- *     The surface to flush.
+ *     The surface whose encoding parameters should be chosen.
+ */
+static void __guac_common_surface_update_quality(
+        guac_common_surface* surface) {
+
+    guac_common_quality_params* params = &surface->quality_params;
+
+    if (surface->quality_controller != NULL) {
+        guac_common_quality_controller_get(surface->quality_controller,
+                params);
+        return;
+    }
+
+    params->quality = guac_common_surface_suggest_quality(surface->client);
+    params->lossy_framerate = GUAC_COMMON_QUALITY_LOSSY_FRAMERATE;
+    params->frame_duration = 0;
+    params->webp_method = GUAC_COMMON_QUALITY_WEBP_METHOD;
+    params->png_compression = GUAC_COMMON_QUALITY_PNG_COMPRESSION;
+
+}
+
+/**
+ * The image formats which may be used to send updated surface contents.
+ */
+typedef enum guac_common_surface_format {
+
+    /**
+     * Lossless PNG.
+     */
+    GUAC_COMMON_SURFACE_PNG,
+
+    /**
+     * Lossy JPEG. JPEG images are always opaque.
+     */
+    GUAC_COMMON_SURFACE_JPEG,
+
+    /**
+     * WebP, which may be lossy or lossless.
+     */
+    GUAC_COMMON_SURFACE_WEBP,
+
+    /**
+     * No image at all. The image is instead copied from the buffer of an
+     * image cache which already contains identical contents.
+     */
+    GUAC_COMMON_SURFACE_CACHED
+
+} guac_common_surface_format;
+
+/**
+ * A single image which must be encoded and sent to update the contents of a
+ * surface, either immediately or by the encode pool of that surface.
+ */
+typedef struct guac_common_surface_image {
+
+    /**
+     * The client whose streams should be used to send the image.
+     */
+    guac_client* client;
+
+    /**
+     * The layer that the image should be drawn to.
+     */
+    const guac_layer* layer;
+
+    /**
+     * The format that the image should be encoded as.
+     */
+    guac_common_surface_format format;
+
+    /**
+     * The area of the layer that the image covers.
+     */
+    guac_common_rect rect;
+
+    /**
+     * Cairo surface pointing directly to the image data within the buffer of
+     * the surface being flushed.
+     */
+    cairo_surface_t* data;
+
+    /**
+     * Whether the image contains only fully-opaque pixels.
+     */
+    int opaque;
+
+    /**
+     * The quality to use for lossy encoding, between 0 and 100 inclusive.
+     */
+    int quality;
+
+    /**
+     * Whether WebP encoding should be lossless.
+     */
+    int lossless;
+
+    /**
+     * The WebP compression method to use, between 0 and 6 inclusive.
+     */
+    int webp_method;
+
+    /**
+     * The zlib compression level to use for PNG images, between 0 and 9
+     * inclusive.
+     */
+    int png_compression;
+
+    /**
+     * For GUAC_COMMON_SURFACE_CACHED, the image cache buffer containing the
+     * image within its upper-left corner. For all other formats, the image
+     * cache buffer which should receive a copy of the image once sent, or
+     * NULL if the image is not being cached.
+     */
+    const guac_layer* buffer;
+
+} guac_common_surface_image;
+
+/**
+ * Encodes and sends the given image over the given socket, destroying the
+ * Cairo surface of the image afterward. If the image is stored within an
+ * image cache, the image is copied from or to the relevant cache buffer.
  *
- * @param opaque
- *     Whether the rectangle being flushed contains only fully-opaque pixels.
+ * @param socket
+ *     The socket to send the image over.
+ *
+ * @param image
+ *     The image to send.
  */
-static void __guac_common_surface_flush_to_png(guac_common_surface* surface,
-        int opaque) {
+static void __guac_common_surface_image_send(guac_socket* socket,
+        guac_common_surface_image* image) {
 
-    if (surface->dirty) {
+    const guac_layer* layer = image->layer;
 
-        guac_socket* socket = surface->socket;
-        const guac_layer* layer = surface->layer;
+    switch (image->format) {
 
-        /* Get Cairo surface for specified rect */
-        unsigned char* buffer = surface->buffer
-                              + surface->dirty_rect.y * surface->stride
-                              + surface->dirty_rect.x * 4;
+        case GUAC_COMMON_SURFACE_PNG:
 
-        cairo_surface_t* rect;
+            /* Clear destination rect first if the image has transparency */
+            if (!image->opaque) {
 
-        /* Use RGB24 if the image is fully opaque */
-        if (opaque)
-            rect = cairo_image_surface_create_for_data(buffer,
-                    CAIRO_FORMAT_RGB24, surface->dirty_rect.width,
-                    surface->dirty_rect.height, surface->stride);
+                char buffer[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH * 2];
+                guac_protocol_batch batch;
+                guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
 
-        /* Otherwise ARGB32 is needed */
-        else {
+                guac_protocol_batch_rect(&batch, layer,
+                        image->rect.x, image->rect.y,
+                        image->rect.width, image->rect.height);
+                guac_protocol_batch_cfill(&batch, GUAC_COMP_ROUT, layer,
+                        0x00, 0x00, 0x00, 0xFF);
+                guac_protocol_batch_flush(&batch);
 
-            rect = cairo_image_surface_create_for_data(buffer,
-                    CAIRO_FORMAT_ARGB32, surface->dirty_rect.width,
-                    surface->dirty_rect.height, surface->stride);
+            }
 
-            /* Clear destination rect first */
-            guac_protocol_send_rect(socket, layer,
-                    surface->dirty_rect.x, surface->dirty_rect.y,
-                    surface->dirty_rect.width, surface->dirty_rect.height);
-            guac_protocol_send_cfill(socket, GUAC_COMP_ROUT, layer,
-                    0x00, 0x00, 0x00, 0xFF);
+            guac_client_stream_png_compressed(image->client, socket,
+                    GUAC_COMP_OVER, layer, image->rect.x, image->rect.y,
+                    image->data, image->png_compression,
+                    GUAC_PNG_FILTER_DEFAULT);
+            break;
 
-        }
+        case GUAC_COMMON_SURFACE_JPEG:
+            guac_client_stream_jpeg(image->client, socket, GUAC_COMP_OVER,
+                    layer, image->rect.x, image->rect.y, image->data,
+                    image->quality);
+            break;
 
-        /* Send PNG for rect */
-        guac_client_stream_png(surface->client, socket, GUAC_COMP_OVER,
-                layer, surface->dirty_rect.x, surface->dirty_rect.y, rect);
+        case GUAC_COMMON_SURFACE_WEBP:
+            guac_client_stream_webp_method(image->client, socket,
+                    GUAC_COMP_OVER, layer, image->rect.x, image->rect.y,
+                    image->data, image->quality, image->lossless,
+                    image->webp_method);
+            break;
 
-        cairo_surface_destroy(rect);
-        surface->realized = 1;
+        /* Identical contents are already present within a buffer */
+        case GUAC_COMMON_SURFACE_CACHED:
+            guac_protocol_send_copy(socket, image->buffer, 0, 0,
+                    image->rect.width, image->rect.height, GUAC_COMP_SRC,
+                    layer, image->rect.x, image->rect.y);
+            return;
 
-        /* Surface is no longer dirty */
-        surface->dirty = 0;
+    }
 
+    /* Store copy of image within cache buffer, if requested */
+    if (image->buffer != NULL) {
+        guac_protocol_send_size(socket, image->buffer,
+                image->rect.width, image->rect.height);
+        guac_protocol_send_copy(socket, layer, image->rect.x, image->rect.y,
+                image->rect.width, image->rect.height, GUAC_COMP_SRC,
+                image->buffer, 0, 0);
     }
 
+    cairo_surface_destroy(image->data);
+
 }
 
 /**
- * Returns an appropriate quality between 0 and 100 for lossy encoding
- * depending on the current processing lag calculated for the given client.
+ * Encode pool handler which encodes and sends a guac_common_surface_image,
+ * freeing the image afterward.
  *
- * @param client
- *     The client for which the lossy quality is being calculated.
+ * @param socket
+ *     The socket to send the image over.
  *
- * @return
- *     A value between 0 and 100 inclusive which seems appropriate for the
- *     client based on lag measurements.
+ * @param data
+ *     The guac_common_surface_image to send.
  */
-static int guac_common_surface_suggest_quality(guac_client* client) {
+static void __guac_common_surface_image_handler(guac_socket* socket,
+        void* data) {
 
-    int lag = guac_client_get_processing_lag(client);
+    guac_common_surface_image* image = (guac_common_surface_image*) data;
 
-    /* Scale quality linearly from 90 to 30 as lag varies from 20ms to 80ms */
-    int quality = 90 - (lag - 20);
+    __guac_common_surface_image_send(socket, image);
+    free(image);
 
-    /* Do not exceed 90 for quality */
-    if (quality > 90)
-        return 90;
+}
 
-    /* Do not go below 30 for quality */
-    if (quality < 30)
-        return 30;
+/**
+ * Sends the bitmap update currently described by the dirty rectangle within
+ * the given surface via an "img" instruction using the given format, marking
+ * the surface as no longer dirty. If the surface has an image cache which
+ * already contains identical contents, those contents are copied from the
+ * cache rather than sent as an image. If the surface has an encode pool, the
+ * image is submitted to that pool and is sent when the pool is flushed.
+ * Otherwise, the image is encoded and sent immediately over the socket
+ * associated with the given surface.
+ *
+ * @param surface
+ *     The surface to flush.
+ *
+ * @param format
+ *     The image format to use.
+ *
+ * @param opaque
+ *     Whether the rectangle being flushed contains only fully-opaque pixels.
+ */
+static void __guac_common_surface_flush_image(guac_common_surface* surface,
+        guac_common_surface_format format, int opaque) {
+
+    guac_common_surface_image image = {
+        .client = surface->client,
+        .layer  = surface->layer,
+        .format = format,
+        .rect   = surface->dirty_rect,
+        .opaque = opaque
+    };
 
-    return quality;
+    /* Compression parameters are determined at the time of flush */
+    if (format != GUAC_COMMON_SURFACE_PNG) {
+        image.quality = surface->quality_params.quality;
+        image.lossless = surface->lossless ? 1 : 0;
+        image.webp_method = surface->quality_params.webp_method;
+    }
+    else
+        image.png_compression = surface->quality_params.png_compression;
+
+    /* Get Cairo surface for specified rect */
+    unsigned char* buffer = surface->buffer
+                          + surface->dirty_rect.y * surface->stride
+                          + surface->dirty_rect.x * 4;
+
+    /* Use RGB24 if the image is fully opaque, otherwise ARGB32 is needed */
+    image.data = cairo_image_surface_create_for_data(buffer,
+            opaque ? CAIRO_FORMAT_RGB24 : CAIRO_FORMAT_ARGB32,
+            surface->dirty_rect.width, surface->dirty_rect.height,
+            surface->stride);
+
+    /* Reuse identical contents sent previously, if possible */
+    guac_common_image_cache* cache = surface->image_cache;
+    if (cache != NULL && guac_common_image_cache_lookup(cache, image.data,
+                &image.buffer) == GUAC_COMMON_IMAGE_CACHE_HIT) {
+        cairo_surface_destroy(image.data);
+        image.data = NULL;
+        image.format = GUAC_COMMON_SURFACE_CACHED;
+    }
+
+    guac_common_encode_pool* pool = surface->encode_pool;
+    if (pool != NULL) {
+
+        /* Encode concurrently if possible */
+        guac_common_surface_image* pending = malloc(sizeof(image));
+        if (pending != NULL) {
+
+            *pending = image;
+            if (!guac_common_encode_pool_submit(pool,
+                        __guac_common_surface_image_handler, pending))
+                goto sent;
+
+            free(pending);
+
+        }
+
+        /* Otherwise, send in order after all images submitted thus far */
+        guac_common_encode_pool_flush(pool, surface->socket);
+        guac_common_encode_pool_begin(pool);
+
+    }
+
+    __guac_common_surface_image_send(surface->socket, &image);
+
+sent:
+    surface->realized = 1;
+
+    /* Surface is no longer dirty */
+    surface->dirty = 0;
+
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface directly via an "img" instruction as PNG data. The
+ * resulting instructions will be sent over the socket associated with the
+ * given surface.
+ *
+ * @param surface
+ *     The surface to flush.
+ *
+ * @param opaque
+ *     Whether the rectangle being flushed contains only fully-opaque pixels.
+ */
+static void __guac_common_surface_flush_to_png(guac_common_surface* surface,
+        int opaque) {
+
+    if (surface->dirty)
+        __guac_common_surface_flush_image(surface, GUAC_COMMON_SURFACE_PNG,
+                opaque);
 
 }
 
@@ -1734,9 +2327,6 @@ static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface) {
 
     if (surface->dirty) {
 
-        guac_socket* socket = surface->socket;
-        const guac_layer* layer = surface->layer;
-
         guac_common_rect max;
         guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
 
@@ -1745,25 +2335,7 @@ static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface) {
         guac_common_rect_expand_to_grid(GUAC_SURFACE_JPEG_BLOCK_SIZE,
                                         &surface->dirty_rect, &max);
 
-        /* Get Cairo surface for specified rect */
-        unsigned char* buffer = surface->buffer
-                              + surface->dirty_rect.y * surface->stride
-                              + surface->dirty_rect.x * 4;
-
-        cairo_surface_t* rect = cairo_image_surface_create_for_data(buffer,
-                CAIRO_FORMAT_RGB24, surface->dirty_rect.width,
-                surface->dirty_rect.height, surface->stride);
-
-        /* Send JPEG for rect */
-        guac_client_stream_jpeg(surface->client, socket, GUAC_COMP_OVER, layer,
-                surface->dirty_rect.x, surface->dirty_rect.y, rect,
-                guac_common_surface_suggest_quality(surface->client));
-
-        cairo_surface_destroy(rect);
-        surface->realized = 1;
-
-        /* Surface is no longer dirty */
-        surface->dirty = 0;
+        __guac_common_surface_flush_image(surface, GUAC_COMMON_SURFACE_JPEG, 1);
 
     }
 
@@ -1786,9 +2358,6 @@ static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
 
     if (surface->dirty) {
 
-        guac_socket* socket = surface->socket;
-        const guac_layer* layer = surface->layer;
-
         guac_common_rect max;
         guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
 
@@ -1797,64 +2366,13 @@ static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
         guac_common_rect_expand_to_grid(GUAC_SURFACE_WEBP_BLOCK_SIZE,
                                         &surface->dirty_rect, &max);
 
-        /* Get Cairo surface for specified rect */
-        unsigned char* buffer = surface->buffer
-                              + surface->dirty_rect.y * surface->stride
-                              + surface->dirty_rect.x * 4;
-
-        cairo_surface_t* rect;
-
-        /* Use RGB24 if the image is fully opaque */
-        if (opaque)
-            rect = cairo_image_surface_create_for_data(buffer,
-                    CAIRO_FORMAT_RGB24, surface->dirty_rect.width,
-                    surface->dirty_rect.height, surface->stride);
-
-        /* Otherwise ARGB32 is needed */
-        else
-            rect = cairo_image_surface_create_for_data(buffer,
-                    CAIRO_FORMAT_ARGB32, surface->dirty_rect.width,
-                    surface->dirty_rect.height, surface->stride);
-
-        /* Send WebP for rect */
-        guac_client_stream_webp(surface->client, socket, GUAC_COMP_OVER, layer,
-                surface->dirty_rect.x, surface->dirty_rect.y, rect,
-                guac_common_surface_suggest_quality(surface->client),
-                surface->lossless ? 1 : 0);
-
-        cairo_surface_destroy(rect);
-        surface->realized = 1;
-
-        /* Surface is no longer dirty */
-        surface->dirty = 0;
+        __guac_common_surface_flush_image(surface, GUAC_COMMON_SURFACE_WEBP,
+                opaque);
 
     }
 
 }
 
-/**
- * Comparator for instances of guac_common_surface_bitmap_rect, the elements
- * which make up a surface's bitmap buffer.
- *
- * @see qsort
- */
-static int __guac_common_surface_bitmap_rect_compare(const void* a, const void* b) {
-
-    guac_common_surface_bitmap_rect* ra = (guac_common_surface_bitmap_rect*) a;
-    guac_common_surface_bitmap_rect* rb = (guac_common_surface_bitmap_rect*) b;
-
-    /* Order roughly top to bottom, left to right */
-    if (ra->rect.y != rb->rect.y) return ra->rect.y - rb->rect.y;
-    if (ra->rect.x != rb->rect.x) return ra->rect.x - rb->rect.x;
-
-    /* Wider updates should come first (more likely to intersect later) */
-    if (ra->rect.width != rb->rect.width) return rb->rect.width - ra->rect.width;
-
-    /* Shorter updates should come first (less likely to increase cost) */
-    return ra->rect.height - rb->rect.height;
-
-}
-
 /**
  * Flushes only the properties of the given surface, such as layer location or
  * opacity. Image state is not flushed. If the surface represents a buffer or
@@ -1889,89 +2407,61 @@ static void __guac_common_surface_flush_properties(
 
 static void __guac_common_surface_flush(guac_common_surface* surface) {
 
-    /* Flush final dirty rectangle to queue. */
-    __guac_common_surface_flush_to_queue(surface);
-
-    guac_common_surface_bitmap_rect* current = surface->bitmap_queue;
-    int i, j;
-    int original_queue_length;
-    int flushed = 0;
-
-    original_queue_length = surface->bitmap_queue_length;
-
-    /* Sort updates to make combination less costly */
-    qsort(surface->bitmap_queue, surface->bitmap_queue_length, sizeof(guac_common_surface_bitmap_rect),
-          __guac_common_surface_bitmap_rect_compare);
+    guac_common_region* region = surface->bitmap_region;
 
-    /* Flush all rects in queue */
-    for (i=0; i < surface->bitmap_queue_length; i++) {
+    /* Choose encoding parameters for all images within this flush */
+    __guac_common_surface_update_quality(surface);
 
-        /* Get next unflushed candidate */
-        guac_common_surface_bitmap_rect* candidate = current;
-        if (!candidate->flushed) {
+    /* Flush final dirty rectangle to region */
+    __guac_common_surface_flush_to_region(surface);
 
-            int combined = 0;
+    /* Clip updates within current bounds */
+    guac_common_rect bounds;
+    guac_common_rect_init(&bounds, 0, 0, surface->width, surface->height);
+    guac_common_region_clip(region, &bounds);
 
-            /* Build up rect as much as possible */
-            for (j=i; j < surface->bitmap_queue_length; j++) {
+    /* Combine updates wherever estimated to be less costly */
+    guac_common_region_coalesce(region,
+            __guac_common_surface_region_combine, surface);
 
-                if (!candidate->flushed) {
+    /* Encode images concurrently if an encode pool is available */
+    guac_common_encode_pool* pool = surface->encode_pool;
+    if (pool != NULL)
+        guac_common_encode_pool_begin(pool);
 
-                    /* Clip candidate within current bounds */
-                    __guac_common_bound_rect(surface, &candidate->rect, NULL, NULL);
-                    if (candidate->rect.width <= 0 || candidate->rect.height <= 0)
-                        candidate->flushed = 1;
+    /* Flush each combined update as a bitmap */
+    for (int i = 0; i < region->count; i++) {
 
-                    /* Combine if reasonable */
-                    else if (__guac_common_should_combine(surface, &candidate->rect, 0) || !surface->dirty) {
-                        __guac_common_mark_dirty(surface, &candidate->rect);
-                        candidate->flushed = 1;
-                        combined++;
-                    }
-
-                }
-
-                candidate++;
-
-            }
-
-            /* Re-add to queue if there's room and this update was modified or we expect others might be */
-            if ((combined > 1 || i < original_queue_length)
-                    && surface->bitmap_queue_length < GUAC_COMMON_SURFACE_QUEUE_SIZE)
-                __guac_common_surface_flush_to_queue(surface);
-
-            /* Flush as bitmap otherwise */
-            else if (surface->dirty) {
-
-                flushed++;
-
-                int opaque = __guac_common_surface_is_opaque(surface,
-                            &surface->dirty_rect);
-
-                /* Prefer WebP when reasonable */
-                if (__guac_common_surface_should_use_webp(surface,
-                            &surface->dirty_rect))
-                    __guac_common_surface_flush_to_webp(surface, opaque);
+        surface->dirty_rect = region->rects[i];
+        surface->dirty = 1;
 
-                /* If not WebP, JPEG is the next best (lossy) choice */
-                else if (opaque && __guac_common_surface_should_use_jpeg(
-                            surface, &surface->dirty_rect))
-                    __guac_common_surface_flush_to_jpeg(surface);
+        __guac_common_surface_record_damage(surface, &surface->dirty_rect);
 
-                /* Use PNG if no lossy formats are appropriate */
-                else
-                    __guac_common_surface_flush_to_png(surface, opaque);
+        int opaque = __guac_common_surface_is_opaque(surface,
+                    &surface->dirty_rect);
 
-            }
+        /* Prefer WebP when reasonable */
+        if (__guac_common_surface_should_use_webp(surface,
+                    &surface->dirty_rect))
+            __guac_common_surface_flush_to_webp(surface, opaque);
 
-        }
+        /* If not WebP, JPEG is the next best (lossy) choice */
+        else if (opaque && __guac_common_surface_should_use_jpeg(
+                    surface, &surface->dirty_rect))
+            __guac_common_surface_flush_to_jpeg(surface);
 
-        current++;
+        /* Use PNG if no lossy formats are appropriate */
+        else
+            __guac_common_surface_flush_to_png(surface, opaque);
 
     }
 
+    /* Send all concurrently-encoded images in their original order */
+    if (pool != NULL)
+        guac_common_encode_pool_flush(pool, surface->socket);
+
     /* Flush complete */
-    surface->bitmap_queue_length = 0;
+    guac_common_region_clear(region);
 
 }
 
@@ -1985,19 +2475,26 @@ void guac_common_surface_flush(guac_common_surface* surface) {
     /* Flush surface contents */
     __guac_common_surface_flush(surface);
 
+    /* Nothing remains to be sent until the surface is next changed */
+    surface->flush_pending = 0;
+
     pthread_mutex_unlock(&surface->_lock);
 
 }
 
-void guac_common_surface_dup(guac_common_surface* surface, guac_user* user,
+/**
+ * Sends the layer-specific properties of the given surface, as well as its
+ * size, over the given socket. The surface must be locked.
+ *
+ * @param surface
+ *     The surface whose properties should be sent.
+ *
+ * @param socket
+ *     The socket over which the surface properties should be sent.
+ */
+static void __guac_common_surface_dup_properties(guac_common_surface* surface,
         guac_socket* socket) {
 
-    pthread_mutex_lock(&surface->_lock);
-
-    /* Do nothing if not realized */
-    if (!surface->realized)
-        goto complete;
-
     /* Synchronize layer-specific properties if applicable */
     if (surface->layer->index > 0) {
 
@@ -2009,7 +2506,7 @@ void guac_common_surface_dup(guac_common_surface* surface, guac_user* user,
                 surface->parent, surface->x, surface->y, surface->z);
 
         /* Synchronize multi-touch support level */
-        guac_protocol_send_set_int(surface->socket, surface->layer,
+        guac_protocol_send_set_int(socket, surface->layer,
                 GUAC_PROTOCOL_LAYER_PARAMETER_MULTI_TOUCH,
                 surface->touches);
 
@@ -2019,19 +2516,82 @@ void guac_common_surface_dup(guac_common_surface* surface, guac_user* user,
     guac_protocol_send_size(socket, surface->layer,
             surface->width, surface->height);
 
-    /* Send contents of layer, if non-empty */
-    if (surface->width > 0 && surface->height > 0) {
+}
 
-        /* Get entire surface */
-        cairo_surface_t* rect = cairo_image_surface_create_for_data(
-                surface->buffer, CAIRO_FORMAT_ARGB32,
-                surface->width, surface->height, surface->stride);
+/**
+ * Sends the contents of the given rectangle of the given surface to the
+ * given user as a PNG image. The surface must be locked.
+ *
+ * @param surface
+ *     The surface whose contents should be sent.
+ *
+ * @param user
+ *     The user receiving the surface contents.
+ *
+ * @param socket
+ *     The socket over which the surface contents should be sent.
+ *
+ * @param rect
+ *     The rectangle of the surface to send, which must be within the bounds
+ *     of the surface.
+ *
+ * @param replace
+ *     Non-zero if the rectangle may already have contents on the remote
+ *     display which must be cleared, zero if the rectangle is known to be
+ *     empty.
+ */
+static void __guac_common_surface_dup_rect(guac_common_surface* surface,
+        guac_user* user, guac_socket* socket, const guac_common_rect* rect,
+        int replace) {
+
+    const guac_layer* layer = surface->layer;
+
+    /* Get Cairo surface for specified rect */
+    unsigned char* data = surface->buffer
+                        + rect->y * surface->stride
+                        + rect->x * 4;
+
+    cairo_surface_t* image = cairo_image_surface_create_for_data(data,
+            CAIRO_FORMAT_ARGB32, rect->width, rect->height, surface->stride);
+
+    /* Clear any existing contents first */
+    if (replace) {
+
+        char buffer[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH * 2];
+        guac_protocol_batch batch;
+        guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
+
+        guac_protocol_batch_rect(&batch, layer,
+                rect->x, rect->y, rect->width, rect->height);
+        guac_protocol_batch_cfill(&batch, GUAC_COMP_ROUT, layer,
+                0x00, 0x00, 0x00, 0xFF);
+        guac_protocol_batch_flush(&batch);
+
+    }
 
-        /* Send PNG for rect */
-        guac_user_stream_png(user, socket, GUAC_COMP_OVER, surface->layer,
-                0, 0, rect);
-        cairo_surface_destroy(rect);
+    /* Send PNG for rect */
+    guac_user_stream_png(user, socket, GUAC_COMP_OVER, layer,
+            rect->x, rect->y, image);
+    cairo_surface_destroy(image);
 
+}
+
+void guac_common_surface_dup(guac_common_surface* surface, guac_user* user,
+        guac_socket* socket) {
+
+    pthread_mutex_lock(&surface->_lock);
+
+    /* Do nothing if not realized */
+    if (!surface->realized)
+        goto complete;
+
+    __guac_common_surface_dup_properties(surface, socket);
+
+    /* Send contents of layer, if non-empty */
+    if (surface->width > 0 && surface->height > 0) {
+        guac_common_rect rect;
+        guac_common_rect_init(&rect, 0, 0, surface->width, surface->height);
+        __guac_common_surface_dup_rect(surface, user, socket, &rect, 0);
     }
 
 complete:
@@ -2039,3 +2599,68 @@ complete:
 
 }
 
+void guac_common_surface_lock(guac_common_surface* surface) {
+    pthread_mutex_lock(&surface->_lock);
+}
+
+int guac_common_surface_trylock(guac_common_surface* surface) {
+    return pthread_mutex_trylock(&surface->_lock);
+}
+
+void guac_common_surface_unlock(guac_common_surface* surface) {
+    pthread_mutex_unlock(&surface->_lock);
+}
+
+void guac_common_surface_resync(guac_common_surface* surface,
+        guac_user* user, guac_socket* socket, guac_timestamp since) {
+
+    /* Do nothing if not realized */
+    if (!surface->realized)
+        return;
+
+    __guac_common_surface_dup_properties(surface, socket);
+
+    /* Nothing further to send if empty */
+    if (surface->width <= 0 || surface->height <= 0)
+        return;
+
+    guac_common_rect rect;
+    guac_common_rect_init(&rect, 0, 0, surface->width, surface->height);
+
+    /* Send only the union of all damage since the given frame, if that
+     * damage is still tracked */
+    if (since > surface->damage_base) {
+
+        int damaged = 0;
+        for (int i = 0; i < surface->damage_length; i++) {
+
+            int index = (surface->oldest_damage + i)
+                      % GUAC_COMMON_SURFACE_DAMAGE_HISTORY_SIZE;
+
+            guac_common_surface_damage* damage = &surface->damage[index];
+            if (damage->frame < since)
+                continue;
+
+            if (damaged)
+                guac_common_rect_extend(&rect, &damage->rect);
+            else
+                rect = damage->rect;
+
+            damaged = 1;
+
+        }
+
+        /* Nothing to send if unchanged */
+        if (!damaged)
+            return;
+
+        /* Damage may predate any decrease in size */
+        __guac_common_bound_rect(surface, &rect, NULL, NULL);
+        if (rect.width <= 0 || rect.height <= 0)
+            return;
+
+    }
+
+    __guac_common_surface_dup_rect(surface, user, socket, &rect, 1);
+
+}
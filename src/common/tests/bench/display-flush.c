@@ -0,0 +1,374 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Benchmark which replays a scripted desktop session against a 4K display,
+ * timing each guac_common_display_flush() with differing numbers of encoding
+ * threads. The session mixes full-screen redraws, moving windows containing
+ * photographic content, and many small text-like updates, while many other
+ * layers remain idle. This program is not run as part of "make check", and
+ * must be built explicitly with "make bench_display_flush".
+ *
+ * Usage: bench_display_flush [FRAMES [THREADS...]]
+ */
+
+#include "common/display.h"
+#include "common/surface.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * The width of the display, in pixels.
+ */
+#define BENCH_WIDTH 3840
+
+/**
+ * The height of the display, in pixels.
+ */
+#define BENCH_HEIGHT 2160
+
+/**
+ * The default number of frames to replay for each number of threads.
+ */
+#define BENCH_DEFAULT_FRAMES 40
+
+/**
+ * The number of frames between each full-screen redraw.
+ */
+#define BENCH_FULL_REDRAW_INTERVAL 8
+
+/**
+ * The number of text-like updates drawn within each frame that is not a
+ * full-screen redraw.
+ */
+#define BENCH_TEXT_UPDATES 48
+
+/**
+ * The number of window-sized updates drawn within each frame that is not a
+ * full-screen redraw.
+ */
+#define BENCH_WINDOW_UPDATES 3
+
+/**
+ * The number of additional layers allocated alongside the default layer but
+ * never drawn to, as with the many mostly-idle windows of a RemoteApp
+ * session.
+ */
+#define BENCH_IDLE_LAYERS 64
+
+/**
+ * The total number of bytes written to the display's socket.
+ */
+static uint64_t bench_bytes_written;
+
+/**
+ * Returns the current value of the monotonic clock, in nanoseconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in nanoseconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * Socket write handler which discards all data, counting the number of bytes
+ * written.
+ *
+ * @param socket
+ *     The socket being written to.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param count
+ *     The number of bytes to write.
+ *
+ * @return
+ *     Always count.
+ */
+static ssize_t bench_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+    bench_bytes_written += count;
+    return count;
+}
+
+/**
+ * Returns the next value of a simple linear congruential generator, such
+ * that each replay of the session is identical.
+ *
+ * @param state
+ *     The current state of the generator, which will be updated.
+ *
+ * @return
+ *     The next pseudo-random value, between 0 and 2^31 - 1 inclusive.
+ */
+static int bench_random(uint32_t* state) {
+    *state = *state * 1103515245 + 12345;
+    return (*state >> 1) & 0x7FFFFFFF;
+}
+
+/**
+ * Allocates an opaque image of the given size containing smooth gradients
+ * with low-level noise, resembling photographic content.
+ *
+ * @param width
+ *     The width of the image, in pixels.
+ *
+ * @param height
+ *     The height of the image, in pixels.
+ *
+ * @param seed
+ *     An arbitrary value which determines the content of the image.
+ *
+ * @return
+ *     A newly-allocated image surface.
+ */
+static cairo_surface_t* bench_create_photo(int width, int height, int seed) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            width, height);
+
+    unsigned char* data = cairo_image_surface_get_data(image);
+    int stride = cairo_image_surface_get_stride(image);
+    uint32_t state = seed;
+
+    for (int y = 0; y < height; y++) {
+        uint32_t* row = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < width; x++) {
+            int noise = bench_random(&state) & 0x0F;
+            int red   = ((x + seed) * 255 / width + noise) & 0xFF;
+            int green = ((y + seed) * 255 / height + noise) & 0xFF;
+            int blue  = ((x + y) / 8 + seed + noise) & 0xFF;
+            row[x] = 0xFF000000 | (red << 16) | (green << 8) | blue;
+        }
+    }
+
+    cairo_surface_mark_dirty(image);
+    return image;
+
+}
+
+/**
+ * Allocates an opaque image of the given size containing dark, text-like
+ * glyph patterns on a light background.
+ *
+ * @param width
+ *     The width of the image, in pixels.
+ *
+ * @param height
+ *     The height of the image, in pixels.
+ *
+ * @param seed
+ *     An arbitrary value which determines the content of the image.
+ *
+ * @return
+ *     A newly-allocated image surface.
+ */
+static cairo_surface_t* bench_create_text(int width, int height, int seed) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            width, height);
+
+    unsigned char* data = cairo_image_surface_get_data(image);
+    int stride = cairo_image_surface_get_stride(image);
+    uint32_t state = seed;
+
+    for (int y = 0; y < height; y++) {
+        uint32_t* row = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < width; x++)
+            row[x] = 0xFFF0F0F0;
+    }
+
+    /* Draw 8x12 "glyphs" consisting of random strokes */
+    for (int gx = 0; gx + 8 <= width; gx += 9) {
+        for (int gy = 0; gy + 12 <= height; gy += 14) {
+            int strokes = bench_random(&state);
+            for (int y = 0; y < 12; y++) {
+                uint32_t* row = (uint32_t*) (data + (gy + y) * stride);
+                for (int x = 0; x < 8; x++) {
+                    if (strokes & (1 << ((x + y * 3) % 31)))
+                        row[gx + x] = 0xFF202020;
+                }
+            }
+        }
+    }
+
+    cairo_surface_mark_dirty(image);
+    return image;
+
+}
+
+/**
+ * Replays the benchmark session against a new display using the given number
+ * of encoding threads, printing the time taken by all display flushes.
+ *
+ * @param threads
+ *     The number of threads that should encode images.
+ *
+ * @param frames
+ *     The number of frames to replay.
+ *
+ * @param photo
+ *     A full-screen image containing photographic content.
+ *
+ * @param text
+ *     A wide image containing text-like content.
+ *
+ * @return
+ *     The total time taken by all display flushes, in nanoseconds.
+ */
+static double bench_replay(int threads, int frames, cairo_surface_t* photo,
+        cairo_surface_t* text) {
+
+    guac_client* client = guac_client_alloc();
+
+    /* Discard all output, counting bytes written. The original broadcast
+     * socket is restored before the client is freed. */
+    client->socket = guac_socket_alloc();
+    client->socket->write_handler = bench_write_handler;
+
+    guac_common_display* display = guac_common_display_alloc(client,
+            BENCH_WIDTH, BENCH_HEIGHT);
+    guac_common_display_set_lossless(display, 0);
+    guac_common_display_set_encode_threads(display, threads);
+
+    guac_common_surface* surface = display->default_surface;
+
+    /* Allocate idle layers, which need not be visited by each flush */
+    for (int i = 0; i < BENCH_IDLE_LAYERS; i++)
+        guac_common_display_alloc_layer(display, 256, 256);
+
+    unsigned char* photo_data = cairo_image_surface_get_data(photo);
+    int photo_stride = cairo_image_surface_get_stride(photo);
+
+    unsigned char* text_data = cairo_image_surface_get_data(text);
+    int text_stride = cairo_image_surface_get_stride(text);
+    int text_width = cairo_image_surface_get_width(text);
+    int text_height = cairo_image_surface_get_height(text);
+
+    uint32_t state = 1;
+    double elapsed = 0;
+    bench_bytes_written = 0;
+
+    for (int frame = 0; frame < frames; frame++) {
+
+        /* Periodically redraw the entire screen, scrolling the content */
+        if (frame % BENCH_FULL_REDRAW_INTERVAL == 0) {
+            int offset = (frame / BENCH_FULL_REDRAW_INTERVAL) * 16;
+            cairo_surface_t* src = cairo_image_surface_create_for_data(
+                    photo_data + offset * photo_stride, CAIRO_FORMAT_RGB24,
+                    BENCH_WIDTH, BENCH_HEIGHT, photo_stride);
+            guac_common_surface_draw(surface, 0, 0, src);
+            cairo_surface_destroy(src);
+        }
+
+        else {
+
+            /* Move several windows of photographic content */
+            for (int i = 0; i < BENCH_WINDOW_UPDATES; i++) {
+                int x = bench_random(&state) % (BENCH_WIDTH - 1280);
+                int y = bench_random(&state) % (BENCH_HEIGHT - 720);
+                cairo_surface_t* src = cairo_image_surface_create_for_data(
+                        photo_data + y * photo_stride + x * 4,
+                        CAIRO_FORMAT_RGB24, 1280, 720, photo_stride);
+                guac_common_surface_draw(surface, x, y, src);
+                cairo_surface_destroy(src);
+            }
+
+            /* Update lines of text throughout the screen */
+            for (int i = 0; i < BENCH_TEXT_UPDATES; i++) {
+                int width = 64 + bench_random(&state) % (text_width - 64);
+                int sy = bench_random(&state) % (text_height - 14);
+                int x = bench_random(&state) % (BENCH_WIDTH - width);
+                int y = bench_random(&state) % (BENCH_HEIGHT - 14);
+                cairo_surface_t* src = cairo_image_surface_create_for_data(
+                        text_data + sy * text_stride, CAIRO_FORMAT_RGB24,
+                        width, 14, text_stride);
+                guac_common_surface_draw(surface, x, y, src);
+                cairo_surface_destroy(src);
+            }
+
+        }
+
+        double start = bench_now();
+        guac_common_display_flush(display);
+        elapsed += bench_now() - start;
+
+    }
+
+    guac_common_display_free(display);
+
+    guac_socket_free(client->socket);
+    client->socket = client->__broadcast_socket;
+    guac_client_free(client);
+
+    return elapsed;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    int frames = BENCH_DEFAULT_FRAMES;
+    if (argc > 1)
+        frames = atoi(argv[1]);
+
+    if (frames <= 0) {
+        fprintf(stderr, "Usage: %s [FRAMES [THREADS...]]\n", argv[0]);
+        return 1;
+    }
+
+    /* Content is generated once and shared by all replays */
+    cairo_surface_t* photo = bench_create_photo(BENCH_WIDTH,
+            BENCH_HEIGHT * 2, 42);
+    cairo_surface_t* text = bench_create_text(1200, 600, 7);
+
+    int default_threads[] = { 1, 2, 4, 8 };
+    int thread_counts = argc > 2 ? argc - 2 : 4;
+
+    double baseline = 0;
+    for (int i = 0; i < thread_counts; i++) {
+
+        int threads = argc > 2 ? atoi(argv[i + 2]) : default_threads[i];
+        double elapsed = bench_replay(threads, frames, photo, text);
+
+        if (i == 0)
+            baseline = elapsed;
+
+        printf("%2i thread(s): %8.2f ms/frame, %6.2f MB sent, %5.2fx\n",
+                threads, elapsed / frames / 1e6,
+                bench_bytes_written / 1048576.0, baseline / elapsed);
+
+    }
+
+    cairo_surface_destroy(text);
+    cairo_surface_destroy(photo);
+    return 0;
+
+}
+
@@ -0,0 +1,286 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Benchmark which times each supported set of pixel kernel implementations
+ * against 1080p image data, reporting throughput relative to the scalar
+ * implementations. Every result is also compared against the scalar
+ * implementations, and the benchmark fails if any result differs. This
+ * program is not run as part of "make check", and must be built explicitly
+ * with "make bench_pixel_kernels".
+ *
+ * Usage: bench_pixel_kernels [ITERATIONS]
+ */
+
+#include "common/pixel.h"
+#include "common/rect.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The width of the image data, in pixels.
+ */
+#define BENCH_WIDTH 1920
+
+/**
+ * The height of the image data, in pixels.
+ */
+#define BENCH_HEIGHT 1080
+
+/**
+ * The default number of times each kernel is invoked.
+ */
+#define BENCH_DEFAULT_ITERATIONS 50
+
+/**
+ * The number of distinct operations timed for each set of kernels.
+ */
+#define BENCH_OPERATIONS 5
+
+/**
+ * The human-readable names of each operation timed.
+ */
+static const char* BENCH_OPERATION_NAMES[BENCH_OPERATIONS] = {
+    "put (opaque, 1/16 changed)",
+    "put (opaque, all changed)",
+    "put (blended)",
+    "is_opaque",
+    "png_optimality"
+};
+
+/**
+ * Returns the current value of the monotonic clock, in nanoseconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in nanoseconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * Image data shared by all operations.
+ */
+typedef struct bench_images {
+
+    /**
+     * Opaque, photographic-like source image data.
+     */
+    uint32_t* photo;
+
+    /**
+     * Source image data containing translucent pixels.
+     */
+    uint32_t* translucent;
+
+    /**
+     * Destination image data which differs from the photographic source in
+     * only one of every sixteen pixels.
+     */
+    uint32_t* similar;
+
+    /**
+     * Destination image data which is reset before each operation.
+     */
+    uint32_t* dst;
+
+} bench_images;
+
+/**
+ * Performs the given operation using the given kernels, returning a value
+ * summarizing the result such that results may be compared across kernels.
+ *
+ * @param kernels
+ *     The kernels to use.
+ *
+ * @param operation
+ *     The index of the operation to perform.
+ *
+ * @param images
+ *     The image data to operate on.
+ *
+ * @param elapsed
+ *     Pointer to a double which will be incremented by the time taken by
+ *     the kernel itself, in nanoseconds.
+ *
+ * @return
+ *     A value summarizing the result of the operation.
+ */
+static uint64_t bench_run(const guac_common_pixel_kernels* kernels,
+        int operation, bench_images* images, double* elapsed) {
+
+    size_t size = BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t);
+    int stride = BENCH_WIDTH * 4;
+    guac_common_rect changed = { 0 };
+    uint64_t result = 0;
+
+    /* Reset destination for put operations */
+    if (operation == 0)
+        memcpy(images->dst, images->similar, size);
+    else if (operation <= 2)
+        memcpy(images->dst, images->photo, size);
+
+    double start = bench_now();
+    switch (operation) {
+
+        case 0:
+        case 1:
+            kernels->put((unsigned char*) (operation == 0 ? images->photo
+                        : images->translucent), stride,
+                    (unsigned char*) images->dst, stride,
+                    BENCH_WIDTH, BENCH_HEIGHT, 1, &changed);
+            break;
+
+        case 2:
+            kernels->put((unsigned char*) images->translucent, stride,
+                    (unsigned char*) images->dst, stride,
+                    BENCH_WIDTH, BENCH_HEIGHT, 0, &changed);
+            break;
+
+        case 3:
+            result = kernels->is_opaque((unsigned char*) images->photo,
+                    stride, BENCH_WIDTH, BENCH_HEIGHT);
+            break;
+
+        case 4:
+            result = kernels->png_optimality((unsigned char*) images->photo,
+                    stride, BENCH_WIDTH, BENCH_HEIGHT);
+            break;
+
+    }
+    *elapsed += bench_now() - start;
+
+    /* Summarize output of put operations */
+    if (operation <= 2) {
+        for (int i = 0; i < BENCH_WIDTH * BENCH_HEIGHT; i++)
+            result = result * 31 + images->dst[i];
+        result ^= ((uint64_t) changed.x << 48) ^ ((uint64_t) changed.y << 32)
+                ^ ((uint64_t) changed.width << 16) ^ changed.height;
+    }
+
+    return result;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    if (argc > 1)
+        iterations = atoi(argv[1]);
+
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [ITERATIONS]\n", argv[0]);
+        return 1;
+    }
+
+    int pixels = BENCH_WIDTH * BENCH_HEIGHT;
+    bench_images images = {
+        .photo       = malloc(pixels * sizeof(uint32_t)),
+        .translucent = malloc(pixels * sizeof(uint32_t)),
+        .similar     = malloc(pixels * sizeof(uint32_t)),
+        .dst         = malloc(pixels * sizeof(uint32_t))
+    };
+
+    /* Generate smooth gradients with noise, resembling photographs, with
+     * occasional runs of identical pixels */
+    uint32_t state = 1;
+    for (int i = 0; i < pixels; i++) {
+
+        int x = i % BENCH_WIDTH;
+        int y = i / BENCH_WIDTH;
+
+        state = state * 1103515245 + 12345;
+        uint32_t noise = (state >> 16) & 0x07;
+
+        uint32_t color = 0xFF000000
+                       | (((x + noise) & 0xFF) << 16)
+                       | (((y + noise) & 0xFF) << 8)
+                       | ((x ^ y) & 0xFF);
+
+        if (x > 0 && (state >> 8) % 4 == 0)
+            color = images.photo[i - 1];
+
+        images.photo[i] = color;
+        images.similar[i] = (i % 16 == 0) ? color ^ 0x010101 : color;
+
+        /* Translucent pixels, pre-multiplied, including fully transparent
+         * and fully opaque pixels */
+        uint32_t alpha = (state >> 20) & 0xFF;
+        if (alpha < 0x20) alpha = 0x00;
+        else if (alpha > 0xE0) alpha = 0xFF;
+        images.translucent[i] = (alpha << 24) | (color & 0x3F3F3F);
+
+    }
+
+    /* Time each operation of each supported set of kernels */
+    double baseline[BENCH_OPERATIONS];
+    uint64_t expected[BENCH_OPERATIONS];
+    int failed = 0;
+
+    for (int i = 0; GUAC_COMMON_PIXEL_KERNELS[i] != NULL; i++) {
+
+        const guac_common_pixel_kernels* kernels = GUAC_COMMON_PIXEL_KERNELS[i];
+        if (!kernels->supported()) {
+            printf("%s: not supported by this CPU\n", kernels->name);
+            continue;
+        }
+
+        printf("%s:\n", kernels->name);
+        for (int operation = 0; operation < BENCH_OPERATIONS; operation++) {
+
+            double elapsed = 0;
+            uint64_t result = 0;
+            for (int j = 0; j < iterations; j++)
+                result = bench_run(kernels, operation, &images, &elapsed);
+
+            /* The first set of kernels is always the scalar reference */
+            if (i == 0) {
+                baseline[operation] = elapsed;
+                expected[operation] = result;
+            }
+
+            int exact = (result == expected[operation]);
+            if (!exact)
+                failed = 1;
+
+            printf("    %-28s %8.1f Mpixel/s, %5.2fx%s\n",
+                    BENCH_OPERATION_NAMES[operation],
+                    (double) pixels * iterations / elapsed * 1e3,
+                    baseline[operation] / elapsed,
+                    exact ? "" : " (MISMATCH)");
+
+        }
+
+    }
+
+    free(images.photo);
+    free(images.translucent);
+    free(images.similar);
+    free(images.dst);
+
+    return failed;
+
+}
+
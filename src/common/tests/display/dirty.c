@@ -0,0 +1,215 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/display.h"
+#include "common/surface.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/socket.h>
+
+#include <stddef.h>
+
+/**
+ * The width and height of the display and each layer used by these tests, in
+ * pixels.
+ */
+#define TEST_DISPLAY_SIZE 64
+
+/**
+ * The total number of bytes written to the socket of the display used by
+ * these tests.
+ */
+static size_t test_bytes_written;
+
+/**
+ * Socket write handler which discards all written data, counting the number
+ * of bytes written.
+ *
+ * @param socket
+ *     The socket being written to.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param count
+ *     The number of bytes to write.
+ *
+ * @return
+ *     The number of bytes given, which are always considered written.
+ */
+static ssize_t test_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+    test_bytes_written += count;
+    return count;
+}
+
+/**
+ * Allocates a new display whose client writes to a socket that discards all
+ * data, counting the bytes written within test_bytes_written.
+ *
+ * @return
+ *     A newly-allocated display, which must eventually be freed along with
+ *     its client.
+ */
+static guac_common_display* test_display_alloc() {
+
+    guac_client* client = guac_client_alloc();
+
+    /* The original broadcast socket is restored before the client is freed */
+    client->socket = guac_socket_alloc();
+    client->socket->write_handler = test_write_handler;
+
+    return guac_common_display_alloc(client, TEST_DISPLAY_SIZE,
+            TEST_DISPLAY_SIZE);
+
+}
+
+/**
+ * Frees the given display along with its client.
+ *
+ * @param display
+ *     The display to free.
+ */
+static void test_display_free(guac_common_display* display) {
+    guac_client* client = display->client;
+    guac_common_display_free(display);
+
+    guac_socket_free(client->socket);
+    client->socket = client->__broadcast_socket;
+    guac_client_free(client);
+}
+
+/**
+ * Returns the number of layers within the dirty set of the given display,
+ * excluding the default layer.
+ *
+ * @param display
+ *     The display to inspect.
+ *
+ * @return
+ *     The number of layers within the dirty set of the given display.
+ */
+static int test_dirty_count(guac_common_display* display) {
+
+    int count = 0;
+    for (guac_common_display_layer* current = display->dirty_layers;
+            current != NULL; current = current->next_dirty)
+        count++;
+
+    return count;
+
+}
+
+/**
+ * Verifies that only layers which have been changed since the last flush
+ * are added to the dirty set, and that flushing the display empties that
+ * set.
+ */
+void test_display__flush_dirty() {
+
+    guac_common_display* display = test_display_alloc();
+
+    guac_common_display_layer* first = guac_common_display_alloc_layer(
+            display, TEST_DISPLAY_SIZE, TEST_DISPLAY_SIZE);
+    guac_common_display_layer* second = guac_common_display_alloc_layer(
+            display, TEST_DISPLAY_SIZE, TEST_DISPLAY_SIZE);
+    guac_common_display_layer* third = guac_common_display_alloc_layer(
+            display, TEST_DISPLAY_SIZE, TEST_DISPLAY_SIZE);
+
+    /* Newly-allocated layers have nothing to flush */
+    CU_ASSERT_PTR_NULL(display->dirty_layers);
+    CU_ASSERT_FALSE(display->default_layer.dirty);
+
+    /* Drawing marks only the affected layer (translucent rectangles are
+     * always deferred until flush) */
+    guac_common_surface_set(second->surface, 0, 0, 16, 16,
+            0xFF, 0x00, 0x00, 0x80);
+    CU_ASSERT_PTR_EQUAL(display->dirty_layers, second);
+    CU_ASSERT_TRUE(second->dirty);
+    CU_ASSERT_FALSE(first->dirty);
+    CU_ASSERT_FALSE(third->dirty);
+
+    /* Repeated changes do not add the same layer twice */
+    guac_common_surface_set(second->surface, 16, 16, 16, 16,
+            0x00, 0xFF, 0x00, 0x80);
+    CU_ASSERT_EQUAL(test_dirty_count(display), 1);
+
+    /* Changing layer properties also marks the layer */
+    guac_common_surface_move(third->surface, 8, 8);
+    CU_ASSERT_TRUE(third->dirty);
+    CU_ASSERT_EQUAL(test_dirty_count(display), 2);
+
+    /* The default layer is tracked separately */
+    guac_common_surface_set(display->default_surface, 0, 0, 8, 8,
+            0x00, 0x00, 0xFF, 0x80);
+    CU_ASSERT_TRUE(display->default_layer.dirty);
+    CU_ASSERT_EQUAL(test_dirty_count(display), 2);
+
+    /* Flushing sends all changes and empties the dirty set */
+    test_bytes_written = 0;
+    guac_common_display_flush(display);
+    guac_socket_flush(display->client->socket);
+    CU_ASSERT(test_bytes_written > 0);
+
+    CU_ASSERT_PTR_NULL(display->dirty_layers);
+    CU_ASSERT_FALSE(display->default_layer.dirty);
+    CU_ASSERT_FALSE(second->dirty);
+    CU_ASSERT_FALSE(third->dirty);
+    CU_ASSERT_FALSE(second->surface->flush_pending);
+    CU_ASSERT_FALSE(third->surface->flush_pending);
+
+    /* Layers changed again after a flush are marked again */
+    guac_common_surface_set_opacity(first->surface, 0x80);
+    CU_ASSERT_PTR_EQUAL(display->dirty_layers, first);
+
+    test_display_free(display);
+
+}
+
+/**
+ * Verifies that freeing a layer having unflushed changes removes that layer
+ * from the dirty set.
+ */
+void test_display__free_dirty() {
+
+    guac_common_display* display = test_display_alloc();
+
+    guac_common_display_layer* first = guac_common_display_alloc_layer(
+            display, TEST_DISPLAY_SIZE, TEST_DISPLAY_SIZE);
+    guac_common_display_layer* second = guac_common_display_alloc_layer(
+            display, TEST_DISPLAY_SIZE, TEST_DISPLAY_SIZE);
+
+    guac_common_surface_move(first->surface, 1, 1);
+    guac_common_surface_move(second->surface, 2, 2);
+    CU_ASSERT_EQUAL(test_dirty_count(display), 2);
+
+    guac_common_display_free_layer(display, first);
+    CU_ASSERT_EQUAL(test_dirty_count(display), 1);
+    CU_ASSERT_PTR_EQUAL(display->dirty_layers, second);
+
+    guac_common_display_free_layer(display, second);
+    CU_ASSERT_PTR_NULL(display->dirty_layers);
+
+    /* Nothing remains to be flushed */
+    guac_common_display_flush(display);
+
+    test_display_free(display);
+
+}
@@ -0,0 +1,164 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/encode-pool.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/socket.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The number of jobs submitted to the encode pool by each test.
+ */
+#define TEST_JOB_COUNT 64
+
+/**
+ * Buffer receiving all data written to the socket used by these tests.
+ */
+static char test_output[TEST_JOB_COUNT * 16];
+
+/**
+ * The number of bytes currently stored within test_output.
+ */
+static size_t test_output_length;
+
+/**
+ * Socket write handler which appends all written data to test_output.
+ *
+ * @param socket
+ *     The socket being written to.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param count
+ *     The number of bytes to write.
+ *
+ * @return
+ *     The number of bytes written, or -1 if test_output is full.
+ */
+static ssize_t test_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    if (test_output_length + count > sizeof(test_output))
+        return -1;
+
+    memcpy(test_output + test_output_length, buf, count);
+    test_output_length += count;
+    return count;
+
+}
+
+/**
+ * Encode pool handler which writes the job number pointed to by the given
+ * data to the given socket, with earlier jobs taking longer than later jobs
+ * such that jobs complete out of order.
+ *
+ * @param socket
+ *     The socket to write the job number to.
+ *
+ * @param data
+ *     A pointer to the int job number.
+ */
+static void test_job_handler(guac_socket* socket, void* data) {
+
+    int job = *((int*) data);
+    char buffer[16];
+
+    /* Finish later jobs first, so that out-of-order completion is likely */
+    struct timespec delay = {
+        .tv_sec  = 0,
+        .tv_nsec = (TEST_JOB_COUNT - job) * 100000
+    };
+    nanosleep(&delay, NULL);
+
+    int length = snprintf(buffer, sizeof(buffer), "%i;", job);
+    guac_socket_write(socket, buffer, length);
+
+}
+
+/**
+ * Submits TEST_JOB_COUNT jobs to a new encode pool having the given number
+ * of threads, twice, verifying that the output of each job is written in
+ * order of submission each time the pool is flushed.
+ *
+ * @param threads
+ *     The number of threads that the encode pool should have.
+ */
+static void test_encode_pool_order(int threads) {
+
+    int jobs[TEST_JOB_COUNT];
+    char expected[sizeof(test_output)];
+    size_t expected_length = 0;
+
+    for (int i = 0; i < TEST_JOB_COUNT; i++) {
+        jobs[i] = i;
+        expected_length += snprintf(expected + expected_length,
+                sizeof(expected) - expected_length, "%i;", i);
+    }
+
+    guac_socket* socket = guac_socket_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+    socket->write_handler = test_write_handler;
+
+    guac_common_encode_pool* pool = guac_common_encode_pool_alloc(threads);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(pool);
+
+    /* Job structures are reused by later flushes */
+    for (int flush = 0; flush < 2; flush++) {
+
+        test_output_length = 0;
+
+        guac_common_encode_pool_begin(pool);
+        for (int i = 0; i < TEST_JOB_COUNT; i++)
+            CU_ASSERT_EQUAL(guac_common_encode_pool_submit(pool,
+                        test_job_handler, &jobs[i]), 0);
+
+        guac_common_encode_pool_flush(pool, socket);
+
+        CU_ASSERT_EQUAL(test_output_length, expected_length);
+        CU_ASSERT_NSTRING_EQUAL(test_output, expected, expected_length);
+
+    }
+
+    guac_common_encode_pool_free(pool);
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Test which verifies that an encode pool having only a single thread
+ * performs all jobs in order when flushed.
+ */
+void test_encode_pool__order_single() {
+    test_encode_pool_order(1);
+}
+
+/**
+ * Test which verifies that an encode pool having several threads writes the
+ * output of all jobs in order of submission, even though those jobs
+ * complete out of order.
+ */
+void test_encode_pool__order_concurrent() {
+    test_encode_pool_order(4);
+}
+
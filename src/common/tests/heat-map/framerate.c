@@ -0,0 +1,153 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/heat-map.h"
+#include "common/rect.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/timestamp.h>
+
+/**
+ * Touches the given rectangle of the given heat map the given number of
+ * times, at a regular interval.
+ *
+ * @param heat_map
+ *     The heat map to touch.
+ *
+ * @param rect
+ *     The rectangle to touch, in pixels.
+ *
+ * @param start
+ *     The timestamp of the first touch.
+ *
+ * @param interval
+ *     The number of milliseconds between each touch.
+ *
+ * @param count
+ *     The number of times the rectangle should be touched.
+ */
+static void test_touch(guac_common_heat_map* heat_map,
+        const guac_common_rect* rect, guac_timestamp start, int interval,
+        int count) {
+
+    for (int i = 0; i < count; i++)
+        guac_common_heat_map_touch(heat_map, rect, start + i * interval);
+
+}
+
+/**
+ * Verifies that the framerate of areas which are regularly updated is
+ * calculated correctly, and that a framerate is reported only once enough
+ * updates have occurred.
+ */
+void test_heat_map__framerate() {
+
+    guac_common_heat_map* heat_map = guac_common_heat_map_alloc(1024, 768);
+
+    guac_common_rect cell;
+    guac_common_rect_init(&cell, 64, 64, 64, 64);
+
+    /* Untouched areas have no framerate */
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &cell), 0);
+
+    /* Framerate is not reported until enough intervals are observed */
+    test_touch(heat_map, &cell, 1000, 20, GUAC_COMMON_HEAT_MAP_MIN_SAMPLES);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &cell), 0);
+
+    /* Further regular updates give an exact framerate */
+    guac_common_heat_map_touch(heat_map, &cell,
+            1000 + GUAC_COMMON_HEAT_MAP_MIN_SAMPLES * 20);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &cell), 50);
+
+    /* Updates within the same frame do not affect the framerate */
+    guac_common_heat_map_touch(heat_map, &cell,
+            1000 + GUAC_COMMON_HEAT_MAP_MIN_SAMPLES * 20);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &cell), 50);
+
+    /* Partially-covered cells count fully */
+    guac_common_rect inner;
+    guac_common_rect_init(&inner, 100, 100, 1, 1);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &inner), 50);
+
+    /* Framerate is averaged over all cells */
+    guac_common_rect wide;
+    guac_common_rect_init(&wide, 0, 64, 256, 64);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &wide), 12);
+
+    /* Framerate converges to new rate as update frequency changes */
+    test_touch(heat_map, &cell, 2000, 100, 50);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &cell), 10);
+
+    /* Areas outside the heat map are ignored */
+    guac_common_rect outside;
+    guac_common_rect_init(&outside, 2000, 2000, 64, 64);
+    guac_common_heat_map_touch(heat_map, &outside, 10000);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &outside), 0);
+
+    guac_common_heat_map_free(heat_map);
+
+}
+
+/**
+ * Verifies that framerates are calculated correctly for rectangles which
+ * span multiple independently-locked bands of the heat map, including the
+ * partial band at the bottom of the heat map.
+ */
+void test_heat_map__bands() {
+
+    /* 18 rows of cells, such that the final band is only partially filled */
+    guac_common_heat_map* heat_map = guac_common_heat_map_alloc(640, 1100);
+
+    /* Touch the leftmost column of cells at 25 fps, and all other cells of
+     * the final row at 50 fps */
+    guac_common_rect column;
+    guac_common_rect_init(&column, 0, 0, 64, 1100);
+    test_touch(heat_map, &column, 1000, 40, 10);
+
+    guac_common_rect last_row;
+    guac_common_rect_init(&last_row, 64, 1099, 576, 1);
+    test_touch(heat_map, &last_row, 5000, 20, 10);
+
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &column), 25);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &last_row),
+            50);
+
+    /* Entire heat map */
+    guac_common_rect all;
+    guac_common_rect_init(&all, 0, 0, 640, 1100);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &all),
+            (25 * 18 + 50 * 9) / 180);
+
+    /* Rectangle spanning the boundary between two bands */
+    guac_common_rect boundary;
+    guac_common_rect_init(&boundary,
+            0, (GUAC_COMMON_HEAT_MAP_BAND_HEIGHT - 1)
+                * GUAC_COMMON_HEAT_MAP_CELL_SIZE,
+            128, 2 * GUAC_COMMON_HEAT_MAP_CELL_SIZE);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &boundary),
+            25 * 2 / 4);
+
+    /* Resizing discards all past updates */
+    guac_common_heat_map_resize(heat_map, 320, 240);
+    CU_ASSERT_EQUAL(guac_common_heat_map_get_framerate(heat_map, &all), 0);
+
+    guac_common_heat_map_free(heat_map);
+
+}
+
@@ -0,0 +1,208 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/image-cache.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+
+#include <stdint.h>
+
+/**
+ * The width and height of each image used by these tests, in pixels.
+ */
+#define TEST_IMAGE_SIZE 32
+
+/**
+ * The number of bytes occupied by each image used by these tests.
+ */
+#define TEST_IMAGE_BYTES (TEST_IMAGE_SIZE * TEST_IMAGE_SIZE * 4)
+
+/**
+ * Allocates a new image whose pixels are all the given color.
+ *
+ * @param color
+ *     The ARGB color of every pixel of the image.
+ *
+ * @return
+ *     A newly-allocated image which must be destroyed with
+ *     cairo_surface_destroy().
+ */
+static cairo_surface_t* test_image_alloc(uint32_t color) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+            TEST_IMAGE_SIZE, TEST_IMAGE_SIZE);
+
+    unsigned char* data = cairo_image_surface_get_data(image);
+    int stride = cairo_image_surface_get_stride(image);
+
+    for (int y = 0; y < TEST_IMAGE_SIZE; y++) {
+        uint32_t* row = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < TEST_IMAGE_SIZE; x++)
+            row[x] = color;
+    }
+
+    cairo_surface_mark_dirty(image);
+    return image;
+
+}
+
+/**
+ * Verifies that images are stored only once they have been seen twice, and
+ * that identical images are subsequently found within the buffer that
+ * stored them.
+ */
+void test_image_cache__store_and_hit() {
+
+    guac_client* client = guac_client_alloc();
+    guac_common_image_cache* cache = guac_common_image_cache_alloc(client,
+            TEST_IMAGE_BYTES * 64);
+
+    cairo_surface_t* image = test_image_alloc(0xFF102030);
+    cairo_surface_t* other = test_image_alloc(0xFF102031);
+
+    const guac_layer* stored = NULL;
+    const guac_layer* found = NULL;
+
+    /* First sighting is only remembered */
+    CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, image, &stored),
+            GUAC_COMMON_IMAGE_CACHE_MISS);
+    CU_ASSERT_PTR_NULL(stored);
+
+    /* Second sighting is stored within a buffer */
+    CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, image, &stored),
+            GUAC_COMMON_IMAGE_CACHE_STORE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(stored);
+    CU_ASSERT(stored->index < 0);
+
+    /* Further sightings are found within that buffer */
+    CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, image, &found),
+            GUAC_COMMON_IMAGE_CACHE_HIT);
+    CU_ASSERT_PTR_EQUAL(found, stored);
+
+    /* Different contents are never found */
+    found = NULL;
+    CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, other, &found),
+            GUAC_COMMON_IMAGE_CACHE_MISS);
+    CU_ASSERT_PTR_NULL(found);
+
+    CU_ASSERT_EQUAL(cache->hits, 1);
+    CU_ASSERT_EQUAL(cache->misses, 3);
+    CU_ASSERT_EQUAL(cache->stores, 1);
+    CU_ASSERT_EQUAL(cache->length, 1);
+    CU_ASSERT_EQUAL(cache->size, TEST_IMAGE_BYTES);
+
+    cairo_surface_destroy(other);
+    cairo_surface_destroy(image);
+
+    guac_common_image_cache_free(cache);
+    guac_client_free(client);
+
+}
+
+/**
+ * Verifies that the least recently used images are evicted once the cache
+ * is full, and that the buffers of evicted images are reused.
+ */
+void test_image_cache__evict() {
+
+    guac_client* client = guac_client_alloc();
+    guac_common_image_cache* cache = guac_common_image_cache_alloc(client,
+            TEST_IMAGE_BYTES * 8);
+
+    cairo_surface_t* images[9];
+    const guac_layer* buffers[9];
+
+    /* Fill cache to capacity */
+    for (int i = 0; i < 9; i++) {
+        images[i] = test_image_alloc(0xFF000000 | i);
+        guac_common_image_cache_lookup(cache, images[i], &buffers[i]);
+        CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, images[i],
+                    &buffers[i]), GUAC_COMMON_IMAGE_CACHE_STORE);
+        if (i == 7)
+            CU_ASSERT_EQUAL(cache->evictions, 0);
+    }
+
+    /* Oldest image was evicted, with its buffer reused for the newest */
+    CU_ASSERT_EQUAL(cache->evictions, 1);
+    CU_ASSERT_EQUAL(cache->length, 8);
+    CU_ASSERT_EQUAL(cache->size, TEST_IMAGE_BYTES * 8);
+    CU_ASSERT_PTR_EQUAL(buffers[8], buffers[0]);
+
+    const guac_layer* found = NULL;
+    CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, images[1], &found),
+            GUAC_COMMON_IMAGE_CACHE_HIT);
+    CU_ASSERT_PTR_EQUAL(found, buffers[1]);
+
+    /* Image 1 is now more recently used than image 2, and evicted images
+     * are stored again as soon as they are seen again */
+    CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, images[0], &found),
+            GUAC_COMMON_IMAGE_CACHE_STORE);
+    CU_ASSERT_PTR_EQUAL(found, buffers[2]);
+
+    CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, images[1], &found),
+            GUAC_COMMON_IMAGE_CACHE_HIT);
+    CU_ASSERT_NOT_EQUAL(guac_common_image_cache_lookup(cache, images[2],
+                &found), GUAC_COMMON_IMAGE_CACHE_HIT);
+
+    for (int i = 0; i < 9; i++)
+        cairo_surface_destroy(images[i]);
+
+    guac_common_image_cache_free(cache);
+    guac_client_free(client);
+
+}
+
+/**
+ * Verifies that images which are too small or too large relative to the
+ * cache are never stored.
+ */
+void test_image_cache__uncacheable() {
+
+    guac_client* client = guac_client_alloc();
+    guac_common_image_cache* cache = guac_common_image_cache_alloc(client,
+            TEST_IMAGE_BYTES * 4);
+
+    cairo_surface_t* tiny = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+            4, 4);
+    cairo_surface_t* large = test_image_alloc(0xFFFFFFFF);
+
+    const guac_layer* buffer = NULL;
+    for (int i = 0; i < 3; i++) {
+        CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, tiny, &buffer),
+                GUAC_COMMON_IMAGE_CACHE_MISS);
+        CU_ASSERT_EQUAL(guac_common_image_cache_lookup(cache, large, &buffer),
+                GUAC_COMMON_IMAGE_CACHE_MISS);
+    }
+
+    /* Uncacheable images do not affect the hit rate */
+    CU_ASSERT_PTR_NULL(buffer);
+    CU_ASSERT_EQUAL(cache->misses, 0);
+    CU_ASSERT_EQUAL(cache->length, 0);
+
+    cairo_surface_destroy(large);
+    cairo_surface_destroy(tiny);
+
+    guac_common_image_cache_free(cache);
+    guac_client_free(client);
+
+}
+
@@ -0,0 +1,270 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+#include "common/rect.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The width of the image data used by these tests, in pixels. This is
+ * deliberately not a multiple of any vector width.
+ */
+#define TEST_WIDTH 77
+
+/**
+ * The height of the image data used by these tests, in pixels.
+ */
+#define TEST_HEIGHT 23
+
+/**
+ * The number of randomly-generated cases tested for each kernel.
+ */
+#define TEST_CASES 500
+
+/**
+ * Returns the next value from a simple, deterministic pseudo-random number
+ * generator.
+ *
+ * @param state
+ *     The state of the generator, which is updated by this call.
+ *
+ * @return
+ *     The next pseudo-random 32-bit value.
+ */
+static uint32_t test_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/**
+ * Fills the given image data with pseudo-random pixels that favor the values
+ * which exercise special cases: fully opaque and fully transparent alpha, and
+ * runs of identical pixels.
+ *
+ * @param pixels
+ *     The image data to fill, containing TEST_WIDTH * TEST_HEIGHT pixels.
+ *
+ * @param state
+ *     The state of the pseudo-random number generator to use.
+ */
+static void test_fill(uint32_t* pixels, uint32_t* state) {
+
+    uint32_t mode = test_random(state) % 4;
+
+    for (int i = 0; i < TEST_WIDTH * TEST_HEIGHT; i++) {
+
+        uint32_t color = test_random(state);
+
+        /* Force alpha to one of the special values most of the time */
+        switch (test_random(state) % 4) {
+            case 0: color |= 0xFF000000; break;
+            case 1: color &= 0x00FFFFFF; break;
+        }
+
+        /* Produce runs of identical pixels for some images */
+        if (i > 0 && mode == 0 && test_random(state) % 4 != 0)
+            color = pixels[i - 1];
+
+        /* Produce entirely opaque images for others */
+        if (mode == 1)
+            color |= 0xFF000000;
+
+        pixels[i] = color;
+
+    }
+
+}
+
+/**
+ * Produces a pseudo-random rectangle within the test image data.
+ *
+ * @param rect
+ *     The rectangle to initialize.
+ *
+ * @param state
+ *     The state of the pseudo-random number generator to use.
+ */
+static void test_random_rect(guac_common_rect* rect, uint32_t* state) {
+
+    int x = test_random(state) % TEST_WIDTH;
+    int y = test_random(state) % TEST_HEIGHT;
+    int width = 1 + test_random(state) % (TEST_WIDTH - x);
+    int height = 1 + test_random(state) % (TEST_HEIGHT - y);
+
+    guac_common_rect_init(rect, x, y, width, height);
+
+}
+
+/**
+ * Verifies that the put kernel of every supported set of implementations
+ * produces exactly the same pixels and changed bounds as the scalar
+ * implementation.
+ */
+void test_pixel__put() {
+
+    const guac_common_pixel_kernels* scalar = GUAC_COMMON_PIXEL_KERNELS[0];
+    int stride = TEST_WIDTH * 4;
+
+    uint32_t src[TEST_WIDTH * TEST_HEIGHT];
+    uint32_t dst[TEST_WIDTH * TEST_HEIGHT];
+    uint32_t expected[TEST_WIDTH * TEST_HEIGHT];
+    uint32_t actual[TEST_WIDTH * TEST_HEIGHT];
+
+    for (int i = 1; GUAC_COMMON_PIXEL_KERNELS[i] != NULL; i++) {
+
+        const guac_common_pixel_kernels* kernels = GUAC_COMMON_PIXEL_KERNELS[i];
+        if (!kernels->supported())
+            continue;
+
+        uint32_t state = 0x12345678;
+        for (int j = 0; j < TEST_CASES; j++) {
+
+            test_fill(src, &state);
+            test_fill(dst, &state);
+
+            /* Destination sometimes already largely matches */
+            if (j % 3 == 0) {
+                for (int k = 0; k < TEST_WIDTH * TEST_HEIGHT; k++) {
+                    if (test_random(&state) % 8 != 0)
+                        dst[k] = src[k] | 0xFF000000;
+                }
+            }
+
+            guac_common_rect rect;
+            test_random_rect(&rect, &state);
+            int opaque = j % 2;
+            int offset = rect.y * TEST_WIDTH + rect.x;
+
+            memcpy(expected, dst, sizeof(dst));
+            memcpy(actual, dst, sizeof(dst));
+
+            guac_common_rect expected_changed;
+            guac_common_rect actual_changed;
+
+            scalar->put((unsigned char*) (src + offset), stride,
+                    (unsigned char*) (expected + offset), stride,
+                    rect.width, rect.height, opaque, &expected_changed);
+
+            kernels->put((unsigned char*) (src + offset), stride,
+                    (unsigned char*) (actual + offset), stride,
+                    rect.width, rect.height, opaque, &actual_changed);
+
+            CU_ASSERT(memcmp(expected, actual, sizeof(expected)) == 0);
+            CU_ASSERT_EQUAL(expected_changed.x, actual_changed.x);
+            CU_ASSERT_EQUAL(expected_changed.y, actual_changed.y);
+            CU_ASSERT_EQUAL(expected_changed.width, actual_changed.width);
+            CU_ASSERT_EQUAL(expected_changed.height, actual_changed.height);
+
+        }
+
+    }
+
+}
+
+/**
+ * Verifies that the is_opaque kernel of every supported set of
+ * implementations produces exactly the same result as the scalar
+ * implementation.
+ */
+void test_pixel__is_opaque() {
+
+    const guac_common_pixel_kernels* scalar = GUAC_COMMON_PIXEL_KERNELS[0];
+    int stride = TEST_WIDTH * 4;
+
+    uint32_t pixels[TEST_WIDTH * TEST_HEIGHT];
+
+    for (int i = 1; GUAC_COMMON_PIXEL_KERNELS[i] != NULL; i++) {
+
+        const guac_common_pixel_kernels* kernels = GUAC_COMMON_PIXEL_KERNELS[i];
+        if (!kernels->supported())
+            continue;
+
+        uint32_t state = 0x9ABCDEF0;
+        for (int j = 0; j < TEST_CASES; j++) {
+
+            test_fill(pixels, &state);
+
+            /* Most images should be opaque aside from a single pixel */
+            if (j % 2 == 0) {
+                for (int k = 0; k < TEST_WIDTH * TEST_HEIGHT; k++)
+                    pixels[k] |= 0xFF000000;
+                pixels[test_random(&state) % (TEST_WIDTH * TEST_HEIGHT)]
+                    &= 0xFEFFFFFF;
+            }
+
+            guac_common_rect rect;
+            test_random_rect(&rect, &state);
+            unsigned char* buffer =
+                (unsigned char*) (pixels + rect.y * TEST_WIDTH + rect.x);
+
+            CU_ASSERT_EQUAL(
+                scalar->is_opaque(buffer, stride, rect.width, rect.height),
+                kernels->is_opaque(buffer, stride, rect.width, rect.height));
+
+        }
+
+    }
+
+}
+
+/**
+ * Verifies that the png_optimality kernel of every supported set of
+ * implementations produces exactly the same result as the scalar
+ * implementation.
+ */
+void test_pixel__png_optimality() {
+
+    const guac_common_pixel_kernels* scalar = GUAC_COMMON_PIXEL_KERNELS[0];
+    int stride = TEST_WIDTH * 4;
+
+    uint32_t pixels[TEST_WIDTH * TEST_HEIGHT];
+
+    for (int i = 1; GUAC_COMMON_PIXEL_KERNELS[i] != NULL; i++) {
+
+        const guac_common_pixel_kernels* kernels = GUAC_COMMON_PIXEL_KERNELS[i];
+        if (!kernels->supported())
+            continue;
+
+        uint32_t state = 0x0F1E2D3C;
+        for (int j = 0; j < TEST_CASES; j++) {
+
+            test_fill(pixels, &state);
+
+            guac_common_rect rect;
+            test_random_rect(&rect, &state);
+            unsigned char* buffer =
+                (unsigned char*) (pixels + rect.y * TEST_WIDTH + rect.x);
+
+            CU_ASSERT_EQUAL(
+                scalar->png_optimality(buffer, stride, rect.width, rect.height),
+                kernels->png_optimality(buffer, stride, rect.width, rect.height));
+
+        }
+
+    }
+
+}
+
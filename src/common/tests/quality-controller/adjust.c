@@ -0,0 +1,118 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/quality-controller.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+
+/**
+ * Verifies that congestion reduces quality multiplicatively down to the
+ * minimum, and that all other parameters degrade along with quality.
+ */
+void test_quality_controller__congested() {
+
+    guac_client* client = guac_client_alloc();
+    guac_common_quality_controller* controller =
+        guac_common_quality_controller_alloc(client);
+
+    guac_common_quality_params params;
+
+    /* Parameters of an uncongested connection are used initially */
+    guac_common_quality_controller_get(controller, &params);
+    CU_ASSERT_EQUAL(params.quality, GUAC_COMMON_QUALITY_MAX);
+    CU_ASSERT_EQUAL(params.lossy_framerate,
+            GUAC_COMMON_QUALITY_LOSSY_FRAMERATE);
+    CU_ASSERT_EQUAL(params.frame_duration, 0);
+    CU_ASSERT_EQUAL(params.webp_method, GUAC_COMMON_QUALITY_WEBP_METHOD);
+    CU_ASSERT_EQUAL(params.png_compression,
+            GUAC_COMMON_QUALITY_PNG_COMPRESSION);
+
+    /* A single congested measurement reduces quality by a quarter */
+    guac_common_quality_controller_adjust(controller,
+            GUAC_COMMON_QUALITY_CONGESTED_DELAY + 1);
+    guac_common_quality_controller_get(controller, &params);
+    CU_ASSERT_EQUAL(params.quality, GUAC_COMMON_QUALITY_MAX * 3 / 4);
+    CU_ASSERT(params.frame_duration > 0);
+
+    /* Sustained congestion reaches the minimum quality and stays there */
+    for (int i = 0; i < 16; i++)
+        guac_common_quality_controller_adjust(controller, 1000);
+
+    guac_common_quality_controller_get(controller, &params);
+    CU_ASSERT_EQUAL(params.quality, GUAC_COMMON_QUALITY_MIN);
+    CU_ASSERT_EQUAL(params.lossy_framerate, 1);
+    CU_ASSERT_EQUAL(params.frame_duration,
+            GUAC_COMMON_QUALITY_MAX_FRAME_DURATION);
+    CU_ASSERT_EQUAL(params.webp_method, GUAC_COMMON_QUALITY_WEBP_METHOD + 2);
+    CU_ASSERT_EQUAL(params.png_compression,
+            GUAC_COMMON_QUALITY_MAX_PNG_COMPRESSION);
+
+    guac_common_quality_controller_free(controller);
+    guac_client_free(client);
+
+}
+
+/**
+ * Verifies that quality holds steady at moderate delays and recovers
+ * additively, up to the maximum, once the connection is clear.
+ */
+void test_quality_controller__recovery() {
+
+    guac_client* client = guac_client_alloc();
+    guac_common_quality_controller* controller =
+        guac_common_quality_controller_alloc(client);
+
+    guac_common_quality_params params;
+
+    /* Drive quality to the minimum */
+    for (int i = 0; i < 16; i++)
+        guac_common_quality_controller_adjust(controller, 1000);
+
+    /* Delays which are neither clear nor congested change nothing */
+    guac_common_quality_controller_adjust(controller,
+            GUAC_COMMON_QUALITY_CLEAR_DELAY);
+    guac_common_quality_controller_adjust(controller,
+            GUAC_COMMON_QUALITY_CONGESTED_DELAY);
+    guac_common_quality_controller_get(controller, &params);
+    CU_ASSERT_EQUAL(params.quality, GUAC_COMMON_QUALITY_MIN);
+
+    /* Each clear measurement raises quality by a fixed amount */
+    guac_common_quality_controller_adjust(controller, 0);
+    guac_common_quality_controller_get(controller, &params);
+    CU_ASSERT_EQUAL(params.quality,
+            GUAC_COMMON_QUALITY_MIN + GUAC_COMMON_QUALITY_INCREASE);
+
+    /* Recovery stops at the maximum, restoring uncongested parameters */
+    for (int i = 0; i < 64; i++)
+        guac_common_quality_controller_adjust(controller, 0);
+
+    guac_common_quality_controller_get(controller, &params);
+    CU_ASSERT_EQUAL(params.quality, GUAC_COMMON_QUALITY_MAX);
+    CU_ASSERT_EQUAL(params.lossy_framerate,
+            GUAC_COMMON_QUALITY_LOSSY_FRAMERATE);
+    CU_ASSERT_EQUAL(params.frame_duration, 0);
+    CU_ASSERT_EQUAL(params.webp_method, GUAC_COMMON_QUALITY_WEBP_METHOD);
+    CU_ASSERT_EQUAL(params.png_compression,
+            GUAC_COMMON_QUALITY_PNG_COMPRESSION);
+
+    guac_common_quality_controller_free(controller);
+    guac_client_free(client);
+
+}
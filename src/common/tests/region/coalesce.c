@@ -0,0 +1,230 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/rect.h"
+#include "common/region.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdint.h>
+
+/**
+ * Combine callback which combines rectangles only if doing so would not
+ * increase the number of pixels covered.
+ *
+ * @see guac_common_region_combine_callback
+ */
+static int test_combine_if_no_growth(const guac_common_rect* current,
+        const guac_common_rect* rect, void* data) {
+
+    guac_common_rect combined = *current;
+    guac_common_rect_extend(&combined, rect);
+
+    return combined.width * combined.height
+        <= current->width * current->height + rect->width * rect->height;
+
+}
+
+/**
+ * Combine callback which never combines rectangles.
+ *
+ * @see guac_common_region_combine_callback
+ */
+static int test_combine_never(const guac_common_rect* current,
+        const guac_common_rect* rect, void* data) {
+    return 0;
+}
+
+/**
+ * Returns whether the given rectangle is entirely contained within any
+ * rectangle of the given region.
+ *
+ * @param region
+ *     The region to search.
+ *
+ * @param rect
+ *     The rectangle to search for.
+ *
+ * @return
+ *     Non-zero if the rectangle is covered by the region, zero otherwise.
+ */
+static int test_is_covered(const guac_common_region* region,
+        const guac_common_rect* rect) {
+
+    for (int i = 0; i < region->count; i++) {
+        const guac_common_rect* current = &region->rects[i];
+        if (rect->x >= current->x && rect->y >= current->y
+                && rect->x + rect->width <= current->x + current->width
+                && rect->y + rect->height <= current->y + current->height)
+            return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Verifies that rectangles which tile a larger area are combined into that
+ * area regardless of the order they were added, even if added in an order
+ * that requires multiple passes.
+ */
+void test_region__coalesce_tiles() {
+
+    guac_common_region* region = guac_common_region_alloc();
+    guac_common_rect rect;
+
+    /* Add an 8x8 grid of 16x16 tiles, in column order */
+    for (int x = 0; x < 8; x++) {
+        for (int y = 0; y < 8; y++) {
+            guac_common_rect_init(&rect, 100 + x * 16, 50 + y * 16, 16, 16);
+            guac_common_region_add(region, &rect);
+        }
+    }
+
+    CU_ASSERT_EQUAL(region->count, 64);
+    guac_common_region_coalesce(region, test_combine_if_no_growth, NULL);
+
+    CU_ASSERT_EQUAL_FATAL(region->count, 1);
+    CU_ASSERT_EQUAL(region->rects[0].x, 100);
+    CU_ASSERT_EQUAL(region->rects[0].y, 50);
+    CU_ASSERT_EQUAL(region->rects[0].width, 128);
+    CU_ASSERT_EQUAL(region->rects[0].height, 128);
+
+    guac_common_region_free(region);
+
+}
+
+/**
+ * Verifies that distant rectangles are kept separate if the callback
+ * disagrees with combining them, that rectangles within other rectangles are
+ * always combined, and that regions grow beyond their initial size.
+ */
+void test_region__coalesce_separate() {
+
+    guac_common_region* region = guac_common_region_alloc();
+    guac_common_rect rect;
+
+    /* Many distant rects, each followed by a rect it contains */
+    int count = GUAC_COMMON_REGION_INITIAL_SIZE * 4;
+    for (int i = 0; i < count; i++) {
+
+        guac_common_rect_init(&rect, (i % 16) * 100, (i / 16) * 100, 50, 50);
+        guac_common_region_add(region, &rect);
+
+        guac_common_rect_init(&rect, (i % 16) * 100 + 10,
+                (i / 16) * 100 + 10, 20, 20);
+        guac_common_region_add(region, &rect);
+
+    }
+
+    /* Empty rects are ignored */
+    guac_common_rect_init(&rect, 10, 10, 0, 10);
+    guac_common_region_add(region, &rect);
+
+    CU_ASSERT_EQUAL(region->count, count * 2);
+    guac_common_region_coalesce(region, test_combine_never, NULL);
+    CU_ASSERT_EQUAL(region->count, count);
+
+    /* All rects remain covered */
+    for (int i = 0; i < count; i++) {
+        guac_common_rect_init(&rect, (i % 16) * 100, (i / 16) * 100, 50, 50);
+        CU_ASSERT(test_is_covered(region, &rect));
+    }
+
+    /* Clearing retains allocated space */
+    int size = region->size;
+    guac_common_region_clear(region);
+    CU_ASSERT_EQUAL(region->count, 0);
+    CU_ASSERT_EQUAL(region->size, size);
+
+    guac_common_region_free(region);
+
+}
+
+/**
+ * Verifies that every rectangle added to a region remains covered by the
+ * region after coalescing arbitrary, overlapping rectangles.
+ */
+void test_region__coalesce_coverage() {
+
+    guac_common_region* region = guac_common_region_alloc();
+    guac_common_rect rects[500];
+
+    uint32_t state = 1;
+    for (int i = 0; i < 500; i++) {
+        state = state * 1103515245 + 12345;
+        int x = (state >> 8) % 1000;
+        state = state * 1103515245 + 12345;
+        int y = (state >> 8) % 1000;
+        state = state * 1103515245 + 12345;
+        int width = 1 + (state >> 8) % 64;
+        state = state * 1103515245 + 12345;
+        int height = 1 + (state >> 8) % 64;
+        guac_common_rect_init(&rects[i], x, y, width, height);
+        guac_common_region_add(region, &rects[i]);
+    }
+
+    guac_common_region_coalesce(region, test_combine_if_no_growth, NULL);
+    CU_ASSERT(region->count < 500);
+
+    for (int i = 0; i < 500; i++)
+        CU_ASSERT(test_is_covered(region, &rects[i]));
+
+    guac_common_region_free(region);
+
+}
+
+/**
+ * Verifies that clipping a region constrains its rectangles to the given
+ * bounds, removing rectangles outside those bounds.
+ */
+void test_region__clip() {
+
+    guac_common_region* region = guac_common_region_alloc();
+    guac_common_rect rect;
+
+    guac_common_rect_init(&rect, 90, 90, 20, 20);
+    guac_common_region_add(region, &rect);
+
+    guac_common_rect_init(&rect, 200, 10, 20, 20);
+    guac_common_region_add(region, &rect);
+
+    guac_common_rect_init(&rect, 10, 10, 20, 20);
+    guac_common_region_add(region, &rect);
+
+    guac_common_rect bounds;
+    guac_common_rect_init(&bounds, 0, 0, 100, 100);
+    guac_common_region_clip(region, &bounds);
+
+    CU_ASSERT_EQUAL_FATAL(region->count, 2);
+
+    CU_ASSERT_EQUAL(region->rects[0].x, 90);
+    CU_ASSERT_EQUAL(region->rects[0].y, 90);
+    CU_ASSERT_EQUAL(region->rects[0].width, 10);
+    CU_ASSERT_EQUAL(region->rects[0].height, 10);
+
+    CU_ASSERT_EQUAL(region->rects[1].x, 10);
+    CU_ASSERT_EQUAL(region->rects[1].y, 10);
+    CU_ASSERT_EQUAL(region->rects[1].width, 20);
+    CU_ASSERT_EQUAL(region->rects[1].height, 20);
+
+    guac_common_region_free(region);
+
+}
+
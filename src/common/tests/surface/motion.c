@@ -0,0 +1,243 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/surface.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The width and height of the surface used by these tests, in pixels.
+ */
+#define TEST_SURFACE_SIZE 256
+
+/**
+ * Buffer receiving all data written to the socket used by these tests.
+ */
+static char test_output[1024 * 1024];
+
+/**
+ * The number of bytes currently stored within test_output.
+ */
+static size_t test_output_length;
+
+/**
+ * Socket write handler which appends all written data to test_output,
+ * silently discarding anything which does not fit.
+ *
+ * @param socket
+ *     The socket being written to.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param count
+ *     The number of bytes to write.
+ *
+ * @return
+ *     The number of bytes given, which are always considered written.
+ */
+static ssize_t test_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    size_t available = sizeof(test_output) - 1 - test_output_length;
+    size_t length = count < available ? count : available;
+
+    memcpy(test_output + test_output_length, buf, length);
+    test_output_length += length;
+    test_output[test_output_length] = '\0';
+
+    return count;
+
+}
+
+/**
+ * Returns the color of the pixel at the given coordinates of a test image
+ * whose contents are offset by the given amounts. Every row and column of a
+ * test image is unique.
+ *
+ * @param x
+ *     The X coordinate of the pixel.
+ *
+ * @param y
+ *     The Y coordinate of the pixel.
+ *
+ * @param dx
+ *     The horizontal offset of the contents of the image.
+ *
+ * @param dy
+ *     The vertical offset of the contents of the image.
+ *
+ * @return
+ *     The color of the pixel, which is always opaque.
+ */
+static uint32_t test_pixel(int x, int y, int dx, int dy) {
+    x += dx;
+    y += dy;
+    return 0xFF000000 | ((x * 2654435761u) ^ (y * 40503u * 7919u)) >> 8;
+}
+
+/**
+ * Allocates a new opaque test image the size of the test surface, having
+ * contents offset by the given amounts.
+ *
+ * @param dx
+ *     The horizontal offset of the contents of the image.
+ *
+ * @param dy
+ *     The vertical offset of the contents of the image.
+ *
+ * @return
+ *     A newly-allocated image which must be destroyed with
+ *     cairo_surface_destroy().
+ */
+static cairo_surface_t* test_image_alloc(int dx, int dy) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            TEST_SURFACE_SIZE, TEST_SURFACE_SIZE);
+
+    unsigned char* data = cairo_image_surface_get_data(image);
+    int stride = cairo_image_surface_get_stride(image);
+
+    for (int y = 0; y < TEST_SURFACE_SIZE; y++) {
+        uint32_t* row = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < TEST_SURFACE_SIZE; x++)
+            row[x] = test_pixel(x, y, dx, dy);
+    }
+
+    cairo_surface_mark_dirty(image);
+    return image;
+
+}
+
+/**
+ * Draws a test image to a new surface, then draws a second test image whose
+ * contents are offset by the given amounts, returning the output produced
+ * by flushing the second image. The contents of the surface are verified
+ * to match the second image.
+ *
+ * @param dx
+ *     The horizontal offset of the contents of the second image.
+ *
+ * @param dy
+ *     The vertical offset of the contents of the second image.
+ *
+ * @return
+ *     The output produced by flushing the second image, which remains valid
+ *     until the next call to this function.
+ */
+static const char* test_draw_moved(int dx, int dy) {
+
+    guac_client* client = guac_client_alloc();
+    guac_socket* socket = guac_socket_alloc();
+    socket->write_handler = test_write_handler;
+
+    guac_common_surface* surface = guac_common_surface_alloc(client, socket,
+            GUAC_DEFAULT_LAYER, TEST_SURFACE_SIZE, TEST_SURFACE_SIZE);
+    guac_common_surface_set_lossless(surface, 1);
+
+    cairo_surface_t* before = test_image_alloc(0, 0);
+    guac_common_surface_draw(surface, 0, 0, before);
+    guac_common_surface_flush(surface);
+    guac_socket_flush(socket);
+
+    test_output_length = 0;
+    test_output[0] = '\0';
+
+    cairo_surface_t* after = test_image_alloc(dx, dy);
+    guac_common_surface_draw(surface, 0, 0, after);
+    guac_common_surface_flush(surface);
+    guac_socket_flush(socket);
+
+    /* Surface must contain exactly the second image */
+    int mismatches = 0;
+    for (int y = 0; y < TEST_SURFACE_SIZE; y++) {
+        uint32_t* row = (uint32_t*) (surface->buffer + y * surface->stride);
+        for (int x = 0; x < TEST_SURFACE_SIZE; x++) {
+            if (row[x] != test_pixel(x, y, dx, dy))
+                mismatches++;
+        }
+    }
+
+    CU_ASSERT_EQUAL(mismatches, 0);
+
+    cairo_surface_destroy(after);
+    cairo_surface_destroy(before);
+
+    guac_common_surface_free(surface);
+    guac_socket_free(socket);
+    guac_client_free(client);
+
+    return test_output;
+
+}
+
+/**
+ * Verifies that content which has scrolled vertically is sent as a copy of
+ * the existing content.
+ */
+void test_surface__motion_vertical() {
+
+    const char* output = test_draw_moved(0, 20);
+
+    /* Rows 20 onward move to the top, leaving only the bottom to draw */
+    CU_ASSERT_PTR_NOT_NULL(strstr(output,
+                "4.copy,1.0,1.0,2.20,3.256,3.236,2.14,1.0,1.0,1.0;"));
+
+    /* Scrolling the other way moves rows to the bottom */
+    output = test_draw_moved(0, -32);
+    CU_ASSERT_PTR_NOT_NULL(strstr(output,
+                "4.copy,1.0,1.0,1.0,3.256,3.224,2.14,1.0,1.0,2.32;"));
+
+}
+
+/**
+ * Verifies that content which has scrolled horizontally is sent as a copy
+ * of the existing content.
+ */
+void test_surface__motion_horizontal() {
+
+    const char* output = test_draw_moved(48, 0);
+
+    CU_ASSERT_PTR_NOT_NULL(strstr(output,
+                "4.copy,1.0,2.48,1.0,3.208,3.256,2.14,1.0,1.0,1.0;"));
+
+}
+
+/**
+ * Verifies that content which has not moved is not sent as a copy.
+ */
+void test_surface__motion_none() {
+
+    /* Completely different content */
+    const char* output = test_draw_moved(1000, 1000);
+    CU_ASSERT_PTR_NULL(strstr(output, "4.copy,"));
+
+    /* Identical content */
+    output = test_draw_moved(0, 0);
+    CU_ASSERT_PTR_NULL(strstr(output, "4.copy,"));
+
+}
+
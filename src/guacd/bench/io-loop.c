@@ -0,0 +1,460 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Load test comparing the per-connection I/O threads of guacd against the
+ * shared epoll-based I/O loop. Each simulated connection consists of two
+ * socket pairs standing in for the user's connection and the connection
+ * process, with a single driver thread echoing data on the process side and
+ * keeping exactly one message in flight per connection. This program is not
+ * built by default, and must be built explicitly with "make bench_io_loop".
+ *
+ * Usage: bench_io_loop [CONNECTIONS [MESSAGES [IO_THREADS]]]
+ */
+
+#include "config.h"
+
+#include "connection.h"
+#include "io-loop.h"
+
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The numbers of simultaneous connections to simulate if no specific number
+ * of connections is requested.
+ */
+static const int BENCH_DEFAULT_CONNECTIONS[] = { 1000, 5000 };
+
+/**
+ * The default number of messages to send over each connection.
+ */
+#define BENCH_DEFAULT_MESSAGES 100
+
+/**
+ * The default number of I/O loop worker threads.
+ */
+#define BENCH_DEFAULT_IO_THREADS 2
+
+/**
+ * The size of each message sent over each connection, in bytes.
+ */
+#define BENCH_MESSAGE_SIZE 64
+
+/**
+ * The size of the buffers used by guacd to transfer data in each direction,
+ * in bytes.
+ */
+#define BENCH_BUFFER_SIZE 8192
+
+/**
+ * A single simulated connection, as seen by the driver thread.
+ */
+typedef struct bench_connection {
+
+    /**
+     * The driver's end of the user's connection to guacd.
+     */
+    int user_fd;
+
+    /**
+     * The driver's end of the file descriptor handed to the connection
+     * process.
+     */
+    int proc_fd;
+
+    /**
+     * The number of bytes of the in-flight message which have been echoed
+     * back to the user so far.
+     */
+    int received;
+
+    /**
+     * The number of messages which have been fully echoed so far.
+     */
+    int completed;
+
+    /**
+     * The time that the in-flight message was sent, in nanoseconds.
+     */
+    double sent;
+
+} bench_connection;
+
+/**
+ * Returns the current value of the monotonic clock, in nanoseconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in nanoseconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * Comparator for sorting latencies in ascending order with qsort().
+ *
+ * @param a
+ *     A pointer to the first latency to compare.
+ *
+ * @param b
+ *     A pointer to the second latency to compare.
+ *
+ * @return
+ *     A negative value if the first latency is smaller, a positive value if
+ *     the first latency is larger, or zero if both are equal.
+ */
+static int bench_compare(const void* a, const void* b) {
+    double delta = *((const double*) a) - *((const double*) b);
+    return (delta > 0) - (delta < 0);
+}
+
+/**
+ * Writes the entirety of the given buffer to the given non-blocking file
+ * descriptor, retrying if the file descriptor is temporarily full.
+ *
+ * @param fd
+ *     The file descriptor to write to.
+ *
+ * @param buffer
+ *     The data to write.
+ *
+ * @param length
+ *     The number of bytes to write.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int bench_write_all(int fd, const char* buffer, int length) {
+
+    while (length > 0) {
+
+        int written = write(fd, buffer, length);
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                continue;
+            return 1;
+        }
+
+        length -= written;
+        buffer += written;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Hands the guacd ends of a simulated connection to guacd, using the given
+ * I/O loop, or a dedicated I/O thread if the I/O loop is NULL.
+ *
+ * @param loop
+ *     The I/O loop to use, or NULL to use I/O threads.
+ *
+ * @param user_fd
+ *     guacd's end of the user's connection.
+ *
+ * @param proc_fd
+ *     guacd's end of the file descriptor handed to the connection process.
+ *
+ * @return
+ *     Zero on success, non-zero otherwise.
+ */
+static int bench_start_transfer(guacd_io_loop* loop, int user_fd,
+        int proc_fd) {
+
+    if (loop != NULL)
+        return guacd_io_loop_add(loop, user_fd, proc_fd,
+                BENCH_BUFFER_SIZE, BENCH_BUFFER_SIZE);
+
+    guacd_connection_io_thread_params* params =
+        malloc(sizeof(guacd_connection_io_thread_params));
+
+    params->parser = guac_parser_alloc();
+    params->socket = guac_socket_open(user_fd);
+    params->fd = proc_fd;
+    params->read_buffer_size = BENCH_BUFFER_SIZE;
+    params->write_buffer_size = BENCH_BUFFER_SIZE;
+
+    pthread_t io_thread;
+    if (pthread_create(&io_thread, NULL, guacd_connection_io_thread, params)) {
+        guac_parser_free(params->parser);
+        guac_socket_free(params->socket);
+        close(proc_fd);
+        free(params);
+        return 1;
+    }
+
+    pthread_detach(io_thread);
+    return 0;
+
+}
+
+/**
+ * Runs a single closed-loop echo test over the given number of connections,
+ * printing the resulting throughput and latency percentiles.
+ *
+ * @param name
+ *     A human-readable name for the test being run.
+ *
+ * @param loop
+ *     The I/O loop to test, or NULL to test per-connection I/O threads.
+ *
+ * @param count
+ *     The number of connections to simulate.
+ *
+ * @param messages
+ *     The number of messages to send over each connection.
+ *
+ * @return
+ *     Zero if the test completed successfully, non-zero otherwise.
+ */
+static int bench_run(const char* name, guacd_io_loop* loop, int count,
+        int messages) {
+
+    char message[BENCH_MESSAGE_SIZE];
+    char buffer[BENCH_BUFFER_SIZE];
+    memset(message, 'x', sizeof(message));
+
+    bench_connection* connections = calloc(count, sizeof(bench_connection));
+    double* latencies = malloc(sizeof(double) * count * messages);
+    int latency_count = 0;
+
+    int epoll_fd = epoll_create1(0);
+    if (connections == NULL || latencies == NULL || epoll_fd < 0) {
+        fprintf(stderr, "%s: unable to allocate test state\n", name);
+        return 1;
+    }
+
+    /* Create all simulated connections */
+    for (int i = 0; i < count; i++) {
+
+        bench_connection* connection = &connections[i];
+
+        int user_pair[2];
+        int proc_pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, user_pair)) {
+            fprintf(stderr, "%s: socketpair: %s\n", name, strerror(errno));
+            return 1;
+        }
+
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, proc_pair)) {
+            fprintf(stderr, "%s: socketpair: %s\n", name, strerror(errno));
+            return 1;
+        }
+
+        connection->user_fd = user_pair[0];
+        connection->proc_fd = proc_pair[0];
+        fcntl(connection->user_fd, F_SETFL, O_NONBLOCK);
+        fcntl(connection->proc_fd, F_SETFL, O_NONBLOCK);
+
+        if (bench_start_transfer(loop, user_pair[1], proc_pair[1])) {
+            fprintf(stderr, "%s: unable to start transfer\n", name);
+            return 1;
+        }
+
+        /* Tag each event with the connection index and which end it is */
+        struct epoll_event event = { .events = EPOLLIN };
+
+        event.data.u64 = ((uint64_t) i << 1);
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection->user_fd, &event);
+
+        event.data.u64 = ((uint64_t) i << 1) | 1;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection->proc_fd, &event);
+
+    }
+
+    double start = bench_now();
+
+    /* Put one message in flight for each connection */
+    for (int i = 0; i < count; i++) {
+        connections[i].sent = bench_now();
+        if (bench_write_all(connections[i].user_fd, message, sizeof(message)))
+            return 1;
+    }
+
+    int remaining = count;
+    struct epoll_event events[GUACD_IO_LOOP_MAX_EVENTS];
+
+    while (remaining > 0) {
+
+        int ready = epoll_wait(epoll_fd, events, GUACD_IO_LOOP_MAX_EVENTS,
+                1000);
+
+        if (ready == 0) {
+            fprintf(stderr, "%s: stalled with %i connections remaining\n",
+                    name, remaining);
+            return 1;
+        }
+
+        for (int i = 0; i < ready; i++) {
+
+            bench_connection* connection = &connections[events[i].data.u64 >> 1];
+
+            /* Echo everything received by the connection process */
+            if (events[i].data.u64 & 1) {
+                int length = read(connection->proc_fd, buffer, sizeof(buffer));
+                if (length > 0 && bench_write_all(connection->proc_fd,
+                            buffer, length))
+                    return 1;
+                continue;
+            }
+
+            /* Track receipt of the echoed message by the user */
+            int length = read(connection->user_fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                continue;
+
+            connection->received += length;
+            if (connection->received < BENCH_MESSAGE_SIZE)
+                continue;
+
+            double now = bench_now();
+            latencies[latency_count++] = now - connection->sent;
+            connection->received = 0;
+
+            /* Send next message, if any */
+            if (++connection->completed < messages) {
+                connection->sent = now;
+                if (bench_write_all(connection->user_fd, message,
+                            sizeof(message)))
+                    return 1;
+            }
+            else
+                remaining--;
+
+        }
+
+    }
+
+    double elapsed = bench_now() - start;
+
+    qsort(latencies, latency_count, sizeof(double), bench_compare);
+    printf("%-8s %6i connections: %10.0f msg/s, "
+            "p50 %8.1f us, p99 %8.1f us\n",
+            name, count, latency_count / (elapsed / 1e9),
+            latencies[latency_count / 2] / 1e3,
+            latencies[latency_count * 99 / 100] / 1e3);
+
+    /* Closing the driver's ends allows guacd to complete each transfer */
+    for (int i = 0; i < count; i++) {
+        close(connections[i].user_fd);
+        close(connections[i].proc_fd);
+    }
+
+    close(epoll_fd);
+    free(latencies);
+    free(connections);
+    return 0;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    const int* counts = BENCH_DEFAULT_CONNECTIONS;
+    int num_counts = sizeof(BENCH_DEFAULT_CONNECTIONS) / sizeof(int);
+
+    int count = 0;
+    int messages = BENCH_DEFAULT_MESSAGES;
+    int threads = BENCH_DEFAULT_IO_THREADS;
+
+    /* Test only the requested number of connections, if specified */
+    if (argc > 1) {
+        count = atoi(argv[1]);
+        counts = &count;
+        num_counts = 1;
+    }
+
+    if (argc > 2) messages = atoi(argv[2]);
+    if (argc > 3) threads = atoi(argv[3]);
+
+    if ((argc > 1 && count <= 0) || messages <= 0 || threads <= 0) {
+        fprintf(stderr, "Usage: %s [CONNECTIONS [MESSAGES [IO_THREADS]]]\n",
+                argv[0]);
+        return 1;
+    }
+
+    /* Each connection requires four file descriptors, plus headroom for
+     * those still being closed by the previous test */
+    int max_count = 0;
+    for (int i = 0; i < num_counts; i++) {
+        if (counts[i] > max_count)
+            max_count = counts[i];
+    }
+
+    rlim_t required = (rlim_t) max_count * 4 + 1024;
+
+    /* Raise the hard limit if necessary (and permitted) */
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+
+        if (limit.rlim_max != RLIM_INFINITY && limit.rlim_max < required) {
+            struct rlimit raised = { .rlim_cur = required, .rlim_max = required };
+            if (setrlimit(RLIMIT_NOFILE, &raised) == 0)
+                limit = raised;
+            else
+                fprintf(stderr, "Warning: %i connections require %lu file "
+                        "descriptors, but only %lu are permitted\n", max_count,
+                        (unsigned long) required, (unsigned long) limit.rlim_max);
+        }
+
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+
+    }
+
+    guacd_io_loop* loop = guacd_io_loop_alloc(threads);
+    if (loop == NULL) {
+        fprintf(stderr, "Unable to allocate I/O loop\n");
+        return 1;
+    }
+
+    int result = 0;
+    for (int i = 0; i < num_counts && result == 0; i++) {
+
+        result = bench_run("threads", NULL, counts[i], messages)
+              || bench_run("io-loop", loop, counts[i], messages);
+
+        /* Wait for completed transfers to be cleaned up */
+        struct timespec interval = { .tv_sec = 0, .tv_nsec = 1000000 };
+        while (guacd_io_loop_get_active(loop) > 0)
+            nanosleep(&interval, NULL);
+
+    }
+
+    guacd_io_loop_free(loop);
+    return result;
+
+}
@@ -60,6 +60,69 @@ static int guacd_conf_callback(const char* section, const char* param, const cha
             return 0;
         }
 
+        /* Initial output buffer size */
+        else if (strcmp(param, "buffer_size") == 0) {
+
+            int size = guacd_parse_positive_int(value);
+            if (size < 0) {
+                guacd_conf_parse_error = "Buffer sizes must be positive integers";
+                return 1;
+            }
+
+            config->buffer_size = size;
+            return 0;
+
+        }
+
+        /* Maximum output buffer size */
+        else if (strcmp(param, "max_buffer_size") == 0) {
+
+            int size = guacd_parse_positive_int(value);
+            if (size < 0) {
+                guacd_conf_parse_error = "Buffer sizes must be positive integers";
+                return 1;
+            }
+
+            config->max_buffer_size = size;
+            return 0;
+
+        }
+
+        /* Number of I/O loop worker threads */
+        else if (strcmp(param, "io_threads") == 0) {
+
+            int threads = guacd_parse_positive_int(value);
+            if (threads < 0) {
+                guacd_conf_parse_error = "The number of I/O threads must be a positive integer";
+                return 1;
+            }
+
+            config->io_threads = threads;
+            return 0;
+
+        }
+
+        /* Protocols having pre-forked processes */
+        else if (strcmp(param, "prefork_protocols") == 0) {
+            free(config->prefork_protocols);
+            config->prefork_protocols = strdup(value);
+            return 0;
+        }
+
+        /* Number of pre-forked processes per protocol */
+        else if (strcmp(param, "prefork_size") == 0) {
+
+            int size = guacd_parse_positive_int(value);
+            if (size < 0) {
+                guacd_conf_parse_error = "The number of pre-forked processes must be a positive integer";
+                return 1;
+            }
+
+            config->prefork_size = size;
+            return 0;
+
+        }
+
     }
 
     /* Options related to daemon startup */
@@ -178,6 +241,11 @@ guacd_config* guacd_conf_load() {
     /* Load defaults */
     conf->bind_host = strdup(GUACD_DEFAULT_BIND_HOST);
     conf->bind_port = strdup(GUACD_DEFAULT_BIND_PORT);
+    conf->buffer_size = GUACD_DEFAULT_BUFFER_SIZE;
+    conf->max_buffer_size = GUACD_DEFAULT_MAX_BUFFER_SIZE;
+    conf->io_threads = GUACD_DEFAULT_IO_THREADS;
+    conf->prefork_protocols = NULL;
+    conf->prefork_size = GUACD_DEFAULT_PREFORK_SIZE;
     conf->pidfile = NULL;
     conf->foreground = 0;
     conf->print_version = 0;
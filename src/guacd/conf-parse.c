@@ -25,6 +25,9 @@
 #include <guacamole/client.h>
 
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 
 /*
@@ -535,3 +538,21 @@ int guacd_parse_log_level(const char* name) {
 
 }
 
+int guacd_parse_positive_int(const char* value) {
+
+    char* end;
+
+    /* Parse value as a decimal integer */
+    errno = 0;
+    long parsed = strtol(value, &end, 10);
+
+    /* Reject values which are not entirely numeric, are out of range, or are
+     * not positive */
+    if (errno != 0 || end == value || *end != '\0'
+            || parsed <= 0 || parsed > INT_MAX)
+        return -1;
+
+    return (int) parsed;
+
+}
+
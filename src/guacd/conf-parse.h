@@ -53,6 +53,12 @@ int guacd_parse_conf(guacd_param_callback* callback, char* buffer, int length, v
  */
 int guacd_parse_log_level(const char* name);
 
+/**
+ * Parses the given value as a positive decimal integer, returning that
+ * integer, or -1 if the value is not a valid positive integer.
+ */
+int guacd_parse_positive_int(const char* value);
+
 /**
  * Human-readable description of the current error, if any.
  */
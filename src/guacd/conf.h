@@ -36,6 +36,32 @@
  */
 #define GUACD_DEFAULT_BIND_PORT "4822"
 
+/**
+ * The default initial size of the output buffer of each guac_socket created
+ * by guacd for a connection, in bytes.
+ */
+#define GUACD_DEFAULT_BUFFER_SIZE 8192
+
+/**
+ * The default maximum size that the output buffer of each guac_socket created
+ * by guacd for a connection may grow to, in bytes.
+ */
+#define GUACD_DEFAULT_MAX_BUFFER_SIZE 131072
+
+/**
+ * The default number of I/O worker threads used to transfer data between
+ * connected users and connection processes. If zero, the I/O loop is not used
+ * and each connection instead receives its own pair of I/O threads.
+ */
+#define GUACD_DEFAULT_IO_THREADS 0
+
+/**
+ * The default number of idle, pre-forked connection processes which should be
+ * maintained for each protocol listed within the "prefork_protocols"
+ * configuration parameter.
+ */
+#define GUACD_DEFAULT_PREFORK_SIZE 2
+
 /**
  * The contents of a guacd configuration file.
  */
@@ -51,6 +77,39 @@ typedef struct guacd_config {
      */
     char* bind_port;
 
+    /**
+     * The initial size of the output buffer of each connection's sockets, in
+     * bytes.
+     */
+    int buffer_size;
+
+    /**
+     * The maximum size that the output buffer of each connection's sockets
+     * may grow to, in bytes. If equal to buffer_size, output buffers have a
+     * fixed size.
+     */
+    int max_buffer_size;
+
+    /**
+     * The number of worker threads within the shared I/O loop which transfers
+     * data between connected users and connection processes, or zero if each
+     * connection should instead receive its own pair of I/O threads.
+     */
+    int io_threads;
+
+    /**
+     * Comma-separated list of the protocols which should have idle,
+     * pre-forked connection processes, or NULL if no processes should be
+     * pre-forked.
+     */
+    char* prefork_protocols;
+
+    /**
+     * The number of idle, pre-forked connection processes to maintain for
+     * each protocol listed within prefork_protocols.
+     */
+    int prefork_size;
+
     /**
      * The file to write the PID in, if any.
      */
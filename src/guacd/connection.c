@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include "connection.h"
+#include "io-loop.h"
 #include "log.h"
 #include "move-fd.h"
 #include "proc.h"
@@ -104,12 +105,17 @@ static int __write_all(int fd, char* buffer, int length) {
 static void* guacd_connection_write_thread(void* data) {
 
     guacd_connection_io_thread_params* params = (guacd_connection_io_thread_params*) data;
-    char buffer[8192];
 
     int length;
 
+    char* buffer = malloc(params->read_buffer_size);
+    if (buffer == NULL) {
+        guac_parser_free(params->parser);
+        return NULL;
+    }
+
     /* Read all buffered data from parser first */
-    while ((length = guac_parser_shift(params->parser, buffer, sizeof(buffer))) > 0) {
+    while ((length = guac_parser_shift(params->parser, buffer, params->read_buffer_size)) > 0) {
         if (__write_all(params->fd, buffer, length) < 0)
             break;
     }
@@ -118,11 +124,12 @@ static void* guacd_connection_write_thread(void* data) {
     guac_parser_free(params->parser);
 
     /* Transfer data from file descriptor to socket */
-    while ((length = guac_socket_read(params->socket, buffer, sizeof(buffer))) > 0) {
+    while ((length = guac_socket_read(params->socket, buffer, params->read_buffer_size)) > 0) {
         if (__write_all(params->fd, buffer, length) < 0)
             break;
     }
 
+    free(buffer);
     return NULL;
 
 }
@@ -130,7 +137,7 @@ static void* guacd_connection_write_thread(void* data) {
 void* guacd_connection_io_thread(void* data) {
 
     guacd_connection_io_thread_params* params = (guacd_connection_io_thread_params*) data;
-    char buffer[8192];
+    char* buffer = malloc(params->write_buffer_size);
 
     int length;
 
@@ -138,14 +145,17 @@ void* guacd_connection_io_thread(void* data) {
     pthread_create(&write_thread, NULL, guacd_connection_write_thread, params);
 
     /* Transfer data from file descriptor to socket */
-    while ((length = read(params->fd, buffer, sizeof(buffer))) > 0) {
-        if (guac_socket_write(params->socket, buffer, length))
-            break;
-        guac_socket_flush(params->socket);
+    if (buffer != NULL) {
+        while ((length = read(params->fd, buffer, params->write_buffer_size)) > 0) {
+            if (guac_socket_write(params->socket, buffer, length))
+                break;
+            guac_socket_flush(params->socket);
+        }
     }
 
     /* Wait for write thread to die */
     pthread_join(write_thread, NULL);
+    free(buffer);
 
     /* Clean up */
     guac_socket_free(params->socket);
@@ -156,15 +166,86 @@ void* guacd_connection_io_thread(void* data) {
 
 }
 
+/**
+ * Hands the connection of the given user to the given I/O loop, which will
+ * transfer data between that connection and the given file descriptor. Any
+ * data already buffered by the given guac_parser is written to the file
+ * descriptor first. The given parser and socket are freed, but the
+ * underlying connection remains open and is owned by the I/O loop.
+ *
+ * @param params
+ *     The parameters of the connection being routed, including the I/O loop
+ *     to use and the file descriptor of the connection.
+ *
+ * @param parser
+ *     The parser associated with the given guac_socket (used to handle the
+ *     user's connection handshake thus far).
+ *
+ * @param socket
+ *     The socket associated with the user's connection, which must read
+ *     directly from the connected file descriptor without encryption.
+ *
+ * @param fd
+ *     The file descriptor which is handled by a guac_socket within the
+ *     connection-specific process.
+ *
+ * @param read_buffer_size
+ *     The size of the buffer used to transfer data from the user to the
+ *     process, in bytes.
+ *
+ * @param write_buffer_size
+ *     The size of the buffer used to transfer data from the process to the
+ *     user, in bytes.
+ *
+ * @return
+ *     Zero if the connection was successfully handed to the I/O loop,
+ *     non-zero otherwise. The parser and socket are freed regardless.
+ */
+static int guacd_connection_io_loop_add(guacd_connection_thread_params* params,
+        guac_parser* parser, guac_socket* socket, int fd,
+        int read_buffer_size, int write_buffer_size) {
+
+    int length;
+    char buffer[8192];
+
+    /* Read all buffered data from parser first */
+    while ((length = guac_parser_shift(parser, buffer, sizeof(buffer))) > 0) {
+        if (__write_all(fd, buffer, length) < 0)
+            break;
+    }
+
+    guac_parser_free(parser);
+
+    /* Retain the connection beyond the lifetime of its guac_socket, which
+     * will otherwise close the connection when freed */
+    int user_fd = dup(params->connected_socket_fd);
+    guac_socket_free(socket);
+
+    if (user_fd < 0) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to hand connection to I/O loop: %s",
+                strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    return guacd_io_loop_add(params->io_loop, user_fd, fd,
+            read_buffer_size, write_buffer_size);
+
+}
+
 /**
  * Adds the given socket as a new user to the given process, automatically
- * reading/writing from the socket via read/write threads. The given socket,
- * parser, and any associated resources will be freed unless the user is not
- * added successfully.
+ * reading/writing from the socket via read/write threads or the shared I/O
+ * loop. The given socket, parser, and any associated resources will be freed
+ * unless the user is not added successfully.
  *
  * If adding the user fails for any reason, non-zero is returned. Zero is
  * returned upon success.
  *
+ * @param params
+ *     The parameters of the connection being routed, including the shared
+ *     I/O loop, if any.
+ *
  * @param proc
  *     The existing process to add the user to.
  *
@@ -179,7 +260,8 @@ void* guacd_connection_io_thread(void* data) {
  * @return
  *     Zero if the user was added successfully, non-zero if an error occurred.
  */
-static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* socket) {
+static int guacd_add_user(guacd_connection_thread_params* params,
+        guacd_proc* proc, guac_parser* parser, guac_socket* socket) {
 
     int sockets[2];
 
@@ -201,14 +283,29 @@ static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* so
     /* Close our end of the process file descriptor */
     close(proc_fd);
 
-    guacd_connection_io_thread_params* params = malloc(sizeof(guacd_connection_io_thread_params));
-    params->parser = parser;
-    params->socket = socket;
-    params->fd = user_fd;
+    /* Use the shared I/O loop if available for unencrypted connections. The
+     * user has been added to the process regardless of whether this
+     * succeeds, and will simply be disconnected if it fails. */
+#ifdef ENABLE_SSL
+    if (params->io_loop != NULL && params->ssl_context == NULL) {
+#else
+    if (params->io_loop != NULL) {
+#endif
+        guacd_connection_io_loop_add(params, parser, socket, user_fd,
+                proc->buffer_size, proc->max_buffer_size);
+        return 0;
+    }
+
+    guacd_connection_io_thread_params* io_params = malloc(sizeof(guacd_connection_io_thread_params));
+    io_params->parser = parser;
+    io_params->socket = socket;
+    io_params->fd = user_fd;
+    io_params->read_buffer_size = proc->buffer_size;
+    io_params->write_buffer_size = proc->max_buffer_size;
 
     /* Start I/O thread */
     pthread_t io_thread;
-    pthread_create(&io_thread,  NULL, guacd_connection_io_thread,  params);
+    pthread_create(&io_thread,  NULL, guacd_connection_io_thread,  io_params);
     pthread_detach(io_thread);
 
     return 0;
@@ -224,8 +321,10 @@ static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* so
  * The socket provided will be automatically freed when the connection
  * terminates unless routing fails, in which case non-zero is returned.
  *
- * @param map
- *     The map of existing client processes.
+ * @param params
+ *     The parameters of the connection being routed, including the map of
+ *     existing client processes and the sizes of the output buffers to use
+ *     for any new process.
  *
  * @param socket
  *     The socket associated with the new connection that must be routed to
@@ -235,8 +334,10 @@ static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* so
  *     Zero if the connection was successfully routed, non-zero if routing has
  *     failed.
  */
-static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
+static int guacd_route_connection(guacd_connection_thread_params* params,
+        guac_socket* socket) {
 
+    guacd_proc_map* map = params->map;
     guac_parser* parser = guac_parser_alloc();
 
     /* Reset guac_error */
@@ -297,8 +398,16 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
         guacd_log(GUAC_LOG_INFO, "Creating new client for protocol \"%s\"",
                 identifier);
 
-        /* Create new process */
-        proc = guacd_create_proc(identifier);
+        /* Use a pre-forked process if available, creating a new process
+         * only if necessary */
+        proc = NULL;
+        if (params->proc_pool != NULL)
+            proc = guacd_proc_pool_take(params->proc_pool, identifier);
+
+        if (proc == NULL)
+            proc = guacd_create_proc(identifier, params->buffer_size,
+                    params->max_buffer_size);
+
         new_process = 1;
 
     }
@@ -311,7 +420,7 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
     }
 
     /* Add new user (in the case of a new process, this will be the owner */
-    int add_user_failed = guacd_add_user(proc, parser, socket);
+    int add_user_failed = guacd_add_user(params, proc, parser, socket);
 
     /* If new process was created, manage that process */
     if (new_process) {
@@ -365,7 +474,6 @@ void* guacd_connection_thread(void* data) {
 
     guacd_connection_thread_params* params = (guacd_connection_thread_params*) data;
 
-    guacd_proc_map* map = params->map;
     int connected_socket_fd = params->connected_socket_fd;
 
     guac_socket* socket;
@@ -385,15 +493,17 @@ void* guacd_connection_thread(void* data) {
         }
     }
     else
-        socket = guac_socket_open(connected_socket_fd);
+        socket = guac_socket_open_buffered(connected_socket_fd,
+                params->buffer_size, params->max_buffer_size);
 
 #else
     /* Open guac_socket */
-    socket = guac_socket_open(connected_socket_fd);
+    socket = guac_socket_open_buffered(connected_socket_fd,
+            params->buffer_size, params->max_buffer_size);
 #endif
 
     /* Route connection according to Guacamole, creating a new process if needed */
-    if (guacd_route_connection(map, socket))
+    if (guacd_route_connection(params, socket))
         guac_socket_free(socket);
 
     free(params);
@@ -22,7 +22,9 @@
 
 #include "config.h"
 
+#include "io-loop.h"
 #include "proc-map.h"
+#include "proc-pool.h"
 
 #ifdef ENABLE_SSL
 #include <openssl/ssl.h>
@@ -51,6 +53,33 @@ typedef struct guacd_connection_thread_params {
      */
     int connected_socket_fd;
 
+    /**
+     * The initial size of the output buffer of each guac_socket created for
+     * the connection, in bytes.
+     */
+    int buffer_size;
+
+    /**
+     * The maximum size that the output buffer of each guac_socket created for
+     * the connection may grow to, in bytes.
+     */
+    int max_buffer_size;
+
+    /**
+     * The shared I/O loop which should transfer data between the connection
+     * and its process, or NULL if the connection should receive its own pair
+     * of I/O threads. The I/O loop is not used for connections encrypted
+     * with SSL/TLS.
+     */
+    guacd_io_loop* io_loop;
+
+    /**
+     * The pool of idle, pre-forked processes from which new connections
+     * should take their process, or NULL if processes should always be
+     * created as connections are made.
+     */
+    guacd_proc_pool* proc_pool;
+
 } guacd_connection_thread_params;
 
 /**
@@ -98,6 +127,18 @@ typedef struct guacd_connection_io_thread_params {
      */
     int fd;
 
+    /**
+     * The size of the buffer used to transfer data from the guac_socket to
+     * the file descriptor, in bytes.
+     */
+    int read_buffer_size;
+
+    /**
+     * The size of the buffer used to transfer data from the file descriptor
+     * to the guac_socket, in bytes.
+     */
+    int write_buffer_size;
+
 } guacd_connection_io_thread_params;
 
 /**
@@ -23,8 +23,10 @@
 #include "conf-args.h"
 #include "conf-file.h"
 #include "connection.h"
+#include "io-loop.h"
 #include "log.h"
 #include "proc-map.h"
+#include "proc-pool.h"
 
 #ifdef ENABLE_SSL
 #include <openssl/ssl.h>
@@ -464,6 +466,39 @@ int main(int argc, char* argv[]) {
         return 3;
     }
 
+    /* Transfer connection data using a shared I/O loop if requested */
+    guacd_io_loop* io_loop = NULL;
+    if (config->io_threads > 0) {
+
+        io_loop = guacd_io_loop_alloc(config->io_threads);
+        if (io_loop == NULL)
+            guacd_log(GUAC_LOG_WARNING, "Unable to start I/O loop. "
+                    "Falling back to per-connection I/O threads.");
+        else
+            guacd_log(GUAC_LOG_INFO, "Transferring connection data using "
+                    "%i I/O thread(s).", config->io_threads);
+
+    }
+
+    /* Pre-fork connection processes if requested */
+    guacd_proc_pool* proc_pool = NULL;
+    if (config->prefork_protocols != NULL && config->prefork_size > 0) {
+
+        proc_pool = guacd_proc_pool_alloc(config->prefork_protocols,
+                config->prefork_size, config->buffer_size,
+                config->max_buffer_size);
+
+        if (proc_pool == NULL)
+            guacd_log(GUAC_LOG_WARNING, "Unable to create pool of "
+                    "pre-forked processes. Processes will be created as "
+                    "connections are made.");
+        else
+            guacd_log(GUAC_LOG_INFO, "Maintaining %i pre-forked process(es) "
+                    "for each of the following protocols: %s",
+                    config->prefork_size, config->prefork_protocols);
+
+    }
+
     /* Daemon loop */
     for (;;) {
 
@@ -488,6 +523,10 @@ int main(int argc, char* argv[]) {
 
         params->map = map;
         params->connected_socket_fd = connected_socket_fd;
+        params->buffer_size = config->buffer_size;
+        params->max_buffer_size = config->max_buffer_size;
+        params->io_loop = io_loop;
+        params->proc_pool = proc_pool;
 
 #ifdef ENABLE_SSL
         params->ssl_context = ssl_context;
@@ -0,0 +1,607 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "io-loop.h"
+#include "log.h"
+
+#include <guacamole/client.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+struct guacd_io_pair;
+
+/**
+ * The transfer of data in one direction between the two file descriptors of
+ * a guacd_io_pair. Data is read from the source file descriptor into the
+ * buffer only while the buffer is empty, and is written from the buffer to
+ * the destination file descriptor until the buffer is empty again.
+ */
+typedef struct guacd_io_transfer {
+
+    /**
+     * The file descriptor that data is read from.
+     */
+    int from;
+
+    /**
+     * The file descriptor that data is written to.
+     */
+    int to;
+
+    /**
+     * Buffer containing data read from the source file descriptor but not
+     * yet written to the destination file descriptor.
+     */
+    char* buffer;
+
+    /**
+     * The size of the buffer, in bytes.
+     */
+    int size;
+
+    /**
+     * The offset of the first byte within the buffer not yet written.
+     */
+    int offset;
+
+    /**
+     * The number of bytes within the buffer not yet written, starting at
+     * offset.
+     */
+    int length;
+
+    /**
+     * Non-zero if end-of-file has been reached on the source file
+     * descriptor.
+     */
+    int eof;
+
+    /**
+     * Non-zero if the destination file descriptor has been shut down for
+     * writing, as end-of-file was reached on the source file descriptor and
+     * all data has been written.
+     */
+    int shutdown;
+
+} guacd_io_transfer;
+
+/**
+ * The bidirectional transfer of data between the connection of a user and
+ * the file descriptor handed to the connection-specific process for that
+ * user.
+ */
+typedef struct guacd_io_pair {
+
+    /**
+     * The transfer of data from the user to the process, followed by the
+     * transfer of data from the process to the user.
+     */
+    guacd_io_transfer transfers[2];
+
+    /**
+     * Non-zero if the transfer is complete or has failed, and the pair is
+     * awaiting cleanup.
+     */
+    int closed;
+
+    /**
+     * The previous pair within the list of pairs handled by the same worker.
+     */
+    struct guacd_io_pair* prev;
+
+    /**
+     * The next pair within the list of pairs handled by the same worker, or
+     * within the list of pairs awaiting cleanup.
+     */
+    struct guacd_io_pair* next;
+
+} guacd_io_pair;
+
+/**
+ * A single worker thread of an I/O loop, along with the epoll instance used
+ * by that thread.
+ */
+typedef struct guacd_io_worker {
+
+    /**
+     * The I/O loop that this worker belongs to.
+     */
+    guacd_io_loop* loop;
+
+    /**
+     * The thread handling all events for this worker.
+     */
+    pthread_t thread;
+
+    /**
+     * The epoll instance containing the file descriptors of all pairs
+     * handled by this worker.
+     */
+    int epoll_fd;
+
+    /**
+     * Pipe which is closed to signal this worker to stop. The read end is
+     * registered with the epoll instance.
+     */
+    int stop_pipe[2];
+
+    /**
+     * Lock which must be acquired when modifying the list of pairs.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * All pairs currently handled by this worker.
+     */
+    guacd_io_pair* pairs;
+
+} guacd_io_worker;
+
+struct guacd_io_loop {
+
+    /**
+     * All worker threads of this I/O loop.
+     */
+    guacd_io_worker* workers;
+
+    /**
+     * The number of worker threads.
+     */
+    int threads;
+
+    /**
+     * The index of the worker which should handle the next pair.
+     */
+    unsigned int next_worker;
+
+    /**
+     * The number of pairs currently being handled.
+     */
+    int active;
+
+};
+
+/**
+ * Transfers as much data as possible in the given direction without
+ * blocking, alternately reading into and writing from the buffer of the
+ * transfer until either file descriptor would block. Once end-of-file is
+ * reached and all data has been written, the destination is shut down for
+ * writing.
+ *
+ * @param transfer
+ *     The transfer to perform.
+ *
+ * @return
+ *     Zero if the transfer succeeded or would block, non-zero if an error
+ *     occurred.
+ */
+static int guacd_io_transfer_pump(guacd_io_transfer* transfer) {
+
+    while (!transfer->shutdown) {
+
+        /* Write any pending data */
+        if (transfer->length > 0) {
+
+            int written = write(transfer->to,
+                    transfer->buffer + transfer->offset, transfer->length);
+
+            if (written < 0) {
+
+                /* Retry if interrupted, as no further edge will be reported
+                 * for space which is already available */
+                if (errno == EINTR)
+                    continue;
+
+                return errno != EAGAIN && errno != EWOULDBLOCK;
+
+            }
+
+            transfer->offset += written;
+            transfer->length -= written;
+
+        }
+
+        /* Read more data only once the buffer is empty */
+        else if (!transfer->eof) {
+
+            int length = read(transfer->from, transfer->buffer,
+                    transfer->size);
+
+            if (length < 0) {
+
+                /* Retry if interrupted, as no further edge will be reported
+                 * for data which is already buffered */
+                if (errno == EINTR)
+                    continue;
+
+                return errno != EAGAIN && errno != EWOULDBLOCK;
+
+            }
+
+            if (length == 0)
+                transfer->eof = 1;
+
+            transfer->offset = 0;
+            transfer->length = length;
+
+        }
+
+        /* Pass along end-of-file once all data is written */
+        else {
+            shutdown(transfer->to, SHUT_WR);
+            transfer->shutdown = 1;
+        }
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Closes the file descriptors of the given pair and frees the pair.
+ *
+ * @param pair
+ *     The pair to free.
+ */
+static void guacd_io_pair_free(guacd_io_pair* pair) {
+
+    close(pair->transfers[0].from);
+    close(pair->transfers[0].to);
+
+    free(pair->transfers[0].buffer);
+    free(pair->transfers[1].buffer);
+    free(pair);
+
+}
+
+/**
+ * Removes the given pair from the list of pairs handled by the given worker.
+ * The pair is not freed.
+ *
+ * @param worker
+ *     The worker handling the pair.
+ *
+ * @param pair
+ *     The pair to remove.
+ */
+static void guacd_io_worker_remove_pair(guacd_io_worker* worker,
+        guacd_io_pair* pair) {
+
+    pthread_mutex_lock(&(worker->lock));
+
+    if (pair->prev != NULL)
+        pair->prev->next = pair->next;
+    else
+        worker->pairs = pair->next;
+
+    if (pair->next != NULL)
+        pair->next->prev = pair->prev;
+
+    pthread_mutex_unlock(&(worker->lock));
+
+}
+
+/**
+ * The main loop of a single worker thread, handling events for all pairs
+ * associated with the worker until the worker is signalled to stop.
+ *
+ * @param data
+ *     The guacd_io_worker to run.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guacd_io_worker_thread(void* data) {
+
+    guacd_io_worker* worker = (guacd_io_worker*) data;
+    guacd_io_loop* loop = worker->loop;
+
+    struct epoll_event events[GUACD_IO_LOOP_MAX_EVENTS];
+
+    for (;;) {
+
+        int count = epoll_wait(worker->epoll_fd, events,
+                GUACD_IO_LOOP_MAX_EVENTS, -1);
+
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            guacd_log(GUAC_LOG_ERROR, "I/O worker failed waiting for "
+                    "events: %s", strerror(errno));
+            break;
+        }
+
+        guacd_io_pair* closed = NULL;
+
+        for (int i = 0; i < count; i++) {
+
+            guacd_io_pair* pair = (guacd_io_pair*) events[i].data.ptr;
+
+            /* Stop once the stop pipe is closed */
+            if (pair == NULL)
+                return NULL;
+
+            /* Ignore further events for pairs closed within this batch */
+            if (pair->closed)
+                continue;
+
+            /* Events are edge-triggered, so both directions must be pumped
+             * until they would block */
+            int failed = guacd_io_transfer_pump(&pair->transfers[0])
+                       | guacd_io_transfer_pump(&pair->transfers[1]);
+
+            /* Clean up once both directions are complete or on error,
+             * deferring the free until all events in this batch have been
+             * handled */
+            if (failed || (pair->transfers[0].shutdown
+                        && pair->transfers[1].shutdown)) {
+                pair->closed = 1;
+                guacd_io_worker_remove_pair(worker, pair);
+                pair->next = closed;
+                closed = pair;
+            }
+
+        }
+
+        /* Free all pairs closed within this batch */
+        while (closed != NULL) {
+            guacd_io_pair* next = closed->next;
+            guacd_io_pair_free(closed);
+            __atomic_sub_fetch(&loop->active, 1, __ATOMIC_RELAXED);
+            closed = next;
+        }
+
+    }
+
+    return NULL;
+
+}
+
+guacd_io_loop* guacd_io_loop_alloc(int threads) {
+
+    guacd_io_loop* loop = calloc(1, sizeof(guacd_io_loop));
+    if (loop == NULL) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to allocate I/O loop: %s",
+                strerror(errno));
+        return NULL;
+    }
+
+    loop->workers = calloc(threads, sizeof(guacd_io_worker));
+    if (loop->workers == NULL) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to allocate I/O loop workers: %s",
+                strerror(errno));
+        free(loop);
+        return NULL;
+    }
+
+    for (int i = 0; i < threads; i++) {
+
+        guacd_io_worker* worker = &loop->workers[i];
+        worker->loop = loop;
+        pthread_mutex_init(&(worker->lock), NULL);
+
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (worker->epoll_fd < 0 || pipe(worker->stop_pipe)) {
+            guacd_log(GUAC_LOG_ERROR, "Unable to create I/O loop: %s",
+                    strerror(errno));
+            if (worker->epoll_fd >= 0)
+                close(worker->epoll_fd);
+            pthread_mutex_destroy(&(worker->lock));
+            guacd_io_loop_free(loop);
+            return NULL;
+        }
+
+        /* Wake the worker with a NULL pair once the stop pipe is closed */
+        struct epoll_event event = { .events = EPOLLIN };
+        event.data.ptr = NULL;
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->stop_pipe[0],
+                &event);
+
+        if (pthread_create(&(worker->thread), NULL, guacd_io_worker_thread,
+                    worker)) {
+            guacd_log(GUAC_LOG_ERROR, "Unable to start I/O worker thread.");
+            close(worker->epoll_fd);
+            close(worker->stop_pipe[0]);
+            close(worker->stop_pipe[1]);
+            pthread_mutex_destroy(&(worker->lock));
+            guacd_io_loop_free(loop);
+            return NULL;
+        }
+
+        loop->threads++;
+
+    }
+
+    return loop;
+
+}
+
+/**
+ * Initializes the given transfer, allocating its buffer.
+ *
+ * @param transfer
+ *     The transfer to initialize.
+ *
+ * @param from
+ *     The file descriptor that data should be read from.
+ *
+ * @param to
+ *     The file descriptor that data should be written to.
+ *
+ * @param size
+ *     The size of the buffer to allocate, in bytes.
+ *
+ * @return
+ *     Zero on success, non-zero if the buffer could not be allocated.
+ */
+static int guacd_io_transfer_init(guacd_io_transfer* transfer, int from,
+        int to, int size) {
+
+    transfer->from = from;
+    transfer->to = to;
+    transfer->size = size;
+    transfer->buffer = malloc(size);
+
+    return transfer->buffer == NULL;
+
+}
+
+int guacd_io_loop_add(guacd_io_loop* loop, int user_fd, int proc_fd,
+        int read_buffer_size, int write_buffer_size) {
+
+    guacd_io_pair* pair = calloc(1, sizeof(guacd_io_pair));
+    if (pair == NULL)
+        goto fail;
+
+    if (guacd_io_transfer_init(&pair->transfers[0], user_fd, proc_fd,
+                read_buffer_size)
+            || guacd_io_transfer_init(&pair->transfers[1], proc_fd, user_fd,
+                write_buffer_size)) {
+        free(pair->transfers[0].buffer);
+        free(pair->transfers[1].buffer);
+        free(pair);
+        goto fail;
+    }
+
+    /* All I/O must be non-blocking */
+    fcntl(user_fd, F_SETFL, fcntl(user_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(proc_fd, F_SETFL, fcntl(proc_fd, F_GETFL) | O_NONBLOCK);
+
+    /* Distribute pairs evenly across workers */
+    unsigned int index = __atomic_fetch_add(&loop->next_worker, 1,
+            __ATOMIC_RELAXED);
+    guacd_io_worker* worker = &loop->workers[index % loop->threads];
+
+    /* Both file descriptors remain registered for all events until closed,
+     * with edge-triggering ensuring that events for a file descriptor which
+     * cannot currently be handled are not repeatedly reported */
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET
+    };
+    event.data.ptr = pair;
+
+    /* The worker cannot clean up the pair until it is fully registered, as
+     * doing so requires the same lock */
+    pthread_mutex_lock(&(worker->lock));
+
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, proc_fd, &event)) {
+        pthread_mutex_unlock(&(worker->lock));
+        guacd_log(GUAC_LOG_ERROR, "Unable to add connection to I/O loop: %s",
+                strerror(errno));
+        guacd_io_pair_free(pair);
+        return 1;
+    }
+
+    pair->next = worker->pairs;
+    if (pair->next != NULL)
+        pair->next->prev = pair;
+    worker->pairs = pair;
+
+    __atomic_add_fetch(&loop->active, 1, __ATOMIC_RELAXED);
+
+    /* If the user cannot be registered, force the worker to clean up the
+     * pair via the process file descriptor, which is already registered */
+    int retval = 0;
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, user_fd, &event)) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to add connection to I/O loop: %s",
+                strerror(errno));
+        shutdown(proc_fd, SHUT_RDWR);
+        retval = 1;
+    }
+
+    pthread_mutex_unlock(&(worker->lock));
+    return retval;
+
+fail:
+    close(user_fd);
+    close(proc_fd);
+    return 1;
+
+}
+
+int guacd_io_loop_get_active(guacd_io_loop* loop) {
+    return __atomic_load_n(&loop->active, __ATOMIC_RELAXED);
+}
+
+void guacd_io_loop_free(guacd_io_loop* loop) {
+
+    for (int i = 0; i < loop->threads; i++) {
+
+        guacd_io_worker* worker = &loop->workers[i];
+
+        /* Signal worker to stop and wait for it to do so */
+        close(worker->stop_pipe[1]);
+        pthread_join(worker->thread, NULL);
+
+        /* Abort any transfers still in progress */
+        guacd_io_pair* current = worker->pairs;
+        while (current != NULL) {
+            guacd_io_pair* next = current->next;
+            guacd_io_pair_free(current);
+            current = next;
+        }
+
+        close(worker->stop_pipe[0]);
+        close(worker->epoll_fd);
+        pthread_mutex_destroy(&(worker->lock));
+
+    }
+
+    free(loop->workers);
+    free(loop);
+
+}
+
+#else
+
+guacd_io_loop* guacd_io_loop_alloc(int threads) {
+    guacd_log(GUAC_LOG_ERROR, "The I/O loop requires epoll, which is not "
+            "supported on this platform.");
+    return NULL;
+}
+
+int guacd_io_loop_add(guacd_io_loop* loop, int user_fd, int proc_fd,
+        int read_buffer_size, int write_buffer_size) {
+    close(user_fd);
+    close(proc_fd);
+    return 1;
+}
+
+int guacd_io_loop_get_active(guacd_io_loop* loop) {
+    return 0;
+}
+
+void guacd_io_loop_free(guacd_io_loop* loop) {
+}
+
+#endif
+
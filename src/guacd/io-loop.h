@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACD_IO_LOOP_H
+#define GUACD_IO_LOOP_H
+
+#include "config.h"
+
+/**
+ * The maximum number of events handled by an I/O worker thread with each
+ * call to epoll_wait().
+ */
+#define GUACD_IO_LOOP_MAX_EVENTS 256
+
+/**
+ * A pool of worker threads which transfer data between the connections of
+ * users and the file descriptors handed to connection processes, with each
+ * worker multiplexing any number of connections using a single epoll
+ * instance. This replaces the pair of blocking I/O threads otherwise
+ * created for each connection.
+ */
+typedef struct guacd_io_loop guacd_io_loop;
+
+/**
+ * Allocates a new I/O loop, starting the given number of worker threads.
+ * The I/O loop is only available on platforms which provide epoll. On all
+ * other platforms, this function always fails.
+ *
+ * @param threads
+ *     The number of worker threads to start. This must be positive.
+ *
+ * @return
+ *     The newly-allocated I/O loop, or NULL if the I/O loop could not be
+ *     allocated.
+ */
+guacd_io_loop* guacd_io_loop_alloc(int threads);
+
+/**
+ * Begins transferring data bidirectionally between the given file
+ * descriptors using one of the worker threads of the given I/O loop, until
+ * both directions have reached end-of-file or an error occurs. Both file
+ * descriptors are switched to non-blocking mode, and are owned by the I/O
+ * loop once this function is invoked, being closed automatically when the
+ * transfer is complete or if the transfer cannot be started.
+ *
+ * @param loop
+ *     The I/O loop which should handle the transfer.
+ *
+ * @param user_fd
+ *     The file descriptor of the connection of the user to guacd.
+ *
+ * @param proc_fd
+ *     The file descriptor which is handled by a guac_socket within the
+ *     connection-specific process.
+ *
+ * @param read_buffer_size
+ *     The size of the buffer used to transfer data from user_fd to proc_fd,
+ *     in bytes.
+ *
+ * @param write_buffer_size
+ *     The size of the buffer used to transfer data from proc_fd to user_fd,
+ *     in bytes.
+ *
+ * @return
+ *     Zero if the transfer was successfully started, non-zero otherwise.
+ */
+int guacd_io_loop_add(guacd_io_loop* loop, int user_fd, int proc_fd,
+        int read_buffer_size, int write_buffer_size);
+
+/**
+ * Returns the number of transfers currently being handled by the given I/O
+ * loop.
+ *
+ * @param loop
+ *     The I/O loop to query.
+ *
+ * @return
+ *     The number of transfers which have been started and are not yet
+ *     complete.
+ */
+int guacd_io_loop_get_active(guacd_io_loop* loop);
+
+/**
+ * Stops all worker threads of the given I/O loop, closing the file
+ * descriptors of all transfers still in progress, and frees the I/O loop.
+ *
+ * @param loop
+ *     The I/O loop to free.
+ */
+void guacd_io_loop_free(guacd_io_loop* loop);
+
+#endif
+
@@ -0,0 +1,415 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "log.h"
+#include "proc.h"
+#include "proc-pool.h"
+
+#include <guacamole/client.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/**
+ * The number of seconds to wait before retrying after a pre-forked process
+ * could not be created.
+ */
+#define GUACD_PROC_POOL_RETRY_INTERVAL 5
+
+/**
+ * The idle, pre-forked processes of a single protocol.
+ */
+typedef struct guacd_proc_pool_protocol {
+
+    /**
+     * The name of the protocol, as would be sent by a connecting user within
+     * the "select" instruction.
+     */
+    char* name;
+
+    /**
+     * Array of all idle processes for this protocol. This array has room for
+     * exactly as many processes as the size of the pool.
+     */
+    guacd_proc** idle;
+
+    /**
+     * The number of idle processes currently stored within the idle array.
+     */
+    int length;
+
+    /**
+     * The number of times a process for this protocol was requested and an
+     * idle process was available.
+     */
+    unsigned int hits;
+
+    /**
+     * The number of times a process for this protocol was requested but no
+     * idle process was available.
+     */
+    unsigned int misses;
+
+} guacd_proc_pool_protocol;
+
+struct guacd_proc_pool {
+
+    /**
+     * Array of all protocols having pre-forked processes.
+     */
+    guacd_proc_pool_protocol* protocols;
+
+    /**
+     * The number of protocols within the protocols array.
+     */
+    int protocol_count;
+
+    /**
+     * The number of idle processes to maintain for each protocol.
+     */
+    int size;
+
+    /**
+     * The initial size of the output buffer of each guac_socket created for
+     * users of the pre-forked processes, in bytes.
+     */
+    int buffer_size;
+
+    /**
+     * The maximum size that the output buffer of each guac_socket created for
+     * users of the pre-forked processes may grow to, in bytes.
+     */
+    int max_buffer_size;
+
+    /**
+     * Lock which must be acquired before accessing the idle processes of any
+     * protocol. This lock is also held while forking, such that child
+     * processes observe a consistent pool.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled whenever a process is taken from the
+     * pool, waking the refill thread.
+     */
+    pthread_cond_t refill;
+
+    /**
+     * The thread which forks new idle processes as needed.
+     */
+    pthread_t refill_thread;
+
+};
+
+/**
+ * The single process pool within guacd, if any. This pool is needed by the
+ * fork handlers registered with pthread_atfork().
+ */
+static guacd_proc_pool* guacd_proc_pool_instance = NULL;
+
+/**
+ * Fork handler invoked prior to fork(), acquiring the lock of the process
+ * pool such that the pool is not mid-modification within the child.
+ */
+static void guacd_proc_pool_prepare_fork() {
+    pthread_mutex_lock(&guacd_proc_pool_instance->lock);
+}
+
+/**
+ * Fork handler invoked within the parent process after fork(), releasing the
+ * lock acquired by guacd_proc_pool_prepare_fork().
+ */
+static void guacd_proc_pool_parent_fork() {
+    pthread_mutex_unlock(&guacd_proc_pool_instance->lock);
+}
+
+/**
+ * Fork handler invoked within the child process after fork(). The child
+ * inherits guacd's ends of the sockets of every idle process, which would
+ * otherwise keep those processes alive indefinitely should guacd terminate,
+ * so all such sockets are closed. The child's copy of the pool is then
+ * emptied, as the closed file descriptors may be reused by the child and
+ * must not be closed again should the child itself fork.
+ */
+static void guacd_proc_pool_child_fork() {
+
+    guacd_proc_pool* pool = guacd_proc_pool_instance;
+
+    for (int i = 0; i < pool->protocol_count; i++) {
+        guacd_proc_pool_protocol* protocol = &pool->protocols[i];
+        for (int j = 0; j < protocol->length; j++)
+            close(protocol->idle[j]->fd_socket);
+    }
+
+    pool->protocol_count = 0;
+    pthread_mutex_unlock(&pool->lock);
+
+}
+
+/**
+ * Frees guacd's record of an idle process which will never receive users,
+ * closing guacd's end of the socket used to send users to the process. If
+ * the process is still running, this will cause it to terminate.
+ *
+ * @param proc
+ *     The idle process to free.
+ */
+static void guacd_proc_pool_discard(guacd_proc* proc) {
+    guac_client_free(proc->client);
+    close(proc->fd_socket);
+    free(proc);
+}
+
+/**
+ * Returns the first protocol within the given pool which has fewer idle
+ * processes than the size of the pool. The lock of the pool must be held.
+ *
+ * @param pool
+ *     The pool to search.
+ *
+ * @return
+ *     The first protocol requiring an additional idle process, or NULL if
+ *     the pool is full.
+ */
+static guacd_proc_pool_protocol* guacd_proc_pool_find_unfilled(
+        guacd_proc_pool* pool) {
+
+    for (int i = 0; i < pool->protocol_count; i++) {
+        guacd_proc_pool_protocol* protocol = &pool->protocols[i];
+        if (protocol->length < pool->size)
+            return protocol;
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Thread which forks new idle processes whenever any protocol within the
+ * given pool has fewer idle processes than the size of the pool, waiting for
+ * processes to be taken from the pool otherwise. This thread runs for the
+ * lifetime of guacd.
+ *
+ * @param data
+ *     A pointer to the guacd_proc_pool to refill.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guacd_proc_pool_refill_thread(void* data) {
+
+    guacd_proc_pool* pool = (guacd_proc_pool*) data;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;) {
+
+        /* Wait until at least one protocol requires another process */
+        guacd_proc_pool_protocol* protocol = guacd_proc_pool_find_unfilled(pool);
+        if (protocol == NULL) {
+            pthread_cond_wait(&pool->refill, &pool->lock);
+            continue;
+        }
+
+        /* The pool lock is acquired by the fork handlers, and thus cannot be
+         * held while forking */
+        pthread_mutex_unlock(&pool->lock);
+
+        guacd_proc* proc = guacd_create_proc(protocol->name,
+                pool->buffer_size, pool->max_buffer_size);
+
+        /* Avoid rapidly retrying if processes cannot be created */
+        if (proc == NULL) {
+            guacd_log(GUAC_LOG_WARNING, "Unable to pre-fork process for "
+                    "protocol \"%s\". Retrying in %i seconds.",
+                    protocol->name, GUACD_PROC_POOL_RETRY_INTERVAL);
+            sleep(GUACD_PROC_POOL_RETRY_INTERVAL);
+            pthread_mutex_lock(&pool->lock);
+            continue;
+        }
+
+        guacd_log(GUAC_LOG_DEBUG, "Pre-forked process for protocol \"%s\" "
+                "(connection \"%s\").", protocol->name,
+                proc->client->connection_id);
+
+        /* Only this thread adds processes, thus space is still available */
+        pthread_mutex_lock(&pool->lock);
+        protocol->idle[protocol->length++] = proc;
+
+    }
+
+    return NULL;
+
+}
+
+guacd_proc_pool* guacd_proc_pool_alloc(const char* protocols, int size,
+        int buffer_size, int max_buffer_size) {
+
+    /* Only one pool may exist, as the fork handlers cannot be removed */
+    if (guacd_proc_pool_instance != NULL)
+        return NULL;
+
+    char* names = strdup(protocols);
+    guacd_proc_pool* pool = calloc(1, sizeof(guacd_proc_pool));
+    if (names == NULL || pool == NULL)
+        goto fail;
+
+    /* Allocate enough protocols for worst case of single-character names */
+    pool->protocols = calloc(strlen(names) / 2 + 1,
+            sizeof(guacd_proc_pool_protocol));
+    if (pool->protocols == NULL)
+        goto fail;
+
+    /* Parse comma-separated list of protocol names */
+    char* state;
+    for (char* name = strtok_r(names, ", ", &state); name != NULL;
+            name = strtok_r(NULL, ", ", &state)) {
+
+        guacd_proc_pool_protocol* protocol =
+            &pool->protocols[pool->protocol_count++];
+
+        protocol->name = strdup(name);
+        protocol->idle = calloc(size, sizeof(guacd_proc*));
+        if (protocol->name == NULL || protocol->idle == NULL)
+            goto fail;
+
+    }
+
+    /* Pre-forking must be enabled for at least one protocol */
+    if (pool->protocol_count == 0)
+        goto fail;
+
+    pool->size = size;
+    pool->buffer_size = buffer_size;
+    pool->max_buffer_size = max_buffer_size;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->refill, NULL);
+
+    guacd_proc_pool_instance = pool;
+    if (pthread_atfork(guacd_proc_pool_prepare_fork,
+                guacd_proc_pool_parent_fork, guacd_proc_pool_child_fork)) {
+        guacd_proc_pool_instance = NULL;
+        goto fail_sync;
+    }
+
+    /* Begin filling the pool */
+    if (pthread_create(&pool->refill_thread, NULL,
+                guacd_proc_pool_refill_thread, pool)) {
+
+        /* The fork handlers remain registered, and thus the pool must
+         * remain allocated, but will always be empty */
+        pool->protocol_count = 0;
+        goto fail_cleanup;
+
+    }
+
+    pthread_detach(pool->refill_thread);
+    free(names);
+    return pool;
+
+fail_sync:
+    pthread_cond_destroy(&pool->refill);
+    pthread_mutex_destroy(&pool->lock);
+
+fail:
+    if (pool != NULL) {
+
+        if (pool->protocols != NULL) {
+            for (int i = 0; i < pool->protocol_count; i++) {
+                free(pool->protocols[i].name);
+                free(pool->protocols[i].idle);
+            }
+        }
+
+        free(pool->protocols);
+        free(pool);
+
+    }
+
+fail_cleanup:
+    free(names);
+    return NULL;
+
+}
+
+guacd_proc* guacd_proc_pool_take(guacd_proc_pool* pool, const char* protocol_name) {
+
+    guacd_proc* proc = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+
+    /* Locate idle processes of requested protocol, if any */
+    guacd_proc_pool_protocol* protocol = NULL;
+    for (int i = 0; i < pool->protocol_count; i++) {
+        if (strcmp(pool->protocols[i].name, protocol_name) == 0) {
+            protocol = &pool->protocols[i];
+            break;
+        }
+    }
+
+    /* Pre-forking is not enabled for the requested protocol */
+    if (protocol == NULL) {
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+
+    /* Take most recently forked process which is still running (terminated
+     * children are reaped automatically, thus no zombies remain) */
+    while (protocol->length > 0) {
+
+        guacd_proc* candidate = protocol->idle[--protocol->length];
+        if (kill(candidate->pid, 0) == 0) {
+            proc = candidate;
+            break;
+        }
+
+        guacd_log(GUAC_LOG_DEBUG, "Discarding terminated pre-forked process "
+                "for protocol \"%s\".", protocol->name);
+        guacd_proc_pool_discard(candidate);
+
+    }
+
+    if (proc != NULL) {
+        protocol->hits++;
+        guacd_log(GUAC_LOG_INFO, "Using pre-forked process for protocol "
+                "\"%s\" (%u hits, %u misses)", protocol->name,
+                protocol->hits, protocol->misses);
+    }
+    else {
+        protocol->misses++;
+        guacd_log(GUAC_LOG_INFO, "No pre-forked process available for "
+                "protocol \"%s\" (%u hits, %u misses)", protocol->name,
+                protocol->hits, protocol->misses);
+    }
+
+    /* Replace the process taken (or any terminated processes discarded) */
+    pthread_cond_signal(&pool->refill);
+    pthread_mutex_unlock(&pool->lock);
+
+    return proc;
+
+}
+
@@ -0,0 +1,86 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACD_PROC_POOL_H
+#define GUACD_PROC_POOL_H
+
+#include "config.h"
+
+#include "proc.h"
+
+/**
+ * A pool of idle connection processes which have been forked ahead of time
+ * and have already loaded the client plugin of their protocol. Taking a
+ * process from the pool avoids the cost of forking and initializing the
+ * client plugin while the user waits. Each process taken from the pool is
+ * replaced in the background by a dedicated refill thread.
+ */
+typedef struct guacd_proc_pool guacd_proc_pool;
+
+/**
+ * Allocates a new process pool, starting a background thread which forks
+ * the given number of idle processes for each of the given protocols. Only
+ * one process pool may exist within guacd.
+ *
+ * @param protocols
+ *     A comma-separated list of the names of all protocols which should have
+ *     pre-forked processes, such as "rdp,vnc".
+ *
+ * @param size
+ *     The number of idle processes to maintain for each protocol. This must
+ *     be positive.
+ *
+ * @param buffer_size
+ *     The initial size of the output buffer of each guac_socket created for
+ *     users of the pre-forked processes, in bytes.
+ *
+ * @param max_buffer_size
+ *     The maximum size that the output buffer of each guac_socket created for
+ *     users of the pre-forked processes may grow to, in bytes.
+ *
+ * @return
+ *     The newly-allocated process pool, or NULL if the pool could not be
+ *     allocated.
+ */
+guacd_proc_pool* guacd_proc_pool_alloc(const char* protocols, int size,
+        int buffer_size, int max_buffer_size);
+
+/**
+ * Removes and returns an idle, pre-forked process for the given protocol from
+ * the given pool, signalling the refill thread to fork a replacement. The
+ * returned process is exactly equivalent to a process returned by
+ * guacd_create_proc(), and has not yet received any users. The running
+ * totals of pool hits and misses for the given protocol are logged with
+ * each call.
+ *
+ * @param pool
+ *     The pool to take a process from.
+ *
+ * @param protocol
+ *     The protocol that the process must be handling.
+ *
+ * @return
+ *     An idle process for the given protocol, or NULL if no such process is
+ *     currently available, including if pre-forking is not enabled for the
+ *     given protocol.
+ */
+guacd_proc* guacd_proc_pool_take(guacd_proc_pool* pool, const char* protocol);
+
+#endif
+
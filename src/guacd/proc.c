@@ -84,7 +84,8 @@ static void* guacd_user_thread(void* data) {
     guac_client* client = proc->client;
 
     /* Get guac_socket for user's file descriptor */
-    guac_socket* socket = guac_socket_open(params->fd);
+    guac_socket* socket = guac_socket_open_buffered(params->fd,
+            proc->buffer_size, proc->max_buffer_size);
     if (socket == NULL)
         return NULL;
 
@@ -388,12 +389,16 @@ cleanup_process:
 
 }
 
-guacd_proc* guacd_create_proc(const char* protocol) {
+guacd_proc* guacd_create_proc(const char* protocol, int buffer_size,
+        int max_buffer_size) {
 
     int sockets[2];
 
-    /* Open UNIX socket pair */
-    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets) < 0) {
+    /* Open UNIX socket pair, preferring a connection-oriented socket where
+     * supported, such that an idle child observes the termination of guacd
+     * as end-of-file rather than waiting for users indefinitely */
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets) < 0
+            && socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets) < 0) {
         guacd_log(GUAC_LOG_ERROR, "Error opening socket pair: %s", strerror(errno));
         return NULL;
     }
@@ -409,6 +414,10 @@ guacd_proc* guacd_create_proc(const char* protocol) {
         return NULL;
     }
 
+    /* Store buffer sizes for future user sockets */
+    proc->buffer_size = buffer_size;
+    proc->max_buffer_size = max_buffer_size;
+
     /* Associate new client */
     proc->client = guac_client_alloc();
     if (proc->client == NULL) {
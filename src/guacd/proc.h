@@ -78,6 +78,18 @@ typedef struct guacd_proc {
      */
     guac_client* client;
 
+    /**
+     * The initial size of the output buffer of each guac_socket created for
+     * users of this process, in bytes.
+     */
+    int buffer_size;
+
+    /**
+     * The maximum size that the output buffer of each guac_socket created for
+     * users of this process may grow to, in bytes.
+     */
+    int max_buffer_size;
+
 } guacd_proc;
 
 /**
@@ -89,12 +101,21 @@ typedef struct guacd_proc {
  * @param protocol
  *     The protocol for which this process is client being created.
  *
+ * @param buffer_size
+ *     The initial size of the output buffer of each guac_socket created for
+ *     users of the new process, in bytes.
+ *
+ * @param max_buffer_size
+ *     The maximum size that the output buffer of each guac_socket created for
+ *     users of the new process may grow to, in bytes.
+ *
  * @return
  *     A newly-allocated process structure pointing to the file descriptor of
  *     the background process specific to the specified protocol, or NULL of
  *     the process could not be created.
  */
-guacd_proc* guacd_create_proc(const char* protocol);
+guacd_proc* guacd_create_proc(const char* protocol, int buffer_size,
+        int max_buffer_size);
 
 /**
  * Signals the given process to stop accepting new users and clean up. This
@@ -23,6 +23,7 @@
 #include "log.h"
 
 #include <guacamole/client.h>
+#include <guacamole/opcode.h>
 
 #include <string.h>
 
@@ -44,33 +45,62 @@ guacenc_instruction_handler_mapping guacenc_instruction_handler_map[] = {
     {NULL,       NULL}
 };
 
-int guacenc_handle_instruction(guacenc_display* display, const char* opcode,
-        int argc, char** argv) {
+/**
+ * Perfect hash index of the opcodes within guacenc_instruction_handler_map,
+ * built upon the first call to guacenc_handle_instruction().
+ */
+static guac_opcode_index* guacenc_instruction_handler_index = NULL;
 
-    /* Search through mapping for instruction handler having given opcode */
-    guacenc_instruction_handler_mapping* current = guacenc_instruction_handler_map;
-    while (current->opcode != NULL) {
+/**
+ * Returns the position of the mapping having the given opcode within
+ * guacenc_instruction_handler_map, building the perfect hash index of that
+ * map if it has not yet been built. If the index cannot be built, the map is
+ * scanned linearly.
+ *
+ * @param opcode
+ *     The opcode to search for.
+ *
+ * @return
+ *     The position of the mapping having the given opcode, or -1 if no such
+ *     mapping exists.
+ */
+static int guacenc_find_instruction_handler(const char* opcode) {
 
-        /* Invoke handler if opcode matches (if defined) */
-        if (strcmp(current->opcode, opcode) == 0) {
+    if (guacenc_instruction_handler_index == NULL)
+        guacenc_instruction_handler_index = guac_opcode_index_alloc(
+                &guacenc_instruction_handler_map[0].opcode,
+                sizeof(guacenc_instruction_handler_mapping));
 
-            /* Invoke defined handler */
-            guacenc_instruction_handler* handler = current->handler;
-            if (handler != NULL)
-                return handler(display, argc, argv);
+    if (guacenc_instruction_handler_index != NULL)
+        return guac_opcode_index_find(guacenc_instruction_handler_index,
+                opcode);
 
-            /* Log defined but unimplemented instructions */
-            guacenc_log(GUAC_LOG_DEBUG, "\"%s\" not implemented", opcode);
-            return 0;
+    /* Search through mapping for instruction handler having given opcode */
+    for (int i = 0; guacenc_instruction_handler_map[i].opcode != NULL; i++) {
+        if (strcmp(guacenc_instruction_handler_map[i].opcode, opcode) == 0)
+            return i;
+    }
 
-        }
+    return -1;
 
-        /* Next candidate handler */
-        current++;
+}
 
-    } /* end opcode search */
+int guacenc_handle_instruction(guacenc_display* display, const char* opcode,
+        int argc, char** argv) {
 
     /* Ignore any unknown instructions */
+    int position = guacenc_find_instruction_handler(opcode);
+    if (position == -1)
+        return 0;
+
+    /* Invoke defined handler */
+    guacenc_instruction_handler* handler =
+        guacenc_instruction_handler_map[position].handler;
+    if (handler != NULL)
+        return handler(display, argc, argv);
+
+    /* Log defined but unimplemented instructions */
+    guacenc_log(GUAC_LOG_DEBUG, "\"%s\" not implemented", opcode);
     return 0;
 
 }
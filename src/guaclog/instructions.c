@@ -22,6 +22,8 @@
 #include "instructions.h"
 #include "log.h"
 
+#include <guacamole/opcode.h>
+
 #include <string.h>
 
 guaclog_instruction_handler_mapping guaclog_instruction_handler_map[] = {
@@ -29,33 +31,62 @@ guaclog_instruction_handler_mapping guaclog_instruction_handler_map[] = {
     {NULL,  NULL}
 };
 
-int guaclog_handle_instruction(guaclog_state* state, const char* opcode,
-        int argc, char** argv) {
+/**
+ * Perfect hash index of the opcodes within guaclog_instruction_handler_map,
+ * built upon the first call to guaclog_handle_instruction().
+ */
+static guac_opcode_index* guaclog_instruction_handler_index = NULL;
 
-    /* Search through mapping for instruction handler having given opcode */
-    guaclog_instruction_handler_mapping* current = guaclog_instruction_handler_map;
-    while (current->opcode != NULL) {
+/**
+ * Returns the position of the mapping having the given opcode within
+ * guaclog_instruction_handler_map, building the perfect hash index of that
+ * map if it has not yet been built. If the index cannot be built, the map is
+ * scanned linearly.
+ *
+ * @param opcode
+ *     The opcode to search for.
+ *
+ * @return
+ *     The position of the mapping having the given opcode, or -1 if no such
+ *     mapping exists.
+ */
+static int guaclog_find_instruction_handler(const char* opcode) {
 
-        /* Invoke handler if opcode matches (if defined) */
-        if (strcmp(current->opcode, opcode) == 0) {
+    if (guaclog_instruction_handler_index == NULL)
+        guaclog_instruction_handler_index = guac_opcode_index_alloc(
+                &guaclog_instruction_handler_map[0].opcode,
+                sizeof(guaclog_instruction_handler_mapping));
 
-            /* Invoke defined handler */
-            guaclog_instruction_handler* handler = current->handler;
-            if (handler != NULL)
-                return handler(state, argc, argv);
+    if (guaclog_instruction_handler_index != NULL)
+        return guac_opcode_index_find(guaclog_instruction_handler_index,
+                opcode);
 
-            /* Log defined but unimplemented instructions */
-            guaclog_log(GUAC_LOG_DEBUG, "\"%s\" not implemented", opcode);
-            return 0;
+    /* Search through mapping for instruction handler having given opcode */
+    for (int i = 0; guaclog_instruction_handler_map[i].opcode != NULL; i++) {
+        if (strcmp(guaclog_instruction_handler_map[i].opcode, opcode) == 0)
+            return i;
+    }
 
-        }
+    return -1;
 
-        /* Next candidate handler */
-        current++;
+}
 
-    } /* end opcode search */
+int guaclog_handle_instruction(guaclog_state* state, const char* opcode,
+        int argc, char** argv) {
 
     /* Ignore any unknown instructions */
+    int position = guaclog_find_instruction_handler(opcode);
+    if (position == -1)
+        return 0;
+
+    /* Invoke defined handler */
+    guaclog_instruction_handler* handler =
+        guaclog_instruction_handler_map[position].handler;
+    if (handler != NULL)
+        return handler(state, argc, argv);
+
+    /* Log defined but unimplemented instructions */
+    guaclog_log(GUAC_LOG_DEBUG, "\"%s\" not implemented", opcode);
     return 0;
 
 }
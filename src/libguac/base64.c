@@ -0,0 +1,381 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "base64.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GUAC_BASE64_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define GUAC_BASE64_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * The 64 characters of the base64 alphabet, in order of their corresponding
+ * 6-bit values.
+ */
+static const char guac_base64_alphabet[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+/**
+ * Function which encodes as many complete blocks of the given data as is
+ * convenient for a particular implementation, returning the number of input
+ * bytes consumed. The number of bytes consumed is always a multiple of three,
+ * and the number of characters written is always 4/3 of that value.
+ *
+ * @param data
+ *     The binary data to encode.
+ *
+ * @param length
+ *     The number of bytes within the given buffer of binary data.
+ *
+ * @param output
+ *     The buffer into which the resulting base64 characters should be
+ *     written.
+ *
+ * @return
+ *     The number of bytes of input data which were encoded.
+ */
+typedef size_t guac_base64_block_encoder(const unsigned char* data,
+        size_t length, char* output);
+
+/**
+ * Encodes as many complete triplets of the given data as possible, one
+ * triplet at a time. This implementation is used on CPUs lacking any
+ * supported SIMD instructions, and to finish off data left over by the SIMD
+ * implementations.
+ *
+ * @see guac_base64_block_encoder
+ */
+static size_t guac_base64_encode_scalar(const unsigned char* data,
+        size_t length, char* output) {
+
+    size_t consumed = length - (length % 3);
+    const unsigned char* end = data + consumed;
+
+    while (data < end) {
+
+        uint32_t triplet = ((uint32_t) data[0] << 16)
+                         | ((uint32_t) data[1] << 8)
+                         |  (uint32_t) data[2];
+
+        output[0] = guac_base64_alphabet[(triplet >> 18) & 0x3F];
+        output[1] = guac_base64_alphabet[(triplet >> 12) & 0x3F];
+        output[2] = guac_base64_alphabet[(triplet >>  6) & 0x3F];
+        output[3] = guac_base64_alphabet[ triplet        & 0x3F];
+
+        data   += 3;
+        output += 4;
+
+    }
+
+    return consumed;
+
+}
+
+#ifdef GUAC_BASE64_X86
+
+/*
+ * The x86 implementations below follow the approach described by Wojciech
+ * Muła ("Base64 encoding with SIMD instructions"): each group of three bytes
+ * is first shuffled into a 32-bit lane, the four 6-bit indices within that
+ * lane are isolated using multiplication by powers of two, and each index is
+ * finally translated into its ASCII character by adding an offset chosen via
+ * a 16-entry lookup performed by PSHUFB. SSE2 alone lacks PSHUFB, thus SSSE3
+ * is the minimum instruction set used.
+ */
+
+/**
+ * Splits the 12 bytes stored within bytes 0-11 of the given vector (after
+ * shuffling) into sixteen 6-bit indices, one index per byte.
+ *
+ * @param in
+ *     The vector containing the bytes to split.
+ *
+ * @return
+ *     A vector of sixteen 6-bit values, each within its own byte.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i guac_base64_split_ssse3(__m128i in) {
+
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(
+                10, 11,  9, 10,
+                 7,  8,  6,  7,
+                 4,  5,  3,  4,
+                 1,  2,  0,  1));
+
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(t1, t3);
+
+}
+
+/**
+ * Translates sixteen 6-bit indices into their corresponding base64
+ * characters.
+ *
+ * @param indices
+ *     A vector of sixteen 6-bit values, each within its own byte.
+ *
+ * @return
+ *     A vector of the sixteen base64 characters corresponding to the given
+ *     indices.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i guac_base64_translate_ssse3(__m128i indices) {
+
+    const __m128i offsets = _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+            '/' - 63, 'A',      0,        0);
+
+    /* Map 0-25 to 13, 26-51 to 0, and 52-63 to 1-12 */
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, result));
+
+}
+
+/**
+ * Encodes 12 bytes at a time using SSSE3 instructions. As each block is read
+ * with a 16-byte load, at least 16 bytes must remain for a block to be
+ * encoded.
+ *
+ * @see guac_base64_block_encoder
+ */
+__attribute__((target("ssse3")))
+static size_t guac_base64_encode_ssse3(const unsigned char* data,
+        size_t length, char* output) {
+
+    size_t consumed = 0;
+
+    while (length - consumed >= 16) {
+
+        __m128i in = _mm_loadu_si128((const __m128i*) (data + consumed));
+        __m128i out = guac_base64_translate_ssse3(guac_base64_split_ssse3(in));
+        _mm_storeu_si128((__m128i*) output, out);
+
+        consumed += 12;
+        output   += 16;
+
+    }
+
+    return consumed;
+
+}
+
+/**
+ * Encodes 24 bytes at a time using AVX2 instructions. Each block is read as
+ * two overlapping 16-byte loads (one per 128-bit lane), thus at least 28
+ * bytes must remain for a block to be encoded.
+ *
+ * @see guac_base64_block_encoder
+ */
+__attribute__((target("avx2")))
+static size_t guac_base64_encode_avx2(const unsigned char* data,
+        size_t length, char* output) {
+
+    const __m256i shuffle = _mm256_set_epi8(
+            10, 11,  9, 10,  7,  8,  6,  7,  4,  5,  3,  4,  1,  2,  0,  1,
+            10, 11,  9, 10,  7,  8,  6,  7,  4,  5,  3,  4,  1,  2,  0,  1);
+
+    const __m256i offsets = _mm256_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+            '/' - 63, 'A',      0,        0,
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+            '/' - 63, 'A',      0,        0);
+
+    size_t consumed = 0;
+
+    while (length - consumed >= 28) {
+
+        const unsigned char* current = data + consumed;
+
+        /* Load 12 bytes into each 128-bit lane */
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                    _mm_loadu_si128((const __m128i*) current)),
+                _mm_loadu_si128((const __m128i*) (current + 12)), 1);
+
+        /* Split into 6-bit indices */
+        in = _mm256_shuffle_epi8(in, shuffle);
+        __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t1, t3);
+
+        /* Translate indices into characters */
+        __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        result = _mm256_or_si256(result,
+                _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        result = _mm256_add_epi8(indices,
+                _mm256_shuffle_epi8(offsets, result));
+
+        _mm256_storeu_si256((__m256i*) output, result);
+
+        consumed += 24;
+        output   += 32;
+
+    }
+
+    return consumed;
+
+}
+
+#endif
+
+#ifdef GUAC_BASE64_NEON
+
+/**
+ * Encodes 48 bytes at a time using NEON instructions. The input is
+ * de-interleaved into three vectors of 16 bytes each, split into four
+ * vectors of 6-bit indices, and translated to characters with a single
+ * 64-byte table lookup.
+ *
+ * @see guac_base64_block_encoder
+ */
+static size_t guac_base64_encode_neon(const unsigned char* data,
+        size_t length, char* output) {
+
+    const uint8x16_t mask = vdupq_n_u8(0x3F);
+    const uint8_t* alphabet = (const uint8_t*) guac_base64_alphabet;
+
+    uint8x16x4_t table;
+    table.val[0] = vld1q_u8(alphabet);
+    table.val[1] = vld1q_u8(alphabet + 16);
+    table.val[2] = vld1q_u8(alphabet + 32);
+    table.val[3] = vld1q_u8(alphabet + 48);
+
+    size_t consumed = 0;
+
+    while (length - consumed >= 48) {
+
+        uint8x16x3_t in = vld3q_u8(data + consumed);
+        uint8x16x4_t out;
+
+        out.val[0] = vshrq_n_u8(in.val[0], 2);
+        out.val[1] = vorrq_u8(vshrq_n_u8(in.val[1], 4),
+                vandq_u8(vshlq_n_u8(in.val[0], 4), mask));
+        out.val[2] = vorrq_u8(vshrq_n_u8(in.val[2], 6),
+                vandq_u8(vshlq_n_u8(in.val[1], 2), mask));
+        out.val[3] = vandq_u8(in.val[2], mask);
+
+        out.val[0] = vqtbl4q_u8(table, out.val[0]);
+        out.val[1] = vqtbl4q_u8(table, out.val[1]);
+        out.val[2] = vqtbl4q_u8(table, out.val[2]);
+        out.val[3] = vqtbl4q_u8(table, out.val[3]);
+
+        vst4q_u8((uint8_t*) output, out);
+
+        consumed += 48;
+        output   += 64;
+
+    }
+
+    return consumed;
+
+}
+
+#endif
+
+/**
+ * The block encoder which should be used for the bulk of all input, as
+ * selected by guac_base64_select_encoder() based on the capabilities of the
+ * current CPU.
+ */
+static guac_base64_block_encoder* guac_base64_block_encode =
+    guac_base64_encode_scalar;
+
+/**
+ * Guarantees that guac_base64_select_encoder() is invoked exactly once.
+ */
+static pthread_once_t guac_base64_encoder_selected = PTHREAD_ONCE_INIT;
+
+/**
+ * Selects the fastest available block encoder for the current CPU, storing
+ * that selection within guac_base64_block_encode.
+ */
+static void guac_base64_select_encoder() {
+
+#ifdef GUAC_BASE64_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        guac_base64_block_encode = guac_base64_encode_avx2;
+    else if (__builtin_cpu_supports("ssse3"))
+        guac_base64_block_encode = guac_base64_encode_ssse3;
+#elif defined(GUAC_BASE64_NEON)
+    guac_base64_block_encode = guac_base64_encode_neon;
+#endif
+
+}
+
+size_t guac_base64_encode(const unsigned char* data, size_t length,
+        char* output) {
+
+    pthread_once(&guac_base64_encoder_selected, guac_base64_select_encoder);
+
+    /* Encode bulk of data using fastest available implementation */
+    size_t consumed = guac_base64_block_encode(data, length, output);
+    char* current = output + consumed / 3 * 4;
+
+    /* Encode any remaining complete triplets */
+    size_t remaining = guac_base64_encode_scalar(data + consumed,
+            length - consumed, current);
+    consumed += remaining;
+    current += remaining / 3 * 4;
+
+    /* Encode final partial triplet with padding */
+    if (consumed < length) {
+
+        unsigned int a = data[consumed];
+        unsigned int b = (consumed + 1 < length) ? data[consumed + 1] : 0;
+
+        current[0] = guac_base64_alphabet[a >> 2];
+        current[1] = guac_base64_alphabet[((a & 0x03) << 4) | (b >> 4)];
+        current[2] = (consumed + 1 < length)
+                   ? guac_base64_alphabet[(b & 0x0F) << 2] : '=';
+        current[3] = '=';
+
+        current += 4;
+
+    }
+
+    return current - output;
+
+}
+
@@ -0,0 +1,66 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_BASE64_H
+#define GUAC_BASE64_H
+
+#include "config.h"
+
+#include <stddef.h>
+
+/**
+ * Returns the number of base64 characters which result from encoding the
+ * given number of bytes, including any padding.
+ *
+ * @param length
+ *     The number of bytes to be encoded.
+ *
+ * @return
+ *     The number of characters which result from encoding the given number
+ *     of bytes as base64.
+ */
+#define GUAC_BASE64_ENCODED_LENGTH(length) ((((length) + 2) / 3) * 4)
+
+/**
+ * Encodes the given buffer of arbitrary binary data as base64, storing the
+ * resulting characters within the given output buffer. Padding characters are
+ * written only if the length of the input data is not a multiple of three. The
+ * output is NOT null-terminated. Depending on the capabilities of the CPU,
+ * the bulk of the input will be encoded using SIMD instructions (SSSE3, AVX2,
+ * or NEON), with any remaining bytes encoded one triplet at a time.
+ *
+ * @param data
+ *     The binary data to encode.
+ *
+ * @param length
+ *     The number of bytes within the given buffer of binary data.
+ *
+ * @param output
+ *     The buffer into which the resulting base64 characters should be
+ *     written. This buffer must be at least
+ *     GUAC_BASE64_ENCODED_LENGTH(length) bytes long.
+ *
+ * @return
+ *     The number of characters written to the output buffer.
+ */
+size_t guac_base64_encode(const unsigned char* data, size_t length,
+        char* output);
+
+#endif
+
@@ -34,6 +34,7 @@
 #include "guacamole/timestamp.h"
 #include "guacamole/user.h"
 #include "id.h"
+#include "socket-broadcast.h"
 
 #include <dlfcn.h>
 #include <inttypes.h>
@@ -178,6 +179,7 @@ guac_client* guac_client_alloc() {
 
     /* Set up socket to broadcast to all users */
     client->socket = guac_socket_broadcast(client);
+    client->__broadcast_socket = client->socket;
 
     return client;
 
@@ -307,6 +309,10 @@ int guac_client_add_user(guac_client* client, guac_user* user, int argc, char**
 
     pthread_rwlock_unlock(&(client->__users_lock));
 
+    /* Begin draining broadcast output to user if broadcasting via ring */
+    if (retval == 0)
+        guac_socket_broadcast_add_user(client->__broadcast_socket, user);
+
     /* Notify owner of user joining connection. */
     if (retval == 0 && !user->owner)
         guac_client_owner_notify_join(client, user);
@@ -337,6 +343,9 @@ void guac_client_remove_user(guac_client* client, guac_user* user) {
 
     pthread_rwlock_unlock(&(client->__users_lock));
 
+    /* Stop draining broadcast output to user if broadcasting via ring */
+    guac_socket_broadcast_remove_user(client->__broadcast_socket, user);
+
     /* Update owner of user having left the connection. */
     if (!user->owner)
         guac_client_owner_notify_leave(client, user);
@@ -551,17 +560,69 @@ static void* __calculate_lag(guac_user* user, void* data) {
 
 }
 
+/**
+ * Callback for guac_client_foreach_user() which behaves identically to
+ * __calculate_lag(), except that users whose processing lag exceeds
+ * GUAC_CLIENT_FRAME_SKIP_LAG are ignored. Such users have frames skipped by
+ * the broadcast socket and should not affect the pacing of frames for other
+ * users.
+ *
+ * @param user
+ *     The guac_user to use to update the approximate processing lag.
+ *
+ * @param data
+ *     Pointer to an int containing the current approximate processing lag.
+ *     The int will be updated according to the processing lag of the given
+ *     user.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __calculate_paced_lag(guac_user* user, void* data) {
+
+    /* Ignore users that are having frames skipped */
+    if (user->processing_lag > GUAC_CLIENT_FRAME_SKIP_LAG)
+        return NULL;
+
+    return __calculate_lag(user, data);
+
+}
+
 int guac_client_get_processing_lag(guac_client* client) {
 
     int processing_lag = 0;
 
-    /* Approximate the processing lag of all users */
-    guac_client_foreach_user(client, __calculate_lag, &processing_lag);
+    /* Approximate the processing lag of all users, excluding any users whose
+     * frames are skipped if they cannot keep up */
+    if (guac_socket_broadcast_skips_frames(client->__broadcast_socket))
+        guac_client_foreach_user(client, __calculate_paced_lag,
+                &processing_lag);
+    else
+        guac_client_foreach_user(client, __calculate_lag, &processing_lag);
 
     return processing_lag;
 
 }
 
+int guac_client_skips_frames(guac_client* client) {
+    return guac_socket_broadcast_skips_frames(client->__broadcast_socket);
+}
+
+int guac_client_enable_broadcast_ring(guac_client* client, size_t max_lag,
+        guac_client_lag_policy policy) {
+    return guac_socket_broadcast_enable_ring(client->__broadcast_socket,
+            max_lag, policy);
+}
+
+size_t guac_client_get_broadcast_lag(guac_client* client, guac_user* user) {
+    return guac_socket_broadcast_get_lag(client->__broadcast_socket, user);
+}
+
+void guac_client_discard_broadcast(guac_client* client, guac_user* user,
+        guac_socket* socket) {
+    guac_socket_broadcast_discard(client->__broadcast_socket, user, socket);
+}
+
 void guac_client_stream_argv(guac_client* client, guac_socket* socket,
         const char* mimetype, const char* name, const char* value) {
 
@@ -585,6 +646,15 @@ void guac_client_stream_argv(guac_client* client, guac_socket* socket,
 void guac_client_stream_png(guac_client* client, guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer, int x, int y,
         cairo_surface_t* surface) {
+    guac_client_stream_png_compressed(client, socket, mode, layer, x, y,
+            surface, GUAC_CLIENT_PNG_DEFAULT_COMPRESSION,
+            GUAC_PNG_FILTER_DEFAULT);
+}
+
+void guac_client_stream_png_compressed(guac_client* client,
+        guac_socket* socket, guac_composite_mode mode,
+        const guac_layer* layer, int x, int y, cairo_surface_t* surface,
+        int compression_level, guac_png_filter filter) {
 
     /* Allocate new stream for image */
     guac_stream* stream = guac_client_alloc_stream(client);
@@ -593,7 +663,7 @@ void guac_client_stream_png(guac_client* client, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/png", x, y);
 
     /* Write PNG data */
-    guac_png_write(socket, stream, surface);
+    guac_png_write(socket, stream, surface, compression_level, filter);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -627,6 +697,13 @@ void guac_client_stream_jpeg(guac_client* client, guac_socket* socket,
 void guac_client_stream_webp(guac_client* client, guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer, int x, int y,
         cairo_surface_t* surface, int quality, int lossless) {
+    guac_client_stream_webp_method(client, socket, mode, layer, x, y,
+            surface, quality, lossless, GUAC_WEBP_DEFAULT_METHOD);
+}
+
+void guac_client_stream_webp_method(guac_client* client, guac_socket* socket,
+        guac_composite_mode mode, const guac_layer* layer, int x, int y,
+        cairo_surface_t* surface, int quality, int lossless, int method) {
 
 #ifdef ENABLE_WEBP
     /* Allocate new stream for image */
@@ -636,7 +713,7 @@ void guac_client_stream_webp(guac_client* client, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/webp", x, y);
 
     /* Write WebP data */
-    guac_webp_write(socket, stream, surface, quality, lossless);
+    guac_webp_write(socket, stream, surface, quality, lossless, method);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -23,12 +23,14 @@
 #include "guacamole/error.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
+#include "encode-scratch.h"
 #include "palette.h"
 
 #include <cairo/cairo.h>
 #include <jpeglib.h>
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -164,6 +166,99 @@ static void jpeg_guac_dest(j_compress_ptr cinfo, guac_socket* socket,
 
 }
 
+/**
+ * Encoder state which is reused by all JPEG images written by the same
+ * thread. The libjpeg compression structure (including its destination
+ * manager and output buffer) is created only once per thread rather than once
+ * per image.
+ */
+typedef struct guac_jpeg_encoder {
+
+    /**
+     * The libjpeg compression structure, created via jpeg_create_compress()
+     * when the encoder is allocated.
+     */
+    struct jpeg_compress_struct cinfo;
+
+    /**
+     * The libjpeg error handler associated with cinfo.
+     */
+    struct jpeg_error_mgr error;
+
+    /**
+     * The buffer receiving each RGB scanline converted from the source
+     * surface, if the libjpeg implementation cannot read BGRx directly.
+     */
+    guac_encode_buffer scanline;
+
+} guac_jpeg_encoder;
+
+/**
+ * The key used to store the guac_jpeg_encoder of each thread.
+ */
+static pthread_key_t guac_jpeg_encoder_key;
+
+/**
+ * Guard ensuring guac_jpeg_encoder_key is created exactly once.
+ */
+static pthread_once_t guac_jpeg_encoder_key_init = PTHREAD_ONCE_INIT;
+
+/**
+ * Frees the given guac_jpeg_encoder, destroying its compression structure.
+ * This function is invoked automatically when a thread having a
+ * guac_jpeg_encoder exits.
+ *
+ * @param data
+ *     The guac_jpeg_encoder to free.
+ */
+static void guac_jpeg_encoder_free(void* data) {
+
+    guac_jpeg_encoder* encoder = (guac_jpeg_encoder*) data;
+
+    jpeg_destroy_compress(&encoder->cinfo);
+    guac_encode_buffer_free(&encoder->scanline);
+    free(encoder);
+
+}
+
+/**
+ * Creates guac_jpeg_encoder_key. This function is invoked only once, via
+ * pthread_once().
+ */
+static void guac_jpeg_encoder_alloc_key() {
+    pthread_key_create(&guac_jpeg_encoder_key, guac_jpeg_encoder_free);
+}
+
+/**
+ * Returns the guac_jpeg_encoder of the current thread, allocating and
+ * initializing a new encoder if the current thread has not yet written any
+ * JPEG images.
+ *
+ * @return
+ *     The guac_jpeg_encoder of the current thread, or NULL if a new encoder
+ *     was needed but could not be allocated.
+ */
+static guac_jpeg_encoder* guac_jpeg_encoder_get() {
+
+    pthread_once(&guac_jpeg_encoder_key_init, guac_jpeg_encoder_alloc_key);
+
+    guac_jpeg_encoder* encoder = pthread_getspecific(guac_jpeg_encoder_key);
+    if (encoder == NULL) {
+
+        encoder = calloc(1, sizeof(guac_jpeg_encoder));
+        if (encoder == NULL)
+            return NULL;
+
+        encoder->cinfo.err = jpeg_std_error(&encoder->error);
+        jpeg_create_compress(&encoder->cinfo);
+        pthread_setspecific(guac_jpeg_encoder_key, encoder);
+
+    }
+
+    return encoder;
+
+}
+
 int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
         cairo_surface_t* surface, int quality) {
 
@@ -185,48 +280,58 @@ int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
     /* Flush pending operations to surface */
     cairo_surface_flush(surface);
 
-    /* Prepare JPEG bits */
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
+    /* Reuse this thread's compression structure */
+    guac_jpeg_encoder* encoder = guac_jpeg_encoder_get();
+    if (encoder == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Insufficient memory for JPEG encoder";
+        return -1;
+    }
+
+    j_compress_ptr cinfo = &encoder->cinfo;
 
     /* Write JPEG directly to given stream */
-    jpeg_guac_dest(&cinfo, socket, stream);
+    jpeg_guac_dest(cinfo, socket, stream);
 
-    cinfo.image_width = width; /* image width and height, in pixels */
-    cinfo.image_height = height;
-    cinfo.arith_code = TRUE;
+    cinfo->image_width = width; /* image width and height, in pixels */
+    cinfo->image_height = height;
+    cinfo->arith_code = TRUE;
 
 #ifdef JCS_EXTENSIONS
     /* The Turbo JPEG extentions allows us to use the Cairo surface
      * (BGRx) as input without converting it */
-    cinfo.input_components = 4;
-    cinfo.in_color_space = JCS_EXT_BGRX;
+    cinfo->input_components = 4;
+    cinfo->in_color_space = JCS_EXT_BGRX;
 #else
     /* Standard JPEG supports RGB as input so we will have to convert
      * the contents of the Cairo surface from (BGRx) to RGB */
-    cinfo.input_components = 3;
-    cinfo.in_color_space = JCS_RGB;
-
-    /* Create a buffer for the write scan line which is where we will
-     * put the converted pixels (BGRx -> RGB) */
-    int write_stride = cinfo.image_width * cinfo.input_components;
-    unsigned char *scanline_data = malloc(write_stride);
-    memset(scanline_data, 0, write_stride);
+    cinfo->input_components = 3;
+    cinfo->in_color_space = JCS_RGB;
+
+    /* Reserve the write scan line which is where we will put the converted
+     * pixels (BGRx -> RGB) */
+    int write_stride = cinfo->image_width * cinfo->input_components;
+    unsigned char *scanline_data = guac_encode_buffer_reserve(
+            &encoder->scanline, write_stride);
+
+    if (scanline_data == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Insufficient memory for JPEG scanline";
+        return -1;
+    }
 #endif
 
     /* Initialize the JPEG compressor */
-    jpeg_set_defaults(&cinfo);
-    jpeg_set_quality(&cinfo, quality, TRUE /* limit to baseline-JPEG values */);
-    jpeg_start_compress(&cinfo, TRUE);
+    jpeg_set_defaults(cinfo);
+    jpeg_set_quality(cinfo, quality, TRUE /* limit to baseline-JPEG values */);
+    jpeg_start_compress(cinfo, TRUE);
 
     JSAMPROW row_pointer[1]; /* pointer to a single row */
 
     /* Write scanlines to be used in JPEG compression */
-    while (cinfo.next_scanline < cinfo.image_height) {
+    while (cinfo->next_scanline < cinfo->image_height) {
 
-        int row_offset = stride * cinfo.next_scanline;
+        int row_offset = stride * cinfo->next_scanline;
 
 #ifdef JCS_EXTENSIONS
         /* In Turbo JPEG we can use the raw BGRx scanline  */
@@ -250,18 +355,12 @@ int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
         row_pointer[0] = scanline_data;
 #endif
 
-        jpeg_write_scanlines(&cinfo, row_pointer, 1);
+        jpeg_write_scanlines(cinfo, row_pointer, 1);
     }
 
-#ifndef JCS_EXTENSIONS
-    free(scanline_data);
-#endif
-
-    /* Finalize compression */
-    jpeg_finish_compress(&cinfo);
-
-    /* Clean up */
-    jpeg_destroy_compress(&cinfo);
+    /* Finalize compression, leaving the compression structure ready for
+     * reuse by the next image */
+    jpeg_finish_compress(cinfo);
     return 0;
 
 }
@@ -20,9 +20,12 @@
 #include "config.h"
 
 #include "encode-png.h"
+#include "guacamole/client-constants.h"
+#include "guacamole/client-types.h"
 #include "guacamole/error.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
+#include "encode-scratch.h"
 #include "palette.h"
 
 #include <png.h>
@@ -33,6 +36,7 @@
 #endif
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <setjmp.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -114,6 +118,20 @@ static void guac_png_write_data(guac_png_write_state* write_state,
             remaining = sizeof(write_state->buffer);
         }
 
+        /* Send complete blobs directly from the given data while nothing is
+         * buffered, rather than first copying that data into the buffer */
+        if (remaining == sizeof(write_state->buffer) && length >= remaining) {
+
+            int direct_length = length - length % remaining;
+            guac_protocol_send_blobs(write_state->socket, write_state->stream,
+                    current, direct_length);
+
+            current += direct_length;
+            length -= direct_length;
+            continue;
+
+        }
+
         /* Calculate size of next block of data to append */
         int block_size = remaining;
         if (block_size > length)
@@ -265,49 +283,241 @@ static void guac_png_flush_handler(png_structp png) {
 
 }
 
-int guac_png_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface) {
+/**
+ * Encoder state which is reused by all PNG images written by the same
+ * thread, such that encoding images of similar size repeatedly does not
+ * require memory to be allocated.
+ */
+typedef struct guac_png_encoder {
 
-    png_structp png;
-    png_infop png_info;
-    png_byte** png_rows;
-    int bpp;
+    /**
+     * The arena from which all memory required by libpng (and by zlib on
+     * behalf of libpng) is allocated. The arena is reset after each image.
+     */
+    guac_encode_arena arena;
 
-    int x, y;
+    /**
+     * The array of pointers to each row of the image being written.
+     */
+    guac_encode_buffer rows;
 
-    guac_png_write_state write_state;
+    /**
+     * The image data being written, either one palette index or three RGB
+     * bytes per pixel.
+     */
+    guac_encode_buffer pixels;
 
-    /* Get image surface properties and data */
-    cairo_format_t format = cairo_image_surface_get_format(surface);
-    int width = cairo_image_surface_get_width(surface);
-    int height = cairo_image_surface_get_height(surface);
-    int stride = cairo_image_surface_get_stride(surface);
-    unsigned char* data = cairo_image_surface_get_data(surface);
+    /**
+     * The palette of the image being written, which is reset after each
+     * image.
+     */
+    guac_palette palette;
 
-    /* If not RGB24, use Cairo PNG writer */
-    if (format != CAIRO_FORMAT_RGB24 || data == NULL)
-        return guac_png_cairo_write(socket, stream, surface);
+} guac_png_encoder;
 
-    /* Flush pending operations to surface */
-    cairo_surface_flush(surface);
+/**
+ * The key used to store the guac_png_encoder of each thread.
+ */
+static pthread_key_t guac_png_encoder_key;
 
-    /* Attempt to build palette */
-    guac_palette* palette = guac_palette_alloc(surface);
+/**
+ * Guard ensuring guac_png_encoder_key is created exactly once.
+ */
+static pthread_once_t guac_png_encoder_key_init = PTHREAD_ONCE_INIT;
 
-    /* If not possible, resort to Cairo PNG writer */
-    if (palette == NULL)
-        return guac_png_cairo_write(socket, stream, surface);
+/**
+ * Frees the given guac_png_encoder. This function is invoked automatically
+ * when a thread having a guac_png_encoder exits.
+ *
+ * @param data
+ *     The guac_png_encoder to free.
+ */
+static void guac_png_encoder_free(void* data) {
+
+    guac_png_encoder* encoder = (guac_png_encoder*) data;
+
+    guac_encode_arena_free(&encoder->arena);
+    guac_encode_buffer_free(&encoder->rows);
+    guac_encode_buffer_free(&encoder->pixels);
+    free(encoder);
+
+}
+
+/**
+ * Creates guac_png_encoder_key. This function is invoked only once, via
+ * pthread_once().
+ */
+static void guac_png_encoder_alloc_key() {
+    pthread_key_create(&guac_png_encoder_key, guac_png_encoder_free);
+}
+
+/**
+ * Returns the guac_png_encoder of the current thread, allocating a new
+ * encoder if the current thread has not yet written any PNG images.
+ *
+ * @return
+ *     The guac_png_encoder of the current thread, or NULL if a new encoder
+ *     was needed but could not be allocated.
+ */
+static guac_png_encoder* guac_png_encoder_get() {
+
+    pthread_once(&guac_png_encoder_key_init, guac_png_encoder_alloc_key);
+
+    guac_png_encoder* encoder = pthread_getspecific(guac_png_encoder_key);
+    if (encoder == NULL) {
+        encoder = calloc(1, sizeof(guac_png_encoder));
+        if (encoder != NULL)
+            pthread_setspecific(guac_png_encoder_key, encoder);
+    }
+
+    return encoder;
+
+}
+
+/**
+ * Releases any buffers of the given guac_png_encoder which have grown beyond
+ * GUAC_ENCODE_SCRATCH_MAX_RETAINED while writing an unusually large image.
+ * This function should be invoked once each image has been written.
+ *
+ * @param encoder
+ *     The guac_png_encoder to trim.
+ */
+static void guac_png_encoder_trim(guac_png_encoder* encoder) {
+    guac_encode_buffer_trim(&encoder->rows);
+    guac_encode_buffer_trim(&encoder->pixels);
+}
+
+/**
+ * Allocates memory on behalf of libpng from the arena of the guac_png_encoder
+ * associated with the given PNG write structure.
+ *
+ * @param png
+ *     The PNG write structure requesting memory. The pointer returned by
+ *     png_get_mem_ptr() will be the guac_encode_arena to allocate from.
+ *
+ * @param size
+ *     The number of bytes to allocate.
+ *
+ * @return
+ *     A pointer to the allocated memory, or NULL if allocation fails.
+ */
+static png_voidp guac_png_arena_malloc(png_structp png,
+        png_alloc_size_t size) {
+    return guac_encode_arena_alloc((guac_encode_arena*) png_get_mem_ptr(png),
+            size);
+}
+
+/**
+ * Frees memory allocated on behalf of libpng. As all such memory is
+ * allocated from an arena and released when the arena is reset, this
+ * function has no effect.
+ *
+ * @param png
+ *     The PNG write structure freeing memory.
+ *
+ * @param ptr
+ *     The memory being freed.
+ */
+static void guac_png_arena_free(png_structp png, png_voidp ptr) {
+    /* Released when the arena is reset */
+}
+
+/**
+ * Returns the libpng row filter flags corresponding to the given filter.
+ *
+ * @param filter
+ *     The filter to translate.
+ *
+ * @return
+ *     The libpng filter flags to pass to png_set_filter(), or zero if the
+ *     default filters of libpng should be used.
+ */
+static int guac_png_filter_flags(guac_png_filter filter) {
+
+    switch (filter) {
+
+        case GUAC_PNG_FILTER_NONE:
+            return PNG_FILTER_NONE;
+
+        case GUAC_PNG_FILTER_SUB:
+            return PNG_FILTER_SUB;
+
+        case GUAC_PNG_FILTER_UP:
+            return PNG_FILTER_UP;
+
+        case GUAC_PNG_FILTER_PAETH:
+            return PNG_FILTER_PAETH;
+
+        case GUAC_PNG_FILTER_ADAPTIVE:
+            return PNG_ALL_FILTERS;
 
-    /* Calculate BPP from palette size */
-    if      (palette->size <= 2)  bpp = 1;
-    else if (palette->size <= 4)  bpp = 2;
-    else if (palette->size <= 16) bpp = 4;
-    else                          bpp = 8;
+        default:
+            return 0;
 
-    /* Set up PNG writer */
-    png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    }
+
+}
+
+/**
+ * Writes the given rows of image data as a PNG using libpng directly, sending
+ * the resulting data over the given stream and socket as blobs.
+ *
+ * @param socket
+ *     The socket to send PNG blobs over.
+ *
+ * @param stream
+ *     The stream to associate with each blob.
+ *
+ * @param width
+ *     The width of the image, in pixels.
+ *
+ * @param height
+ *     The height of the image, in pixels.
+ *
+ * @param rows
+ *     The rows of the image, in the format dictated by color_type and
+ *     bit_depth. Palette images having a bit depth less than 8 must store
+ *     one index per byte, as rows are packed automatically.
+ *
+ * @param color_type
+ *     The libpng color type of the image, either PNG_COLOR_TYPE_PALETTE or
+ *     PNG_COLOR_TYPE_RGB.
+ *
+ * @param bit_depth
+ *     The bit depth of the image.
+ *
+ * @param palette
+ *     The palette of the image, or NULL if the image is not a palette image.
+ *
+ * @param compression_level
+ *     The zlib compression level to use, or
+ *     GUAC_CLIENT_PNG_DEFAULT_COMPRESSION to use the default level.
+ *
+ * @param filter
+ *     The row filter to apply prior to compression.
+ *
+ * @param arena
+ *     The arena from which all memory required by libpng should be
+ *     allocated. The arena is reset once the image has been written.
+ *
+ * @return
+ *     Zero if the encoding operation is successful, non-zero otherwise.
+ */
+static int guac_png_write_rows(guac_socket* socket, guac_stream* stream,
+        int width, int height, png_byte** rows, int color_type,
+        int bit_depth, guac_palette* palette, int compression_level,
+        guac_png_filter filter, guac_encode_arena* arena) {
+
+    png_structp png;
+    png_infop png_info;
+
+    guac_png_write_state write_state;
+
+    /* Set up PNG writer, allocating only from the given arena */
+    png = png_create_write_struct_2(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL,
+            arena, guac_png_arena_malloc, guac_png_arena_free);
     if (!png) {
-        guac_palette_free(palette);
+        guac_encode_arena_reset(arena);
         guac_error = GUAC_STATUS_INTERNAL_ERROR;
         guac_error_message = "libpng failed to create write structure";
         return -1;
@@ -316,7 +526,7 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     png_info = png_create_info_struct(png);
     if (!png_info) {
         png_destroy_write_struct(&png, NULL);
-        guac_palette_free(palette);
+        guac_encode_arena_reset(arena);
         guac_error = GUAC_STATUS_INTERNAL_ERROR;
         guac_error_message = "libpng failed to create info structure";
         return -1;
@@ -325,7 +535,7 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     /* Set error handler */
     if (setjmp(png_jmpbuf(png))) {
         png_destroy_write_struct(&png, &png_info);
-        guac_palette_free(palette);
+        guac_encode_arena_reset(arena);
         guac_error = GUAC_STATUS_IO_ERROR;
         guac_error_message = "libpng output error";
         return -1;
@@ -341,29 +551,13 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
             guac_png_write_handler,
             guac_png_flush_handler);
 
-    /* Copy data from surface into PNG data */
-    png_rows = (png_byte**) malloc(sizeof(png_byte*) * height);
-    for (y=0; y<height; y++) {
-
-        /* Allocate new PNG row */
-        png_byte* row = (png_byte*) malloc(sizeof(png_byte) * width);
-        png_rows[y] = row;
-
-        /* Copy data from surface into current row */
-        for (x=0; x<width; x++) {
+    /* Apply requested compression level and filters, if any */
+    if (compression_level != GUAC_CLIENT_PNG_DEFAULT_COMPRESSION)
+        png_set_compression_level(png, compression_level);
 
-            /* Get pixel color */
-            int color = ((uint32_t*) data)[x] & 0xFFFFFF;
-
-            /* Set index in row */
-            row[x] = guac_palette_find(palette, color);
-
-        }
-
-        /* Advance to next data row */
-        data += stride;
-
-    }
+    int filter_flags = guac_png_filter_flags(filter);
+    if (filter_flags != 0)
+        png_set_filter(png, PNG_FILTER_TYPE_BASE, filter_flags);
 
     /* Write image info */
     png_set_IHDR(
@@ -371,30 +565,24 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
         png_info,
         width,
         height,
-        bpp,
-        PNG_COLOR_TYPE_PALETTE,
+        bit_depth,
+        color_type,
         PNG_INTERLACE_NONE,
         PNG_COMPRESSION_TYPE_DEFAULT,
         PNG_FILTER_TYPE_DEFAULT
     );
 
     /* Write palette */
-    png_set_PLTE(png, png_info, palette->colors, palette->size);
+    if (palette != NULL)
+        png_set_PLTE(png, png_info, palette->colors, palette->size);
 
     /* Write image */
-    png_set_rows(png, png_info, png_rows);
+    png_set_rows(png, png_info, rows);
     png_write_png(png, png_info, PNG_TRANSFORM_PACKING, NULL);
 
     /* Finish write */
     png_destroy_write_struct(&png, &png_info);
-
-    /* Free palette */
-    guac_palette_free(palette);
-
-    /* Free PNG data */
-    for (y=0; y<height; y++)
-        free(png_rows[y]);
-    free(png_rows);
+    guac_encode_arena_reset(arena);
 
     /* Ensure all data is written */
     guac_png_flush_data(&write_state);
@@ -402,3 +590,97 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
 
 }
 
+int guac_png_write(guac_socket* socket, guac_stream* stream,
+        cairo_surface_t* surface, int compression_level,
+        guac_png_filter filter) {
+
+    int x, y;
+    int result;
+
+    /* Get image surface properties and data */
+    cairo_format_t format = cairo_image_surface_get_format(surface);
+    int width = cairo_image_surface_get_width(surface);
+    int height = cairo_image_surface_get_height(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    unsigned char* data = cairo_image_surface_get_data(surface);
+
+    /* If not RGB24, use Cairo PNG writer */
+    if (format != CAIRO_FORMAT_RGB24 || data == NULL)
+        return guac_png_cairo_write(socket, stream, surface);
+
+    /* Flush pending operations to surface */
+    cairo_surface_flush(surface);
+
+    /* Reserve row pointers, plus room for three bytes per pixel (enough for
+     * either palette indexes or RGB) */
+    guac_png_encoder* encoder = guac_png_encoder_get();
+    png_byte** png_rows = NULL;
+    png_byte* pixels = NULL;
+    if (encoder != NULL) {
+        png_rows = guac_encode_buffer_reserve(&encoder->rows,
+                sizeof(png_byte*) * height);
+        pixels = guac_encode_buffer_reserve(&encoder->pixels,
+                (size_t) width * height * 3);
+    }
+
+    if (png_rows == NULL || pixels == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Insufficient memory for PNG rows";
+        return -1;
+    }
+
+    /* Attempt to build palette and index rows in a single pass */
+    guac_palette* palette = &encoder->palette;
+    if (!guac_palette_build(palette, surface, pixels)) {
+
+        int bpp;
+
+        /* Calculate BPP from palette size */
+        if      (palette->size <= 2)  bpp = 1;
+        else if (palette->size <= 4)  bpp = 2;
+        else if (palette->size <= 16) bpp = 4;
+        else                          bpp = 8;
+
+        for (y=0; y<height; y++)
+            png_rows[y] = pixels + (size_t) y * width;
+
+        result = guac_png_write_rows(socket, stream, width, height, png_rows,
+                PNG_COLOR_TYPE_PALETTE, bpp, palette, compression_level,
+                filter, &encoder->arena);
+
+        guac_palette_reset(palette);
+        guac_png_encoder_trim(encoder);
+        return result;
+
+    }
+
+    guac_palette_reset(palette);
+
+    /* Too many colors for a palette - write truecolor image instead */
+    for (y=0; y<height; y++) {
+
+        const uint32_t* src = (const uint32_t*) data;
+        png_byte* row = pixels + (size_t) y * width * 3;
+        png_rows[y] = row;
+
+        /* Convert native-endian XRGB pixels to RGB bytes */
+        for (x=0; x<width; x++) {
+            uint32_t color = src[x];
+            *(row++) = (color >> 16) & 0xFF;
+            *(row++) = (color >> 8)  & 0xFF;
+            *(row++) =  color        & 0xFF;
+        }
+
+        /* Advance to next data row */
+        data += stride;
+
+    }
+
+    result = guac_png_write_rows(socket, stream, width, height, png_rows,
+            PNG_COLOR_TYPE_RGB, 8, NULL, compression_level, filter,
+            &encoder->arena);
+
+    guac_png_encoder_trim(encoder);
+    return result;
+
+}
@@ -22,6 +22,7 @@
 
 #include "config.h"
 
+#include "guacamole/client-types.h"
 #include "guacamole/socket.h"
 #include "guacamole/stream.h"
 
@@ -40,11 +41,22 @@
  * @param surface
  *     The Cairo surface to write to the given stream and socket as PNG blobs.
  *
+ * @param compression_level
+ *     The zlib compression level to use, from 0 (no compression) to 9
+ *     (smallest output, slowest), or GUAC_CLIENT_PNG_DEFAULT_COMPRESSION to
+ *     use the default level. This is ignored for surfaces which are not
+ *     RGB24.
+ *
+ * @param filter
+ *     The row filter to apply prior to compression. This is ignored for
+ *     surfaces which are not RGB24.
+ *
  * @return
  *     Zero if the encoding operation is successful, non-zero otherwise.
  */
 int guac_png_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface);
+        cairo_surface_t* surface, int compression_level,
+        guac_png_filter filter);
 
 #endif
 
@@ -0,0 +1,153 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "encode-scratch.h"
+
+#include <stdlib.h>
+
+/**
+ * Rounds the given size up to the nearest multiple of
+ * GUAC_ENCODE_ARENA_ALIGNMENT.
+ *
+ * @param size
+ *     The size to round.
+ *
+ * @return
+ *     The given size, rounded up to the nearest multiple of
+ *     GUAC_ENCODE_ARENA_ALIGNMENT.
+ */
+static size_t guac_encode_arena_align(size_t size) {
+    return (size + GUAC_ENCODE_ARENA_ALIGNMENT - 1)
+        & ~((size_t) GUAC_ENCODE_ARENA_ALIGNMENT - 1);
+}
+
+void* guac_encode_buffer_reserve(guac_encode_buffer* buffer, size_t size) {
+
+    /* Reuse existing buffer if large enough */
+    if (size <= buffer->size)
+        return buffer->data;
+
+    /* Otherwise, replace with a larger buffer */
+    free(buffer->data);
+    buffer->data = malloc(size);
+    buffer->size = buffer->data != NULL ? size : 0;
+
+    return buffer->data;
+
+}
+
+void guac_encode_buffer_trim(guac_encode_buffer* buffer) {
+    if (buffer->size > GUAC_ENCODE_SCRATCH_MAX_RETAINED)
+        guac_encode_buffer_free(buffer);
+}
+
+void guac_encode_buffer_free(guac_encode_buffer* buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->size = 0;
+}
+
+void* guac_encode_arena_alloc(guac_encode_arena* arena, size_t size) {
+
+    size = guac_encode_arena_align(size);
+    arena->requested += size;
+
+    /* Allocate from main block if possible */
+    if (arena->block != NULL && size <= arena->size - arena->used) {
+        void* allocated = arena->block + arena->used;
+        arena->used += size;
+        return allocated;
+    }
+
+    /* Otherwise, allocate separately until the arena is next reset */
+    guac_encode_arena_overflow* overflow =
+        malloc(sizeof(guac_encode_arena_overflow) + size);
+    if (overflow == NULL)
+        return NULL;
+
+    overflow->next = arena->overflow;
+    arena->overflow = overflow;
+
+    return overflow->data;
+
+}
+
+/**
+ * Frees all allocations made outside the main block of the given arena since
+ * the arena was last reset.
+ *
+ * @param arena
+ *     The arena whose overflow allocations should be freed.
+ *
+ * @return
+ *     Non-zero if any overflow allocations were freed, zero otherwise.
+ */
+static int guac_encode_arena_free_overflow(guac_encode_arena* arena) {
+
+    guac_encode_arena_overflow* overflow = arena->overflow;
+    if (overflow == NULL)
+        return 0;
+
+    do {
+        guac_encode_arena_overflow* next = overflow->next;
+        free(overflow);
+        overflow = next;
+    } while (overflow != NULL);
+
+    arena->overflow = NULL;
+    return 1;
+
+}
+
+void guac_encode_arena_reset(guac_encode_arena* arena) {
+
+    /* Enlarge main block to fit everything allocated since last reset if
+     * anything did not fit, retaining no more than the maximum */
+    if (guac_encode_arena_free_overflow(arena)) {
+
+        size_t size = arena->requested;
+        if (size > GUAC_ENCODE_SCRATCH_MAX_RETAINED)
+            size = GUAC_ENCODE_SCRATCH_MAX_RETAINED;
+
+        if (size > arena->size) {
+            free(arena->block);
+            arena->block = malloc(size);
+            arena->size = arena->block != NULL ? size : 0;
+        }
+
+    }
+
+    arena->used = 0;
+    arena->requested = 0;
+
+}
+
+void guac_encode_arena_free(guac_encode_arena* arena) {
+
+    guac_encode_arena_free_overflow(arena);
+
+    free(arena->block);
+    arena->block = NULL;
+    arena->size = 0;
+    arena->used = 0;
+    arena->requested = 0;
+
+}
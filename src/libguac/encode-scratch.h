@@ -0,0 +1,219 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_ENCODE_SCRATCH_H
+#define GUAC_ENCODE_SCRATCH_H
+
+/**
+ * Reusable scratch memory for image encoders. Each encoder keeps its scratch
+ * memory within thread-local state, such that memory allocated while
+ * encoding one image is reused while encoding the next, and encoding images
+ * of similar size repeatedly requires no further allocation.
+ *
+ * @file encode-scratch.h
+ */
+
+#include "config.h"
+
+#include <stddef.h>
+
+/**
+ * The alignment of every allocation made from a guac_encode_arena, in bytes.
+ */
+#define GUAC_ENCODE_ARENA_ALIGNMENT 16
+
+/**
+ * The largest amount of memory, in bytes, that a buffer or the main block of
+ * an arena retains between images. This is enough for a full 1920x1080 frame
+ * at four bytes per pixel. Larger images are still encoded, but their scratch
+ * memory is released afterward rather than held by the encoding thread for
+ * the life of the process.
+ */
+#define GUAC_ENCODE_SCRATCH_MAX_RETAINED 8388608
+
+/**
+ * A buffer which grows as needed, reused for temporary data of varying size.
+ * Buffers are shrunk only by guac_encode_buffer_trim().
+ */
+typedef struct guac_encode_buffer {
+
+    /**
+     * The contents of the buffer, or NULL if no memory has yet been
+     * allocated.
+     */
+    void* data;
+
+    /**
+     * The number of bytes allocated for the buffer.
+     */
+    size_t size;
+
+} guac_encode_buffer;
+
+/**
+ * A union of the standard types having the strictest alignment requirements.
+ * Memory aligned for this union is suitably aligned for any of these types.
+ * This serves the purpose of C11's max_align_t, which is not available when
+ * building as C99.
+ */
+typedef union guac_encode_max_align {
+    long double long_double_value;
+    long long long_long_value;
+    double double_value;
+    void* pointer_value;
+    void (*function_value)(void);
+} guac_encode_max_align;
+
+/**
+ * A single allocation made by a guac_encode_arena outside its main block,
+ * because that block was too small. Overflow allocations are freed when the
+ * arena is reset, at which point the main block is enlarged to avoid further
+ * overflow.
+ */
+typedef struct guac_encode_arena_overflow {
+
+    /**
+     * The next overflow allocation, or NULL if this is the last.
+     */
+    struct guac_encode_arena_overflow* next;
+
+    /**
+     * The allocated memory. As this is an array of guac_encode_max_align,
+     * the header is padded such that the allocated memory is suitably
+     * aligned for any type.
+     */
+    guac_encode_max_align data[];
+
+} guac_encode_arena_overflow;
+
+/**
+ * A bump allocator whose allocations are all released at once when the
+ * arena is reset. Individual allocations are never freed. An arena which is
+ * repeatedly used for similar work and then reset reaches a size at which
+ * it never allocates memory again.
+ */
+typedef struct guac_encode_arena {
+
+    /**
+     * The main block of memory from which allocations are made, or NULL if
+     * no block has yet been allocated.
+     */
+    unsigned char* block;
+
+    /**
+     * The size of the main block, in bytes.
+     */
+    size_t size;
+
+    /**
+     * The number of bytes of the main block which have been allocated since
+     * the arena was last reset.
+     */
+    size_t used;
+
+    /**
+     * All allocations which did not fit within the main block since the
+     * arena was last reset, or NULL if there are none.
+     */
+    guac_encode_arena_overflow* overflow;
+
+    /**
+     * The total number of bytes requested since the arena was last reset,
+     * including overflow allocations.
+     */
+    size_t requested;
+
+} guac_encode_arena;
+
+/**
+ * Returns a pointer to at least the given number of bytes of the given
+ * buffer, enlarging the buffer if necessary. The contents of the buffer are
+ * not preserved when the buffer is enlarged.
+ *
+ * @param buffer
+ *     The buffer to reserve space within.
+ *
+ * @param size
+ *     The number of bytes required.
+ *
+ * @return
+ *     A pointer to the contents of the buffer, or NULL if the buffer could
+ *     not be enlarged.
+ */
+void* guac_encode_buffer_reserve(guac_encode_buffer* buffer, size_t size);
+
+/**
+ * Frees the contents of the given buffer if it has grown larger than
+ * GUAC_ENCODE_SCRATCH_MAX_RETAINED, such that memory reserved for an unusually
+ * large image is not retained indefinitely. This should be invoked once the
+ * contents of the buffer are no longer needed.
+ *
+ * @param buffer
+ *     The buffer to trim.
+ */
+void guac_encode_buffer_trim(guac_encode_buffer* buffer);
+
+/**
+ * Frees all memory associated with the given buffer. The buffer may be
+ * reused afterward.
+ *
+ * @param buffer
+ *     The buffer to free.
+ */
+void guac_encode_buffer_free(guac_encode_buffer* buffer);
+
+/**
+ * Allocates the given number of bytes from the given arena. The returned
+ * memory is aligned to GUAC_ENCODE_ARENA_ALIGNMENT bytes (or to the
+ * alignment of guac_encode_max_align, if less strict) and remains valid
+ * until the arena is reset.
+ *
+ * @param arena
+ *     The arena to allocate from.
+ *
+ * @param size
+ *     The number of bytes to allocate.
+ *
+ * @return
+ *     A pointer to the allocated memory, or NULL if the memory could not be
+ *     allocated.
+ */
+void* guac_encode_arena_alloc(guac_encode_arena* arena, size_t size);
+
+/**
+ * Releases all allocations made from the given arena. If any allocations
+ * did not fit within the main block of the arena, the main block is
+ * enlarged such that the same allocations will fit in future, up to a
+ * maximum of GUAC_ENCODE_SCRATCH_MAX_RETAINED bytes.
+ *
+ * @param arena
+ *     The arena to reset.
+ */
+void guac_encode_arena_reset(guac_encode_arena* arena);
+
+/**
+ * Frees all memory associated with the given arena. The arena may be reused
+ * afterward.
+ *
+ * @param arena
+ *     The arena to free.
+ */
+void guac_encode_arena_free(guac_encode_arena* arena);
+
+#endif
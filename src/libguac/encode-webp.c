@@ -23,6 +23,7 @@
 #include "guacamole/error.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
+#include "encode-scratch.h"
 #include "palette.h"
 
 #include <cairo/cairo.h>
@@ -30,6 +31,7 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -143,6 +145,20 @@ static int guac_webp_stream_write(const uint8_t* data, size_t data_size,
             remaining = sizeof(writer->buffer);
         }
 
+        /* Send complete blobs directly from the given data while nothing is
+         * buffered, rather than first copying that data into the buffer */
+        if (remaining == sizeof(writer->buffer) && length >= remaining) {
+
+            int direct_length = length - length % remaining;
+            guac_protocol_send_blobs(writer->socket, writer->stream,
+                    current, direct_length);
+
+            current += direct_length;
+            length -= direct_length;
+            continue;
+
+        }
+
         /* Calculate size of next block of data to append */
         int block_size = remaining;
         if (block_size > length)
@@ -162,8 +178,79 @@ static int guac_webp_stream_write(const uint8_t* data, size_t data_size,
     return 1;
 }
 
+/**
+ * The key used to store the guac_encode_buffer which receives the ARGB pixels
+ * of each WebP image written by the current thread. Reusing this buffer
+ * avoids allocating a full-size picture for every image.
+ */
+static pthread_key_t guac_webp_argb_key;
+
+/**
+ * Guard ensuring guac_webp_argb_key is created exactly once.
+ */
+static pthread_once_t guac_webp_argb_key_init = PTHREAD_ONCE_INIT;
+
+/**
+ * Frees the given guac_encode_buffer. This function is invoked automatically
+ * when a thread having an ARGB buffer exits.
+ *
+ * @param data
+ *     The guac_encode_buffer to free.
+ */
+static void guac_webp_argb_free(void* data) {
+    guac_encode_buffer_free((guac_encode_buffer*) data);
+    free(data);
+}
+
+/**
+ * Creates guac_webp_argb_key. This function is invoked only once, via
+ * pthread_once().
+ */
+static void guac_webp_argb_alloc_key() {
+    pthread_key_create(&guac_webp_argb_key, guac_webp_argb_free);
+}
+
+/**
+ * Returns a buffer of at least the given number of ARGB pixels which may be
+ * used by the current thread until its next call to this function.
+ *
+ * @param pixels
+ *     The number of 32-bit ARGB pixels required.
+ *
+ * @return
+ *     A pointer to the reserved pixels, or NULL if memory could not be
+ *     allocated.
+ */
+static uint32_t* guac_webp_argb_reserve(size_t pixels) {
+
+    pthread_once(&guac_webp_argb_key_init, guac_webp_argb_alloc_key);
+
+    guac_encode_buffer* buffer = pthread_getspecific(guac_webp_argb_key);
+    if (buffer == NULL) {
+        buffer = calloc(1, sizeof(guac_encode_buffer));
+        if (buffer == NULL)
+            return NULL;
+        pthread_setspecific(guac_webp_argb_key, buffer);
+    }
+
+    return guac_encode_buffer_reserve(buffer, pixels * sizeof(uint32_t));
+
+}
+
+/**
+ * Releases the ARGB buffer of the current thread if it has grown beyond
+ * GUAC_ENCODE_SCRATCH_MAX_RETAINED while writing an unusually large image.
+ */
+static void guac_webp_argb_trim() {
+
+    guac_encode_buffer* buffer = pthread_getspecific(guac_webp_argb_key);
+    if (buffer != NULL)
+        guac_encode_buffer_trim(buffer);
+
+}
+
 int guac_webp_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface, int quality, int lossless) {
+        cairo_surface_t* surface, int quality, int lossless, int method) {
 
     guac_webp_stream_writer writer;
     WebPPicture picture;
@@ -195,7 +282,7 @@ int guac_webp_write(guac_socket* socket, guac_stream* stream,
     config.lossless = lossless;
     config.quality = quality;
     config.thread_level = 1; /* Multi threaded */
-    config.method = 2; /* Compression method (0=fast/larger, 6=slow/smaller) */
+    config.method = method; /* Compression method (0=fast/larger, 6=slow/smaller) */
 
     /* Validate configuration */
     WebPValidateConfig(&config);
@@ -206,8 +293,17 @@ int guac_webp_write(guac_socket* socket, guac_stream* stream,
     picture.width = width;
     picture.height = height;
 
-    /* Allocate and init writer */
-    WebPPictureAlloc(&picture);
+    /* Point picture at this thread's reusable ARGB buffer rather than
+     * allocating new picture data for each image */
+    picture.argb = guac_webp_argb_reserve((size_t) width * height);
+    picture.argb_stride = width;
+    if (picture.argb == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Insufficient memory for WebP picture";
+        return -1;
+    }
+
+    /* Init writer */
     picture.writer = guac_webp_stream_write;
     picture.custom_ptr = &writer;
     guac_webp_stream_writer_init(&writer, socket, stream);
@@ -246,8 +342,10 @@ int guac_webp_write(guac_socket* socket, guac_stream* stream,
     /* Encode image */
     WebPEncode(&config, &picture);
 
-    /* Free picture */
+    /* Free any memory allocated by the encoder (the ARGB buffer itself is
+     * not owned by the picture and is retained for the next image) */
     WebPPictureFree(&picture);
+    guac_webp_argb_trim();
 
     /* Ensure all data is written */
     guac_webp_flush_data(&writer);
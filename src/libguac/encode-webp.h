@@ -27,6 +27,13 @@
 
 #include <cairo/cairo.h>
 
+/**
+ * The WebP compression method used when no other method is requested. Lower
+ * methods encode faster at the expense of larger output, while higher methods
+ * produce smaller output at the expense of speed.
+ */
+#define GUAC_WEBP_DEFAULT_METHOD 2
+
 /**
  * Encodes the given surface as a WebP, and sends the resulting data over the
  * given stream and socket as blobs.
@@ -49,10 +56,14 @@
  * @param lossless
  *     Zero for a lossy image, non-zero for lossless.
  *
+ * @param method
+ *     The WebP compression method to use, between 0 (fastest, largest
+ *     output) and 6 (slowest, smallest output) inclusive.
+ *
  * @return
  *     Zero if the encoding operation is successful, non-zero otherwise.
  */
 int guac_webp_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface, int quality, int lossless);
+        cairo_surface_t* surface, int quality, int lossless, int method);
 
 #endif
@@ -83,5 +83,38 @@
  */
 #define GUAC_BUFFER_POOL_INITIAL_SIZE 1024
 
+/**
+ * The default maximum number of bytes of broadcast output that any one user
+ * may fall behind when the broadcast socket is operating in ring mode,
+ * before the lag policy of the client is applied to that user.
+ *
+ * @see guac_client_enable_broadcast_ring()
+ */
+#define GUAC_CLIENT_DEFAULT_BROADCAST_MAX_LAG 8388608
+
+/**
+ * The processing lag, in milliseconds, beyond which a user stops receiving
+ * every frame and instead has frames skipped until it catches up, when the
+ * broadcast socket is operating in ring mode with the GUAC_CLIENT_LAG_RESYNC
+ * lag policy.
+ *
+ * @see GUAC_CLIENT_LAG_RESYNC
+ */
+#define GUAC_CLIENT_FRAME_SKIP_LAG 500
+
+/**
+ * The zlib compression level which requests that PNG images be compressed
+ * using the default level of the PNG encoder. Explicit levels range from 0
+ * (no compression) to 9 (smallest output, slowest).
+ */
+#define GUAC_CLIENT_PNG_DEFAULT_COMPRESSION -1
+
+/**
+ * The interval, in milliseconds, at which a user whose frames are being
+ * skipped is checked for having caught up, regardless of whether new
+ * broadcast output is available.
+ */
+#define GUAC_CLIENT_FRAME_SKIP_POLL_INTERVAL 50
+
 #endif
 
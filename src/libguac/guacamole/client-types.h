@@ -54,6 +54,81 @@ typedef enum guac_client_state {
 
 } guac_client_state;
 
+/**
+ * The action taken for a user whose copy of the broadcast output has fallen
+ * too far behind, when the broadcast socket of a guac_client is operating in
+ * ring mode.
+ *
+ * @see guac_client_enable_broadcast_ring()
+ */
+typedef enum guac_client_lag_policy {
+
+    /**
+     * The lagging user is disconnected with guac_user_stop().
+     */
+    GUAC_CLIENT_LAG_DISCONNECT,
+
+    /**
+     * All broadcast output affecting the remote display which has not yet
+     * been sent to the lagging user is discarded, and the client's
+     * resync_handler is invoked to send that user the current state of the
+     * display, as would be done for a user joining the connection. Other
+     * output, such as that of audio or clipboard streams, is still sent. If
+     * no resync_handler is defined, the lagging user is disconnected instead.
+     *
+     * Users whose processing lag exceeds GUAC_CLIENT_FRAME_SKIP_LAG are
+     * similarly resynchronized, having all frames discarded until they have
+     * caught up, and are excluded from the processing lag reported by
+     * guac_client_get_processing_lag(), such that a single slow user does
+     * not reduce the frame rate of all other users.
+     */
+    GUAC_CLIENT_LAG_RESYNC
+
+} guac_client_lag_policy;
+
+/**
+ * The row filters which may be applied to image data before that data is
+ * compressed within a PNG image. Filtering makes smooth gradients compress
+ * far better, but choosing filters costs time which is largely wasted on
+ * images consisting of few colors, such as rendered text.
+ */
+typedef enum guac_png_filter {
+
+    /**
+     * Let the PNG encoder choose. Palette images are not filtered, while
+     * truecolor images are filtered adaptively.
+     */
+    GUAC_PNG_FILTER_DEFAULT,
+
+    /**
+     * Do not filter rows. This is the fastest option, and is optimal for
+     * images consisting of few colors.
+     */
+    GUAC_PNG_FILTER_NONE,
+
+    /**
+     * Filter each row relative to the pixel to the left.
+     */
+    GUAC_PNG_FILTER_SUB,
+
+    /**
+     * Filter each row relative to the row above.
+     */
+    GUAC_PNG_FILTER_UP,
+
+    /**
+     * Filter each row using the Paeth predictor.
+     */
+    GUAC_PNG_FILTER_PAETH,
+
+    /**
+     * Choose the best filter for each row by trying all filters. This is
+     * the slowest option, and generally produces the smallest images.
+     */
+    GUAC_PNG_FILTER_ADAPTIVE
+
+} guac_png_filter;
+
 /**
  * All supported log levels used by the logging subsystem of each Guacamole
  * client. With the exception of GUAC_LOG_TRACE, these log levels correspond to
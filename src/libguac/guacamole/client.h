@@ -42,6 +42,7 @@
 
 #include <pthread.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 struct guac_client {
 
@@ -257,6 +258,34 @@ struct guac_client {
      */
     void* __plugin_handle;
 
+    /**
+     * Handler for resync events fired when a user has fallen too far behind
+     * the broadcast output of this client and has had that output
+     * discarded, either because the user could not receive the output
+     * quickly enough or because frames were skipped while the user was
+     * lagging. This handler is only used if the broadcast socket is
+     * operating in ring mode with the GUAC_CLIENT_LAG_RESYNC lag policy.
+     *
+     * Example:
+     * @code
+     *     int resync_handler(guac_user* user, guac_timestamp timestamp);
+     *
+     *     int guac_client_init(guac_client* client) {
+     *         client->resync_handler = resync_handler;
+     *     }
+     * @endcode
+     *
+     * @see guac_client_enable_broadcast_ring()
+     */
+    guac_user_resync_handler* resync_handler;
+
+    /**
+     * The broadcast socket originally allocated for this client. This will
+     * be the same as the socket member unless that socket has since been
+     * wrapped (such as for session recording).
+     */
+    guac_socket* __broadcast_socket;
+
 };
 
 /**
@@ -540,6 +569,11 @@ int guac_client_load_plugin(guac_client* client, const char* protocol);
  * pool of users. The processing lag is the difference in time between server
  * and client due purely to data processing and excluding network delays.
  *
+ * If the broadcast socket of the client is operating in ring mode with the
+ * GUAC_CLIENT_LAG_RESYNC lag policy, users whose processing lag exceeds
+ * GUAC_CLIENT_FRAME_SKIP_LAG have frames skipped individually and are not
+ * considered.
+ *
  * @param client
  *     The guac_client to calculate the processing lag of.
  *
@@ -549,6 +583,114 @@ int guac_client_load_plugin(guac_client* client, const char* protocol);
  */
 int guac_client_get_processing_lag(guac_client* client);
 
+/**
+ * Returns whether the broadcast socket of the given guac_client skips frames
+ * for individual users whose processing lag exceeds
+ * GUAC_CLIENT_FRAME_SKIP_LAG. When frames are skipped, such users no longer
+ * hold back the output sent to other users, and need not be considered when
+ * deciding how much data to produce.
+ *
+ * @param client
+ *     The guac_client to check.
+ *
+ * @return
+ *     Non-zero if frames are skipped for lagging users, zero otherwise.
+ */
+int guac_client_skips_frames(guac_client* client);
+
+/**
+ * Switches the broadcast socket of the given guac_client into ring mode.
+ * Rather than writing each instruction to the socket of every connected user
+ * in turn, the broadcast socket then serializes its output only once, into a
+ * chain of shared, reference-counted blocks. A dedicated thread for each
+ * user drains that shared output independently into the user's socket,
+ * such that a single slow user cannot stall the thread writing to the
+ * broadcast socket, nor any other user.
+ *
+ * Users which fall more than the given number of bytes behind are handled
+ * according to the given lag policy. Users which cannot apply the lag policy
+ * because they are blocked while being written to, and which fall several
+ * times that number of bytes behind, are disconnected regardless of policy,
+ * such that the memory used by the shared output remains bounded. Ring mode
+ * cannot be disabled once enabled, and will typically be enabled within
+ * guac_client_init() or, if dependent on connection parameters, within the
+ * join handler of the connection owner before anything is broadcast.
+ *
+ * @param client
+ *     The guac_client whose broadcast socket should operate in ring mode.
+ *
+ * @param max_lag
+ *     The maximum number of bytes of broadcast output that any one user may
+ *     fall behind before the lag policy is applied to that user, such as
+ *     GUAC_CLIENT_DEFAULT_BROADCAST_MAX_LAG.
+ *
+ * @param policy
+ *     The action to take for users that fall too far behind.
+ *
+ * @return
+ *     Zero if ring mode was successfully enabled or is already enabled,
+ *     non-zero if ring mode could not be enabled.
+ */
+int guac_client_enable_broadcast_ring(guac_client* client, size_t max_lag,
+        guac_client_lag_policy policy);
+
+/**
+ * Returns the number of bytes of broadcast output that have been written to
+ * the broadcast socket of the given guac_client but have not yet been
+ * written to the socket of the given user. If the broadcast socket is not
+ * operating in ring mode, all output is written to all users synchronously
+ * and this will always be zero.
+ *
+ * @param client
+ *     The guac_client whose broadcast socket should be queried.
+ *
+ * @param user
+ *     The user whose lag should be determined.
+ *
+ * @return
+ *     The number of bytes of broadcast output not yet written to the given
+ *     user.
+ */
+size_t guac_client_get_broadcast_lag(guac_client* client, guac_user* user);
+
+/**
+ * Discards all broadcast output of the given guac_client which has not yet
+ * been written to the socket of the given user, such that the user next
+ * receives only output broadcast after this call. This function may only be
+ * invoked from within the client's resync handler, and has no effect
+ * otherwise or if the broadcast socket is not operating in ring mode.
+ *
+ * Output broadcast between the point that the user fell behind and the
+ * invocation of the resync handler has already been discarded. A resync
+ * handler should nevertheless invoke this function while holding whatever
+ * locks prevent the state it sends from changing, such that the state sent
+ * corresponds exactly to the point in the broadcast output at which the user
+ * resumes. Otherwise, output broadcast while the handler is collecting that
+ * state may be applied by the user both as part of that state and again
+ * afterward.
+ *
+ * Only instructions which affect the remote display are discarded, as only
+ * the state of the display can be restored by the resync handler. All other
+ * instructions not yet written to the user, such as those of audio,
+ * clipboard or file streams, are written to the given socket instead, such
+ * that those streams are neither corrupted nor left open.
+ *
+ * @param client
+ *     The guac_client whose broadcast output should be discarded.
+ *
+ * @param user
+ *     The user being resynchronized.
+ *
+ * @param socket
+ *     The socket which should receive all discarded instructions which do
+ *     not affect the remote display. This socket is written to while the
+ *     broadcast socket is locked, and should thus not block, typically
+ *     buffering its output in memory until the handler's locks have been
+ *     released.
+ */
+void guac_client_discard_broadcast(guac_client* client, guac_user* user,
+        guac_socket* socket);
+
 /**
  * Sends a request to the owner of the given guac_client for parameters required
  * to continue the connection started by the client. The function returns zero
@@ -625,6 +767,52 @@ void guac_client_stream_png(guac_client* client, guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer, int x, int y,
         cairo_surface_t* surface);
 
+/**
+ * Streams the image data of the given surface over an image stream ("img"
+ * instruction) as PNG-encoded data, exactly as guac_client_stream_png() does,
+ * except that the zlib compression level and row filter used are specified
+ * explicitly. Lower levels and fewer filters encode faster at the expense of
+ * larger images, which is often worthwhile for images consisting of few
+ * colors, such as rendered text. The compression level and filter only apply
+ * to opaque (RGB24) surfaces.
+ *
+ * @param client
+ *     The Guacamole client for which the image stream should be allocated.
+ *
+ * @param socket
+ *     The socket over which instructions associated with the image stream
+ *     should be sent.
+ *
+ * @param mode
+ *     The composite mode to use when rendering the image over the given layer.
+ *
+ * @param layer
+ *     The destination layer.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param surface
+ *     A Cairo surface containing the image data to be streamed.
+ *
+ * @param compression_level
+ *     The zlib compression level to use, from 0 (no compression) to 9
+ *     (smallest output, slowest), or GUAC_CLIENT_PNG_DEFAULT_COMPRESSION to
+ *     use the default level.
+ *
+ * @param filter
+ *     The row filter to apply prior to compression.
+ */
+void guac_client_stream_png_compressed(guac_client* client,
+        guac_socket* socket, guac_composite_mode mode,
+        const guac_layer* layer, int x, int y, cairo_surface_t* surface,
+        int compression_level, guac_png_filter filter);
+
 /**
  * Streams the image data of the given surface over an image stream ("img"
  * instruction) as JPEG-encoded data at the given quality. The image stream
@@ -708,6 +896,53 @@ void guac_client_stream_webp(guac_client* client, guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer, int x, int y,
         cairo_surface_t* surface, int quality, int lossless);
 
+/**
+ * Streams the image data of the given surface over an image stream ("img"
+ * instruction) as WebP-encoded data, exactly as guac_client_stream_webp()
+ * does, except that the WebP compression method is specified explicitly.
+ * Higher methods produce smaller images at the expense of encoding time,
+ * which may be worthwhile when bandwidth rather than CPU is the limiting
+ * factor. If the server does not support WebP, this function has no effect.
+ *
+ * @param client
+ *     The Guacamole client for whom the image stream should be allocated.
+ *
+ * @param socket
+ *     The socket over which instructions associated with the image stream
+ *     should be sent.
+ *
+ * @param mode
+ *     The composite mode to use when rendering the image over the given layer.
+ *
+ * @param layer
+ *     The destination layer.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param surface
+ *     A Cairo surface containing the image data to be streamed.
+ *
+ * @param quality
+ *     The WebP image quality, which must be an integer value between 0 and 100
+ *     inclusive.
+ *
+ * @param lossless
+ *     Zero to encode a lossy image, non-zero to encode losslessly.
+ *
+ * @param method
+ *     The WebP compression method, between 0 (fastest, largest output) and 6
+ *     (slowest, smallest output) inclusive.
+ */
+void guac_client_stream_webp_method(guac_client* client, guac_socket* socket,
+        guac_composite_mode mode, const guac_layer* layer, int x, int y,
+        cairo_surface_t* surface, int quality, int lossless, int method);
+
 /**
  * Returns whether the owner of the given client supports the "msg"
  * instruction, returning non-zero if the client owner does support the
@@ -0,0 +1,128 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _GUAC_OPCODE_H
+#define _GUAC_OPCODE_H
+
+/**
+ * Provides a perfect hash over a fixed set of instruction opcodes, for use by
+ * anything which must dispatch received instructions to handlers based on
+ * their opcodes.
+ *
+ * @file opcode.h
+ */
+
+#include "opcode-types.h"
+
+#include <stddef.h>
+
+struct guac_opcode_index {
+
+    /**
+     * The seed of the hash function used to map opcodes to slots. This seed
+     * is chosen when the index is allocated such that no two opcodes map to
+     * the same slot.
+     */
+    unsigned int seed;
+
+    /**
+     * Bitmask which, when applied to a hash value, produces the index of a
+     * slot. The number of slots is always a power of two, and this mask is
+     * one less than that number.
+     */
+    unsigned int mask;
+
+    /**
+     * The length of the longest opcode within this index, in bytes. Any
+     * opcode longer than this cannot be present and is rejected without
+     * hashing.
+     */
+    size_t max_length;
+
+    /**
+     * The number of opcodes within this index.
+     */
+    int count;
+
+    /**
+     * Array of mask + 1 slots, each containing the position of the opcode
+     * hashing to that slot, or -1 if no opcode hashes to that slot.
+     */
+    int* slots;
+
+    /**
+     * The opcodes within this index, in the order they were provided when
+     * the index was allocated. The strings themselves are not copied and
+     * must remain valid for the lifetime of the index.
+     */
+    const char** opcodes;
+
+};
+
+/**
+ * Allocates a new guac_opcode_index covering the opcodes within an existing
+ * NULL-terminated mapping array, such as an array of structures mapping
+ * opcodes to handlers. The opcode strings are not copied, and must remain
+ * valid until the index is freed with guac_opcode_index_free().
+ *
+ * @param opcodes
+ *     A pointer to the opcode (a char* or const char*) of the first entry of
+ *     the mapping array. The end of the array must be marked with an entry
+ *     whose opcode is NULL.
+ *
+ * @param stride
+ *     The distance between each entry of the mapping array, in bytes. This
+ *     will typically be the size of the structure used for each entry, or
+ *     sizeof(char*) if the array is simply an array of opcode strings.
+ *
+ * @return
+ *     A newly-allocated guac_opcode_index, or NULL if the index could not be
+ *     allocated.
+ */
+guac_opcode_index* guac_opcode_index_alloc(const void* opcodes, size_t stride);
+
+/**
+ * Frees the given guac_opcode_index. The opcode strings referenced by the
+ * index are not freed.
+ *
+ * @param index
+ *     The guac_opcode_index to free.
+ */
+void guac_opcode_index_free(guac_opcode_index* index);
+
+/**
+ * Returns the position of the given opcode within the mapping array used to
+ * allocate the given guac_opcode_index. At most one string comparison is
+ * performed, regardless of the number of opcodes within the index.
+ *
+ * @param index
+ *     The guac_opcode_index to search.
+ *
+ * @param opcode
+ *     The opcode to search for.
+ *
+ * @return
+ *     The position of the given opcode within the original mapping array, or
+ *     -1 if the opcode is not present.
+ */
+int guac_opcode_index_find(const guac_opcode_index* index,
+        const char* opcode);
+
+#endif
+
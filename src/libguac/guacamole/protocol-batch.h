@@ -0,0 +1,260 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_PROTOCOL_BATCH_H
+#define GUAC_PROTOCOL_BATCH_H
+
+/**
+ * Provides functions for serializing bursts of Guacamole drawing instructions
+ * into a single buffer, such that the entire burst is written to a
+ * guac_socket with one write, rather than with many small writes per
+ * instruction.
+ *
+ * @file protocol-batch.h
+ */
+
+#include "layer-types.h"
+#include "protocol-constants.h"
+#include "protocol-types.h"
+#include "socket-types.h"
+
+#include <stddef.h>
+
+struct guac_protocol_batch {
+
+    /**
+     * The guac_socket that the batched instructions will be written to.
+     */
+    guac_socket* socket;
+
+    /**
+     * The caller-provided buffer into which instructions are serialized.
+     */
+    char* buffer;
+
+    /**
+     * The size of the buffer, in bytes.
+     */
+    size_t size;
+
+    /**
+     * The number of bytes of serialized instructions currently within the
+     * buffer.
+     */
+    size_t length;
+
+};
+
+/**
+ * Initializes the given guac_protocol_batch, such that instructions appended
+ * to the batch are serialized into the given buffer and eventually written
+ * to the given guac_socket. The buffer remains owned by the caller, and will
+ * typically be allocated on the stack. Instructions are written to the
+ * socket only when guac_protocol_batch_flush() is called, or when the buffer
+ * cannot hold the next instruction appended.
+ *
+ * @param batch
+ *     The guac_protocol_batch to initialize.
+ *
+ * @param socket
+ *     The guac_socket that batched instructions should be written to.
+ *
+ * @param buffer
+ *     The buffer into which instructions should be serialized. Any
+ *     instruction too large for this buffer even while the batch is empty is
+ *     written directly. A buffer of at least
+ *     GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH bytes can hold any
+ *     instruction.
+ *
+ * @param size
+ *     The size of the buffer, in bytes.
+ */
+void guac_protocol_batch_init(guac_protocol_batch* batch, guac_socket* socket,
+        char* buffer, size_t size);
+
+/**
+ * Writes all instructions currently within the given batch to its socket
+ * using a single write, within a single instruction block (as delimited by
+ * guac_socket_instruction_begin() and guac_socket_instruction_end()). The
+ * batch is empty after this function returns, and may be reused.
+ *
+ * @param batch
+ *     The guac_protocol_batch to flush.
+ *
+ * @return
+ *     Zero on success, non-zero on error.
+ */
+int guac_protocol_batch_flush(guac_protocol_batch* batch);
+
+/**
+ * Appends a cfill instruction to the given batch.
+ *
+ * @see guac_protocol_send_cfill()
+ *
+ * @param batch
+ *     The guac_protocol_batch to append the instruction to.
+ *
+ * @param mode
+ *     The composite mode to use.
+ *
+ * @param layer
+ *     The destination layer.
+ *
+ * @param r
+ *     The red component of the color of the rectangle.
+ *
+ * @param g
+ *     The green component of the color of the rectangle.
+ *
+ * @param b
+ *     The blue component of the color of the rectangle.
+ *
+ * @param a
+ *     The alpha (transparency) component of the color of the rectangle.
+ *
+ * @return
+ *     Zero on success, non-zero on error. Errors can only occur if the batch
+ *     must be flushed to make room for the instruction.
+ */
+int guac_protocol_batch_cfill(guac_protocol_batch* batch,
+        guac_composite_mode mode, const guac_layer* layer,
+        int r, int g, int b, int a);
+
+/**
+ * Appends a copy instruction to the given batch.
+ *
+ * @see guac_protocol_send_copy()
+ *
+ * @param batch
+ *     The guac_protocol_batch to append the instruction to.
+ *
+ * @param srcl
+ *     The source layer.
+ *
+ * @param srcx
+ *     The X coordinate of the source rectangle.
+ *
+ * @param srcy
+ *     The Y coordinate of the source rectangle.
+ *
+ * @param w
+ *     The width of the source rectangle.
+ *
+ * @param h
+ *     The height of the source rectangle.
+ *
+ * @param mode
+ *     The composite mode to use.
+ *
+ * @param dstl
+ *     The destination layer.
+ *
+ * @param dstx
+ *     The X coordinate of the destination, where the source rectangle should
+ *     be copied.
+ *
+ * @param dsty
+ *     The Y coordinate of the destination, where the source rectangle should
+ *     be copied.
+ *
+ * @return
+ *     Zero on success, non-zero on error. Errors can only occur if the batch
+ *     must be flushed to make room for the instruction.
+ */
+int guac_protocol_batch_copy(guac_protocol_batch* batch,
+        const guac_layer* srcl, int srcx, int srcy, int w, int h,
+        guac_composite_mode mode, const guac_layer* dstl, int dstx, int dsty);
+
+/**
+ * Appends a rect instruction to the given batch.
+ *
+ * @see guac_protocol_send_rect()
+ *
+ * @param batch
+ *     The guac_protocol_batch to append the instruction to.
+ *
+ * @param layer
+ *     The destination layer.
+ *
+ * @param x
+ *     The X coordinate of the rectangle.
+ *
+ * @param y
+ *     The Y coordinate of the rectangle.
+ *
+ * @param width
+ *     The width of the rectangle.
+ *
+ * @param height
+ *     The height of the rectangle.
+ *
+ * @return
+ *     Zero on success, non-zero on error. Errors can only occur if the batch
+ *     must be flushed to make room for the instruction.
+ */
+int guac_protocol_batch_rect(guac_protocol_batch* batch,
+        const guac_layer* layer, int x, int y, int width, int height);
+
+/**
+ * Appends a transfer instruction to the given batch.
+ *
+ * @see guac_protocol_send_transfer()
+ *
+ * @param batch
+ *     The guac_protocol_batch to append the instruction to.
+ *
+ * @param srcl
+ *     The source layer.
+ *
+ * @param srcx
+ *     The X coordinate of the source rectangle.
+ *
+ * @param srcy
+ *     The Y coordinate of the source rectangle.
+ *
+ * @param w
+ *     The width of the source rectangle.
+ *
+ * @param h
+ *     The height of the source rectangle.
+ *
+ * @param fn
+ *     The transfer function to use.
+ *
+ * @param dstl
+ *     The destination layer.
+ *
+ * @param dstx
+ *     The X coordinate of the destination, where the source rectangle should
+ *     be transferred.
+ *
+ * @param dsty
+ *     The Y coordinate of the destination, where the source rectangle should
+ *     be transferred.
+ *
+ * @return
+ *     Zero on success, non-zero on error. Errors can only occur if the batch
+ *     must be flushed to make room for the instruction.
+ */
+int guac_protocol_batch_transfer(guac_protocol_batch* batch,
+        const guac_layer* srcl, int srcx, int srcy, int w, int h,
+        guac_transfer_function fn, const guac_layer* dstl, int dstx, int dsty);
+
+#endif
+
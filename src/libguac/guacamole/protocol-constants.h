@@ -49,6 +49,22 @@
  */
 #define GUAC_PROTOCOL_BLOB_MAX_LENGTH 6048
 
+/**
+ * The maximum number of bytes required to serialize any single instruction
+ * appended to a guac_protocol_batch.
+ *
+ * @see guac_protocol_batch
+ */
+#define GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH 256
+
+/**
+ * A reasonable default size for the buffer backing a guac_protocol_batch,
+ * in bytes, sufficient for a burst of several dozen drawing instructions.
+ *
+ * @see guac_protocol_batch_init()
+ */
+#define GUAC_PROTOCOL_BATCH_DEFAULT_SIZE 4096
+
 /**
  * The name of the layer parameter defining the number of simultaneous points
  * of contact supported by a layer. This parameter should be set to a non-zero
@@ -341,5 +341,11 @@ typedef enum guac_message_type {
 
 } guac_message_type;
 
+/**
+ * A batch of Guacamole instructions serialized into a caller-provided buffer,
+ * to be written to a guac_socket all at once.
+ */
+typedef struct guac_protocol_batch guac_protocol_batch;
+
 #endif
 
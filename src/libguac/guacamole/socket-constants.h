@@ -31,6 +31,13 @@
  */
 #define GUAC_SOCKET_OUTPUT_BUFFER_SIZE 8192
 
+/**
+ * The maximum number of bytes of binary data to base64-encode at once when
+ * writing base64 data to a socket which does not provide its own
+ * write_base64_handler. This value must be a multiple of three.
+ */
+#define GUAC_SOCKET_BASE64_CHUNK_SIZE 3072
+
 /**
  * The number of milliseconds to wait between keep-alive pings on a socket
  * with keep-alive enabled.
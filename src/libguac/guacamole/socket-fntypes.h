@@ -56,6 +56,54 @@ typedef ssize_t guac_socket_read_handler(guac_socket* socket,
 typedef ssize_t guac_socket_write_handler(guac_socket* socket,
         const void* buf, size_t count);
 
+/**
+ * Handler for writes of binary data which must be base64-encoded. When set
+ * within a guac_socket, a handler of this type will be called by
+ * guac_socket_write_base64() for the bulk of the data provided, allowing the
+ * implementation to encode that data directly into its own internal buffer.
+ * The number of bytes provided to this handler will always be a multiple of
+ * three, and thus the encoded data will never require padding.
+ *
+ * @param socket
+ *     The guac_socket being written to.
+ *
+ * @param buf
+ *     The arbitrary buffer containing the binary data to be encoded and
+ *     written.
+ *
+ * @param count
+ *     The number of bytes within the buffer. This will always be a multiple
+ *     of three.
+ *
+ * @return
+ *     The number of bytes of binary data written, or -1 if an error occurs.
+ */
+typedef ssize_t guac_socket_write_base64_handler(guac_socket* socket,
+        const void* buf, size_t count);
+
+/**
+ * Handler for writes of several separate buffers as a single contiguous
+ * block of data, modeled after the standard POSIX writev() function. When set
+ * within a guac_socket, a handler of this type will be called when
+ * guac_socket_write_vector() is invoked, allowing the implementation to write
+ * those buffers without first copying them into its own internal buffer.
+ *
+ * @param socket
+ *     The guac_socket being written to.
+ *
+ * @param vector
+ *     The array of buffers to write, in order.
+ *
+ * @param count
+ *     The number of buffers within the array.
+ *
+ * @return
+ *     The total number of bytes written, which will be the sum of the lengths
+ *     of all buffers, or -1 if an error occurs.
+ */
+typedef ssize_t guac_socket_write_vector_handler(guac_socket* socket,
+        const guac_socket_vector* vector, int count);
+
 /**
  * Generic handler for socket select operations, similar to the POSIX select()
  * function. When guac_socket_select() is called on a guac_socket, its
@@ -69,6 +117,22 @@ typedef ssize_t guac_socket_write_handler(guac_socket* socket,
  */
 typedef int guac_socket_select_handler(guac_socket* socket, int usec_timeout);
 
+/**
+ * Handler which reports how much data previously written to a socket has not
+ * yet been delivered, including data still buffered within the socket itself
+ * and data which has been handed to the underlying transport but not yet
+ * acknowledged by the remote end. When set within a guac_socket, a handler of
+ * this type will be called when guac_socket_get_queued() is called.
+ *
+ * @param socket
+ *     The guac_socket being queried.
+ *
+ * @return
+ *     The number of bytes written to the socket which have not yet been
+ *     delivered, or -1 if this cannot be determined.
+ */
+typedef int guac_socket_queued_handler(guac_socket* socket);
+
 /**
  * Generic flush handler for socket flush operations. This function is not
  * modeled after any POSIX function. When set within a guac_socket, a handler
@@ -112,5 +176,21 @@ typedef void guac_socket_unlock_handler(guac_socket* socket);
  */
 typedef int guac_socket_free_handler(guac_socket* socket);
 
+/**
+ * Handler which shuts down the connection underlying a socket, modeled after
+ * the standard POSIX shutdown() function. Any read or write which is blocked
+ * on that connection, or which is attempted afterward, must fail rather than
+ * block. When set within a guac_socket, a handler of this type will be called
+ * when guac_socket_shutdown() is called.
+ *
+ * @param socket
+ *     The guac_socket whose connection should be shut down.
+ *
+ * @return
+ *     Zero on success, or non-zero if the connection could not be shut
+ *     down.
+ */
+typedef int guac_socket_shutdown_handler(guac_socket* socket);
+
 #endif
 
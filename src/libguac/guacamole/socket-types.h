@@ -20,6 +20,8 @@
 #ifndef _GUAC_SOCKET_TYPES_H
 #define _GUAC_SOCKET_TYPES_H
 
+#include <stddef.h>
+
 /**
  * Type definitions related to the guac_socket object.
  *
@@ -49,5 +51,24 @@ typedef enum guac_socket_state {
 
 } guac_socket_state;
 
+/**
+ * A single element of a vector of buffers which should be written to a
+ * guac_socket as one contiguous block of data, analogous to the POSIX iovec
+ * structure used by writev().
+ */
+typedef struct guac_socket_vector {
+
+    /**
+     * The buffer containing the data to be written.
+     */
+    const void* buffer;
+
+    /**
+     * The number of bytes within the buffer.
+     */
+    size_t length;
+
+} guac_socket_vector;
+
 #endif
 
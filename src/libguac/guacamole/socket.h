@@ -53,6 +53,20 @@ struct guac_socket {
      */
     guac_socket_write_handler* write_handler;
 
+    /**
+     * Handler which will be called whenever complete triplets of binary data
+     * are written to this socket with guac_socket_write_base64(). If NULL,
+     * the encoded data will instead be written using the write_handler.
+     */
+    guac_socket_write_base64_handler* write_base64_handler;
+
+    /**
+     * Handler which will be called whenever a vector of buffers is written to
+     * this socket with guac_socket_write_vector(). If NULL, each buffer will
+     * instead be written in order using the write_handler.
+     */
+    guac_socket_write_vector_handler* write_vector_handler;
+
     /**
      * Handler which will be called whenever this socket needs to be flushed.
      */
@@ -81,6 +95,19 @@ struct guac_socket {
      */
     guac_socket_free_handler* free_handler;
 
+    /**
+     * Handler which will be called whenever guac_socket_get_queued() is
+     * invoked on this socket. If NULL, the amount of undelivered data is
+     * considered unknown.
+     */
+    guac_socket_queued_handler* queued_handler;
+
+    /**
+     * Handler which will be called whenever guac_socket_shutdown() is invoked
+     * on this socket. If NULL, the socket cannot be shut down.
+     */
+    guac_socket_shutdown_handler* shutdown_handler;
+
     /**
      * The current state of this guac_socket.
      */
@@ -92,6 +119,15 @@ struct guac_socket {
      */
     guac_timestamp last_write_timestamp;
 
+    /**
+     * The total number of bytes which have been handed to the underlying
+     * transport of this guac_socket, as maintained by the socket
+     * implementation. This value must be read with
+     * guac_socket_get_bytes_written(), and will remain zero for
+     * implementations which do not track it.
+     */
+    uint64_t __bytes_written;
+
     /**
      * The number of bytes present in the base64 "ready" buffer.
      */
@@ -172,6 +208,40 @@ void guac_socket_instruction_end(guac_socket* socket);
  */
 guac_socket* guac_socket_open(int fd);
 
+/**
+ * Allocates and initializes a new guac_socket object with the given open
+ * file descriptor, exactly as guac_socket_open() does, but with an output
+ * buffer of the given size which may adapt to the observed write pattern. The
+ * output buffer initially has the given size and will grow, up to the given
+ * maximum, while bursts of written data routinely exceed the buffer, unless
+ * the kernel send queue of the file descriptor is already congested. The
+ * buffer will shrink back toward its original size as bursts subside or if
+ * the send queue becomes congested. The file descriptor will be automatically
+ * closed when the allocated guac_socket is freed.
+ *
+ * If an error occurs while allocating the guac_socket object, NULL is returned,
+ * and guac_error is set appropriately.
+ *
+ * @param fd
+ *     An open file descriptor that this guac_socket object should manage.
+ *
+ * @param buffer_size
+ *     The initial (and minimum) size of the output buffer, in bytes. If zero
+ *     or negative, GUAC_SOCKET_OUTPUT_BUFFER_SIZE is used.
+ *
+ * @param max_buffer_size
+ *     The maximum size that the output buffer may grow to, in bytes. If this
+ *     value is not greater than buffer_size, the size of the output buffer is
+ *     fixed.
+ *
+ * @return
+ *     A newly allocated guac_socket object associated with the given file
+ *     descriptor, or NULL if an error occurs while allocating the guac_socket
+ *     object.
+ */
+guac_socket* guac_socket_open_buffered(int fd, int buffer_size,
+        int max_buffer_size);
+
 /**
  * Allocates and initializes a new guac_socket which writes all data via
  * nest instructions to the given existing, open guac_socket. Freeing the
@@ -314,6 +384,32 @@ ssize_t guac_socket_write_base64(guac_socket* socket, const void* buf, size_t co
  */
 ssize_t guac_socket_write(guac_socket* socket, const void* buf, size_t count);
 
+/**
+ * Writes the given vector of buffers to the specified socket as a single,
+ * contiguous block of data, in the order given. Depending on the socket
+ * implementation, large buffers may be written directly without first being
+ * copied into the internal buffer of the socket, and all buffers may be
+ * written using a single system call. The data written may otherwise be
+ * buffered until the buffer is flushed automatically or manually.
+ *
+ * If an error occurs while writing, a non-zero value is returned, and
+ * guac_error is set appropriately.
+ *
+ * @param socket
+ *     The guac_socket object to write to.
+ *
+ * @param vector
+ *     The array of buffers to write, in order.
+ *
+ * @param count
+ *     The number of buffers within the array.
+ *
+ * @return
+ *     Zero on success, or non-zero if an error occurs while writing.
+ */
+ssize_t guac_socket_write_vector(guac_socket* socket,
+        const guac_socket_vector* vector, int count);
+
 /**
  * Attempts to read data from the socket, filling up to the specified number
  * of bytes in the given buffer.
@@ -369,5 +465,51 @@ ssize_t guac_socket_flush(guac_socket* socket);
  */
 int guac_socket_select(guac_socket* socket, int usec_timeout);
 
+/**
+ * Returns the total number of bytes which have been handed to the underlying
+ * transport of the given guac_socket since it was allocated. Data which is
+ * still buffered within the guac_socket is not included. If the socket
+ * implementation does not track this value, zero is always returned.
+ *
+ * @param socket
+ *     The guac_socket to query.
+ *
+ * @return
+ *     The total number of bytes handed to the underlying transport.
+ */
+uint64_t guac_socket_get_bytes_written(guac_socket* socket);
+
+/**
+ * Returns the number of bytes written to the given guac_socket which have not
+ * yet been delivered to the remote end, including data which is still
+ * buffered within the guac_socket and data which is queued within the
+ * underlying transport. This is a measure of how far the remote end is
+ * behind the data being produced.
+ *
+ * @param socket
+ *     The guac_socket to query.
+ *
+ * @return
+ *     The number of undelivered bytes, or -1 if this cannot be determined
+ *     for the given socket.
+ */
+int guac_socket_get_queued(guac_socket* socket);
+
+/**
+ * Shuts down the connection underlying the given guac_socket, such that any
+ * read or write currently blocked on that connection fails, as do all reads
+ * and writes attempted afterward. This allows a thread blocked writing to an
+ * unresponsive remote end to be stopped. The guac_socket itself must still be
+ * freed with guac_socket_free().
+ *
+ * @param socket
+ *     The guac_socket to shut down.
+ *
+ * @return
+ *     Zero on success, or non-zero if the socket does not support being shut
+ *     down or an error occurs.
+ */
+int guac_socket_shutdown(guac_socket* socket);
+
 #endif
 
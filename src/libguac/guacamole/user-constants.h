@@ -64,5 +64,19 @@
  */
 #define GUAC_USER_STREAM_INDEX_MIMETYPE "application/vnd.glyptodon.guacamole.stream-index+json"
 
+/**
+ * The minimum amount of time over which the throughput of a user's connection
+ * is sampled, in milliseconds. Sync instructions which arrive before this
+ * interval has elapsed contribute to the next sample.
+ */
+#define GUAC_USER_THROUGHPUT_INTERVAL 250
+
+/**
+ * The smallest number of undelivered bytes which may indicate that a user's
+ * connection is saturated. Throughput estimates are only lowered if at least
+ * this much data is waiting to be delivered.
+ */
+#define GUAC_USER_SATURATED_QUEUE 4096
+
 #endif
 
@@ -429,6 +429,43 @@ typedef int guac_user_join_handler(guac_user* user, int argc, char** argv);
  */
 typedef int guac_user_leave_handler(guac_user* user);
 
+/**
+ * Handler for resynchronizing a user whose copy of the broadcast output has
+ * fallen too far behind and has been partly discarded. The handler should
+ * send the current state of the connection to the given user, typically in
+ * the same manner as is done when a user first joins the connection. As the
+ * user is known to have received all output up to and including the frame
+ * ending with the given timestamp, only state which has changed since that
+ * frame need be sent. This handler is only invoked when the broadcast socket
+ * of the guac_client is operating in ring mode with the
+ * GUAC_CLIENT_LAG_RESYNC lag policy.
+ *
+ * To ensure the state sent matches the point at which the user resumes
+ * receiving broadcast output, implementations should invoke
+ * guac_client_discard_broadcast() while holding whatever locks prevent that
+ * state from changing.
+ *
+ * As with leave handlers, implementations of the resync handler MUST NOT
+ * use the client-level broadcast socket, nor invoke
+ * guac_client_foreach_user() or guac_client_for_owner(). Only the socket of
+ * the given user may be written to.
+ *
+ * @param user
+ *     The user that must be resynchronized.
+ *
+ * @param timestamp
+ *     The timestamp of the most recent frame which the user is known to have
+ *     received in its entirety, as sent within a "sync" instruction. Any
+ *     output sent after the "sync" instruction for this frame may not have
+ *     been received by the user.
+ *
+ * @return
+ *     Zero if the user has been successfully resynchronized, non-zero
+ *     otherwise. If non-zero is returned, the user is disconnected.
+ */
+typedef int guac_user_resync_handler(guac_user* user,
+        guac_timestamp timestamp);
+
 /**
  * Handler for Guacamole sync events. A sync event is fired by the
  * guac_client whenever a guac_user responds to a "sync" instruction. Sync
@@ -42,6 +42,7 @@
 
 #include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 
 struct guac_user_info {
 
@@ -183,6 +184,49 @@ struct guac_user {
      */
     int processing_lag;
 
+    /**
+     * The smoothed round-trip time of sync instructions sent to this user, in
+     * milliseconds, measured from the time a frame is sent to the time the
+     * user confirms that frame. This includes network latency, queueing
+     * delay, and the time taken by the user to render the frame. Zero if no
+     * frame has yet been confirmed.
+     *
+     * This and the other sync statistics below are updated by the thread
+     * handling the user's instructions while other threads may be reading
+     * them, and must therefore be read with __atomic_load_n().
+     */
+    int sync_rtt;
+
+    /**
+     * The lowest sync round-trip time observed for this user, in
+     * milliseconds. As this approximates the latency of an idle connection,
+     * the difference between sync_rtt and this value is an estimate of the
+     * delay added by congestion. Zero if no frame has yet been confirmed.
+     * Must be read atomically, as with sync_rtt.
+     */
+    int min_sync_rtt;
+
+    /**
+     * The estimated rate at which data can be delivered to this user, in
+     * bytes per second, as measured over periods of at least
+     * GUAC_USER_THROUGHPUT_INTERVAL milliseconds. Zero if no estimate is
+     * available yet or if the user's socket does not track the amount of
+     * data written. Must be read atomically, as with sync_rtt.
+     */
+    int throughput;
+
+    /**
+     * The number of bytes sent to this user which had not yet been delivered
+     * as of the most recently received sync instruction, or -1 if this is
+     * unknown. Must be read atomically, as with sync_rtt.
+     *
+     * Only data queued by this process can be counted. When the user is
+     * connected through guacd, the user's socket is the local connection to
+     * guacd, and data already relayed by guacd toward the client is not
+     * included. Backlog within the network is reflected by sync_rtt instead.
+     */
+    int queued;
+
     /**
      * Information structure containing properties exposed by the remote
      * user during the initial handshake process.
@@ -194,6 +238,18 @@ struct guac_user {
      */
     guac_pool* __stream_pool;
 
+    /**
+     * The total number of bytes written to this user's socket at the start
+     * of the current throughput sample.
+     */
+    uint64_t __throughput_bytes;
+
+    /**
+     * The time that the current throughput sample began, in milliseconds, or
+     * zero if no sample has yet begun.
+     */
+    guac_timestamp __throughput_timestamp;
+
     /**
      * All available output streams (data going to connected user).
      */
@@ -83,9 +83,11 @@ unsigned int guac_hash_surface(cairo_surface_t* surface) {
             unsigned int color = *row;
             row++;
 
-            /* Compute next hash */
+            /* Compute next hash, multiplying by an odd constant such that
+             * content repeating every 32 pixels does not cancel out */
             hash_value =
-                _guac_rotate(hash_value, 1) ^ color ^ 0x1B872E69;
+                (_guac_rotate(hash_value, 1) ^ color ^ 0x1B872E69)
+                * 0x01000193;
 
         }
 
@@ -0,0 +1,216 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/error.h"
+#include "guacamole/opcode.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The smallest number of slots that any guac_opcode_index will have. This
+ * value must be a power of two.
+ */
+#define GUAC_OPCODE_INDEX_MIN_SLOTS 16
+
+/**
+ * The largest number of slots that any guac_opcode_index will have. If no
+ * collision-free seed can be found even at this size, allocation fails.
+ */
+#define GUAC_OPCODE_INDEX_MAX_SLOTS 65536
+
+/**
+ * The number of seeds which are tried for each table size before the table
+ * size is doubled.
+ */
+#define GUAC_OPCODE_INDEX_SEED_ATTEMPTS 4096
+
+/**
+ * Hashes the given opcode using a seeded variant of 32-bit FNV-1a. Hashing
+ * stops early if the opcode proves to be longer than the given maximum
+ * length.
+ *
+ * @param opcode
+ *     The opcode to hash.
+ *
+ * @param seed
+ *     The seed to incorporate into the hash.
+ *
+ * @param max_length
+ *     The maximum length of any opcode that may be matched.
+ *
+ * @param length
+ *     Pointer to a size_t which will receive the number of bytes hashed. If
+ *     the opcode is longer than max_length, this will be greater than
+ *     max_length, and the returned hash is meaningless.
+ *
+ * @return
+ *     The hash of the given opcode.
+ */
+static unsigned int __guac_opcode_hash(const char* opcode, unsigned int seed,
+        size_t max_length, size_t* length) {
+
+    unsigned int hash = 2166136261u ^ (seed * 2654435761u);
+    const unsigned char* current = (const unsigned char*) opcode;
+
+    while (*current != '\0') {
+
+        if ((size_t) (current - (const unsigned char*) opcode) >= max_length) {
+            *length = max_length + 1;
+            return 0;
+        }
+
+        hash = (hash ^ *(current++)) * 16777619u;
+
+    }
+
+    *length = current - (const unsigned char*) opcode;
+    return hash ^ (hash >> 16);
+
+}
+
+/**
+ * Attempts to assign every opcode within the given index a unique slot using
+ * the given seed, storing the resulting assignments within the index.
+ *
+ * @param index
+ *     The guac_opcode_index whose opcodes should be assigned slots. The
+ *     mask, opcodes, count, max_length, and slots members must already be
+ *     set.
+ *
+ * @param seed
+ *     The seed to attempt.
+ *
+ * @return
+ *     Non-zero if every opcode was assigned a unique slot, zero if any two
+ *     opcodes collided.
+ */
+static int __guac_opcode_index_try_seed(guac_opcode_index* index,
+        unsigned int seed) {
+
+    for (unsigned int i = 0; i <= index->mask; i++)
+        index->slots[i] = -1;
+
+    for (int i = 0; i < index->count; i++) {
+
+        size_t length;
+        unsigned int slot = __guac_opcode_hash(index->opcodes[i], seed,
+                index->max_length, &length) & index->mask;
+
+        /* Duplicate opcodes are tolerated by keeping the first, matching
+         * the behavior of a linear scan */
+        if (index->slots[slot] != -1) {
+            if (strcmp(index->opcodes[index->slots[slot]],
+                        index->opcodes[i]) == 0)
+                continue;
+            return 0;
+        }
+
+        index->slots[slot] = i;
+
+    }
+
+    index->seed = seed;
+    return 1;
+
+}
+
+guac_opcode_index* guac_opcode_index_alloc(const void* opcodes, size_t stride) {
+
+    /* Count opcodes within the mapping array */
+    int count = 0;
+    const char* entry = (const char*) opcodes;
+    while (*((const char* const*) (entry + count * stride)) != NULL)
+        count++;
+
+    guac_opcode_index* index = calloc(1, sizeof(guac_opcode_index));
+    index->count = count;
+    index->opcodes = malloc(sizeof(const char*) * (count > 0 ? count : 1));
+
+    /* Copy references to each opcode, noting the longest */
+    for (int i = 0; i < count; i++) {
+        const char* opcode = *((const char* const*) (entry + i * stride));
+        size_t length = strlen(opcode);
+        if (length > index->max_length)
+            index->max_length = length;
+        index->opcodes[i] = opcode;
+    }
+
+    /* Start with a sparse table (at least four slots per opcode), growing
+     * only if no seed yields a collision-free assignment */
+    unsigned int slots = GUAC_OPCODE_INDEX_MIN_SLOTS;
+    while (slots < (unsigned int) count * 4)
+        slots <<= 1;
+
+    for (; slots <= GUAC_OPCODE_INDEX_MAX_SLOTS; slots <<= 1) {
+
+        index->mask = slots - 1;
+        index->slots = malloc(sizeof(int) * slots);
+
+        for (unsigned int seed = 0; seed < GUAC_OPCODE_INDEX_SEED_ATTEMPTS;
+                seed++) {
+            if (__guac_opcode_index_try_seed(index, seed))
+                return index;
+        }
+
+        free(index->slots);
+
+    }
+
+    guac_error = GUAC_STATUS_INTERNAL_ERROR;
+    guac_error_message = "No collision-free hash could be found for the "
+        "given opcodes";
+
+    free(index->opcodes);
+    free(index);
+    return NULL;
+
+}
+
+void guac_opcode_index_free(guac_opcode_index* index) {
+    free(index->slots);
+    free(index->opcodes);
+    free(index);
+}
+
+int guac_opcode_index_find(const guac_opcode_index* index,
+        const char* opcode) {
+
+    size_t length;
+    unsigned int hash = __guac_opcode_hash(opcode, index->seed,
+            index->max_length, &length);
+
+    /* Opcodes longer than any known opcode cannot match */
+    if (length > index->max_length)
+        return -1;
+
+    int position = index->slots[hash & index->mask];
+    if (position == -1)
+        return -1;
+
+    /* Verify the candidate, as unknown opcodes may share a slot */
+    if (strcmp(index->opcodes[position], opcode) != 0)
+        return -1;
+
+    return position;
+
+}
+
@@ -23,12 +23,95 @@
 
 #include <cairo/cairo.h>
 
+#if defined(__GNUC__) && defined(__SSE2__)
+#define GUAC_PALETTE_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
+/**
+ * Returns the palette index of the given color, adding that color to the
+ * given palette if not already present.
+ *
+ * @param palette
+ *     The palette to search.
+ *
+ * @param color
+ *     The 24-bit RGB color to find.
+ *
+ * @return
+ *     The index of the given color within the palette, or -1 if the color is
+ *     not present and the palette is already full.
+ */
+static int guac_palette_insert(guac_palette* palette, int color) {
+
+    /* Calculate hash code */
+    int hash = ((color & 0xFFF000) >> 12) ^ (color & 0xFFF);
+
+    guac_palette_entry* entry;
+
+    /* Search for open palette entry */
+    for (;;) {
+
+        entry = &(palette->entries[hash]);
+
+        /* If we've found a free space, use it */
+        if (entry->index == 0) {
+
+            png_color* c;
+
+            /* Stop if already at capacity */
+            if (palette->size == 256)
+                return -1;
+
+            /* Store in palette */
+            c = &(palette->colors[palette->size]);
+            c->blue  = (color      ) & 0xFF;
+            c->green = (color >> 8 ) & 0xFF;
+            c->red   = (color >> 16) & 0xFF;
+
+            /* Add color to map */
+            palette->slots[palette->size] = hash;
+            entry->index = ++palette->size;
+            entry->color = color;
+
+            return entry->index - 1;
+
+        }
+
+        /* Otherwise, if already stored here, done */
+        if (entry->color == color)
+            return entry->index - 1;
+
+        /* Otherwise, collision. Move on to another bucket */
+        hash = (hash+1) & 0xFFF;
+
+    }
+
+}
+
+guac_palette* guac_palette_alloc(cairo_surface_t* surface,
+        unsigned char* indexes) {
+
+    /* Allocate palette */
+    guac_palette* palette = (guac_palette*) malloc(sizeof(guac_palette));
+    memset(palette, 0, sizeof(guac_palette));
+
+    if (guac_palette_build(palette, surface, indexes)) {
+        guac_palette_free(palette);
+        return NULL;
+    }
+
+    return palette;
+
+}
+
+int guac_palette_build(guac_palette* palette, cairo_surface_t* surface,
+        unsigned char* indexes) {
 
     int x, y;
 
@@ -37,67 +120,75 @@ guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
     int stride = cairo_image_surface_get_stride(surface);
     unsigned char* data = cairo_image_surface_get_data(surface);
 
-    /* Allocate palette */
-    guac_palette* palette = (guac_palette*) malloc(sizeof(guac_palette));
-    memset(palette, 0, sizeof(guac_palette));
+    /* Colors are masked to 24 bits, thus this never matches */
+    int last_color = -1;
+    int last_index = 0;
+
+#ifdef GUAC_PALETTE_SSE2
+    const __m128i rgb_mask = _mm_set1_epi32(0xFFFFFF);
+#endif
 
     for (y=0; y<height; y++) {
-        for (x=0; x<width; x++) {
 
-            /* Get pixel color */
-            int color = ((uint32_t*) data)[x] & 0xFFFFFF;
+        const uint32_t* row = (const uint32_t*) data;
 
-            /* Calculate hash code */
-            int hash = ((color & 0xFFF000) >> 12) ^ (color & 0xFFF);
+        x = 0;
+        while (x < width) {
 
-            guac_palette_entry* entry;
+            /* Get pixel color */
+            int color = row[x] & 0xFFFFFF;
 
-            /* Search for open palette entry */
-            for (;;) {
-                
-                entry = &(palette->entries[hash]);
+            /* Look up index only when color changes */
+            if (color != last_color) {
 
-                /* If we've found a free space, use it */
-                if (entry->index == 0) {
+                last_index = guac_palette_insert(palette, color);
 
-                    png_color* c;
+                /* Abort as soon as too many colors are found */
+                if (last_index < 0)
+                    return -1;
 
-                    /* Stop if already at capacity */
-                    if (palette->size == 256) {
-                        guac_palette_free(palette);
-                        return NULL;
-                    }
+                last_color = color;
 
-                    /* Store in palette */
-                    c = &(palette->colors[palette->size]);
-                    c->blue  = (color      ) & 0xFF;
-                    c->green = (color >> 8 ) & 0xFF;
-                    c->red   = (color >> 16) & 0xFF;
+            }
 
-                    /* Add color to map */
-                    entry->index = ++palette->size;
-                    entry->color = color;
+            indexes[x++] = last_index;
 
-                    break;
+#ifdef GUAC_PALETTE_SSE2
+            /* Skip past any run of the same color four pixels at a time */
+            __m128i target = _mm_set1_epi32(color);
+            while (x + 4 <= width) {
 
-                }
+                __m128i pixels = _mm_and_si128(rgb_mask,
+                        _mm_loadu_si128((const __m128i*) (row + x)));
 
-                /* Otherwise, if already stored here, done */
-                if (entry->color == color)
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(pixels, target))
+                        != 0xFFFF)
                     break;
 
-                /* Otherwise, collision. Move on to another bucket */
-                hash = (hash+1) & 0xFFF;
+                memset(indexes + x, last_index, 4);
+                x += 4;
 
             }
+#endif
+
         }
 
         /* Advance to next data row */
         data += stride;
+        indexes += width;
 
     }
 
-    return palette;
+    return 0;
+
+}
+
+void guac_palette_reset(guac_palette* palette) {
+
+    for (int i = 0; i < palette->size; i++)
+        palette->entries[palette->slots[i]].index = 0;
+
+    palette->size = 0;
 
 }
 
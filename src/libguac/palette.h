@@ -37,9 +37,73 @@ typedef struct guac_palette {
     png_color colors[256];
     int size;
 
+    /**
+     * The position within entries of the entry for each color within
+     * colors, such that a palette can be emptied by clearing only the
+     * entries in use.
+     */
+    int slots[256];
+
 } guac_palette;
 
-guac_palette* guac_palette_alloc(cairo_surface_t* surface);
+/**
+ * Builds the palette of the given RGB24 surface in a single pass, storing the
+ * palette index of each pixel within the given buffer as each color is
+ * discovered. Building the palette stops as soon as the surface is found to
+ * contain more than 256 distinct colors.
+ *
+ * @param surface
+ *     The RGB24 surface whose palette should be built.
+ *
+ * @param indexes
+ *     A buffer of at least width * height bytes which will receive the
+ *     palette index of each pixel of the surface, in row-major order with no
+ *     padding between rows. If the surface contains too many colors, the
+ *     contents of this buffer are undefined.
+ *
+ * @return
+ *     A newly-allocated palette containing every color within the surface,
+ *     or NULL if the surface contains more than 256 distinct colors.
+ */
+guac_palette* guac_palette_alloc(cairo_surface_t* surface,
+        unsigned char* indexes);
+
+/**
+ * Builds the palette of the given RGB24 surface within the given empty
+ * palette, exactly as guac_palette_alloc() does, but without allocating a
+ * new palette. This allows the same palette to be reused for many surfaces,
+ * emptying it with guac_palette_reset() between uses.
+ *
+ * @param palette
+ *     The palette to populate, which must be empty, either having been
+ *     zeroed or reset with guac_palette_reset().
+ *
+ * @param surface
+ *     The RGB24 surface whose palette should be built.
+ *
+ * @param indexes
+ *     A buffer of at least width * height bytes which will receive the
+ *     palette index of each pixel of the surface, as described for
+ *     guac_palette_alloc().
+ *
+ * @return
+ *     Zero if the palette was built successfully, or non-zero if the surface
+ *     contains more than 256 distinct colors. The palette must be reset
+ *     before reuse in either case.
+ */
+int guac_palette_build(guac_palette* palette, cairo_surface_t* surface,
+        unsigned char* indexes);
+
+/**
+ * Empties the given palette, clearing only those entries which are in use.
+ * This is considerably faster than zeroing the entire palette when few
+ * colors are present.
+ *
+ * @param palette
+ *     The palette to empty.
+ */
+void guac_palette_reset(guac_palette* palette);
+
 int guac_palette_find(guac_palette* palette, int color);
 void guac_palette_free(guac_palette* palette);
 
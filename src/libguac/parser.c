@@ -24,10 +24,25 @@
 #include "guacamole/socket.h"
 #include "guacamole/unicode.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#if defined(__GNUC__) && defined(__SSE2__)
+#define GUAC_PARSER_SSE2 1
+#include <emmintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define GUAC_PARSER_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * The number of bytes of element content examined at once by
+ * guac_parser_skip_content().
+ */
+#define GUAC_PARSER_BLOCK_SIZE 16
+
 static void guac_parser_reset(guac_parser* parser) {
     parser->opcode = NULL;
     parser->argc = 0;
@@ -36,6 +51,264 @@ static void guac_parser_reset(guac_parser* parser) {
     parser->__element_length = 0;
 }
 
+#if defined(GUAC_PARSER_SSE2) || defined(GUAC_PARSER_NEON)
+
+/**
+ * Bitmasks describing the UTF-8 structure of a single block of
+ * GUAC_PARSER_BLOCK_SIZE bytes. Each mask contains one group of bits per
+ * byte, with the group for the first byte of the block in the least
+ * significant position. Each group is BITS_PER_BYTE bits wide.
+ */
+typedef struct guac_parser_block_masks {
+
+    /**
+     * Set for each byte having its high bit set (any non-ASCII byte).
+     */
+    uint64_t high;
+
+    /**
+     * Set for each UTF-8 continuation byte (10xxxxxx).
+     */
+    uint64_t cont;
+
+    /**
+     * Set for each lead byte of a UTF-8 character at least two bytes long.
+     */
+    uint64_t lead2;
+
+    /**
+     * Set for each lead byte of a UTF-8 character at least three bytes long.
+     */
+    uint64_t lead3;
+
+    /**
+     * Set for each lead byte of a UTF-8 character four bytes long.
+     */
+    uint64_t lead4;
+
+} guac_parser_block_masks;
+
+#endif
+
+#ifdef GUAC_PARSER_SSE2
+
+/**
+ * The width of each per-byte group of bits within guac_parser_block_masks.
+ * With SSE2, each byte is represented by a single bit, as produced by
+ * _mm_movemask_epi8().
+ */
+#define BITS_PER_BYTE 1
+
+/**
+ * Mask covering the bits of all bytes within a single block.
+ */
+#define BLOCK_MASK UINT64_C(0xFFFF)
+
+/**
+ * Classifies each byte of the given block, which must contain at least
+ * GUAC_PARSER_BLOCK_SIZE bytes.
+ *
+ * @param block
+ *     The block of element content to classify.
+ *
+ * @param masks
+ *     The guac_parser_block_masks to populate.
+ */
+static void guac_parser_classify_block(const char* block,
+        guac_parser_block_masks* masks) {
+
+    __m128i bytes = _mm_loadu_si128((const __m128i*) block);
+
+    masks->high = (uint16_t) _mm_movemask_epi8(bytes);
+    if (masks->high == 0)
+        return;
+
+    masks->cont = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(
+                _mm_and_si128(bytes, _mm_set1_epi8((char) 0xC0)),
+                _mm_set1_epi8((char) 0x80)));
+
+    masks->lead2 = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(
+                _mm_and_si128(bytes, _mm_set1_epi8((char) 0xE0)),
+                _mm_set1_epi8((char) 0xC0)));
+
+    masks->lead3 = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(
+                _mm_and_si128(bytes, _mm_set1_epi8((char) 0xF0)),
+                _mm_set1_epi8((char) 0xE0)));
+
+    masks->lead4 = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(
+                _mm_and_si128(bytes, _mm_set1_epi8((char) 0xF8)),
+                _mm_set1_epi8((char) 0xF0)));
+
+    /* Characters of three or more bytes also require a second byte, etc. */
+    masks->lead3 |= masks->lead4;
+    masks->lead2 |= masks->lead3;
+
+}
+
+#endif
+
+#ifdef GUAC_PARSER_NEON
+
+/**
+ * The width of each per-byte group of bits within guac_parser_block_masks.
+ * NEON has no equivalent of SSE2's movemask, so each byte is instead
+ * represented by four bits produced by narrowing the comparison result.
+ */
+#define BITS_PER_BYTE 4
+
+/**
+ * Mask covering the bits of all bytes within a single block.
+ */
+#define BLOCK_MASK UINT64_MAX
+
+/**
+ * Reduces the given comparison result, where each byte is either 0x00 or
+ * 0xFF, to a 64-bit mask having four bits per byte.
+ *
+ * @param compared
+ *     The result of a NEON comparison.
+ *
+ * @return
+ *     A 64-bit mask with four bits set for each byte of the comparison
+ *     result which is 0xFF.
+ */
+static uint64_t guac_parser_neon_mask(uint8x16_t compared) {
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(compared), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+/**
+ * Classifies each byte of the given block, which must contain at least
+ * GUAC_PARSER_BLOCK_SIZE bytes.
+ *
+ * @param block
+ *     The block of element content to classify.
+ *
+ * @param masks
+ *     The guac_parser_block_masks to populate.
+ */
+static void guac_parser_classify_block(const char* block,
+        guac_parser_block_masks* masks) {
+
+    uint8x16_t bytes = vld1q_u8((const uint8_t*) block);
+
+    masks->high = guac_parser_neon_mask(vcltq_s8(vreinterpretq_s8_u8(bytes),
+                vdupq_n_s8(0)));
+    if (masks->high == 0)
+        return;
+
+    masks->cont = guac_parser_neon_mask(vceqq_u8(
+                vandq_u8(bytes, vdupq_n_u8(0xC0)), vdupq_n_u8(0x80)));
+
+    masks->lead2 = guac_parser_neon_mask(vceqq_u8(
+                vandq_u8(bytes, vdupq_n_u8(0xE0)), vdupq_n_u8(0xC0)));
+
+    masks->lead3 = guac_parser_neon_mask(vceqq_u8(
+                vandq_u8(bytes, vdupq_n_u8(0xF0)), vdupq_n_u8(0xE0)));
+
+    masks->lead4 = guac_parser_neon_mask(vceqq_u8(
+                vandq_u8(bytes, vdupq_n_u8(0xF8)), vdupq_n_u8(0xF0)));
+
+    /* Characters of three or more bytes also require a second byte, etc. */
+    masks->lead3 |= masks->lead4;
+    masks->lead2 |= masks->lead3;
+
+}
+
+#endif
+
+/**
+ * Skips over as many whole blocks of element content as possible without
+ * examining each character individually, updating the number of characters
+ * remaining in the current element accordingly. A block is skipped only if
+ * it lies entirely within the current element and if walking it character
+ * by character with guac_utf8_charsize() would end exactly at the end of the
+ * block, such that the result is identical to that of the scalar parser.
+ * Any block which does not satisfy these conditions, such as a block
+ * containing malformed UTF-8 or a character split across the block
+ * boundary, must be handled by the scalar parser.
+ *
+ * @param buffer
+ *     The element content to skip.
+ *
+ * @param length
+ *     The number of bytes available within the buffer.
+ *
+ * @param element_length
+ *     Pointer to the number of characters remaining in the current element,
+ *     which will be decremented by the number of characters skipped.
+ *
+ * @return
+ *     The number of bytes skipped, which may be zero.
+ */
+static int guac_parser_skip_content(const char* buffer, int length,
+        int* element_length) {
+
+#if defined(GUAC_PARSER_SSE2) || defined(GUAC_PARSER_NEON)
+
+    const char* current = buffer;
+    int remaining = *element_length;
+
+    while (length >= GUAC_PARSER_BLOCK_SIZE
+            && remaining >= GUAC_PARSER_BLOCK_SIZE) {
+
+        guac_parser_block_masks masks;
+        guac_parser_classify_block(current, &masks);
+
+        /* ASCII blocks contain exactly one character per byte */
+        int chars = GUAC_PARSER_BLOCK_SIZE;
+
+        if (masks.high != 0) {
+
+            /* Bytes which must be continuation bytes, given the lead bytes
+             * present. Characters may not extend past the block. */
+            uint64_t lead2 = masks.lead2;
+            uint64_t lead3 = masks.lead3;
+            uint64_t lead4 = masks.lead4;
+
+            if (((lead2 >> (BITS_PER_BYTE * (GUAC_PARSER_BLOCK_SIZE - 1)))
+               | (lead3 >> (BITS_PER_BYTE * (GUAC_PARSER_BLOCK_SIZE - 2)))
+               | (lead4 >> (BITS_PER_BYTE * (GUAC_PARSER_BLOCK_SIZE - 3))))
+                    != 0)
+                break;
+
+            uint64_t required = ((lead2 << BITS_PER_BYTE)
+                               | (lead3 << (BITS_PER_BYTE * 2))
+                               | (lead4 << (BITS_PER_BYTE * 3))) & BLOCK_MASK;
+
+            /* Only if every continuation byte is accounted for by exactly
+             * one lead byte (and vice versa) will counting lead bytes match
+             * the scalar parser */
+            if (required != masks.cont)
+                break;
+
+            chars -= __builtin_popcountll(masks.cont) / BITS_PER_BYTE;
+
+        }
+
+        /* Do not skip past the end of the element */
+        if (chars > remaining)
+            break;
+
+        remaining -= chars;
+        current += GUAC_PARSER_BLOCK_SIZE;
+        length -= GUAC_PARSER_BLOCK_SIZE;
+
+    }
+
+    *element_length = remaining;
+    return current - buffer;
+
+#else
+
+    /* No SIMD implementation available - all content is parsed by the
+     * scalar parser */
+    return 0;
+
+#endif
+
+}
+
 guac_parser* guac_parser_alloc() {
 
     /* Allocate space for parser */
@@ -112,6 +385,20 @@ int guac_parser_append(guac_parser* parser, void* buffer, int length) {
 
         while (bytes_parsed < length && parser->__element_length >= 0) {
 
+            /* Skip runs of content in bulk where possible */
+            if (parser->__element_length >= GUAC_PARSER_BLOCK_SIZE) {
+
+                int skipped = guac_parser_skip_content(char_buffer,
+                        length - bytes_parsed, &parser->__element_length);
+
+                char_buffer += skipped;
+                bytes_parsed += skipped;
+
+                if (bytes_parsed == length)
+                    break;
+
+            }
+
             /* Get length of current character */
             char c = *char_buffer;
             int char_length = guac_utf8_charsize((unsigned char) c);
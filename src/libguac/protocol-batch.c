@@ -0,0 +1,191 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/layer.h"
+#include "guacamole/protocol-batch.h"
+#include "guacamole/socket.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Writes the given integer as a Guacamole protocol element, including its
+ * length prefix, to the given buffer. The buffer must have space for at
+ * least 24 bytes. No null terminator is written.
+ *
+ * @param buffer
+ *     The buffer to write the element to.
+ *
+ * @param value
+ *     The integer value of the element.
+ *
+ * @return
+ *     A pointer to the byte immediately following the written element.
+ */
+static char* __guac_protocol_batch_write_int(char* buffer, int64_t value) {
+
+    char digits[20];
+    char* start = digits + sizeof(digits);
+
+    /* Produce digits in reverse, taking care not to negate INT64_MIN */
+    uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+    do {
+        *(--start) = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    int length = digits + sizeof(digits) - start;
+    if (value < 0)
+        length++;
+
+    /* Length prefix (at most 20 characters, thus at most 2 digits) */
+    if (length >= 10)
+        *(buffer++) = '0' + length / 10;
+    *(buffer++) = '0' + length % 10;
+    *(buffer++) = '.';
+
+    /* Value */
+    if (value < 0)
+        *(buffer++) = '-';
+
+    memcpy(buffer, start, digits + sizeof(digits) - start);
+    return buffer + (digits + sizeof(digits) - start);
+
+}
+
+/**
+ * Appends an instruction consisting entirely of integer arguments to the
+ * given batch, flushing the batch first if the instruction will not fit.
+ *
+ * @param batch
+ *     The guac_protocol_batch to append the instruction to.
+ *
+ * @param opcode
+ *     The opcode of the instruction, including its length prefix (for
+ *     example, "4.rect").
+ *
+ * @param args
+ *     The integer arguments of the instruction.
+ *
+ * @param argc
+ *     The number of arguments, which may be no more than 9.
+ *
+ * @return
+ *     Zero on success, non-zero on error.
+ */
+static int __guac_protocol_batch_append(guac_protocol_batch* batch,
+        const char* opcode, const int64_t* args, int argc) {
+
+    char instruction[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH];
+
+    /* Serialize instruction */
+    size_t opcode_length = strlen(opcode);
+    memcpy(instruction, opcode, opcode_length);
+
+    char* current = instruction + opcode_length;
+    for (int i = 0; i < argc; i++) {
+        *(current++) = ',';
+        current = __guac_protocol_batch_write_int(current, args[i]);
+    }
+
+    *(current++) = ';';
+    size_t length = current - instruction;
+
+    /* Make room for instruction if necessary */
+    if (batch->length + length > batch->size
+            && guac_protocol_batch_flush(batch))
+        return 1;
+
+    /* Write directly if the batch buffer is simply too small */
+    if (length > batch->size) {
+        guac_socket_instruction_begin(batch->socket);
+        int retval = guac_socket_write(batch->socket, instruction, length);
+        guac_socket_instruction_end(batch->socket);
+        return retval;
+    }
+
+    memcpy(batch->buffer + batch->length, instruction, length);
+    batch->length += length;
+    return 0;
+
+}
+
+void guac_protocol_batch_init(guac_protocol_batch* batch, guac_socket* socket,
+        char* buffer, size_t size) {
+    batch->socket = socket;
+    batch->buffer = buffer;
+    batch->size = size;
+    batch->length = 0;
+}
+
+int guac_protocol_batch_flush(guac_protocol_batch* batch) {
+
+    /* Nothing to do if batch is empty */
+    if (batch->length == 0)
+        return 0;
+
+    guac_socket_instruction_begin(batch->socket);
+    int retval = guac_socket_write(batch->socket, batch->buffer,
+            batch->length);
+    guac_socket_instruction_end(batch->socket);
+
+    batch->length = 0;
+    return retval;
+
+}
+
+int guac_protocol_batch_cfill(guac_protocol_batch* batch,
+        guac_composite_mode mode, const guac_layer* layer,
+        int r, int g, int b, int a) {
+
+    int64_t args[] = { mode, layer->index, r, g, b, a };
+    return __guac_protocol_batch_append(batch, "5.cfill", args, 6);
+
+}
+
+int guac_protocol_batch_copy(guac_protocol_batch* batch,
+        const guac_layer* srcl, int srcx, int srcy, int w, int h,
+        guac_composite_mode mode, const guac_layer* dstl, int dstx, int dsty) {
+
+    int64_t args[] = { srcl->index, srcx, srcy, w, h, mode, dstl->index,
+        dstx, dsty };
+    return __guac_protocol_batch_append(batch, "4.copy", args, 9);
+
+}
+
+int guac_protocol_batch_rect(guac_protocol_batch* batch,
+        const guac_layer* layer, int x, int y, int width, int height) {
+
+    int64_t args[] = { layer->index, x, y, width, height };
+    return __guac_protocol_batch_append(batch, "4.rect", args, 5);
+
+}
+
+int guac_protocol_batch_transfer(guac_protocol_batch* batch,
+        const guac_layer* srcl, int srcx, int srcy, int w, int h,
+        guac_transfer_function fn, const guac_layer* dstl, int dstx, int dsty) {
+
+    int64_t args[] = { srcl->index, srcx, srcy, w, h, fn, dstl->index,
+        dstx, dsty };
+    return __guac_protocol_batch_append(batch, "8.transfer", args, 9);
+
+}
+
@@ -19,10 +19,12 @@
 
 #include "config.h"
 
+#include "base64.h"
 #include "guacamole/error.h"
 #include "guacamole/layer.h"
 #include "guacamole/object.h"
 #include "guacamole/protocol.h"
+#include "guacamole/protocol-batch.h"
 #include "guacamole/protocol-types.h"
 #include "guacamole/socket.h"
 #include "guacamole/stream.h"
@@ -245,8 +247,29 @@ int guac_protocol_send_audio(guac_socket* socket, const guac_stream* stream,
 
 }
 
-int guac_protocol_send_blob(guac_socket* socket, const guac_stream* stream,
-        const void* data, int count) {
+/**
+ * Sends a blob instruction containing the given data, base64-encoding that
+ * data incrementally as it is written to the socket. This is used for blobs
+ * which exceed GUAC_PROTOCOL_BLOB_MAX_LENGTH, and which therefore cannot be
+ * encoded in their entirety ahead of time by guac_protocol_send_blob().
+ *
+ * @param socket
+ *     The guac_socket connection to use.
+ *
+ * @param stream
+ *     The stream to associate with the blob.
+ *
+ * @param data
+ *     The data to send.
+ *
+ * @param count
+ *     The number of bytes of data to send.
+ *
+ * @return
+ *     Zero on success, non-zero on error.
+ */
+static int __guac_protocol_send_large_blob(guac_socket* socket,
+        const guac_stream* stream, const void* data, int count) {
 
     int base64_length = (count + 2) / 3 * 4;
 
@@ -268,6 +291,43 @@ int guac_protocol_send_blob(guac_socket* socket, const guac_stream* stream,
 
 }
 
+int guac_protocol_send_blob(guac_socket* socket, const guac_stream* stream,
+        const void* data, int count) {
+
+    /* Data which cannot be encoded in advance must be encoded as written */
+    if (count > GUAC_PROTOCOL_BLOB_MAX_LENGTH)
+        return __guac_protocol_send_large_blob(socket, stream, data, count);
+
+    char index[128];
+    char header[256];
+    char encoded[GUAC_BASE64_ENCODED_LENGTH(GUAC_PROTOCOL_BLOB_MAX_LENGTH)];
+
+    /* Encode blob contents in their entirety */
+    int base64_length = guac_base64_encode(data, count, encoded);
+
+    /* Build all portions of the instruction preceding the blob contents */
+    snprintf(index, sizeof(index), "%i", stream->index);
+    int header_length = snprintf(header, sizeof(header), "4.blob,%i.%s,%i.",
+            (int) strlen(index), index, base64_length);
+
+    /* Write entire instruction at once, allowing the socket to avoid copying
+     * the encoded contents */
+    guac_socket_vector vector[] = {
+        { header,  header_length },
+        { encoded, base64_length },
+        { ";",     1             }
+    };
+
+    int ret_val;
+
+    guac_socket_instruction_begin(socket);
+    ret_val = guac_socket_write_vector(socket, vector, 3);
+    guac_socket_instruction_end(socket);
+
+    return ret_val;
+
+}
+
 int guac_protocol_send_blobs(guac_socket* socket, const guac_stream* stream,
         const void* data, int count) {
 
@@ -321,26 +381,14 @@ int guac_protocol_send_cfill(guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer,
         int r, int g, int b, int a) {
 
-    int ret_val;
+    char buffer[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH];
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "5.cfill,")
-        || __guac_socket_write_length_int(socket, mode)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, r)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, g)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, b)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, a)
-        || guac_socket_write_string(socket, ";");
+    /* Serialize instruction such that it is written all at once */
+    guac_protocol_batch batch;
+    guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_batch_cfill(&batch, mode, layer, r, g, b, a)
+        || guac_protocol_batch_flush(&batch);
 
 }
 
@@ -420,32 +468,15 @@ int guac_protocol_send_copy(guac_socket* socket,
         const guac_layer* srcl, int srcx, int srcy, int w, int h,
         guac_composite_mode mode, const guac_layer* dstl, int dstx, int dsty) {
 
-    int ret_val;
+    char buffer[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH];
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.copy,")
-        || __guac_socket_write_length_int(socket, srcl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcy)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, w)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, h)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, mode)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dstl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dstx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dsty)
-        || guac_socket_write_string(socket, ";");
+    /* Serialize instruction such that it is written all at once */
+    guac_protocol_batch batch;
+    guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_batch_copy(&batch, srcl, srcx, srcy, w, h, mode, dstl,
+            dstx, dsty)
+        || guac_protocol_batch_flush(&batch);
 
 }
 
@@ -1033,24 +1064,14 @@ int guac_protocol_send_ready(guac_socket* socket, const char* id) {
 int guac_protocol_send_rect(guac_socket* socket,
         const guac_layer* layer, int x, int y, int width, int height) {
 
-    int ret_val;
+    char buffer[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH];
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "4.rect,")
-        || __guac_socket_write_length_int(socket, layer->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, x)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, y)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, width)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, height)
-        || guac_socket_write_string(socket, ";");
+    /* Serialize instruction such that it is written all at once */
+    guac_protocol_batch batch;
+    guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_batch_rect(&batch, layer, x, y, width, height)
+        || guac_protocol_batch_flush(&batch);
 
 }
 
@@ -1218,32 +1239,15 @@ int guac_protocol_send_transfer(guac_socket* socket,
         const guac_layer* srcl, int srcx, int srcy, int w, int h,
         guac_transfer_function fn, const guac_layer* dstl, int dstx, int dsty) {
 
-    int ret_val;
+    char buffer[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH];
 
-    guac_socket_instruction_begin(socket);
-    ret_val =
-           guac_socket_write_string(socket, "8.transfer,")
-        || __guac_socket_write_length_int(socket, srcl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, srcy)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, w)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, h)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, fn)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dstl->index)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dstx)
-        || guac_socket_write_string(socket, ",")
-        || __guac_socket_write_length_int(socket, dsty)
-        || guac_socket_write_string(socket, ";");
+    /* Serialize instruction such that it is written all at once */
+    guac_protocol_batch batch;
+    guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
 
-    guac_socket_instruction_end(socket);
-    return ret_val;
+    return guac_protocol_batch_transfer(&batch, srcl, srcx, srcy, w, h, fn, dstl,
+            dstx, dsty)
+        || guac_protocol_batch_flush(&batch);
 
 }
 
@@ -21,48 +21,1469 @@
 
 #include "guacamole/client.h"
 #include "guacamole/error.h"
+#include "guacamole/protocol.h"
 #include "guacamole/socket.h"
+#include "guacamole/timestamp.h"
+#include "guacamole/unicode.h"
 #include "guacamole/user.h"
+#include "socket-broadcast.h"
 
+#include <errno.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The size of each block of output within the ring of a broadcast socket
+ * operating in ring mode, in bytes.
+ */
+#define GUAC_BROADCAST_BLOCK_SIZE 65536
+
+/**
+ * The maximum number of bytes copied out of the ring of a broadcast socket
+ * and written to a user at once by each reader of that ring.
+ */
+#define GUAC_BROADCAST_READER_BUFFER_SIZE 8192
+
+/**
+ * The multiple of the maximum lag of a ring beyond which any reader is
+ * disconnected and its blocks released by the thread writing to the ring,
+ * regardless of lag policy. Readers otherwise apply the lag policy
+ * themselves, which they cannot do while blocked writing to their users.
+ */
+#define GUAC_BROADCAST_HARD_LAG_FACTOR 4
+
+/**
+ * The amount of time to wait for a reader to stop on its own before shutting
+ * down the socket of its user, in milliseconds. A reader can only be blocked
+ * for longer than this while writing to a user that is not receiving data.
+ */
+#define GUAC_BROADCAST_READER_STOP_TIMEOUT 250
+
+/**
+ * The number of bytes of each of the opcode and first argument of an
+ * instruction retained while classifying discarded output, including null
+ * terminator. Longer values are truncated, and cannot match any opcode or
+ * stream index of interest.
+ */
+#define GUAC_BROADCAST_ELEMENT_SIZE 16
+
+/**
+ * The opcodes of all instructions which affect only the remote display. As
+ * the state of the display is restored by the resync handler of the client,
+ * these instructions are dropped when output is discarded, while all other
+ * instructions (such as those of audio or clipboard streams) are still sent.
+ * Streams opened with "img" or "video" are likewise part of the display.
+ */
+static const char* GUAC_BROADCAST_DISPLAY_OPCODES[] = {
+    "arc", "cfill", "clip", "close", "copy", "cstroke", "cursor", "curve",
+    "dispose", "distort", "identity", "lfill", "line", "lstroke", "mouse",
+    "move", "pop", "push", "rect", "reset", "set", "shade", "size", "start",
+    "sync", "transfer", "transform", NULL
+};
+
+/**
+ * A single block of the output written to a broadcast socket operating in
+ * ring mode. Blocks form a singly-linked chain in the order written, and are
+ * reference counted. A reference is held by each reader currently draining
+ * the block, by the broadcast socket itself while the block is the block
+ * being written or the block containing the most recently committed data,
+ * and by the previous block in the chain. Once no references remain, the
+ * block is freed, releasing its own reference to the next block.
+ */
+typedef struct guac_broadcast_block {
+
+    /**
+     * The next block in the chain, or NULL if this is the block currently
+     * being written. This is set only once, and is read without locking.
+     */
+    struct guac_broadcast_block* next;
+
+    /**
+     * The number of references to this block.
+     */
+    int refcount;
+
+    /**
+     * The offset of the first byte of this block within the overall output
+     * of the broadcast socket.
+     */
+    uint64_t offset;
+
+    /**
+     * The data within this block. Every block other than the block currently
+     * being written is completely full.
+     */
+    char data[GUAC_BROADCAST_BLOCK_SIZE];
+
+} guac_broadcast_block;
+
+/**
+ * The reader associated with a single user of a broadcast socket operating
+ * in ring mode. Each reader has its own thread, which drains committed
+ * output from the ring into the user's socket.
+ */
+typedef struct guac_broadcast_reader {
+
+    /**
+     * The user whose socket should receive the output of the ring.
+     */
+    guac_user* user;
+
+    /**
+     * The ring being drained.
+     */
+    struct guac_broadcast_ring* ring;
+
+    /**
+     * The thread draining the ring into the user's socket.
+     */
+    pthread_t thread;
+
+    /**
+     * Lock which is acquired while the reader copies data out of its current
+     * block or advances to the next block, and by the thread writing to the
+     * ring while releasing the blocks of a reader that has fallen too far
+     * behind.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * The block containing the next byte to be written to the user, or NULL
+     * if the reader thread has terminated or the reader has fallen so far
+     * behind that its blocks have been released. The reader holds a
+     * reference to this block.
+     */
+    guac_broadcast_block* block;
+
+    /**
+     * Data copied out of the ring which is being written to the user. Data is
+     * written from this buffer rather than directly from the ring, such that
+     * a reader blocked while writing does not prevent the ring from being
+     * freed.
+     */
+    char buffer[GUAC_BROADCAST_READER_BUFFER_SIZE];
+
+    /**
+     * The offset of the next byte to be written to the user within the
+     * overall output of the broadcast socket.
+     */
+    uint64_t position;
+
+    /**
+     * Non-zero if the reader thread has been requested to stop.
+     */
+    int stopping;
+
+    /**
+     * Non-zero if the reader thread is about to terminate and will no longer
+     * access the user's socket. This is accessed only while holding the
+     * wait_lock of the ring.
+     */
+    int exited;
+
+    /**
+     * Non-zero if all output is currently being discarded rather than
+     * written to the user, as the processing lag of the user exceeded
+     * GUAC_CLIENT_FRAME_SKIP_LAG. This is accessed only by the reader
+     * thread.
+     */
+    int skipping;
+
+    /**
+     * The timestamp of the most recent frame known to have been received by
+     * the user in its entirety at the time frames began to be skipped.
+     */
+    guac_timestamp skip_since;
+
+    /**
+     * The timestamp of the "sync" instruction sent to the user when frames
+     * began to be skipped. The user has caught up once it has acknowledged
+     * this frame.
+     */
+    guac_timestamp skip_marker;
+
+    /**
+     * The timestamp of the last frame sent prior to the most recent resync
+     * of the user. The processing lag of the user does not reflect the
+     * resync until a later frame has been acknowledged, thus frames are not
+     * skipped again until then.
+     */
+    guac_timestamp resync_marker;
+
+    /**
+     * The next reader in the list of all readers of the ring.
+     */
+    struct guac_broadcast_reader* next;
+
+} guac_broadcast_reader;
+
+/**
+ * The shared output of a broadcast socket operating in ring mode, along with
+ * the readers draining that output.
+ */
+typedef struct guac_broadcast_ring {
+
+    /**
+     * The client whose users are receiving the output of this ring.
+     */
+    guac_client* client;
+
+    /**
+     * Lock which is acquired while writing to or committing the output of
+     * the ring, and while adding or removing readers. Readers do not acquire
+     * this lock while draining the ring.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * The block currently being written.
+     */
+    guac_broadcast_block* tail;
+
+    /**
+     * The block containing the most recently committed byte, or the first
+     * byte of the ring if nothing has yet been committed. New readers start
+     * from this block.
+     */
+    guac_broadcast_block* commit_block;
+
+    /**
+     * The total number of bytes written to the ring.
+     */
+    uint64_t written;
+
+    /**
+     * The total number of bytes committed to the ring. Committed output
+     * always ends at an instruction boundary, and only committed output may
+     * be drained by readers.
+     */
+    uint64_t committed;
+
+    /**
+     * The maximum number of bytes that a reader may fall behind before the
+     * lag policy is applied.
+     */
+    size_t max_lag;
+
+    /**
+     * The action to take for readers that fall too far behind.
+     */
+    guac_client_lag_policy policy;
+
+    /**
+     * All readers of this ring.
+     */
+    guac_broadcast_reader* readers;
+
+    /**
+     * Lock which must be acquired when waiting for or signalling
+     * data_available.
+     */
+    pthread_mutex_t wait_lock;
+
+    /**
+     * Condition which is signalled whenever new output is committed to the
+     * ring or a reader is requested to stop.
+     */
+    pthread_cond_t data_available;
+
+    /**
+     * The number of readers currently waiting on data_available. Commits
+     * only signal data_available if this is non-zero.
+     */
+    int sleepers;
+
+} guac_broadcast_ring;
 
 /**
  * Data associated with an open socket which writes to all connected users of
  * a particular guac_client.
  */
-typedef struct guac_socket_broadcast_data {
+typedef struct guac_socket_broadcast_data {
+
+    /**
+     * The guac_client whose connected users should receive all instructions
+     * written to this socket.
+     */
+    guac_client* client;
+
+    /**
+     * Lock which is acquired when an instruction is being written, and
+     * released when the instruction is finished being written.
+     */
+    pthread_mutex_t socket_lock;
+
+    /**
+     * The shared output of this socket, if operating in ring mode, or NULL
+     * if output is written to each user synchronously.
+     */
+    guac_broadcast_ring* ring;
+
+} guac_socket_broadcast_data;
+
+/**
+ * Single chunk of data, to be broadcast to all users.
+ */
+typedef struct __write_chunk {
+
+    /**
+     * The buffer to write.
+     */
+    const void* buffer;
+
+    /**
+     * The number of bytes in the buffer.
+     */
+    size_t length;
+
+} __write_chunk;
+
+/**
+ * Allocates a new, empty block starting at the given offset, with an initial
+ * reference count of two.
+ *
+ * @param offset
+ *     The offset of the first byte of the new block within the overall
+ *     output of the broadcast socket.
+ *
+ * @return
+ *     The newly-allocated block.
+ */
+static guac_broadcast_block* guac_broadcast_block_alloc(uint64_t offset) {
+
+    guac_broadcast_block* block = malloc(sizeof(guac_broadcast_block));
+    block->next = NULL;
+    block->refcount = 2;
+    block->offset = offset;
+
+    return block;
+
+}
+
+/**
+ * Acquires an additional reference to the given block. The caller must
+ * already hold a reference to the block or to the block preceding it.
+ *
+ * @param block
+ *     The block to acquire a reference to.
+ */
+static void guac_broadcast_block_acquire(guac_broadcast_block* block) {
+    __atomic_add_fetch(&block->refcount, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Releases a reference to the given block, freeing the block (and releasing
+ * its reference to the next block) if no references remain.
+ *
+ * @param block
+ *     The block to release a reference to, or NULL.
+ */
+static void guac_broadcast_block_release(guac_broadcast_block* block) {
+
+    while (block != NULL
+            && __atomic_sub_fetch(&block->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        guac_broadcast_block* next = __atomic_load_n(&block->next,
+                __ATOMIC_ACQUIRE);
+        free(block);
+        block = next;
+    }
+
+}
+
+/**
+ * Applies the lag policy of the given ring to any reader which has fallen
+ * too far behind, but which cannot apply the policy itself as it is blocked
+ * writing to its user. Readers that are not blocked apply the lag policy
+ * themselves. Regardless of policy, readers which have fallen behind by more
+ * than GUAC_BROADCAST_HARD_LAG_FACTOR times the maximum lag are disconnected
+ * and have their blocks released, such that the ring cannot grow without
+ * bound. The ring must be locked.
+ *
+ * @param ring
+ *     The ring whose readers should be checked.
+ */
+static void guac_broadcast_ring_check_lag(guac_broadcast_ring* ring) {
+
+    for (guac_broadcast_reader* reader = ring->readers; reader != NULL;
+            reader = reader->next) {
+
+        uint64_t position = __atomic_load_n(&reader->position,
+                __ATOMIC_RELAXED);
+
+        uint64_t lag = ring->written - position;
+
+        /* A blocked reader may be part way through an instruction, thus
+         * cannot be resynchronized and must be disconnected */
+        if (lag > ring->max_lag * GUAC_BROADCAST_HARD_LAG_FACTOR) {
+
+            pthread_mutex_lock(&(reader->lock));
+
+            if (reader->block != NULL) {
+
+                guac_user_log(reader->user, GUAC_LOG_WARNING, "User has "
+                        "fallen too far behind the connection and will be "
+                        "disconnected.");
+
+                guac_user_stop(reader->user);
+                __atomic_store_n(&reader->stopping, 1, __ATOMIC_SEQ_CST);
+
+                guac_broadcast_block_release(reader->block);
+                reader->block = NULL;
+
+            }
+
+            pthread_mutex_unlock(&(reader->lock));
+
+        }
+
+        /* Readers can only be resynchronized by their own threads */
+        else if (ring->policy == GUAC_CLIENT_LAG_DISCONNECT
+                && lag > ring->max_lag && reader->user->active) {
+            guac_user_log(reader->user, GUAC_LOG_WARNING, "User has fallen "
+                    "too far behind the connection and will be "
+                    "disconnected.");
+            guac_user_stop(reader->user);
+        }
+
+    }
+
+}
+
+/**
+ * Appends the given data to the given ring. The data is not visible to
+ * readers until committed with guac_broadcast_ring_commit().
+ *
+ * @param ring
+ *     The ring to write to.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param count
+ *     The number of bytes to write.
+ */
+static void guac_broadcast_ring_write(guac_broadcast_ring* ring,
+        const void* buf, size_t count) {
+
+    const char* current = (const char*) buf;
+
+    pthread_mutex_lock(&(ring->lock));
+
+    while (count > 0) {
+
+        size_t used = ring->written - ring->tail->offset;
+
+        /* Start a new block once the current block is full, linking the new
+         * block such that readers may follow */
+        if (used == GUAC_BROADCAST_BLOCK_SIZE) {
+
+            guac_broadcast_block* block =
+                guac_broadcast_block_alloc(ring->written);
+
+            __atomic_store_n(&ring->tail->next, block, __ATOMIC_RELEASE);
+            guac_broadcast_block_release(ring->tail);
+            ring->tail = block;
+            used = 0;
+
+            guac_broadcast_ring_check_lag(ring);
+
+        }
+
+        size_t length = GUAC_BROADCAST_BLOCK_SIZE - used;
+        if (length > count)
+            length = count;
+
+        memcpy(ring->tail->data + used, current, length);
+        ring->written += length;
+
+        current += length;
+        count -= length;
+
+    }
+
+    pthread_mutex_unlock(&(ring->lock));
+
+}
+
+/**
+ * Makes all data written to the given ring thus far visible to readers,
+ * waking any readers that are waiting for data. This must only be invoked
+ * at instruction boundaries.
+ *
+ * @param ring
+ *     The ring to commit.
+ */
+static void guac_broadcast_ring_commit(guac_broadcast_ring* ring) {
+
+    pthread_mutex_lock(&(ring->lock));
+
+    /* Retain the block containing the committed data for new readers */
+    if (ring->commit_block != ring->tail) {
+        guac_broadcast_block_acquire(ring->tail);
+        guac_broadcast_block_release(ring->commit_block);
+        ring->commit_block = ring->tail;
+    }
+
+    __atomic_store_n(&ring->committed, ring->written, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_unlock(&(ring->lock));
+
+    /* Wake readers only if any are waiting */
+    if (__atomic_load_n(&ring->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&(ring->wait_lock));
+        pthread_cond_broadcast(&(ring->data_available));
+        pthread_mutex_unlock(&(ring->wait_lock));
+    }
+
+}
+
+/**
+ * Waits until the given reader has committed data to drain, until the reader
+ * is requested to stop, or until the given timeout elapses.
+ *
+ * @param reader
+ *     The reader that should wait.
+ *
+ * @param msec_timeout
+ *     The maximum amount of time to wait, in milliseconds, or -1 to wait
+ *     indefinitely.
+ *
+ * @return
+ *     The total number of bytes committed to the ring.
+ */
+static uint64_t guac_broadcast_reader_wait(guac_broadcast_reader* reader,
+        int msec_timeout) {
+
+    guac_broadcast_ring* ring = reader->ring;
+
+    uint64_t committed = __atomic_load_n(&ring->committed, __ATOMIC_SEQ_CST);
+    if (committed != reader->position
+            || __atomic_load_n(&reader->stopping, __ATOMIC_SEQ_CST))
+        return committed;
+
+    /* Calculate absolute deadline from provided relative timeout */
+    struct timespec deadline;
+    if (msec_timeout >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += msec_timeout / 1000;
+        deadline.tv_nsec += (msec_timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&(ring->wait_lock));
+    __atomic_add_fetch(&ring->sleepers, 1, __ATOMIC_SEQ_CST);
+
+    /* The committing thread checks for sleepers only after updating the
+     * committed count, thus no wakeup can be missed here */
+    while ((committed = __atomic_load_n(&ring->committed, __ATOMIC_SEQ_CST))
+                == reader->position
+            && !__atomic_load_n(&reader->stopping, __ATOMIC_SEQ_CST)) {
+
+        if (msec_timeout < 0)
+            pthread_cond_wait(&(ring->data_available), &(ring->wait_lock));
+
+        else if (pthread_cond_timedwait(&(ring->data_available),
+                    &(ring->wait_lock), &deadline) == ETIMEDOUT)
+            break;
+
+    }
+
+    __atomic_sub_fetch(&ring->sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&(ring->wait_lock));
+
+    return committed;
+
+}
+
+/**
+ * A position within the committed output of a ring, used to read that output
+ * without regard for block boundaries.
+ */
+typedef struct guac_broadcast_scan {
+
+    /**
+     * The block containing the next byte to be read, or the block ending
+     * with the next byte to be read if that byte is the first byte of the
+     * following block. A reference to the first block scanned must be held
+     * for as long as the scan is in use, keeping all following blocks alive.
+     */
+    guac_broadcast_block* block;
+
+    /**
+     * The offset of the next byte to be read within the overall output of
+     * the broadcast socket.
+     */
+    uint64_t position;
+
+    /**
+     * The offset of the first byte within the overall output of the
+     * broadcast socket that must not be read.
+     */
+    uint64_t end;
+
+} guac_broadcast_scan;
+
+/**
+ * Reads the next byte of output, advancing to the next block as necessary.
+ *
+ * @param scan
+ *     The position to read from.
+ *
+ * @return
+ *     The byte read, or -1 if the end of the output being scanned has been
+ *     reached.
+ */
+static int guac_broadcast_scan_next(guac_broadcast_scan* scan) {
+
+    if (scan->position == scan->end)
+        return -1;
+
+    if (scan->position == scan->block->offset + GUAC_BROADCAST_BLOCK_SIZE)
+        scan->block = __atomic_load_n(&scan->block->next, __ATOMIC_ACQUIRE);
+
+    return (unsigned char)
+        scan->block->data[scan->position++ - scan->block->offset];
+
+}
+
+/**
+ * Reads the next element of an instruction, including its terminator. The
+ * length prefix of each element is given in Unicode codepoints, thus the
+ * value is read one whole UTF-8 character at a time.
+ *
+ * @param scan
+ *     The position to read from, which must be the start of an element.
+ *
+ * @param value
+ *     A buffer which should receive the value of the element, truncated as
+ *     necessary and null-terminated, or NULL if the value is not needed.
+ *
+ * @param size
+ *     The size of the given buffer, in bytes.
+ *
+ * @return
+ *     The terminator of the element (',' or ';'), or -1 if the output is
+ *     malformed or ends within the element.
+ */
+static int guac_broadcast_scan_element(guac_broadcast_scan* scan,
+        char* value, size_t size) {
+
+    size_t length = 0;
+    size_t stored = 0;
+    int c;
+
+    /* Parse length prefix */
+    while ((c = guac_broadcast_scan_next(scan)) >= '0' && c <= '9')
+        length = length * 10 + c - '0';
+
+    if (c != '.')
+        return -1;
+
+    /* Read value one UTF-8 character at a time */
+    for (size_t i = 0; i < length; i++) {
+
+        c = guac_broadcast_scan_next(scan);
+        if (c == -1)
+            return -1;
+
+        size_t remaining = guac_utf8_charsize(c);
+        for (;;) {
+
+            if (value != NULL && stored + 1 < size)
+                value[stored++] = c;
+
+            if (--remaining == 0)
+                break;
+
+            c = guac_broadcast_scan_next(scan);
+            if (c == -1)
+                return -1;
+
+        }
+
+    }
+
+    if (value != NULL)
+        value[stored] = '\0';
+
+    c = guac_broadcast_scan_next(scan);
+    if (c != ',' && c != ';')
+        return -1;
+
+    return c;
+
+}
+
+/**
+ * Returns whether the instruction having the given opcode and first argument
+ * affects only the remote display, updating the given set of open display
+ * streams accordingly. The "blob" and "end" instructions affect only the
+ * display if their stream was opened as a display stream within the output
+ * being classified. All other streams, including any display stream opened
+ * before that output, must receive their remaining instructions such that
+ * they are properly closed by the user.
+ *
+ * @param opcode
+ *     The opcode of the instruction.
+ *
+ * @param argument
+ *     The first argument of the instruction, or an empty string if the
+ *     instruction has no arguments.
+ *
+ * @param display_streams
+ *     An array containing a non-zero value for each index of a broadcast
+ *     stream currently open as a display stream.
+ *
+ * @return
+ *     Non-zero if the instruction affects only the remote display and may be
+ *     dropped, zero otherwise.
+ */
+static int guac_broadcast_is_display_instruction(const char* opcode,
+        const char* argument, char* display_streams) {
+
+    int index = atoi(argument);
+    int tracked = index >= 0 && index < GUAC_CLIENT_MAX_STREAMS * 2;
+
+    /* Track opened display streams */
+    if (strcmp(opcode, "img") == 0 || strcmp(opcode, "video") == 0) {
+        if (tracked)
+            display_streams[index] = 1;
+        return 1;
+    }
+
+    if (strcmp(opcode, "blob") == 0)
+        return tracked && display_streams[index];
+
+    if (strcmp(opcode, "end") == 0) {
+        if (tracked && display_streams[index]) {
+            display_streams[index] = 0;
+            return 1;
+        }
+        return 0;
+    }
+
+    for (const char** current = GUAC_BROADCAST_DISPLAY_OPCODES;
+            *current != NULL; current++) {
+        if (strcmp(opcode, *current) == 0)
+            return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Writes the output between the current position of the given scan and the
+ * given offset to the given socket, advancing the scan to that offset.
+ *
+ * @param scan
+ *     The position of the first byte to write.
+ *
+ * @param end
+ *     The offset of the first byte that should not be written.
+ *
+ * @param socket
+ *     The socket to write to.
+ *
+ * @return
+ *     Zero on success, non-zero if writing to the socket fails.
+ */
+static int guac_broadcast_scan_write(guac_broadcast_scan* scan, uint64_t end,
+        guac_socket* socket) {
+
+    while (scan->position < end) {
+
+        uint64_t block_end = scan->block->offset + GUAC_BROADCAST_BLOCK_SIZE;
+
+        if (scan->position == block_end) {
+            scan->block = __atomic_load_n(&scan->block->next,
+                    __ATOMIC_ACQUIRE);
+            continue;
+        }
+
+        size_t length = (end < block_end ? end : block_end) - scan->position;
+
+        if (guac_socket_write(socket,
+                    scan->block->data + (scan->position - scan->block->offset),
+                    length))
+            return 1;
+
+        scan->position += length;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Writes all instructions within the given range of committed output which
+ * do not affect only the remote display to the given socket, dropping the
+ * rest. Instructions are written within a single instruction block, such
+ * that they cannot be interleaved with other instructions written to the
+ * socket.
+ *
+ * @param block
+ *     The block containing the first byte of the range, or the block ending
+ *     with that byte. A reference to this block must be held by the caller.
+ *
+ * @param position
+ *     The offset of the first byte of the range, which must be an
+ *     instruction boundary.
+ *
+ * @param end
+ *     The offset of the first byte following the range, which must be an
+ *     instruction boundary.
+ *
+ * @param socket
+ *     The socket to write to.
+ */
+static void guac_broadcast_forward(guac_broadcast_block* block,
+        uint64_t position, uint64_t end, guac_socket* socket) {
+
+    guac_broadcast_scan scan = {
+        .block = block,
+        .position = position,
+        .end = end
+    };
+
+    char display_streams[GUAC_CLIENT_MAX_STREAMS * 2] = { 0 };
+
+    guac_socket_instruction_begin(socket);
+
+    while (scan.position < end) {
+
+        guac_broadcast_scan start = scan;
+        char opcode[GUAC_BROADCAST_ELEMENT_SIZE];
+        char argument[GUAC_BROADCAST_ELEMENT_SIZE] = "";
+
+        /* Read opcode and first argument, skipping all others */
+        int c = guac_broadcast_scan_element(&scan, opcode, sizeof(opcode));
+        if (c == ',')
+            c = guac_broadcast_scan_element(&scan, argument, sizeof(argument));
+
+        while (c == ',')
+            c = guac_broadcast_scan_element(&scan, NULL, 0);
+
+        /* Committed output always ends at an instruction boundary */
+        if (c != ';')
+            break;
+
+        if (guac_broadcast_is_display_instruction(opcode, argument,
+                    display_streams))
+            continue;
+
+        if (guac_broadcast_scan_write(&start, scan.position, socket))
+            break;
+
+    }
+
+    guac_socket_instruction_end(socket);
+
+}
+
+/**
+ * Discards all committed data not yet written to the given reader's user,
+ * skipping directly to the most recently committed instruction boundary.
+ * Only instructions which affect the remote display are dropped. All other
+ * instructions within the discarded data, such as those of audio, clipboard
+ * or file streams, are written to the given socket, such that those streams
+ * are neither corrupted nor left open.
+ *
+ * @param reader
+ *     The reader whose pending data should be discarded.
+ *
+ * @param socket
+ *     The socket which should receive all discarded instructions which do
+ *     not affect the remote display.
+ */
+static void guac_broadcast_reader_discard(guac_broadcast_reader* reader,
+        guac_socket* socket) {
+
+    guac_broadcast_ring* ring = reader->ring;
+
+    /* Take over the reference to the old block of the reader, such that the
+     * discarded data remains available until it has been scanned */
+    pthread_mutex_lock(&(ring->lock));
+    guac_broadcast_block* block = reader->block;
+    uint64_t position = reader->position;
+    uint64_t end = ring->committed;
+    guac_broadcast_block_acquire(ring->commit_block);
+    reader->block = ring->commit_block;
+    __atomic_store_n(&reader->position, end, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&(ring->lock));
+
+    /* The ring is not locked while writing, as this may block */
+    if (block != NULL) {
+        guac_broadcast_forward(block, position, end, socket);
+        guac_broadcast_block_release(block);
+    }
 
-    /**
-     * The guac_client whose connected users should receive all instructions
-     * written to this socket.
-     */
-    guac_client* client;
+}
 
-    /**
-     * Lock which is acquired when an instruction is being written, and
-     * released when the instruction is finished being written.
-     */
-    pthread_mutex_t socket_lock;
+/**
+ * Sends the current state of the connection to the given reader's user via
+ * the client's resync handler, following a discard of output that had not
+ * yet been written to that user. If the resync fails, the user is
+ * disconnected.
+ *
+ * @param reader
+ *     The reader whose user should be resynchronized.
+ *
+ * @param since
+ *     The timestamp of the most recent frame which the user is known to
+ *     have received in its entirety.
+ *
+ * @return
+ *     Non-zero if the user has been resynchronized and the reader should
+ *     continue, zero if the user has been disconnected.
+ */
+static int guac_broadcast_reader_send_state(guac_broadcast_reader* reader,
+        guac_timestamp since) {
 
-} guac_socket_broadcast_data;
+    guac_user* user = reader->user;
+    guac_client* client = reader->ring->client;
+
+    reader->resync_marker = client->last_sent_timestamp;
+
+    if (client->resync_handler(user, since)
+            || guac_socket_flush(user->socket)) {
+        guac_user_stop(user);
+        return 0;
+    }
+
+    return 1;
+
+}
 
 /**
- * Single chunk of data, to be broadcast to all users.
+ * Applies the lag policy of the ring to the given reader, which has fallen
+ * too far behind. If the policy is GUAC_CLIENT_LAG_RESYNC, all output not
+ * yet written to the reader's user is skipped and the client's resync
+ * handler is invoked. Otherwise, the user is disconnected.
+ *
+ * @param reader
+ *     The reader that has fallen too far behind.
+ *
+ * @return
+ *     Non-zero if the reader has been resynchronized and should continue,
+ *     zero if the user has been disconnected.
  */
-typedef struct __write_chunk {
+static int guac_broadcast_reader_resync(guac_broadcast_reader* reader) {
 
-    /**
-     * The buffer to write.
-     */
-    const void* buffer;
+    guac_broadcast_ring* ring = reader->ring;
+    guac_user* user = reader->user;
+    guac_client* client = ring->client;
 
-    /**
-     * The number of bytes in the buffer.
-     */
-    size_t length;
+    /* Disconnect user if resync is not possible */
+    if (ring->policy != GUAC_CLIENT_LAG_RESYNC
+            || client->resync_handler == NULL) {
+        guac_user_log(user, GUAC_LOG_WARNING, "User has fallen too far "
+                "behind the connection and will be disconnected.");
+        guac_user_stop(user);
+        return 0;
+    }
 
-} __write_chunk;
+    /* All frames through the last acknowledged frame have been received */
+    guac_timestamp since = user->last_received_timestamp;
+
+    guac_broadcast_reader_discard(reader, user->socket);
+
+    guac_user_log(user, GUAC_LOG_DEBUG, "User has fallen too far behind the "
+            "connection. Skipping to current state.");
+
+    return guac_broadcast_reader_send_state(reader, since);
+
+}
+
+/**
+ * Returns whether frames should be skipped for the given reader's user, due
+ * to the processing lag of that user exceeding GUAC_CLIENT_FRAME_SKIP_LAG.
+ *
+ * @param reader
+ *     The reader to test.
+ *
+ * @return
+ *     Non-zero if frames should be skipped for the reader's user, zero
+ *     otherwise.
+ */
+static int guac_broadcast_reader_should_skip(guac_broadcast_reader* reader) {
+
+    guac_broadcast_ring* ring = reader->ring;
+    guac_user* user = reader->user;
+
+    /* Skipping frames requires resync support */
+    if (ring->policy != GUAC_CLIENT_LAG_RESYNC
+            || ring->client->resync_handler == NULL)
+        return 0;
+
+    /* Lag is not meaningful until a frame following any resync is
+     * acknowledged */
+    if (user->last_received_timestamp <= reader->resync_marker)
+        return 0;
+
+    return user->processing_lag > GUAC_CLIENT_FRAME_SKIP_LAG;
+
+}
+
+/**
+ * Begins skipping frames for the given reader's user, discarding all output
+ * not yet written to the user. A "sync" instruction is sent to the user such
+ * that it can be determined when the user has caught up with the output
+ * that has already been written.
+ *
+ * @param reader
+ *     The reader whose user should have frames skipped.
+ *
+ * @return
+ *     Non-zero if frames are now being skipped and the reader should
+ *     continue, zero if the user has been disconnected.
+ */
+static int guac_broadcast_reader_begin_skip(guac_broadcast_reader* reader) {
+
+    guac_user* user = reader->user;
+    guac_client* client = reader->ring->client;
+
+    reader->skip_since = user->last_received_timestamp;
+    reader->skip_marker = client->last_sent_timestamp;
+    reader->skipping = 1;
+
+    guac_broadcast_reader_discard(reader, user->socket);
+
+    guac_user_log(user, GUAC_LOG_DEBUG, "User is lagging (processing_lag="
+            "%ims). Skipping frames until caught up.", user->processing_lag);
+
+    /* Mark the end of all output actually written to the user */
+    if (guac_protocol_send_sync(user->socket, reader->skip_marker)
+            || guac_socket_flush(user->socket)) {
+        guac_user_stop(user);
+        return 0;
+    }
+
+    return 1;
+
+}
+
+/**
+ * Discards all committed data not yet written to the given reader's user,
+ * which is currently having frames skipped. If the user has caught up with
+ * the output written prior to skipping, frame skipping stops and the user is
+ * resynchronized with the current state of the connection, receiving the
+ * union of all changes made by the skipped frames.
+ *
+ * @param reader
+ *     The reader whose user is having frames skipped.
+ *
+ * @return
+ *     Non-zero if the reader should continue, zero if the user has been
+ *     disconnected.
+ */
+static int guac_broadcast_reader_skip(guac_broadcast_reader* reader) {
+
+    guac_broadcast_reader_discard(reader, reader->user->socket);
+
+    /* Continue skipping until the user has caught up */
+    if (reader->user->last_received_timestamp < reader->skip_marker)
+        return 1;
+
+    reader->skipping = 0;
+    return guac_broadcast_reader_send_state(reader, reader->skip_since);
+
+}
+
+/**
+ * Writes all committed data not yet written to the given reader's user,
+ * following the chain of blocks as necessary. The data is written within a
+ * single instruction block on the user's socket, such that it cannot be
+ * interleaved with other instructions written directly to that socket.
+ *
+ * @param reader
+ *     The reader whose user should receive the data.
+ *
+ * @param committed
+ *     The total number of bytes committed to the ring.
+ *
+ * @return
+ *     Zero on success, non-zero if writing to the user's socket fails or the
+ *     blocks of the reader have been released.
+ */
+static int guac_broadcast_reader_drain(guac_broadcast_reader* reader,
+        uint64_t committed) {
+
+    guac_socket* socket = reader->user->socket;
+    int retval = 0;
+
+    guac_socket_instruction_begin(socket);
+
+    uint64_t position = reader->position;
+    while (position < committed) {
+
+        pthread_mutex_lock(&(reader->lock));
+
+        /* Stop if the reader has fallen too far behind to continue */
+        guac_broadcast_block* block = reader->block;
+        if (block == NULL) {
+            pthread_mutex_unlock(&(reader->lock));
+            retval = 1;
+            break;
+        }
+
+        uint64_t block_end = block->offset + GUAC_BROADCAST_BLOCK_SIZE;
+
+        /* Advance to next block once this block is exhausted (the next
+         * block must exist, as further data has been committed) */
+        if (position == block_end) {
+            guac_broadcast_block* next = __atomic_load_n(&block->next,
+                    __ATOMIC_ACQUIRE);
+            guac_broadcast_block_acquire(next);
+            guac_broadcast_block_release(block);
+            reader->block = next;
+            pthread_mutex_unlock(&(reader->lock));
+            continue;
+        }
+
+        size_t length = (committed < block_end ? committed : block_end)
+                      - position;
+
+        if (length > GUAC_BROADCAST_READER_BUFFER_SIZE)
+            length = GUAC_BROADCAST_READER_BUFFER_SIZE;
+
+        memcpy(reader->buffer, block->data + (position - block->offset),
+                length);
+
+        position += length;
+        __atomic_store_n(&reader->position, position, __ATOMIC_RELAXED);
+
+        pthread_mutex_unlock(&(reader->lock));
+
+        /* The ring is not referenced while writing, as this may block */
+        if (guac_socket_write(socket, reader->buffer, length)) {
+            retval = 1;
+            break;
+        }
+
+    }
+
+    guac_socket_instruction_end(socket);
+    return retval;
+
+}
+
+/**
+ * The main loop of the thread of a single reader, draining committed output
+ * from the ring into the socket of the reader's user until the reader is
+ * requested to stop or writing to the user fails.
+ *
+ * @param data
+ *     The guac_broadcast_reader to run.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_broadcast_reader_thread(void* data) {
+
+    guac_broadcast_reader* reader = (guac_broadcast_reader*) data;
+    guac_broadcast_ring* ring = reader->ring;
+    guac_user* user = reader->user;
+
+    while (!__atomic_load_n(&reader->stopping, __ATOMIC_SEQ_CST)) {
+
+        /* Users having frames skipped must be polled for having caught up,
+         * as that user may well catch up after all output has stopped */
+        uint64_t committed = guac_broadcast_reader_wait(reader,
+                reader->skipping ? GUAC_CLIENT_FRAME_SKIP_POLL_INTERVAL : -1);
+
+        if (reader->skipping) {
+            if (guac_broadcast_reader_skip(reader))
+                continue;
+            break;
+        }
+
+        if (committed == reader->position)
+            continue;
+
+        /* Apply lag policy if too far behind */
+        if (committed - reader->position > ring->max_lag) {
+            if (guac_broadcast_reader_resync(reader))
+                continue;
+            break;
+        }
+
+        /* Skip frames entirely if the user cannot keep up with them */
+        if (guac_broadcast_reader_should_skip(reader)) {
+            if (guac_broadcast_reader_begin_skip(reader))
+                continue;
+            break;
+        }
+
+        /* Disconnect user if data cannot be written */
+        if (guac_broadcast_reader_drain(reader, committed)) {
+            guac_user_stop(user);
+            break;
+        }
+
+        /* Flush only once all available data has been written */
+        if (__atomic_load_n(&ring->committed, __ATOMIC_SEQ_CST)
+                    == reader->position
+                && guac_socket_flush(user->socket)) {
+            guac_user_stop(user);
+            break;
+        }
+
+    }
+
+    /* Data which will never be written need not be retained */
+    pthread_mutex_lock(&(ring->lock));
+    guac_broadcast_block_release(reader->block);
+    reader->block = NULL;
+    pthread_mutex_unlock(&(ring->lock));
+
+    /* Notify any thread waiting for this reader to stop */
+    pthread_mutex_lock(&(ring->wait_lock));
+    reader->exited = 1;
+    pthread_cond_broadcast(&(ring->data_available));
+    pthread_mutex_unlock(&(ring->wait_lock));
+
+    return NULL;
+
+}
+
+/**
+ * Adds a reader for the given user to the given ring, starting the reader's
+ * thread. If a reader already exists for the user, this function has no
+ * effect.
+ *
+ * @param ring
+ *     The ring that the reader should drain.
+ *
+ * @param user
+ *     The user that should receive the output of the ring.
+ */
+static void guac_broadcast_ring_add_reader(guac_broadcast_ring* ring,
+        guac_user* user) {
+
+    pthread_mutex_lock(&(ring->lock));
+
+    /* Do not add duplicate readers */
+    for (guac_broadcast_reader* current = ring->readers; current != NULL;
+            current = current->next) {
+        if (current->user == user) {
+            pthread_mutex_unlock(&(ring->lock));
+            return;
+        }
+    }
+
+    /* Start from the most recently committed data */
+    guac_broadcast_reader* reader = calloc(1, sizeof(guac_broadcast_reader));
+    reader->user = user;
+    reader->ring = ring;
+    reader->block = ring->commit_block;
+    reader->position = ring->committed;
+    guac_broadcast_block_acquire(reader->block);
+    pthread_mutex_init(&(reader->lock), NULL);
+
+    if (pthread_create(&(reader->thread), NULL,
+                guac_broadcast_reader_thread, reader)) {
+        guac_user_log(user, GUAC_LOG_ERROR, "Unable to start thread for "
+                "broadcast output. User will be disconnected.");
+        guac_broadcast_block_release(reader->block);
+        pthread_mutex_destroy(&(reader->lock));
+        free(reader);
+        guac_user_stop(user);
+    }
+
+    /* Add reader only if successfully started */
+    else {
+        reader->next = ring->readers;
+        ring->readers = reader;
+    }
+
+    pthread_mutex_unlock(&(ring->lock));
+
+}
+
+/**
+ * Stops the given reader, waiting for its thread to terminate, and frees the
+ * reader. The reader must already have been removed from the list of readers
+ * of its ring. If the reader does not stop within
+ * GUAC_BROADCAST_READER_STOP_TIMEOUT milliseconds, it is blocked writing to
+ * its user, and the user's socket is shut down such that the write fails.
+ *
+ * @param reader
+ *     The reader to stop and free.
+ */
+static void guac_broadcast_reader_stop(guac_broadcast_reader* reader) {
+
+    guac_broadcast_ring* ring = reader->ring;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += GUAC_BROADCAST_READER_STOP_TIMEOUT / 1000;
+    deadline.tv_nsec += (GUAC_BROADCAST_READER_STOP_TIMEOUT % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    /* Signal reader to stop, waking it if waiting */
+    __atomic_store_n(&reader->stopping, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&(ring->wait_lock));
+    pthread_cond_broadcast(&(ring->data_available));
+
+    /* Allow the reader to stop on its own, as it will unless blocked */
+    while (!reader->exited) {
+        if (pthread_cond_timedwait(&(ring->data_available),
+                    &(ring->wait_lock), &deadline) == ETIMEDOUT)
+            break;
+    }
+
+    int exited = reader->exited;
+    pthread_mutex_unlock(&(ring->wait_lock));
+
+    /* Force any blocked write to fail, as the user is not receiving data
+     * and may never do so */
+    if (!exited) {
+        guac_user_log(reader->user, GUAC_LOG_DEBUG, "User is not receiving "
+                "broadcast output. Closing connection to user.");
+        if (guac_socket_shutdown(reader->user->socket))
+            guac_user_log(reader->user, GUAC_LOG_WARNING, "Unable to close "
+                    "connection to user: %s. Waiting for pending output to be "
+                    "written.", guac_status_string(guac_error));
+    }
+
+    pthread_join(reader->thread, NULL);
+    pthread_mutex_destroy(&(reader->lock));
+    free(reader);
+
+}
+
+/**
+ * Removes the reader for the given user from the given ring, stopping and
+ * freeing that reader. If no such reader exists, this function has no
+ * effect.
+ *
+ * @param ring
+ *     The ring to remove the reader from.
+ *
+ * @param user
+ *     The user whose reader should be removed.
+ */
+static void guac_broadcast_ring_remove_reader(guac_broadcast_ring* ring,
+        guac_user* user) {
+
+    guac_broadcast_reader* reader = NULL;
+
+    pthread_mutex_lock(&(ring->lock));
+
+    /* Locate and unlink reader */
+    guac_broadcast_reader** current = &(ring->readers);
+    while (*current != NULL) {
+
+        if ((*current)->user == user) {
+            reader = *current;
+            *current = reader->next;
+            break;
+        }
+
+        current = &((*current)->next);
+
+    }
+
+    pthread_mutex_unlock(&(ring->lock));
+
+    if (reader != NULL)
+        guac_broadcast_reader_stop(reader);
+
+}
+
+/**
+ * Allocates a new, empty ring for the given client.
+ *
+ * @param client
+ *     The client whose users will receive the output of the ring.
+ *
+ * @param max_lag
+ *     The maximum number of bytes that a reader may fall behind before the
+ *     lag policy is applied.
+ *
+ * @param policy
+ *     The action to take for readers that fall too far behind.
+ *
+ * @return
+ *     The newly-allocated ring.
+ */
+static guac_broadcast_ring* guac_broadcast_ring_alloc(guac_client* client,
+        size_t max_lag, guac_client_lag_policy policy) {
+
+    guac_broadcast_ring* ring = calloc(1, sizeof(guac_broadcast_ring));
+    ring->client = client;
+    ring->max_lag = max_lag;
+    ring->policy = policy;
+
+    /* The first block is referenced both as the block being written and as
+     * the block containing committed data */
+    ring->tail = ring->commit_block = guac_broadcast_block_alloc(0);
+
+    pthread_mutex_init(&(ring->lock), NULL);
+    pthread_mutex_init(&(ring->wait_lock), NULL);
+    pthread_cond_init(&(ring->data_available), NULL);
+
+    return ring;
+
+}
+
+/**
+ * Frees the given ring, stopping any remaining readers.
+ *
+ * @param ring
+ *     The ring to free.
+ */
+static void guac_broadcast_ring_free(guac_broadcast_ring* ring) {
+
+    /* Stop any remaining readers */
+    guac_broadcast_reader* reader = ring->readers;
+    ring->readers = NULL;
+    while (reader != NULL) {
+        guac_broadcast_reader* next = reader->next;
+        guac_broadcast_reader_stop(reader);
+        reader = next;
+    }
+
+    guac_broadcast_block_release(ring->tail);
+    guac_broadcast_block_release(ring->commit_block);
+
+    pthread_cond_destroy(&(ring->data_available));
+    pthread_mutex_destroy(&(ring->wait_lock));
+    pthread_mutex_destroy(&(ring->lock));
+    free(ring);
+
+}
+
+/**
+ * Returns the ring of the given broadcast socket, or NULL if the socket is
+ * not operating in ring mode.
+ *
+ * @param socket
+ *     The broadcast socket.
+ *
+ * @return
+ *     The ring of the given broadcast socket, or NULL.
+ */
+static guac_broadcast_ring* guac_socket_broadcast_get_ring(
+        guac_socket* socket) {
+
+    guac_socket_broadcast_data* data =
+        (guac_socket_broadcast_data*) socket->data;
+
+    return __atomic_load_n(&data->ring, __ATOMIC_ACQUIRE);
+
+}
 
 /**
  * Callback which handles read requests on the broadcast socket. This callback
@@ -141,6 +1562,13 @@ static ssize_t __guac_socket_broadcast_write_handler(guac_socket* socket,
     guac_socket_broadcast_data* data =
         (guac_socket_broadcast_data*) socket->data;
 
+    /* Serialize only once if operating in ring mode */
+    guac_broadcast_ring* ring = guac_socket_broadcast_get_ring(socket);
+    if (ring != NULL) {
+        guac_broadcast_ring_write(ring, buf, count);
+        return count;
+    }
+
     /* Build chunk */
     __write_chunk chunk;
     chunk.buffer = buf;
@@ -195,6 +1623,13 @@ static ssize_t __guac_socket_broadcast_flush_handler(guac_socket* socket) {
     guac_socket_broadcast_data* data =
         (guac_socket_broadcast_data*) socket->data;
 
+    /* In ring mode, readers flush once they have caught up */
+    guac_broadcast_ring* ring = guac_socket_broadcast_get_ring(socket);
+    if (ring != NULL) {
+        guac_broadcast_ring_commit(ring);
+        return 0;
+    }
+
     /* Flush all users */
     guac_client_foreach_user(data->client, __flush_callback, NULL);
 
@@ -243,8 +1678,10 @@ static void __guac_socket_broadcast_lock_handler(guac_socket* socket) {
     /* Acquire exclusive access to socket */
     pthread_mutex_lock(&(data->socket_lock));
 
-    /* Lock sockets of all users */
-    guac_client_foreach_user(data->client, __lock_callback, NULL);
+    /* Lock sockets of all users (not needed in ring mode, as readers lock
+     * their own users' sockets while writing) */
+    if (guac_socket_broadcast_get_ring(socket) == NULL)
+        guac_client_foreach_user(data->client, __lock_callback, NULL);
 
 }
 
@@ -284,8 +1721,14 @@ static void __guac_socket_broadcast_unlock_handler(guac_socket* socket) {
     guac_socket_broadcast_data* data =
         (guac_socket_broadcast_data*) socket->data;
 
-    /* Unlock sockets of all users */
-    guac_client_foreach_user(data->client, __unlock_callback, NULL);
+    /* Make instruction visible to readers if in ring mode */
+    guac_broadcast_ring* ring = guac_socket_broadcast_get_ring(socket);
+    if (ring != NULL)
+        guac_broadcast_ring_commit(ring);
+
+    /* Otherwise, unlock sockets of all users */
+    else
+        guac_client_foreach_user(data->client, __unlock_callback, NULL);
 
     /* Relinquish exclusive access to socket */
     pthread_mutex_unlock(&(data->socket_lock));
@@ -335,6 +1778,10 @@ static int __guac_socket_broadcast_free_handler(guac_socket* socket) {
     guac_socket_broadcast_data* data =
         (guac_socket_broadcast_data*) socket->data;
 
+    /* Free ring, if any */
+    if (data->ring != NULL)
+        guac_broadcast_ring_free(data->ring);
+
     /* Destroy locks */
     pthread_mutex_destroy(&(data->socket_lock));
 
@@ -354,6 +1801,7 @@ guac_socket* guac_socket_broadcast(guac_client* client) {
 
     /* Store client as socket data */
     data->client = client;
+    data->ring = NULL;
     socket->data = data;
 
     pthread_mutexattr_init(&lock_attributes);
@@ -375,3 +1823,133 @@ guac_socket* guac_socket_broadcast(guac_client* client) {
 
 }
 
+
+/**
+ * Callback invoked by guac_client_foreach_user() which adds a reader for the
+ * given user to the ring of a broadcast socket.
+ *
+ * @param user
+ *     The user that should receive the output of the ring.
+ *
+ * @param data
+ *     The guac_broadcast_ring to add the reader to.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __add_reader_callback(guac_user* user, void* data) {
+    guac_broadcast_ring_add_reader((guac_broadcast_ring*) data, user);
+    return NULL;
+}
+
+int guac_socket_broadcast_enable_ring(guac_socket* socket, size_t max_lag,
+        guac_client_lag_policy policy) {
+
+    guac_socket_broadcast_data* data =
+        (guac_socket_broadcast_data*) socket->data;
+
+    /* Ensure no instruction is in progress while switching modes */
+    pthread_mutex_lock(&(data->socket_lock));
+
+    if (data->ring == NULL) {
+
+        guac_broadcast_ring* ring = guac_broadcast_ring_alloc(data->client,
+                max_lag, policy);
+
+        /* Readers for existing users must exist before any data is written
+         * to the ring */
+        guac_client_foreach_user(data->client, __add_reader_callback, ring);
+        __atomic_store_n(&data->ring, ring, __ATOMIC_RELEASE);
+
+    }
+
+    pthread_mutex_unlock(&(data->socket_lock));
+    return 0;
+
+}
+
+void guac_socket_broadcast_add_user(guac_socket* socket, guac_user* user) {
+
+    guac_broadcast_ring* ring = guac_socket_broadcast_get_ring(socket);
+    if (ring != NULL)
+        guac_broadcast_ring_add_reader(ring, user);
+
+}
+
+void guac_socket_broadcast_remove_user(guac_socket* socket, guac_user* user) {
+
+    guac_broadcast_ring* ring = guac_socket_broadcast_get_ring(socket);
+    if (ring != NULL)
+        guac_broadcast_ring_remove_reader(ring, user);
+
+}
+
+size_t guac_socket_broadcast_get_lag(guac_socket* socket, guac_user* user) {
+
+    guac_broadcast_ring* ring = guac_socket_broadcast_get_ring(socket);
+    if (ring == NULL)
+        return 0;
+
+    size_t lag = 0;
+
+    pthread_mutex_lock(&(ring->lock));
+
+    for (guac_broadcast_reader* reader = ring->readers; reader != NULL;
+            reader = reader->next) {
+        if (reader->user == user) {
+            lag = __atomic_load_n(&ring->committed, __ATOMIC_RELAXED)
+                - __atomic_load_n(&reader->position, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&(ring->lock));
+    return lag;
+
+}
+
+void guac_socket_broadcast_discard(guac_socket* socket, guac_user* user,
+        guac_socket* target) {
+
+    guac_socket_broadcast_data* data =
+        (guac_socket_broadcast_data*) socket->data;
+
+    guac_broadcast_ring* ring = guac_socket_broadcast_get_ring(socket);
+    if (ring == NULL)
+        return;
+
+    /* Only the reader of the user may reposition that reader */
+    guac_broadcast_reader* reader = NULL;
+    pthread_mutex_lock(&(ring->lock));
+
+    for (guac_broadcast_reader* current = ring->readers; current != NULL;
+            current = current->next) {
+        if (current->user == user) {
+            if (pthread_equal(current->thread, pthread_self()))
+                reader = current;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&(ring->lock));
+
+    if (reader == NULL)
+        return;
+
+    /* Ensure no instruction is in progress, such that all output written
+     * thus far has been committed */
+    pthread_mutex_lock(&(data->socket_lock));
+    guac_broadcast_reader_discard(reader, target);
+    pthread_mutex_unlock(&(data->socket_lock));
+
+}
+
+int guac_socket_broadcast_skips_frames(guac_socket* socket) {
+
+    guac_broadcast_ring* ring = guac_socket_broadcast_get_ring(socket);
+
+    return ring != NULL
+        && ring->policy == GUAC_CLIENT_LAG_RESYNC
+        && ring->client->resync_handler != NULL;
+
+}
@@ -0,0 +1,147 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_SOCKET_BROADCAST_H
+#define GUAC_SOCKET_BROADCAST_H
+
+/**
+ * Provides internal functions for managing the ring mode of the broadcast
+ * socket of a guac_client. This is used only internally within libguac, and
+ * is not installed along with the library.
+ *
+ * @file socket-broadcast.h
+ */
+
+#include "config.h"
+
+#include "guacamole/client.h"
+#include "guacamole/socket.h"
+#include "guacamole/user.h"
+
+#include <stddef.h>
+
+/**
+ * Switches the given broadcast socket into ring mode, starting a reader for
+ * each user currently connected to the associated guac_client. If the socket
+ * is already in ring mode, this function has no effect.
+ *
+ * @see guac_client_enable_broadcast_ring()
+ *
+ * @param socket
+ *     The broadcast socket, as returned by guac_socket_broadcast().
+ *
+ * @param max_lag
+ *     The maximum number of bytes that any one user may fall behind before
+ *     the lag policy is applied to that user.
+ *
+ * @param policy
+ *     The action to take for users that fall too far behind.
+ *
+ * @return
+ *     Zero on success, non-zero if ring mode could not be enabled.
+ */
+int guac_socket_broadcast_enable_ring(guac_socket* socket, size_t max_lag,
+        guac_client_lag_policy policy);
+
+/**
+ * Starts the reader which drains the output of the given broadcast socket
+ * into the socket of the given user. This function has no effect if the
+ * broadcast socket is not in ring mode, or if a reader already exists for
+ * the given user.
+ *
+ * @param socket
+ *     The broadcast socket, as returned by guac_socket_broadcast().
+ *
+ * @param user
+ *     The user that has joined.
+ */
+void guac_socket_broadcast_add_user(guac_socket* socket, guac_user* user);
+
+/**
+ * Stops and frees the reader draining the output of the given broadcast
+ * socket into the socket of the given user, waiting for any write in
+ * progress to complete. This function has no effect if no such reader
+ * exists.
+ *
+ * @param socket
+ *     The broadcast socket, as returned by guac_socket_broadcast().
+ *
+ * @param user
+ *     The user that is leaving.
+ */
+void guac_socket_broadcast_remove_user(guac_socket* socket, guac_user* user);
+
+/**
+ * Returns the number of bytes written to the given broadcast socket which
+ * have not yet been written to the socket of the given user.
+ *
+ * @param socket
+ *     The broadcast socket, as returned by guac_socket_broadcast().
+ *
+ * @param user
+ *     The user whose lag should be determined.
+ *
+ * @return
+ *     The number of bytes not yet written to the given user, or zero if the
+ *     broadcast socket is not in ring mode.
+ */
+size_t guac_socket_broadcast_get_lag(guac_socket* socket, guac_user* user);
+
+/**
+ * Discards all output written to the given broadcast socket which has not
+ * yet been written to the socket of the given user. The discard takes place
+ * while no instruction is being written to the broadcast socket, such that
+ * the user resumes at exactly the point in the output reached at the time of
+ * the call. Only instructions which affect the remote display are dropped.
+ * All other discarded instructions are written to the given target socket.
+ * This function has no effect if the broadcast socket is not in ring mode,
+ * or if invoked by any thread other than the reader of the given user (as is
+ * the case within the client's resync handler).
+ *
+ * @param socket
+ *     The broadcast socket, as returned by guac_socket_broadcast().
+ *
+ * @param user
+ *     The user whose pending output should be discarded.
+ *
+ * @param target
+ *     The socket which should receive all discarded instructions which do
+ *     not affect the remote display. As this socket is written to while
+ *     nothing can be written to the broadcast socket, it should not block.
+ */
+void guac_socket_broadcast_discard(guac_socket* socket, guac_user* user,
+        guac_socket* target);
+
+/**
+ * Returns whether the given broadcast socket skips frames for users whose
+ * processing lag exceeds GUAC_CLIENT_FRAME_SKIP_LAG, resynchronizing those
+ * users once they have caught up. Frames are skipped only if the socket is
+ * in ring mode with the GUAC_CLIENT_LAG_RESYNC lag policy, and the
+ * associated guac_client has a resync_handler.
+ *
+ * @param socket
+ *     The broadcast socket, as returned by guac_socket_broadcast().
+ *
+ * @return
+ *     Non-zero if frames are skipped for lagging users, zero otherwise.
+ */
+int guac_socket_broadcast_skips_frames(guac_socket* socket);
+
+#endif
+
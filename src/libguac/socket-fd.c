@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include "base64.h"
 #include "guacamole/error.h"
 #include "guacamole/socket.h"
 #include "wait-fd.h"
@@ -33,8 +34,28 @@
 
 #ifdef ENABLE_WINSOCK
 #include <winsock2.h>
+#else
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef HAVE_LINUX_SOCKIOS_H
+#include <linux/sockios.h>
 #endif
 
+/**
+ * The maximum number of buffers to provide to a single call to writev() when
+ * writing a vector of buffers.
+ */
+#define GUAC_SOCKET_FD_MAX_VECTOR 16
+
+/**
+ * The number of flushes between each re-evaluation of the size of the output
+ * buffer of a socket whose output buffer is allowed to grow.
+ */
+#define GUAC_SOCKET_FD_ADAPT_INTERVAL 32
+
 /**
  * Data associated with an open socket which writes to a file descriptor.
  */
@@ -54,7 +75,43 @@ typedef struct guac_socket_fd_data {
      * The main write buffer. Bytes written go here before being flushed
      * to the open file descriptor.
      */
-    char out_buf[GUAC_SOCKET_OUTPUT_BUFFER_SIZE];
+    char* out_buf;
+
+    /**
+     * The current size of the main write buffer, in bytes. This will always
+     * be within the range defined by min_buf_size and max_buf_size.
+     */
+    int out_buf_size;
+
+    /**
+     * The smallest size that the main write buffer may shrink to, in bytes.
+     */
+    int min_buf_size;
+
+    /**
+     * The largest size that the main write buffer may grow to, in bytes. If
+     * equal to min_buf_size, the size of the buffer is fixed.
+     */
+    int max_buf_size;
+
+    /**
+     * The number of flushes which have occurred since the size of the main
+     * write buffer was last evaluated.
+     */
+    int flushes;
+
+    /**
+     * The number of flushes which have occurred since the size of the main
+     * write buffer was last evaluated and which were forced due to the buffer
+     * being full.
+     */
+    int full_flushes;
+
+    /**
+     * The largest number of bytes written by any one flush since the size of
+     * the main write buffer was last evaluated.
+     */
+    int max_flush_size;
 
     /**
      * Lock which is acquired when an instruction is being written, and
@@ -115,6 +172,10 @@ ssize_t guac_socket_fd_write(guac_socket* socket,
             return retval;
         }
 
+        /* Record bytes handed to the kernel */
+        __atomic_add_fetch(&socket->__bytes_written, retval,
+                __ATOMIC_RELAXED);
+
         /* Advance buffer to next chunk */
         buffer += retval;
         count  -= retval;
@@ -166,6 +227,119 @@ static ssize_t guac_socket_fd_read_handler(guac_socket* socket,
 
 }
 
+/**
+ * Returns whether data written to the file descriptor associated with the
+ * given socket is backing up within the kernel, as determined by comparing
+ * the number of unsent bytes within the send queue (SIOCOUTQ) against the
+ * size of the send buffer. If this cannot be determined, such as when the
+ * file descriptor is not a socket or SIOCOUTQ is not supported, the file
+ * descriptor is assumed to not be congested.
+ *
+ * @param data
+ *     The data associated with the socket to check.
+ *
+ * @return
+ *     Non-zero if more than half of the kernel send buffer is occupied by
+ *     unsent data, zero otherwise.
+ */
+static int guac_socket_fd_is_congested(guac_socket_fd_data* data) {
+
+#if defined(SIOCOUTQ) && !defined(ENABLE_WINSOCK)
+
+    int queued;
+    int send_buffer_size;
+    socklen_t length = sizeof(send_buffer_size);
+
+    /* Assume no congestion if queue state is unknown */
+    if (ioctl(data->fd, SIOCOUTQ, &queued)
+            || getsockopt(data->fd, SOL_SOCKET, SO_SNDBUF,
+                &send_buffer_size, &length))
+        return 0;
+
+    return queued > send_buffer_size / 2;
+
+#else
+    return 0;
+#endif
+
+}
+
+/**
+ * Records that the given number of bytes has just been flushed from the
+ * output buffer of the given socket, periodically growing or shrinking that
+ * buffer based on the recorded flushes. The buffer is grown if at least half
+ * of all recent flushes were forced by the buffer being full, unless the
+ * kernel send queue is already congested. The buffer is shrunk if no recent
+ * flush used more than a quarter of the buffer, or if the kernel send queue
+ * is congested. This function must ONLY be called if the buffer lock has
+ * already been acquired and the output buffer is empty.
+ *
+ * @param socket
+ *     The guac_socket whose output buffer was just flushed.
+ *
+ * @param length
+ *     The number of bytes flushed.
+ *
+ * @param full
+ *     Non-zero if the flush was forced due to the output buffer being full,
+ *     zero otherwise.
+ */
+static void guac_socket_fd_record_flush(guac_socket* socket,
+        int length, int full) {
+
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+    /* Nothing to adapt if buffer size is fixed */
+    if (data->min_buf_size == data->max_buf_size)
+        return;
+
+    data->flushes++;
+    if (full)
+        data->full_flushes++;
+
+    if (length > data->max_flush_size)
+        data->max_flush_size = length;
+
+    /* Re-evaluate buffer size only periodically */
+    if (data->flushes < GUAC_SOCKET_FD_ADAPT_INTERVAL)
+        return;
+
+    int size = data->out_buf_size;
+    int congested = guac_socket_fd_is_congested(data);
+
+    /* Grow if bursts of data routinely exceed the buffer */
+    if (!congested && data->full_flushes * 2 >= data->flushes)
+        size *= 2;
+
+    /* Shrink if most of the buffer is going unused, or if a larger buffer
+     * would only add to data already waiting within the kernel */
+    else if (congested || data->max_flush_size * 4 <= size)
+        size /= 2;
+
+    /* Limit to configured range */
+    if (size > data->max_buf_size)
+        size = data->max_buf_size;
+    else if (size < data->min_buf_size)
+        size = data->min_buf_size;
+
+    /* Reallocate buffer if size has changed (the buffer is empty, thus no
+     * data needs to be copied) */
+    if (size != data->out_buf_size) {
+        char* out_buf = malloc(size);
+        if (out_buf != NULL) {
+            free(data->out_buf);
+            data->out_buf = out_buf;
+            data->out_buf_size = size;
+        }
+    }
+
+    /* Begin new evaluation period */
+    data->flushes = 0;
+    data->full_flushes = 0;
+    data->max_flush_size = 0;
+
+}
+
 /**
  * Flushes the contents of the output buffer of the given socket immediately,
  * without first locking access to the output buffer. This function must ONLY
@@ -184,11 +358,18 @@ static ssize_t guac_socket_fd_flush(guac_socket* socket) {
     /* Flush remaining bytes in buffer */
     if (data->written > 0) {
 
+        int length = data->written;
+
         /* Write ALL bytes in buffer immediately */
-        if (guac_socket_fd_write(socket, data->out_buf, data->written))
+        if (guac_socket_fd_write(socket, data->out_buf, length))
             return 1;
 
         data->written = 0;
+
+        /* Consider the buffer full if not even one more base64 group fits */
+        guac_socket_fd_record_flush(socket, length,
+                data->out_buf_size - length < 4);
+
     }
 
     return 0;
@@ -223,6 +404,166 @@ static ssize_t guac_socket_fd_flush_handler(guac_socket* socket) {
 
 }
 
+#ifndef ENABLE_WINSOCK
+/**
+ * Writes the entire contents of the given array of buffers to the file
+ * descriptor associated with the given socket using writev(), retrying as
+ * necessary until all buffers are written, and aborting if an error occurs.
+ * The contents of the given array are modified as data is written.
+ *
+ * @param socket
+ *     The guac_socket associated with the file descriptor to which the given
+ *     buffers should be written.
+ *
+ * @param iov
+ *     The array of buffers to write. The elements of this array will be
+ *     modified to track partial writes.
+ *
+ * @param iovcnt
+ *     The number of buffers within the given array.
+ *
+ * @return
+ *     Zero if all buffers were written successfully, or a negative value if
+ *     an error occurs.
+ */
+static ssize_t guac_socket_fd_writev(guac_socket* socket,
+        struct iovec* iov, int iovcnt) {
+
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+    /* Write until completely written */
+    while (iovcnt > 0) {
+
+        ssize_t retval = writev(data->fd, iov, iovcnt);
+
+        /* Record errors in guac_error */
+        if (retval < 0) {
+            guac_error = GUAC_STATUS_SEE_ERRNO;
+            guac_error_message = "Error writing data to socket";
+            return retval;
+        }
+
+        /* Record bytes handed to the kernel */
+        __atomic_add_fetch(&socket->__bytes_written, retval,
+                __ATOMIC_RELAXED);
+
+        /* Skip past all buffers which were written completely */
+        while (iovcnt > 0 && (size_t) retval >= iov->iov_len) {
+            retval -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        /* Advance within any partially-written buffer */
+        if (iovcnt > 0) {
+            iov->iov_base = (char*) iov->iov_base + retval;
+            iov->iov_len -= retval;
+        }
+
+    }
+
+    return 0;
+
+}
+#endif
+
+/**
+ * Writes the given vector of buffers to the given socket, without first
+ * locking access to the output buffer. If all buffers fit within the space
+ * remaining in the output buffer, they are simply appended to the output
+ * buffer. Otherwise, the contents of the output buffer and all given buffers
+ * are written directly with writev(), avoiding any copies. This function must
+ * ONLY be called if the buffer lock has already been acquired.
+ *
+ * @param socket
+ *     The guac_socket to write the given buffers to.
+ *
+ * @param vector
+ *     The array of buffers to write, in order.
+ *
+ * @param count
+ *     The number of buffers within the array.
+ *
+ * @return
+ *     The total number of bytes written, or a negative value if an error
+ *     occurs during write.
+ */
+static ssize_t guac_socket_fd_write_vector_buffered(guac_socket* socket,
+        const guac_socket_vector* vector, int count) {
+
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+    size_t total = 0;
+    for (int i = 0; i < count; i++)
+        total += vector[i].length;
+
+    /* Simply append to output buffer if everything fits */
+    if (total <= (size_t) (data->out_buf_size - data->written)) {
+
+        for (int i = 0; i < count; i++) {
+            memcpy(data->out_buf + data->written,
+                    vector[i].buffer, vector[i].length);
+            data->written += vector[i].length;
+        }
+
+        return total;
+
+    }
+
+#ifdef ENABLE_WINSOCK
+
+    /* WSA lacks writev(), so pending data and each buffer must be sent
+     * separately */
+    if (guac_socket_fd_flush(socket))
+        return -1;
+
+    for (int i = 0; i < count; i++) {
+        if (guac_socket_fd_write(socket, vector[i].buffer, vector[i].length))
+            return -1;
+    }
+
+#else
+
+    /* Otherwise, write pending data along with all given buffers, using as
+     * few calls to writev() as possible */
+    while (count > 0) {
+
+        struct iovec iov[GUAC_SOCKET_FD_MAX_VECTOR];
+        int iovcnt = 0;
+
+        /* Pending data must be written first */
+        if (data->written > 0) {
+            iov[iovcnt].iov_base = data->out_buf;
+            iov[iovcnt].iov_len  = data->written;
+            iovcnt++;
+        }
+
+        /* Add as many of the given buffers as possible */
+        while (count > 0 && iovcnt < GUAC_SOCKET_FD_MAX_VECTOR) {
+            iov[iovcnt].iov_base = (void*) vector->buffer;
+            iov[iovcnt].iov_len  = vector->length;
+            iovcnt++;
+            vector++;
+            count--;
+        }
+
+        if (guac_socket_fd_writev(socket, iov, iovcnt))
+            return -1;
+
+        data->written = 0;
+
+    }
+
+    /* Data which does not fit within the buffer is equivalent to a full
+     * buffer for the sake of buffer sizing */
+    guac_socket_fd_record_flush(socket, total, 1);
+
+#endif
+
+    return total;
+
+}
+
 /**
  * Writes the contents of the buffer to the output buffer of the given socket,
  * flushing the output buffer as necessary, without first locking access to the
@@ -249,11 +590,18 @@ static ssize_t guac_socket_fd_write_buffered(guac_socket* socket,
     const char* current = buf;
     guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
 
+    /* Write blocks of data at least as large as the output buffer directly,
+     * rather than copying them through the output buffer piece by piece */
+    if (count >= (size_t) data->out_buf_size) {
+        guac_socket_vector vector = { buf, count };
+        return guac_socket_fd_write_vector_buffered(socket, &vector, 1);
+    }
+
     /* Append to buffer, flush if necessary */
     while (count > 0) {
 
         int chunk_size;
-        int remaining = sizeof(data->out_buf) - data->written;
+        int remaining = data->out_buf_size - data->written;
 
         /* If no space left in buffer, flush and retry */
         if (remaining == 0) {
@@ -323,6 +671,110 @@ static ssize_t guac_socket_fd_write_handler(guac_socket* socket,
 
 }
 
+/**
+ * Writes the given vector of buffers to the given socket, appending the
+ * buffers to the internal buffer if they fit, and otherwise writing them
+ * along with any pending data using writev().
+ *
+ * @param socket
+ *     The guac_socket being written to.
+ *
+ * @param vector
+ *     The array of buffers to write, in order.
+ *
+ * @param count
+ *     The number of buffers within the array.
+ *
+ * @return
+ *     The total number of bytes written, or -1 if an error occurs.
+ */
+static ssize_t guac_socket_fd_write_vector_handler(guac_socket* socket,
+        const guac_socket_vector* vector, int count) {
+
+    int retval;
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+    /* Acquire exclusive access to buffer */
+    pthread_mutex_lock(&(data->buffer_lock));
+
+    /* Write provided buffers */
+    retval = guac_socket_fd_write_vector_buffered(socket, vector, count);
+
+    /* Relinquish exclusive access to buffer */
+    pthread_mutex_unlock(&(data->buffer_lock));
+
+    return retval;
+
+}
+
+/**
+ * Encodes the provided binary data as base64 directly into the internal
+ * buffer for future writing, avoiding any intermediate copy of the encoded
+ * data. The actual write attempt will occur only upon flush, or when the
+ * internal buffer is full.
+ *
+ * @param socket
+ *     The guac_socket being written to.
+ *
+ * @param buf
+ *     The arbitrary buffer containing the binary data to be encoded.
+ *
+ * @param count
+ *     The number of bytes contained within the buffer. This will always be
+ *     a multiple of three.
+ *
+ * @return
+ *     The number of bytes encoded, or -1 if an error occurs.
+ */
+static ssize_t guac_socket_fd_write_base64_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    size_t original_count = count;
+    const unsigned char* current = buf;
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+    /* Acquire exclusive access to buffer */
+    pthread_mutex_lock(&(data->buffer_lock));
+
+    /* Encode into buffer, flushing as necessary */
+    while (count > 0) {
+
+        /* Only complete groups of four characters may be encoded */
+        size_t chunk_size = (data->out_buf_size - data->written) / 4 * 3;
+
+        /* If no space left in buffer, flush and retry */
+        if (chunk_size == 0) {
+
+            /* Abort if error occurs during flush */
+            if (guac_socket_fd_flush(socket)) {
+                pthread_mutex_unlock(&(data->buffer_lock));
+                return -1;
+            }
+
+            /* Retry buffer append */
+            continue;
+
+        }
+
+        if (chunk_size > count)
+            chunk_size = count;
+
+        /* Encode chunk directly into output buffer */
+        data->written += guac_base64_encode(current, chunk_size,
+                data->out_buf + data->written);
+
+        current += chunk_size;
+        count   -= chunk_size;
+
+    }
+
+    /* Relinquish exclusive access to buffer */
+    pthread_mutex_unlock(&(data->buffer_lock));
+
+    return original_count;
+
+}
+
 /**
  * Waits for data on the underlying file desriptor of the given socket to
  * become available such that the next read operation will not block.
@@ -360,6 +812,72 @@ static int guac_socket_fd_select_handler(guac_socket* socket,
 
 }
 
+/**
+ * Returns the number of bytes written to the given socket which have not yet
+ * been delivered, consisting of the contents of the main write buffer plus
+ * any data within the kernel send queue which has not yet been acknowledged
+ * by the remote end (SIOCOUTQ). If the state of the kernel send queue cannot
+ * be determined, only the contents of the main write buffer are counted.
+ *
+ * The kernel send queue is that of the file descriptor itself. Within
+ * guacd's connection processes, this is the local socket connected to guacd
+ * rather than the client's network connection, so the queue only grows once
+ * guacd is itself unable to relay data to the client.
+ *
+ * @param socket
+ *     The guac_socket to query.
+ *
+ * @return
+ *     The number of undelivered bytes.
+ */
+static int guac_socket_fd_queued_handler(guac_socket* socket) {
+
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+    int queued = __atomic_load_n(&data->written, __ATOMIC_RELAXED);
+
+#if defined(SIOCOUTQ) && !defined(ENABLE_WINSOCK)
+    int kernel_queued;
+    if (!ioctl(data->fd, SIOCOUTQ, &kernel_queued) && kernel_queued > 0)
+        queued += kernel_queued;
+#endif
+
+    return queued;
+
+}
+
+/**
+ * Shuts down both directions of the connection associated with the file
+ * descriptor of the given socket, causing any read or write blocked on that
+ * file descriptor to fail. The file descriptor itself remains open until the
+ * socket is freed.
+ *
+ * @param socket
+ *     The guac_socket to shut down.
+ *
+ * @return
+ *     Zero on success, non-zero if the file descriptor could not be shut
+ *     down, such as when it is not a socket.
+ */
+static int guac_socket_fd_shutdown_handler(guac_socket* socket) {
+
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+#ifdef ENABLE_WINSOCK
+    int retval = shutdown(data->fd, SD_BOTH);
+#else
+    int retval = shutdown(data->fd, SHUT_RDWR);
+#endif
+
+    /* Record errors in guac_error */
+    if (retval) {
+        guac_error = GUAC_STATUS_SEE_ERRNO;
+        guac_error_message = "Error shutting down socket";
+    }
+
+    return retval;
+
+}
+
 /**
  * Frees all implementation-specific data associated with the given socket, but
  * not the socket object itself.
@@ -382,6 +900,7 @@ static int guac_socket_fd_free_handler(guac_socket* socket) {
     /* Close file descriptor */
     close(data->fd);
 
+    free(data->out_buf);
     free(data);
     return 0;
 
@@ -418,18 +937,52 @@ static void guac_socket_fd_unlock_handler(guac_socket* socket) {
 }
 
 guac_socket* guac_socket_open(int fd) {
+    return guac_socket_open_buffered(fd, GUAC_SOCKET_OUTPUT_BUFFER_SIZE,
+            GUAC_SOCKET_OUTPUT_BUFFER_SIZE);
+}
+
+guac_socket* guac_socket_open_buffered(int fd, int buffer_size,
+        int max_buffer_size) {
 
     pthread_mutexattr_t lock_attributes;
 
+    /* Sanitize buffer size limits */
+    if (buffer_size <= 0)
+        buffer_size = GUAC_SOCKET_OUTPUT_BUFFER_SIZE;
+
+    if (max_buffer_size < buffer_size)
+        max_buffer_size = buffer_size;
+
     /* Allocate socket and associated data */
     guac_socket* socket = guac_socket_alloc();
+    if (socket == NULL)
+        return NULL;
+
     guac_socket_fd_data* data = malloc(sizeof(guac_socket_fd_data));
+    char* out_buf = malloc(buffer_size);
+    if (data == NULL || out_buf == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Could not allocate socket output buffer";
+        free(out_buf);
+        free(data);
+        free(socket);
+        return NULL;
+    }
 
     /* Store file descriptor as socket data */
     data->fd = fd;
     data->written = 0;
     socket->data = data;
 
+    /* Init output buffer, which begins at its minimum size */
+    data->out_buf = out_buf;
+    data->out_buf_size = buffer_size;
+    data->min_buf_size = buffer_size;
+    data->max_buf_size = max_buffer_size;
+    data->flushes = 0;
+    data->full_flushes = 0;
+    data->max_flush_size = 0;
+
     pthread_mutexattr_init(&lock_attributes);
     pthread_mutexattr_setpshared(&lock_attributes, PTHREAD_PROCESS_SHARED);
 
@@ -438,13 +991,17 @@ guac_socket* guac_socket_open(int fd) {
     pthread_mutex_init(&(data->buffer_lock), &lock_attributes);
     
     /* Set read/write handlers */
-    socket->read_handler   = guac_socket_fd_read_handler;
-    socket->write_handler  = guac_socket_fd_write_handler;
-    socket->select_handler = guac_socket_fd_select_handler;
-    socket->lock_handler   = guac_socket_fd_lock_handler;
-    socket->unlock_handler = guac_socket_fd_unlock_handler;
-    socket->flush_handler  = guac_socket_fd_flush_handler;
-    socket->free_handler   = guac_socket_fd_free_handler;
+    socket->read_handler         = guac_socket_fd_read_handler;
+    socket->write_handler        = guac_socket_fd_write_handler;
+    socket->write_base64_handler = guac_socket_fd_write_base64_handler;
+    socket->write_vector_handler = guac_socket_fd_write_vector_handler;
+    socket->select_handler       = guac_socket_fd_select_handler;
+    socket->lock_handler         = guac_socket_fd_lock_handler;
+    socket->unlock_handler       = guac_socket_fd_unlock_handler;
+    socket->flush_handler        = guac_socket_fd_flush_handler;
+    socket->free_handler         = guac_socket_fd_free_handler;
+    socket->queued_handler       = guac_socket_fd_queued_handler;
+    socket->shutdown_handler     = guac_socket_fd_shutdown_handler;
 
     return socket;
 
@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include "base64.h"
 #include "guacamole/error.h"
 #include "guacamole/protocol.h"
 #include "guacamole/socket.h"
@@ -117,6 +118,25 @@ ssize_t guac_socket_write(guac_socket* socket,
 
 }
 
+ssize_t guac_socket_write_vector(guac_socket* socket,
+        const guac_socket_vector* vector, int count) {
+
+    /* Use vectored write handler, if defined */
+    if (socket->write_vector_handler) {
+        socket->last_write_timestamp = guac_timestamp_current();
+        return socket->write_vector_handler(socket, vector, count) < 0;
+    }
+
+    /* Otherwise, write each buffer in order */
+    for (int i = 0; i < count; i++) {
+        if (guac_socket_write(socket, vector[i].buffer, vector[i].length))
+            return 1;
+    }
+
+    return 0;
+
+}
+
 ssize_t guac_socket_read(guac_socket* socket, void* buf, size_t count) {
 
     /* If handler defined, call it. */
@@ -139,6 +159,34 @@ int guac_socket_select(guac_socket* socket, int usec_timeout) {
 
 }
 
+uint64_t guac_socket_get_bytes_written(guac_socket* socket) {
+    return __atomic_load_n(&socket->__bytes_written, __ATOMIC_RELAXED);
+}
+
+int guac_socket_get_queued(guac_socket* socket) {
+
+    /* Call queued handler if defined */
+    if (socket->queued_handler)
+        return socket->queued_handler(socket);
+
+    /* Otherwise, the amount of undelivered data is unknown */
+    return -1;
+
+}
+
+int guac_socket_shutdown(guac_socket* socket) {
+
+    /* Call shutdown handler if defined */
+    if (socket->shutdown_handler)
+        return socket->shutdown_handler(socket);
+
+    /* Otherwise, the socket cannot be shut down */
+    guac_error = GUAC_STATUS_NOT_SUPPORTED;
+    guac_error_message = "Socket cannot be shut down";
+    return -1;
+
+}
+
 guac_socket* guac_socket_alloc() {
 
     guac_socket* socket = malloc(sizeof(guac_socket));
@@ -154,18 +202,23 @@ guac_socket* guac_socket_alloc() {
     socket->data = NULL;
     socket->state = GUAC_SOCKET_OPEN;
     socket->last_write_timestamp = guac_timestamp_current();
+    socket->__bytes_written = 0;
 
     /* No keep alive ping by default */
     socket->__keep_alive_enabled = 0;
 
     /* No handlers yet */
-    socket->read_handler   = NULL;
-    socket->write_handler  = NULL;
-    socket->select_handler = NULL;
-    socket->free_handler   = NULL;
-    socket->flush_handler  = NULL;
-    socket->lock_handler   = NULL;
-    socket->unlock_handler = NULL;
+    socket->read_handler         = NULL;
+    socket->write_handler        = NULL;
+    socket->write_base64_handler = NULL;
+    socket->write_vector_handler = NULL;
+    socket->select_handler       = NULL;
+    socket->free_handler         = NULL;
+    socket->flush_handler        = NULL;
+    socket->lock_handler         = NULL;
+    socket->unlock_handler       = NULL;
+    socket->queued_handler       = NULL;
+    socket->shutdown_handler     = NULL;
 
     return socket;
 
@@ -323,6 +376,57 @@ ssize_t __guac_socket_write_base64_byte(guac_socket* socket, int buf) {
     return 1;
 }
 
+/**
+ * Writes the given binary data to the given guac_socket as base64, encoding
+ * the data in bulk. The number of bytes provided MUST be a multiple of three,
+ * and the base64 "ready" buffer of the socket MUST be empty. If the socket
+ * provides a write_base64_handler, that handler is used to write the data.
+ * Otherwise, the data is encoded in chunks of GUAC_SOCKET_BASE64_CHUNK_SIZE
+ * bytes, with each encoded chunk written using guac_socket_write().
+ *
+ * @param socket
+ *     The guac_socket to write the given data to.
+ *
+ * @param buf
+ *     A buffer containing the data to write.
+ *
+ * @param count
+ *     The number of bytes to write. This MUST be a multiple of three.
+ *
+ * @return
+ *     Zero on success, or non-zero if an error occurs while writing.
+ */
+static int __guac_socket_write_base64_bulk(guac_socket* socket,
+        const unsigned char* buf, size_t count) {
+
+    /* Allow the socket implementation to encode directly, if supported */
+    if (socket->write_base64_handler) {
+        socket->last_write_timestamp = guac_timestamp_current();
+        return socket->write_base64_handler(socket, buf, count) < 0;
+    }
+
+    char encoded[GUAC_BASE64_ENCODED_LENGTH(GUAC_SOCKET_BASE64_CHUNK_SIZE)];
+
+    /* Otherwise, encode and write one chunk at a time */
+    while (count > 0) {
+
+        size_t chunk_size = count;
+        if (chunk_size > GUAC_SOCKET_BASE64_CHUNK_SIZE)
+            chunk_size = GUAC_SOCKET_BASE64_CHUNK_SIZE;
+
+        size_t length = guac_base64_encode(buf, chunk_size, encoded);
+        if (guac_socket_write(socket, encoded, length))
+            return 1;
+
+        buf   += chunk_size;
+        count -= chunk_size;
+
+    }
+
+    return 0;
+
+}
+
 ssize_t guac_socket_write_base64(guac_socket* socket, const void* buf, size_t count) {
 
     int retval;
@@ -330,6 +434,27 @@ ssize_t guac_socket_write_base64(guac_socket* socket, const void* buf, size_t co
     const unsigned char* char_buf = (const unsigned char*) buf;
     const unsigned char* end = char_buf + count;
 
+    /* Complete any partial triplet left over from a previous write */
+    while (socket->__ready > 0 && char_buf < end) {
+
+        retval = __guac_socket_write_base64_byte(socket, *(char_buf++));
+        if (retval < 0)
+            return retval;
+
+    }
+
+    /* Encode all remaining complete triplets at once */
+    size_t bulk_size = (end - char_buf) - (end - char_buf) % 3;
+    if (bulk_size > 0) {
+
+        if (__guac_socket_write_base64_bulk(socket, char_buf, bulk_size))
+            return -1;
+
+        char_buf += bulk_size;
+
+    }
+
+    /* Buffer any trailing partial triplet */
     while (char_buf < end) {
 
         retval = __guac_socket_write_base64_byte(socket, *(char_buf++));
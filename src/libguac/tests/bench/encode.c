@@ -0,0 +1,296 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Microbenchmark measuring the time taken to encode PNG, JPEG and WebP images
+ * and the number of heap allocations made per image once the encoders have
+ * warmed up. Allocations are counted only where the C library permits
+ * malloc() and friends to be wrapped (glibc). This program is not run as part
+ * of "make check", and must be built explicitly with "make bench_encode".
+ */
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * The width of each benchmark image, in pixels.
+ */
+#define BENCH_ENCODE_WIDTH 256
+
+/**
+ * The height of each benchmark image, in pixels.
+ */
+#define BENCH_ENCODE_HEIGHT 256
+
+/**
+ * The number of times each image is encoded prior to measurement, allowing
+ * any reusable encoder state to be allocated.
+ */
+#define BENCH_ENCODE_WARMUP 5
+
+/**
+ * The number of times each image is encoded while measuring.
+ */
+#define BENCH_ENCODE_ITERATIONS 50
+
+/**
+ * The total number of calls to malloc(), calloc() and realloc() made by this
+ * process so far.
+ */
+static size_t bench_allocations = 0;
+
+#ifdef __GLIBC__
+
+/* The underlying glibc allocator, wrapped below to count allocations */
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    __atomic_add_fetch(&bench_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+    __atomic_add_fetch(&bench_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    __atomic_add_fetch(&bench_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+#endif
+
+/**
+ * Returns the current value of the monotonic clock, in nanoseconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in nanoseconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * Write handler for the benchmark socket which discards all data, counting
+ * the number of bytes written.
+ *
+ * @param socket
+ *     The socket being written to, whose data points to the byte counter.
+ *
+ * @param buf
+ *     The data being written.
+ *
+ * @param count
+ *     The number of bytes being written.
+ *
+ * @return
+ *     The number of bytes written, which is always count.
+ */
+static ssize_t bench_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+    *((size_t*) socket->data) += count;
+    return count;
+}
+
+/**
+ * Fills the given RGB24 surface with content having few colors, such that
+ * PNG encoding will use a palette.
+ *
+ * @param surface
+ *     The surface to fill.
+ */
+static void bench_fill_flat(cairo_surface_t* surface) {
+
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+
+    for (int y = 0; y < BENCH_ENCODE_HEIGHT; y++) {
+        uint32_t* pixels = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < BENCH_ENCODE_WIDTH; x++)
+            pixels[x] = ((x / 16 + y / 16) % 4) * 0x404040;
+    }
+
+    cairo_surface_mark_dirty(surface);
+
+}
+
+/**
+ * Fills the given RGB24 surface with photographic content: smooth gradients
+ * with a small amount of noise, containing far more than 256 colors.
+ *
+ * @param surface
+ *     The surface to fill.
+ */
+static void bench_fill_photo(cairo_surface_t* surface) {
+
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+
+    srand(2);
+    for (int y = 0; y < BENCH_ENCODE_HEIGHT; y++) {
+        uint32_t* pixels = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < BENCH_ENCODE_WIDTH; x++) {
+            int noise = rand() % 8;
+            int red   = (x + noise) & 0xFF;
+            int green = (y + noise) & 0xFF;
+            int blue  = ((x + y) / 2 + noise) & 0xFF;
+            pixels[x] = (red << 16) | (green << 8) | blue;
+        }
+    }
+
+    cairo_surface_mark_dirty(surface);
+
+}
+
+/**
+ * The image formats exercised by this benchmark.
+ */
+typedef enum bench_format {
+    BENCH_FORMAT_PNG,
+    BENCH_FORMAT_JPEG,
+    BENCH_FORMAT_WEBP
+} bench_format;
+
+/**
+ * Sends the given surface as a single image of the given format.
+ *
+ * @param client
+ *     The client to use to allocate streams.
+ *
+ * @param socket
+ *     The socket to send the image over.
+ *
+ * @param format
+ *     The image format to use.
+ *
+ * @param surface
+ *     The surface to send.
+ */
+static void bench_send(guac_client* client, guac_socket* socket,
+        bench_format format, cairo_surface_t* surface) {
+
+    switch (format) {
+
+        case BENCH_FORMAT_PNG:
+            guac_client_stream_png(client, socket, GUAC_COMP_OVER,
+                    GUAC_DEFAULT_LAYER, 0, 0, surface);
+            break;
+
+        case BENCH_FORMAT_JPEG:
+            guac_client_stream_jpeg(client, socket, GUAC_COMP_OVER,
+                    GUAC_DEFAULT_LAYER, 0, 0, surface, 80);
+            break;
+
+        case BENCH_FORMAT_WEBP:
+            guac_client_stream_webp(client, socket, GUAC_COMP_OVER,
+                    GUAC_DEFAULT_LAYER, 0, 0, surface, 80, 0);
+            break;
+
+    }
+
+}
+
+/**
+ * Encodes the given surface repeatedly using the given format, printing the
+ * average time taken, the average number of allocations, and the size of
+ * the output.
+ *
+ * @param client
+ *     The client to use to allocate streams.
+ *
+ * @param socket
+ *     The benchmark socket, whose data points to the byte counter.
+ *
+ * @param name
+ *     A human-readable name for the format and content being encoded.
+ *
+ * @param format
+ *     The image format to use.
+ *
+ * @param surface
+ *     The surface to encode.
+ */
+static void bench_encode(guac_client* client, guac_socket* socket,
+        const char* name, bench_format format, cairo_surface_t* surface) {
+
+    size_t* written = (size_t*) socket->data;
+
+    for (int i = 0; i < BENCH_ENCODE_WARMUP; i++)
+        bench_send(client, socket, format, surface);
+
+    *written = 0;
+    size_t allocations = bench_allocations;
+
+    double start = bench_now();
+    for (int i = 0; i < BENCH_ENCODE_ITERATIONS; i++)
+        bench_send(client, socket, format, surface);
+    double elapsed = (bench_now() - start) / BENCH_ENCODE_ITERATIONS;
+
+    allocations = bench_allocations - allocations;
+
+    printf("%-12s %8.3f ms/image %8.1f allocs/image %8zu bytes/image\n",
+            name, elapsed / 1e6,
+            (double) allocations / BENCH_ENCODE_ITERATIONS,
+            *written / BENCH_ENCODE_ITERATIONS);
+
+}
+
+int main(int argc, char** argv) {
+
+    size_t written = 0;
+
+    guac_client* client = guac_client_alloc();
+    guac_socket* socket = guac_socket_alloc();
+    socket->data = &written;
+    socket->write_handler = bench_write_handler;
+
+    cairo_surface_t* flat = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            BENCH_ENCODE_WIDTH, BENCH_ENCODE_HEIGHT);
+    cairo_surface_t* photo = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            BENCH_ENCODE_WIDTH, BENCH_ENCODE_HEIGHT);
+
+    bench_fill_flat(flat);
+    bench_fill_photo(photo);
+
+    bench_encode(client, socket, "png/flat",   BENCH_FORMAT_PNG,  flat);
+    bench_encode(client, socket, "png/photo",  BENCH_FORMAT_PNG,  photo);
+    bench_encode(client, socket, "jpeg/photo", BENCH_FORMAT_JPEG, photo);
+    bench_encode(client, socket, "webp/photo", BENCH_FORMAT_WEBP, photo);
+
+    cairo_surface_destroy(flat);
+    cairo_surface_destroy(photo);
+
+    guac_socket_free(socket);
+    guac_client_free(client);
+
+    return 0;
+
+}
@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Microbenchmark comparing opcode lookup via guac_opcode_index against the
+ * linear strcmp() scan previously used for instruction dispatch. This
+ * program is not run as part of "make check", and must be built explicitly
+ * with "make bench_opcode".
+ */
+
+#include <guacamole/opcode.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The number of lookups to perform for each method.
+ */
+#define BENCH_OPCODE_ITERATIONS 20000000
+
+/**
+ * Every opcode dispatched by libguac for connected users, in the same order
+ * as libguac's own instruction handler map.
+ */
+static const char* bench_opcodes[] = {
+    "sync", "touch", "mouse", "key", "clipboard", "disconnect", "size",
+    "file", "pipe", "ack", "blob", "end", "get", "put", "audio", "argv",
+    "nop", NULL
+};
+
+/**
+ * A representative stream of received opcodes, dominated by input events
+ * and acknowledgements, and including an opcode which is not handled.
+ */
+static const char* bench_stream[] = {
+    "mouse", "mouse", "mouse", "sync", "key", "key", "mouse", "ack",
+    "blob", "ack", "mouse", "sync", "nop", "size", "argv", "unknown"
+};
+
+/**
+ * Returns the current value of the monotonic clock, in nanoseconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in nanoseconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * Returns the position of the given opcode within bench_opcodes using a
+ * linear scan, as instruction dispatch did prior to guac_opcode_index.
+ *
+ * @param opcode
+ *     The opcode to search for.
+ *
+ * @return
+ *     The position of the given opcode, or -1 if not found.
+ */
+static int bench_linear_find(const char* opcode) {
+
+    for (int i = 0; bench_opcodes[i] != NULL; i++) {
+        if (strcmp(bench_opcodes[i], opcode) == 0)
+            return i;
+    }
+
+    return -1;
+
+}
+
+int main(int argc, char** argv) {
+
+    int stream_length = sizeof(bench_stream) / sizeof(bench_stream[0]);
+    long checksum = 0;
+
+    guac_opcode_index* index = guac_opcode_index_alloc(bench_opcodes,
+            sizeof(const char*));
+    if (index == NULL) {
+        fprintf(stderr, "Unable to build opcode index.\n");
+        return 1;
+    }
+
+    /* Time linear scan */
+    double start = bench_now();
+    for (int i = 0; i < BENCH_OPCODE_ITERATIONS; i++)
+        checksum += bench_linear_find(bench_stream[i % stream_length]);
+    double linear = (bench_now() - start) / BENCH_OPCODE_ITERATIONS;
+
+    /* Time perfect hash lookup */
+    start = bench_now();
+    for (int i = 0; i < BENCH_OPCODE_ITERATIONS; i++)
+        checksum -= guac_opcode_index_find(index,
+                bench_stream[i % stream_length]);
+    double hashed = (bench_now() - start) / BENCH_OPCODE_ITERATIONS;
+
+    guac_opcode_index_free(index);
+
+    /* Both methods must produce identical results */
+    if (checksum != 0) {
+        fprintf(stderr, "Lookup results differ between methods.\n");
+        return 1;
+    }
+
+    printf("linear scan:  %6.2f ns/lookup\n", linear);
+    printf("opcode index: %6.2f ns/lookup\n", hashed);
+    printf("speedup:      %6.2fx\n", linear / hashed);
+
+    return 0;
+
+}
+
@@ -0,0 +1,278 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Microbenchmark measuring the time taken to encode PNG images and the size
+ * of the resulting data, for text-like and photographic content, at several
+ * zlib compression levels and row filters. This program is not run as part
+ * of "make check", and must be built explicitly with "make bench_png".
+ */
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * The width of each benchmark image, in pixels.
+ */
+#define BENCH_PNG_WIDTH 640
+
+/**
+ * The height of each benchmark image, in pixels.
+ */
+#define BENCH_PNG_HEIGHT 384
+
+/**
+ * The number of times each image is encoded for each configuration.
+ */
+#define BENCH_PNG_ITERATIONS 50
+
+/**
+ * The number of distinct glyphs used to render text-like images.
+ */
+#define BENCH_PNG_GLYPHS 96
+
+/**
+ * The width of each glyph, in pixels.
+ */
+#define BENCH_PNG_GLYPH_WIDTH 8
+
+/**
+ * The height of each glyph, in pixels.
+ */
+#define BENCH_PNG_GLYPH_HEIGHT 16
+
+/**
+ * Returns the current value of the monotonic clock, in nanoseconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in nanoseconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * Write handler for the benchmark socket which discards all data, counting
+ * the number of bytes written.
+ *
+ * @param socket
+ *     The socket being written to, whose data points to the byte counter.
+ *
+ * @param buf
+ *     The data being written.
+ *
+ * @param count
+ *     The number of bytes being written.
+ *
+ * @return
+ *     The number of bytes written, which is always count.
+ */
+static ssize_t bench_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+    *((size_t*) socket->data) += count;
+    return count;
+}
+
+/**
+ * Fills the given RGB24 surface with text-like content: rows of glyphs drawn
+ * from a small random set, using a few shades of gray to approximate
+ * antialiasing, over a solid background.
+ *
+ * @param surface
+ *     The surface to fill.
+ */
+static void bench_fill_text(cairo_surface_t* surface) {
+
+    static const uint32_t shades[] = {
+        0xFFFFFF, 0xAAAAAA, 0x555555, 0x000000
+    };
+
+    unsigned char glyphs[BENCH_PNG_GLYPHS]
+        [BENCH_PNG_GLYPH_HEIGHT][BENCH_PNG_GLYPH_WIDTH];
+
+    /* Generate random glyph shapes, leaving blank margins */
+    srand(1);
+    for (int g = 0; g < BENCH_PNG_GLYPHS; g++) {
+        for (int y = 0; y < BENCH_PNG_GLYPH_HEIGHT; y++) {
+            for (int x = 0; x < BENCH_PNG_GLYPH_WIDTH; x++) {
+                int margin = x == 0 || y < 3 || y > 12;
+                glyphs[g][y][x] = margin ? 0 : rand() % 4;
+            }
+        }
+    }
+
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+
+    /* Draw lines of text of varying length */
+    for (int row = 0; row < BENCH_PNG_HEIGHT / BENCH_PNG_GLYPH_HEIGHT; row++) {
+
+        int length = rand() % (BENCH_PNG_WIDTH / BENCH_PNG_GLYPH_WIDTH);
+
+        for (int col = 0; col < BENCH_PNG_WIDTH / BENCH_PNG_GLYPH_WIDTH;
+                col++) {
+
+            int glyph = (col < length && rand() % 6) ? rand()
+                % BENCH_PNG_GLYPHS : -1;
+
+            for (int y = 0; y < BENCH_PNG_GLYPH_HEIGHT; y++) {
+
+                uint32_t* pixels = (uint32_t*) (data
+                        + (row * BENCH_PNG_GLYPH_HEIGHT + y) * stride)
+                        + col * BENCH_PNG_GLYPH_WIDTH;
+
+                for (int x = 0; x < BENCH_PNG_GLYPH_WIDTH; x++)
+                    pixels[x] = glyph < 0 ? shades[0]
+                        : shades[glyphs[glyph][y][x]];
+
+            }
+
+        }
+
+    }
+
+    cairo_surface_mark_dirty(surface);
+
+}
+
+/**
+ * Fills the given RGB24 surface with photographic content: smooth gradients
+ * with a small amount of noise, containing far more than 256 colors.
+ *
+ * @param surface
+ *     The surface to fill.
+ */
+static void bench_fill_photo(cairo_surface_t* surface) {
+
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+
+    srand(2);
+    for (int y = 0; y < BENCH_PNG_HEIGHT; y++) {
+        uint32_t* pixels = (uint32_t*) (data + y * stride);
+        for (int x = 0; x < BENCH_PNG_WIDTH; x++) {
+            int noise = rand() % 8;
+            int red   = (x * 255 / BENCH_PNG_WIDTH + noise) & 0xFF;
+            int green = (y * 255 / BENCH_PNG_HEIGHT + noise) & 0xFF;
+            int blue  = ((x + y) * 127 / BENCH_PNG_HEIGHT + noise) & 0xFF;
+            pixels[x] = (red << 16) | (green << 8) | blue;
+        }
+    }
+
+    cairo_surface_mark_dirty(surface);
+
+}
+
+/**
+ * Encodes the given surface repeatedly using the given compression level and
+ * filter, printing the average time taken and the size of the output.
+ *
+ * @param client
+ *     The client to use to allocate streams.
+ *
+ * @param socket
+ *     The benchmark socket, whose data points to the byte counter.
+ *
+ * @param name
+ *     A human-readable name for the content of the surface.
+ *
+ * @param surface
+ *     The surface to encode.
+ *
+ * @param level
+ *     The zlib compression level to use.
+ *
+ * @param filter
+ *     The PNG row filter to use.
+ *
+ * @param filter_name
+ *     A human-readable name for the PNG row filter.
+ */
+static void bench_encode(guac_client* client, guac_socket* socket,
+        const char* name, cairo_surface_t* surface, int level,
+        guac_png_filter filter, const char* filter_name) {
+
+    size_t* written = (size_t*) socket->data;
+    *written = 0;
+
+    double start = bench_now();
+    for (int i = 0; i < BENCH_PNG_ITERATIONS; i++)
+        guac_client_stream_png_compressed(client, socket, GUAC_COMP_OVER,
+                GUAC_DEFAULT_LAYER, 0, 0, surface, level, filter);
+    double elapsed = (bench_now() - start) / BENCH_PNG_ITERATIONS;
+
+    printf("%-6s level=%2i filter=%-8s %8.3f ms/image %8zu bytes/image\n",
+            name, level, filter_name, elapsed / 1e6,
+            *written / BENCH_PNG_ITERATIONS);
+
+}
+
+int main(int argc, char** argv) {
+
+    static const int levels[] = {
+        GUAC_CLIENT_PNG_DEFAULT_COMPRESSION, 1, 3, 6, 9
+    };
+
+    size_t written = 0;
+
+    guac_client* client = guac_client_alloc();
+    guac_socket* socket = guac_socket_alloc();
+    socket->data = &written;
+    socket->write_handler = bench_write_handler;
+
+    cairo_surface_t* text = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            BENCH_PNG_WIDTH, BENCH_PNG_HEIGHT);
+    cairo_surface_t* photo = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            BENCH_PNG_WIDTH, BENCH_PNG_HEIGHT);
+
+    bench_fill_text(text);
+    bench_fill_photo(photo);
+
+    for (int i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        bench_encode(client, socket, "text", text, levels[i],
+                GUAC_PNG_FILTER_DEFAULT, "default");
+        bench_encode(client, socket, "text", text, levels[i],
+                GUAC_PNG_FILTER_ADAPTIVE, "adaptive");
+    }
+
+    for (int i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        bench_encode(client, socket, "photo", photo, levels[i],
+                GUAC_PNG_FILTER_DEFAULT, "default");
+        bench_encode(client, socket, "photo", photo, levels[i],
+                GUAC_PNG_FILTER_NONE, "none");
+    }
+
+    cairo_surface_destroy(text);
+    cairo_surface_destroy(photo);
+
+    guac_socket_free(socket);
+    guac_client_free(client);
+
+    return 0;
+
+}
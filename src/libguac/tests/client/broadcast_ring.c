@@ -0,0 +1,673 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/user.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * The maximum lag allowed for users while testing lag policies, in bytes.
+ */
+#define TEST_MAX_LAG 262144
+
+/**
+ * The number of rect instructions to broadcast while testing lag policies.
+ * This is deliberately large enough to produce more than ten times
+ * TEST_MAX_LAG bytes of output, far more than a pipe can hold.
+ */
+#define TEST_FLOOD_INSTRUCTIONS 100000
+
+/**
+ * The number of rect instructions to broadcast while testing resync of a
+ * user that is blocked for the duration. This is deliberately large enough
+ * to produce more than TEST_MAX_LAG bytes of output, but not so large that
+ * the user falls behind by more than several times TEST_MAX_LAG, beyond which
+ * users are disconnected regardless of lag policy.
+ */
+#define TEST_RESYNC_INSTRUCTIONS 15000
+
+/**
+ * The number of rect instructions to broadcast between each wait for the
+ * paced user while testing lag policies. This is deliberately small enough
+ * that the paced user never lags by anywhere near TEST_MAX_LAG bytes.
+ */
+#define TEST_FLOOD_CHUNK 1000
+
+/**
+ * The number of times test_resync_handler() has been invoked.
+ */
+static int resync_count = 0;
+
+/**
+ * The timestamp most recently passed to test_resync_handler().
+ */
+static guac_timestamp resync_since = 0;
+
+/**
+ * Resync handler which simply counts the number of times it has been
+ * invoked, sending a "nop" to the user to mark the resync.
+ *
+ * @param user
+ *     The user being resynchronized.
+ *
+ * @param timestamp
+ *     The timestamp of the most recent frame received in its entirety by
+ *     the user.
+ *
+ * @return
+ *     Always zero.
+ */
+static int test_resync_handler(guac_user* user, guac_timestamp timestamp) {
+    __atomic_store_n(&resync_since, timestamp, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&resync_count, 1, __ATOMIC_SEQ_CST);
+    return guac_protocol_send_nop(user->socket);
+}
+
+/**
+ * Non-zero if test_discard_resync_handler() has been invoked and is waiting
+ * for output to be broadcast.
+ */
+static int discard_handler_waiting = 0;
+
+/**
+ * Non-zero once output has been broadcast while test_discard_resync_handler()
+ * is waiting.
+ */
+static int discard_output_sent = 0;
+
+/**
+ * Resync handler which waits for output to be broadcast while the handler is
+ * running, as if collecting the current state of the connection, and then
+ * discards all broadcast output before sending a "nop" to mark the resync.
+ *
+ * @param user
+ *     The user being resynchronized.
+ *
+ * @param timestamp
+ *     The timestamp of the most recent frame received in its entirety by
+ *     the user.
+ *
+ * @return
+ *     Always zero.
+ */
+static int test_discard_resync_handler(guac_user* user,
+        guac_timestamp timestamp) {
+
+    __atomic_store_n(&discard_handler_waiting, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < 500
+            && !__atomic_load_n(&discard_output_sent, __ATOMIC_SEQ_CST); i++)
+        usleep(10000);
+
+    guac_client_discard_broadcast(user->client, user, user->socket);
+    return guac_protocol_send_nop(user->socket);
+
+}
+
+/**
+ * Allocates a new user of the given client whose socket writes to the given
+ * file descriptor, adding that user to the client.
+ *
+ * @param client
+ *     The client that the user should join.
+ *
+ * @param fd
+ *     The file descriptor that the user's socket should write to.
+ *
+ * @return
+ *     The newly-allocated user.
+ */
+static guac_user* add_user(guac_client* client, int fd) {
+
+    guac_user* user = guac_user_alloc();
+    user->client = client;
+    user->socket = guac_socket_open(fd);
+    user->owner = (client->connected_users == 0);
+
+    CU_ASSERT_EQUAL(guac_client_add_user(client, user, 0, NULL), 0);
+    return user;
+
+}
+
+/**
+ * Removes the given user from its client, freeing the user and its socket.
+ *
+ * @param user
+ *     The user to remove.
+ */
+static void remove_user(guac_user* user) {
+    guac_client_remove_user(user->client, user);
+    guac_socket_free(user->socket);
+    guac_user_free(user);
+}
+
+/**
+ * Waits up to five seconds for all broadcast output to be written to the
+ * given user.
+ *
+ * @param user
+ *     The user to wait for.
+ *
+ * @return
+ *     Zero if all output was written, non-zero otherwise.
+ */
+static int wait_for_drain(guac_user* user) {
+
+    for (int i = 0; i < 500; i++) {
+        if (guac_client_get_broadcast_lag(user->client, user) == 0)
+            return 0;
+        usleep(10000);
+    }
+
+    return 1;
+
+}
+
+/**
+ * Broadcasts a flood of instructions to all users of the given client,
+ * optionally waiting for a specific user to catch up between chunks of
+ * instructions.
+ *
+ * @param client
+ *     The client whose users should receive the instructions.
+ *
+ * @param paced
+ *     The user to wait for between each chunk of TEST_FLOOD_CHUNK
+ *     instructions, or NULL to flood without waiting.
+ *
+ * @param count
+ *     The number of instructions to broadcast.
+ */
+static void flood(guac_client* client, guac_user* paced, int count) {
+
+    const guac_layer layer = { .index = 1 };
+
+    for (int i = 0; i < count; i++) {
+
+        guac_protocol_send_rect(client->socket, &layer, i, i, 64, 64);
+
+        if (paced != NULL && (i + 1) % TEST_FLOOD_CHUNK == 0) {
+            guac_socket_flush(client->socket);
+            CU_ASSERT_EQUAL(wait_for_drain(paced), 0);
+        }
+
+    }
+
+    guac_socket_flush(client->socket);
+
+}
+
+/**
+ * Test which verifies that instructions written to the broadcast socket in
+ * ring mode are received, unaltered, by every connected user.
+ */
+void test_client__broadcast_ring() {
+
+    char expected[] = "4.sync,5.12345;4.rect,1.1,1.2,1.3,1.4,1.5;";
+    const guac_layer layer = { .index = 1 };
+
+    int fd_a[2];
+    int fd_b[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd_a), 0);
+    CU_ASSERT_EQUAL_FATAL(pipe(fd_b), 0);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    CU_ASSERT_EQUAL(guac_client_enable_broadcast_ring(client,
+                GUAC_CLIENT_DEFAULT_BROADCAST_MAX_LAG,
+                GUAC_CLIENT_LAG_DISCONNECT), 0);
+
+    guac_user* user_a = add_user(client, fd_a[1]);
+    guac_user* user_b = add_user(client, fd_b[1]);
+
+    /* Broadcast instructions */
+    guac_protocol_send_sync(client->socket, 12345);
+    guac_protocol_send_rect(client->socket, &layer, 2, 3, 4, 5);
+    guac_socket_flush(client->socket);
+
+    CU_ASSERT_EQUAL(wait_for_drain(user_a), 0);
+    CU_ASSERT_EQUAL(wait_for_drain(user_b), 0);
+
+    remove_user(user_a);
+    remove_user(user_b);
+    guac_client_free(client);
+
+    /* Verify both users received the exact same output */
+    char buffer[1024];
+    int length;
+
+    length = read(fd_a[0], buffer, sizeof(buffer) - 1);
+    CU_ASSERT_EQUAL_FATAL(length, strlen(expected));
+    buffer[length] = '\0';
+    CU_ASSERT_STRING_EQUAL(buffer, expected);
+
+    length = read(fd_b[0], buffer, sizeof(buffer) - 1);
+    CU_ASSERT_EQUAL_FATAL(length, strlen(expected));
+    buffer[length] = '\0';
+    CU_ASSERT_STRING_EQUAL(buffer, expected);
+
+    close(fd_a[0]);
+    close(fd_b[0]);
+
+}
+
+/**
+ * Test which verifies that a user which falls too far behind is disconnected
+ * under the GUAC_CLIENT_LAG_DISCONNECT policy, without affecting other
+ * users.
+ */
+void test_client__broadcast_ring_disconnect() {
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int fd_slow[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd_slow), 0);
+
+    int fd_fast = open("/dev/null", O_WRONLY);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd_fast, -1);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    CU_ASSERT_EQUAL(guac_client_enable_broadcast_ring(client, TEST_MAX_LAG,
+                GUAC_CLIENT_LAG_DISCONNECT), 0);
+
+    guac_user* fast = add_user(client, fd_fast);
+    guac_user* slow = add_user(client, fd_slow[1]);
+
+    /* The slow user never reads, and must be disconnected */
+    flood(client, fast, TEST_FLOOD_INSTRUCTIONS);
+    CU_ASSERT_EQUAL(wait_for_drain(fast), 0);
+    CU_ASSERT_TRUE(fast->active);
+    CU_ASSERT_FALSE(slow->active);
+
+    /* Unblock any write to the slow user */
+    close(fd_slow[0]);
+
+    remove_user(fast);
+    remove_user(slow);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that a user which falls too far behind is
+ * resynchronized via the client's resync handler under the
+ * GUAC_CLIENT_LAG_RESYNC policy, remaining connected.
+ */
+void test_client__broadcast_ring_resync() {
+
+    int fd_slow[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd_slow), 0);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    client->resync_handler = test_resync_handler;
+    CU_ASSERT_EQUAL(guac_client_enable_broadcast_ring(client, TEST_MAX_LAG,
+                GUAC_CLIENT_LAG_RESYNC), 0);
+
+    guac_user* slow = add_user(client, fd_slow[1]);
+
+    /* Flood the slow user, reading only once flooding is complete */
+    flood(client, NULL, TEST_RESYNC_INSTRUCTIONS);
+
+    char buffer[65536];
+    fcntl(fd_slow[0], F_SETFL, O_NONBLOCK);
+    for (int i = 0; i < 500 && (guac_client_get_broadcast_lag(client, slow) != 0
+                || __atomic_load_n(&resync_count, __ATOMIC_SEQ_CST) == 0); i++) {
+        while (read(fd_slow[0], buffer, sizeof(buffer)) > 0);
+        usleep(10000);
+    }
+
+    /* User must have been resynchronized rather than disconnected */
+    CU_ASSERT_TRUE(resync_count > 0);
+    CU_ASSERT_TRUE(slow->active);
+
+    remove_user(slow);
+    guac_client_free(client);
+    close(fd_slow[0]);
+
+}
+
+/**
+ * Test which verifies that a user which is blocked while falling far behind
+ * is disconnected even under the GUAC_CLIENT_LAG_RESYNC policy, as such a
+ * user cannot apply the lag policy itself, without affecting other users.
+ */
+void test_client__broadcast_ring_hard_lag() {
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int fd_slow[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd_slow), 0);
+
+    int fd_fast = open("/dev/null", O_WRONLY);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd_fast, -1);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    client->resync_handler = test_resync_handler;
+    CU_ASSERT_EQUAL(guac_client_enable_broadcast_ring(client, TEST_MAX_LAG,
+                GUAC_CLIENT_LAG_RESYNC), 0);
+
+    guac_user* fast = add_user(client, fd_fast);
+    guac_user* slow = add_user(client, fd_slow[1]);
+
+    /* The slow user never reads, remaining blocked, and must be
+     * disconnected */
+    flood(client, fast, TEST_FLOOD_INSTRUCTIONS);
+    CU_ASSERT_EQUAL(wait_for_drain(fast), 0);
+    CU_ASSERT_TRUE(fast->active);
+    CU_ASSERT_FALSE(slow->active);
+
+    /* Unblock any write to the slow user */
+    close(fd_slow[0]);
+
+    remove_user(fast);
+    remove_user(slow);
+    guac_client_free(client);
+
+}
+
+/**
+ * Non-zero once remove_user_thread() has finished removing its user.
+ */
+static int remove_user_complete = 0;
+
+/**
+ * Thread which removes the given user, as remove_user() does, and then sets
+ * remove_user_complete.
+ *
+ * @param data
+ *     The guac_user to remove.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* remove_user_thread(void* data) {
+    remove_user((guac_user*) data);
+    __atomic_store_n(&remove_user_complete, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+/**
+ * Test which verifies that a user whose reader is blocked writing to a
+ * connection that is never read can still be removed, with the connection
+ * to that user being shut down such that the reader stops.
+ */
+void test_client__broadcast_ring_remove_blocked() {
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fd), 0);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    client->resync_handler = test_resync_handler;
+    CU_ASSERT_EQUAL(guac_client_enable_broadcast_ring(client, TEST_MAX_LAG,
+                GUAC_CLIENT_LAG_RESYNC), 0);
+
+    guac_user* blocked = add_user(client, fd[1]);
+
+    /* Fill the connection to the user, but not so far beyond TEST_MAX_LAG
+     * that the user is disconnected regardless of lag policy */
+    flood(client, NULL, TEST_RESYNC_INSTRUCTIONS);
+    usleep(100000);
+    CU_ASSERT_TRUE(blocked->active);
+    CU_ASSERT_NOT_EQUAL(guac_client_get_broadcast_lag(client, blocked), 0);
+
+    /* Removal must complete despite nothing ever being read */
+    __atomic_store_n(&remove_user_complete, 0, __ATOMIC_SEQ_CST);
+    pthread_t thread;
+    CU_ASSERT_EQUAL_FATAL(pthread_create(&thread, NULL, remove_user_thread,
+                blocked), 0);
+
+    for (int i = 0; i < 500
+            && !__atomic_load_n(&remove_user_complete, __ATOMIC_SEQ_CST); i++)
+        usleep(10000);
+
+    CU_ASSERT_TRUE(__atomic_load_n(&remove_user_complete, __ATOMIC_SEQ_CST));
+
+    /* Unblock the reader regardless, such that the test can finish */
+    close(fd[0]);
+    pthread_join(thread, NULL);
+
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that frames are skipped for a user whose processing
+ * lag exceeds GUAC_CLIENT_FRAME_SKIP_LAG under the GUAC_CLIENT_LAG_RESYNC
+ * policy, that the user is excluded from the processing lag of the client,
+ * and that the user is resynchronized once it has caught up.
+ */
+void test_client__broadcast_ring_skip() {
+
+    const guac_layer layer = { .index = 1 };
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+    fcntl(fd[0], F_SETFL, O_NONBLOCK);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    client->resync_handler = test_resync_handler;
+    client->last_sent_timestamp = 5000;
+    CU_ASSERT_EQUAL(guac_client_enable_broadcast_ring(client,
+                GUAC_CLIENT_DEFAULT_BROADCAST_MAX_LAG,
+                GUAC_CLIENT_LAG_RESYNC), 0);
+
+    guac_user* slow = add_user(client, fd[1]);
+
+    /* Simulate a user which acknowledged an older frame very late */
+    slow->last_received_timestamp = 1000;
+    slow->processing_lag = GUAC_CLIENT_FRAME_SKIP_LAG + 1;
+    CU_ASSERT_EQUAL(guac_client_get_processing_lag(client), 0);
+
+    int initial_count = __atomic_load_n(&resync_count, __ATOMIC_SEQ_CST);
+
+    /* The frame must be skipped, with only a marker sync being sent */
+    guac_protocol_send_rect(client->socket, &layer, 1, 2, 3, 4);
+    guac_socket_flush(client->socket);
+    CU_ASSERT_EQUAL(wait_for_drain(slow), 0);
+
+    char expected[] = "4.sync,4.5000;";
+    char buffer[1024];
+    int length = 0;
+    for (int i = 0; i < 500 && length < (int) strlen(expected); i++) {
+        int result = read(fd[0], buffer + length, sizeof(buffer) - 1 - length);
+        if (result > 0)
+            length += result;
+        else
+            usleep(10000);
+    }
+
+    buffer[length] = '\0';
+    CU_ASSERT_STRING_EQUAL(buffer, expected);
+
+    /* Acknowledging the marker must result in resync */
+    slow->last_received_timestamp = 5000;
+    for (int i = 0; i < 500
+            && __atomic_load_n(&resync_count, __ATOMIC_SEQ_CST)
+                == initial_count; i++)
+        usleep(10000);
+
+    CU_ASSERT_EQUAL(resync_count, initial_count + 1);
+    CU_ASSERT_EQUAL(resync_since, 1000);
+    CU_ASSERT_TRUE(slow->active);
+
+    remove_user(slow);
+    guac_client_free(client);
+    close(fd[0]);
+
+}
+
+/**
+ * Test which verifies that discarding the output of a user having frames
+ * skipped drops only instructions affecting the remote display, while all
+ * other instructions, including those of streams opened before the discarded
+ * output, are still received in order.
+ */
+void test_client__broadcast_ring_skip_streams() {
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+    fcntl(fd[0], F_SETFL, O_NONBLOCK);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    client->resync_handler = test_resync_handler;
+    client->last_sent_timestamp = 5000;
+    CU_ASSERT_EQUAL(guac_client_enable_broadcast_ring(client,
+                GUAC_CLIENT_DEFAULT_BROADCAST_MAX_LAG,
+                GUAC_CLIENT_LAG_RESYNC), 0);
+
+    guac_user* slow = add_user(client, fd[1]);
+
+    slow->last_received_timestamp = 1000;
+    slow->processing_lag = GUAC_CLIENT_FRAME_SKIP_LAG + 1;
+
+    /* Broadcast a mix of display and other instructions, committed all at
+     * once such that they are discarded together. Element lengths are in
+     * codepoints, and values may contain separators. */
+    guac_socket_instruction_begin(client->socket);
+    guac_socket_write_string(client->socket,
+            "4.rect,1.1,1.2,1.3,1.4,1.5;"
+            "3.img,1.3,2.14,1.1,9.image/png,1.0,1.0;"
+            "4.blob,1.3,4.AAAA;"
+            "3.end,1.3;"
+            "4.name,7.\xc3\x9cn;c,d\xc3\xa9;"
+            "9.clipboard,1.5,10.text/plain;"
+            "4.blob,1.5,8.dGVzdA==;"
+            "3.end,1.5;"
+            "4.blob,1.7,4.AAAA;"
+            "3.end,1.7;"
+            "4.sync,4.4000;");
+    guac_socket_instruction_end(client->socket);
+    guac_socket_flush(client->socket);
+    CU_ASSERT_EQUAL(wait_for_drain(slow), 0);
+
+    char expected[] =
+        "4.name,7.\xc3\x9cn;c,d\xc3\xa9;"
+        "9.clipboard,1.5,10.text/plain;"
+        "4.blob,1.5,8.dGVzdA==;"
+        "3.end,1.5;"
+        "4.blob,1.7,4.AAAA;"
+        "3.end,1.7;"
+        "4.sync,4.5000;";
+
+    char buffer[1024];
+    int length = 0;
+    for (int i = 0; i < 500 && length < (int) strlen(expected); i++) {
+        int result = read(fd[0], buffer + length, sizeof(buffer) - 1 - length);
+        if (result > 0)
+            length += result;
+        else
+            usleep(10000);
+    }
+
+    buffer[length] = '\0';
+    CU_ASSERT_STRING_EQUAL(buffer, expected);
+    CU_ASSERT_TRUE(slow->active);
+
+    remove_user(slow);
+    guac_client_free(client);
+    close(fd[0]);
+
+}
+
+/**
+ * Test which verifies that output broadcast while the resync handler is
+ * collecting the current state of the connection is not received by the user
+ * being resynchronized if the handler discards it, while output broadcast
+ * after the handler has returned is received.
+ */
+void test_client__broadcast_ring_resync_discard() {
+
+    const guac_layer layer = { .index = 1 };
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+    fcntl(fd[0], F_SETFL, O_NONBLOCK);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+    client->resync_handler = test_discard_resync_handler;
+    client->last_sent_timestamp = 5000;
+    CU_ASSERT_EQUAL(guac_client_enable_broadcast_ring(client,
+                GUAC_CLIENT_DEFAULT_BROADCAST_MAX_LAG,
+                GUAC_CLIENT_LAG_RESYNC), 0);
+
+    guac_user* slow = add_user(client, fd[1]);
+
+    /* Begin skipping frames for the user */
+    slow->last_received_timestamp = 1000;
+    slow->processing_lag = GUAC_CLIENT_FRAME_SKIP_LAG + 1;
+    guac_protocol_send_rect(client->socket, &layer, 1, 2, 3, 4);
+    guac_socket_flush(client->socket);
+    CU_ASSERT_EQUAL(wait_for_drain(slow), 0);
+
+    /* Broadcast while the user is being resynchronized */
+    slow->last_received_timestamp = 5000;
+    for (int i = 0; i < 500
+            && !__atomic_load_n(&discard_handler_waiting, __ATOMIC_SEQ_CST);
+            i++)
+        usleep(10000);
+
+    guac_protocol_send_rect(client->socket, &layer, 9, 9, 9, 9);
+    guac_socket_flush(client->socket);
+    __atomic_store_n(&discard_output_sent, 1, __ATOMIC_SEQ_CST);
+
+    /* Broadcast after the user has been resynchronized */
+    CU_ASSERT_EQUAL(wait_for_drain(slow), 0);
+    guac_protocol_send_rect(client->socket, &layer, 7, 7, 7, 7);
+    guac_socket_flush(client->socket);
+    CU_ASSERT_EQUAL(wait_for_drain(slow), 0);
+
+    char expected[] = "4.sync,4.5000;3.nop;4.rect,1.1,1.7,1.7,1.7,1.7;";
+    char buffer[1024];
+    int length = 0;
+    for (int i = 0; i < 500 && length < (int) strlen(expected); i++) {
+        int result = read(fd[0], buffer + length, sizeof(buffer) - 1 - length);
+        if (result > 0)
+            length += result;
+        else
+            usleep(10000);
+    }
+
+    buffer[length] = '\0';
+    CU_ASSERT_STRING_EQUAL(buffer, expected);
+    CU_ASSERT_TRUE(slow->active);
+
+    remove_user(slow);
+    guac_client_free(client);
+    close(fd[0]);
+
+}
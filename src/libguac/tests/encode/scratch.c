@@ -0,0 +1,212 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "encode-scratch.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The sizes of the allocations made from the arena during each simulated
+ * encoding operation, mimicking the mix of small and large allocations made
+ * by an image encoder.
+ */
+static const size_t test_scratch_sizes[] = {
+    24, 1, 4096, 65536, 7, 300, 32768, 5
+};
+
+/**
+ * Structure whose layout reveals the alignment required by
+ * guac_encode_max_align, which is the offset of its second member.
+ */
+typedef struct test_scratch_alignment {
+    char padding;
+    guac_encode_max_align aligned;
+} test_scratch_alignment;
+
+/**
+ * The alignment that every allocation from an arena must satisfy.
+ */
+#define TEST_SCRATCH_ALIGNMENT offsetof(test_scratch_alignment, aligned)
+
+/**
+ * Allocates each of test_scratch_sizes from the given arena, verifying that
+ * each allocation is aligned and writable, and that no allocation overlaps
+ * any other.
+ *
+ * @param arena
+ *     The arena to allocate from.
+ */
+static void test_scratch_fill(guac_encode_arena* arena) {
+
+    int count = sizeof(test_scratch_sizes) / sizeof(test_scratch_sizes[0]);
+    unsigned char* allocations[count];
+
+    for (int i = 0; i < count; i++) {
+
+        allocations[i] = guac_encode_arena_alloc(arena, test_scratch_sizes[i]);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(allocations[i]);
+        CU_ASSERT_EQUAL((uintptr_t) allocations[i]
+                % GUAC_ENCODE_ARENA_ALIGNMENT, 0);
+        CU_ASSERT_EQUAL((uintptr_t) allocations[i]
+                % TEST_SCRATCH_ALIGNMENT, 0);
+
+        memset(allocations[i], i, test_scratch_sizes[i]);
+
+    }
+
+    /* Each allocation must still contain only its own value */
+    for (int i = 0; i < count; i++) {
+        for (size_t j = 0; j < test_scratch_sizes[i]; j++) {
+            if (allocations[i][j] != i) {
+                CU_FAIL("Arena allocations overlap");
+                return;
+            }
+        }
+    }
+
+}
+
+/**
+ * Verifies that allocations which overflow the main block of an arena
+ * succeed, and that resetting the arena enlarges its main block such that
+ * the same allocations no longer overflow.
+ */
+void test_encode__arena_reset() {
+
+    guac_encode_arena arena = { 0 };
+
+    /* First use of the arena overflows, as there is no main block */
+    test_scratch_fill(&arena);
+    CU_ASSERT_PTR_NOT_NULL(arena.overflow);
+
+    guac_encode_arena_reset(&arena);
+    CU_ASSERT_PTR_NULL(arena.overflow);
+    CU_ASSERT_EQUAL(arena.used, 0);
+
+    /* Identical work must now fit entirely within the main block */
+    unsigned char* block = arena.block;
+    for (int i = 0; i < 3; i++) {
+        test_scratch_fill(&arena);
+        CU_ASSERT_PTR_NULL(arena.overflow);
+        CU_ASSERT_PTR_EQUAL(arena.block, block);
+        guac_encode_arena_reset(&arena);
+    }
+
+    guac_encode_arena_free(&arena);
+    CU_ASSERT_PTR_NULL(arena.block);
+
+}
+
+/**
+ * Verifies that reserving space within a buffer enlarges the buffer only
+ * when more space is required than previously reserved.
+ */
+void test_encode__buffer_reserve() {
+
+    guac_encode_buffer buffer = { 0 };
+
+    void* data = guac_encode_buffer_reserve(&buffer, 1024);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+    CU_ASSERT(buffer.size >= 1024);
+    memset(data, 0xFF, 1024);
+
+    /* Smaller and equal requests reuse the existing memory */
+    CU_ASSERT_PTR_EQUAL(guac_encode_buffer_reserve(&buffer, 16), data);
+    CU_ASSERT_PTR_EQUAL(guac_encode_buffer_reserve(&buffer, 1024), data);
+
+    /* Larger requests enlarge the buffer */
+    data = guac_encode_buffer_reserve(&buffer, 4096);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+    CU_ASSERT(buffer.size >= 4096);
+    memset(data, 0xFF, 4096);
+
+    guac_encode_buffer_free(&buffer);
+    CU_ASSERT_PTR_NULL(buffer.data);
+    CU_ASSERT_EQUAL(buffer.size, 0);
+
+}
+
+/**
+ * Verifies that the main block of an arena does not grow beyond
+ * GUAC_ENCODE_SCRATCH_MAX_RETAINED, even if more than that was allocated
+ * since the arena was last reset, and that such allocations still succeed.
+ */
+void test_encode__arena_retained_max() {
+
+    guac_encode_arena arena = { 0 };
+
+    unsigned char* data = guac_encode_arena_alloc(&arena,
+            GUAC_ENCODE_SCRATCH_MAX_RETAINED * 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+    CU_ASSERT_EQUAL((uintptr_t) data % TEST_SCRATCH_ALIGNMENT, 0);
+    memset(data, 0xFF, GUAC_ENCODE_SCRATCH_MAX_RETAINED * 2);
+
+    guac_encode_arena_reset(&arena);
+    CU_ASSERT_PTR_NULL(arena.overflow);
+    CU_ASSERT_EQUAL(arena.size, GUAC_ENCODE_SCRATCH_MAX_RETAINED);
+
+    /* The same large allocation again overflows rather than enlarging the
+     * main block further */
+    CU_ASSERT_PTR_NOT_NULL(guac_encode_arena_alloc(&arena,
+                GUAC_ENCODE_SCRATCH_MAX_RETAINED * 2));
+    CU_ASSERT_PTR_NOT_NULL(arena.overflow);
+
+    guac_encode_arena_reset(&arena);
+    CU_ASSERT_EQUAL(arena.size, GUAC_ENCODE_SCRATCH_MAX_RETAINED);
+
+    guac_encode_arena_free(&arena);
+
+}
+
+/**
+ * Verifies that trimming a buffer releases its memory only if the buffer has
+ * grown beyond GUAC_ENCODE_SCRATCH_MAX_RETAINED.
+ */
+void test_encode__buffer_trim() {
+
+    guac_encode_buffer buffer = { 0 };
+
+    /* Buffers of typical size are retained */
+    void* data = guac_encode_buffer_reserve(&buffer,
+            GUAC_ENCODE_SCRATCH_MAX_RETAINED);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+
+    guac_encode_buffer_trim(&buffer);
+    CU_ASSERT_PTR_EQUAL(buffer.data, data);
+    CU_ASSERT_EQUAL(buffer.size, GUAC_ENCODE_SCRATCH_MAX_RETAINED);
+
+    /* Buffers enlarged for unusually large images are released */
+    data = guac_encode_buffer_reserve(&buffer,
+            GUAC_ENCODE_SCRATCH_MAX_RETAINED + 1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+
+    guac_encode_buffer_trim(&buffer);
+    CU_ASSERT_PTR_NULL(buffer.data);
+    CU_ASSERT_EQUAL(buffer.size, 0);
+
+    /* A trimmed buffer remains usable */
+    CU_ASSERT_PTR_NOT_NULL(guac_encode_buffer_reserve(&buffer, 1024));
+
+    guac_encode_buffer_free(&buffer);
+
+}
@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/opcode.h>
+
+#include <stdlib.h>
+
+/**
+ * Structure resembling the opcode/handler mapping structures used by
+ * instruction dispatch, with additional members such that the stride between
+ * entries differs from the size of a pointer.
+ */
+typedef struct test_opcode_mapping {
+
+    /**
+     * The opcode of this mapping.
+     */
+    const char* opcode;
+
+    /**
+     * Arbitrary value associated with the opcode.
+     */
+    int value;
+
+    /**
+     * Arbitrary padding, included only to alter the size of this structure.
+     */
+    char padding[13];
+
+} test_opcode_mapping;
+
+/**
+ * Mapping array containing every opcode dispatched by libguac for connected
+ * users, in the same order as libguac's own instruction handler map.
+ */
+static test_opcode_mapping test_mappings[] = {
+    {"sync",       0},
+    {"touch",      1},
+    {"mouse",      2},
+    {"key",        3},
+    {"clipboard",  4},
+    {"disconnect", 5},
+    {"size",       6},
+    {"file",       7},
+    {"pipe",       8},
+    {"ack",        9},
+    {"blob",       10},
+    {"end",        11},
+    {"get",        12},
+    {"put",        13},
+    {"audio",      14},
+    {"argv",       15},
+    {"nop",        16},
+    {NULL,         -1}
+};
+
+/**
+ * Test which verifies that guac_opcode_index_find() returns the position of
+ * each opcode within the mapping array used to build the index.
+ */
+void test_opcode__find_known() {
+
+    guac_opcode_index* index = guac_opcode_index_alloc(
+            &test_mappings[0].opcode, sizeof(test_opcode_mapping));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(index);
+    CU_ASSERT_EQUAL(index->count, 17);
+
+    for (int i = 0; test_mappings[i].opcode != NULL; i++)
+        CU_ASSERT_EQUAL(guac_opcode_index_find(index, test_mappings[i].opcode),
+                test_mappings[i].value);
+
+    guac_opcode_index_free(index);
+
+}
+
+/**
+ * Test which verifies that guac_opcode_index_find() returns -1 for opcodes
+ * that are not present, including those which are prefixes or extensions of
+ * opcodes that are present.
+ */
+void test_opcode__find_unknown() {
+
+    guac_opcode_index* index = guac_opcode_index_alloc(
+            &test_mappings[0].opcode, sizeof(test_opcode_mapping));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(index);
+
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, ""), -1);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "syn"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "syncs"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "SYNC"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "img"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "disconnected"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index,
+                "an-opcode-longer-than-any-known-opcode"), -1);
+
+    guac_opcode_index_free(index);
+
+}
+
+/**
+ * Test which verifies that an index may be built from a plain NULL-terminated
+ * array of opcode strings, including an empty array.
+ */
+void test_opcode__string_array() {
+
+    const char* opcodes[] = { "img", "blob", "end", NULL };
+    const char* empty[] = { NULL };
+
+    guac_opcode_index* index = guac_opcode_index_alloc(opcodes,
+            sizeof(const char*));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(index);
+
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "img"),  0);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "blob"), 1);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "end"),  2);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "key"), -1);
+
+    guac_opcode_index_free(index);
+
+    index = guac_opcode_index_alloc(empty, sizeof(const char*));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(index);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, "img"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_index_find(index, ""), -1);
+    guac_opcode_index_free(index);
+
+}
+
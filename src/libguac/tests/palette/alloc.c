@@ -0,0 +1,138 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "palette.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * The width of each test surface, in pixels. This is deliberately not a
+ * multiple of four, such that runs of color which end at the edge of each
+ * row cannot be skipped entirely four pixels at a time.
+ */
+#define TEST_PALETTE_WIDTH 37
+
+/**
+ * The height of each test surface, in pixels.
+ */
+#define TEST_PALETTE_HEIGHT 9
+
+/**
+ * Returns a pointer to the pixel at the given coordinates within the given
+ * RGB24 surface.
+ *
+ * @param surface
+ *     The surface containing the pixel.
+ *
+ * @param x
+ *     The X coordinate of the pixel.
+ *
+ * @param y
+ *     The Y coordinate of the pixel.
+ *
+ * @return
+ *     A pointer to the requested pixel.
+ */
+static uint32_t* test_pixel(cairo_surface_t* surface, int x, int y) {
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    return (uint32_t*) (data + y * stride) + x;
+}
+
+/**
+ * Verifies that the index produced for each pixel refers to the color of
+ * that pixel, for surfaces containing both long runs of a single color and
+ * isolated pixels, and that the unused upper byte of each pixel is ignored.
+ */
+void test_palette__indexes() {
+
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            TEST_PALETTE_WIDTH, TEST_PALETTE_HEIGHT);
+
+    /* Runs of varying length, broken by isolated pixels */
+    for (int y = 0; y < TEST_PALETTE_HEIGHT; y++) {
+        for (int x = 0; x < TEST_PALETTE_WIDTH; x++) {
+            uint32_t color = (x + y) % 11 == 0 ? 0x102030
+                           : x < 20            ? 0xFFFFFF
+                           :                     0x000080;
+            *test_pixel(surface, x, y) = color | ((x & 1) ? 0xFF000000 : 0);
+        }
+    }
+
+    unsigned char indexes[TEST_PALETTE_WIDTH * TEST_PALETTE_HEIGHT];
+    guac_palette* palette = guac_palette_alloc(surface, indexes);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(palette);
+    CU_ASSERT_EQUAL(palette->size, 3);
+
+    /* Every index must map back to the original color */
+    for (int y = 0; y < TEST_PALETTE_HEIGHT; y++) {
+        for (int x = 0; x < TEST_PALETTE_WIDTH; x++) {
+
+            int index = indexes[y * TEST_PALETTE_WIDTH + x];
+            CU_ASSERT_FATAL(index < palette->size);
+
+            png_color* color = &palette->colors[index];
+            uint32_t expected = *test_pixel(surface, x, y) & 0xFFFFFF;
+            CU_ASSERT_EQUAL((color->red << 16) | (color->green << 8)
+                    | color->blue, expected);
+
+        }
+    }
+
+    guac_palette_free(palette);
+    cairo_surface_destroy(surface);
+
+}
+
+/**
+ * Verifies that a palette can be built for surfaces containing exactly 256
+ * colors, but not for surfaces containing more.
+ */
+void test_palette__too_many_colors() {
+
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            TEST_PALETTE_WIDTH, TEST_PALETTE_HEIGHT);
+
+    unsigned char indexes[TEST_PALETTE_WIDTH * TEST_PALETTE_HEIGHT];
+
+    /* Exactly 256 distinct colors, each repeated */
+    for (int y = 0; y < TEST_PALETTE_HEIGHT; y++) {
+        for (int x = 0; x < TEST_PALETTE_WIDTH; x++)
+            *test_pixel(surface, x, y) =
+                ((y * TEST_PALETTE_WIDTH + x) % 256) * 0x010101;
+    }
+
+    guac_palette* palette = guac_palette_alloc(surface, indexes);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(palette);
+    CU_ASSERT_EQUAL(palette->size, 256);
+    guac_palette_free(palette);
+
+    /* One more color in the final pixel */
+    *test_pixel(surface, TEST_PALETTE_WIDTH - 1, TEST_PALETTE_HEIGHT - 1) =
+        0x123456;
+
+    CU_ASSERT_PTR_NULL(guac_palette_alloc(surface, indexes));
+
+    cairo_surface_destroy(surface);
+
+}
@@ -0,0 +1,200 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/parser.h>
+#include <guacamole/unicode.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The number of bytes provided to guac_parser_append() at a time when
+ * exercising the scalar parser. As this is smaller than the blocks examined
+ * by the bulk content scan, content will only ever be parsed character by
+ * character.
+ */
+#define SCALAR_CHUNK_SIZE 7
+
+/**
+ * Builds a Guacamole instruction from the given NULL-terminated array of
+ * elements, the first being the opcode, computing the length prefix of each
+ * element in the same manner as the parser (by stepping through lead bytes
+ * with guac_utf8_charsize()).
+ *
+ * @param elements
+ *     NULL-terminated array of elements.
+ *
+ * @param buffer
+ *     The buffer to write the instruction to.
+ *
+ * @param size
+ *     The size of the buffer, in bytes.
+ *
+ * @return
+ *     The length of the resulting instruction, in bytes, which will be equal
+ *     to or greater than the size of the buffer if the buffer was too small.
+ */
+static int build_instruction(const char** elements, char* buffer, int size) {
+
+    int length = 0;
+
+    for (int i = 0; elements[i] != NULL; i++) {
+        length += snprintf(buffer + length, size - length, "%i.%s%c",
+                (int) guac_utf8_strlen(elements[i]), elements[i],
+                elements[i+1] != NULL ? ',' : ';');
+    }
+
+    return length;
+
+}
+
+/**
+ * Parses the given instruction with guac_parser_append(), providing data
+ * in chunks of the given size, and verifies that the elements parsed match
+ * the given elements exactly.
+ *
+ * @param elements
+ *     NULL-terminated array of elements, the first being the opcode.
+ *
+ * @param chunk_size
+ *     The maximum number of new bytes to provide to the parser whenever it
+ *     requires more data, or zero to provide the entire instruction at once.
+ */
+static void verify_parse(const char** elements, int chunk_size) {
+
+    char buffer[8192];
+    int length = build_instruction(elements, buffer, sizeof(buffer));
+    CU_ASSERT_FATAL(length < sizeof(buffer));
+
+    guac_parser* parser = guac_parser_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(parser);
+
+    int start = 0;
+    int end = chunk_size > 0 ? 0 : length;
+
+    while (parser->state != GUAC_PARSE_COMPLETE
+            && parser->state != GUAC_PARSE_ERROR) {
+
+        int parsed = guac_parser_append(parser, buffer + start, end - start);
+
+        /* Provide more data only if needed */
+        if (parsed == 0) {
+            CU_ASSERT_FATAL(end < length);
+            end += chunk_size;
+            if (end > length)
+                end = length;
+        }
+
+        else
+            start += parsed;
+
+    }
+
+    /* Entire instruction should have been parsed successfully */
+    CU_ASSERT_EQUAL_FATAL(parser->state, GUAC_PARSE_COMPLETE);
+    CU_ASSERT_EQUAL(start, length);
+
+    /* Verify all elements */
+    CU_ASSERT_STRING_EQUAL(parser->opcode, elements[0]);
+    int argc = 0;
+    for (; elements[argc + 1] != NULL; argc++) {
+        CU_ASSERT_FATAL(argc < parser->argc);
+        CU_ASSERT_STRING_EQUAL(parser->argv[argc], elements[argc + 1]);
+    }
+
+    CU_ASSERT_EQUAL(parser->argc, argc);
+
+    guac_parser_free(parser);
+
+}
+
+/**
+ * Test which verifies that long ASCII elements, which are skipped in bulk
+ * when the entire instruction is available, are parsed identically whether
+ * provided all at once or in small chunks.
+ */
+void test_parser__content_ascii() {
+
+    char long_element[4097];
+    for (int i = 0; i < sizeof(long_element) - 1; i++)
+        long_element[i] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789+/,.;"[i % 41];
+    long_element[sizeof(long_element) - 1] = '\0';
+
+    const char* elements[] = {
+        "blob", "15", long_element, "0123456789abcdef", "0123456789abcde",
+        "0123456789abcdefg", "", NULL
+    };
+
+    verify_parse(elements, 0);
+    verify_parse(elements, SCALAR_CHUNK_SIZE);
+
+}
+
+/**
+ * Test which verifies that elements containing multibyte UTF-8 characters,
+ * including characters which straddle the boundaries of the blocks examined
+ * by the bulk content scan, are parsed identically whether provided all at
+ * once or in small chunks.
+ */
+void test_parser__content_utf8() {
+
+    const char* elements[] = {
+        "clipboard",
+        "h\xc3\xa9llo w\xc3\xb6rld, caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e",
+        "\xe3\x81\x93\xe3\x82\x93\xe3\x81\xab\xe3\x81\xa1\xe3\x81\xaf"
+        "\xe4\xb8\x96\xe7\x95\x8c\xe3\x81\x93\xe3\x82\x93\xe3\x81\xab"
+        "\xe3\x81\xa1\xe3\x81\xaf\xe4\xb8\x96\xe7\x95\x8c",
+        "\xf0\x9f\x98\x80\xf0\x9f\x98\x81\xf0\x9f\x98\x82\xf0\x9f\x98\x83"
+        "\xf0\x9f\x98\x84\xf0\x9f\x98\x85\xf0\x9f\x98\x86\xf0\x9f\x98\x87",
+        "a\xf0\x9f\x98\x80" "bc\xe4\xb8\x96" "d\xc3\xa9" "efghijklmnopqrstuvwxyz"
+        "\xe7\x95\x8c" "0123456789\xf0\x9f\x98\x81",
+        NULL
+    };
+
+    verify_parse(elements, 0);
+    verify_parse(elements, SCALAR_CHUNK_SIZE);
+
+}
+
+/**
+ * Test which verifies that elements containing malformed UTF-8, such as
+ * stray continuation bytes and truncated multibyte characters, are parsed
+ * identically whether provided all at once or in small chunks. Such content
+ * must always be handled by the scalar parser.
+ */
+void test_parser__content_malformed() {
+
+    const char* elements[] = {
+        "clipboard",
+        "\x80\x81\x82\x83\x84\x85\x86\x87\x88\x89\x8a\x8b\x8c\x8d\x8e\x8f"
+        "\x90\x91\x92\x93\x94\x95\x96\x97",
+        "abcdefgh\xe3\x81ijklmnopqrstuvwxyz\xc3zyxwvutsrqponmlkjihgfedcba",
+        "\xff\xfe\xfd\xfc\xfb\xfa\xf9\xf8\xff\xfe\xfd\xfc\xfb\xfa\xf9\xf8"
+        "abcdefghijklmnopqrstuvwxyz",
+        "\xc3\xa9\xa9\xa9" "abcdefghijklmnopqrstuvwxyz0123456789",
+        NULL
+    };
+
+    verify_parse(elements, 0);
+    verify_parse(elements, SCALAR_CHUNK_SIZE);
+
+}
+
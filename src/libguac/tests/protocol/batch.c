@@ -0,0 +1,174 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol.h>
+#include <guacamole/protocol-batch.h>
+#include <guacamole/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The size of the buffer backing the batch used by write_instructions(). This
+ * is deliberately small enough that the batch must be flushed automatically
+ * before all instructions have been appended.
+ */
+#define TEST_BATCH_SIZE 96
+
+/**
+ * Writes a series of Guacamole instructions using a guac_protocol_batch
+ * wrapping a normal guac_socket for the given file descriptor, as well as
+ * the guac_protocol_send_*() equivalents of the batched instructions. The
+ * instructions written correspond to the instructions verified by
+ * read_expected_instructions(). The given file descriptor is automatically
+ * closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to write instructions to.
+ */
+static void write_instructions(int fd) {
+
+    /* Open guac socket */
+    guac_socket* socket = guac_socket_open(fd);
+
+    /* Write nothing if socket cannot be allocated (test will fail in parent
+     * process due to failure to read) */
+    if (socket == NULL) {
+        close(fd);
+        return;
+    }
+
+    const guac_layer default_layer = { .index = 0 };
+    const guac_layer buffer_layer = { .index = -12 };
+
+    char buffer[TEST_BATCH_SIZE];
+    guac_protocol_batch batch;
+    guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
+
+    /* Write batched instructions */
+    guac_protocol_batch_rect(&batch, &default_layer, 0, 0, 1024, 768);
+    guac_protocol_batch_cfill(&batch, GUAC_COMP_OVER, &default_layer,
+            0x12, 0x34, 0x56, 0xFF);
+    guac_protocol_batch_copy(&batch, &buffer_layer, -5, 7, 123456789, 2147483647,
+            GUAC_COMP_OVER, &default_layer, -2147483647 - 1, 10);
+    guac_protocol_batch_transfer(&batch, &buffer_layer, 1, 2, 3, 4,
+            GUAC_TRANSFER_BINARY_XOR, &default_layer, 5, 6);
+    guac_protocol_batch_flush(&batch);
+
+    /* Write equivalent individual instructions */
+    guac_protocol_send_rect(socket, &default_layer, 0, 0, 1024, 768);
+    guac_protocol_send_cfill(socket, GUAC_COMP_OVER, &default_layer,
+            0x12, 0x34, 0x56, 0xFF);
+    guac_protocol_send_copy(socket, &buffer_layer, -5, 7, 123456789, 2147483647,
+            GUAC_COMP_OVER, &default_layer, -2147483647 - 1, 10);
+    guac_protocol_send_transfer(socket, &buffer_layer, 1, 2, 3, 4,
+            GUAC_TRANSFER_BINARY_XOR, &default_layer, 5, 6);
+
+    guac_socket_flush(socket);
+
+    /* Close and free socket */
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Reads raw bytes from the given file descriptor until no further bytes
+ * remain, verifying that those bytes represent the series of Guacamole
+ * instructions expected to be written by write_instructions(). The given
+ * file descriptor is automatically closed as a result of calling this
+ * function.
+ *
+ * @param fd
+ *     The file descriptor to read data from.
+ */
+static void read_expected_instructions(int fd) {
+
+    char expected[] =
+        "4.rect,1.0,1.0,1.0,4.1024,3.768;"
+        "5.cfill,2.14,1.0,2.18,2.52,2.86,3.255;"
+        "4.copy,3.-12,2.-5,1.7,9.123456789,10.2147483647,2.14,1.0,"
+            "11.-2147483648,2.10;"
+        "8.transfer,3.-12,1.1,1.2,1.3,1.4,1.6,1.0,1.5,1.6;"
+        "4.rect,1.0,1.0,1.0,4.1024,3.768;"
+        "5.cfill,2.14,1.0,2.18,2.52,2.86,3.255;"
+        "4.copy,3.-12,2.-5,1.7,9.123456789,10.2147483647,2.14,1.0,"
+            "11.-2147483648,2.10;"
+        "8.transfer,3.-12,1.1,1.2,1.3,1.4,1.6,1.0,1.5,1.6;";
+
+    int numread;
+    char buffer[1024];
+    int offset = 0;
+
+    /* Read everything available into buffer */
+    while ((numread = read(fd, &(buffer[offset]),
+                    sizeof(buffer) - offset)) > 0) {
+        offset += numread;
+    }
+
+    /* Verify length of read data */
+    CU_ASSERT_EQUAL(offset, strlen(expected));
+
+    /* Add NULL terminator */
+    buffer[offset] = '\0';
+
+    /* Read value should be equal to expected value */
+    CU_ASSERT_STRING_EQUAL(buffer, expected);
+
+    /* File descriptor is no longer needed */
+    close(fd);
+
+}
+
+/**
+ * Tests that instructions appended to a guac_protocol_batch are written
+ * exactly as they would be by the corresponding guac_protocol_send_*()
+ * functions, including when the batch must be flushed automatically to make
+ * room. A child process is forked to write a series of instructions which
+ * are read and verified by the parent process.
+ */
+void test_protocol__batch() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    /* Fork into writer process (child) and reader process (parent) */
+    int childpid;
+    CU_ASSERT_NOT_EQUAL_FATAL((childpid = fork()), -1);
+
+    /* Attempt to write a series of instructions within the child process */
+    if (childpid == 0) {
+        close(read_fd);
+        write_instructions(write_fd);
+        exit(0);
+    }
+
+    /* Read and verify the expected instructions within the parent process */
+    close(write_fd);
+    read_expected_instructions(read_fd);
+
+}
+
@@ -0,0 +1,113 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <CUnit/CUnit.h>
+#include <guacamole/socket.h>
+
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Reads all data currently available from the given file descriptor,
+ * returning the number of bytes read.
+ *
+ * @param fd
+ *     The file descriptor to read data from. This must be a non-blocking
+ *     file descriptor, or must be the read end of a pipe whose write end has
+ *     been closed.
+ *
+ * @return
+ *     The number of bytes read.
+ */
+static int drain(int fd) {
+
+    char buffer[4096];
+    int numread;
+    int total = 0;
+
+    while ((numread = read(fd, buffer, sizeof(buffer))) > 0)
+        total += numread;
+
+    return total;
+
+}
+
+/**
+ * Tests that the number of bytes written reported for a file descriptor
+ * guac_socket starts at zero and accumulates exactly the number of bytes
+ * handed to the file descriptor across both normal and vectored writes.
+ */
+void test_socket__fd_bytes_written() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    guac_socket* socket = guac_socket_open(write_fd);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    /* Nothing has yet been written */
+    CU_ASSERT_EQUAL(guac_socket_get_bytes_written(socket), 0);
+
+    /* Buffered data is not counted until flushed */
+    guac_socket_write_string(socket, "4.sync,");
+    CU_ASSERT_EQUAL(guac_socket_get_bytes_written(socket), 0);
+
+    guac_socket_flush(socket);
+    CU_ASSERT_EQUAL(guac_socket_get_bytes_written(socket), 7);
+
+    /* Subsequent writes accumulate rather than replacing the total */
+    guac_socket_vector vector[] = {
+        { "1.0", 3 },
+        { ";",   1 }
+    };
+
+    guac_socket_write_vector(socket, vector, 2);
+    guac_socket_write_string(socket, "4.nop;");
+    guac_socket_flush(socket);
+    CU_ASSERT_EQUAL(guac_socket_get_bytes_written(socket), 17);
+
+    /* The total must match the data actually received */
+    guac_socket_free(socket);
+    CU_ASSERT_EQUAL(drain(read_fd), 17);
+
+    close(read_fd);
+
+}
+
+/**
+ * Tests that sockets which do not track the number of bytes written, such as
+ * those with no write handler, always report zero bytes written.
+ */
+void test_socket__bytes_written_untracked() {
+
+    guac_socket* socket = guac_socket_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    guac_socket_write_string(socket, "4.sync,1.0;");
+    guac_socket_flush(socket);
+    CU_ASSERT_EQUAL(guac_socket_get_bytes_written(socket), 0);
+
+    guac_socket_free(socket);
+
+}
+
@@ -0,0 +1,186 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The number of separate writes made to the socket.
+ */
+#define TEST_WRITES 1000
+
+/**
+ * The initial size of the output buffer of the socket under test. This is
+ * intentionally tiny such that nearly every write overflows the buffer.
+ */
+#define TEST_BUFFER_SIZE 64
+
+/**
+ * The maximum size that the output buffer of the socket under test may grow
+ * to.
+ */
+#define TEST_MAX_BUFFER_SIZE 4096
+
+/**
+ * Returns the number of bytes written by the given write to the socket, where
+ * the first write is write #0. Early writes are large, such that the output
+ * buffer will grow, while later writes are small, such that the output
+ * buffer will shrink.
+ *
+ * @param index
+ *     The index of the write.
+ *
+ * @return
+ *     The number of bytes written by the given write.
+ */
+static int get_write_length(int index) {
+    if (index < TEST_WRITES / 2)
+        return 100 + (index * 37) % 400;
+    return 1 + index % 7;
+}
+
+/**
+ * Writes a series of blocks of data of varying size using a guac_socket with
+ * an adaptive output buffer wrapping the given file descriptor, flushing
+ * periodically. The given file descriptor is automatically closed as a result
+ * of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to write data to.
+ */
+static void write_blocks(int fd) {
+
+    char block[512];
+
+    /* Open guac socket */
+    guac_socket* socket = guac_socket_open_buffered(fd, TEST_BUFFER_SIZE,
+            TEST_MAX_BUFFER_SIZE);
+
+    /* Write nothing if socket cannot be allocated (test will fail in parent
+     * process due to failure to read) */
+    if (socket == NULL) {
+        close(fd);
+        return;
+    }
+
+    /* Write blocks, each block consisting of a single repeated character */
+    for (int i = 0; i < TEST_WRITES; i++) {
+
+        int length = get_write_length(i);
+        memset(block, 'a' + i % 26, length);
+        guac_socket_write(socket, block, length);
+
+        /* Flush every so often */
+        if (i % 3 == 0)
+            guac_socket_flush(socket);
+
+    }
+
+    guac_socket_flush(socket);
+
+    /* Close and free socket */
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Reads raw bytes from the given file descriptor until no further bytes
+ * remain, verifying that those bytes are the data expected to be written by
+ * write_blocks(). The given file descriptor is automatically closed as a
+ * result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to read data from.
+ */
+static void read_expected_blocks(int fd) {
+
+    int expected_length = 0;
+    for (int i = 0; i < TEST_WRITES; i++)
+        expected_length += get_write_length(i);
+
+    char* expected = malloc(expected_length);
+    char* buffer = malloc(expected_length + 1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(expected);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(buffer);
+
+    /* Build expected data */
+    char* current = expected;
+    for (int i = 0; i < TEST_WRITES; i++) {
+        int length = get_write_length(i);
+        memset(current, 'a' + i % 26, length);
+        current += length;
+    }
+
+    int numread;
+    int offset = 0;
+
+    /* Read everything available into buffer */
+    while ((numread = read(fd, &(buffer[offset]),
+                    expected_length + 1 - offset)) > 0) {
+        offset += numread;
+    }
+
+    /* Read data should be exactly the expected data */
+    CU_ASSERT_EQUAL(offset, expected_length);
+    CU_ASSERT(memcmp(buffer, expected, expected_length) == 0);
+
+    free(expected);
+    free(buffer);
+
+    /* File descriptor is no longer needed */
+    close(fd);
+
+}
+
+/**
+ * Tests that the file descriptor implementation of guac_socket preserves all
+ * written data while its output buffer grows and shrinks. A child process is
+ * forked to write the data which is read and verified by the parent process.
+ */
+void test_socket__fd_send_adaptive() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    /* Fork into writer process (child) and reader process (parent) */
+    int childpid;
+    CU_ASSERT_NOT_EQUAL_FATAL((childpid = fork()), -1);
+
+    /* Attempt to write data within the child process */
+    if (childpid == 0) {
+        close(read_fd);
+        write_blocks(write_fd);
+        exit(0);
+    }
+
+    /* Read and verify the expected data within the parent process */
+    close(write_fd);
+    read_expected_blocks(read_fd);
+
+}
+
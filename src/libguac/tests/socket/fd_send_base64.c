@@ -0,0 +1,215 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The total number of bytes of binary data to write as base64. This value is
+ * intentionally larger than GUAC_SOCKET_OUTPUT_BUFFER_SIZE and is not a
+ * multiple of three, such that both flushing of the internal buffer and
+ * padding are exercised.
+ */
+#define TEST_DATA_LENGTH 20000
+
+/**
+ * The sizes of each successive write of binary data. These sizes are chosen
+ * such that writes frequently end in the middle of a base64 triplet, and such
+ * that writes both smaller and larger than any SIMD block size are made. The
+ * final write consumes whatever data remains.
+ */
+static const int WRITE_SIZES[] = { 1, 1, 2, 4, 7, 11, 31, 64, 100, 1000, 5001 };
+
+/**
+ * Populates the given buffer with deterministic, non-repeating binary data
+ * covering all possible byte values.
+ *
+ * @param data
+ *     The buffer to populate. This buffer must be at least TEST_DATA_LENGTH
+ *     bytes long.
+ */
+static void generate_data(unsigned char* data) {
+
+    unsigned int value = 12345;
+    for (int i = 0; i < TEST_DATA_LENGTH; i++) {
+        value = value * 1103515245 + 12345;
+        data[i] = (value >> 16) & 0xFF;
+    }
+
+}
+
+/**
+ * Straightforward reference implementation of base64 encoding, used to
+ * produce the data expected to be read from the socket. The output buffer
+ * is null-terminated.
+ *
+ * @param data
+ *     The binary data to encode.
+ *
+ * @param length
+ *     The number of bytes of binary data to encode.
+ *
+ * @param output
+ *     The buffer to populate with the encoded data. This buffer must be large
+ *     enough to hold the encoded data and its null terminator.
+ */
+static void reference_encode(const unsigned char* data, int length,
+        char* output) {
+
+    const char* alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (int i = 0; i < length; i += 3) {
+
+        int remaining = length - i;
+        unsigned int triplet = data[i] << 16;
+        if (remaining > 1) triplet |= data[i + 1] << 8;
+        if (remaining > 2) triplet |= data[i + 2];
+
+        *(output++) = alphabet[(triplet >> 18) & 0x3F];
+        *(output++) = alphabet[(triplet >> 12) & 0x3F];
+        *(output++) = remaining > 1 ? alphabet[(triplet >> 6) & 0x3F] : '=';
+        *(output++) = remaining > 2 ? alphabet[triplet & 0x3F] : '=';
+
+    }
+
+    *output = '\0';
+
+}
+
+/**
+ * Writes the test data as base64 using a normal guac_socket wrapping the
+ * given file descriptor, split across writes of varying sizes. The given file
+ * descriptor is automatically closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to write base64 data to.
+ */
+static void write_base64(int fd) {
+
+    unsigned char data[TEST_DATA_LENGTH];
+    generate_data(data);
+
+    /* Open guac socket */
+    guac_socket* socket = guac_socket_open(fd);
+
+    /* Write nothing if socket cannot be allocated (test will fail in parent
+     * process due to failure to read) */
+    if (socket == NULL) {
+        close(fd);
+        return;
+    }
+
+    /* Write data in chunks of varying size */
+    int offset = 0;
+    for (int i = 0; i < sizeof(WRITE_SIZES) / sizeof(WRITE_SIZES[0]); i++) {
+        guac_socket_write_base64(socket, data + offset, WRITE_SIZES[i]);
+        offset += WRITE_SIZES[i];
+    }
+
+    /* Write all remaining data at once */
+    guac_socket_write_base64(socket, data + offset,
+            TEST_DATA_LENGTH - offset);
+
+    guac_socket_flush_base64(socket);
+    guac_socket_flush(socket);
+
+    /* Close and free socket */
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Reads raw bytes from the given file descriptor until no further bytes
+ * remain, verifying that those bytes are the base64 encoding of the test
+ * data written by write_base64(). The given file descriptor is automatically
+ * closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to read data from.
+ */
+static void read_expected_base64(int fd) {
+
+    unsigned char data[TEST_DATA_LENGTH];
+    generate_data(data);
+
+    char expected[(TEST_DATA_LENGTH + 2) / 3 * 4 + 1];
+    reference_encode(data, TEST_DATA_LENGTH, expected);
+
+    int numread;
+    char buffer[sizeof(expected)];
+    int offset = 0;
+
+    /* Read everything available into buffer */
+    while ((numread = read(fd, &(buffer[offset]),
+                    sizeof(buffer) - offset - 1)) > 0) {
+        offset += numread;
+    }
+
+    /* Verify length of read data */
+    CU_ASSERT_EQUAL(offset, strlen(expected));
+
+    /* Add NULL terminator */
+    buffer[offset] = '\0';
+
+    /* Read value should be equal to expected value */
+    CU_ASSERT_STRING_EQUAL(buffer, expected);
+
+    /* File descriptor is no longer needed */
+    close(fd);
+
+}
+
+/**
+ * Tests that the file descriptor implementation of guac_socket properly
+ * encodes base64 data, including data split across many writes of varying
+ * size. A child process is forked to write the base64 data which is read and
+ * verified by the parent process.
+ */
+void test_socket__fd_send_base64() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    /* Fork into writer process (child) and reader process (parent) */
+    int childpid;
+    CU_ASSERT_NOT_EQUAL_FATAL((childpid = fork()), -1);
+
+    /* Attempt to write base64 data within the child process */
+    if (childpid == 0) {
+        close(read_fd);
+        write_base64(write_fd);
+        exit(0);
+    }
+
+    /* Read and verify the expected base64 data within the parent process */
+    close(write_fd);
+    read_expected_base64(read_fd);
+
+}
+
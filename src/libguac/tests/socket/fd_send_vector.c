@@ -0,0 +1,175 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/socket.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The size of the large buffer written as part of each vector. This value is
+ * intentionally larger than GUAC_SOCKET_OUTPUT_BUFFER_SIZE such that the
+ * vector cannot be appended to the internal buffer of the socket.
+ */
+#define LARGE_BUFFER_LENGTH 20000
+
+/**
+ * Populates the given buffer with a deterministic pattern of printable
+ * characters.
+ *
+ * @param buffer
+ *     The buffer to populate. This buffer must be at least
+ *     LARGE_BUFFER_LENGTH bytes long.
+ */
+static void generate_large_buffer(char* buffer) {
+    for (int i = 0; i < LARGE_BUFFER_LENGTH; i++)
+        buffer[i] = 'A' + (i % 26);
+}
+
+/**
+ * Writes a series of vectors, interleaved with normal writes, using a normal
+ * guac_socket wrapping the given file descriptor. The data written
+ * corresponds to the data verified by read_expected_data(). The given file
+ * descriptor is automatically closed as a result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to write data to.
+ */
+static void write_vectors(int fd) {
+
+    char large[LARGE_BUFFER_LENGTH];
+    generate_large_buffer(large);
+
+    /* Open guac socket */
+    guac_socket* socket = guac_socket_open(fd);
+
+    /* Write nothing if socket cannot be allocated (test will fail in parent
+     * process due to failure to read) */
+    if (socket == NULL) {
+        close(fd);
+        return;
+    }
+
+    /* Vector small enough to be buffered */
+    guac_socket_vector small_vector[] = {
+        { "abc", 3 },
+        { "",    0 },
+        { "def", 3 }
+    };
+
+    /* Vector which must be written directly */
+    guac_socket_vector large_vector[] = {
+        { "<",   1                   },
+        { large, LARGE_BUFFER_LENGTH },
+        { ">",   1                   }
+    };
+
+    /* Write vectors, interleaved with normal writes */
+    guac_socket_write_string(socket, "123");
+    guac_socket_write_vector(socket, small_vector, 3);
+    guac_socket_write_vector(socket, large_vector, 3);
+    guac_socket_write_string(socket, "456");
+    guac_socket_write(socket, large, LARGE_BUFFER_LENGTH);
+    guac_socket_write_vector(socket, small_vector, 3);
+    guac_socket_flush(socket);
+
+    /* Close and free socket */
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Reads raw bytes from the given file descriptor until no further bytes
+ * remain, verifying that those bytes are the data expected to be written by
+ * write_vectors(). The given file descriptor is automatically closed as a
+ * result of calling this function.
+ *
+ * @param fd
+ *     The file descriptor to read data from.
+ */
+static void read_expected_data(int fd) {
+
+    char large[LARGE_BUFFER_LENGTH + 1];
+    generate_large_buffer(large);
+    large[LARGE_BUFFER_LENGTH] = '\0';
+
+    char expected[LARGE_BUFFER_LENGTH * 2 + 64];
+    snprintf(expected, sizeof(expected), "123abcdef<%s>456%sabcdef",
+            large, large);
+
+    int numread;
+    char buffer[sizeof(expected)];
+    int offset = 0;
+
+    /* Read everything available into buffer */
+    while ((numread = read(fd, &(buffer[offset]),
+                    sizeof(buffer) - offset - 1)) > 0) {
+        offset += numread;
+    }
+
+    /* Verify length of read data */
+    CU_ASSERT_EQUAL(offset, strlen(expected));
+
+    /* Add NULL terminator */
+    buffer[offset] = '\0';
+
+    /* Read value should be equal to expected value */
+    CU_ASSERT_STRING_EQUAL(buffer, expected);
+
+    /* File descriptor is no longer needed */
+    close(fd);
+
+}
+
+/**
+ * Tests that the file descriptor implementation of guac_socket properly
+ * implements vectored writes, preserving the order of data relative to
+ * normal, buffered writes. A child process is forked to write the data which
+ * is read and verified by the parent process.
+ */
+void test_socket__fd_send_vector() {
+
+    int fd[2];
+
+    /* Create pipe */
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    int read_fd = fd[0];
+    int write_fd = fd[1];
+
+    /* Fork into writer process (child) and reader process (parent) */
+    int childpid;
+    CU_ASSERT_NOT_EQUAL_FATAL((childpid = fork()), -1);
+
+    /* Attempt to write data within the child process */
+    if (childpid == 0) {
+        close(read_fd);
+        write_vectors(write_fd);
+        exit(0);
+    }
+
+    /* Read and verify the expected data within the parent process */
+    close(write_fd);
+    read_expected_data(read_fd);
+
+}
+
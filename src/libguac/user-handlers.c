@@ -21,13 +21,16 @@
 
 #include "guacamole/client.h"
 #include "guacamole/object.h"
+#include "guacamole/opcode.h"
 #include "guacamole/protocol.h"
+#include "guacamole/socket.h"
 #include "guacamole/stream.h"
 #include "guacamole/timestamp.h"
 #include "guacamole/user.h"
 #include "user-handlers.h"
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -68,6 +71,119 @@ __guac_instruction_handler_mapping __guac_handshake_handler_map[] = {
     {NULL,       NULL}
 };
 
+/**
+ * Perfect hash index of the opcodes within __guac_instruction_handler_map,
+ * built upon first use.
+ */
+static guac_opcode_index* __guac_instruction_handler_index = NULL;
+
+/**
+ * Perfect hash index of the opcodes within __guac_handshake_handler_map,
+ * built upon first use.
+ */
+static guac_opcode_index* __guac_handshake_handler_index = NULL;
+
+/**
+ * Guard ensuring the handler map indexes are built exactly once.
+ */
+static pthread_once_t __guac_handler_index_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Builds the perfect hash indexes of both the instruction and handshake
+ * handler maps. This function is invoked only once, via pthread_once().
+ */
+static void __guac_init_handler_indexes(void) {
+
+    __guac_instruction_handler_index = guac_opcode_index_alloc(
+            &__guac_instruction_handler_map[0].opcode,
+            sizeof(__guac_instruction_handler_mapping));
+
+    __guac_handshake_handler_index = guac_opcode_index_alloc(
+            &__guac_handshake_handler_map[0].opcode,
+            sizeof(__guac_instruction_handler_mapping));
+
+}
+
+/**
+ * Updates the round-trip time, throughput, and queue depth statistics of the
+ * given user in response to the receipt of a sync instruction confirming a
+ * frame. Throughput is measured from the number of bytes handed to the user's
+ * socket over intervals of at least GUAC_USER_THROUGHPUT_INTERVAL
+ * milliseconds. Because the amount of data sent is bounded by demand as well
+ * as by the capacity of the connection, estimates are only lowered by samples
+ * taken while data was backing up, and are otherwise raised quickly.
+ *
+ * @param user
+ *     The user whose statistics should be updated.
+ *
+ * @param current
+ *     The current time, in milliseconds.
+ *
+ * @param frame_duration
+ *     The number of milliseconds between the confirmed frame being sent and
+ *     its confirmation being received.
+ */
+static void __guac_user_update_stats(guac_user* user,
+        guac_timestamp current, int frame_duration) {
+
+    /* The statistics are written only by this thread, but may be read by
+     * others at any time, so each is updated with a single atomic store */
+    int sync_rtt = user->sync_rtt;
+    int min_sync_rtt = user->min_sync_rtt;
+    int throughput = user->throughput;
+
+    /* Smooth round-trip time (weight of 1/8 for new samples) */
+    if (sync_rtt == 0)
+        sync_rtt = frame_duration;
+    else
+        sync_rtt += (frame_duration - sync_rtt) / 8;
+
+    __atomic_store_n(&user->sync_rtt, sync_rtt, __ATOMIC_RELAXED);
+
+    /* Track baseline round-trip time of an uncongested connection */
+    if (min_sync_rtt == 0 || frame_duration < min_sync_rtt) {
+        min_sync_rtt = frame_duration > 0 ? frame_duration : 1;
+        __atomic_store_n(&user->min_sync_rtt, min_sync_rtt, __ATOMIC_RELAXED);
+    }
+
+    int queued = guac_socket_get_queued(user->socket);
+    uint64_t written = guac_socket_get_bytes_written(user->socket);
+
+    /* Begin first throughput sample */
+    if (user->__throughput_timestamp == 0) {
+        user->__throughput_timestamp = current;
+        user->__throughput_bytes = written;
+        __atomic_store_n(&user->queued, queued, __ATOMIC_RELAXED);
+        return;
+    }
+
+    int elapsed = current - user->__throughput_timestamp;
+    if (elapsed < GUAC_USER_THROUGHPUT_INTERVAL)
+        return;
+
+    int sample = (written - user->__throughput_bytes) * 1000 / elapsed;
+
+    /* Consider the connection saturated if at least a quarter second's worth
+     * of data (and never less than a few KB) was waiting both at the start
+     * and end of the sample */
+    int saturated_queue = sample / 4;
+    if (saturated_queue < GUAC_USER_SATURATED_QUEUE)
+        saturated_queue = GUAC_USER_SATURATED_QUEUE;
+
+    /* Raise estimate quickly, but lower only if the connection was actually
+     * saturated throughout the sample */
+    if (sample > throughput)
+        throughput += (sample - throughput + 1) / 2;
+    else if (queued >= saturated_queue && user->queued >= saturated_queue)
+        throughput += (sample - throughput) / 8;
+
+    user->__throughput_timestamp = current;
+    user->__throughput_bytes = written;
+    __atomic_store_n(&user->throughput, throughput, __ATOMIC_RELAXED);
+    __atomic_store_n(&user->queued, queued, __ATOMIC_RELAXED);
+
+}
+
 /**
  * Parses a 64-bit integer from the given string. It is assumed that the string
  * will contain only decimal digits, with an optional leading minus sign.
@@ -139,13 +255,17 @@ int __guac_handle_sync(guac_user* user, int argc, char** argv) {
         /* Record baseline duration of frame by excluding lag */
         user->last_frame_duration = frame_duration - user->processing_lag;
 
+        __guac_user_update_stats(user, current, frame_duration);
+
     }
 
     /* Log received timestamp and calculated lag (at TRACE level only) */
     guac_user_log(user, GUAC_LOG_TRACE,
             "User confirmation of frame %" PRIu64 "ms received "
-            "at %" PRIu64 "ms (processing_lag=%ims)",
-            timestamp, current, user->processing_lag);
+            "at %" PRIu64 "ms (processing_lag=%ims, sync_rtt=%ims, "
+            "throughput=%iB/s, queued=%iB)", timestamp, current,
+            user->processing_lag, user->sync_rtt, user->throughput,
+            user->queued);
 
     if (user->sync_handler)
         return user->sync_handler(user, timestamp);
@@ -749,15 +869,32 @@ void guac_free_mimetypes(char** mimetypes) {
 int __guac_user_call_opcode_handler(__guac_instruction_handler_mapping* map,
         guac_user* user, const char* opcode, int argc, char** argv) {
 
-    /* For each defined instruction */
-    __guac_instruction_handler_mapping* current = map;
-    while (current->opcode != NULL) {
+    pthread_once(&__guac_handler_index_once, __guac_init_handler_indexes);
 
-        /* If recognized, call handler */
-        if (strcmp(opcode, current->opcode) == 0)
-            return current->handler(user, argc, argv);
+    guac_opcode_index* index = NULL;
+    if (map == __guac_instruction_handler_map)
+        index = __guac_instruction_handler_index;
+    else if (map == __guac_handshake_handler_map)
+        index = __guac_handshake_handler_index;
 
-        current++;
+    /* Look up handler via the map's index, if available */
+    if (index != NULL) {
+        int position = guac_opcode_index_find(index, opcode);
+        if (position != -1)
+            return map[position].handler(user, argc, argv);
+    }
+
+    /* Otherwise, fall back to scanning each defined instruction */
+    else {
+        __guac_instruction_handler_mapping* current = map;
+        while (current->opcode != NULL) {
+
+            /* If recognized, call handler */
+            if (strcmp(opcode, current->opcode) == 0)
+                return current->handler(user, argc, argv);
+
+            current++;
+        }
     }
 
     /* If unrecognized, log and ignore */
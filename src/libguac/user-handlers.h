@@ -283,9 +283,12 @@ char** guac_copy_mimetypes(char** mimetypes, int count);
  * Call the appropriate handler defined by the given user for the given
  * instruction. A comparison is made between the instruction opcode and the
  * initial handler lookup table defined in the map that is provided to this
- * function. If an entry for the instruction is found in the provided map,
- * the handler defined in that map will be called and the value returned.  If
- * no match is found, it is silently ignored.
+ * function. Lookups within __guac_instruction_handler_map and
+ * __guac_handshake_handler_map are performed using a perfect hash of their
+ * opcodes, while any other map is scanned linearly. If an entry for the
+ * instruction is found in the provided map, the handler defined in that map
+ * will be called and the value returned.  If no match is found, it is
+ * silently ignored.
  *
  * @param map
  *     The array that holds the opcode to handler mappings.
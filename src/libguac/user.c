@@ -53,6 +53,7 @@ guac_user* guac_user_alloc() {
     user->last_received_timestamp = guac_timestamp_current();
     user->last_frame_duration = 0;
     user->processing_lag = 0;
+    user->queued = -1;
     user->active = 1;
 
     /* Allocate stream pool */
@@ -260,7 +261,8 @@ void guac_user_stream_png(guac_user* user, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/png", x, y);
 
     /* Write PNG data */
-    guac_png_write(socket, stream, surface);
+    guac_png_write(socket, stream, surface,
+            GUAC_CLIENT_PNG_DEFAULT_COMPRESSION, GUAC_PNG_FILTER_DEFAULT);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -303,7 +305,8 @@ void guac_user_stream_webp(guac_user* user, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/webp", x, y);
 
     /* Write WebP data */
-    guac_webp_write(socket, stream, surface, quality, lossless);
+    guac_webp_write(socket, stream, surface, quality, lossless,
+            GUAC_WEBP_DEFAULT_METHOD);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -480,6 +480,15 @@ static int guac_rdp_handle_connection(guac_client* client) {
      * heuristics) */
     guac_common_display_set_lossless(rdp_client->display, settings->lossless);
 
+    /* Encode images using as many threads as requested */
+    guac_common_display_set_encode_threads(rdp_client->display,
+            settings->encoding_threads);
+
+    /* Send repeated images as copies of cached images, if enabled */
+    if (settings->image_cache_size > 0)
+        guac_common_display_set_image_cache_size(rdp_client->display,
+                (size_t) settings->image_cache_size * 1024);
+
     rdp_client->current_surface = rdp_client->display->default_surface;
 
     rdp_client->available_svc = guac_common_list_alloc();
@@ -546,6 +555,15 @@ static int guac_rdp_handle_connection(guac_client* client) {
             int processing_lag = guac_client_get_processing_lag(client);
             guac_timestamp frame_start = guac_timestamp_current();
 
+            /* Lengthen frames if bandwidth is scarce */
+            guac_common_quality_params quality;
+            guac_common_quality_controller_get(rdp_client->display->quality_controller,
+                    &quality);
+
+            int frame_duration = GUAC_RDP_FRAME_DURATION;
+            if (quality.frame_duration > frame_duration)
+                frame_duration = quality.frame_duration;
+
             /* Read server messages until frame is built */
             do {
 
@@ -566,8 +584,7 @@ static int guac_rdp_handle_connection(guac_client* client) {
 
                 /* Calculate time remaining in frame */
                 frame_end = guac_timestamp_current();
-                frame_remaining = frame_start + GUAC_RDP_FRAME_DURATION
-                                - frame_end;
+                frame_remaining = frame_start + frame_duration - frame_end;
 
                 /* Calculate time that client needs to catch up */
                 int time_elapsed = frame_end - last_frame_end;
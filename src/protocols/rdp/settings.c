@@ -142,6 +142,9 @@ const char* GUAC_RDP_CLIENT_ARGS[] = {
 
     "force-lossless",
     "normalize-clipboard",
+    "encoding-threads",
+    "image-cache-size",
+    "resync-lagging-users",
     NULL
 };
 
@@ -669,6 +672,30 @@ enum RDP_ARGS_IDX {
      */
     IDX_NORMALIZE_CLIPBOARD,
 
+    /**
+     * The number of threads which should concurrently encode the images sent
+     * for graphical updates. By default, all images are encoded one at a time
+     * by the thread handling updates.
+     */
+    IDX_ENCODING_THREADS,
+
+    /**
+     * The maximum total size of the previously-sent images which should be
+     * cached within buffers of the client, such that repeated updates can be
+     * sent as copies from those buffers, in kilobytes. By default, images are
+     * not cached.
+     */
+    IDX_IMAGE_CACHE_SIZE,
+
+    /**
+     * "true" if each user should receive graphical updates at its own pace,
+     * with users that fall behind having frames skipped and being
+     * resynchronized with the current state of the display, "false" or blank
+     * otherwise. By default, all users receive every frame, and the slowest
+     * user limits the rate at which frames are sent to all users.
+     */
+    IDX_RESYNC_LAGGING_USERS,
+
     RDP_ARGS_COUNT
 };
 
@@ -829,6 +856,21 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
                 IDX_FORCE_LOSSLESS, 0);
 
+    /* Image encoding threads */
+    settings->encoding_threads =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_ENCODING_THREADS, 1);
+
+    /* Image cache size (in kilobytes) */
+    settings->image_cache_size =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_IMAGE_CACHE_SIZE, 0);
+
+    /* Per-user pacing of graphical updates */
+    settings->resync_lagging_users =
+        guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_RESYNC_LAGGING_USERS, 0);
+
     /* Domain */
     settings->domain =
         guac_user_parse_args_string(user, GUAC_RDP_CLIENT_ARGS, argv,
@@ -198,6 +198,26 @@ typedef struct guac_rdp_settings {
      */
     int lossless;
 
+    /**
+     * The number of threads which should concurrently encode the images sent
+     * for graphical updates.
+     */
+    int encoding_threads;
+
+    /**
+     * The maximum total size of the previously-sent images which should be
+     * cached within buffers of the client, in kilobytes, or zero if images
+     * should not be cached.
+     */
+    int image_cache_size;
+
+    /**
+     * Whether each user should receive graphical updates at its own pace,
+     * with users that fall behind having frames skipped and being
+     * resynchronized with the current state of the display.
+     */
+    int resync_lagging_users;
+
     /**
      * Whether audio is enabled.
      */
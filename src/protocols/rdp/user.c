@@ -68,6 +68,18 @@ int guac_rdp_user_join_handler(guac_user* user, int argc, char** argv) {
         /* Store owner's settings at client level */
         rdp_client->settings = settings;
 
+        /* Pace output individually for each user if requested, skipping
+         * frames for users that cannot keep up. This must be enabled before
+         * anything is broadcast, and before the owner has been added as a
+         * user of the connection. */
+        if (settings->resync_lagging_users
+                && guac_client_enable_broadcast_ring(user->client,
+                    GUAC_CLIENT_DEFAULT_BROADCAST_MAX_LAG,
+                    GUAC_CLIENT_LAG_RESYNC))
+            guac_user_log(user, GUAC_LOG_WARNING, "Output cannot be paced "
+                    "for each user individually. All users will receive the "
+                    "same frames.");
+
         /* Start client thread */
         if (pthread_create(&rdp_client->client_thread, NULL,
                     guac_rdp_client_thread, user->client)) {
@@ -178,3 +190,20 @@ int guac_rdp_user_leave_handler(guac_user* user) {
     return 0;
 }
 
+int guac_rdp_user_resync_handler(guac_user* user, guac_timestamp timestamp) {
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) user->client->data;
+
+    pthread_rwlock_rdlock(&(rdp_client->lock));
+
+    /* Send only what has changed since the given frame, if the display still
+     * exists */
+    if (rdp_client->display != NULL)
+        guac_common_display_resync(rdp_client->display, user, user->socket,
+                timestamp);
+
+    pthread_rwlock_unlock(&(rdp_client->lock));
+
+    return 0;
+}
+
@@ -60,6 +60,7 @@ int guac_client_init(guac_client* client) {
     /* Set handlers */
     client->join_handler = guac_vnc_user_join_handler;
     client->leave_handler = guac_vnc_user_leave_handler;
+    client->resync_handler = guac_vnc_user_resync_handler;
     client->free_handler = guac_vnc_client_free_handler;
 
     return 0;
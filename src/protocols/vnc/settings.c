@@ -93,6 +93,9 @@ const char* GUAC_VNC_CLIENT_ARGS[] = {
     "wol-wait-time",
 
     "force-lossless",
+    "encoding-threads",
+    "image-cache-size",
+    "resync-lagging-users",
     NULL
 };
 
@@ -381,6 +384,30 @@ enum VNC_ARGS_IDX {
      */
     IDX_FORCE_LOSSLESS,
 
+    /**
+     * The number of threads which should concurrently encode the images sent
+     * for graphical updates. By default, all images are encoded one at a time
+     * by the thread handling updates.
+     */
+    IDX_ENCODING_THREADS,
+
+    /**
+     * The maximum total size of the previously-sent images which should be
+     * cached within buffers of the client, such that repeated updates can be
+     * sent as copies from those buffers, in kilobytes. By default, images are
+     * not cached.
+     */
+    IDX_IMAGE_CACHE_SIZE,
+
+    /**
+     * "true" if each user should receive graphical updates at its own pace,
+     * with users that fall behind having frames skipped and being
+     * resynchronized with the current state of the display, "false" or blank
+     * otherwise. By default, all users receive every frame, and the slowest
+     * user limits the rate at which frames are sent to all users.
+     */
+    IDX_RESYNC_LAGGING_USERS,
+
     VNC_ARGS_COUNT
 };
 
@@ -445,6 +472,21 @@ guac_vnc_settings* guac_vnc_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
                 IDX_FORCE_LOSSLESS, false);
 
+    /* Image encoding threads */
+    settings->encoding_threads =
+        guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_ENCODING_THREADS, 1);
+
+    /* Image cache size (in kilobytes) */
+    settings->image_cache_size =
+        guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_IMAGE_CACHE_SIZE, 0);
+
+    /* Per-user pacing of graphical updates */
+    settings->resync_lagging_users =
+        guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_RESYNC_LAGGING_USERS, false);
+
 #ifdef ENABLE_VNC_REPEATER
     /* Set repeater parameters if specified */
     settings->dest_host =
@@ -83,6 +83,26 @@ typedef struct guac_vnc_settings {
      */
     bool lossless;
 
+    /**
+     * The number of threads which should concurrently encode the images sent
+     * for graphical updates.
+     */
+    int encoding_threads;
+
+    /**
+     * The maximum total size of the previously-sent images which should be
+     * cached within buffers of the client, in kilobytes, or zero if images
+     * should not be cached.
+     */
+    int image_cache_size;
+
+    /**
+     * Whether each user should receive graphical updates at its own pace,
+     * with users that fall behind having frames skipped and being
+     * resynchronized with the current state of the display.
+     */
+    bool resync_lagging_users;
+
 #ifdef ENABLE_VNC_REPEATER
     /**
      * The VNC host to connect to, if using a repeater.
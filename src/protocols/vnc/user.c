@@ -66,6 +66,18 @@ int guac_vnc_user_join_handler(guac_user* user, int argc, char** argv) {
         /* Store owner's settings at client level */
         vnc_client->settings = settings;
 
+        /* Pace output individually for each user if requested, skipping
+         * frames for users that cannot keep up. This must be enabled before
+         * anything is broadcast, and before the owner has been added as a
+         * user of the connection. */
+        if (settings->resync_lagging_users
+                && guac_client_enable_broadcast_ring(user->client,
+                    GUAC_CLIENT_DEFAULT_BROADCAST_MAX_LAG,
+                    GUAC_CLIENT_LAG_RESYNC))
+            guac_user_log(user, GUAC_LOG_WARNING, "Output cannot be paced "
+                    "for each user individually. All users will receive the "
+                    "same frames.");
+
         /* Start client thread */
         if (pthread_create(&vnc_client->client_thread, NULL, guac_vnc_client_thread, user->client)) {
             guac_user_log(user, GUAC_LOG_ERROR, "Unable to start VNC client thread.");
@@ -134,3 +146,15 @@ int guac_vnc_user_leave_handler(guac_user* user) {
     return 0;
 }
 
+int guac_vnc_user_resync_handler(guac_user* user, guac_timestamp timestamp) {
+
+    guac_vnc_client* vnc_client = (guac_vnc_client*) user->client->data;
+
+    /* Send only what has changed since the given frame */
+    if (vnc_client->display)
+        guac_common_display_resync(vnc_client->display, user, user->socket,
+                timestamp);
+
+    return 0;
+}
+
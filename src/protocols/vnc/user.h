@@ -34,5 +34,11 @@ guac_user_join_handler guac_vnc_user_join_handler;
  */
 guac_user_leave_handler guac_vnc_user_leave_handler;
 
+/**
+ * Handler for users that have fallen behind the connection and must be
+ * resynchronized with the current state of the display.
+ */
+guac_user_resync_handler guac_vnc_user_resync_handler;
+
 #endif
 
@@ -439,6 +439,15 @@ void* guac_vnc_client_thread(void* data) {
      * heuristics) */
     guac_common_display_set_lossless(vnc_client->display, settings->lossless);
 
+    /* Encode images using as many threads as requested */
+    guac_common_display_set_encode_threads(vnc_client->display,
+            settings->encoding_threads);
+
+    /* Send repeated images as copies of cached images, if enabled */
+    if (settings->image_cache_size > 0)
+        guac_common_display_set_image_cache_size(vnc_client->display,
+                (size_t) settings->image_cache_size * 1024);
+
     /* If not read-only, set an appropriate cursor */
     if (settings->read_only == 0) {
         if (settings->remote_cursor)
@@ -463,6 +472,15 @@ void* guac_vnc_client_thread(void* data) {
             int processing_lag = guac_client_get_processing_lag(client);
             guac_timestamp frame_start = guac_timestamp_current();
 
+            /* Lengthen frames if bandwidth is scarce */
+            guac_common_quality_params quality;
+            guac_common_quality_controller_get(vnc_client->display->quality_controller,
+                    &quality);
+
+            int frame_duration = GUAC_VNC_FRAME_DURATION;
+            if (quality.frame_duration > frame_duration)
+                frame_duration = quality.frame_duration;
+
             /* Read server messages until frame is built */
             do {
 
@@ -479,8 +497,7 @@ void* guac_vnc_client_thread(void* data) {
 
                 /* Calculate time remaining in frame */
                 frame_end = guac_timestamp_current();
-                frame_remaining = frame_start + GUAC_VNC_FRAME_DURATION
-                                - frame_end;
+                frame_remaining = frame_start + frame_duration - frame_end;
 
                 /* Calculate time that client needs to catch up */
                 int time_elapsed = frame_end - last_frame_end;
@@ -512,6 +529,10 @@ void* guac_vnc_client_thread(void* data) {
         if (wait_result < 0)
             guac_client_abort(client, GUAC_PROTOCOL_STATUS_UPSTREAM_ERROR, "Connection closed.");
 
+        /* Adjust encoding parameters to current congestion */
+        guac_common_quality_controller_update(
+                vnc_client->display->quality_controller);
+
         /* Flush frame */
         guac_common_surface_flush(vnc_client->display->default_surface);
         guac_client_end_frame(client);
@@ -0,0 +1,311 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/attribute-table.h"
+#include "terminal/palette.h"
+#include "terminal/types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Returns whether the given colors are identical, including their palette
+ * indices. Unlike guac_terminal_colorcmp(), colors which merely compare
+ * equal are not considered identical, as the palette index determines how
+ * the color is rendered should the palette later change.
+ *
+ * @param a
+ *     The first color to compare.
+ *
+ * @param b
+ *     The second color to compare.
+ *
+ * @return
+ *     true if the given colors are identical, false otherwise.
+ */
+static bool guac_terminal_color_identical(const guac_terminal_color* a,
+        const guac_terminal_color* b) {
+    return a->palette_index == b->palette_index
+        && a->red   == b->red
+        && a->green == b->green
+        && a->blue  == b->blue;
+}
+
+/**
+ * Returns whether the given attributes are identical. Attributes are
+ * compared member by member, as any padding within the structure is not
+ * guaranteed to be initialized.
+ *
+ * @param a
+ *     The first set of attributes to compare.
+ *
+ * @param b
+ *     The second set of attributes to compare.
+ *
+ * @return
+ *     true if the given attributes are identical, false otherwise.
+ */
+static bool guac_terminal_attributes_identical(
+        const guac_terminal_attributes* a,
+        const guac_terminal_attributes* b) {
+    return a->bold        == b->bold
+        && a->half_bright == b->half_bright
+        && a->reverse     == b->reverse
+        && a->cursor      == b->cursor
+        && a->underscore  == b->underscore
+        && guac_terminal_color_identical(&a->foreground, &b->foreground)
+        && guac_terminal_color_identical(&a->background, &b->background);
+}
+
+/**
+ * Packs the given color, including its palette index, into a single 32-bit
+ * value suitable for hashing.
+ *
+ * @param color
+ *     The color to pack.
+ *
+ * @return
+ *     The given color as a 32-bit value.
+ */
+static uint32_t guac_terminal_color_key(const guac_terminal_color* color) {
+    return ((uint32_t) (color->palette_index + 1) << 24)
+         ^ (color->red << 16) ^ (color->green << 8) ^ color->blue;
+}
+
+/**
+ * Returns the hash of the given attributes.
+ *
+ * @param attributes
+ *     The attributes to hash.
+ *
+ * @return
+ *     A hash of the given attributes.
+ */
+static uint32_t guac_terminal_attributes_hash(
+        const guac_terminal_attributes* attributes) {
+
+    uint32_t flags = attributes->bold
+                  | (attributes->half_bright << 1)
+                  | (attributes->reverse     << 2)
+                  | (attributes->cursor      << 3)
+                  | (attributes->underscore  << 4);
+
+    uint32_t hash = flags * 0x9E3779B1u;
+    hash ^= guac_terminal_color_key(&attributes->foreground) * 0x85EBCA77u;
+    hash ^= guac_terminal_color_key(&attributes->background) * 0xC2B2AE3Du;
+    hash ^= hash >> 15;
+
+    return hash;
+
+}
+
+/**
+ * Returns the hash table slot which contains the given attributes, or the
+ * empty slot where those attributes would be stored if not yet present.
+ *
+ * @param table
+ *     The attribute table to search.
+ *
+ * @param attributes
+ *     The attributes to search for.
+ *
+ * @return
+ *     A pointer to the slot containing the given attributes or, if the
+ *     attributes are not present, the empty slot where they belong.
+ */
+static uint32_t* guac_terminal_attribute_table_find_slot(
+        guac_terminal_attribute_table* table,
+        const guac_terminal_attributes* attributes) {
+
+    int mask = table->slot_count - 1;
+    int slot = guac_terminal_attributes_hash(attributes) & mask;
+
+    /* The table is never more than half full, so probing always reaches
+     * either the attributes or an empty slot */
+    while (table->slots[slot] != 0) {
+
+        const guac_terminal_attributes* entry =
+            &table->entries[table->slots[slot] - 1];
+
+        if (guac_terminal_attributes_identical(entry, attributes))
+            break;
+
+        slot = (slot + 1) & mask;
+
+    }
+
+    return &table->slots[slot];
+
+}
+
+/**
+ * Rebuilds the hash table of the given attribute table from the current
+ * contents of its entries array.
+ *
+ * @param table
+ *     The attribute table to rebuild.
+ */
+static void guac_terminal_attribute_table_rehash(
+        guac_terminal_attribute_table* table) {
+
+    memset(table->slots, 0, sizeof(uint32_t) * table->slot_count);
+
+    for (int i = 0; i < table->length; i++)
+        *guac_terminal_attribute_table_find_slot(table,
+                &table->entries[i]) = i + 1;
+
+}
+
+/**
+ * Resizes the given attribute table such that it can store the given
+ * number of attributes.
+ *
+ * @param table
+ *     The attribute table to resize.
+ *
+ * @param available
+ *     The number of attributes the table must be able to store.
+ *
+ * @return
+ *     Zero if the table was resized successfully, non-zero otherwise.
+ */
+static int guac_terminal_attribute_table_resize(
+        guac_terminal_attribute_table* table, int available) {
+
+    guac_terminal_attributes* entries = realloc(table->entries,
+            sizeof(guac_terminal_attributes) * available);
+    if (entries == NULL)
+        return 1;
+
+    table->entries = entries;
+
+    uint32_t* slots = malloc(sizeof(uint32_t) * available * 2);
+    if (slots == NULL)
+        return 1;
+
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = available * 2;
+    table->available = available;
+
+    guac_terminal_attribute_table_rehash(table);
+    return 0;
+
+}
+
+guac_terminal_attribute_table* guac_terminal_attribute_table_alloc() {
+
+    guac_terminal_attribute_table* table =
+        calloc(1, sizeof(guac_terminal_attribute_table));
+    if (table == NULL)
+        return NULL;
+
+    table->last = -1;
+
+    if (guac_terminal_attribute_table_resize(table,
+                GUAC_TERMINAL_ATTRIBUTE_TABLE_INITIAL)) {
+        guac_terminal_attribute_table_free(table);
+        return NULL;
+    }
+
+    return table;
+
+}
+
+void guac_terminal_attribute_table_free(guac_terminal_attribute_table* table) {
+    free(table->entries);
+    free(table->slots);
+    free(table);
+}
+
+int guac_terminal_attribute_table_find(guac_terminal_attribute_table* table,
+        const guac_terminal_attributes* attributes) {
+
+    /* Consecutive characters usually share attributes */
+    if (table->last != -1 && guac_terminal_attributes_identical(
+                &table->entries[table->last], attributes))
+        return table->last;
+
+    return *guac_terminal_attribute_table_find_slot(table, attributes) - 1;
+
+}
+
+int guac_terminal_attribute_table_intern(guac_terminal_attribute_table* table,
+        const guac_terminal_attributes* attributes) {
+
+    /* Consecutive characters usually share attributes */
+    if (table->last != -1 && guac_terminal_attributes_identical(
+                &table->entries[table->last], attributes))
+        return table->last;
+
+    uint32_t* slot = guac_terminal_attribute_table_find_slot(table,
+            attributes);
+
+    /* Add attributes if not yet present */
+    if (*slot == 0) {
+
+        if (table->length == GUAC_TERMINAL_ATTRIBUTE_TABLE_MAX)
+            return -1;
+
+        /* Grow table if full, locating the slot again within the newly
+         * rebuilt hash table */
+        if (table->length == table->available) {
+
+            int available = table->available * 2;
+            if (available > GUAC_TERMINAL_ATTRIBUTE_TABLE_MAX)
+                available = GUAC_TERMINAL_ATTRIBUTE_TABLE_MAX;
+
+            if (guac_terminal_attribute_table_resize(table, available))
+                return -1;
+
+            slot = guac_terminal_attribute_table_find_slot(table, attributes);
+
+        }
+
+        table->entries[table->length] = *attributes;
+        *slot = ++table->length;
+
+    }
+
+    table->last = *slot - 1;
+    return table->last;
+
+}
+
+void guac_terminal_attribute_table_compact(guac_terminal_attribute_table* table,
+        const bool* used, uint32_t* remap) {
+
+    int length = 0;
+
+    /* Shift each used entry down to the next free index, preserving order */
+    for (int i = 0; i < table->length; i++) {
+        if (used[i]) {
+            table->entries[length] = table->entries[i];
+            remap[i] = length++;
+        }
+    }
+
+    table->length = length;
+    table->last = -1;
+
+    guac_terminal_attribute_table_rehash(table);
+
+}
@@ -17,43 +17,456 @@
  * under the License.
  */
 
-
+#include "terminal/attribute-table.h"
 #include "terminal/buffer.h"
 #include "terminal/common.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * The header of each run of characters within a compressed row. Each run
+ * consists of characters sharing the same attributes, and the header is
+ * followed immediately by the values of those characters. Headers are
+ * copied in and out of compressed rows with memcpy(), as they are not
+ * aligned.
+ */
+typedef struct guac_terminal_buffer_run {
+
+    /**
+     * The index of the attributes shared by all characters in the run.
+     */
+    uint32_t attributes;
+
+    /**
+     * The number of characters in the run.
+     */
+    uint16_t length;
+
+    /**
+     * Non-zero if every character in the run is a single-column character
+     * whose codepoint fits within a single byte, in which case each
+     * character is stored as that byte alone. Otherwise, each character is
+     * stored as its full 32-bit value followed by its 8-bit width.
+     */
+    uint8_t narrow;
+
+} guac_terminal_buffer_run;
+
+/**
+ * The number of bytes used to store each character of a compressed run
+ * which is not narrow.
+ */
+#define GUAC_TERMINAL_BUFFER_WIDE_CHAR_SIZE (sizeof(int32_t) + sizeof(uint8_t))
+
+/**
+ * Returns whether the given character may be stored within a narrow run of
+ * a compressed row.
+ *
+ * @param character
+ *     The character to test.
+ *
+ * @return
+ *     true if the given character may be stored as a single byte, false
+ *     otherwise.
+ */
+static bool guac_terminal_buffer_is_narrow(
+        const guac_terminal_packed_char* character) {
+    return character->value >= 0 && character->value <= 0xFF
+        && character->width == 1;
+}
+
+/**
+ * Encodes the given characters as a sequence of runs, returning the number
+ * of bytes required. If no output buffer is given, the characters are not
+ * actually encoded, and only the required size is calculated.
+ *
+ * @param characters
+ *     The characters to encode.
+ *
+ * @param length
+ *     The number of characters to encode.
+ *
+ * @param output
+ *     The buffer to store the encoded characters within, which must be at
+ *     least as large as the size returned for the same characters when no
+ *     buffer is given, or NULL to only calculate that size.
+ *
+ * @return
+ *     The number of bytes required to encode the given characters.
+ */
+static size_t guac_terminal_buffer_encode(
+        const guac_terminal_packed_char* characters, int length,
+        unsigned char* output) {
+
+    size_t size = 0;
+    int start = 0;
+
+    while (start < length) {
+
+        guac_terminal_buffer_run run = {
+            .attributes = characters[start].attributes,
+            .narrow = guac_terminal_buffer_is_narrow(&characters[start])
+        };
+
+        /* Extend run for as long as characters can share its header */
+        int end = start + 1;
+        while (end < length && end - start < UINT16_MAX
+                && characters[end].attributes == run.attributes
+                && guac_terminal_buffer_is_narrow(&characters[end]) == run.narrow)
+            end++;
+
+        run.length = end - start;
+
+        if (output != NULL) {
+
+            memcpy(output + size, &run, sizeof(run));
+            unsigned char* current = output + size + sizeof(run);
+
+            for (int i = start; i < end; i++) {
+
+                if (run.narrow)
+                    *(current++) = characters[i].value;
+
+                else {
+                    memcpy(current, &characters[i].value, sizeof(int32_t));
+                    current[sizeof(int32_t)] = characters[i].width;
+                    current += GUAC_TERMINAL_BUFFER_WIDE_CHAR_SIZE;
+                }
+
+            }
+
+        }
+
+        size += sizeof(run) + run.length * (run.narrow ? 1
+                : GUAC_TERMINAL_BUFFER_WIDE_CHAR_SIZE);
+
+        start = end;
+
+    }
+
+    return size;
+
+}
+
+/**
+ * Decodes the given sequence of runs, as produced by
+ * guac_terminal_buffer_encode(), into the given array of characters.
+ *
+ * @param input
+ *     The runs to decode.
+ *
+ * @param size
+ *     The size of the encoded runs, in bytes.
+ *
+ * @param characters
+ *     The array to store the decoded characters within, which must be large
+ *     enough to contain every character encoded.
+ */
+static void guac_terminal_buffer_decode(const unsigned char* input,
+        size_t size, guac_terminal_packed_char* characters) {
+
+    const unsigned char* end = input + size;
+
+    while (input < end) {
+
+        guac_terminal_buffer_run run;
+        memcpy(&run, input, sizeof(run));
+        input += sizeof(run);
+
+        for (int i = 0; i < run.length; i++) {
+
+            characters->attributes = run.attributes;
+
+            if (run.narrow) {
+                characters->value = *(input++);
+                characters->width = 1;
+            }
+
+            else {
+                memcpy(&characters->value, input, sizeof(int32_t));
+                characters->width = input[sizeof(int32_t)];
+                input += GUAC_TERMINAL_BUFFER_WIDE_CHAR_SIZE;
+            }
+
+            characters++;
+
+        }
+
+    }
+
+}
+
+/**
+ * Returns the row at the given location within the given buffer, without
+ * expanding or otherwise altering that row.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param row
+ *     The index of the row to return, relative to the top of the terminal
+ *     display.
+ *
+ * @return
+ *     The row at the given location.
+ */
+static guac_terminal_buffer_row* guac_terminal_buffer_row_at(
+        guac_terminal_buffer* buffer, int row) {
+
+    /* Normalize row index into a scrollback buffer index */
+    int index = (buffer->top + row) % buffer->available;
+    if (index < 0)
+        index += buffer->available;
+
+    return &(buffer->rows[index]);
+
+}
+
+/**
+ * Replaces the contents of the given row with a compressed representation,
+ * omitting any trailing characters which are identical to the default
+ * character. Rows which are already compressed, or which have never been
+ * written, are left untouched. If memory for the compressed representation
+ * cannot be allocated, the row is left uncompressed.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param buffer_row
+ *     The row to compress.
+ */
+static void guac_terminal_buffer_compress_row(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* buffer_row) {
+
+    if (buffer_row->compressed != NULL || buffer_row->characters == NULL)
+        return;
+
+    const guac_terminal_packed_char* blank = &buffer->packed_default_character;
+
+    /* Trailing default characters are recreated when the row is expanded */
+    int length = buffer_row->length;
+    while (length > 0) {
+
+        const guac_terminal_packed_char* last =
+            &buffer_row->characters[length - 1];
+
+        if (last->value != blank->value || last->width != blank->width
+                || last->attributes != blank->attributes)
+            break;
+
+        length--;
+
+    }
+
+    if (length > 0) {
+
+        size_t size = guac_terminal_buffer_encode(buffer_row->characters,
+                length, NULL);
+
+        unsigned char* compressed = malloc(size);
+        if (compressed == NULL)
+            return;
+
+        guac_terminal_buffer_encode(buffer_row->characters, length,
+                compressed);
+
+        buffer_row->compressed = compressed;
+        buffer_row->compressed_size = size;
+
+    }
+
+    free(buffer_row->characters);
+    buffer_row->characters = NULL;
+    buffer_row->available = 0;
+    buffer_row->length = length;
+
+}
+
+/**
+ * Replaces the compressed contents of the given row, if any, with the
+ * characters represented.
+ *
+ * @param buffer_row
+ *     The row to expand.
+ */
+static void guac_terminal_buffer_expand_row(guac_terminal_buffer_row* buffer_row) {
+
+    if (buffer_row->compressed == NULL)
+        return;
+
+    buffer_row->available = buffer_row->length;
+    buffer_row->characters = malloc(sizeof(guac_terminal_packed_char)
+            * buffer_row->available);
+
+    guac_terminal_buffer_decode(buffer_row->compressed,
+            buffer_row->compressed_size, buffer_row->characters);
+
+    free(buffer_row->compressed);
+    buffer_row->compressed = NULL;
+
+}
+
+/**
+ * Returns the size in bytes of the given run of a compressed row, including
+ * its header.
+ *
+ * @param run
+ *     The header of the run.
+ *
+ * @return
+ *     The size of the run, in bytes.
+ */
+static size_t guac_terminal_buffer_run_size(const guac_terminal_buffer_run* run) {
+    return sizeof(*run) + run->length * (run->narrow ? 1
+            : GUAC_TERMINAL_BUFFER_WIDE_CHAR_SIZE);
+}
+
+/**
+ * Marks the attributes of every character within the given row as used.
+ * Compressed rows are read in place, without being expanded.
+ *
+ * @param buffer_row
+ *     The row whose attributes should be marked.
+ *
+ * @param used
+ *     An array of flags, one for each attribute within the attribute table,
+ *     which will be set to true for each attribute used by the row.
+ */
+static void guac_terminal_buffer_mark_row(
+        const guac_terminal_buffer_row* buffer_row, bool* used) {
+
+    /* Each run of a compressed row shares a single set of attributes */
+    if (buffer_row->compressed != NULL) {
+
+        const unsigned char* current = buffer_row->compressed;
+        const unsigned char* end = current + buffer_row->compressed_size;
+
+        while (current < end) {
+            guac_terminal_buffer_run run;
+            memcpy(&run, current, sizeof(run));
+            used[run.attributes] = true;
+            current += guac_terminal_buffer_run_size(&run);
+        }
+
+    }
+
+    /* Otherwise, check every character */
+    else {
+        for (int i = 0; i < buffer_row->length; i++)
+            used[buffer_row->characters[i].attributes] = true;
+    }
+
+}
+
+/**
+ * Updates the attributes of every character within the given row to refer
+ * to their new indices. Compressed rows are updated in place, without being
+ * expanded.
+ *
+ * @param buffer_row
+ *     The row whose attributes should be updated.
+ *
+ * @param remap
+ *     An array of indices, one for each attribute previously within the
+ *     attribute table, containing the new index of each attribute used by
+ *     the row.
+ */
+static void guac_terminal_buffer_remap_row(
+        guac_terminal_buffer_row* buffer_row, const uint32_t* remap) {
+
+    /* Each run of a compressed row shares a single set of attributes. As
+     * remapping never merges distinct attributes, runs remain distinct */
+    if (buffer_row->compressed != NULL) {
+
+        unsigned char* current = buffer_row->compressed;
+        unsigned char* end = current + buffer_row->compressed_size;
+
+        while (current < end) {
+            guac_terminal_buffer_run run;
+            memcpy(&run, current, sizeof(run));
+            run.attributes = remap[run.attributes];
+            memcpy(current, &run, sizeof(run));
+            current += guac_terminal_buffer_run_size(&run);
+        }
+
+    }
+
+    /* Otherwise, update every character */
+    else {
+        for (int i = 0; i < buffer_row->length; i++) {
+            guac_terminal_packed_char* current = &buffer_row->characters[i];
+            current->attributes = remap[current->attributes];
+        }
+    }
+
+}
+
+/**
+ * Removes all attributes which are no longer used by any character from the
+ * attribute table of the given buffer, updating all stored characters to
+ * refer to the new indices of their attributes. The threshold at which the
+ * table will next be compacted is updated such that the table must at least
+ * double in size before it is compacted again, regardless of how many
+ * attributes could be removed.
+ *
+ * @param buffer
+ *     The buffer whose attribute table should be compacted.
+ */
+static void guac_terminal_buffer_compact_attributes(guac_terminal_buffer* buffer) {
+
+    int length = buffer->attributes->length;
+
+    bool* used = calloc(length, sizeof(bool));
+    uint32_t* remap = malloc(sizeof(uint32_t) * length);
+    if (used == NULL || remap == NULL)
+        goto done;
+
+    /* The default attributes must remain at index 0 */
+    used[0] = true;
+
+    for (int i = 0; i < buffer->available; i++)
+        guac_terminal_buffer_mark_row(&(buffer->rows[i]), used);
+
+    guac_terminal_attribute_table_compact(buffer->attributes, used, remap);
+
+    for (int i = 0; i < buffer->available; i++)
+        guac_terminal_buffer_remap_row(&(buffer->rows[i]), remap);
+
+done:
+
+    /* Compact again only once the table has at least doubled */
+    buffer->attributes_compact_threshold = buffer->attributes->length * 2;
+    if (buffer->attributes_compact_threshold < GUAC_TERMINAL_BUFFER_MIN_COMPACT_THRESHOLD)
+        buffer->attributes_compact_threshold = GUAC_TERMINAL_BUFFER_MIN_COMPACT_THRESHOLD;
+
+    free(used);
+    free(remap);
+
+}
+
 guac_terminal_buffer* guac_terminal_buffer_alloc(int rows, guac_terminal_char* default_character) {
 
     /* Allocate scrollback */
     guac_terminal_buffer* buffer =
-        malloc(sizeof(guac_terminal_buffer));
-
-    int i;
-    guac_terminal_buffer_row* row;
+        calloc(1, sizeof(guac_terminal_buffer));
 
     /* Init scrollback data */
     buffer->default_character = *default_character;
     buffer->available = rows;
     buffer->top = 0;
     buffer->length = 0;
-    buffer->rows = malloc(sizeof(guac_terminal_buffer_row) *
-            buffer->available);
 
-    /* Init scrollback rows */
-    row = buffer->rows;
-    for (i=0; i<rows; i++) {
+    /* Scrollback rows are allocated only once written */
+    buffer->rows = calloc(buffer->available, sizeof(guac_terminal_buffer_row));
 
-        /* Allocate row  */
-        row->available = 256;
-        row->length = 0;
-        row->characters = malloc(sizeof(guac_terminal_char) * row->available);
-
-        /* Next row */
-        row++;
-
-    }
+    /* Attributes of the default character always occupy index 0 */
+    buffer->attributes = guac_terminal_attribute_table_alloc();
+    buffer->attributes_compact_threshold = GUAC_TERMINAL_BUFFER_MIN_COMPACT_THRESHOLD;
+    guac_terminal_buffer_pack(buffer, default_character,
+            &buffer->packed_default_character);
 
     return buffer;
 
@@ -67,28 +480,69 @@ void guac_terminal_buffer_free(guac_terminal_buffer* buffer) {
     /* Free all rows */
     for (i=0; i<buffer->available; i++) {
         free(row->characters);
+        free(row->compressed);
         row++;
     }
 
     /* Free actual buffer */
+    free(buffer->peek_row.characters);
+    guac_terminal_attribute_table_free(buffer->attributes);
     free(buffer->rows);
     free(buffer);
 
 }
 
+void guac_terminal_buffer_pack(guac_terminal_buffer* buffer,
+        const guac_terminal_char* character, guac_terminal_packed_char* packed) {
+
+    guac_terminal_attribute_table* table = buffer->attributes;
+
+    int index = guac_terminal_attribute_table_find(table,
+            &character->attributes);
+
+    if (index == -1) {
+
+        /* Discard attributes no longer in use before adding more to a table
+         * which has grown significantly */
+        if (table->length >= buffer->attributes_compact_threshold)
+            guac_terminal_buffer_compact_attributes(buffer);
+
+        index = guac_terminal_attribute_table_intern(table,
+                &character->attributes);
+
+        /* The table can hold distinct attributes for every character of
+         * any buffer which fits in memory, so this can fail only if memory
+         * for a larger table cannot be allocated */
+        if (index == -1)
+            index = 0;
+
+    }
+
+    packed->value = character->value;
+    packed->attributes = index;
+    packed->width = character->width;
+
+}
+
+void guac_terminal_buffer_unpack(guac_terminal_buffer* buffer,
+        const guac_terminal_packed_char* packed, guac_terminal_char* character) {
+
+    character->value = packed->value;
+    character->attributes = buffer->attributes->entries[packed->attributes];
+    character->width = packed->width;
+
+}
+
 guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buffer, int row, int width) {
 
     int i;
-    guac_terminal_char* first;
-    guac_terminal_buffer_row* buffer_row;
-
-    /* Normalize row index into a scrollback buffer index */
-    int index = (buffer->top + row) % buffer->available;
-    if (index < 0)
-        index += buffer->available;
+    guac_terminal_packed_char* first;
 
     /* Get row */
-    buffer_row = &(buffer->rows[index]);
+    guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_row_at(buffer, row);
+
+    /* Rows are only modified while expanded */
+    guac_terminal_buffer_expand_row(buffer_row);
 
     /* If resizing is needed */
     if (width >= buffer_row->length) {
@@ -96,13 +550,13 @@ guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buf
         /* Expand if necessary */
         if (width > buffer_row->available) {
             buffer_row->available = width*2;
-            buffer_row->characters = realloc(buffer_row->characters, sizeof(guac_terminal_char) * buffer_row->available);
+            buffer_row->characters = realloc(buffer_row->characters, sizeof(guac_terminal_packed_char) * buffer_row->available);
         }
 
         /* Initialize new part of row */
         first = &(buffer_row->characters[buffer_row->length]);
         for (i=buffer_row->length; i<width; i++)
-            *(first++) = buffer->default_character;
+            *(first++) = buffer->packed_default_character;
 
         buffer_row->length = width;
 
@@ -113,11 +567,54 @@ guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buf
 
 }
 
+const guac_terminal_buffer_row* guac_terminal_buffer_peek_row(
+        guac_terminal_buffer* buffer, int row) {
+
+    guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_row_at(buffer, row);
+
+    /* Rows which are not compressed can be read directly */
+    if (buffer_row->compressed == NULL)
+        return buffer_row;
+
+    /* Otherwise, decompress into storage reused across calls */
+    guac_terminal_buffer_row* peek_row = &(buffer->peek_row);
+    if (buffer_row->length > peek_row->available) {
+        peek_row->available = buffer_row->length * 2;
+        peek_row->characters = realloc(peek_row->characters,
+                sizeof(guac_terminal_packed_char) * peek_row->available);
+    }
+
+    guac_terminal_buffer_decode(buffer_row->compressed,
+            buffer_row->compressed_size, peek_row->characters);
+
+    peek_row->length = buffer_row->length;
+    return peek_row;
+
+}
+
+void guac_terminal_buffer_scroll_up(guac_terminal_buffer* buffer, int amount) {
+
+    /* Advance by scroll amount */
+    buffer->top += amount;
+    if (buffer->top >= buffer->available)
+        buffer->top -= buffer->available;
+
+    buffer->length += amount;
+    if (buffer->length > buffer->available)
+        buffer->length = buffer->available;
+
+    /* Compress rows which are now part of the scrollback */
+    for (int row = -amount; row < 0; row++)
+        guac_terminal_buffer_compress_row(buffer,
+                guac_terminal_buffer_row_at(buffer, row));
+
+}
+
 void guac_terminal_buffer_copy_columns(guac_terminal_buffer* buffer, int row,
         int start_column, int end_column, int offset) {
 
-    guac_terminal_char* src;
-    guac_terminal_char* dst;
+    guac_terminal_packed_char* src;
+    guac_terminal_packed_char* dst;
 
     /* Get row */
     guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(buffer, row, end_column + offset + 1);
@@ -133,7 +630,7 @@ void guac_terminal_buffer_copy_columns(guac_terminal_buffer* buffer, int row,
     dst = &(buffer_row->characters[start_column + offset]);
 
     /* Copy data */
-    memmove(dst, src, sizeof(guac_terminal_char) * (end_column - start_column + 1));
+    memmove(dst, src, sizeof(guac_terminal_packed_char) * (end_column - start_column + 1));
 
 }
 
@@ -162,8 +659,9 @@ void guac_terminal_buffer_copy_rows(guac_terminal_buffer* buffer,
         guac_terminal_buffer_row* src_row = guac_terminal_buffer_get_row(buffer, current_row, 0);
         guac_terminal_buffer_row* dst_row = guac_terminal_buffer_get_row(buffer, current_row + offset, src_row->length);
 
-        /* Copy data */
-        memcpy(dst_row->characters, src_row->characters, sizeof(guac_terminal_char) * src_row->length);
+        /* Copy data (rows never written have no storage) */
+        if (src_row->length > 0)
+            memcpy(dst_row->characters, src_row->characters, sizeof(guac_terminal_packed_char) * src_row->length);
         dst_row->length = src_row->length;
 
         /* Next current_row */
@@ -177,26 +675,51 @@ void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
         int start_column, int end_column, guac_terminal_char* character) {
 
     int i, j;
-    guac_terminal_char* current;
+    guac_terminal_packed_char* current;
 
     /* Do nothing if glyph is empty */
     if (character->width == 0)
         return;
 
+    /* Pack character, interning its attributes only once for the range */
+    guac_terminal_packed_char packed_char;
+    guac_terminal_buffer_pack(buffer, character, &packed_char);
+
     /* Build continuation char (for multicolumn characters) */
-    guac_terminal_char continuation_char;
+    guac_terminal_packed_char continuation_char;
     continuation_char.value = GUAC_CHAR_CONTINUATION;
-    continuation_char.attributes = character->attributes;
+    continuation_char.attributes = packed_char.attributes;
     continuation_char.width = 0; /* Not applicable for GUAC_CHAR_CONTINUATION */
 
+    /* Compressed rows which are about to be entirely overwritten (such as
+     * rows recycled from the end of the scrollback) need not be expanded */
+    guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_row_at(buffer, row);
+    if (buffer_row->compressed != NULL && start_column == 0
+            && end_column + 1 >= buffer_row->length) {
+        free(buffer_row->compressed);
+        buffer_row->compressed = NULL;
+        buffer_row->length = 0;
+    }
+
     /* Get and expand row */
-    guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(buffer, row, end_column+1);
+    buffer_row = guac_terminal_buffer_get_row(buffer, row, end_column+1);
+
+    /* Ensure space for the final character, which may extend beyond the end
+     * of the range if the range is not a multiple of the character width */
+    int required = start_column
+        + ((end_column - start_column) / character->width + 1) * character->width;
+
+    if (required > buffer_row->available) {
+        buffer_row->available = required*2;
+        buffer_row->characters = realloc(buffer_row->characters,
+                sizeof(guac_terminal_packed_char) * buffer_row->available);
+    }
 
     /* Set values */
     current = &(buffer_row->characters[start_column]);
     for (i = start_column; i <= end_column; i += character->width) {
 
-        *(current++) = *character;
+        *(current++) = packed_char;
 
         /* Store any required continuation characters */
         for (j=1; j < character->width; j++)
@@ -210,3 +733,36 @@ void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
 
 }
 
+void guac_terminal_buffer_set_text(guac_terminal_buffer* buffer, int row,
+        int start_column, const char* text, int length,
+        const guac_terminal_attributes* attributes) {
+
+    if (length <= 0)
+        return;
+
+    /* Intern attributes only once for the entire range */
+    guac_terminal_char character = {
+        .value      = ' ',
+        .attributes = *attributes,
+        .width      = 1
+    };
+
+    guac_terminal_packed_char packed_char;
+    guac_terminal_buffer_pack(buffer, &character, &packed_char);
+
+    /* Get and expand row */
+    guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(buffer,
+            row, start_column + length);
+
+    /* Set values */
+    guac_terminal_packed_char* current = &(buffer_row->characters[start_column]);
+    for (int i = 0; i < length; i++) {
+        packed_char.value = (unsigned char) text[i];
+        *(current++) = packed_char;
+    }
+
+    /* Update length depending on row written */
+    if (row >= buffer->length)
+        buffer->length = row+1;
+
+}
@@ -21,11 +21,13 @@
 #include "common/surface.h"
 #include "terminal/common.h"
 #include "terminal/display.h"
+#include "terminal/glyph-cache.h"
 #include "terminal/palette.h"
 #include "terminal/terminal.h"
 #include "terminal/terminal-priv.h"
 #include "terminal/types.h"
 
+#include <inttypes.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,6 +37,7 @@
 #include <glib-object.h>
 #include <guacamole/client.h>
 #include <guacamole/protocol.h>
+#include <guacamole/protocol-batch.h>
 #include <guacamole/socket.h>
 #include <pango/pangocairo.h>
 
@@ -98,23 +101,37 @@ int __guac_terminal_set_colors(guac_terminal_display* display,
 }
 
 /**
- * Sends the given character to the terminal at the given row and column,
- * rendering the character immediately. This bypasses the guac_terminal_display
- * mechanism and is intended for flushing of updates only.
+ * Renders the given character using the current font of the given display,
+ * returning a new image containing the rendered glyph. This involves a full
+ * Pango layout, and should be performed only if the glyph is not already
+ * cached.
+ *
+ * @param display
+ *     The display whose font should be used.
+ *
+ * @param codepoint
+ *     The Unicode codepoint of the character to render.
+ *
+ * @param width
+ *     The width of the character, in columns.
+ *
+ * @param color
+ *     The foreground color of the glyph.
+ *
+ * @param background
+ *     The background color of the glyph.
+ *
+ * @return
+ *     A newly-allocated image containing the rendered glyph.
  */
-int __guac_terminal_set(guac_terminal_display* display, int row, int col, int codepoint) {
-
-    int width;
+static cairo_surface_t* __guac_terminal_render_glyph(
+        guac_terminal_display* display, int codepoint, int width,
+        const guac_terminal_color* color,
+        const guac_terminal_color* background) {
 
     int bytes;
     char utf8[4];
 
-    /* Use foreground color */
-    const guac_terminal_color* color = &display->glyph_foreground;
-
-    /* Use background color */
-    const guac_terminal_color* background = &display->glyph_background;
-
     cairo_surface_t* surface;
     cairo_t* cairo;
     int surface_width, surface_height;
@@ -123,15 +140,6 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
     int layout_width, layout_height;
     int ideal_layout_width, ideal_layout_height;
 
-    /* Calculate width in columns */
-    width = wcwidth(codepoint);
-    if (width < 0)
-        width = 1;
-
-    /* Do nothing if glyph is empty */
-    if (width == 0)
-        return 0;
-
     /* Convert to UTF-8 */
     bytes = guac_terminal_encode_utf8(codepoint, utf8);
 
@@ -187,19 +195,145 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
     cairo_move_to(cairo, 0.0, 0.0);
     pango_cairo_show_layout(cairo, layout);
 
-    /* Draw */
+    /* Free all but rendered glyph */
+    g_object_unref(layout);
+    cairo_destroy(cairo);
+
+    cairo_surface_flush(surface);
+    return surface;
+
+}
+
+/**
+ * Returns the rendered glyph of the given character in the current glyph
+ * colors of the given display, as set by __guac_terminal_set_colors(). Each
+ * distinct combination of character and colors is rendered only once, with
+ * later occurrences retrieved from the glyph cache.
+ *
+ * @param display
+ *     The display whose font and glyph colors should be used.
+ *
+ * @param codepoint
+ *     The Unicode codepoint of the character to render.
+ *
+ * @param width
+ *     Pointer to an int which will receive the width of the character, in
+ *     columns.
+ *
+ * @return
+ *     The rendered glyph, which remains owned by the glyph cache, or NULL if
+ *     the character has no visible glyph (zero width).
+ */
+static cairo_surface_t* __guac_terminal_get_glyph(
+        guac_terminal_display* display, int codepoint, int* width) {
+
+    /* Use foreground color */
+    const guac_terminal_color* color = &display->glyph_foreground;
+
+    /* Use background color */
+    const guac_terminal_color* background = &display->glyph_background;
+
+    /* Calculate width in columns */
+    *width = wcwidth(codepoint);
+    if (*width < 0)
+        *width = 1;
+
+    /* Nothing to render if glyph is empty */
+    if (*width == 0)
+        return NULL;
+
+    /* Render glyph only if not already cached */
+    cairo_surface_t* surface = guac_terminal_glyph_cache_lookup(
+            display->glyph_cache, codepoint, color, background);
+
+    if (surface == NULL) {
+        surface = __guac_terminal_render_glyph(display, codepoint, *width,
+                color, background);
+        guac_terminal_glyph_cache_store(display->glyph_cache, codepoint,
+                color, background, surface);
+    }
+
+    return surface;
+
+}
+
+/**
+ * Copies the given rendered glyph into the run buffer of the given display,
+ * such that the glyph occupies the given column of the run. Any portion of
+ * the glyph which does not fit within the run buffer is ignored.
+ *
+ * @param display
+ *     The display whose run buffer should receive the glyph.
+ *
+ * @param glyph
+ *     The rendered glyph to copy.
+ *
+ * @param column
+ *     The column within the run at which the glyph should be placed.
+ *
+ * @param stride
+ *     The number of bytes in each row of the run buffer.
+ */
+static void __guac_terminal_blit_glyph(guac_terminal_display* display,
+        cairo_surface_t* glyph, int column, int stride) {
+
+    unsigned char* src = cairo_image_surface_get_data(glyph);
+    int src_stride = cairo_image_surface_get_stride(glyph);
+    int width = cairo_image_surface_get_width(glyph);
+
+    int x = column * display->char_width;
+    int available = stride / 4 - x;
+    if (width > available)
+        width = available;
+
+    unsigned char* dst = display->run_buffer + x * 4;
+    for (int y = 0; y < display->char_height; y++) {
+        memcpy(dst, src, width * 4);
+        dst += stride;
+        src += src_stride;
+    }
+
+}
+
+/**
+ * Draws the given columns of the run buffer of the given display to the
+ * given row of the terminal.
+ *
+ * @param display
+ *     The display whose run buffer should be drawn.
+ *
+ * @param row
+ *     The row to draw the run at.
+ *
+ * @param start_column
+ *     The first column of the run.
+ *
+ * @param end_column
+ *     The column immediately following the last column of the run.
+ *
+ * @param stride
+ *     The number of bytes in each row of the run buffer.
+ */
+static void __guac_terminal_draw_run(guac_terminal_display* display,
+        int row, int start_column, int end_column, int stride) {
+
+    /* Clip run to the run buffer (wide characters may overhang the last
+     * column of the display) */
+    int columns = end_column - start_column;
+    if (columns > display->width + GUAC_TERMINAL_MAX_CHAR_WIDTH)
+        columns = display->width + GUAC_TERMINAL_MAX_CHAR_WIDTH;
+
+    cairo_surface_t* surface = cairo_image_surface_create_for_data(
+            display->run_buffer, CAIRO_FORMAT_RGB24,
+            columns * display->char_width, display->char_height, stride);
+
     guac_common_surface_draw(display->display_surface,
-        display->char_width * col,
+        display->char_width * start_column,
         display->char_height * row,
         surface);
 
-    /* Free all */
-    g_object_unref(layout);
-    cairo_destroy(cairo);
     cairo_surface_destroy(surface);
 
-    return 0;
-
 }
 
 guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
@@ -216,6 +350,17 @@ guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
     display->char_width = 0;
     display->char_height = 0;
 
+    /* Run buffer is allocated when first needed */
+    display->run_buffer = NULL;
+    display->run_buffer_size = 0;
+
+    /* No glyphs have yet been rendered */
+    display->glyph_cache = guac_terminal_glyph_cache_alloc();
+    if (display->glyph_cache == NULL) {
+        free(display);
+        return NULL;
+    }
+
     /* Create default surface */
     display->display_layer = guac_client_alloc_layer(client);
     display->select_layer = guac_client_alloc_layer(client);
@@ -245,6 +390,7 @@ guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
     if (guac_terminal_display_set_font(display, font_name, font_size, dpi)) {
         guac_client_abort(display->client, GUAC_PROTOCOL_STATUS_SERVER_ERROR,
                 "Unable to set initial font \"%s\"", font_name);
+        guac_terminal_glyph_cache_free(display->glyph_cache);
         free(display);
         return NULL;
     }
@@ -258,12 +404,21 @@ void guac_terminal_display_free(guac_terminal_display* display) {
     /* Free font description */
     pango_font_description_free(display->font_desc);
 
+    /* Free all rendered glyphs */
+    guac_client_log(display->client, GUAC_LOG_DEBUG, "Glyph cache: %" PRIu64
+            " hit(s), %" PRIu64 " miss(es).", display->glyph_cache->hits,
+            display->glyph_cache->misses);
+    guac_terminal_glyph_cache_free(display->glyph_cache);
+
     /* Free default palette. */
     free(display->default_palette);
 
     /* Free operations buffers */
     free(display->operations);
 
+    /* Free buffer used to composite runs of glyphs */
+    free(display->run_buffer);
+
     /* Free display */
     free(display);
 
@@ -445,6 +600,38 @@ void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
 
 }
 
+void guac_terminal_display_set_text(guac_terminal_display* display, int row,
+        int start_column, const char* text, int length,
+        const guac_terminal_attributes* attributes) {
+
+    /* Ignore operations outside display bounds */
+    if (row < 0 || row >= display->height)
+        return;
+
+    /* Clip range to display bounds */
+    if (start_column < 0) {
+        text -= start_column;
+        length += start_column;
+        start_column = 0;
+    }
+
+    if (start_column + length > display->width)
+        length = display->width - start_column;
+
+    guac_terminal_operation* current =
+        &(display->operations[row * display->width + start_column]);
+
+    /* Set operation for each character */
+    for (int i = 0; i < length; i++) {
+        current->type = GUAC_CHAR_SET;
+        current->character.value = (unsigned char) text[i];
+        current->character.attributes = *attributes;
+        current->character.width = 1;
+        current++;
+    }
+
+}
+
 void guac_terminal_display_resize(guac_terminal_display* display, int width, int height) {
 
     guac_terminal_operation* current;
@@ -770,15 +957,61 @@ void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
 
 void __guac_terminal_display_flush_set(guac_terminal_display* display) {
 
-    guac_terminal_operation* current = display->operations;
+    guac_terminal_operation* current_row = display->operations;
     int row, col;
 
-    /* For each operation */
+    /* Ensure run buffer can hold an entire row, plus any overhang from a
+     * wide character in the last column */
+    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24,
+            (display->width + GUAC_TERMINAL_MAX_CHAR_WIDTH)
+            * display->char_width);
+
+    size_t size = (size_t) stride * display->char_height;
+    if (size > display->run_buffer_size) {
+
+        unsigned char* run_buffer = realloc(display->run_buffer, size);
+        if (run_buffer == NULL) {
+            guac_client_log(display->client, GUAC_LOG_WARNING, "Unable to "
+                    "allocate terminal run buffer. Pending text will not be "
+                    "drawn.");
+            return;
+        }
+
+        display->run_buffer = run_buffer;
+        display->run_buffer_size = size;
+
+    }
+
+    /* For each row */
     for (row=0; row<display->height; row++) {
-        for (col=0; col<display->width; col++) {
 
-            /* Perform given operation */
-            if (current->type == GUAC_CHAR_SET) {
+        col = 0;
+        while (col < display->width) {
+
+            /* Skip anything other than a set operation */
+            if (current_row[col].type != GUAC_CHAR_SET) {
+                col++;
+                continue;
+            }
+
+            /* Gather consecutive set operations into a single run, which is
+             * composited from the glyph cache and drawn at once */
+            int run_start = col;
+            int run_end = col;
+
+            while (col < display->width) {
+
+                guac_terminal_operation* current = &current_row[col];
+
+                /* Cells which are not being set end the run, unless
+                 * already covered by a preceding wide character */
+                if (current->type != GUAC_CHAR_SET) {
+                    if (col < run_end) {
+                        col++;
+                        continue;
+                    }
+                    break;
+                }
 
                 int codepoint = current->character.value;
 
@@ -790,18 +1023,42 @@ void __guac_terminal_display_flush_set(guac_terminal_display* display) {
                 __guac_terminal_set_colors(display,
                         &(current->character.attributes));
 
-                /* Send character */
-                __guac_terminal_set(display, row, col, codepoint);
-
                 /* Mark operation as handled */
                 current->type = GUAC_CHAR_NOP;
 
+                int width;
+                cairo_surface_t* glyph = __guac_terminal_get_glyph(display,
+                        codepoint, &width);
+
+                /* Empty glyphs draw nothing, and end the run if not already
+                 * covered by a preceding wide character */
+                if (glyph == NULL) {
+                    col++;
+                    if (col - 1 < run_end)
+                        continue;
+                    break;
+                }
+
+                __guac_terminal_blit_glyph(display, glyph, col - run_start,
+                        stride);
+
+                if (col + width > run_end)
+                    run_end = col + width;
+
+                col++;
+
             }
 
-            /* Next operation */
-            current++;
+            /* Draw run, if anything was rendered */
+            if (run_end > run_start)
+                __guac_terminal_draw_run(display, row, run_start, run_end,
+                        stride);
 
         }
+
+        /* Next row */
+        current_row += display->width;
+
     }
 
 }
@@ -857,6 +1114,11 @@ void guac_terminal_display_select(guac_terminal_display* display,
     display->selection_end_row = end_row;
     display->selection_end_column = end_col;
 
+    /* Send all rectangles and the fill together */
+    char buffer[GUAC_PROTOCOL_BATCH_DEFAULT_SIZE];
+    guac_protocol_batch batch;
+    guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
+
     /* If single row, just need one rectangle */
     if (start_row == end_row) {
 
@@ -868,7 +1130,7 @@ void guac_terminal_display_select(guac_terminal_display* display,
         }
 
         /* Select characters between columns */
-        guac_protocol_send_rect(socket, select_layer,
+        guac_protocol_batch_rect(&batch, select_layer,
 
                 start_col * display->char_width,
                 start_row * display->char_height,
@@ -897,7 +1159,7 @@ void guac_terminal_display_select(guac_terminal_display* display,
         }
 
         /* First row */
-        guac_protocol_send_rect(socket, select_layer,
+        guac_protocol_batch_rect(&batch, select_layer,
 
                 start_col * display->char_width,
                 start_row * display->char_height,
@@ -906,7 +1168,7 @@ void guac_terminal_display_select(guac_terminal_display* display,
                 display->char_height);
 
         /* Middle */
-        guac_protocol_send_rect(socket, select_layer,
+        guac_protocol_batch_rect(&batch, select_layer,
 
                 0,
                 (start_row + 1) * display->char_height,
@@ -915,7 +1177,7 @@ void guac_terminal_display_select(guac_terminal_display* display,
                 (end_row - start_row - 1) * display->char_height);
 
         /* Last row */
-        guac_protocol_send_rect(socket, select_layer,
+        guac_protocol_batch_rect(&batch, select_layer,
 
                 0,
                 end_row * display->char_height,
@@ -926,9 +1188,11 @@ void guac_terminal_display_select(guac_terminal_display* display,
     }
 
     /* Draw new selection, erasing old */
-    guac_protocol_send_cfill(socket, GUAC_COMP_SRC, select_layer,
+    guac_protocol_batch_cfill(&batch, GUAC_COMP_SRC, select_layer,
             0x00, 0x80, 0xFF, 0x60);
 
+    guac_protocol_batch_flush(&batch);
+
 }
 
 void guac_terminal_display_clear_select(guac_terminal_display* display) {
@@ -940,9 +1204,14 @@ void guac_terminal_display_clear_select(guac_terminal_display* display) {
     guac_socket* socket = display->client->socket;
     guac_layer* select_layer = display->select_layer;
 
-    guac_protocol_send_rect(socket, select_layer, 0, 0, 1, 1);
-    guac_protocol_send_cfill(socket, GUAC_COMP_SRC, select_layer,
+    char buffer[GUAC_PROTOCOL_BATCH_INSTRUCTION_MAX_LENGTH * 2];
+    guac_protocol_batch batch;
+    guac_protocol_batch_init(&batch, socket, buffer, sizeof(buffer));
+
+    guac_protocol_batch_rect(&batch, select_layer, 0, 0, 1, 1);
+    guac_protocol_batch_cfill(&batch, GUAC_COMP_SRC, select_layer,
             0x00, 0x00, 0x00, 0x00);
+    guac_protocol_batch_flush(&batch);
 
     /* Text is no longer selected */
     display->text_selected = false;
@@ -1012,6 +1281,9 @@ int guac_terminal_display_set_font(guac_terminal_display* display,
     display->font_desc = font_desc;
     pango_font_description_free(old_font_desc);
 
+    /* Glyphs rendered with the old font can no longer be used */
+    guac_terminal_glyph_cache_clear(display->glyph_cache);
+
     /* Recalculate dimensions which will fit within current surface */
     int new_width = pixel_width / display->char_width;
     int new_height = pixel_height / display->char_height;
@@ -0,0 +1,138 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/glyph-cache.h"
+#include "terminal/palette.h"
+
+#include <cairo/cairo.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Packs the components of the given color into a single 24-bit RGB value,
+ * ignoring its palette index.
+ *
+ * @param color
+ *     The color to pack.
+ *
+ * @return
+ *     The given color as a 24-bit RGB value.
+ */
+static uint32_t guac_terminal_glyph_rgb(const guac_terminal_color* color) {
+    return (color->red << 16) | (color->green << 8) | color->blue;
+}
+
+/**
+ * Returns the slot within a glyph cache which would contain the glyph having
+ * the given codepoint and colors.
+ *
+ * @param codepoint
+ *     The Unicode codepoint of the glyph.
+ *
+ * @param foreground
+ *     The foreground color of the glyph, as a 24-bit RGB value.
+ *
+ * @param background
+ *     The background color of the glyph, as a 24-bit RGB value.
+ *
+ * @return
+ *     The index of the slot for the given glyph.
+ */
+static unsigned int guac_terminal_glyph_slot(int codepoint,
+        uint32_t foreground, uint32_t background) {
+
+    /* Mix all components such that glyphs differing only in color are
+     * spread across the cache */
+    uint32_t hash = (uint32_t) codepoint * 0x9E3779B1u;
+    hash ^= foreground * 0x85EBCA77u;
+    hash ^= background * 0xC2B2AE3Du;
+    hash ^= hash >> 15;
+
+    return hash & (GUAC_TERMINAL_GLYPH_CACHE_SIZE - 1);
+
+}
+
+guac_terminal_glyph_cache* guac_terminal_glyph_cache_alloc() {
+    return calloc(1, sizeof(guac_terminal_glyph_cache));
+}
+
+void guac_terminal_glyph_cache_free(guac_terminal_glyph_cache* cache) {
+    guac_terminal_glyph_cache_clear(cache);
+    free(cache);
+}
+
+void guac_terminal_glyph_cache_clear(guac_terminal_glyph_cache* cache) {
+
+    for (int i = 0; i < GUAC_TERMINAL_GLYPH_CACHE_SIZE; i++) {
+
+        guac_terminal_glyph* glyph = &cache->glyphs[i];
+
+        if (glyph->surface != NULL) {
+            cairo_surface_destroy(glyph->surface);
+            glyph->surface = NULL;
+        }
+
+    }
+
+}
+
+cairo_surface_t* guac_terminal_glyph_cache_lookup(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background) {
+
+    uint32_t fg = guac_terminal_glyph_rgb(foreground);
+    uint32_t bg = guac_terminal_glyph_rgb(background);
+
+    guac_terminal_glyph* glyph =
+        &cache->glyphs[guac_terminal_glyph_slot(codepoint, fg, bg)];
+
+    /* Slot must contain exactly the requested glyph */
+    if (glyph->surface != NULL && glyph->codepoint == codepoint
+            && glyph->foreground == fg && glyph->background == bg) {
+        cache->hits++;
+        return glyph->surface;
+    }
+
+    cache->misses++;
+    return NULL;
+
+}
+
+void guac_terminal_glyph_cache_store(guac_terminal_glyph_cache* cache,
+        int codepoint, const guac_terminal_color* foreground,
+        const guac_terminal_color* background, cairo_surface_t* surface) {
+
+    uint32_t fg = guac_terminal_glyph_rgb(foreground);
+    uint32_t bg = guac_terminal_glyph_rgb(background);
+
+    guac_terminal_glyph* glyph =
+        &cache->glyphs[guac_terminal_glyph_slot(codepoint, fg, bg)];
+
+    /* Replace any glyph already occupying the slot */
+    if (glyph->surface != NULL)
+        cairo_surface_destroy(glyph->surface);
+
+    glyph->codepoint = codepoint;
+    glyph->foreground = fg;
+    glyph->background = bg;
+    glyph->surface = surface;
+
+}
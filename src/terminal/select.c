@@ -149,11 +149,11 @@ static int guac_terminal_find_char(guac_terminal* terminal,
 
     int start_column = *column;
 
-    guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(terminal->buffer, row, 0);
+    const guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_peek_row(terminal->buffer, row);
     if (start_column < buffer_row->length) {
 
         /* Find beginning of character */
-        guac_terminal_char* start_char = &(buffer_row->characters[start_column]);
+        const guac_terminal_packed_char* start_char = &(buffer_row->characters[start_column]);
         while (start_column > 0 && start_char->value == GUAC_CHAR_CONTINUATION) {
             start_char--;
             start_column--;
@@ -285,8 +285,8 @@ static void guac_terminal_clipboard_append_row(guac_terminal* terminal,
     char buffer[1024];
     int i = start;
 
-    guac_terminal_buffer_row* buffer_row =
-        guac_terminal_buffer_get_row(terminal->buffer, row, 0);
+    const guac_terminal_buffer_row* buffer_row =
+        guac_terminal_buffer_peek_row(terminal->buffer, row);
 
     /* If selection is entirely outside the bounds of the row, then there is
      * nothing to append */
@@ -32,9 +32,24 @@
 #include <guacamole/socket.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <wchar.h>
 
+#if defined(__GNUC__) && defined(__SSE2__)
+#define GUAC_TERMINAL_SSE2 1
+#include <emmintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define GUAC_TERMINAL_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * The number of bytes of terminal output examined at once when scanning for
+ * runs of printable text.
+ */
+#define GUAC_TERMINAL_SCAN_BLOCK_SIZE 16
+
 /**
  * Response string sent when identification is requested.
  */
@@ -129,8 +144,8 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
 
     int width;
 
-    static int bytes_remaining = 0;
-    static int codepoint = 0;
+    int bytes_remaining = term->utf8_bytes_remaining;
+    int codepoint = term->utf8_codepoint;
 
     const int* char_mapping = term->char_mapping[term->active_char_set];
 
@@ -188,6 +203,10 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
         bytes_remaining = 0;
     }
 
+    /* Store decoding state for the next byte */
+    term->utf8_bytes_remaining = bytes_remaining;
+    term->utf8_codepoint = codepoint;
+
     /* If we need more bytes, wait for more bytes */
     if (bytes_remaining != 0)
         return 0;
@@ -297,6 +316,130 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
 
 }
 
+/**
+ * Returns the number of bytes at the beginning of the given buffer which are
+ * printable ASCII characters (0x20 through 0x7E inclusive). Control
+ * characters, DEL, and any bytes of multibyte UTF-8 characters end the run.
+ *
+ * @param buffer
+ *     The buffer to scan.
+ *
+ * @param length
+ *     The number of bytes within the buffer.
+ *
+ * @return
+ *     The number of leading bytes within the buffer which are printable
+ *     ASCII characters.
+ */
+static int guac_terminal_printable_length(const char* buffer, int length) {
+
+    int scanned = 0;
+
+#if defined(GUAC_TERMINAL_SSE2)
+
+    const __m128i control = _mm_set1_epi8(0x1F);
+    const __m128i del = _mm_set1_epi8(0x7F);
+
+    while (length - scanned >= GUAC_TERMINAL_SCAN_BLOCK_SIZE) {
+
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (buffer + scanned));
+
+        /* Compared as signed, only printable characters and DEL are greater
+         * than 0x1F, as bytes with the high bit set are negative */
+        int printable = _mm_movemask_epi8(_mm_andnot_si128(
+                    _mm_cmpeq_epi8(bytes, del),
+                    _mm_cmpgt_epi8(bytes, control)));
+
+        if (printable != 0xFFFF)
+            return scanned + __builtin_ctz(~printable);
+
+        scanned += GUAC_TERMINAL_SCAN_BLOCK_SIZE;
+
+    }
+
+#elif defined(GUAC_TERMINAL_NEON)
+
+    while (length - scanned >= GUAC_TERMINAL_SCAN_BLOCK_SIZE) {
+
+        uint8x16_t bytes = vld1q_u8((const uint8_t*) (buffer + scanned));
+
+        uint8x16_t printable = vandq_u8(
+                vcgeq_u8(bytes, vdupq_n_u8(0x20)),
+                vcltq_u8(bytes, vdupq_n_u8(0x7F)));
+
+        /* Narrow comparison result to four bits per byte, as NEON has no
+         * equivalent of SSE2's movemask */
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+                    vshrn_n_u16(vreinterpretq_u16_u8(printable), 4)), 0);
+
+        if (mask != UINT64_MAX)
+            return scanned + __builtin_ctzll(~mask) / 4;
+
+        scanned += GUAC_TERMINAL_SCAN_BLOCK_SIZE;
+
+    }
+
+#endif
+
+    /* Scan any remaining bytes individually */
+    while (scanned < length) {
+
+        unsigned char c = buffer[scanned];
+        if (c < 0x20 || c >= 0x7F)
+            break;
+
+        scanned++;
+
+    }
+
+    return scanned;
+
+}
+
+int guac_terminal_echo_text(guac_terminal* term, const char* text,
+        int length) {
+
+    /* Text can be echoed in bulk only where each byte would otherwise be
+     * echoed individually as a single-column character */
+    if (term->char_handler != guac_terminal_echo
+            || term->utf8_bytes_remaining != 0
+            || term->char_mapping[term->active_char_set] != NULL
+            || term->pipe_stream != NULL
+            || term->insert_mode
+            || term->term_width <= 0)
+        return 0;
+
+    int echoed = guac_terminal_printable_length(text, length);
+
+    int remaining = echoed;
+    while (remaining > 0) {
+
+        /* Wrap if necessary */
+        if (term->cursor_col >= term->term_width) {
+            term->cursor_col = 0;
+            guac_terminal_linefeed(term);
+        }
+
+        /* Write as much of the text as fits within the current row */
+        int count = term->term_width - term->cursor_col;
+        if (count > remaining)
+            count = remaining;
+
+        guac_terminal_set_text(term, term->cursor_row, term->cursor_col,
+                text, count);
+
+        /* Advance cursor */
+        term->cursor_col += count;
+
+        text += count;
+        remaining -= count;
+
+    }
+
+    return echoed;
+
+}
+
 int guac_terminal_escape(guac_terminal* term, unsigned char c) {
 
     switch (c) {
@@ -55,8 +55,9 @@
 static void __guac_terminal_set_columns(guac_terminal* terminal, int row,
         int start_column, int end_column, guac_terminal_char* character) {
 
-    guac_terminal_display_set_columns(terminal->display, row + terminal->scroll_offset,
-            start_column, end_column, character);
+    if (!terminal->flooded)
+        guac_terminal_display_set_columns(terminal->display, row + terminal->scroll_offset,
+                start_column, end_column, character);
 
     guac_terminal_buffer_set_columns(terminal->buffer, row,
             start_column, end_column, character);
@@ -79,12 +80,12 @@ static void __guac_terminal_force_break(guac_terminal* terminal, int row, int ed
     guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(terminal->buffer, row, 0);
 
     /* Ensure character to left of edge is unbroken */
-    if (edge > 0) {
+    if (edge > 0 && edge <= buffer_row->length) {
 
         int end_column = edge - 1;
         int start_column = end_column;
 
-        guac_terminal_char* start_char = &(buffer_row->characters[start_column]);
+        guac_terminal_packed_char* start_char = &(buffer_row->characters[start_column]);
 
         /* Determine start column */
         while (start_column > 0 && start_char->value == GUAC_CHAR_CONTINUATION) {
@@ -102,8 +103,8 @@ static void __guac_terminal_force_break(guac_terminal* terminal, int row, int ed
         if (start_char->value == GUAC_CHAR_CONTINUATION || start_char->width != end_column - start_column + 1) {
 
             guac_terminal_char cleared_char;
+            guac_terminal_buffer_unpack(terminal->buffer, start_char, &cleared_char);
             cleared_char.value = ' ';
-            cleared_char.attributes = start_char->attributes;
             cleared_char.width = 1;
 
             __guac_terminal_set_columns(terminal, row, start_column, end_column, &cleared_char);
@@ -118,8 +119,8 @@ static void __guac_terminal_force_break(guac_terminal* terminal, int row, int ed
         int start_column = edge;
         int end_column = start_column;
 
-        guac_terminal_char* start_char = &(buffer_row->characters[start_column]);
-        guac_terminal_char* end_char = &(buffer_row->characters[end_column]);
+        guac_terminal_packed_char* start_char = &(buffer_row->characters[start_column]);
+        guac_terminal_packed_char* end_char = &(buffer_row->characters[end_column]);
 
         /* Determine end column */
         while (end_column+1 < buffer_row->length && (end_char+1)->value == GUAC_CHAR_CONTINUATION) {
@@ -137,8 +138,8 @@ static void __guac_terminal_force_break(guac_terminal* terminal, int row, int ed
         if (start_char->value == GUAC_CHAR_CONTINUATION || start_char->width != end_column - start_column + 1) {
 
             guac_terminal_char cleared_char;
+            guac_terminal_buffer_unpack(terminal->buffer, start_char, &cleared_char);
             cleared_char.value = ' ';
-            cleared_char.attributes = start_char->attributes;
             cleared_char.width = 1;
 
             __guac_terminal_set_columns(terminal, row, start_column, end_column, &cleared_char);
@@ -203,6 +204,8 @@ void guac_terminal_reset(guac_terminal* term) {
 
     /* Set current state */
     term->char_handler = guac_terminal_echo; 
+    term->utf8_codepoint = 0;
+    term->utf8_bytes_remaining = 0;
     term->active_char_set = 0;
     term->char_mapping[0] =
     term->char_mapping[1] = NULL;
@@ -388,6 +391,10 @@ guac_terminal* guac_terminal_create(guac_client* client,
     pthread_cond_init(&(term->modified_cond), NULL);
     pthread_mutex_init(&(term->modified_lock), NULL);
 
+    /* Terminal is not initially flooded */
+    term->frame_scrolled_rows = 0;
+    term->flooded = false;
+
     /* Maximum and requested scrollback are initially the same */
     term->max_scrollback = options->max_scrollback;
     term->requested_scrollback = options->max_scrollback;
@@ -811,9 +818,44 @@ int guac_terminal_set(guac_terminal* term, int row, int col, int codepoint) {
 
 }
 
+/**
+ * Removes the cursor from the position at which it was last drawn by
+ * guac_terminal_commit_cursor(), if any, updating both the buffer and the
+ * display. The cursor is considered not drawn until committed again.
+ *
+ * @param term
+ *     The terminal whose cursor should be cleared.
+ */
+static void guac_terminal_clear_visible_cursor(guac_terminal* term) {
+
+    guac_terminal_char guac_char;
+    guac_terminal_packed_char* packed_char;
+
+    guac_terminal_buffer_row* row;
+
+    /* Nothing to clear if cursor was not visible */
+    if (term->visible_cursor_row == -1 || term->visible_cursor_col == -1)
+        return;
+
+    /* Get old row with cursor */
+    row = guac_terminal_buffer_get_row(term->buffer, term->visible_cursor_row, term->visible_cursor_col+1);
+
+    packed_char = &(row->characters[term->visible_cursor_col]);
+    guac_terminal_buffer_unpack(term->buffer, packed_char, &guac_char);
+    guac_char.attributes.cursor = false;
+    guac_terminal_buffer_pack(term->buffer, &guac_char, packed_char);
+    guac_terminal_display_set_columns(term->display, term->visible_cursor_row + term->scroll_offset,
+            term->visible_cursor_col, term->visible_cursor_col, &guac_char);
+
+    term->visible_cursor_row = -1;
+    term->visible_cursor_col = -1;
+
+}
+
 void guac_terminal_commit_cursor(guac_terminal* term) {
 
-    guac_terminal_char* guac_char;
+    guac_terminal_char guac_char;
+    guac_terminal_packed_char* packed_char;
 
     guac_terminal_buffer_row* row;
 
@@ -822,25 +864,19 @@ void guac_terminal_commit_cursor(guac_terminal* term) {
         return;
 
     /* Clear cursor if it was visible */
-    if (term->visible_cursor_row != -1 && term->visible_cursor_col != -1) {
-        /* Get old row with cursor */
-        row = guac_terminal_buffer_get_row(term->buffer, term->visible_cursor_row, term->visible_cursor_col+1);
-
-        guac_char = &(row->characters[term->visible_cursor_col]);
-        guac_char->attributes.cursor = false;
-        guac_terminal_display_set_columns(term->display, term->visible_cursor_row + term->scroll_offset,
-                term->visible_cursor_col, term->visible_cursor_col, guac_char);
-    }
+    guac_terminal_clear_visible_cursor(term);
 
     /* Set cursor if should be visible */
     if (term->cursor_visible) {
         /* Get new row with cursor */
         row = guac_terminal_buffer_get_row(term->buffer, term->cursor_row, term->cursor_col+1);
 
-        guac_char = &(row->characters[term->cursor_col]);
-        guac_char->attributes.cursor = true;
+        packed_char = &(row->characters[term->cursor_col]);
+        guac_terminal_buffer_unpack(term->buffer, packed_char, &guac_char);
+        guac_char.attributes.cursor = true;
+        guac_terminal_buffer_pack(term->buffer, &guac_char, packed_char);
         guac_terminal_display_set_columns(term->display, term->cursor_row + term->scroll_offset,
-                term->cursor_col, term->cursor_col, guac_char);
+                term->cursor_col, term->cursor_col, &guac_char);
 
         term->visible_cursor_row = term->cursor_row;
         term->visible_cursor_col = term->cursor_col;
@@ -859,19 +895,28 @@ void guac_terminal_commit_cursor(guac_terminal* term) {
 int guac_terminal_write(guac_terminal* term, const char* buffer, int length) {
 
     guac_terminal_lock(term);
-    for (int written = 0; written < length; written++) {
 
-        /* Read and advance to next character */
-        char current = *(buffer++);
+    /* Write all data to typescript, if any */
+    if (term->typescript != NULL)
+        guac_terminal_typescript_write_data(term->typescript, buffer, length);
 
-        /* Write character to typescript, if any */
-        if (term->typescript != NULL)
-            guac_terminal_typescript_write(term->typescript, current);
+    int written = 0;
+    while (written < length) {
+
+        /* Echo runs of printable text in bulk where possible */
+        int echoed = guac_terminal_echo_text(term, buffer + written,
+                length - written);
+
+        if (echoed > 0) {
+            written += echoed;
+            continue;
+        }
 
-        /* Handle character and its meaning */
-        term->char_handler(term, current);
+        /* Otherwise, handle the next character and its meaning */
+        term->char_handler(term, buffer[written++]);
 
     }
+
     guac_terminal_unlock(term);
 
     guac_terminal_notify(term);
@@ -885,17 +930,25 @@ int guac_terminal_scroll_up(guac_terminal* term,
     /* If scrolling entire display, update scroll offset */
     if (start_row == 0 && end_row == term->term_height - 1) {
 
+        /* Clear the cursor while it can still be found if it is about to
+         * scroll off the display, as it would otherwise remain within the
+         * scrollback */
+        if (term->visible_cursor_row >= start_row &&
+            term->visible_cursor_row < start_row + amount)
+            guac_terminal_clear_visible_cursor(term);
+
+        /* Once an entire screen has scrolled by within the current frame,
+         * stop updating the display until the frame is flushed */
+        term->frame_scrolled_rows += amount;
+        if (term->frame_scrolled_rows >= term->term_height)
+            term->flooded = true;
+
         /* Scroll up visibly */
-        guac_terminal_display_copy_rows(term->display, start_row + amount, end_row, -amount);
+        if (!term->flooded)
+            guac_terminal_display_copy_rows(term->display, start_row + amount, end_row, -amount);
 
         /* Advance by scroll amount */
-        term->buffer->top += amount;
-        if (term->buffer->top >= term->buffer->available)
-            term->buffer->top -= term->buffer->available;
-
-        term->buffer->length += amount;
-        if (term->buffer->length > term->buffer->available)
-            term->buffer->length = term->buffer->available;
+        guac_terminal_buffer_scroll_up(term->buffer, amount);
 
         /* Reset scrollbar bounds */
         guac_terminal_scrollbar_set_bounds(term->scrollbar,
@@ -1073,20 +1126,22 @@ void guac_terminal_scroll_display_down(guac_terminal* terminal,
     for (row=start_row; row<=end_row; row++) {
 
         /* Get row from scrollback */
-        guac_terminal_buffer_row* buffer_row =
-            guac_terminal_buffer_get_row(terminal->buffer, row, 0);
+        const guac_terminal_buffer_row* buffer_row =
+            guac_terminal_buffer_peek_row(terminal->buffer, row);
 
         /* Clear row */
         guac_terminal_display_set_columns(terminal->display,
                 dest_row, 0, terminal->display->width, &(terminal->default_char));
 
         /* Draw row */
-        guac_terminal_char* current = buffer_row->characters;
+        const guac_terminal_packed_char* current = buffer_row->characters;
         for (column=0; column<buffer_row->length; column++) {
 
             /* Only draw if not blank */
-            if (guac_terminal_is_visible(terminal, current))
-                guac_terminal_display_set_columns(terminal->display, dest_row, column, column, current);
+            guac_terminal_char guac_char;
+            guac_terminal_buffer_unpack(terminal->buffer, current, &guac_char);
+            if (guac_terminal_is_visible(terminal, &guac_char))
+                guac_terminal_display_set_columns(terminal->display, dest_row, column, column, &guac_char);
 
             current++;
 
@@ -1136,20 +1191,22 @@ void guac_terminal_scroll_display_up(guac_terminal* terminal,
     for (row=start_row; row<=end_row; row++) {
 
         /* Get row from scrollback */
-        guac_terminal_buffer_row* buffer_row = 
-            guac_terminal_buffer_get_row(terminal->buffer, row, 0);
+        const guac_terminal_buffer_row* buffer_row =
+            guac_terminal_buffer_peek_row(terminal->buffer, row);
 
         /* Clear row */
         guac_terminal_display_set_columns(terminal->display,
                 dest_row, 0, terminal->display->width, &(terminal->default_char));
 
         /* Draw row */
-        guac_terminal_char* current = buffer_row->characters;
+        const guac_terminal_packed_char* current = buffer_row->characters;
         for (column=0; column<buffer_row->length; column++) {
 
             /* Only draw if not blank */
-            if (guac_terminal_is_visible(terminal, current))
-                guac_terminal_display_set_columns(terminal->display, dest_row, column, column, current);
+            guac_terminal_char guac_char;
+            guac_terminal_buffer_unpack(terminal->buffer, current, &guac_char);
+            if (guac_terminal_is_visible(terminal, &guac_char))
+                guac_terminal_display_set_columns(terminal->display, dest_row, column, column, &guac_char);
 
             current++;
 
@@ -1167,8 +1224,9 @@ void guac_terminal_scroll_display_up(guac_terminal* terminal,
 void guac_terminal_copy_columns(guac_terminal* terminal, int row,
         int start_column, int end_column, int offset) {
 
-    guac_terminal_display_copy_columns(terminal->display, row + terminal->scroll_offset,
-            start_column, end_column, offset);
+    if (!terminal->flooded)
+        guac_terminal_display_copy_columns(terminal->display, row + terminal->scroll_offset,
+                start_column, end_column, offset);
 
     guac_terminal_buffer_copy_columns(terminal->buffer, row,
             start_column, end_column, offset);
@@ -1191,8 +1249,9 @@ void guac_terminal_copy_columns(guac_terminal* terminal, int row,
 void guac_terminal_copy_rows(guac_terminal* terminal,
         int start_row, int end_row, int offset) {
 
-    guac_terminal_display_copy_rows(terminal->display,
-            start_row + terminal->scroll_offset, end_row + terminal->scroll_offset, offset);
+    if (!terminal->flooded)
+        guac_terminal_display_copy_rows(terminal->display,
+                start_row + terminal->scroll_offset, end_row + terminal->scroll_offset, offset);
 
     guac_terminal_buffer_copy_rows(terminal->buffer,
             start_row, end_row, offset);
@@ -1233,6 +1292,48 @@ void guac_terminal_set_columns(guac_terminal* terminal, int row,
 
 }
 
+void guac_terminal_set_text(guac_terminal* terminal, int row,
+        int start_column, const char* text, int length) {
+
+    int end_column = start_column + length - 1;
+
+    if (!terminal->flooded)
+        guac_terminal_display_set_text(terminal->display,
+                row + terminal->scroll_offset, start_column, text, length,
+                &terminal->current_attributes);
+
+    guac_terminal_buffer_set_text(terminal->buffer, row, start_column,
+            text, length, &terminal->current_attributes);
+
+    /* Clear selection if region is modified */
+    guac_terminal_select_touch(terminal, row, start_column, row, end_column);
+
+    /* If visible cursor in current row, preserve state */
+    if (row == terminal->visible_cursor_row
+            && terminal->visible_cursor_col >= start_column
+            && terminal->visible_cursor_col <= end_column) {
+
+        /* Create copy of character with cursor attribute set */
+        guac_terminal_char guac_char = {
+            .value      = (unsigned char) text[terminal->visible_cursor_col - start_column],
+            .attributes = terminal->current_attributes,
+            .width      = 1
+        };
+
+        guac_char.attributes.cursor = true;
+
+        __guac_terminal_set_columns(terminal, row,
+                terminal->visible_cursor_col, terminal->visible_cursor_col, &guac_char);
+
+    }
+
+    /* Only the edges of the range can break other characters, as every
+     * character within the range occupies exactly one column */
+    __guac_terminal_force_break(terminal, row, start_column);
+    __guac_terminal_force_break(terminal, row, end_column + 1);
+
+}
+
 static void __guac_terminal_redraw_rect(guac_terminal* term, int start_row, int start_col, int end_row, int end_col) {
 
     int row, col;
@@ -1240,8 +1341,8 @@ static void __guac_terminal_redraw_rect(guac_terminal* term, int start_row, int
     /* Redraw region */
     for (row=start_row; row<=end_row; row++) {
 
-        guac_terminal_buffer_row* buffer_row =
-            guac_terminal_buffer_get_row(term->buffer, row - term->scroll_offset, 0);
+        const guac_terminal_buffer_row* buffer_row =
+            guac_terminal_buffer_peek_row(term->buffer, row - term->scroll_offset);
 
         /* Clear row */
         guac_terminal_display_set_columns(term->display,
@@ -1251,9 +1352,10 @@ static void __guac_terminal_redraw_rect(guac_terminal* term, int start_row, int
         for (col=start_col; col <= end_col && col < buffer_row->length; col++) {
 
             /* Only redraw if not blank */
-            guac_terminal_char* c = &(buffer_row->characters[col]);
-            if (guac_terminal_is_visible(term, c))
-                guac_terminal_display_set_columns(term->display, row, col, col, c);
+            guac_terminal_char c;
+            guac_terminal_buffer_unpack(term->buffer, &(buffer_row->characters[col]), &c);
+            if (guac_terminal_is_visible(term, &c))
+                guac_terminal_display_set_columns(term->display, row, col, col, &c);
 
         }
 
@@ -1456,6 +1558,17 @@ void guac_terminal_flush(guac_terminal* terminal) {
     if (terminal->pipe_stream_flags & GUAC_TERMINAL_PIPE_AUTOFLUSH)
         guac_terminal_pipe_stream_flush(terminal);
 
+    /* If display updates were skipped due to flooding, render only the final
+     * state of the terminal */
+    if (terminal->flooded)
+        __guac_terminal_redraw_rect(terminal, 0, 0,
+                terminal->term_height - 1, terminal->term_width - 1);
+
+    /* Remain flooded for the following frame only if output continues to
+     * arrive at least as quickly as it can scroll by */
+    terminal->flooded = terminal->frame_scrolled_rows >= terminal->term_height;
+    terminal->frame_scrolled_rows = 0;
+
     /* Flush display state */
     guac_terminal_select_redraw(terminal);
     guac_terminal_commit_cursor(terminal);
@@ -0,0 +1,168 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TERMINAL_ATTRIBUTE_TABLE_H
+#define GUAC_TERMINAL_ATTRIBUTE_TABLE_H
+
+/**
+ * A table of the distinct sets of character attributes in use by a terminal
+ * buffer, allowing each stored character to refer to its attributes by a
+ * small index rather than carrying its own copy.
+ *
+ * @file attribute-table.h
+ */
+
+#include "types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The maximum number of distinct sets of attributes which may be stored
+ * within an attribute table. This limit exists only to keep the size of the
+ * table and its hash within the range of an int, and is far larger than the
+ * number of characters within any buffer which fits in memory.
+ */
+#define GUAC_TERMINAL_ATTRIBUTE_TABLE_MAX (1 << 28)
+
+/**
+ * The number of entries initially allocated for an attribute table. The
+ * table grows as needed up to GUAC_TERMINAL_ATTRIBUTE_TABLE_MAX entries.
+ */
+#define GUAC_TERMINAL_ATTRIBUTE_TABLE_INITIAL 64
+
+/**
+ * A table of interned terminal attributes. Identical attributes are always
+ * stored at the same index, such that two characters have the same
+ * attributes if and only if they refer to the same index.
+ */
+typedef struct guac_terminal_attribute_table {
+
+    /**
+     * All interned attributes, indexed by the index returned by
+     * guac_terminal_attribute_table_intern().
+     */
+    guac_terminal_attributes* entries;
+
+    /**
+     * The number of attributes currently stored within the entries array.
+     */
+    int length;
+
+    /**
+     * The number of elements allocated for the entries array.
+     */
+    int available;
+
+    /**
+     * Open-addressed hash table mapping the hash of each set of attributes
+     * to one plus its index within the entries array. Empty slots are 0.
+     */
+    uint32_t* slots;
+
+    /**
+     * The number of slots within the hash table. This is always a power of
+     * two at least twice the number of available entries.
+     */
+    int slot_count;
+
+    /**
+     * The index of the most recently interned attributes. Characters are
+     * typically written in long stretches sharing the same attributes, and
+     * checking this entry first avoids hashing in that common case.
+     */
+    int last;
+
+} guac_terminal_attribute_table;
+
+/**
+ * Allocates a new attribute table containing no attributes.
+ *
+ * @return
+ *     A newly-allocated attribute table, or NULL if allocation fails.
+ */
+guac_terminal_attribute_table* guac_terminal_attribute_table_alloc();
+
+/**
+ * Frees the given attribute table and all attributes stored within it.
+ *
+ * @param table
+ *     The attribute table to free.
+ */
+void guac_terminal_attribute_table_free(guac_terminal_attribute_table* table);
+
+/**
+ * Returns the index of the given attributes within the given table, without
+ * adding the attributes to the table if they are not already present.
+ *
+ * @param table
+ *     The attribute table to search.
+ *
+ * @param attributes
+ *     The attributes to find.
+ *
+ * @return
+ *     The index of the given attributes within the table, or -1 if the
+ *     attributes are not present.
+ */
+int guac_terminal_attribute_table_find(guac_terminal_attribute_table* table,
+        const guac_terminal_attributes* attributes);
+
+/**
+ * Returns the index of the given attributes within the given table, adding
+ * the attributes to the table if they are not already present.
+ *
+ * @param table
+ *     The attribute table to search.
+ *
+ * @param attributes
+ *     The attributes to find or add.
+ *
+ * @return
+ *     The index of the given attributes within the table, or -1 if the
+ *     attributes are not present and cannot be added, either because the
+ *     table is full or because memory for a larger table cannot be
+ *     allocated.
+ */
+int guac_terminal_attribute_table_intern(guac_terminal_attribute_table* table,
+        const guac_terminal_attributes* attributes);
+
+/**
+ * Removes all attributes from the given table which are not marked as used,
+ * renumbering the remaining attributes such that they again occupy
+ * contiguous indices. Attributes which remain keep their relative order, and
+ * thus any attributes at index 0 which are marked as used remain at index 0.
+ *
+ * @param table
+ *     The attribute table to compact.
+ *
+ * @param used
+ *     An array of flags, one for each attribute currently within the table,
+ *     where true indicates that the attributes at that index are still in
+ *     use.
+ *
+ * @param remap
+ *     An array of indices, one for each attribute currently within the
+ *     table, which will receive the new index of each used attribute. The
+ *     values stored for unused attributes are undefined.
+ */
+void guac_terminal_attribute_table_compact(guac_terminal_attribute_table* table,
+        const bool* used, uint32_t* remap);
+
+#endif
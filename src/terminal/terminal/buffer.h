@@ -29,17 +29,60 @@
 
 
 
+#include "attribute-table.h"
 #include "types.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The minimum number of attributes which the attribute table of a buffer may
+ * contain before attributes no longer in use are discarded. Attribute tables
+ * are only compacted once they have at least doubled in size since they were
+ * last compacted, and never while smaller than this.
+ */
+#define GUAC_TERMINAL_BUFFER_MIN_COMPACT_THRESHOLD 65536
+
+/**
+ * A single character as stored within the terminal buffer. Unlike
+ * guac_terminal_char, the attributes of the character are not stored
+ * directly, but as the index of those attributes within the attribute table
+ * of the buffer.
+ */
+typedef struct guac_terminal_packed_char {
+
+    /**
+     * The Unicode codepoint of the character, or GUAC_CHAR_CONTINUATION if
+     * this character is part of another character which spans multiple
+     * columns.
+     */
+    int32_t value;
+
+    /**
+     * The index of the attributes of this character within the attribute
+     * table of the buffer.
+     */
+    uint32_t attributes;
+
+    /**
+     * The number of columns this character occupies. If the character is
+     * GUAC_CHAR_CONTINUATION, this value is undefined and not applicable.
+     */
+    uint8_t width;
+
+} guac_terminal_packed_char;
+
 /**
  * A single variable-length row of terminal data.
  */
 typedef struct guac_terminal_buffer_row {
 
     /**
-     * Array of guac_terminal_char representing the contents of the row.
+     * Array of guac_terminal_packed_char representing the contents of the
+     * row. This array is allocated only once the row is first written, and
+     * is NULL while the row is compressed.
      */
-    guac_terminal_char* characters;
+    guac_terminal_packed_char* characters;
 
     /**
      * The length of this row in characters. This is the number of initialized
@@ -54,6 +97,19 @@ typedef struct guac_terminal_buffer_row {
      */
     int available;
 
+    /**
+     * The compressed contents of this row, or NULL if the row is not
+     * compressed. Rows are compressed as they scroll off the top of the
+     * terminal into the scrollback, and are expanded again only if modified.
+     */
+    unsigned char* compressed;
+
+    /**
+     * The size of the compressed contents of this row, in bytes. If the row
+     * is not compressed, this value is undefined.
+     */
+    size_t compressed_size;
+
 } guac_terminal_buffer_row;
 
 /**
@@ -68,6 +124,26 @@ typedef struct guac_terminal_buffer {
      */
     guac_terminal_char default_character;
 
+    /**
+     * The default character, packed using the attribute table of this
+     * buffer. The attributes of the default character are always at index
+     * 0 of the attribute table.
+     */
+    guac_terminal_packed_char packed_default_character;
+
+    /**
+     * The distinct attributes of all characters stored within this buffer.
+     */
+    guac_terminal_attribute_table* attributes;
+
+    /**
+     * The number of attributes which the attribute table may contain before
+     * attributes no longer used by any character are discarded. This is
+     * recalculated after each compaction such that the table must grow
+     * significantly before it is compacted again.
+     */
+    int attributes_compact_threshold;
+
     /**
      * Array of buffer rows. This array functions as a ring buffer.
      * When a new row needs to be appended, the top reference is moved down
@@ -94,6 +170,13 @@ typedef struct guac_terminal_buffer {
      */
     int available;
 
+    /**
+     * Storage for the contents of compressed rows which have been expanded
+     * for reading by guac_terminal_buffer_peek_row(), without expanding the
+     * rows themselves.
+     */
+    guac_terminal_buffer_row peek_row;
+
 } guac_terminal_buffer;
 
 /**
@@ -109,10 +192,76 @@ void guac_terminal_buffer_free(guac_terminal_buffer* buffer);
 
 /**
  * Returns the row at the given location. The row returned is guaranteed to be at least the given
- * width.
+ * width. If the row is compressed, it is expanded in place.
  */
 guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buffer, int row, int width);
 
+/**
+ * Returns the row at the given location for reading. Unlike
+ * guac_terminal_buffer_get_row(), a compressed row is not expanded in place,
+ * but is instead decompressed into storage owned by the buffer which remains
+ * valid only until the next call to this function. The row returned must
+ * not be modified.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param row
+ *     The index of the row to return, relative to the top of the terminal
+ *     display.
+ *
+ * @return
+ *     The row at the given location, which may contain fewer characters
+ *     than the width of the terminal.
+ */
+const guac_terminal_buffer_row* guac_terminal_buffer_peek_row(
+        guac_terminal_buffer* buffer, int row);
+
+/**
+ * Packs the given character for storage within the given buffer, adding its
+ * attributes to the attribute table of the buffer if necessary.
+ *
+ * @param buffer
+ *     The buffer which will contain the packed character.
+ *
+ * @param character
+ *     The character to pack.
+ *
+ * @param packed
+ *     The packed character to populate.
+ */
+void guac_terminal_buffer_pack(guac_terminal_buffer* buffer,
+        const guac_terminal_char* character, guac_terminal_packed_char* packed);
+
+/**
+ * Unpacks the given character, which must have been packed for storage
+ * within the given buffer.
+ *
+ * @param buffer
+ *     The buffer containing the packed character.
+ *
+ * @param packed
+ *     The packed character to unpack.
+ *
+ * @param character
+ *     The character to populate.
+ */
+void guac_terminal_buffer_unpack(guac_terminal_buffer* buffer,
+        const guac_terminal_packed_char* packed, guac_terminal_char* character);
+
+/**
+ * Scrolls the contents of the buffer up by the given number of rows,
+ * appending the same number of rows to the bottom. Rows which scroll above
+ * row 0 become part of the scrollback, and are compressed.
+ *
+ * @param buffer
+ *     The buffer to scroll.
+ *
+ * @param amount
+ *     The number of rows to scroll.
+ */
+void guac_terminal_buffer_scroll_up(guac_terminal_buffer* buffer, int amount);
+
 /**
  * Copies the given range of columns to a new location, offset from
  * the original by the given number of columns.
@@ -134,5 +283,31 @@ void guac_terminal_buffer_copy_rows(guac_terminal_buffer* buffer,
 void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
         int start_column, int end_column, guac_terminal_char* character);
 
-#endif
+/**
+ * Sets the given range of columns within the given row to the given
+ * printable ASCII characters, all having the given attributes.
+ *
+ * @param buffer
+ *     The buffer to modify.
+ *
+ * @param row
+ *     The row to modify.
+ *
+ * @param start_column
+ *     The first column to modify.
+ *
+ * @param text
+ *     The characters to store. Each character must be printable ASCII
+ *     (0x20 through 0x7E inclusive), and thus occupies exactly one column.
+ *
+ * @param length
+ *     The number of characters to store.
+ *
+ * @param attributes
+ *     The attributes to apply to every character stored.
+ */
+void guac_terminal_buffer_set_text(guac_terminal_buffer* buffer, int row,
+        int start_column, const char* text, int length,
+        const guac_terminal_attributes* attributes);
 
+#endif
@@ -29,6 +29,7 @@
 
 
 #include "common/surface.h"
+#include "glyph-cache.h"
 #include "palette.h"
 #include "types.h"
 
@@ -138,6 +139,24 @@ typedef struct guac_terminal_display {
      */
     int char_height;
 
+    /**
+     * Cache of all recently-rendered glyphs, such that repeated characters
+     * need not be laid out and rasterized again.
+     */
+    guac_terminal_glyph_cache* glyph_cache;
+
+    /**
+     * Buffer into which consecutive glyphs of a row are composited, such
+     * that each run of changed characters is drawn to the display surface
+     * as a single image, or NULL if no such buffer has yet been allocated.
+     */
+    unsigned char* run_buffer;
+
+    /**
+     * The size of run_buffer, in bytes.
+     */
+    size_t run_buffer_size;
+
     /**
      * The current palette.
      */
@@ -297,6 +316,34 @@ void guac_terminal_display_copy_rows(guac_terminal_display* display,
 void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
         int start_column, int end_column, guac_terminal_char* character);
 
+/**
+ * Sets a range of columns within the given row to the given printable ASCII
+ * characters, all having the given attributes. This is equivalent to
+ * calling guac_terminal_display_set_columns() for each character.
+ *
+ * @param display
+ *     The display to modify.
+ *
+ * @param row
+ *     The row to modify.
+ *
+ * @param start_column
+ *     The first column to modify.
+ *
+ * @param text
+ *     The characters to set. Each character must be printable ASCII (0x20
+ *     through 0x7E inclusive), and thus occupies exactly one column.
+ *
+ * @param length
+ *     The number of characters to set.
+ *
+ * @param attributes
+ *     The attributes to apply to every character set.
+ */
+void guac_terminal_display_set_text(guac_terminal_display* display, int row,
+        int start_column, const char* text, int length,
+        const guac_terminal_attributes* attributes);
+
 /**
  * Resize the terminal to the given dimensions.
  */
@@ -0,0 +1,176 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TERMINAL_GLYPH_CACHE_H
+#define GUAC_TERMINAL_GLYPH_CACHE_H
+
+/**
+ * A cache of rendered glyphs, allowing each distinct combination of
+ * character and colors to be laid out and rasterized by Pango only once.
+ * Subsequent renderings of the same glyph are composited directly from the
+ * cached image.
+ *
+ * @file glyph-cache.h
+ */
+
+#include "palette.h"
+
+#include <cairo/cairo.h>
+
+#include <stdint.h>
+
+/**
+ * The number of glyphs which may be stored within a glyph cache. The cache
+ * is direct-mapped: each glyph may be stored in only one slot, replacing any
+ * glyph previously stored in that slot. This must be a power of two.
+ */
+#define GUAC_TERMINAL_GLYPH_CACHE_SIZE 2048
+
+/**
+ * A single rendered glyph, stored within a slot of a guac_terminal_glyph_cache.
+ */
+typedef struct guac_terminal_glyph {
+
+    /**
+     * The Unicode codepoint of the character rendered.
+     */
+    int codepoint;
+
+    /**
+     * The foreground color of the glyph, as a 24-bit RGB value.
+     */
+    uint32_t foreground;
+
+    /**
+     * The background color of the glyph, as a 24-bit RGB value.
+     */
+    uint32_t background;
+
+    /**
+     * The rendered glyph, or NULL if this slot is empty.
+     */
+    cairo_surface_t* surface;
+
+} guac_terminal_glyph;
+
+/**
+ * A bounded cache of rendered glyphs, keyed by codepoint and the exact
+ * foreground and background colors used. Attributes such as bold and
+ * half-bright affect rendering only through the colors chosen, and are thus
+ * implicitly part of the key. All cached glyphs are rendered with the same
+ * font, and the cache must be cleared whenever that font changes.
+ */
+typedef struct guac_terminal_glyph_cache {
+
+    /**
+     * All slots of the cache, indexed by the hash of the glyph stored.
+     */
+    guac_terminal_glyph glyphs[GUAC_TERMINAL_GLYPH_CACHE_SIZE];
+
+    /**
+     * The number of lookups which found the requested glyph, for the sake of
+     * logging cache effectiveness.
+     */
+    uint64_t hits;
+
+    /**
+     * The number of lookups which did not find the requested glyph.
+     */
+    uint64_t misses;
+
+} guac_terminal_glyph_cache;
+
+/**
+ * Allocates a new, empty glyph cache.
+ *
+ * @return
+ *     A newly-allocated glyph cache, or NULL if allocation fails.
+ */
+guac_terminal_glyph_cache* guac_terminal_glyph_cache_alloc();
+
+/**
+ * Frees the given glyph cache and all glyphs stored within it.
+ *
+ * @param cache
+ *     The glyph cache to free.
+ */
+void guac_terminal_glyph_cache_free(guac_terminal_glyph_cache* cache);
+
+/**
+ * Removes all glyphs from the given glyph cache. This must be invoked
+ * whenever the font or character dimensions used to render glyphs change.
+ *
+ * @param cache
+ *     The glyph cache to clear.
+ */
+void guac_terminal_glyph_cache_clear(guac_terminal_glyph_cache* cache);
+
+/**
+ * Returns the cached rendering of the given codepoint in the given colors,
+ * if any. The returned surface remains owned by the cache and is valid only
+ * until the next call to guac_terminal_glyph_cache_store() or
+ * guac_terminal_glyph_cache_clear().
+ *
+ * @param cache
+ *     The glyph cache to search.
+ *
+ * @param codepoint
+ *     The Unicode codepoint of the character to find.
+ *
+ * @param foreground
+ *     The foreground color of the glyph.
+ *
+ * @param background
+ *     The background color of the glyph.
+ *
+ * @return
+ *     The cached rendering of the requested glyph, or NULL if no such glyph
+ *     is cached.
+ */
+cairo_surface_t* guac_terminal_glyph_cache_lookup(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background);
+
+/**
+ * Stores the given rendering of the given codepoint in the given colors,
+ * replacing whichever glyph occupied the same slot. Ownership of the given
+ * surface is transferred to the cache.
+ *
+ * @param cache
+ *     The glyph cache to store the glyph within.
+ *
+ * @param codepoint
+ *     The Unicode codepoint of the character rendered.
+ *
+ * @param foreground
+ *     The foreground color of the glyph.
+ *
+ * @param background
+ *     The background color of the glyph.
+ *
+ * @param surface
+ *     The rendered glyph.
+ */
+void guac_terminal_glyph_cache_store(guac_terminal_glyph_cache* cache,
+        int codepoint, const guac_terminal_color* foreground,
+        const guac_terminal_color* background, cairo_surface_t* surface);
+
+#endif
+
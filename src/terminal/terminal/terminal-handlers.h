@@ -45,6 +45,30 @@
  */
 int guac_terminal_echo(guac_terminal* term, unsigned char c);
 
+/**
+ * Echoes the run of printable ASCII characters at the beginning of the given
+ * buffer to the terminal display in bulk, exactly as if each character had
+ * been passed to guac_terminal_echo() individually. Bulk echoing is possible
+ * only while the terminal is in its default mode, is using Unicode, is not
+ * in insert mode, has no open pipe stream, and is not in the middle of a
+ * multibyte character. If these conditions are not met, or the buffer does
+ * not begin with a printable ASCII character, nothing is echoed.
+ *
+ * @param term
+ *     The terminal that received the given data.
+ *
+ * @param text
+ *     The data received by the given terminal.
+ *
+ * @param length
+ *     The number of bytes of data received.
+ *
+ * @return
+ *     The number of bytes echoed, which may be 0 if no bytes could be echoed
+ *     in bulk and must instead be handled individually.
+ */
+int guac_terminal_echo_text(guac_terminal* term, const char* text, int length);
+
 /**
  * Handles any characters which follow an ANSI ESC (0x1B) character.
  *
@@ -298,6 +298,19 @@ struct guac_terminal {
      */
     guac_terminal_char_handler* char_handler;
 
+    /**
+     * The bits of the UTF-8 character currently being decoded by
+     * guac_terminal_echo() which have been received so far.
+     */
+    int utf8_codepoint;
+
+    /**
+     * The number of bytes of the UTF-8 character currently being decoded by
+     * guac_terminal_echo() which have yet to be received, or 0 if no
+     * multibyte character is in progress.
+     */
+    int utf8_bytes_remaining;
+
     /**
      * The difference between the currently-rendered screen and the current
      * state of the terminal, and the contextual information necessary to
@@ -305,6 +318,21 @@ struct guac_terminal {
      */
     guac_terminal_display* display;
 
+    /**
+     * The number of rows which have scrolled off the top of the terminal
+     * since the display was last flushed.
+     */
+    int frame_scrolled_rows;
+
+    /**
+     * Whether the terminal is receiving output faster than it can be
+     * displayed, such that at least an entire screen of rows has scrolled
+     * off the terminal within a single frame. While flooded, changes are
+     * applied only to the terminal buffer, and the entire visible area of
+     * the display is redrawn from the buffer when the next frame is flushed.
+     */
+    bool flooded;
+
     /**
      * Current terminal display state. All characters present on the screen
      * are within this buffer. This has nothing to do with the display, which
@@ -483,6 +511,32 @@ void guac_terminal_scroll_handler(guac_terminal_scrollbar* scrollbar, int value)
 void guac_terminal_set_columns(guac_terminal* terminal, int row,
         int start_column, int end_column, guac_terminal_char* character);
 
+/**
+ * Sets a range of columns within the given row to the given printable ASCII
+ * characters, using the current attributes of the terminal. This is
+ * equivalent to calling guac_terminal_set() for each character, but updates
+ * the terminal buffer and surrounding state only once for the entire range.
+ *
+ * @param terminal
+ *     The terminal to modify.
+ *
+ * @param row
+ *     The row to modify.
+ *
+ * @param start_column
+ *     The first column to modify.
+ *
+ * @param text
+ *     The characters to store. Each character must be printable ASCII
+ *     (0x20 through 0x7E inclusive).
+ *
+ * @param length
+ *     The number of characters to store. The range of columns modified must
+ *     fit within the terminal.
+ */
+void guac_terminal_set_text(guac_terminal* terminal, int row,
+        int start_column, const char* text, int length);
+
 /**
  * Acquires exclusive access to the terminal. Note that enforcing this
  * exclusive access requires that ALL users of the terminal call this
@@ -167,6 +167,24 @@ guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
 void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
         char c);
 
+/**
+ * Writes the given terminal data to the typescript, flushing and writing
+ * new timestamps as necessary. This is equivalent to calling
+ * guac_terminal_typescript_write() for each byte, but copies the data into
+ * the typescript buffer in as few pieces as possible.
+ *
+ * @param typescript
+ *     The typescript that the given raw terminal data should be written to.
+ *
+ * @param data
+ *     The raw terminal data to write to the typescript.
+ *
+ * @param length
+ *     The number of bytes of data to write.
+ */
+void guac_terminal_typescript_write_data(guac_terminal_typescript* typescript,
+        const char* data, int length);
+
 /**
  * Flushes any pending data to the typescript, writing a new timestamp to the
  * timing file if any data was flushed.
@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "terminal/attribute-table.h"
+#include "terminal/types.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The number of distinct attributes interned by each test, chosen to exceed
+ * the 16-bit limit on attribute indices which once applied.
+ */
+#define TEST_ATTRIBUTES 100000
+
+/**
+ * Initializes the given attributes with a truecolor foreground color unique
+ * to the given number.
+ *
+ * @param attributes
+ *     The attributes to initialize.
+ *
+ * @param number
+ *     The number identifying the attributes. Attributes initialized with
+ *     different numbers (less than 2^24) are different.
+ */
+static void init_attributes(guac_terminal_attributes* attributes, int number) {
+    memset(attributes, 0, sizeof(guac_terminal_attributes));
+    attributes->foreground.palette_index = -1;
+    attributes->foreground.red   = (number >> 16) & 0xFF;
+    attributes->foreground.green = (number >> 8)  & 0xFF;
+    attributes->foreground.blue  =  number        & 0xFF;
+}
+
+/**
+ * Verifies that more distinct attributes can be interned than fit within a
+ * 16-bit index, each receiving its own index, and that each can be found
+ * again at that index.
+ */
+void test_attribute_table__intern_many() {
+
+    guac_terminal_attribute_table* table = guac_terminal_attribute_table_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+
+    guac_terminal_attributes attributes;
+
+    for (int i = 0; i < TEST_ATTRIBUTES; i++) {
+        init_attributes(&attributes, i);
+        CU_ASSERT_EQUAL_FATAL(guac_terminal_attribute_table_find(table, &attributes), -1);
+        CU_ASSERT_EQUAL_FATAL(guac_terminal_attribute_table_intern(table, &attributes), i);
+    }
+
+    CU_ASSERT_EQUAL(table->length, TEST_ATTRIBUTES);
+
+    for (int i = 0; i < TEST_ATTRIBUTES; i++) {
+        init_attributes(&attributes, i);
+        CU_ASSERT_EQUAL_FATAL(guac_terminal_attribute_table_find(table, &attributes), i);
+        CU_ASSERT_EQUAL_FATAL(guac_terminal_attribute_table_intern(table, &attributes), i);
+    }
+
+    guac_terminal_attribute_table_free(table);
+
+}
+
+/**
+ * Verifies that compacting an attribute table removes exactly the attributes
+ * not marked as used, preserving the relative order of those remaining and
+ * reporting their new indices.
+ */
+void test_attribute_table__compact() {
+
+    guac_terminal_attribute_table* table = guac_terminal_attribute_table_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+
+    guac_terminal_attributes attributes;
+    for (int i = 0; i < TEST_ATTRIBUTES; i++) {
+        init_attributes(&attributes, i);
+        guac_terminal_attribute_table_intern(table, &attributes);
+    }
+
+    /* Keep only every third set of attributes */
+    bool* used = calloc(TEST_ATTRIBUTES, sizeof(bool));
+    uint32_t* remap = calloc(TEST_ATTRIBUTES, sizeof(uint32_t));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(used);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(remap);
+
+    for (int i = 0; i < TEST_ATTRIBUTES; i += 3)
+        used[i] = true;
+
+    guac_terminal_attribute_table_compact(table, used, remap);
+    CU_ASSERT_EQUAL(table->length, (TEST_ATTRIBUTES + 2) / 3);
+
+    for (int i = 0; i < TEST_ATTRIBUTES; i++) {
+
+        init_attributes(&attributes, i);
+        int index = guac_terminal_attribute_table_find(table, &attributes);
+
+        if (used[i]) {
+            CU_ASSERT_EQUAL_FATAL(remap[i], i / 3);
+            CU_ASSERT_EQUAL_FATAL(index, i / 3);
+        }
+        else
+            CU_ASSERT_EQUAL_FATAL(index, -1);
+
+    }
+
+    free(used);
+    free(remap);
+    guac_terminal_attribute_table_free(table);
+
+}
+
@@ -0,0 +1,300 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Benchmark which measures the memory consumed by the terminal buffers of
+ * many concurrent sessions, each filling its entire scrollback with typical
+ * shell output: colored prompts, log lines, short command output, blank
+ * lines, and occasional double-width characters. The resident set size of
+ * the process is sampled before and after all buffers are filled. This
+ * program is not run as part of "make check", and must be built explicitly
+ * with "make bench_buffer_memory".
+ *
+ * Usage: bench_buffer_memory [SESSIONS [SCROLLBACK]]
+ */
+
+#include "terminal/buffer.h"
+#include "terminal/types.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The width of each simulated terminal, in columns.
+ */
+#define BENCH_COLUMNS 80
+
+/**
+ * The height of each simulated terminal, in rows.
+ */
+#define BENCH_ROWS 24
+
+/**
+ * The default number of concurrent sessions to simulate.
+ */
+#define BENCH_DEFAULT_SESSIONS 32
+
+/**
+ * The default number of rows of scrollback within each session.
+ */
+#define BENCH_DEFAULT_SCROLLBACK 10000
+
+/**
+ * Returns the current value of the monotonic clock, in nanoseconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in nanoseconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * Returns the resident set size of this process, in bytes.
+ *
+ * @return
+ *     The resident set size of this process, in bytes, or 0 if it cannot be
+ *     determined.
+ */
+static uint64_t bench_rss() {
+
+    unsigned long size, resident;
+
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL)
+        return 0;
+
+    int fields = fscanf(statm, "%lu %lu", &size, &resident);
+    fclose(statm);
+
+    if (fields != 2)
+        return 0;
+
+    return (uint64_t) resident * sysconf(_SC_PAGESIZE);
+
+}
+
+/**
+ * Sets the given color to the given entry of the default 16-color palette.
+ *
+ * @param color
+ *     The color to set.
+ *
+ * @param index
+ *     The palette index of the color.
+ */
+static void bench_color(guac_terminal_color* color, int index) {
+    color->palette_index = index;
+    color->red   = (index & 1) ? 0xCC : 0x00;
+    color->green = (index & 2) ? 0xCC : 0x00;
+    color->blue  = (index & 4) ? 0xCC : 0x00;
+}
+
+/**
+ * Writes the given text to the given row of the given buffer, starting at
+ * the given column, with the given foreground color and boldness.
+ *
+ * @param buffer
+ *     The buffer to write to.
+ *
+ * @param row
+ *     The row to write to.
+ *
+ * @param column
+ *     The column to begin writing at.
+ *
+ * @param text
+ *     The text to write. Any '#' characters are replaced with a
+ *     double-width character.
+ *
+ * @param foreground
+ *     The palette index of the foreground color.
+ *
+ * @param bold
+ *     Whether the text should be bold.
+ *
+ * @return
+ *     The column following the last character written.
+ */
+static int bench_write(guac_terminal_buffer* buffer, int row, int column,
+        const char* text, int foreground, bool bold) {
+
+    guac_terminal_char character = buffer->default_character;
+    bench_color(&character.attributes.foreground, foreground);
+    character.attributes.bold = bold;
+
+    for (; *text != '\0' && column < BENCH_COLUMNS; text++) {
+
+        character.value = *text;
+        character.width = 1;
+
+        /* Substitute a CJK ideograph for each placeholder */
+        if (*text == '#' && column + 1 < BENCH_COLUMNS) {
+            character.value = 0x6F22;
+            character.width = 2;
+        }
+
+        guac_terminal_buffer_set_columns(buffer, row, column,
+                column + character.width - 1, &character);
+
+        column += character.width;
+
+    }
+
+    return column;
+
+}
+
+/**
+ * Writes the given line of simulated shell output to the bottom row of the
+ * given buffer, scrolling the buffer to make room for the next line, in the
+ * same manner as the terminal emulator.
+ *
+ * @param buffer
+ *     The buffer to write to.
+ *
+ * @param line
+ *     The number of the line being written, used to vary its content.
+ */
+static void bench_write_line(guac_terminal_buffer* buffer, int line) {
+
+    char text[BENCH_COLUMNS + 1];
+    int row = BENCH_ROWS - 1;
+    int column = 0;
+
+    /* Clear new row */
+    guac_terminal_buffer_set_columns(buffer, row, 0, BENCH_COLUMNS - 1,
+            &buffer->default_character);
+
+    switch (line % 10) {
+
+        /* Colored prompt followed by a command */
+        case 0:
+            column = bench_write(buffer, row, column, "user@host", 2, true);
+            column = bench_write(buffer, row, column, ":", 7, false);
+            column = bench_write(buffer, row, column, "~/src/project", 4, true);
+            bench_write(buffer, row, column, "$ make -j8 check", 7, false);
+            break;
+
+        /* Log lines with a colored severity */
+        case 1:
+        case 2:
+        case 3:
+        case 4:
+            snprintf(text, sizeof(text), "2024-01-01 12:%02i:%02i ",
+                    (line / 60) % 60, line % 60);
+            column = bench_write(buffer, row, column, text, 7, false);
+            column = bench_write(buffer, row, column,
+                    (line % 7) ? "INFO " : "WARN ", (line % 7) ? 2 : 3, true);
+            snprintf(text, sizeof(text), "worker-%i: request %i handled "
+                    "in %ims", line % 13, line, line % 97);
+            bench_write(buffer, row, column, text, 7, false);
+            break;
+
+        /* Short command output */
+        case 5:
+        case 6:
+            snprintf(text, sizeof(text), "  CC       src/module-%i.lo",
+                    line % 211);
+            bench_write(buffer, row, column, text, 7, false);
+            break;
+
+        /* Output containing double-width characters */
+        case 7:
+            bench_write(buffer, row, column, "commit: ## ### (#)", 3, false);
+            break;
+
+        /* Blank lines */
+        default:
+            break;
+
+    }
+
+    guac_terminal_buffer_scroll_up(buffer, 1);
+
+}
+
+int main(int argc, char** argv) {
+
+    int sessions = BENCH_DEFAULT_SESSIONS;
+    int scrollback = BENCH_DEFAULT_SCROLLBACK;
+
+    if (argc > 1)
+        sessions = atoi(argv[1]);
+
+    if (argc > 2)
+        scrollback = atoi(argv[2]);
+
+    if (sessions <= 0 || scrollback < BENCH_ROWS) {
+        fprintf(stderr, "Usage: %s [SESSIONS [SCROLLBACK]]\n", argv[0]);
+        return 1;
+    }
+
+    guac_terminal_char default_char = {
+        .value = 0,
+        .width = 1
+    };
+
+    bench_color(&default_char.attributes.foreground, 7);
+    bench_color(&default_char.attributes.background, 0);
+
+    guac_terminal_buffer** buffers =
+        malloc(sizeof(guac_terminal_buffer*) * sessions);
+
+    uint64_t rss_before = bench_rss();
+    double start = bench_now();
+
+    /* Fill the entire scrollback of every session */
+    for (int i = 0; i < sessions; i++) {
+
+        buffers[i] = guac_terminal_buffer_alloc(scrollback, &default_char);
+
+        for (int line = 0; line < scrollback; line++)
+            bench_write_line(buffers[i], line + i);
+
+    }
+
+    double elapsed = bench_now() - start;
+    uint64_t rss_after = bench_rss();
+
+    printf("sessions:            %i\n", sessions);
+    printf("scrollback:          %i rows of %i columns\n",
+            scrollback, BENCH_COLUMNS);
+    printf("cell size:           %zu bytes\n",
+            sizeof(guac_terminal_packed_char));
+    printf("RSS per session:     %.1f KiB\n",
+            (double) (rss_after - rss_before) / sessions / 1024);
+    printf("RSS total:           %.1f MiB\n",
+            (double) (rss_after - rss_before) / (1024 * 1024));
+    printf("time per line:       %.0f ns\n",
+            elapsed / ((double) sessions * scrollback));
+
+    for (int i = 0; i < sessions; i++)
+        guac_terminal_buffer_free(buffers[i]);
+
+    free(buffers);
+    return 0;
+
+}
@@ -0,0 +1,225 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "terminal/buffer.h"
+#include "terminal/types.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * The number of columns written within each row by the tests in this file.
+ */
+#define TEST_COLUMNS 80
+
+/**
+ * The number of rows within each buffer used by the tests in this file.
+ */
+#define TEST_ROWS 1000
+
+/**
+ * Initializes the given character as a space whose foreground color is a
+ * truecolor value unique to the given number, as would be written by
+ * programs which produce gradients or images using 24-bit color.
+ *
+ * @param character
+ *     The character to initialize.
+ *
+ * @param number
+ *     The number identifying the color of the character. Characters
+ *     initialized with different numbers (less than 2^24) have different
+ *     attributes.
+ */
+static void init_char(guac_terminal_char* character, int number) {
+
+    memset(character, 0, sizeof(guac_terminal_char));
+    character->value = ' ';
+    character->width = 1;
+
+    character->attributes.foreground.palette_index = -1;
+    character->attributes.foreground.red   = (number >> 16) & 0xFF;
+    character->attributes.foreground.green = (number >> 8)  & 0xFF;
+    character->attributes.foreground.blue  =  number        & 0xFF;
+
+}
+
+/**
+ * Writes a row of characters to the given buffer, each having different
+ * attributes numbered consecutively from the given number.
+ *
+ * @param buffer
+ *     The buffer to write to.
+ *
+ * @param row
+ *     The row to write.
+ *
+ * @param first
+ *     The number identifying the attributes of the first character of the
+ *     row, as accepted by init_char().
+ */
+static void write_row(guac_terminal_buffer* buffer, int row, int first) {
+
+    for (int column = 0; column < TEST_COLUMNS; column++) {
+        guac_terminal_char character;
+        init_char(&character, first + column);
+        guac_terminal_buffer_set_columns(buffer, row, column, column,
+                &character);
+    }
+
+}
+
+/**
+ * Verifies that every character within the given row of the given buffer
+ * still has the attributes with which it was written by write_row().
+ *
+ * @param buffer
+ *     The buffer to read from.
+ *
+ * @param row
+ *     The row to verify.
+ *
+ * @param first
+ *     The number identifying the attributes of the first character of the
+ *     row, as originally provided to write_row().
+ *
+ * @return
+ *     true if every character within the row has the expected attributes,
+ *     false otherwise.
+ */
+static bool verify_row(guac_terminal_buffer* buffer, int row, int first) {
+
+    const guac_terminal_buffer_row* buffer_row =
+        guac_terminal_buffer_peek_row(buffer, row);
+
+    if (buffer_row->length != TEST_COLUMNS)
+        return false;
+
+    for (int column = 0; column < TEST_COLUMNS; column++) {
+
+        guac_terminal_char expected;
+        init_char(&expected, first + column);
+
+        guac_terminal_char actual;
+        guac_terminal_buffer_unpack(buffer,
+                &buffer_row->characters[column], &actual);
+
+        if (actual.attributes.foreground.palette_index != -1
+                || actual.attributes.foreground.red != expected.attributes.foreground.red
+                || actual.attributes.foreground.green != expected.attributes.foreground.green
+                || actual.attributes.foreground.blue != expected.attributes.foreground.blue)
+            return false;
+
+    }
+
+    return true;
+
+}
+
+/**
+ * Allocates a new buffer of TEST_ROWS rows whose default character is a
+ * blank space with default attributes.
+ *
+ * @return
+ *     A newly-allocated buffer.
+ */
+static guac_terminal_buffer* alloc_buffer() {
+
+    guac_terminal_char blank;
+    memset(&blank, 0, sizeof(blank));
+    blank.width = 1;
+
+    return guac_terminal_buffer_alloc(TEST_ROWS, &blank);
+
+}
+
+/**
+ * Verifies that a buffer whose every character has distinct attributes,
+ * well beyond the number of attributes which once fit within the attribute
+ * table, retains the attributes of every character.
+ */
+void test_buffer__attributes_all_distinct() {
+
+    guac_terminal_buffer* buffer = alloc_buffer();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(buffer);
+
+    /* Fill every row with distinct attributes */
+    for (int row = 0; row < TEST_ROWS; row++)
+        write_row(buffer, row, row * TEST_COLUMNS);
+
+    /* No attributes may have been lost */
+    int lost = 0;
+    for (int row = 0; row < TEST_ROWS; row++) {
+        if (!verify_row(buffer, row, row * TEST_COLUMNS))
+            lost++;
+    }
+
+    CU_ASSERT_EQUAL(lost, 0);
+
+    /* As every attribute remains in use, compacting the table cannot help
+     * until it has grown significantly */
+    CU_ASSERT_TRUE(buffer->attributes_compact_threshold
+            > buffer->attributes->length);
+
+    guac_terminal_buffer_free(buffer);
+
+}
+
+/**
+ * Verifies that attributes of characters which have scrolled out of the
+ * buffer are eventually discarded from the attribute table, while the
+ * attributes of characters still within the buffer are retained, even after
+ * many times more distinct attributes have been written than fit within the
+ * buffer.
+ */
+void test_buffer__attributes_scrolled() {
+
+    guac_terminal_buffer* buffer = alloc_buffer();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(buffer);
+
+    /* Write many more rows than the buffer can hold, each scrolling the
+     * previous rows further into the scrollback */
+    int written = TEST_ROWS * 5;
+    for (int line = 0; line < written; line++) {
+        write_row(buffer, 0, line * TEST_COLUMNS);
+        guac_terminal_buffer_scroll_up(buffer, 1);
+    }
+
+    /* All rows still within the buffer retain their attributes */
+    int lost = 0;
+    for (int row = -TEST_ROWS + 1; row < 0; row++) {
+        int line = written + row;
+        if (!verify_row(buffer, row, line * TEST_COLUMNS))
+            lost++;
+    }
+
+    CU_ASSERT_EQUAL(lost, 0);
+
+    /* The table never holds more than twice the number of attributes that
+     * can be in use at once */
+    int max_length = TEST_ROWS * TEST_COLUMNS * 2 + 1;
+    if (max_length < GUAC_TERMINAL_BUFFER_MIN_COMPACT_THRESHOLD)
+        max_length = GUAC_TERMINAL_BUFFER_MIN_COMPACT_THRESHOLD;
+
+    CU_ASSERT_TRUE(buffer->attributes->length <= max_length);
+
+    guac_terminal_buffer_free(buffer);
+
+}
+
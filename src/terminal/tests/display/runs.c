@@ -0,0 +1,296 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "terminal/buffer.h"
+
+#include "common/surface.h"
+#include "terminal/display.h"
+#include "terminal/glyph-cache.h"
+#include "terminal/palette.h"
+#include "terminal/types.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The width of the display used by test_display__runs_attributes(), in
+ * columns.
+ */
+#define TEST_DISPLAY_COLUMNS 16
+
+/**
+ * The height of the display used by test_display__runs_attributes(), in
+ * rows.
+ */
+#define TEST_DISPLAY_ROWS 2
+
+/**
+ * The expected contents of a single cell of the display.
+ */
+typedef struct test_display_cell {
+
+    /**
+     * The codepoint of the character which should be drawn within the cell,
+     * or zero if the cell should be filled with the background color alone.
+     */
+    int codepoint;
+
+    /**
+     * The color that the glyph of the character should have been rendered
+     * with.
+     */
+    guac_terminal_color foreground;
+
+    /**
+     * The color that the background of the cell should have.
+     */
+    guac_terminal_color background;
+
+} test_display_cell;
+
+/**
+ * Sets the given columns of the first row of the given display to the given
+ * character, recording the contents expected of those columns once drawn.
+ *
+ * @param display
+ *     The display to draw to.
+ *
+ * @param expected
+ *     The expected contents of each column of the first row.
+ *
+ * @param start_column
+ *     The first column to set.
+ *
+ * @param end_column
+ *     The last column to set, inclusive.
+ *
+ * @param codepoint
+ *     The codepoint of the character to set, which must be a single-column
+ *     character.
+ *
+ * @param attributes
+ *     The attributes of the character.
+ */
+static void test_display_set(guac_terminal_display* display,
+        test_display_cell* expected, int start_column, int end_column,
+        int codepoint, const guac_terminal_attributes* attributes) {
+
+    guac_terminal_char character = {
+        .value = codepoint,
+        .attributes = *attributes,
+        .width = 1
+    };
+
+    guac_terminal_display_set_columns(display, 0, start_column, end_column,
+            &character);
+
+    for (int column = start_column; column <= end_column; column++) {
+
+        test_display_cell* cell = &expected[column];
+        cell->codepoint = (codepoint == ' ') ? 0 : codepoint;
+
+        /* Reverse video swaps the colors drawn */
+        if (attributes->reverse) {
+            cell->foreground = attributes->background;
+            cell->background = attributes->foreground;
+        }
+        else {
+            cell->foreground = attributes->foreground;
+            cell->background = attributes->background;
+        }
+
+    }
+
+}
+
+/**
+ * Returns the number of pixels within the given cell of the given display
+ * which differ from the expected contents of that cell. A cell expected to
+ * contain a character must match the rendering of that character within the
+ * glyph cache of the display, such that the result does not depend on the
+ * font. If no such rendering is cached, every pixel is considered to differ.
+ *
+ * @param display
+ *     The display to inspect.
+ *
+ * @param row
+ *     The row of the cell.
+ *
+ * @param column
+ *     The column of the cell.
+ *
+ * @param expected
+ *     The expected contents of the cell.
+ *
+ * @return
+ *     The number of pixels within the cell which differ from the expected
+ *     contents.
+ */
+static int test_display_cell_mismatches(guac_terminal_display* display,
+        int row, int column, const test_display_cell* expected) {
+
+    int cell_pixels = display->char_width * display->char_height;
+
+    /* Locate rendered glyph, if any */
+    unsigned char* glyph_buffer = NULL;
+    int glyph_stride = 0;
+    if (expected->codepoint != 0) {
+
+        cairo_surface_t* glyph = guac_terminal_glyph_cache_lookup(
+                display->glyph_cache, expected->codepoint,
+                &expected->foreground, &expected->background);
+
+        if (glyph == NULL)
+            return cell_pixels;
+
+        glyph_buffer = cairo_image_surface_get_data(glyph);
+        glyph_stride = cairo_image_surface_get_stride(glyph);
+
+    }
+
+    const guac_terminal_color* background = &expected->background;
+    uint32_t fill = (background->red << 16) | (background->green << 8)
+        | background->blue;
+
+    guac_common_surface* surface = display->display_surface;
+
+    int mismatches = 0;
+    for (int y = 0; y < display->char_height; y++) {
+
+        uint32_t* pixel = (uint32_t*) (surface->buffer
+                + (row * display->char_height + y) * surface->stride)
+                + column * display->char_width;
+
+        uint32_t* glyph_pixel = (uint32_t*) (glyph_buffer + y * glyph_stride);
+
+        for (int x = 0; x < display->char_width; x++) {
+            uint32_t color = (glyph_buffer != NULL) ? glyph_pixel[x] : fill;
+            if ((pixel[x] & 0xFFFFFF) != (color & 0xFFFFFF))
+                mismatches++;
+        }
+
+    }
+
+    return mismatches;
+
+}
+
+/**
+ * Verifies that a row of characters whose attributes change from cell to
+ * cell, broken into several runs by cleared and unchanged cells, is
+ * composited with the correct glyph and colors within every cell, and that
+ * unchanged cells retain their previous contents.
+ */
+void test_display__runs_attributes() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    const guac_terminal_color* palette = GUAC_TERMINAL_INITIAL_PALETTE;
+    guac_terminal_color foreground = palette[7];
+    guac_terminal_color background = palette[0];
+
+    /* The default palette is freed along with the display */
+    guac_terminal_color (*default_palette)[256] =
+        malloc(sizeof(guac_terminal_color[256]));
+    memcpy(default_palette, palette, sizeof(guac_terminal_color[256]));
+
+    guac_terminal_display* display = guac_terminal_display_alloc(client,
+            "monospace", 12, 96, &foreground, &background, default_palette);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(display);
+
+    guac_terminal_display_reset_palette(display);
+    guac_terminal_display_resize(display, TEST_DISPLAY_COLUMNS,
+            TEST_DISPLAY_ROWS);
+    guac_terminal_display_flush(display);
+
+    test_display_cell expected[TEST_DISPLAY_COLUMNS];
+    guac_terminal_attributes attributes = {
+        .foreground = foreground,
+        .background = palette[3]
+    };
+
+    /* Fill the first row with a color not otherwise used */
+    test_display_set(display, expected, 0, TEST_DISPLAY_COLUMNS - 1, ' ',
+            &attributes);
+    guac_terminal_display_flush(display);
+
+    /* Backgrounds from the palette */
+    attributes.background = palette[1];
+    test_display_set(display, expected, 0, 2, 'a', &attributes);
+
+    attributes.background = palette[2];
+    test_display_set(display, expected, 3, 4, 'b', &attributes);
+
+    /* Background outside the palette */
+    attributes.background = (guac_terminal_color) { -1, 0x0A, 0x14, 0x1E };
+    test_display_set(display, expected, 5, 5, 'c', &attributes);
+
+    /* Change of foreground alone */
+    attributes.foreground = palette[1];
+    test_display_set(display, expected, 6, 6, 'c', &attributes);
+
+    /* Columns 7 and 8 are left unchanged, splitting the row into separate
+     * runs */
+    attributes.foreground = foreground;
+    attributes.background = palette[4];
+    test_display_set(display, expected, 9, 10, 'd', &attributes);
+
+    /* Reverse video */
+    attributes.foreground = palette[5];
+    attributes.background = palette[6];
+    attributes.reverse = true;
+    test_display_set(display, expected, 11, 11, 'e', &attributes);
+
+    /* A cleared cell between runs */
+    attributes.reverse = false;
+    attributes.background = palette[1];
+    test_display_set(display, expected, 12, 12, ' ', &attributes);
+
+    attributes.foreground = foreground;
+    test_display_set(display, expected, 13, 13, 'f', &attributes);
+
+    /* The remaining columns are again left unchanged, ending the row
+     * without a final run */
+    guac_terminal_display_flush(display);
+
+    for (int column = 0; column < TEST_DISPLAY_COLUMNS; column++)
+        CU_ASSERT_EQUAL(test_display_cell_mismatches(display, 0, column,
+                    &expected[column]), 0);
+
+    /* The second row must be untouched */
+    test_display_cell blank = {
+        .codepoint = 0,
+        .foreground = foreground,
+        .background = background
+    };
+
+    for (int column = 0; column < TEST_DISPLAY_COLUMNS; column++)
+        CU_ASSERT_EQUAL(test_display_cell_mismatches(display, 1, column,
+                    &blank), 0);
+
+    guac_terminal_display_free(display);
+    guac_client_free(client);
+
+}
+
@@ -0,0 +1,172 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "terminal/buffer.h"
+
+#include "terminal/glyph-cache.h"
+#include "terminal/palette.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+
+#include <stdlib.h>
+
+/**
+ * The number of distinct glyphs stored by test_glyph_cache__eviction(),
+ * several times more than the cache can hold.
+ */
+#define TEST_GLYPH_COUNT (GUAC_TERMINAL_GLYPH_CACHE_SIZE * 4)
+
+/**
+ * Allocates a new surface which may be stored within a glyph cache. The
+ * contents of the surface are irrelevant to the cache.
+ *
+ * @return
+ *     A newly-allocated surface.
+ */
+static cairo_surface_t* test_glyph_alloc() {
+    return cairo_image_surface_create(CAIRO_FORMAT_RGB24, 1, 1);
+}
+
+/**
+ * Verifies that a stored glyph is found only when looked up with the same
+ * codepoint and colors, that colors are compared by RGB value alone, and that
+ * hits and misses are counted.
+ */
+void test_glyph_cache__hit() {
+
+    guac_terminal_glyph_cache* cache = guac_terminal_glyph_cache_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cache);
+
+    guac_terminal_color foreground = GUAC_TERMINAL_INITIAL_PALETTE[7];
+    guac_terminal_color background = GUAC_TERMINAL_INITIAL_PALETTE[0];
+
+    /* Nothing is cached initially */
+    CU_ASSERT_PTR_NULL(guac_terminal_glyph_cache_lookup(cache, 'A',
+                &foreground, &background));
+    CU_ASSERT_EQUAL(cache->hits, 0);
+    CU_ASSERT_EQUAL(cache->misses, 1);
+
+    /* A stored glyph is found with the same codepoint and colors */
+    cairo_surface_t* glyph = test_glyph_alloc();
+    guac_terminal_glyph_cache_store(cache, 'A', &foreground, &background,
+            glyph);
+
+    CU_ASSERT_PTR_EQUAL(guac_terminal_glyph_cache_lookup(cache, 'A',
+                &foreground, &background), glyph);
+    CU_ASSERT_EQUAL(cache->hits, 1);
+    CU_ASSERT_EQUAL(cache->misses, 1);
+
+    /* The same color from outside the palette is still the same color */
+    guac_terminal_color truecolor = foreground;
+    truecolor.palette_index = -1;
+
+    CU_ASSERT_PTR_EQUAL(guac_terminal_glyph_cache_lookup(cache, 'A',
+                &truecolor, &background), glyph);
+    CU_ASSERT_EQUAL(cache->hits, 2);
+
+    /* A different codepoint or color is a different glyph */
+    guac_terminal_color other = GUAC_TERMINAL_INITIAL_PALETTE[1];
+
+    CU_ASSERT_PTR_NULL(guac_terminal_glyph_cache_lookup(cache, 'B',
+                &foreground, &background));
+    CU_ASSERT_PTR_NULL(guac_terminal_glyph_cache_lookup(cache, 'A',
+                &other, &background));
+    CU_ASSERT_PTR_NULL(guac_terminal_glyph_cache_lookup(cache, 'A',
+                &foreground, &other));
+    CU_ASSERT_EQUAL(cache->hits, 2);
+    CU_ASSERT_EQUAL(cache->misses, 4);
+
+    /* Clearing the cache removes all glyphs */
+    guac_terminal_glyph_cache_clear(cache);
+    CU_ASSERT_PTR_NULL(guac_terminal_glyph_cache_lookup(cache, 'A',
+                &foreground, &background));
+
+    guac_terminal_glyph_cache_free(cache);
+
+}
+
+/**
+ * Verifies that storing many more glyphs than the cache can hold evicts
+ * older glyphs, that the cache releases every glyph it evicts exactly once,
+ * and that any glyph which remains cached is still found. A reference to
+ * each glyph is held by the test, such that glyphs released by the cache can
+ * be identified by their reference count.
+ */
+void test_glyph_cache__eviction() {
+
+    guac_terminal_glyph_cache* cache = guac_terminal_glyph_cache_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cache);
+
+    cairo_surface_t** glyphs = malloc(sizeof(cairo_surface_t*)
+            * TEST_GLYPH_COUNT);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(glyphs);
+
+    guac_terminal_color foreground = GUAC_TERMINAL_INITIAL_PALETTE[7];
+    guac_terminal_color background = GUAC_TERMINAL_INITIAL_PALETTE[0];
+
+    /* Store glyphs of consecutive codepoints */
+    for (int i = 0; i < TEST_GLYPH_COUNT; i++) {
+        glyphs[i] = cairo_surface_reference(test_glyph_alloc());
+        guac_terminal_glyph_cache_store(cache, 0x100 + i, &foreground,
+                &background, glyphs[i]);
+    }
+
+    /* The most recently stored glyph can never have been evicted */
+    CU_ASSERT_PTR_EQUAL(guac_terminal_glyph_cache_lookup(cache,
+                0x100 + TEST_GLYPH_COUNT - 1, &foreground, &background),
+            glyphs[TEST_GLYPH_COUNT - 1]);
+
+    /* Exactly the glyphs still referenced by the cache must be found */
+    int found = 0;
+    int mismatched = 0;
+    for (int i = 0; i < TEST_GLYPH_COUNT; i++) {
+
+        cairo_surface_t* glyph = guac_terminal_glyph_cache_lookup(cache,
+                0x100 + i, &foreground, &background);
+
+        int retained = cairo_surface_get_reference_count(glyphs[i]) == 2;
+        if (glyph != NULL)
+            found++;
+
+        if ((glyph != NULL) != retained
+                || (glyph != NULL && glyph != glyphs[i]))
+            mismatched++;
+
+    }
+
+    CU_ASSERT_EQUAL(mismatched, 0);
+    CU_ASSERT_TRUE(found > 0);
+    CU_ASSERT_TRUE(found <= GUAC_TERMINAL_GLYPH_CACHE_SIZE);
+
+    /* Freeing the cache releases all remaining glyphs */
+    guac_terminal_glyph_cache_free(cache);
+
+    int released = 0;
+    for (int i = 0; i < TEST_GLYPH_COUNT; i++) {
+        if (cairo_surface_get_reference_count(glyphs[i]) == 1)
+            released++;
+        cairo_surface_destroy(glyphs[i]);
+    }
+
+    CU_ASSERT_EQUAL(released, TEST_GLYPH_COUNT);
+
+    free(glyphs);
+
+}
+
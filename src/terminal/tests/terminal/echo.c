@@ -0,0 +1,160 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "terminal/buffer.h"
+
+#include "terminal/terminal.h"
+#include "terminal/terminal-priv.h"
+#include "test-terminal.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The number of bytes of random terminal output generated by
+ * test_terminal__echo_text().
+ */
+#define TEST_ECHO_LENGTH 65536
+
+/**
+ * The maximum number of bytes passed to each call to guac_terminal_write()
+ * by test_terminal__echo_text().
+ */
+#define TEST_ECHO_MAX_CHUNK 512
+
+/**
+ * Non-printable sequences which may be interleaved with printable text,
+ * including control characters, multibyte UTF-8 characters, and escape
+ * sequences which affect whether text may be echoed in bulk.
+ */
+static const char* TEST_ECHO_SEQUENCES[] = {
+
+    /* Control characters */
+    "\r", "\n", "\r\n", "\t", "\b", "\x07", "\x7F",
+
+    /* Two, three, and four byte UTF-8, a wide character, and a combining
+     * character */
+    "\xC3\xA9", "\xE2\x94\x80", "\xF0\x9F\x98\x80", "\xE4\xB8\xAD",
+    "\xCC\x81",
+
+    /* Graphic rendition, including truecolor */
+    "\x1B[1;31m", "\x1B[0m", "\x1B[7m", "\x1B[2;44m",
+    "\x1B[48;2;10;20;30m", "\x1B[38;5;200m",
+
+    /* Insert mode */
+    "\x1B[4h", "\x1B[4l",
+
+    /* DEC special graphics and ASCII character sets */
+    "\x1B(0", "\x1B(B",
+
+    /* Cursor movement */
+    "\x1B[H", "\x1B[5;70H", "\x1B[3C", "\x1B[2A",
+
+    NULL
+
+};
+
+/**
+ * Appends random output to the given buffer until the given number of bytes
+ * have been written. Output consists of runs of printable ASCII interleaved
+ * with the sequences in TEST_ECHO_SEQUENCES. The final sequence may be
+ * truncated.
+ *
+ * @param buffer
+ *     The buffer to populate.
+ *
+ * @param length
+ *     The number of bytes to write to the buffer.
+ */
+static void test_echo_generate(char* buffer, int length) {
+
+    int sequences = 0;
+    while (TEST_ECHO_SEQUENCES[sequences] != NULL)
+        sequences++;
+
+    int written = 0;
+    while (written < length) {
+
+        /* Printable text */
+        if (rand() % 2) {
+            int count = 1 + rand() % 100;
+            for (int i = 0; i < count && written < length; i++)
+                buffer[written++] = 0x20 + rand() % (0x7F - 0x20);
+        }
+
+        /* Anything else */
+        else {
+            const char* sequence = TEST_ECHO_SEQUENCES[rand() % sequences];
+            while (*sequence != '\0' && written < length)
+                buffer[written++] = *(sequence++);
+        }
+
+    }
+
+}
+
+/**
+ * Verifies that output written with guac_terminal_write(), which echoes runs
+ * of printable text in bulk, results in exactly the same terminal contents
+ * and cursor position as the same output handled one byte at a time by the
+ * terminal's character handlers. Output is written in chunks of random size,
+ * such that chunks end within escape sequences and UTF-8 characters.
+ */
+void test_terminal__echo_text() {
+
+    guac_terminal* bulk = test_terminal_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(bulk);
+
+    guac_terminal* reference = test_terminal_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(reference);
+
+    char* output = malloc(TEST_ECHO_LENGTH);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(output);
+
+    srand(0x5EED);
+    test_echo_generate(output, TEST_ECHO_LENGTH);
+
+    /* Write output in bulk, in chunks of random size */
+    int written = 0;
+    while (written < TEST_ECHO_LENGTH) {
+
+        int length = 1 + rand() % TEST_ECHO_MAX_CHUNK;
+        if (length > TEST_ECHO_LENGTH - written)
+            length = TEST_ECHO_LENGTH - written;
+
+        guac_terminal_write(bulk, output + written, length);
+        written += length;
+
+    }
+
+    /* Handle the same output one byte at a time */
+    guac_terminal_lock(reference);
+    for (int i = 0; i < TEST_ECHO_LENGTH; i++)
+        reference->char_handler(reference, output[i]);
+    guac_terminal_unlock(reference);
+
+    test_terminal_assert_buffer_equal(reference, bulk);
+
+    free(output);
+    test_terminal_free(bulk);
+    test_terminal_free(reference);
+
+}
+
@@ -0,0 +1,158 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "terminal/buffer.h"
+
+#include "common/surface.h"
+#include "terminal/display.h"
+#include "terminal/terminal.h"
+#include "terminal/terminal-priv.h"
+#include "test-terminal.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * The number of screens of output written by test_terminal__flood().
+ */
+#define TEST_FLOOD_SCREENS 3
+
+/**
+ * Writes the given line of output to the given terminal. Lines vary in
+ * length and color, such that no two consecutive lines are identical.
+ *
+ * @param terminal
+ *     The terminal to write to.
+ *
+ * @param line
+ *     The number of the line to write.
+ */
+static void test_flood_write_line(guac_terminal* terminal, int line) {
+
+    char buffer[256];
+    int length = snprintf(buffer, sizeof(buffer),
+            "\x1B[3%im%i: \x1B[4%im%.*s\x1B[0m\r\n", line % 8, line,
+            (line + 3) % 8, line % 40,
+            "the quick brown fox jumps over the lazy dog");
+
+    guac_terminal_write(terminal, buffer, length);
+
+}
+
+/**
+ * Flushes all pending changes to the display of the given terminal, as the
+ * terminal would when rendering a frame.
+ *
+ * @param terminal
+ *     The terminal to flush.
+ */
+static void test_flood_flush(guac_terminal* terminal) {
+    guac_terminal_lock(terminal);
+    guac_terminal_flush(terminal);
+    guac_terminal_unlock(terminal);
+}
+
+/**
+ * Returns the number of pixels which differ between the display surfaces
+ * of the given terminals, which must have the same dimensions.
+ *
+ * @param a
+ *     The first terminal to compare.
+ *
+ * @param b
+ *     The second terminal to compare.
+ *
+ * @return
+ *     The number of pixels which differ.
+ */
+static int test_flood_display_mismatches(guac_terminal* a, guac_terminal* b) {
+
+    guac_common_surface* surface_a = a->display->display_surface;
+    guac_common_surface* surface_b = b->display->display_surface;
+
+    int mismatches = 0;
+    for (int y = 0; y < surface_a->height; y++) {
+
+        uint32_t* pixel_a = (uint32_t*) (surface_a->buffer
+                + y * surface_a->stride);
+        uint32_t* pixel_b = (uint32_t*) (surface_b->buffer
+                + y * surface_b->stride);
+
+        for (int x = 0; x < surface_a->width; x++) {
+            if ((pixel_a[x] & 0xFFFFFF) != (pixel_b[x] & 0xFFFFFF))
+                mismatches++;
+        }
+
+    }
+
+    return mismatches;
+
+}
+
+/**
+ * Verifies that output which scrolls several screens within a single frame
+ * floods the terminal, and that once that frame is flushed, the buffer and
+ * display agree exactly with those of a terminal which received the same
+ * output one line per frame, never flooding.
+ */
+void test_terminal__flood() {
+
+    guac_terminal* flooded = test_terminal_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(flooded);
+
+    guac_terminal* reference = test_terminal_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(reference);
+
+    test_flood_flush(flooded);
+    test_flood_flush(reference);
+
+    int lines = flooded->term_height * TEST_FLOOD_SCREENS;
+
+    /* Write all output within a single frame */
+    for (int line = 0; line < lines; line++)
+        test_flood_write_line(flooded, line);
+
+    CU_ASSERT_TRUE(flooded->flooded);
+    test_flood_flush(flooded);
+
+    /* Write the same output, flushing after each line */
+    int reference_flooded = 0;
+    for (int line = 0; line < lines; line++) {
+        test_flood_write_line(reference, line);
+        if (reference->flooded)
+            reference_flooded++;
+        test_flood_flush(reference);
+    }
+
+    CU_ASSERT_EQUAL(reference_flooded, 0);
+
+    test_terminal_assert_buffer_equal(reference, flooded);
+
+    CU_ASSERT_EQUAL_FATAL(flooded->display->display_surface->width,
+            reference->display->display_surface->width);
+    CU_ASSERT_EQUAL_FATAL(flooded->display->display_surface->height,
+            reference->display->display_surface->height);
+    CU_ASSERT_EQUAL(test_flood_display_mismatches(reference, flooded), 0);
+
+    test_terminal_free(flooded);
+    test_terminal_free(reference);
+
+}
+
@@ -0,0 +1,162 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "terminal/buffer.h"
+
+#include "terminal/buffer.h"
+#include "terminal/palette.h"
+#include "terminal/terminal.h"
+#include "terminal/terminal-priv.h"
+#include "terminal/types.h"
+#include "test-terminal.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+guac_terminal* test_terminal_alloc() {
+
+    guac_client* client = guac_client_alloc();
+    if (client == NULL)
+        return NULL;
+
+    /* Prevent the render thread from drawing frames independently of the
+     * test */
+    guac_client_stop(client);
+
+    guac_terminal_options* options = guac_terminal_options_create(
+            TEST_TERMINAL_WIDTH, TEST_TERMINAL_HEIGHT, 96);
+
+    guac_terminal* terminal = guac_terminal_create(client, options);
+    free(options);
+
+    if (terminal == NULL)
+        guac_client_free(client);
+
+    return terminal;
+
+}
+
+void test_terminal_free(guac_terminal* terminal) {
+    guac_client* client = terminal->client;
+    guac_terminal_free(terminal);
+    guac_client_free(client);
+}
+
+/**
+ * Returns whether the given characters are identical in value, width, and
+ * attributes.
+ *
+ * @param a
+ *     The first character to compare.
+ *
+ * @param b
+ *     The second character to compare.
+ *
+ * @return
+ *     true if the characters are identical, false otherwise.
+ */
+static bool test_terminal_char_equal(const guac_terminal_char* a,
+        const guac_terminal_char* b) {
+
+    return a->value == b->value
+        && a->width == b->width
+        && a->attributes.bold == b->attributes.bold
+        && a->attributes.half_bright == b->attributes.half_bright
+        && a->attributes.reverse == b->attributes.reverse
+        && a->attributes.cursor == b->attributes.cursor
+        && a->attributes.underscore == b->attributes.underscore
+        && guac_terminal_colorcmp(&a->attributes.foreground,
+                &b->attributes.foreground) == 0
+        && guac_terminal_colorcmp(&a->attributes.background,
+                &b->attributes.background) == 0;
+
+}
+
+/**
+ * Unpacks the given row of the given terminal into the given array, which
+ * must be large enough to hold a character for each column of the terminal.
+ * Columns beyond the end of the row receive the default character of the
+ * terminal's buffer.
+ *
+ * @param terminal
+ *     The terminal containing the row.
+ *
+ * @param row
+ *     The index of the row to unpack, relative to the top of the terminal
+ *     display. Negative values refer to rows within the scrollback.
+ *
+ * @param characters
+ *     The array to populate.
+ */
+static void test_terminal_unpack_row(guac_terminal* terminal, int row,
+        guac_terminal_char* characters) {
+
+    guac_terminal_buffer* buffer = terminal->buffer;
+    const guac_terminal_buffer_row* buffer_row =
+        guac_terminal_buffer_peek_row(buffer, row);
+
+    for (int column = 0; column < terminal->term_width; column++) {
+        if (column < buffer_row->length)
+            guac_terminal_buffer_unpack(buffer,
+                    &buffer_row->characters[column], &characters[column]);
+        else
+            characters[column] = buffer->default_character;
+    }
+
+}
+
+void test_terminal_assert_buffer_equal(guac_terminal* expected,
+        guac_terminal* actual) {
+
+    CU_ASSERT_EQUAL_FATAL(actual->term_width, expected->term_width);
+    CU_ASSERT_EQUAL_FATAL(actual->term_height, expected->term_height);
+    CU_ASSERT_EQUAL_FATAL(actual->buffer->length, expected->buffer->length);
+
+    CU_ASSERT_EQUAL(actual->cursor_row, expected->cursor_row);
+    CU_ASSERT_EQUAL(actual->cursor_col, expected->cursor_col);
+
+    int width = expected->term_width;
+    guac_terminal_char* expected_row = malloc(sizeof(guac_terminal_char) * width);
+    guac_terminal_char* actual_row = malloc(sizeof(guac_terminal_char) * width);
+
+    /* Compare every row, including the scrollback */
+    int mismatched = 0;
+    int first = expected->term_height - expected->buffer->length;
+    for (int row = first; row < expected->term_height; row++) {
+
+        test_terminal_unpack_row(expected, row, expected_row);
+        test_terminal_unpack_row(actual, row, actual_row);
+
+        for (int column = 0; column < width; column++) {
+            if (!test_terminal_char_equal(&expected_row[column],
+                        &actual_row[column]))
+                mismatched++;
+        }
+
+    }
+
+    CU_ASSERT_EQUAL(mismatched, 0);
+
+    free(expected_row);
+    free(actual_row);
+
+}
+
@@ -0,0 +1,73 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "terminal/buffer.h"
+
+#ifndef GUAC_TERMINAL_TEST_TERMINAL_H
+#define GUAC_TERMINAL_TEST_TERMINAL_H
+
+#include "terminal/terminal.h"
+
+/**
+ * The width of each terminal allocated by test_terminal_alloc(), in pixels.
+ */
+#define TEST_TERMINAL_WIDTH 640
+
+/**
+ * The height of each terminal allocated by test_terminal_alloc(), in pixels.
+ */
+#define TEST_TERMINAL_HEIGHT 480
+
+/**
+ * Allocates a new terminal of TEST_TERMINAL_WIDTH by TEST_TERMINAL_HEIGHT
+ * pixels, using the default font and color scheme, along with a new client
+ * which has no users. The client is stopped before the terminal is created,
+ * such that the terminal never renders frames in the background; tests must
+ * instead invoke guac_terminal_flush() explicitly.
+ *
+ * @return
+ *     A newly-allocated terminal, which must eventually be freed with
+ *     test_terminal_free(), or NULL if the terminal cannot be created.
+ */
+guac_terminal* test_terminal_alloc();
+
+/**
+ * Frees the given terminal along with the client allocated for it by
+ * test_terminal_alloc().
+ *
+ * @param terminal
+ *     The terminal to free.
+ */
+void test_terminal_free(guac_terminal* terminal);
+
+/**
+ * Asserts that the given terminals have identical dimensions, cursor
+ * positions, and buffer contents, including all scrollback. Characters are
+ * compared by value, width, and attributes.
+ *
+ * @param expected
+ *     The terminal having the expected contents.
+ *
+ * @param actual
+ *     The terminal whose contents should be verified.
+ */
+void test_terminal_assert_buffer_equal(guac_terminal* expected,
+        guac_terminal* actual);
+
+#endif
+
@@ -25,6 +25,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/types.h>
@@ -172,6 +173,30 @@ void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
 
 }
 
+void guac_terminal_typescript_write_data(guac_terminal_typescript* typescript,
+        const char* data, int length) {
+
+    while (length > 0) {
+
+        /* Flush buffer if no space is available */
+        if (typescript->length == sizeof(typescript->buffer))
+            guac_terminal_typescript_flush(typescript);
+
+        /* Append as much data as the buffer can hold */
+        int chunk = sizeof(typescript->buffer) - typescript->length;
+        if (chunk > length)
+            chunk = length;
+
+        memcpy(typescript->buffer + typescript->length, data, chunk);
+        typescript->length += chunk;
+
+        data += chunk;
+        length -= chunk;
+
+    }
+
+}
+
 void guac_terminal_typescript_flush(guac_terminal_typescript* typescript) {
 
     /* Do nothing if nothing to flush */